@@ -3,8 +3,41 @@
 
 #include <d3d9.h>
 #include <dxgi.h>
+#include "pixel_conv.h"
 
 DXGI_FORMAT ConvertD3DFormatToDXGIFormat(D3DFORMAT format);
 D3DFORMAT ConvertDXGIFormatToD3DFormat(DXGI_FORMAT format);
 
+// Copies srcRect of pSrc to pDst at dstPoint, converting between any two of
+// R5G6B5, X1R5G5B5, A1R5G5B5, A4R4G4B4, A8R8G8B8, X8R8G8B8 and
+// A16B16G16R16F (pixel_conv.h). False for any other format.
+inline bool ConvertD3DPixels(void* pDst, UINT dstPitch, D3DFORMAT dstFormat, const POINT& dstPoint,
+    const void* pSrc, UINT srcPitch, D3DFORMAT srcFormat, const RECT& srcRect)
+{
+    if (srcRect.left < 0 || srcRect.top < 0 || dstPoint.x < 0 || dstPoint.y < 0)
+        return false;
+    const ZeroMod::zm_pc_rect r = { (uint32_t)srcRect.left, (uint32_t)srcRect.top,
+        (uint32_t)srcRect.right, (uint32_t)srcRect.bottom };
+    return ZeroMod::pc_convert(pDst, dstPitch, (uint32_t)dstFormat, (uint32_t)dstPoint.x, (uint32_t)dstPoint.y,
+        pSrc, srcPitch, (uint32_t)srcFormat, r);
+}
+
+// Rows of memory behind 'height' pixel rows: block-compressed formats keep
+// one row per 4x4 block row.
+inline UINT D3DFormatRowCount(D3DFORMAT format, UINT height)
+{
+    switch (format) {
+    case D3DFMT_DXT1:
+    case D3DFMT_DXT2:
+    case D3DFMT_DXT3:
+    case D3DFMT_DXT4:
+    case D3DFMT_DXT5:
+    case (D3DFORMAT)MAKEFOURCC('A', 'T', 'I', '1'):
+    case (D3DFORMAT)MAKEFOURCC('A', 'T', 'I', '2'):
+        return (height + 3) / 4;
+    default:
+        return height;
+    }
+}
+
 #endif // FORMAT_CONVERSION_H
\ No newline at end of file
@@ -0,0 +1,440 @@
+#include "call_rec.h"
+
+#include <windows.h>
+#include <d3dx9.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace ZeroMod {
+
+    static void zm_cr_dbgf(const char* fmt, ...)
+    {
+        char b[512];
+        va_list va;
+        va_start(va, fmt);
+        _vsnprintf(b, sizeof(b), fmt, va);
+        va_end(va);
+        b[sizeof(b) - 1] = '\0';
+        OutputDebugStringA(b);
+    }
+
+    struct cr_chunk
+    {
+        cr_chunk* next;
+        uint32_t used;
+        uint8_t data[ZM_CR_CHUNK_BYTES];
+    };
+
+    struct cr_id_slot
+    {
+        const void* key;
+        uint32_t id;
+    };
+
+    struct zm_call_rec
+    {
+        HANDLE file;
+        HANDLE thread;
+        HANDLE wake;                // writer: chunks queued or stopping
+        HANDLE freed;               // producer: a chunk came back
+        CRITICAL_SECTION lock;      // guards the two lists
+        cr_chunk* full_head;        // FIFO for the writer
+        cr_chunk* full_tail;
+        cr_chunk* free_list;
+        volatile LONG stop;
+
+        // render thread only
+        cr_chunk* cur;
+        unsigned chunks;
+        bool contents;
+        cr_id_slot* ids;
+        unsigned ids_cap;           // power of two
+        unsigned ids_count;
+        uint32_t next_id;
+
+        uint64_t records;
+        uint64_t bytes;
+        uint64_t stalls;            // writer fell ZM_CR_MAX_CHUNKS behind
+        volatile LONG write_failed;
+    };
+
+    static DWORD WINAPI cr_writer_proc(LPVOID param)
+    {
+        zm_call_rec* rec = (zm_call_rec*)param;
+        for (;;) {
+            WaitForSingleObject(rec->wake, INFINITE);
+
+            for (;;) {
+                EnterCriticalSection(&rec->lock);
+                cr_chunk* c = rec->full_head;
+                if (c) {
+                    rec->full_head = c->next;
+                    if (!rec->full_head)
+                        rec->full_tail = nullptr;
+                }
+                LeaveCriticalSection(&rec->lock);
+                if (!c)
+                    break;
+
+                DWORD written = 0;
+                if (!WriteFile(rec->file, c->data, c->used, &written, NULL) || written != c->used)
+                    InterlockedExchange(&rec->write_failed, 1);
+
+                c->used = 0;
+                EnterCriticalSection(&rec->lock);
+                c->next = rec->free_list;
+                rec->free_list = c;
+                LeaveCriticalSection(&rec->lock);
+                SetEvent(rec->freed);
+            }
+
+            if (InterlockedCompareExchange(&rec->stop, 0, 0))
+                return 0;
+        }
+    }
+
+    static void cr_submit(zm_call_rec* rec, cr_chunk* c)
+    {
+        c->next = nullptr;
+        EnterCriticalSection(&rec->lock);
+        if (rec->full_tail)
+            rec->full_tail->next = c;
+        else
+            rec->full_head = c;
+        rec->full_tail = c;
+        LeaveCriticalSection(&rec->lock);
+        SetEvent(rec->wake);
+    }
+
+    static cr_chunk* cr_take(zm_call_rec* rec)
+    {
+        for (;;) {
+            EnterCriticalSection(&rec->lock);
+            cr_chunk* c = rec->free_list;
+            if (c)
+                rec->free_list = c->next;
+            LeaveCriticalSection(&rec->lock);
+            if (c)
+                return c;
+
+            if (rec->chunks < ZM_CR_MAX_CHUNKS) {
+                c = (cr_chunk*)malloc(sizeof(cr_chunk));
+                if (c) {
+                    rec->chunks++;
+                    c->used = 0;
+                    return c;
+                }
+            }
+
+            // Don't drop records: a replay of a stream with holes is useless
+            rec->stalls++;
+            WaitForSingleObject(rec->freed, 100);
+        }
+    }
+
+    // Room for a record of `bytes` (head included) in the current chunk
+    static uint32_t* cr_begin(zm_call_rec* rec, uint8_t op, uint32_t bytes)
+    {
+        if (rec->cur->used + bytes > ZM_CR_CHUNK_BYTES) {
+            cr_submit(rec, rec->cur);
+            rec->cur = cr_take(rec);
+        }
+        uint32_t* p = (uint32_t*)(rec->cur->data + rec->cur->used);
+        rec->cur->used += bytes;
+        rec->records++;
+        rec->bytes += bytes;
+        p[0] = cr_head(op, bytes);
+        return p + 1;
+    }
+
+    template <typename T>
+    static T* cr_put(zm_call_rec* rec, uint8_t op)
+    {
+        static_assert(sizeof(T) % 4 == 0, "record payloads are 32-bit words");
+        return (T*)cr_begin(rec, op, (uint32_t)(4 + sizeof(T)));
+    }
+
+    static unsigned cr_hash(const void* key, unsigned mask)
+    {
+        uint64_t k = (uint64_t)(uintptr_t)key;
+        k ^= k >> 17;
+        k *= 0x9E3779B97F4A7C15ull;
+        return (unsigned)(k >> 32) & mask;
+    }
+
+    static bool cr_ids_grow(zm_call_rec* rec)
+    {
+        const unsigned cap = rec->ids_cap ? rec->ids_cap * 2 : 1024;
+        cr_id_slot* ids = (cr_id_slot*)calloc(cap, sizeof(cr_id_slot));
+        if (!ids)
+            return false;
+
+        for (unsigned i = 0; i < rec->ids_cap; ++i) {
+            const cr_id_slot& e = rec->ids[i];
+            if (!e.key)
+                continue;
+            unsigned h = cr_hash(e.key, cap - 1);
+            while (ids[h].key)
+                h = (h + 1) & (cap - 1);
+            ids[h] = e;
+        }
+
+        free(rec->ids);
+        rec->ids = ids;
+        rec->ids_cap = cap;
+        return true;
+    }
+
+    static uint32_t cr_assign(zm_call_rec* rec, const void* obj, bool fresh)
+    {
+        if (!obj)
+            return 0;
+        if ((rec->ids_count + 1) * 4 > rec->ids_cap * 3 && !cr_ids_grow(rec))
+            return 0;
+
+        const unsigned mask = rec->ids_cap - 1;
+        unsigned h = cr_hash(obj, mask);
+        while (rec->ids[h].key && rec->ids[h].key != obj)
+            h = (h + 1) & mask;
+
+        cr_id_slot& e = rec->ids[h];
+        if (e.key && !fresh)
+            return e.id;
+        if (!e.key)
+            rec->ids_count++;
+        e.key = obj;
+        e.id = rec->next_id++;
+        return e.id;
+    }
+
+    uint32_t cr_id(zm_call_rec* rec, const void* obj)
+    {
+        return cr_assign(rec, obj, false);
+    }
+
+    uint32_t cr_new_id(zm_call_rec* rec, const void* obj)
+    {
+        return cr_assign(rec, obj, true);
+    }
+
+    zm_call_rec* cr_open(const char* path, bool contents)
+    {
+        zm_call_rec* rec = (zm_call_rec*)calloc(1, sizeof(zm_call_rec));
+        if (!rec)
+            return nullptr;
+
+        rec->next_id = 1;
+        rec->contents = contents;
+        rec->file = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (rec->file == INVALID_HANDLE_VALUE) {
+            zm_cr_dbgf("[ZeroMod] capture: can't create '%s' (%lu)\n", path, (unsigned long)GetLastError());
+            free(rec);
+            return nullptr;
+        }
+
+        zm_cr_file_header hdr = {};
+        hdr.magic = ZM_CR_MAGIC;
+        hdr.version = ZM_CR_VERSION;
+        hdr.header_bytes = sizeof(hdr);
+        hdr.flags = contents ? ZM_CR_FILE_CONTENTS : 0;
+        DWORD written = 0;
+        WriteFile(rec->file, &hdr, sizeof(hdr), &written, NULL);
+
+        InitializeCriticalSection(&rec->lock);
+        rec->wake = CreateEventA(NULL, FALSE, FALSE, NULL);
+        rec->freed = CreateEventA(NULL, FALSE, FALSE, NULL);
+        rec->cur = cr_take(rec);
+        rec->thread = rec->cur && rec->wake && rec->freed
+            ? CreateThread(NULL, 0, cr_writer_proc, rec, 0, NULL) : NULL;
+        if (!rec->thread) {
+            zm_cr_dbgf("[ZeroMod] capture: writer thread FAILED (%lu)\n", (unsigned long)GetLastError());
+            if (rec->wake) CloseHandle(rec->wake);
+            if (rec->freed) CloseHandle(rec->freed);
+            DeleteCriticalSection(&rec->lock);
+            CloseHandle(rec->file);
+            free(rec->cur);
+            free(rec);
+            return nullptr;
+        }
+
+        zm_cr_dbgf("[ZeroMod] capture: recording to '%s'%s\n", path, contents ? " (with shader bytecode)" : "");
+        return rec;
+    }
+
+    void cr_close(zm_call_rec* rec)
+    {
+        if (!rec)
+            return;
+
+        if (rec->cur->used)
+            cr_submit(rec, rec->cur);
+        else
+            free(rec->cur);
+        rec->cur = nullptr;
+
+        InterlockedExchange(&rec->stop, 1);
+        SetEvent(rec->wake);
+        WaitForSingleObject(rec->thread, INFINITE);
+        CloseHandle(rec->thread);
+        CloseHandle(rec->wake);
+        CloseHandle(rec->freed);
+        DeleteCriticalSection(&rec->lock);
+        CloseHandle(rec->file);
+
+        zm_cr_dbgf("[ZeroMod] capture: closed, %llu records, %llu KB, %u ids, %llu writer stalls%s\n",
+            (unsigned long long)rec->records,
+            (unsigned long long)(rec->bytes >> 10),
+            rec->next_id - 1,
+            (unsigned long long)rec->stalls,
+            rec->write_failed ? ", WRITE FAILED" : "");
+
+        while (rec->free_list) {
+            cr_chunk* c = rec->free_list;
+            rec->free_list = c->next;
+            free(c);
+        }
+        free(rec->ids);
+        free(rec);
+    }
+
+    void cr_flush(zm_call_rec* rec)
+    {
+        if (!rec->cur->used)
+            return;
+        cr_submit(rec, rec->cur);
+        rec->cur = cr_take(rec);
+    }
+
+    static void cr_fill_vp(zm_cr_viewport& o, const D3DVIEWPORT9& vp)
+    {
+        o.x = vp.X;
+        o.y = vp.Y;
+        o.w = vp.Width;
+        o.h = vp.Height;
+        memcpy(&o.min_z, &vp.MinZ, 4);
+        memcpy(&o.max_z, &vp.MaxZ, 4);
+    }
+
+    void cr_frame(zm_call_rec* rec, uint64_t frame, UINT bb_w, UINT bb_h)
+    {
+        zm_cr_frame* r = cr_put<zm_cr_frame>(rec, ZM_CR_OP_FRAME);
+        r->frame = (uint32_t)frame;
+        r->bb_w = bb_w;
+        r->bb_h = bb_h;
+    }
+
+    void cr_create_tex(zm_call_rec* rec, const void* tex, uint32_t type, UINT w, UINT h,
+        UINT levels, DWORD usage, D3DFORMAT format, D3DPOOL pool)
+    {
+        const uint32_t id = cr_new_id(rec, tex);
+        zm_cr_create_tex* r = cr_put<zm_cr_create_tex>(rec, ZM_CR_OP_CREATE_TEX);
+        r->id = id;
+        r->type = type;
+        r->w = w;
+        r->h = h;
+        r->levels = levels;
+        r->usage = usage;
+        r->format = (uint32_t)format;
+        r->pool = (uint32_t)pool;
+    }
+
+    void cr_set_rt(zm_call_rec* rec, DWORD index, IDirect3DSurface9* rt, UINT w, UINT h)
+    {
+        const uint32_t id = cr_id(rec, rt);
+        zm_cr_set_rt* r = cr_put<zm_cr_set_rt>(rec, ZM_CR_OP_SET_RT);
+        r->index = index;
+        r->id = id;
+        r->w = w;
+        r->h = h;
+    }
+
+    void cr_set_tex(zm_call_rec* rec, DWORD stage, IDirect3DBaseTexture9* tex, UINT w, UINT h, bool is_2d)
+    {
+        const uint32_t id = cr_id(rec, tex);
+        zm_cr_set_tex* r = cr_put<zm_cr_set_tex>(rec, ZM_CR_OP_SET_TEX);
+        r->stage = stage;
+        r->id = id;
+        r->w = w;
+        r->h = h;
+        r->is_2d = is_2d ? 1 : 0;
+    }
+
+    void cr_set_vp(zm_call_rec* rec, const D3DVIEWPORT9& vp)
+    {
+        cr_fill_vp(*cr_put<zm_cr_viewport>(rec, ZM_CR_OP_SET_VP), vp);
+    }
+
+    void cr_state(zm_call_rec* rec, uint8_t op, DWORD a, DWORD b, DWORD value, bool forwarded)
+    {
+        zm_cr_state* r = cr_put<zm_cr_state>(rec, op);
+        r->a = a;
+        r->b = b;
+        r->value = value;
+        r->forwarded = forwarded ? 1 : 0;
+    }
+
+    void cr_draw(zm_call_rec* rec, D3DPRIMITIVETYPE prim, UINT start, UINT count, uint32_t key, uint32_t sig)
+    {
+        zm_cr_draw* r = cr_put<zm_cr_draw>(rec, ZM_CR_OP_DRAW);
+        r->prim = (uint32_t)prim;
+        r->start = start;
+        r->count = count;
+        r->key = key;
+        r->sig = sig;
+    }
+
+    void cr_clear(zm_call_rec* rec, DWORD rects, DWORD flags, D3DCOLOR color)
+    {
+        zm_cr_clear* r = cr_put<zm_cr_clear>(rec, ZM_CR_OP_CLEAR);
+        r->rects = rects;
+        r->flags = flags;
+        r->color = color;
+    }
+
+    void cr_binds(zm_call_rec* rec, IDirect3DSurface9* rt0, UINT rt0_w, UINT rt0_h,
+        IDirect3DBaseTexture9* tex0, UINT tex0_w, UINT tex0_h, bool tex0_2d, const D3DVIEWPORT9& vp)
+    {
+        const uint32_t rt0_id = cr_id(rec, rt0);
+        const uint32_t tex0_id = cr_id(rec, tex0);
+        zm_cr_binds* r = cr_put<zm_cr_binds>(rec, ZM_CR_OP_BINDS);
+        r->rt0_id = rt0_id;
+        r->rt0_w = rt0_w;
+        r->rt0_h = rt0_h;
+        r->tex0_id = tex0_id;
+        r->tex0_w = tex0_w;
+        r->tex0_h = tex0_h;
+        r->tex0_2d = tex0_2d ? 1 : 0;
+        cr_fill_vp(r->vp, vp);
+    }
+
+    void cr_shader(zm_call_rec* rec, const void* shader, uint32_t type, const DWORD* byte_code)
+    {
+        const uint32_t id = cr_new_id(rec, shader);
+        const uint32_t size = byte_code ? (uint32_t)D3DXGetShaderSize(byte_code) : 0;
+
+        // Bytecode that doesn't fit a chunk is left out; bytes still says how big it was
+        uint32_t body = 0;
+        if (rec->contents && size && 4 + sizeof(zm_cr_shader) + size <= ZM_CR_CHUNK_BYTES)
+            body = (size + 3) & ~3u;
+
+        zm_cr_shader* r = (zm_cr_shader*)cr_begin(rec, ZM_CR_OP_SHADER,
+            (uint32_t)(4 + sizeof(zm_cr_shader) + body));
+        r->id = id;
+        r->type = type;
+        r->bytes = size;
+        if (body) {
+            uint8_t* dst = (uint8_t*)(r + 1);
+            memcpy(dst, byte_code, size);
+            memset(dst + size, 0, body - size);
+        }
+    }
+
+    void cr_reset(zm_call_rec* rec)
+    {
+        cr_begin(rec, ZM_CR_OP_RESET, 4);
+    }
+
+} // namespace ZeroMod
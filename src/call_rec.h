@@ -0,0 +1,51 @@
+#pragma once
+#include <d3d9.h>
+#include <stdint.h>
+#include "call_rec_format.h"
+
+// ---- Call-stream capture ----
+// With [capture] enabled=true in the ini, the proxy records the calls its
+// decisions depend on (bindings, state, draws, frames) in the format from
+// call_rec_format.h. Records are appended to fixed-size chunks on the
+// render thread; a writer thread puts full chunks on disk, so the hot path
+// is a bounds check and a few stores. The capture starts and stops at a
+// Present so the file always holds whole frames.
+// Set ZM_CALL_REC to 0 to compile the hooks out.
+#define ZM_CALL_REC 1
+// Chunk size and how many may wait for the writer before the render thread blocks
+#define ZM_CR_CHUNK_BYTES (256 * 1024)
+#define ZM_CR_MAX_CHUNKS 64
+
+namespace ZeroMod {
+
+    struct zm_call_rec;
+
+    // contents: also store shader bytecode
+    zm_call_rec* cr_open(const char* path, bool contents);
+    // Flushes, waits for the writer and frees rec
+    void cr_close(zm_call_rec* rec);
+
+    // Resource ID for obj, handing out a new one on first sight (0 = null)
+    uint32_t cr_id(zm_call_rec* rec, const void* obj);
+    // Fresh ID for a just-created object (its address may be recycled)
+    uint32_t cr_new_id(zm_call_rec* rec, const void* obj);
+
+    void cr_frame(zm_call_rec* rec, uint64_t frame, UINT bb_w, UINT bb_h);
+    void cr_create_tex(zm_call_rec* rec, const void* tex, uint32_t type, UINT w, UINT h,
+        UINT levels, DWORD usage, D3DFORMAT format, D3DPOOL pool);
+    void cr_set_rt(zm_call_rec* rec, DWORD index, IDirect3DSurface9* rt, UINT w, UINT h);
+    void cr_set_tex(zm_call_rec* rec, DWORD stage, IDirect3DBaseTexture9* tex, UINT w, UINT h, bool is_2d);
+    void cr_set_vp(zm_call_rec* rec, const D3DVIEWPORT9& vp);
+    // op: ZM_CR_OP_SET_RS / _SET_SAMP / _SET_TSS (a = 0 for render states)
+    void cr_state(zm_call_rec* rec, uint8_t op, DWORD a, DWORD b, DWORD value, bool forwarded);
+    void cr_draw(zm_call_rec* rec, D3DPRIMITIVETYPE prim, UINT start, UINT count, uint32_t key, uint32_t sig);
+    void cr_clear(zm_call_rec* rec, DWORD rects, DWORD flags, D3DCOLOR color);
+    void cr_binds(zm_call_rec* rec, IDirect3DSurface9* rt0, UINT rt0_w, UINT rt0_h,
+        IDirect3DBaseTexture9* tex0, UINT tex0_w, UINT tex0_h, bool tex0_2d, const D3DVIEWPORT9& vp);
+    void cr_shader(zm_call_rec* rec, const void* shader, uint32_t type, const DWORD* byte_code);
+    void cr_reset(zm_call_rec* rec);
+
+    // Hand the partly filled chunk to the writer (once per frame)
+    void cr_flush(zm_call_rec* rec);
+
+} // namespace ZeroMod
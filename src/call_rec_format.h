@@ -0,0 +1,86 @@
+#pragma once
+#include <stdint.h>
+
+// ---- Call-stream capture format ----
+// Shared by the in-process recorder (call_rec.cpp) and the offline replay
+// tool (tools/zm_replay.cpp), so no D3D or Windows types in here.
+//
+// File: zm_cr_file_header, then records back to back until EOF. Every
+// record starts with a 32-bit head (opcode in the low 8 bits, record size
+// in bytes including the head in the high 24) followed by 32-bit payload
+// words, so the file can be mapped and walked in place. Resources are
+// referred to by small IDs handed out in first-seen order (0 = null).
+
+#define ZM_CR_MAGIC 0x52434D5Au // "ZMCR"
+#define ZM_CR_VERSION 1
+
+namespace ZeroMod {
+
+    enum : uint32_t {
+        ZM_CR_FILE_CONTENTS = 1u << 0,  // shader records carry their bytecode
+    };
+
+    struct zm_cr_file_header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t header_bytes;          // sizeof(zm_cr_file_header)
+        uint32_t flags;                 // ZM_CR_FILE_*
+    };
+
+    enum : uint8_t {
+        ZM_CR_OP_NOP = 0,
+        ZM_CR_OP_FRAME,                 // Present
+        ZM_CR_OP_CREATE_TEX,
+        ZM_CR_OP_SET_RT,
+        ZM_CR_OP_SET_TEX,
+        ZM_CR_OP_SET_VP,
+        ZM_CR_OP_SET_RS,
+        ZM_CR_OP_SET_SAMP,
+        ZM_CR_OP_SET_TSS,
+        ZM_CR_OP_DRAW,
+        ZM_CR_OP_CLEAR,
+        ZM_CR_OP_BINDS,                 // bindings the proxy had to read back from the device
+        ZM_CR_OP_SHADER,
+        ZM_CR_OP_RESET,
+        ZM_CR_OP_COUNT
+    };
+
+    enum : uint32_t {
+        ZM_CR_TEX_2D = 0,
+        ZM_CR_TEX_CUBE,
+        ZM_CR_TEX_VOLUME,
+    };
+
+    enum : uint32_t {
+        ZM_CR_SHADER_VS = 0,
+        ZM_CR_SHADER_PS,
+    };
+
+    inline uint32_t cr_head(uint32_t op, uint32_t bytes) { return op | (bytes << 8); }
+    inline uint32_t cr_head_op(uint32_t head) { return head & 0xFF; }
+    inline uint32_t cr_head_bytes(uint32_t head) { return head >> 8; }
+
+    // Payloads (after the head word)
+    struct zm_cr_frame { uint32_t frame, bb_w, bb_h; };
+    struct zm_cr_create_tex { uint32_t id, type, w, h, levels, usage, format, pool; };
+    struct zm_cr_set_rt { uint32_t index, id, w, h; };
+    // w/h/is_2d from the proxy's descriptor table (0 when it doesn't know)
+    struct zm_cr_set_tex { uint32_t stage, id, w, h, is_2d; };
+    // min_z/max_z are float bits
+    struct zm_cr_viewport { uint32_t x, y, w, h, min_z, max_z; };
+    // forwarded = 0 when the state filter dropped the call
+    struct zm_cr_state { uint32_t a, b, value, forwarded; };
+    // key/sig: draw_sig key and matched signatures (0 for non-quad draws)
+    struct zm_cr_draw { uint32_t prim, start, count, key, sig; };
+    struct zm_cr_clear { uint32_t rects, flags, color; };
+    struct zm_cr_binds
+    {
+        uint32_t rt0_id, rt0_w, rt0_h;
+        uint32_t tex0_id, tex0_w, tex0_h, tex0_2d;
+        zm_cr_viewport vp;
+    };
+    // followed by the bytecode when the record is long enough to hold it
+    struct zm_cr_shader { uint32_t id, type, bytes; };
+
+} // namespace ZeroMod
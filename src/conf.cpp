@@ -1,21 +1,52 @@
 #include "conf.h"
 #include "globals.h"
+#include "rcu.h"
 
 class Config::Impl {
-    cs_wrapper cs; // Assuming cs_wrapper is a critical section wrapper for thread safety
+    cs_wrapper cs; // Serializes writers; readers never take it
+    ZeroMod::zm_rcu rcu;
+    ConfigValues* editing = nullptr;
     friend class Config;
+
+    static void free_values(void* p) {
+        delete (ConfigValues*)p;
+    }
 };
 
-void Config::begin_config() {
+ConfigValues* Config::begin_config() {
     impl->cs.begin_cs();
+    impl->editing = new ConfigValues(*(const ConfigValues*)ZeroMod::rcu_current(impl->rcu));
+    return impl->editing;
 }
 
 void Config::end_config() {
+    ConfigValues* v = impl->editing;
+    impl->editing = nullptr;
+    ++v->version;
+    ZeroMod::rcu_publish(impl->rcu, v);
     impl->cs.end_cs();
 }
 
-Config::Config() : impl(new Impl()) {}
+int Config::attach_reader() {
+    int reader = ZeroMod::rcu_attach(impl->rcu);
+    if (reader < 0) OutputDebugStringA("[ZeroMod] Config: no reader slot left\n");
+    return reader;
+}
+
+void Config::detach_reader(int reader) {
+    ZeroMod::rcu_detach(impl->rcu, reader);
+}
+
+const ConfigValues* Config::snapshot(int reader) {
+    if (reader < 0) return nullptr;
+    return (const ConfigValues*)ZeroMod::rcu_refresh(impl->rcu, reader);
+}
+
+Config::Config() : impl(new Impl()) {
+    ZeroMod::rcu_init(impl->rcu, new ConfigValues(), Impl::free_values);
+}
 
 Config::~Config() {
+    ZeroMod::rcu_free(impl->rcu);
     delete impl;
 }
@@ -7,35 +7,34 @@
 #include <string>
 #include "globals.h"
 
-class Config {
-    class Impl;
-    Impl* impl;
+// Everything read from the ini. Published as immutable snapshots: the ini
+// thread edits a copy between begin_config/end_config, end_config makes it
+// current with the next version, and readers pick it up once per frame
+// with Config::snapshot. A reader tells a new snapshot by its version, and
+// what changed by comparing against what it applied last.
+struct ConfigValues {
+    UINT64 version = 0;
 
-public:
-    std::atomic<HWND> hwnd = nullptr;
-    std::atomic_bool logging_enabled = false;
+    bool logging_enabled = false;
     std::vector<BYTE> log_toggle_hotkey;
     std::vector<BYTE> log_frame_hotkey;
-    std::atomic_bool interp = false;
-    std::atomic_bool linear = false;
-    std::atomic_bool linear_test_updated = false;
+    bool interp = false;
+    bool linear = false;
     UINT linear_test_width = 0;
     UINT linear_test_height = 0;
-    std::atomic_bool enhanced = false;
+    bool enhanced = false;
     std::string slang_shader_2d;
-    std::atomic_bool slang_shader_2d_updated = false;
     std::string slang_shader_gba;
-    std::atomic_bool slang_shader_gba_updated = false;
     std::string slang_shader_ds;
-    std::atomic_bool slang_shader_ds_updated = false;
-    UINT display_width = 0;
-    UINT display_height = 0;
-    std::atomic_bool render_display_updated = false;
 
-    // --- Toggle states ---
-    std::atomic_bool shader_toggle = true;
-    std::atomic_bool flash_kill = false;
-    std::atomic_bool transparent_cutscenes = true;
+    // --- Call-stream capture ---
+    bool capture_enabled = false;
+    bool capture_contents = false;
+
+    // --- CPU stage profiler ---
+    bool profiler_enabled = false;
+    bool profiler_csv = false;
+    bool profiler_gpu = false;
 
     // --- Toggle hotkeys ---
     std::vector<BYTE> hotkey_shader_toggle;
@@ -46,6 +45,31 @@ public:
     std::vector<BYTE> hotkey_flash_kill_pad;
     std::vector<BYTE> hotkey_transparent_cutscenes_pad;
 
+    // --- Input thread; 0 = ZM_INPUT_POLL_HZ ---
+    UINT input_poll_hz = 0;
+
+    // --- CPU scaler; factor 0 = ZM_CPU_SCALER_FACTOR, threads 0 = one per core ---
+    bool cpu_scaler_enabled = false;
+    UINT cpu_scaler_factor = 0;
+    UINT cpu_scaler_threads = 0;
+};
+
+class Config {
+    class Impl;
+    Impl* impl;
+
+public:
+    std::atomic<HWND> hwnd = nullptr;
+    UINT display_width = 0;
+    UINT display_height = 0;
+    std::atomic_bool render_display_updated = false;
+
+    // --- Toggle states ---
+    // Flipped by hotkeys on the render thread; the ini's [defaults] sets them
+    std::atomic_bool shader_toggle = true;
+    std::atomic_bool flash_kill = false;
+    std::atomic_bool transparent_cutscenes = true;
+
     // XInput button mappings (custom codes above VK range)
 #define XINPUT_VK_BASE       0xE0
 #define XINPUT_VK_LT   (XINPUT_VK_BASE + 0)  // Left Trigger
@@ -65,8 +89,18 @@ public:
 #define XINPUT_VK_DPAD_LEFT  (XINPUT_VK_BASE + 14)  // 0xEE
 #define XINPUT_VK_DPAD_RIGHT (XINPUT_VK_BASE + 15)  // 0xEF
 
-    void begin_config();
+    // Writer (ini thread): a copy of the current values to edit, published
+    // by end_config
+    ConfigValues* begin_config();
     void end_config();
+
+    // Readers: a slot per reader (-1 when none is left), then snapshot()
+    // once per frame. The snapshot stays valid until the reader's next
+    // snapshot() or detach_reader(); null for slot -1.
+    int attach_reader();
+    void detach_reader(int reader);
+    const ConfigValues* snapshot(int reader);
+
     Config();
     ~Config();
 };
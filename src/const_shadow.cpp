@@ -0,0 +1,90 @@
+#include "const_shadow.h"
+
+#include <string.h>
+
+namespace ZeroMod {
+
+    void csh_invalidate(zm_const_shadow& s)
+    {
+        memset(s.known, 0, sizeof(s.known));
+    }
+
+    void csh_forget(zm_const_shadow& s, unsigned first, unsigned count)
+    {
+        for (unsigned r = first; r < first + count && r < ZM_SLANG_MAX_VS_CONSTS; ++r)
+            s.known[r >> 5] &= ~(1u << (r & 31));
+    }
+
+    void csh_begin(const zm_const_shadow& s, float (*img)[4], unsigned lo, unsigned hi)
+    {
+        if (hi > lo)
+            memcpy(img[lo], s.regs[lo], (hi - lo) * sizeof(img[0]));
+    }
+
+    void csh_pack(float (*img)[4], const slang_const_op& op, const void* src)
+    {
+        if (op.layout == ZM_CL_MAT_ROWS || op.layout == ZM_CL_MAT_COLS)
+        {
+            const float* m = (const float*)src;   // D3DXMATRIX, row-major
+            for (unsigned r = 0; r < op.regs; ++r)
+                for (unsigned c = 0; c < 4; ++c)
+                    img[op.reg + r][c] = (op.layout == ZM_CL_MAT_COLS) ? m[r * 4 + c] : m[c * 4 + r];
+            return;
+        }
+
+        for (unsigned r = 0; r < op.regs; ++r)
+            img[op.reg + r][0] = img[op.reg + r][1] = img[op.reg + r][2] = img[op.reg + r][3] = 0.0f;
+
+        if (op.layout == ZM_CL_INT)
+        {
+            const int32_t* s = (const int32_t*)src;
+            for (unsigned k = 0; k < op.dwords; ++k)
+                img[op.reg + k / op.cols][k % op.cols] = (float)s[k];
+        }
+        else
+        {
+            const float* s = (const float*)src;
+            for (unsigned k = 0; k < op.dwords; ++k)
+                img[op.reg + k / op.cols][k % op.cols] = s[k];
+        }
+    }
+
+    bool csh_dirty_span(
+        const zm_const_shadow& s,
+        const float (*img)[4],
+        const slang_const_op* ops,
+        unsigned num,
+        unsigned& first,
+        unsigned& count)
+    {
+        unsigned lo = ~0u, hi = 0;
+        for (unsigned i = 0; i < num; ++i)
+        {
+            const slang_const_op& op = ops[i];
+            for (unsigned r = op.reg; r < (unsigned)op.reg + op.regs; ++r)
+            {
+                const bool k = (s.known[r >> 5] >> (r & 31)) & 1u;
+                if (k && memcmp(img[r], s.regs[r], sizeof(img[0])) == 0)
+                    continue;
+                if (r < lo) lo = r;
+                if (r > hi) hi = r;
+            }
+        }
+
+        if (lo == ~0u) {
+            first = count = 0;
+            return false;
+        }
+        first = lo;
+        count = hi - lo + 1;
+        return true;
+    }
+
+    void csh_commit(zm_const_shadow& s, const float (*img)[4], unsigned first, unsigned count)
+    {
+        memcpy(s.regs[first], img[first], count * sizeof(img[0]));
+        for (unsigned r = first; r < first + count; ++r)
+            s.known[r >> 5] |= 1u << (r & 31);
+    }
+
+} // namespace ZeroMod
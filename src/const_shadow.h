@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include "slang_bind_table.h"
+
+// ---- Constant register shadow ----
+// What the slang runtime last wrote to one stage's float4 constant
+// registers. A pass packs its uniforms through its binding table into a
+// scratch image that starts as a copy of the shadow, and only the span
+// from the first to the last register that changed (or that nothing is
+// known about) goes up, as one Set*ShaderConstantF. Nothing here calls
+// the device, so tools/zm_const_shadow_test.cpp can check the uploads
+// against a fake one on Linux.
+
+namespace ZeroMod {
+
+    // Sized for the vertex stage, the larger of the two
+    struct zm_const_shadow
+    {
+        float regs[ZM_SLANG_MAX_VS_CONSTS][4];
+        uint32_t known[ZM_SLANG_MAX_VS_CONSTS / 32];
+    };
+
+    // Nothing about the device registers is known any more
+    void csh_invalidate(zm_const_shadow& s);
+
+    // Registers [first, first + count) were written behind the shadow's back
+    void csh_forget(zm_const_shadow& s, unsigned first, unsigned count);
+
+    // Copies the shadow's [lo, hi) into 'img', so registers between the ones
+    // that change go up with the values already on the device
+    void csh_begin(const zm_const_shadow& s, float (*img)[4], unsigned lo, unsigned hi);
+
+    // Packs one uniform into its registers, the way ID3DXConstantTable would
+    void csh_pack(float (*img)[4], const slang_const_op& op, const void* src);
+
+    // Smallest span holding every register of 'ops' that differs from the
+    // shadow or isn't known; false when there is none
+    bool csh_dirty_span(
+        const zm_const_shadow& s,
+        const float (*img)[4],
+        const slang_const_op* ops,
+        unsigned num,
+        unsigned& first,
+        unsigned& count);
+
+    // The span was uploaded from 'img'
+    void csh_commit(zm_const_shadow& s, const float (*img)[4], unsigned first, unsigned count);
+
+} // namespace ZeroMod
@@ -0,0 +1,273 @@
+#include "cpu_scaler.h"
+
+#include <windows.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace ZeroMod {
+
+    struct zm_cps_worker
+    {
+        zm_cpu_scaler* s = nullptr;
+        HANDLE wake = NULL;         // auto-reset, one per batch
+        HANDLE thread = NULL;
+    };
+
+    struct zm_cpu_scaler
+    {
+        zm_xbrz x = {};
+        bool sized = false;             // x is set up for w/h/factor below
+        UINT w = 0, h = 0, factor = 0;
+
+        // Output of the last job, X8R8G8B8, (w * factor) x (h * factor)
+        std::vector<uint32_t> out;
+        const void* key = nullptr;
+        bool busy = false;              // a batch is out to the workers
+        bool fresh = false;             // 'out' is newer than the current texture
+
+        zm_cps_worker workers[ZM_CPU_SCALER_MAX_THREADS];
+        unsigned worker_count = 0;
+        HANDLE done = NULL;             // auto-reset; set by the last worker out
+        volatile LONG next_band = 0;
+        volatile LONG bands = 0;
+        volatile LONG running = 0;
+        volatile LONG stop = 0;
+
+        IDirect3DTexture9* ring[ZM_CPU_SCALER_RING] = {};
+        UINT ring_w = 0, ring_h = 0;
+        int ring_cur = -1;              // texture holding the newest frame
+    };
+
+    static void zm_cps_dbgf(const char* fmt, ...)
+    {
+        char b[512];
+        va_list va;
+        va_start(va, fmt);
+        _vsnprintf(b, sizeof(b), fmt, va);
+        va_end(va);
+        b[sizeof(b) - 1] = '\0';
+        OutputDebugStringA(b);
+    }
+
+    // Claims bands until there are none left; any thread may join in
+    static void cps_run_bands(zm_cpu_scaler* s)
+    {
+        const size_t pitch = (size_t)s->w * s->factor * 4;
+        for (;;)
+        {
+            const LONG b = InterlockedIncrement(&s->next_band) - 1;
+            if (b >= s->bands)
+                break;
+            const uint32_t y0 = (uint32_t)b * ZM_CPU_SCALER_BAND;
+            const uint32_t y1 = y0 + ZM_CPU_SCALER_BAND < s->h ? y0 + ZM_CPU_SCALER_BAND : s->h;
+            xb_run(s->x, y0, y1, s->out.data(), pitch);
+        }
+    }
+
+    static DWORD WINAPI cps_worker_proc(LPVOID param)
+    {
+        zm_cps_worker* w = (zm_cps_worker*)param;
+        zm_cpu_scaler* s = w->s;
+
+        for (;;)
+        {
+            WaitForSingleObject(w->wake, INFINITE);
+            if (InterlockedCompareExchange(&s->stop, 0, 0))
+                break;
+            cps_run_bands(s);
+            // Every worker is woken for every batch, so the count only
+            // reaches 0 once all of them are out of this one
+            if (InterlockedDecrement(&s->running) == 0)
+                SetEvent(s->done);
+        }
+        return 0;
+    }
+
+    // Render thread: help with the rest, then wait for the workers
+    static void cps_finish(zm_cpu_scaler* s)
+    {
+        if (!s->busy)
+            return;
+        cps_run_bands(s);
+        if (s->worker_count)
+            WaitForSingleObject(s->done, INFINITE);
+        s->busy = false;
+        s->fresh = true;
+    }
+
+    zm_cpu_scaler* cps_create(unsigned threads)
+    {
+        if (threads == 0) {
+            SYSTEM_INFO si = {};
+            GetSystemInfo(&si);
+            threads = si.dwNumberOfProcessors > 1 ? (unsigned)si.dwNumberOfProcessors - 1 : 0;
+        }
+        if (threads > ZM_CPU_SCALER_MAX_THREADS) threads = ZM_CPU_SCALER_MAX_THREADS;
+
+        zm_cpu_scaler* s = new zm_cpu_scaler();
+        s->done = CreateEvent(NULL, FALSE, FALSE, NULL);
+        if (!s->done) {
+            delete s;
+            return nullptr;
+        }
+
+        for (unsigned i = 0; i < threads; ++i)
+        {
+            zm_cps_worker& w = s->workers[s->worker_count];
+            w.s = s;
+            w.wake = CreateEvent(NULL, FALSE, FALSE, NULL);
+            if (!w.wake)
+                break;
+            w.thread = CreateThread(NULL, 0, cps_worker_proc, &w, 0, NULL);
+            if (!w.thread) {
+                CloseHandle(w.wake);
+                w.wake = NULL;
+                break;
+            }
+            ++s->worker_count;
+        }
+
+        zm_cps_dbgf("[ZeroMod] cpu_scaler: %u worker(s), %s\n", s->worker_count, xb_isa_name(xb_cpu_isa()));
+        return s;
+    }
+
+    void cps_free(zm_cpu_scaler* s)
+    {
+        if (!s)
+            return;
+        cps_finish(s);
+
+        InterlockedExchange(&s->stop, 1);
+        HANDLE threads[ZM_CPU_SCALER_MAX_THREADS];
+        for (unsigned i = 0; i < s->worker_count; ++i) {
+            SetEvent(s->workers[i].wake);
+            threads[i] = s->workers[i].thread;
+        }
+        if (s->worker_count)
+            WaitForMultipleObjects(s->worker_count, threads, TRUE, INFINITE);
+        for (unsigned i = 0; i < s->worker_count; ++i) {
+            CloseHandle(s->workers[i].thread);
+            CloseHandle(s->workers[i].wake);
+        }
+        CloseHandle(s->done);
+
+        cps_release_textures(s);
+        delete s;
+    }
+
+    bool cps_submit(zm_cpu_scaler* s, const void* key, const void* bits, size_t pitch,
+        UINT w, UINT h, D3DFORMAT format, UINT factor)
+    {
+        if (!s || !bits)
+            return false;
+
+        int fmt;
+        switch (format) {
+        case D3DFMT_A8R8G8B8:
+        case D3DFMT_X8R8G8B8: fmt = ZM_XBRZ_XRGB8888; break;
+        case D3DFMT_R5G6B5:   fmt = ZM_XBRZ_RGB565; break;
+        case D3DFMT_A1R5G5B5:
+        case D3DFMT_X1R5G5B5: fmt = ZM_XBRZ_XRGB1555; break;
+        default: return false;
+        }
+
+        // The planes and the output belong to the running job until it ends
+        cps_finish(s);
+
+        if (!s->sized || w != s->w || h != s->h || factor != s->factor) {
+            if (!xb_init(s->x, w, h, factor))
+                return false;
+            s->sized = true;
+            s->w = w;
+            s->h = h;
+            s->factor = factor;
+            s->out.assign((size_t)w * factor * h * factor, 0);
+        }
+        xb_load(s->x, bits, pitch, fmt);
+        s->key = key;
+
+        s->next_band = 0;
+        s->bands = (LONG)((h + ZM_CPU_SCALER_BAND - 1) / ZM_CPU_SCALER_BAND);
+        s->running = (LONG)s->worker_count;
+        s->busy = true;
+        for (unsigned i = 0; i < s->worker_count; ++i)
+            SetEvent(s->workers[i].wake);
+        return true;
+    }
+
+    const void* cps_key(const zm_cpu_scaler* s)
+    {
+        return s ? s->key : nullptr;
+    }
+
+    void cps_forget(zm_cpu_scaler* s, const void* key)
+    {
+        if (s && key && s->key == key)
+            s->key = nullptr;
+    }
+
+    IDirect3DTexture9* cps_fetch(zm_cpu_scaler* s, IDirect3DDevice9* dev, UINT* w, UINT* h)
+    {
+        if (!s || !dev)
+            return nullptr;
+        cps_finish(s);
+
+        const UINT ow = s->w * s->factor;
+        const UINT oh = s->h * s->factor;
+
+        if (s->fresh)
+        {
+            if (ow != s->ring_w || oh != s->ring_h)
+                cps_release_textures(s);
+
+            const int slot = (s->ring_cur + 1) % ZM_CPU_SCALER_RING;
+            IDirect3DTexture9*& t = s->ring[slot];
+            if (!t) {
+                const HRESULT hr = dev->CreateTexture(ow, oh, 1, D3DUSAGE_DYNAMIC, D3DFMT_A8R8G8B8,
+                    D3DPOOL_DEFAULT, &t, NULL);
+                if (FAILED(hr) || !t) {
+                    zm_cps_dbgf("[ZeroMod] cpu_scaler: CreateTexture %ux%u FAILED hr=0x%08lX\n",
+                        ow, oh, (unsigned long)hr);
+                    t = nullptr;
+                    return nullptr;
+                }
+                s->ring_w = ow;
+                s->ring_h = oh;
+            }
+
+            D3DLOCKED_RECT lr;
+            if (FAILED(t->LockRect(0, &lr, NULL, D3DLOCK_DISCARD)))
+                return nullptr;
+            const size_t row = (size_t)ow * 4;
+            for (UINT y = 0; y < oh; ++y)
+                memcpy((BYTE*)lr.pBits + (size_t)y * lr.Pitch, &s->out[(size_t)y * ow], row);
+            t->UnlockRect(0);
+
+            s->ring_cur = slot;
+            s->fresh = false;
+        }
+
+        if (s->ring_cur < 0)
+            return nullptr;
+        if (w) *w = ow;
+        if (h) *h = oh;
+        return s->ring[s->ring_cur];
+    }
+
+    void cps_release_textures(zm_cpu_scaler* s)
+    {
+        if (!s)
+            return;
+        for (IDirect3DTexture9*& t : s->ring) {
+            if (t) { t->Release(); t = nullptr; }
+        }
+        s->ring_w = s->ring_h = 0;
+        // Upload the last frame again into the new textures
+        if (s->ring_cur >= 0)
+            s->fresh = s->sized;
+        s->ring_cur = -1;
+    }
+
+} // namespace ZeroMod
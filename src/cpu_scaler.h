@@ -0,0 +1,54 @@
+#pragma once
+#include <d3d9.h>
+#include <stddef.h>
+#include "xbrz_cpu.h"
+
+// ---- CPU scaler backend ----
+// Runs xBRZ freescale (xbrz_cpu.h) on the game's 240x160 / 256x192 frame
+// on the CPU instead of the slang chain on the GPU, for iGPUs that can't
+// keep up with the chain. The frame is captured where the CPU still has
+// it -- the system-memory side of UpdateTexture/UpdateSurface, or the
+// latched source when it is lockable -- and cps_submit hands it to a
+// worker pool, which scales it in bands of ZM_CPU_SCALER_BAND source rows
+// while the game goes on drawing the UI. cps_fetch at the game-rect draw
+// finishes the job (helping with what's left) and uploads the result into
+// the next of ZM_CPU_SCALER_RING dynamic textures, so the driver never has
+// to wait for a texture the GPU is still reading.
+// Textures in flight
+#define ZM_CPU_SCALER_RING 3
+// Worker threads, besides the render thread
+#define ZM_CPU_SCALER_MAX_THREADS 8
+// Source rows per work item
+#define ZM_CPU_SCALER_BAND 8
+// Factor when [cpu_scaler] factor is 0
+#define ZM_CPU_SCALER_FACTOR 4
+
+namespace ZeroMod {
+
+    struct zm_cpu_scaler;
+
+    // threads: workers; 0 = one per core but the render thread's
+    zm_cpu_scaler* cps_create(unsigned threads);
+    void cps_free(zm_cpu_scaler* s);
+
+    // Starts scaling a w x h frame in 'format' (32-bit, 565 or 1555), rows
+    // 'pitch' bytes apart, by 'factor' (ZM_XBRZ_FACTOR_MIN..MAX). The
+    // pixels are copied before this returns. 'key' names the texture the
+    // frame belongs to. False for a format or size the kernel doesn't take.
+    bool cps_submit(zm_cpu_scaler* s, const void* key, const void* bits, size_t pitch,
+        UINT w, UINT h, D3DFORMAT format, UINT factor);
+
+    // Texture the last submitted frame came from, null when none
+    const void* cps_key(const zm_cpu_scaler* s);
+
+    // 'key' is gone (or a new texture reuses its address)
+    void cps_forget(zm_cpu_scaler* s, const void* key);
+
+    // The scaled frame as a texture, w x h. Waits for the running job.
+    // Null when nothing was submitted or the upload failed.
+    IDirect3DTexture9* cps_fetch(zm_cpu_scaler* s, IDirect3DDevice9* dev, UINT* w, UINT* h);
+
+    // Before a device Reset; the next fetch uploads again
+    void cps_release_textures(zm_cpu_scaler* s);
+
+} // namespace ZeroMod
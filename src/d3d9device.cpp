@@ -24,6 +24,16 @@
 #include "d3d9video.h"
 #include "globals.h"
 #include "slang_d3d9.h"
+#include "state_filter.h"
+#include "d3d9stateblock.h"
+#include "draw_binds.h"
+#include "draw_sig.h"
+#include "call_rec.h"
+#include "stage_prof.h"
+#include "gpu_prof.h"
+#include "input.h"
+#include "cpu_scaler.h"
+#include "FormatConversion.h"
 
 #include <windows.h>
 #define DBG(s) OutputDebugStringA("[ZeroMod] " s "\n")
@@ -37,8 +47,6 @@
 #include <cstdarg>
 #include <cstdio>
 
-#include <Xinput.h>
-
 #define MAX_SAMPLERS 16
 #define MAX_SHADER_RESOURCES 128
 #define MAX_CONSTANT_BUFFERS 15
@@ -64,14 +72,6 @@
 #define E_NOTIMPL ((HRESULT)0x80004001L)
 #endif 
 
-#define ZM_SCREEN_FVF (D3DFVF_XYZRHW | D3DFVF_TEX1)
-
-struct ZM_SCREEN_VERTEX
-{
-    float x, y, z, rhw;
-    float u, v;
-};
-
 static IDirect3DPixelShader9* g_blackkey_ps = nullptr;
 
 // --- MENU -> GAME one-shot 60-frame scan for "512x512 exists" (stage0 only) ---
@@ -89,6 +89,9 @@ static IDirect3DTexture9* g_trace_2x_tex = nullptr; // set by Step 0 capture (ke
 static bool               g_stage0_is_game = false;
 static uint64_t           g_trace_draw_id = 0;
 
+// Compiled DrawPrimitive interception signatures + hit counts
+static ZeroMod::zm_draw_matcher g_draw_matcher = {};
+
 static __forceinline void LogIfUnsupported(const char* name, HRESULT hr)
 {
     if (hr == E_NOTIMPL) {
@@ -222,92 +225,6 @@ namespace {
         render_width = width * width_quo;
         render_height = height * height_quo;
     }
-    struct ToggleHotkeyState {
-        bool was_pressed = false;
-    };
-
-    ToggleHotkeyState hk_shader_toggle;
-    ToggleHotkeyState hk_shader_toggle_pad;
-    ToggleHotkeyState hk_flash_kill;
-    ToggleHotkeyState hk_transparent_cutscenes;
-    ToggleHotkeyState hk_flash_kill_pad;
-    ToggleHotkeyState hk_transparent_cutscenes_pad;   
-
-    XINPUT_STATE xinput_state{};
-    bool xinput_connected = false;
-
-    void RefreshXInputState() {
-        XINPUT_STATE state{};
-        xinput_connected = (XInputGetState(0, &state) == ERROR_SUCCESS);
-        if (xinput_connected)
-            xinput_state = state;
-    }
-
-    bool IsXInputButtonDown(BYTE vk) {
-        if (!xinput_connected) return false;
-        auto& gp = xinput_state.Gamepad;
-        switch (vk) {
-        case XINPUT_VK_LT:         return gp.bLeftTrigger > XINPUT_GAMEPAD_TRIGGER_THRESHOLD;
-        case XINPUT_VK_RT:         return gp.bRightTrigger > XINPUT_GAMEPAD_TRIGGER_THRESHOLD;
-        case XINPUT_VK_RS:         return (gp.wButtons & XINPUT_GAMEPAD_RIGHT_THUMB) != 0;
-        case XINPUT_VK_LS:         return (gp.wButtons & XINPUT_GAMEPAD_LEFT_THUMB) != 0;
-        case XINPUT_VK_A:          return (gp.wButtons & XINPUT_GAMEPAD_A) != 0;
-        case XINPUT_VK_B:          return (gp.wButtons & XINPUT_GAMEPAD_B) != 0;
-        case XINPUT_VK_X:          return (gp.wButtons & XINPUT_GAMEPAD_X) != 0;
-        case XINPUT_VK_Y:          return (gp.wButtons & XINPUT_GAMEPAD_Y) != 0;
-        case XINPUT_VK_LB:         return (gp.wButtons & XINPUT_GAMEPAD_LEFT_SHOULDER) != 0;
-        case XINPUT_VK_RB:         return (gp.wButtons & XINPUT_GAMEPAD_RIGHT_SHOULDER) != 0;
-        case XINPUT_VK_START:      return (gp.wButtons & XINPUT_GAMEPAD_START) != 0;
-        case XINPUT_VK_BACK:       return (gp.wButtons & XINPUT_GAMEPAD_BACK) != 0;
-        case XINPUT_VK_DPAD_UP:    return (gp.wButtons & XINPUT_GAMEPAD_DPAD_UP) != 0;
-        case XINPUT_VK_DPAD_DOWN:  return (gp.wButtons & XINPUT_GAMEPAD_DPAD_DOWN) != 0;
-        case XINPUT_VK_DPAD_LEFT:  return (gp.wButtons & XINPUT_GAMEPAD_DPAD_LEFT) != 0;
-        case XINPUT_VK_DPAD_RIGHT: return (gp.wButtons & XINPUT_GAMEPAD_DPAD_RIGHT) != 0;
-        default: return false;
-        }
-    }
-
-    bool IsHotkeyComboDown(const std::vector<BYTE>& combo) {
-        if (combo.empty()) return false;
-        for (BYTE vk : combo) {
-            if (vk >= XINPUT_VK_BASE) {
-                if (!IsXInputButtonDown(vk))
-                    return false;
-            }
-            else {
-                if (!(GetAsyncKeyState(vk) & 0x8000))
-                    return false;
-            }
-        }
-        return true;
-    }
-
-    // Returns true if the toggle changed (checks both keyboard and pad combos)
-    bool PollToggleHotkey(const std::vector<BYTE>& combo_kb,
-        const std::vector<BYTE>& combo_pad,
-        ToggleHotkeyState& state_kb,
-        ToggleHotkeyState& state_pad,
-        std::atomic_bool& value) {
-        bool changed = false;
-
-        bool pressed_kb = IsHotkeyComboDown(combo_kb);
-        if (pressed_kb && !state_kb.was_pressed) {
-            value = !value.load();
-            state_kb.was_pressed = true;
-            changed = true;
-        }
-        if (!pressed_kb) state_kb.was_pressed = false;
-
-        bool pressed_pad = IsHotkeyComboDown(combo_pad);
-        if (pressed_pad && !state_pad.was_pressed) {
-            value = !value.load();
-            state_pad.was_pressed = true;
-            changed = true;
-        }
-        if (!pressed_pad) state_pad.was_pressed = false;
-
-        return changed;
-    }
 }
 
 // From wikipedia
@@ -329,6 +246,10 @@ public:
     UINT width;
     UINT height;
     Config* config = nullptr;
+    // This frame's ini values, from refresh_config; valid until the next one
+    int config_reader = -1;
+    const ConfigValues* frame_config = nullptr;
+    UINT64 applied_config_version = ~0ull;
     Overlay* overlay = nullptr;
 
     ZeroMod_d3d9_video_t* d3d9_2d = nullptr;
@@ -348,7 +269,6 @@ public:
 
     float cached_vs_constants[256 * 4]; // Assuming a maximum of 256 vector4 registers
     DWORD cached_fvf; // Cached FVF
-    std::unordered_map<D3DRENDERSTATETYPE, DWORD> cached_rs; // Cached render states
     IDirect3DStateBlock9* cached_dss; // Cached depth stencil state
 
     IDirect3DIndexBuffer9* cached_ib; 
@@ -361,10 +281,41 @@ public:
     IDirect3DPixelShader9* overlay_blend_ps = nullptr;
     bool overlay_blend_ps_tried = false;
 
+    // Static quad + blit VS for the overlay composite
+    ZeroMod::zm_quad blit_quad = {};
+    bool blit_quad_tried = false;
+
+    // States touched by the injected chain + overlay, restored after them
+    ZeroMod::zm_state_delta state_delta = {};
+
+    // Shadow of the game's render/sampler/stage states; drops redundant Set* calls
+    ZeroMod::zm_state_filter state_filter = {};
+
+    // RT0 / stage 0 / viewport as last set through the proxy, and the
+    // texture sizes recorded at creation, for DrawPrimitive's classification
+    ZeroMod::zm_draw_binds draw_binds = {};
+    ZeroMod::zm_res_table res_table = {};
+
+    // Open while [capture] enabled=true
+    ZeroMod::zm_call_rec* call_rec = nullptr;
+
+    // Last profiler tables handed to the overlay
+    std::string prof_cpu_text;
+    std::string prof_gpu_text;
+
     // --- Black key shader for opaque cutscenes mode ---
     IDirect3DPixelShader9* black_key_ps = nullptr;
     bool black_key_ps_tried = false;
 
+    // --- [cpu_scaler]: xBRZ on the CPU in place of the slang chain ---
+    ZeroMod::zm_cpu_scaler* cpu_scaler = nullptr;
+    UINT cpu_scaler_threads = 0;
+    UINT cpu_scaler_factor = ZM_CPU_SCALER_FACTOR;
+    // Frame an UpdateTexture/UpdateSurface last fed it
+    UINT64 cpu_scaler_fed_frame = ~0ull;
+    IDirect3DPixelShader9* copy_ps = nullptr;
+    bool copy_ps_tried = false;
+
     void PollToggles();
 
     // D3D9 "SRVs" == textures bound via SetTexture(stage,...)
@@ -428,6 +379,59 @@ public:
     };
     PendingSlangJob pending_slang;
 
+    void track_viewport(HRESULT hr, const D3DVIEWPORT9& vp)
+    {
+        if (SUCCEEDED(hr) && !state_filter.recording) {
+            ZeroMod::db_set_viewport(draw_binds, vp);
+            if (call_rec)
+                ZeroMod::cr_set_vp(call_rec, vp);
+        }
+        else {
+            ZeroMod::db_invalidate(draw_binds, ZeroMod::ZM_DB_VP);
+        }
+    }
+
+    // db_sync; whatever had to be read back from the device is captured so
+    // a replay's mirror of the bindings stays in step
+    void sync_binds()
+    {
+        const bool resync = !ZM_DRAW_BINDS || draw_binds.known != ZeroMod::ZM_DB_ALL;
+        ZeroMod::db_sync(draw_binds, res_table, inner);
+        if (call_rec && resync) {
+            const ZeroMod::zm_draw_binds& db = draw_binds;
+            ZeroMod::cr_binds(call_rec, db.rt0, db.rt0_w, db.rt0_h,
+                db.tex0, db.tex0_w, db.tex0_h, db.tex0_2d != nullptr, db.vp);
+        }
+    }
+
+    // Once per Present: frame marker, and open/close the capture file when
+    // the ini toggles it
+    void capture_frame()
+    {
+        const bool want = ZM_CALL_REC && frame_config && frame_config->capture_enabled;
+        if (call_rec) {
+            ZeroMod::cr_frame(call_rec, frame_count, backbuffer_width, backbuffer_height);
+            if (want) {
+                ZeroMod::cr_flush(call_rec);
+            }
+            else {
+                ZeroMod::cr_close(call_rec);
+                call_rec = nullptr;
+            }
+        }
+        else if (want) {
+            char path[64];
+            _snprintf(path, sizeof(path), "zeromod_%llu.zmcr", (unsigned long long)frame_count);
+            path[sizeof(path) - 1] = '\0';
+            call_rec = ZeroMod::cr_open(path, frame_config->capture_contents);
+            if (call_rec) {
+                // The replay starts knowing nothing: resend the bindings at the next draw
+                ZeroMod::db_invalidate(draw_binds, ZeroMod::ZM_DB_ALL);
+                ZeroMod::cr_frame(call_rec, frame_count, backbuffer_width, backbuffer_height);
+            }
+        }
+    }
+
     bool get_viewport_from_current_rt(D3DVIEWPORT9& out)
     {
         IDirect3DSurface9* rt = nullptr;
@@ -473,6 +477,8 @@ public:
         if (filter_state.vertex_buffer) { filter_state.vertex_buffer->Release(); filter_state.vertex_buffer = nullptr; }
         if (overlay_blend_ps) { overlay_blend_ps->Release(); overlay_blend_ps = nullptr; }
         overlay_blend_ps_tried = false;
+        ZeroMod::quad_release(blit_quad);
+        blit_quad_tried = false;
 
         filter_state.t1 = false;
         filter_state.zx = false;
@@ -487,13 +493,36 @@ public:
     bool render_enhanced = false;
     UINT linear_test_width = 0;
     UINT linear_test_height = 0;
+    std::string render_slang_shader_2d;
+    std::string render_slang_shader_gba;
+    std::string render_slang_shader_ds;
+
+    void set_config(Config* config) {
+        if (this->config) this->config->detach_reader(config_reader);
+        this->config = config;
+        config_reader = config ? config->attach_reader() : -1;
+        frame_config = nullptr;
+        applied_config_version = ~0ull;
+    }
+
+    // Once per frame: picks up the latest published snapshot, a single
+    // load when the ini hasn't changed
+    void refresh_config() {
+        frame_config = config ? config->snapshot(config_reader) : nullptr;
+    }
 
     void update_config() {
+        ZM_PROF_SCOPE(ZeroMod::ZM_PS_UPDATE_CONFIG);
 
-        if (!config) {
+        const ConfigValues* c = frame_config;
+        if (!c) {
             DBG("update_config: config null, skip");
             return;
         }
+        // Nothing published since the last apply
+        if (c->version == applied_config_version) return;
+        applied_config_version = c->version;
+
         auto notify = [&](const char* msg) {
             if (overlay) overlay->push_text(msg);
             OutputDebugStringA((std::string("[ZeroMod] notify: ") + msg).c_str());
@@ -504,19 +533,16 @@ public:
             };
 
 #define GET_SET_CONFIG_BOOL(v, m) do { \
-    bool v##_value = config->v; \
+    bool v##_value = c->v; \
     if (render_##v != v##_value) { \
         render_##v = v##_value; \
         notify(v##_value ? (m " enabled") : (m " disabled")); \
     } \
 } while (0)
 
-        if (config->linear_test_updated) {
-            config->begin_config();
-            linear_test_width = config->linear_test_width;
-            linear_test_height = config->linear_test_height;
-            config->linear_test_updated = false;
-            config->end_config();
+        if (c->linear_test_width != linear_test_width || c->linear_test_height != linear_test_height) {
+            linear_test_width = c->linear_test_width;
+            linear_test_height = c->linear_test_height;
             DBG("update_config: linear_test_updated applied");
         }
 
@@ -529,22 +555,17 @@ public:
     X(gba) \
     X(ds)
 
-#define X(v) config->slang_shader_##v##_updated ||
+#define X(v) c->slang_shader_##v != render_slang_shader_##v ||
 
         if (SLANG_SHADERS false) {
 
 #undef X
 #define X(v) \
-    bool slang_shader_##v##_updated = config->slang_shader_##v##_updated; \
-    std::string slang_shader_##v; \
-    if (slang_shader_##v##_updated) { \
-        slang_shader_##v = config->slang_shader_##v; \
-        config->slang_shader_##v##_updated = false; \
-    }
+    bool slang_shader_##v##_updated = c->slang_shader_##v != render_slang_shader_##v; \
+    const std::string& slang_shader_##v = c->slang_shader_##v; \
+    render_slang_shader_##v = slang_shader_##v;
 
-            config->begin_config();
             SLANG_SHADERS
-                config->end_config();
             {
                 auto dump = [&](const char* tag, bool upd, const std::string& s) {
                     char b[768];
@@ -608,9 +629,83 @@ public:
 #undef SLANG_SHADERS
         }
 
+        // The pool is sized when it starts, so a new thread count restarts it
+        if (c->cpu_scaler_enabled != (cpu_scaler != nullptr)
+            || (cpu_scaler && c->cpu_scaler_threads != cpu_scaler_threads)) {
+            ZeroMod::cps_free(cpu_scaler);
+            cpu_scaler = c->cpu_scaler_enabled ? ZeroMod::cps_create(c->cpu_scaler_threads) : nullptr;
+            cpu_scaler_threads = c->cpu_scaler_threads;
+            cpu_scaler_fed_frame = ~0ull;
+            if (c->cpu_scaler_enabled)
+                notify(cpu_scaler ? "CPU scaler enabled" : "Failed to start the CPU scaler");
+            else
+                notify("CPU scaler disabled");
+        }
+        cpu_scaler_factor = c->cpu_scaler_factor ? c->cpu_scaler_factor : ZM_CPU_SCALER_FACTOR;
+        if (cpu_scaler_factor < ZM_XBRZ_FACTOR_MIN) cpu_scaler_factor = ZM_XBRZ_FACTOR_MIN;
+        if (cpu_scaler_factor > ZM_XBRZ_FACTOR_MAX) cpu_scaler_factor = ZM_XBRZ_FACTOR_MAX;
+
 #undef GET_SET_CONFIG_BOOL
 
     }
+    // [cpu_scaler] capture: 'surf' holds the game's frame for 'key', the
+    // texture the game-rect draw will sample
+    void cps_feed(IDirect3DSurface9* surf, const void* key) {
+        D3DSURFACE_DESC d;
+        if (FAILED(surf->GetDesc(&d)))
+            return;
+        D3DLOCKED_RECT lr;
+        if (FAILED(surf->LockRect(&lr, NULL, D3DLOCK_READONLY)))
+            return;
+        ZeroMod::cps_submit(cpu_scaler, key, lr.pBits, (size_t)lr.Pitch,
+            d.Width, d.Height, d.Format, cpu_scaler_factor);
+        surf->UnlockRect();
+    }
+
+    static bool is_game_frame_size(UINT w, UINT h) {
+        return (w == ZERO_WIDTH && h == ZERO_HEIGHT) || (w == ZX_WIDTH && h == ZX_HEIGHT);
+    }
+
+    // UpdateTexture from system memory into a frame-sized texture
+    void cps_feed_update(IDirect3DBaseTexture9* src, IDirect3DBaseTexture9* dst) {
+        if (!cpu_scaler || !src || !dst
+            || src->GetType() != D3DRTYPE_TEXTURE || dst->GetType() != D3DRTYPE_TEXTURE)
+            return;
+        IDirect3DTexture9* dst_tex = static_cast<IDirect3DTexture9*>(dst);
+        const ZeroMod::zm_res_desc* rd = ZeroMod::res_texture_desc(res_table, dst_tex);
+        if (!rd || !is_game_frame_size(rd->width, rd->height))
+            return;
+
+        IDirect3DSurface9* surf = nullptr;
+        if (FAILED(static_cast<IDirect3DTexture9*>(src)->GetSurfaceLevel(0, &surf)) || !surf)
+            return;
+        D3DSURFACE_DESC d;
+        if (SUCCEEDED(surf->GetDesc(&d)) && d.Pool == D3DPOOL_SYSTEMMEM) {
+            cps_feed(surf, dst_tex);
+            cpu_scaler_fed_frame = frame_count;
+        }
+        surf->Release();
+    }
+
+    // UpdateSurface of a whole system-memory frame into level 0 of a texture
+    void cps_feed_update(IDirect3DSurface9* src, const RECT* src_rect, IDirect3DSurface9* dst, const POINT* dst_point) {
+        if (!cpu_scaler || !src || !dst || src_rect || (dst_point && (dst_point->x || dst_point->y)))
+            return;
+        D3DSURFACE_DESC sdesc, ddesc;
+        if (FAILED(src->GetDesc(&sdesc)) || FAILED(dst->GetDesc(&ddesc)))
+            return;
+        if (sdesc.Pool != D3DPOOL_SYSTEMMEM || !is_game_frame_size(ddesc.Width, ddesc.Height)
+            || sdesc.Width != ddesc.Width || sdesc.Height != ddesc.Height)
+            return;
+
+        IDirect3DTexture9* dst_tex = nullptr;
+        if (FAILED(dst->GetContainer(IID_IDirect3DTexture9, (void**)&dst_tex)) || !dst_tex)
+            return;
+        cps_feed(src, dst_tex);
+        cpu_scaler_fed_frame = frame_count;
+        dst_tex->Release();
+    }
+
     void queue_slang_job(ZeroMod::d3d9_video_struct* d3d9,
         IDirect3DTexture9* src,
         IDirect3DSurface9* dst,
@@ -1100,7 +1195,7 @@ public:
         // NOTE:
 // This block previously crashed due to dynamic_cast on raw IDirect3DBaseTexture9*.
 // D3D9 sampler/texture state here is *not* wrapper-owned.
-// now use QI -> IDirect3DTexture9 + GetLevelDesc for slot 0 only.
+// Sizes come from the proxy's descriptor table (res_texture_desc), slot 0 only.
 // Do NOT reintroduce wrapper casts or store desc pointers here.
 
         linear_restore = false;
@@ -1128,42 +1223,35 @@ public:
             if (i >= MAX_SAMPLERS) {
                 break;
             }
-            IDirect3DTexture9* tex = nullptr;
-            D3DSURFACE_DESC d = {};
-
-            HRESULT hr_qi = (*srvs)->QueryInterface(IID_IDirect3DTexture9, (void**)&tex);
-            if (SUCCEEDED(hr_qi) && tex)
+            // Only care about slot 0 (matches previous texs_descs[0] usage)
+            if (i == 0 &&
+                linear_conditions.alpha_discard == PIXEL_SHADER_ALPHA_DISCARD::EQUAL &&
+                render_linear)
             {
-                if (SUCCEEDED(tex->GetLevelDesc(0, &d)))
+                const ZeroMod::zm_res_desc* d = ZeroMod::res_texture_desc(res_table, *srvs);
+                if (d && d->kind == ZeroMod::ZM_RES_TEX2D)
                 {
-                    // Only care about slot 0 (matches previous texs_descs[0] usage)
-                    if (i == 0 &&
-                        linear_conditions.alpha_discard == PIXEL_SHADER_ALPHA_DISCARD::EQUAL &&
-                        render_linear)
+                    const UINT width = d->width;
+                    const UINT height = d->height;
+
+                    if (!((width == 512 || width == 256) && height == 256) &&
+                        !(width == (UINT)linear_test_width && height == (UINT)linear_test_height))
                     {
-                        const UINT width = d.Width;
-                        const UINT height = d.Height;
-
-                        if (!((width == 512 || width == 256) && height == 256) &&
-                            !(width == (UINT)linear_test_width && height == (UINT)linear_test_height))
-                        {
-                            if (!saved_mag0_valid) {
-                                DWORD v = 0;
-                                if (SUCCEEDED(inner->GetSamplerState(0, D3DSAMP_MAGFILTER, &v))) {
-                                    saved_mag0 = v;
-                                    saved_mag0_valid = true;
-                                }
+                        if (!saved_mag0_valid) {
+                            DWORD v = 0;
+                            if (SUCCEEDED(inner->GetSamplerState(0, D3DSAMP_MAGFILTER, &v))) {
+                                saved_mag0 = v;
+                                saved_mag0_valid = true;
                             }
-                            inner->SetSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_LINEAR);
-                            linear_restore = true;
-
                         }
+                        inner->SetSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_LINEAR);
+                        ZeroMod::sf_invalidate_sampler(state_filter, 0);
+                        linear_restore = true;
+
                     }
                 }
-                tex->Release();
-                tex = nullptr;
             }
-            // IMPORTANT: do not store &d anywhere (it's stack).
+            // IMPORTANT: do not store d anywhere (the table may rehash).
             // If texs_descs later, push nullptr now.
             linear_conditions.texs_descs.push_back(nullptr);
         }
@@ -1173,6 +1261,7 @@ public:
 
         if (linear_restore && saved_mag0_valid) {
             inner->SetSamplerState(0, D3DSAMP_MAGFILTER, saved_mag0);
+            ZeroMod::sf_invalidate_sampler(state_filter, 0);
         }
         linear_restore = false;
         saved_mag0_valid = false;
@@ -1228,6 +1317,7 @@ public:
     bool is_render_vp = false;
 
     void present() {
+        ZM_PROF_SCOPE(ZeroMod::ZM_PS_IMPL_PRESENT);
         clear_filter();
         update_config();
         ++frame_count;
@@ -1270,6 +1360,7 @@ public:
         OutputDebugStringA("[ZeroMod] resize_buffers step 2: clear_filter DONE");
 
         OutputDebugStringA("[ZeroMod] resize_buffers step 3: update_config");
+        refresh_config();
         update_config();
         OutputDebugStringA("[ZeroMod] resize_buffers step 3: update_config DONE");
 
@@ -1309,6 +1400,7 @@ public:
         if (wanted.src_tex) { wanted.src_tex->Release(); wanted.src_tex = nullptr; }
         wanted.active = false;
         wanted.chain = nullptr;
+        if (cpu_scaler) ZeroMod::cps_release_textures(cpu_scaler);
         // ===== RELEASE ALL CACHED STATE REFS =====
 
         // Cached texture stages
@@ -1353,6 +1445,8 @@ public:
         if (inner) {
             inner->SetDepthStencilSurface(nullptr);
             for (UINT i = 0; i < 16; i++) inner->SetTexture(i, nullptr);
+            ZeroMod::sf_invalidate(state_filter);
+            ZeroMod::db_invalidate(draw_binds, ZeroMod::ZM_DB_ALL);
             inner->SetVertexShader(nullptr);
             inner->SetPixelShader(nullptr);
             for (UINT i = 0; i < 16; i++) inner->SetStreamSource(i, nullptr, 0, 0);
@@ -1473,6 +1567,7 @@ public:
             vp.MinZ = 0.0f;
             vp.MaxZ = 1.0f;
             inner->SetViewport(&vp);
+            ZeroMod::db_invalidate(draw_binds, ZeroMod::ZM_DB_VP);
         }
 
         rt->Release();
@@ -1526,6 +1621,7 @@ public:
         }
 
         HRESULT hr = inner->SetViewport(&render_vp);
+        ZeroMod::db_invalidate(draw_binds, ZeroMod::ZM_DB_VP);
         if (FAILED(hr))
         {
             // If SetViewport fails, immediately restore. Don't poison downstream.
@@ -1552,6 +1648,7 @@ public:
         if (cached_vp.Width && cached_vp.Height) {
             render_vp = cached_vp;
             inner->SetViewport(&render_vp);
+            ZeroMod::db_invalidate(draw_binds, ZeroMod::ZM_DB_VP);
         }
         else {
             force_viewport_from_current_rt();
@@ -1661,6 +1758,14 @@ public:
 
         filter_temp_shutdown(inner);
         clear_filter();
+        ZeroMod::res_free(res_table);
+        ZeroMod::cr_close(call_rec);
+        call_rec = nullptr;
+        ZeroMod::cps_free(cpu_scaler);
+        cpu_scaler = nullptr;
+        if (copy_ps) { copy_ps->Release(); copy_ps = nullptr; }
+        set_config(nullptr);
+        ZeroMod::gp_discard(ZeroMod::g_gpu_prof, true);
 
         if (g_blackkey_ps) {
             g_blackkey_ps->Release();
@@ -1802,6 +1907,11 @@ public:
             return false;
         }
 
+        // Stage 0 texture/sampler, RT0 and viewport are written directly below
+        ZeroMod::sf_invalidate_texture(state_filter, 0);
+        ZeroMod::sf_invalidate_sampler(state_filter, 0);
+        ZeroMod::db_invalidate(draw_binds, ZeroMod::ZM_DB_ALL);
+
         filter_next = false;
 
         D3DSURFACE_DESC srv_desc = {};
@@ -2003,10 +2113,24 @@ public:
                 w.src_tex = latch;
                 w.src_tex->AddRef();
 
+                // No upload fed the CPU scaler this frame: read the frame
+                // straight from the texture when the game keeps it lockable
+                if (cpu_scaler && cpu_scaler_fed_frame != frame_count) {
+                    D3DSURFACE_DESC d;
+                    IDirect3DSurface9* surf = nullptr;
+                    if (SUCCEEDED(latch->GetLevelDesc(0, &d))
+                        && (d.Pool == D3DPOOL_MANAGED || d.Pool == D3DPOOL_SYSTEMMEM || (d.Usage & D3DUSAGE_DYNAMIC))
+                        && SUCCEEDED(latch->GetSurfaceLevel(0, &surf)) && surf) {
+                        cps_feed(surf, latch);
+                        surf->Release();
+                    }
+                }
+
                 return true;
             };
 
         auto draw_enhanced = [&](std::vector<TextureViewsAndBuffer*>& v_v) {
+            ZM_GPU_SCOPE("type1 enhanced");
             auto v_it = v_v.begin();
 
             // If there are no intermediate passes, just do a final linear draw.
@@ -2226,7 +2350,7 @@ void MyID3D9Device::set_overlay(Overlay* overlay) {
 }
 
 void MyID3D9Device::set_config(Config* config) {
-    impl->config = config;
+    impl->set_config(config);
 }
 
 void MyID3D9Device::resize_buffers(UINT width, UINT height) {
@@ -2335,7 +2459,12 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::SetTexture(
         return D3DERR_INVALIDCALL;
 
     // Always call through first (don't desync on failure).
-    HRESULT hr = impl->inner->SetTexture(Stage, pTexture);
+    HRESULT hr = D3D_OK;
+    if (ZeroMod::sf_texture(impl->state_filter, Stage, pTexture)) {
+        hr = impl->inner->SetTexture(Stage, pTexture);
+        if (FAILED(hr))
+            ZeroMod::sf_invalidate_texture(impl->state_filter, Stage);
+    }
 
     if (SUCCEEDED(hr) && Stage < Impl::ZM_MAX_TEX_STAGES) {
         // Keep own ref to whatever the app bound.
@@ -2350,6 +2479,15 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::SetTexture(
         // keep sentinel intact for loops that expect null-termination
         impl->cached_stage_tex[Impl::ZM_MAX_TEX_STAGES] = nullptr;
 
+        if (Stage == 0 && !impl->state_filter.recording)
+            ZeroMod::db_set_tex0(impl->draw_binds, impl->res_table, pTexture);
+
+        if (impl->call_rec && !impl->state_filter.recording) {
+            const ZeroMod::zm_res_desc* e = ZeroMod::res_texture_desc(impl->res_table, pTexture);
+            ZeroMod::cr_set_tex(impl->call_rec, Stage, pTexture, e ? e->width : 0, e ? e->height : 0,
+                e && e->kind == ZeroMod::ZM_RES_TEX2D);
+        }
+
         // ---- TRACE (stage0 match) ----
         if (Stage == 0) {
             g_stage0_is_game = false;
@@ -2375,8 +2513,16 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::SetSamplerState(
     D3DSAMPLERSTATETYPE Type,
     DWORD Value
 ) {
+    const bool forward = ZeroMod::sf_sampler(impl->state_filter, Sampler, Type, Value);
+    if (impl->call_rec && !impl->state_filter.recording)
+        ZeroMod::cr_state(impl->call_rec, ZeroMod::ZM_CR_OP_SET_SAMP, Sampler, Type, Value, forward);
+    if (!forward)
+        return D3D_OK;
+
     HRESULT hr = impl->inner->SetSamplerState(Sampler, Type, Value);
     ZM_LOG_UNSUP("MyID3D9Device::SetSamplerState", hr);
+    if (FAILED(hr))
+        ZeroMod::sf_invalidate_sampler(impl->state_filter, Sampler);
 
 #ifdef ENABLE_SAMPLER_STATE_CACHE
     impl->cached_sampler_states[Sampler][Type] = Value;
@@ -2565,36 +2711,29 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::SetIndices(IDirect3DIndexBuffer9* pInde
 }
 
 void MyID3D9Device::Impl::PollToggles() {
-    if (!config || !overlay) return;
-
-    RefreshXInputState();
+    if (!config || !overlay || !default_input) return;
 
     bool flash_kill_changed = false;
     bool cutscenes_changed = false;
     bool shader_changed = false;
 
-    if (PollToggleHotkey(config->hotkey_transparent_cutscenes,
-        config->hotkey_transparent_cutscenes_pad,
-        hk_transparent_cutscenes,
-        hk_transparent_cutscenes_pad,
-        config->transparent_cutscenes)) {
-        cutscenes_changed = true;
-    }
-
-    if (PollToggleHotkey(config->hotkey_flash_kill,
-        config->hotkey_flash_kill_pad,
-        hk_flash_kill,
-        hk_flash_kill_pad,
-        config->flash_kill)) {
-        flash_kill_changed = true;
-    }
-
-    if (PollToggleHotkey(config->hotkey_shader_toggle,
-        config->hotkey_shader_toggle_pad,
-        hk_shader_toggle,
-        hk_shader_toggle_pad,
-        config->shader_toggle)) {
-        shader_changed = true;
+    // Presses of the [toggles] hotkeys, edge-detected by the input thread
+    BYTE event;
+    while (default_input->next_event(ZeroMod::ZM_IN_Q_RENDER, event)) {
+        switch (event) {
+        case ZeroMod::ZM_IN_TRANSPARENT_CUTSCENES:
+            config->transparent_cutscenes = !config->transparent_cutscenes.load();
+            cutscenes_changed = true;
+            break;
+        case ZeroMod::ZM_IN_FLASH_KILL:
+            config->flash_kill = !config->flash_kill.load();
+            flash_kill_changed = true;
+            break;
+        case ZeroMod::ZM_IN_SHADER_TOGGLE:
+            config->shader_toggle = !config->shader_toggle.load();
+            shader_changed = true;
+            break;
+        }
     }
 
     if (default_overlay) {
@@ -2647,6 +2786,40 @@ void EnsureBlackKeyShader(IDirect3DDevice9* dev, IDirect3DPixelShader9** ps, boo
         }
     }
 }
+// Plain sample for the CPU scaler's output
+void EnsureCopyShader(IDirect3DDevice9* dev, IDirect3DPixelShader9** ps, bool* tried)
+{
+    if (*tried) return;
+    *tried = true;
+
+    static const char* src =
+        "sampler2D s0 : register(s0);\n"
+        "float4 main(float2 uv : TEXCOORD0) : COLOR {\n"
+        "    return float4(tex2D(s0, uv).rgb, 1.0);\n"
+        "}\n";
+
+    ID3DXBuffer* code = nullptr;
+    ID3DXBuffer* err = nullptr;
+
+    HRESULT hr = D3DXCompileShader(
+        src, (UINT)strlen(src),
+        nullptr, nullptr,
+        "main", "ps_2_0",
+        0, &code, &err, nullptr
+    );
+
+    if (SUCCEEDED(hr) && code) {
+        dev->CreatePixelShader((const DWORD*)code->GetBufferPointer(), ps);
+        code->Release();
+    }
+    else {
+        if (err) {
+            OutputDebugStringA("[ZeroMod] copy_ps FAILED: ");
+            OutputDebugStringA((const char*)err->GetBufferPointer());
+            err->Release();
+        }
+    }
+}
 void EnsureOverlayBlendShader(IDirect3DDevice9* dev, IDirect3DPixelShader9** ps, bool* tried)
 {
     if (*tried) return;
@@ -2716,93 +2889,40 @@ void EnsureOverlayBlendShader(IDirect3DDevice9* dev, IDirect3DPixelShader9** ps,
         }
     }
 }
-void DrawFullscreenQuad(IDirect3DDevice9* dev)
+void EnsureBlitQuad(IDirect3DDevice9* dev, ZeroMod::zm_quad* quad, bool* tried)
 {
-    D3DVIEWPORT9 vp{};
-    dev->GetViewport(&vp);
-
-    const float x0 = (float)vp.X - 0.5f;
-    const float y0 = (float)vp.Y - 0.5f;
-    const float x1 = (float)(vp.X + vp.Width) - 0.5f;
-    const float y1 = (float)(vp.Y + vp.Height) - 0.5f;
-
-    ZM_SCREEN_VERTEX quad[4] =
-    {
-        { x0, y0, 0.0f, 1.0f, 0.0f, 0.0f },
-        { x1, y0, 0.0f, 1.0f, 1.0f, 0.0f },
-        { x0, y1, 0.0f, 1.0f, 0.0f, 1.0f },
-        { x1, y1, 0.0f, 1.0f, 1.0f, 1.0f }
-    };
+    if (*tried) return;
+    *tried = true;
 
-    dev->SetFVF(ZM_SCREEN_FVF);
+    if (!ZeroMod::quad_create(dev, *quad))
+        OutputDebugStringA("[ZeroMod] blit_quad FAILED\n");
+}
+void DrawFullscreenQuad(ZeroMod::zm_state_delta& sd, const ZeroMod::zm_quad& quad)
+{
+    D3DVIEWPORT9 vp{};
+    sd.dev->GetViewport(&vp);
 
     // Disable depth
-    dev->SetRenderState(D3DRS_ZENABLE, FALSE);
-    dev->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
-
-    // Ensure no shaders override
-    dev->SetVertexShader(nullptr);
+    ZeroMod::sd_rs(sd, D3DRS_ZENABLE, FALSE);
+    ZeroMod::sd_rs(sd, D3DRS_ZWRITEENABLE, FALSE);
 
-    dev->DrawPrimitiveUP(
-        D3DPT_TRIANGLESTRIP,
-        2,
-        quad,
-        sizeof(ZM_SCREEN_VERTEX)
-    );
+    ZeroMod::quad_blit(sd, quad, vp.Width, vp.Height, 0.0f, 0.0f, 1.0f, 1.0f);
 }
-void DrawFullscreenQuadOverscanned(IDirect3DDevice9* dev, float u_scale, float v_scale)
+void DrawFullscreenQuadOverscanned(ZeroMod::zm_state_delta& sd, const ZeroMod::zm_quad& quad, float u_scale, float v_scale)
 {
     D3DVIEWPORT9 vp{};
-    dev->GetViewport(&vp);
-
-    const float x0 = (float)vp.X - 0.5f;
-    const float y0 = (float)vp.Y - 0.5f;
-    const float x1 = (float)(vp.X + vp.Width) - 0.5f;
-    const float y1 = (float)(vp.Y + vp.Height) - 0.5f;
+    sd.dev->GetViewport(&vp);
 
     // Center the UV overscan so it zooms from the middle
     const float u_off = (1.0f - u_scale) * 0.5f;
     const float v_off = (1.0f - v_scale) * 0.5f;
 
-    const float u0 = u_off;
-    const float v0 = v_off;
-    const float u1 = u_off + u_scale;
-    const float v1 = v_off + v_scale;
+    ZeroMod::sd_rs(sd, D3DRS_ZENABLE, FALSE);
+    ZeroMod::sd_rs(sd, D3DRS_ZWRITEENABLE, FALSE);
 
-    ZM_SCREEN_VERTEX quad[4] =
-    {
-        { x0, y0, 0.0f, 1.0f, u0, v0 },
-        { x1, y0, 0.0f, 1.0f, u1, v0 },
-        { x0, y1, 0.0f, 1.0f, u0, v1 },
-        { x1, y1, 0.0f, 1.0f, u1, v1 }
-    };
-
-    dev->SetFVF(ZM_SCREEN_FVF);
-    dev->SetRenderState(D3DRS_ZENABLE, FALSE);
-    dev->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
-    dev->SetVertexShader(nullptr);
-
-    dev->DrawPrimitiveUP(
-        D3DPT_TRIANGLESTRIP,
-        2,
-        quad,
-        sizeof(ZM_SCREEN_VERTEX)
-    );
-}
-static bool is_4_3(UINT w, UINT h) {
-    return w && h && (w * 3 == h * 4);
+    ZeroMod::quad_blit(sd, quad, vp.Width, vp.Height,
+        u_off, v_off, u_off + u_scale, v_off + v_scale);
 }
-static inline bool is_3_2(UINT w, UINT h)
-{
-    if (!w || !h) return false;
-
-    // 3:2 => w*2 == h*3, with tiny tolerance for rounding
-    const uint64_t lhs = (uint64_t)w * 2ull;
-    const uint64_t rhs = (uint64_t)h * 3ull;
-    const uint64_t diff = (lhs > rhs) ? (lhs - rhs) : (rhs - lhs);
-    return diff <= 8;
-}
-
 HRESULT STDMETHODCALLTYPE MyID3D9Device::DrawPrimitive(
     D3DPRIMITIVETYPE PrimitiveType,
     UINT StartVertex,
@@ -2815,6 +2935,7 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::DrawPrimitive(
 
     if (in_our_draw)
         return impl->inner->DrawPrimitive(PrimitiveType, StartVertex, PrimitiveCount);
+    ZM_PROF_SCOPE(ZeroMod::ZM_PS_DRAW_INTERCEPT);
     // --- Poll toggles once per frame (guarded by frame boundary) ---
     {
         static UINT64 last_poll_frame = 0;
@@ -2823,321 +2944,279 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::DrawPrimitive(
             impl->PollToggles();
         }
     }
+    // RT0 / stage 0 / viewport as last set through the proxy; only what was
+    // invalidated since is read back from the device
+    const ZeroMod::zm_draw_binds& db = impl->draw_binds;
+
+    // Which interception signatures this draw matches (table in draw_sig.cpp)
+    uint32_t key = 0;
+    uint32_t sig = 0;
+    if (PrimitiveType == D3DPT_TRIANGLESTRIP && PrimitiveCount == 2)
+    {
+        ZeroMod::zm_draw_matcher& dm = g_draw_matcher;
+        if (!dm.compiled)
+            ZeroMod::ds_compile(dm, ZeroMod::k_draw_sigs, ZeroMod::ZM_DS_COUNT);
+
+        const bool time_it = (dm.draws % ZM_DRAW_SIG_TIME_SAMPLE) == 0;
+        const uint64_t start_ns = time_it ? ZeroMod::ds_now_ns() : 0;
+
+        impl->sync_binds();
+
+        ZeroMod::zm_draw_bind_state bs;
+        bs.rt0 = db.rt0 != nullptr;
+        bs.rt0_w = db.rt0_w;
+        bs.rt0_h = db.rt0_h;
+        bs.bb_w = impl->backbuffer_width;
+        bs.bb_h = impl->backbuffer_height;
+        bs.vp_x = db.vp.X;
+        bs.vp_y = db.vp.Y;
+        bs.vp_w = db.vp.Width;
+        bs.vp_h = db.vp.Height;
+        bs.tex0_2d = db.tex0_2d != nullptr;
+        bs.tex0_w = db.tex0_w;
+        bs.tex0_h = db.tex0_h;
+
+        key = ZeroMod::ds_bind_key(bs);
+        if (impl->wanted.active)
+            key |= ZeroMod::ZM_DK_WANTED;
+        if (impl->wanted.chain)
+            key |= ZeroMod::ZM_DK_CHAIN;
+        if (impl->wanted.src_tex)
+            key |= ZeroMod::ZM_DK_SRC_TEX;
+        if (impl->wanted.saw_composite_fingerprint)
+            key |= ZeroMod::ZM_DK_LATCHED;
+        if ((g_trace_draw_id - impl->wanted.latch_draw_id) > ZM_DRAW_SIG_LATCH_WINDOW)
+            key |= ZeroMod::ZM_DK_LATCH_STALE;
+
+        sig = ZeroMod::ds_match_count(dm, key);
+
+        if (time_it)
+            ZeroMod::ds_add_time(dm, ZeroMod::ds_now_ns() - start_ns);
+#if ZM_DRAW_SIG_STATS_INTERVAL
+        if ((dm.draws % ZM_DRAW_SIG_STATS_INTERVAL) == 0) {
+            char b[1024];
+            ZeroMod::ds_format_stats(dm, b, sizeof(b));
+            OutputDebugStringA(b);
+        }
+#endif
+    }
+    if (impl->call_rec)
+        ZeroMod::cr_draw(impl->call_rec, PrimitiveType, StartVertex, PrimitiveCount, key, sig);
+
     // PRE-WANT flash kill
-    if (!in_our_draw &&
-        PrimitiveType == D3DPT_TRIANGLESTRIP &&
-        PrimitiveCount == 2 &&
-        !impl->wanted.active)
+    if (sig & ZM_DS_BIT(ZeroMod::ZM_DS_PRE_WANT_COMPOSITE))
     {
-        IDirect3DSurface9* rt0 = nullptr;
-        if (SUCCEEDED(impl->inner->GetRenderTarget(0, &rt0)) && rt0) {
-            D3DSURFACE_DESC rd{};
-            rt0->GetDesc(&rd);
-            if (rd.Width == 1280 && rd.Height == 960) {
-                impl->wanted.pre_want_draw_count++;
-                if (impl->wanted.pre_want_draw_count == 1) {
-                    bool kill_it = impl->config && impl->config->flash_kill;
-                    if (kill_it) {
-                        impl->inner->ColorFill(rt0, nullptr, D3DCOLOR_ARGB(0, 0, 0, 0));
-                        rt0->Release();
-                        return D3D_OK;
-                    }
-                }
+        impl->wanted.pre_want_draw_count++;
+        if (impl->wanted.pre_want_draw_count == 1) {
+            bool kill_it = impl->config && impl->config->flash_kill;
+            if (kill_it) {
+                impl->inner->ColorFill(db.rt0, nullptr, D3DCOLOR_ARGB(0, 0, 0, 0));
+                return D3D_OK;
             }
-            rt0->Release();
         }
     }
     // -------------------------------------------------------------------------
     // SWALLOW: when wanted is armed, block the "game src -> composite RT" blit
     // so composite contains UI only.
     // -------------------------------------------------------------------------
-    if (!in_our_draw &&
-        PrimitiveType == D3DPT_TRIANGLESTRIP &&
-        PrimitiveCount == 2 &&
-        impl->wanted.active &&
-        impl->wanted.src_tex)
+    if (sig & ZM_DS_BIT(ZeroMod::ZM_DS_COMPOSITE_FULL))
     {
+        if (!impl->wanted.cleared_composite) {
+            impl->wanted.cleared_composite = true;
+        }
 
-        IDirect3DSurface9* rt0 = nullptr;
-        if (SUCCEEDED(impl->inner->GetRenderTarget(0, &rt0)) && rt0) {
-
-            D3DSURFACE_DESC rd{};
-            rt0->GetDesc(&rd);
-
-            IDirect3DBaseTexture9* t0b = nullptr;
-            IDirect3DTexture9* t0 = nullptr;
-            D3DSURFACE_DESC td{};
-
-            if (SUCCEEDED(impl->inner->GetTexture(0, &t0b)) && t0b)
-                t0b->QueryInterface(IID_IDirect3DTexture9, (void**)&t0);
-
-            if (t0)
-                t0->GetLevelDesc(0, &td);
-
-            D3DVIEWPORT9 vp{};
-            impl->inner->GetViewport(&vp);
-
-            const bool rt_is_composite = (rd.Width == 1280 && rd.Height == 960);
-            const bool t0_is_game_layer =
-                (td.Width == 512 && td.Height == 384);
-
-            const bool vp_full_composite =
-                (vp.X == 0 && vp.Y == 0 && vp.Width == rd.Width && vp.Height == rd.Height);
-
-            if (rt_is_composite && vp_full_composite) {
-
-                if (!impl->wanted.cleared_composite) {
-                    impl->wanted.cleared_composite = true;
-                }
+        // Kill only the game layer blit(s).
+        if (sig & ZM_DS_BIT(ZeroMod::ZM_DS_SWALLOW_GAME_LAYER)) {
+            impl->wanted.swallow_count++;
 
-                // Kill only the game layer blit(s).
-                if (t0 && t0_is_game_layer) {
-                    impl->wanted.swallow_count++;
-            
-                    if (impl->wanted.swallow_count <= 1) {
-                        if (t0)  t0->Release();
-                        if (t0b) t0b->Release();
-                        rt0->Release();
-                        return D3D_OK;
-                    }
-                    else {
-                        // else: fall through, draw normally (ZX subscreen / flash layer)
-                    }
-                }
+            if (impl->wanted.swallow_count <= 1) {
+                return D3D_OK;
+            }
+            else {
+                // else: fall through, draw normally (ZX subscreen / flash layer)
             }
-            if (t0)  t0->Release();
-            if (t0b) t0b->Release();
-            rt0->Release();
         }
     }
 
     // -------------------------------------------------------------------------
     // STEP A: latch "we saw the composite RT" 
     // -------------------------------------------------------------------------
-    if (!in_our_draw &&
-        PrimitiveType == D3DPT_TRIANGLESTRIP &&
-        PrimitiveCount == 2 &&
-        impl->wanted.active &&
-        impl->wanted.chain &&
-        impl->wanted.src_tex)
+    if (sig & ZM_DS_BIT(ZeroMod::ZM_DS_LATCH_COMPOSITE))
     {
-        // Get stage0 texture desc (level 0)
-        IDirect3DBaseTexture9* t0b = nullptr;
-        IDirect3DTexture9* t0 = nullptr;
-        D3DSURFACE_DESC td{};
-
-        if (SUCCEEDED(impl->inner->GetTexture(0, &t0b)) && t0b) {
-            t0b->QueryInterface(IID_IDirect3DTexture9, (void**)&t0);
-        }
-
-        bool is_composite_t0 = false;
-        if (t0) {
-            if (SUCCEEDED(t0->GetLevelDesc(0, &td))) {
-                is_composite_t0 = (td.Width == 1280 && td.Height == 960);
-            }
-        }
-
-        if (is_composite_t0) {
-            impl->wanted.saw_composite_fingerprint = true;
-            impl->wanted.latch_draw_id = g_trace_draw_id;
+        IDirect3DTexture9* t0 = db.tex0_2d;
 
-            if (impl->wanted.ui_composite_tex)
-            {
-                impl->wanted.ui_composite_tex->Release();
-                impl->wanted.ui_composite_tex = nullptr;
-            }
+        impl->wanted.saw_composite_fingerprint = true;
+        impl->wanted.latch_draw_id = g_trace_draw_id;
+        // a fresh latch can't expire on this draw
+        sig &= ~ZM_DS_BIT(ZeroMod::ZM_DS_LATCH_EXPIRE);
 
-            t0->AddRef();
-            impl->wanted.ui_composite_tex = t0;
-        }
+        // AddRef first: t0 may already be the latched texture
+        t0->AddRef();
+        if (impl->wanted.ui_composite_tex)
+            impl->wanted.ui_composite_tex->Release();
+        impl->wanted.ui_composite_tex = t0;
+    }
 
-        if (t0)  t0->Release();
-        if (t0b) t0b->Release();
+    // keep latch from living forever
+    if (sig & ZM_DS_BIT(ZeroMod::ZM_DS_LATCH_EXPIRE)) {
+        impl->wanted.saw_composite_fingerprint = false;
     }
 
     // -------------------------------------------------------------------------
     // STEP B: intercept the ONE "full/full/full" draw and run CG there
-    // Conditions :
+    // Conditions (ZM_DS_GAME_RECT_*):
     //   - TRIANGLESTRIP, 2 tris
-    //   - RT0 desc == 2560x1440
-    //   - T0 level0 desc == 2560x1440
-    //   - VP == 0,0 2560x1440
-    //   - previously latched the composite this frame (saw_composite_fingerprint)
+    //   - RT0 desc == backbuffer size
+    //   - T0 level0 desc == 1280x960 (latched as the composite above)
+    //   - VP a 4:3 or 3:2 sub-rect of RT0 (game space, not UI/wallpaper)
     // -------------------------------------------------------------------------
-    if (!in_our_draw &&
-        PrimitiveType == D3DPT_TRIANGLESTRIP &&
-        PrimitiveCount == 2 &&
-        impl->wanted.active &&
-        impl->wanted.chain &&
-        impl->wanted.src_tex &&
-        impl->wanted.saw_composite_fingerprint)
+    if (sig & (ZM_DS_BIT(ZeroMod::ZM_DS_GAME_RECT_4_3) | ZM_DS_BIT(ZeroMod::ZM_DS_GAME_RECT_3_2)))
     {
-        // keep latch from living forever
-        if ((g_trace_draw_id - impl->wanted.latch_draw_id) > 400) {
-            impl->wanted.saw_composite_fingerprint = false;
-        }
-        else {
-
-            IDirect3DSurface9* rt0 = nullptr;
-            if (SUCCEEDED(impl->inner->GetRenderTarget(0, &rt0)) && rt0) {
-
-                D3DSURFACE_DESC rd{};
-                rt0->GetDesc(&rd);
-
-                IDirect3DBaseTexture9* t0b = nullptr;
-                IDirect3DTexture9* t0 = nullptr;
-                D3DSURFACE_DESC td{};
-
-                if (SUCCEEDED(impl->inner->GetTexture(0, &t0b)) && t0b)
-                    t0b->QueryInterface(IID_IDirect3DTexture9, (void**)&t0);
-
-                if (t0)
-                    t0->GetLevelDesc(0, &td);
-
-                D3DVIEWPORT9 vp{};
-                impl->inner->GetViewport(&vp);
-
-                const bool rt_full = (rd.Width == impl->backbuffer_width &&
-                    rd.Height == impl->backbuffer_height);
-
-                // ZX path
-                const bool t0_is_composite = (td.Width == 1280 && td.Height == 960);
-
-                // viewport must be a sub-rect (game space), not full screen
-                const bool vp_is_subrect =
-                    (vp.Width > 0 && vp.Height > 0) &&
-                    (vp.Width <= rd.Width && vp.Height <= rd.Height) &&
-                    !(vp.X == 0 && vp.Y == 0 && vp.Width == rd.Width && vp.Height == rd.Height);
-
-                // enforce 4:3 viewport to avoid UI/wallpaper layers
-                const bool vp_is_game_aspect =
-                    is_4_3((UINT)vp.Width, (UINT)vp.Height) ||
-                    is_3_2((UINT)vp.Width, (UINT)vp.Height);
+        IDirect3DSurface9* rt0 = db.rt0;
+        const D3DVIEWPORT9 vp = db.vp;
 
-                // ---------------------------------------------------------------------
-                // Zero/ZX accept
-                // ---------------------------------------------------------------------
-                if (rt_full && t0_is_composite && vp_is_subrect && vp_is_game_aspect)
-                {
-                    IDirect3DStateBlock9* sb = nullptr;
-                    if (SUCCEEDED(impl->inner->CreateStateBlock(D3DSBT_ALL, &sb)))
-                        sb->Capture();
-
-                    // force scissor off; keep the engine's game-rect viewport
-                    impl->inner->SetRenderState(D3DRS_SCISSORTESTENABLE, FALSE);
+        // Only what the chain and overlay write gets saved/restored
+        ZeroMod::zm_state_delta& sd = impl->state_delta;
+        ZeroMod::sd_begin(sd, impl->inner);
 
-                    const bool vp_is_32 = is_3_2((UINT)vp.Width, (UINT)vp.Height);
-                    {
-                        ZeroMod::d3d9_video_struct* best = nullptr;
+        // force scissor off; keep the engine's game-rect viewport
+        ZeroMod::sd_rs(sd, D3DRS_SCISSORTESTENABLE, FALSE);
 
-                        if (vp_is_32) {
-                            if (impl->d3d9_gba && impl->d3d9_gba->shader_preset)
-                                best = impl->d3d9_gba;
-                        }
-                        else {
-                            if (impl->d3d9_ds && impl->d3d9_ds->shader_preset)
-                                best = impl->d3d9_ds;
-                        }
-
-                        if (!best && impl->d3d9_2d && impl->d3d9_2d->shader_preset)
-                            best = impl->d3d9_2d;
-
-                        if (best)
-                            impl->wanted.chain = best;
-                    }
-                    in_our_draw = true;
-                    bool ok = ZeroMod::slang_d3d9_frame(
-                        impl->wanted.chain,
-                        impl->wanted.src_tex,     // 256x192
-                        rt0,                      // full RT
-                        (UINT)vp.X, (UINT)vp.Y,   // IMPORTANT: game rect
-                        (UINT)vp.Width, (UINT)vp.Height,
-                        impl->wanted.frame_count,
-                        false, RECT{},
-                        vp_is_32
-                    );
-                    in_our_draw = false;
+        const bool vp_is_32 = (sig & ZM_DS_BIT(ZeroMod::ZM_DS_GAME_RECT_3_2)) != 0;
+        {
+            ZeroMod::d3d9_video_struct* best = nullptr;
 
-                    if (!ok) OutputDebugStringA("[ZeroMod][CGQ] game-rect cg FAILED\n");
+            if (vp_is_32) {
+                if (impl->d3d9_gba && impl->d3d9_gba->shader_preset)
+                    best = impl->d3d9_gba;
+            }
+            else {
+                if (impl->d3d9_ds && impl->d3d9_ds->shader_preset)
+                    best = impl->d3d9_ds;
+            }
 
-                    // ---- OVERLAY: choose shader based on transparent_cutscenes toggle ----
-                    bool use_black_key = impl->config && !impl->config->transparent_cutscenes;
+            if (!best && impl->d3d9_2d && impl->d3d9_2d->shader_preset)
+                best = impl->d3d9_2d;
+
+            if (best)
+                impl->wanted.chain = best;
+        }
+        in_our_draw = true;
+        bool ok = false;
+
+        // [cpu_scaler]: when it has this frame, its output replaces the chain
+        IDirect3DTexture9* scaled = nullptr;
+        if (impl->cpu_scaler && impl->wanted.src_tex
+            && ZeroMod::cps_key(impl->cpu_scaler) == impl->wanted.src_tex) {
+            ZM_PROF_SCOPE(ZeroMod::ZM_PS_CPU_SCALER);
+            scaled = ZeroMod::cps_fetch(impl->cpu_scaler, impl->inner, nullptr, nullptr);
+            EnsureCopyShader(impl->inner, &impl->copy_ps, &impl->copy_ps_tried);
+            EnsureBlitQuad(impl->inner, &impl->blit_quad, &impl->blit_quad_tried);
+            if (scaled && impl->copy_ps) {
+                ZM_GPU_SCOPE("cpu scaler blit");
+                ZeroMod::sd_rs(sd, D3DRS_ALPHABLENDENABLE, FALSE);
+                ZeroMod::sd_ps(sd, impl->copy_ps);
+                ZeroMod::sd_texture(sd, 0, scaled);
+                ZeroMod::sd_sampler(sd, 0, D3DSAMP_MINFILTER, D3DTEXF_LINEAR);
+                ZeroMod::sd_sampler(sd, 0, D3DSAMP_MAGFILTER, D3DTEXF_LINEAR);
+                ZeroMod::sd_sampler(sd, 0, D3DSAMP_MIPFILTER, D3DTEXF_NONE);
+                ZeroMod::sd_sampler(sd, 0, D3DSAMP_ADDRESSU, D3DTADDRESS_CLAMP);
+                ZeroMod::sd_sampler(sd, 0, D3DSAMP_ADDRESSV, D3DTADDRESS_CLAMP);
+                ZeroMod::sd_sampler(sd, 0, D3DSAMP_SRGBTEXTURE, FALSE);
+                DrawFullscreenQuad(sd, impl->blit_quad);
+                ok = true;
+            }
+        }
+        if (!ok)
+        {
+            ZM_PROF_SCOPE(ZeroMod::ZM_PS_SLANG_FRAME);
+            ok = ZeroMod::slang_d3d9_frame(
+                sd,
+                impl->wanted.chain,
+                impl->wanted.src_tex,     // 256x192
+                rt0,                      // full RT
+                (UINT)vp.X, (UINT)vp.Y,   // IMPORTANT: game rect
+                (UINT)vp.Width, (UINT)vp.Height,
+                impl->wanted.frame_count,
+                false, RECT{},
+                vp_is_32
+            );
+        }
+        in_our_draw = false;
 
-                    if (use_black_key) {
-                        EnsureBlackKeyShader(impl->inner, &impl->black_key_ps, &impl->black_key_ps_tried);
-                    }
-                    else {
-                        EnsureOverlayBlendShader(impl->inner, &impl->overlay_blend_ps, &impl->overlay_blend_ps_tried);
-                    }
+        if (!ok) {
+            OutputDebugStringA("[ZeroMod][CGQ] game-rect cg FAILED\n");
+            // a failed chain may have left an intermediate bound
+            ZeroMod::sd_rt(sd, rt0);
+        }
 
-                    impl->inner->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
-                    impl->inner->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
-                    impl->inner->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
-
-                    IDirect3DPixelShader9* chosen_ps = use_black_key
-                        ? impl->black_key_ps
-                        : impl->overlay_blend_ps;
-                    impl->inner->SetPixelShader(chosen_ps);
-                    impl->inner->SetTexture(0, impl->wanted.ui_composite_tex);
-
-                    if (vp_is_32) {
-                        // Zero/GBA path: overscan compensation on full game-rect VP
-                        D3DVIEWPORT9 bbvp = vp;
-                        bbvp.MinZ = 0.f;
-                        bbvp.MaxZ = 1.f;
-                        impl->inner->SetViewport(&bbvp);
-
-                        const float h_overscan = 1.07f;
-                        const float v_overscan = 1.20f;
-                        DrawFullscreenQuadOverscanned(impl->inner, 1.0f / h_overscan, 1.0f / v_overscan);
-                    }
-                    else {
-                        // ZX/DS path: match the integer-scaled game layer
-                        const UINT src_w = 256;
-                        const UINT src_h = 192;
-                        const UINT kx = vp.Width / src_w;
-                        const UINT ky = vp.Height / src_h;
-                        const UINT k = (kx < ky) ? kx : ky;
-                        const UINT int_w = (k > 0) ? src_w * k : vp.Width;
-                        const UINT int_h = (k > 0) ? src_h * k : vp.Height;
-
-                        const UINT dx = (vp.Width > int_w) ? (vp.Width - int_w) / 2 : 0;
-                        const UINT dy = (vp.Height > int_h) ? (vp.Height - int_h) / 2 : 0;
-
-                        D3DVIEWPORT9 bbvp{};
-                        bbvp.X = vp.X + dx;
-                        bbvp.Y = vp.Y + dy;
-                        bbvp.Width = int_w;
-                        bbvp.Height = int_h;
-                        bbvp.MinZ = 0.f;
-                        bbvp.MaxZ = 1.f;
-                        impl->inner->SetViewport(&bbvp);
-
-                        DrawFullscreenQuad(impl->inner);
-                    }
+        // ---- OVERLAY: choose shader based on transparent_cutscenes toggle ----
+        bool use_black_key = impl->config && !impl->config->transparent_cutscenes;
 
-                    impl->inner->SetPixelShader(nullptr);
-                    impl->inner->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
+        if (use_black_key) {
+            EnsureBlackKeyShader(impl->inner, &impl->black_key_ps, &impl->black_key_ps_tried);
+        }
+        else {
+            EnsureOverlayBlendShader(impl->inner, &impl->overlay_blend_ps, &impl->overlay_blend_ps_tried);
+        }
+        EnsureBlitQuad(impl->inner, &impl->blit_quad, &impl->blit_quad_tried);
 
-                    if (sb) { sb->Apply(); sb->Release(); }
+        ZM_GPU_SCOPE("ui composite blend");
+        ZeroMod::sd_rs(sd, D3DRS_ALPHABLENDENABLE, TRUE);
+        ZeroMod::sd_rs(sd, D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+        ZeroMod::sd_rs(sd, D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
 
-                    impl->wanted.active = false;
-                    impl->wanted.saw_composite_fingerprint = false;
-                    impl->wanted.chain = nullptr;
-                    impl->wanted.frame_count = 0;
-                    if (impl->wanted.src_tex) { impl->wanted.src_tex->Release(); impl->wanted.src_tex = nullptr; }
+        IDirect3DPixelShader9* chosen_ps = use_black_key
+            ? impl->black_key_ps
+            : impl->overlay_blend_ps;
+        ZeroMod::sd_ps(sd, chosen_ps);
+        ZeroMod::sd_texture(sd, 0, impl->wanted.ui_composite_tex);
 
-                    if (t0)  t0->Release();
-                    if (t0b) t0b->Release();
-                    rt0->Release();
+        if (vp_is_32) {
+            // Zero/GBA path: overscan compensation on full game-rect VP
+            D3DVIEWPORT9 bbvp = vp;
+            bbvp.MinZ = 0.f;
+            bbvp.MaxZ = 1.f;
+            ZeroMod::sd_viewport(sd, bbvp);
 
-                    return D3D_OK;
-                }
-                if (t0)  t0->Release();
-                if (t0b) t0b->Release();
-                rt0->Release();
-            }
+            const float h_overscan = 1.07f;
+            const float v_overscan = 1.20f;
+            DrawFullscreenQuadOverscanned(sd, impl->blit_quad, 1.0f / h_overscan, 1.0f / v_overscan);
         }
+        else {
+            // ZX/DS path: match the integer-scaled game layer
+            const UINT src_w = 256;
+            const UINT src_h = 192;
+            const UINT kx = vp.Width / src_w;
+            const UINT ky = vp.Height / src_h;
+            const UINT k = (kx < ky) ? kx : ky;
+            const UINT int_w = (k > 0) ? src_w * k : vp.Width;
+            const UINT int_h = (k > 0) ? src_h * k : vp.Height;
+
+            const UINT dx = (vp.Width > int_w) ? (vp.Width - int_w) / 2 : 0;
+            const UINT dy = (vp.Height > int_h) ? (vp.Height - int_h) / 2 : 0;
+
+            D3DVIEWPORT9 bbvp{};
+            bbvp.X = vp.X + dx;
+            bbvp.Y = vp.Y + dy;
+            bbvp.Width = int_w;
+            bbvp.Height = int_h;
+            bbvp.MinZ = 0.f;
+            bbvp.MaxZ = 1.f;
+            ZeroMod::sd_viewport(sd, bbvp);
+
+            DrawFullscreenQuad(sd, impl->blit_quad);
+        }
+
+        ZeroMod::sd_end(sd);
+
+        impl->wanted.active = false;
+        impl->wanted.saw_composite_fingerprint = false;
+        impl->wanted.chain = nullptr;
+        impl->wanted.frame_count = 0;
+        if (impl->wanted.src_tex) { impl->wanted.src_tex->Release(); impl->wanted.src_tex = nullptr; }
+
+        return D3D_OK;
     }
 
     // -------------------------------------------------------------------------
@@ -3145,22 +3224,15 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::DrawPrimitive(
     // -------------------------------------------------------------------------
     bool handled = false;
 
-    if (!in_our_draw &&
-        PrimitiveType == D3DPT_TRIANGLESTRIP &&
-        PrimitiveCount == 2)
+    if (sig & ZM_DS_BIT(ZeroMod::ZM_DS_LEGACY))
     {
-        if (impl->wanted.active) {
-            // armed; do nothing here; fall through to inner draw
-        }
-        else {
-            in_our_draw = true;
-            const UINT vertexCount = PrimitiveCount + 2;
-            handled = impl->Draw(vertexCount, StartVertex);
-            in_our_draw = false;
+        in_our_draw = true;
+        const UINT vertexCount = PrimitiveCount + 2;
+        handled = impl->Draw(vertexCount, StartVertex);
+        in_our_draw = false;
 
-            if (handled)
-                return D3D_OK;
-        }
+        if (handled)
+            return D3D_OK;
     }
 
     impl->linear_conditions_begin();
@@ -3212,6 +3284,14 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::SetRenderTarget(
         impl->cached_rtv = pRenderTarget;
         if (impl->cached_rtv)
             impl->cached_rtv->AddRef();
+
+        ZeroMod::db_set_rt0(impl->draw_binds, pRenderTarget);
+    }
+
+    if (impl->call_rec) {
+        const bool rt0 = RenderTargetIndex == 0;
+        ZeroMod::cr_set_rt(impl->call_rec, RenderTargetIndex, pRenderTarget,
+            rt0 ? impl->draw_binds.rt0_w : 0, rt0 ? impl->draw_binds.rt0_h : 0);
     }
 
     return hr;
@@ -3221,13 +3301,15 @@ HRESULT STDMETHODCALLTYPE  MyID3D9Device::SetRenderState(
     D3DRENDERSTATETYPE State,
     DWORD Value
 ) {
-    // Set the render state directly on the inner device
-    impl->inner->SetRenderState(State, Value);
+    // Drop it if the device already has this value
+    const bool forward = ZeroMod::sf_rs(impl->state_filter, State, Value);
+    if (impl->call_rec && !impl->state_filter.recording)
+        ZeroMod::cr_state(impl->call_rec, ZeroMod::ZM_CR_OP_SET_RS, 0, State, Value, forward);
+    if (!forward)
+        return S_OK;
 
-    // Cache the render state if enabled for slang shader
-    if constexpr (ENABLE_SLANG_SHADER) {
-        impl->cached_rs[State] = Value;
-    }
+    if (FAILED(impl->inner->SetRenderState(State, Value)))
+        ZeroMod::sf_invalidate_rs(impl->state_filter, State);
     return S_OK;
 }
 
@@ -3237,14 +3319,15 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::SetDepthStencilState(
     // Set the cached depth stencil state
     impl->cached_dss = pDepthStencilState;
 
+    // Goes through SetRenderState so the filter and the capture see it
     if (pDepthStencilState) {
         // Enable stencil
-        impl->inner->SetRenderState(D3DRS_STENCILENABLE, TRUE);
+        SetRenderState(D3DRS_STENCILENABLE, TRUE);
         // Additional D3DRS_* state settings here if needed
     }
     else {
         // Disable stencil
-        impl->inner->SetRenderState(D3DRS_STENCILENABLE, FALSE);
+        SetRenderState(D3DRS_STENCILENABLE, FALSE);
     }
 
     return S_OK; // Assuming HRESULT should be returned
@@ -3289,7 +3372,9 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::SetRasterizerState(
 ) {
     if (pRasterizerState) {
         // Apply the state block to set the rasterizer state
-        return pRasterizerState->Apply();
+        HRESULT hr = pRasterizerState->Apply();
+        ZeroMod::sf_invalidate(impl->state_filter);
+        return hr;
     }
     return D3D_OK;
 }
@@ -3424,21 +3509,33 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::SetScissorRects(
              return;
          }
 
-         D3DSURFACE_DESC desc;
-         dstTexture->GetLevelDesc(0, &desc);
+         D3DSURFACE_DESC srcDesc, dstDesc;
+         srcTexture->GetLevelDesc(0, &srcDesc);
+         dstTexture->GetLevelDesc(0, &dstDesc);
 
          BYTE* src = static_cast<BYTE*>(srcLocked.pBits);
          BYTE* dst = static_cast<BYTE*>(dstLocked.pBits);
 
-         UINT rowBytes =(std::min)(
-             static_cast<UINT>(srcLocked.Pitch),
-             static_cast<UINT>(dstLocked.Pitch)
-         );
-
-         for (UINT y = 0; y < desc.Height; ++y) {
-             memcpy(dst, src, rowBytes);
-             src += srcLocked.Pitch;
-             dst += dstLocked.Pitch;
+         const UINT height = (std::min)(srcDesc.Height, dstDesc.Height);
+         const RECT srcRect = { 0, 0, (LONG)(std::min)(srcDesc.Width, dstDesc.Width), (LONG)height };
+         const POINT dstPoint = { 0, 0 };
+
+         // Formats the converter doesn't know (compressed ones) copy as
+         // bytes, a block row at a time for block formats
+         if (!ConvertD3DPixels(dst, dstLocked.Pitch, dstDesc.Format, dstPoint,
+                 src, srcLocked.Pitch, srcDesc.Format, srcRect)) {
+             UINT rowBytes =(std::min)(
+                 static_cast<UINT>(srcLocked.Pitch),
+                 static_cast<UINT>(dstLocked.Pitch)
+             );
+             const UINT rows = (std::min)(D3DFormatRowCount(srcDesc.Format, srcDesc.Height),
+                 D3DFormatRowCount(dstDesc.Format, dstDesc.Height));
+
+             for (UINT y = 0; y < rows; ++y) {
+                 memcpy(dst, src, rowBytes);
+                 src += srcLocked.Pitch;
+                 dst += dstLocked.Pitch;
+             }
          }
 
          srcTexture->UnlockRect(0);
@@ -3463,9 +3560,23 @@ void STDMETHODCALLTYPE MyIDirect3DDevice9::UpdateSubresource(
     switch (dstType) {
     case D3DRTYPE_TEXTURE_ALIAS: {
         IDirect3DTexture9* dstTexture = static_cast<IDirect3DTexture9*>(pDstResource);
+        D3DSURFACE_DESC desc;
         D3DLOCKED_RECT lockedRect;
-        dstTexture->LockRect(0, &lockedRect, nullptr, 0);
-        memcpy(lockedRect.pBits, pSrcData, SrcRowPitch); // Simplified copy
+        if (!pSrcData || FAILED(dstTexture->GetLevelDesc(0, &desc)) ||
+            FAILED(dstTexture->LockRect(0, &lockedRect, nullptr, 0)))
+            break;
+
+        // Every row, SrcRowPitch apart, in the texture's own format
+        const RECT srcRect = { 0, 0, (LONG)desc.Width, (LONG)desc.Height };
+        const POINT dstPoint = { 0, 0 };
+        if (!ConvertD3DPixels(lockedRect.pBits, lockedRect.Pitch, desc.Format, dstPoint,
+                pSrcData, SrcRowPitch, desc.Format, srcRect)) {
+            const UINT rowBytes = (std::min)(SrcRowPitch, static_cast<UINT>(lockedRect.Pitch));
+            const UINT rows = D3DFormatRowCount(desc.Format, desc.Height);
+            for (UINT y = 0; y < rows; ++y)
+                memcpy((BYTE*)lockedRect.pBits + (size_t)y * lockedRect.Pitch,
+                    (const BYTE*)pSrcData + (size_t)y * SrcRowPitch, rowBytes);
+        }
         dstTexture->UnlockRect(0);
         break;
     }
@@ -3679,6 +3790,7 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::CreateTexture1D(
 ) {
     HRESULT ret = impl->inner->CreateTexture(Width, 1, Levels, Usage, Format, Pool, ppTexture, pSharedHandle);
     if (ret == S_OK) {
+        ZeroMod::res_put(impl->res_table, *ppTexture, Width, 1, Format, ZeroMod::ZM_RES_TEX2D);
     }
     else {
     }
@@ -3700,6 +3812,7 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::CreateTexture2D(
         Width, Height, Levels, Usage, Format, Pool, ppTexture, pSharedHandle
     );
     if (ret == S_OK) {
+        ZeroMod::res_put(impl->res_table, *ppTexture, Width, Height, Format, ZeroMod::ZM_RES_TEX2D);
     }
     else {
     }
@@ -4205,7 +4318,13 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::Reset(D3DPRESENT_PARAMETERS* pPresentat
     }
 
     // ---- RESET ----
+    ZeroMod::gp_discard(ZeroMod::g_gpu_prof, true);
     HRESULT hr = impl->inner->Reset(pPresentationParameters);
+    // Reset puts every state back to its default
+    ZeroMod::sf_invalidate(impl->state_filter);
+    ZeroMod::db_invalidate(impl->draw_binds, ZeroMod::ZM_DB_ALL);
+    if (impl->call_rec)
+        ZeroMod::cr_reset(impl->call_rec);
 
     char dbg[128];
     _snprintf(dbg, sizeof(dbg), "[ZeroMod] Reset hr=0x%08lX\n", (unsigned long)hr);
@@ -4227,7 +4346,7 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::Reset(D3DPRESENT_PARAMETERS* pPresentat
     extern Config* default_config;
 
     if (!impl->config && default_config) {
-        impl->config = default_config;
+        impl->set_config(default_config);
     }
     if (!impl->overlay && default_overlay) {
         impl->overlay = default_overlay;
@@ -4340,6 +4459,15 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::Present(
     HWND dst_window_override,
     const RGNDATA* dirty_region
 ) {
+    // ---- This frame's config snapshot ----
+    if (impl)
+        impl->refresh_config();
+
+    // ---- Profiler frame boundary (before any scope of this frame) ----
+    if (impl && impl->frame_config)
+        ZeroMod::prof_frame(impl->frame_config->profiler_enabled, impl->frame_config->profiler_csv);
+    ZM_PROF_SCOPE(ZeroMod::ZM_PS_PRESENT);
+
     // ---- Grab backbuffer size once ----
     if (impl && impl->backbuffer_width == 0) {
         IDirect3DSurface9* bb = nullptr;
@@ -4357,6 +4485,12 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::Present(
 
     // ---- Overlay draw (no init here) ----
     if (impl && impl->overlay_inited && impl->overlay) {
+        ZM_PROF_SCOPE(ZeroMod::ZM_PS_OVERLAY);
+        const bool cpu_new = ZeroMod::prof_overlay_text(impl->prof_cpu_text);
+        const bool gpu_new = ZeroMod::gp_overlay_text(ZeroMod::g_gpu_prof, impl->prof_gpu_text);
+        if (cpu_new || gpu_new)
+            impl->overlay->set_stats_text(impl->prof_cpu_text + impl->prof_gpu_text);
+
         // prove this is actually executing
         static bool once = false;
         if (!once) { once = true; OutputDebugStringA("[ZeroMod] Overlay: Present path entered\n"); }
@@ -4366,10 +4500,15 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::Present(
 
     // ---- Per-frame config + filter cleanup ----
     impl->present();
+    ZeroMod::sf_frame_end(impl->state_filter);
+    impl->capture_frame();
+    if (default_logger)
+        default_logger->next_frame();
 
 	// ---- Slang Parse ----
     if (impl && (impl->d3d9_2d || impl->d3d9_gba || impl->d3d9_ds))
     {
+      ZM_PROF_SCOPE(ZeroMod::ZM_PS_GFX_FRAME);
       static uint64_t s_frame = 0;
       uint64_t f = ++s_frame;
 
@@ -4377,7 +4516,13 @@ HRESULT STDMETHODCALLTYPE MyID3D9Device::Present(
        if (impl->d3d9_gba) ZeroMod::d3d9_gfx_frame(impl->d3d9_gba, nullptr, f);
        if (impl->d3d9_ds)  ZeroMod::d3d9_gfx_frame(impl->d3d9_ds, nullptr, f);
     }
+    // ---- GPU timestamps: close this frame's queries, read finished ones ----
+    ZeroMod::gp_frame(ZeroMod::g_gpu_prof, impl->inner,
+        impl->frame_config && impl->frame_config->profiler_gpu,
+        impl->frame_config && impl->frame_config->profiler_csv);
+
     // ---- Real Present ----
+        ZM_PROF_SCOPE(ZeroMod::ZM_PS_DRIVER_PRESENT);
         return impl->inner->Present(src_rect, dst_rect, dst_window_override, dirty_region);
 }
 
@@ -4420,15 +4565,38 @@ HRESULT MyID3D9Device::CreateTexture(UINT Width, UINT Height, UINT Levels, DWORD
         OutputDebugStringA("[ZeroMod][SCAN] CREATE HIT 512x512 (CreateTexture)\n");
     }
 
-    return impl->inner->CreateTexture(Width, Height, Levels, Usage, Format, Pool, ppTexture, pSharedHandle);
+    HRESULT hr = impl->inner->CreateTexture(Width, Height, Levels, Usage, Format, Pool, ppTexture, pSharedHandle);
+    if (SUCCEEDED(hr) && ppTexture && *ppTexture) {
+        ZeroMod::res_put(impl->res_table, *ppTexture, Width, Height, Format, ZeroMod::ZM_RES_TEX2D);
+        // A new texture at a freed one's address isn't the scaled frame's
+        ZeroMod::cps_forget(impl->cpu_scaler, *ppTexture);
+        if (impl->call_rec)
+            ZeroMod::cr_create_tex(impl->call_rec, *ppTexture, ZeroMod::ZM_CR_TEX_2D,
+                Width, Height, Levels, Usage, Format, Pool);
+    }
+    return hr;
 }
 
 HRESULT MyID3D9Device::CreateVolumeTexture(UINT Width, UINT Height, UINT Depth, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DVolumeTexture9** ppVolumeTexture, HANDLE* pSharedHandle) {
-    return impl->inner->CreateVolumeTexture(Width, Height, Depth, Levels, Usage, Format, Pool, ppVolumeTexture, pSharedHandle);
+    HRESULT hr = impl->inner->CreateVolumeTexture(Width, Height, Depth, Levels, Usage, Format, Pool, ppVolumeTexture, pSharedHandle);
+    if (SUCCEEDED(hr) && ppVolumeTexture && *ppVolumeTexture) {
+        ZeroMod::res_put(impl->res_table, *ppVolumeTexture, Width, Height, Format, ZeroMod::ZM_RES_OTHER);
+        if (impl->call_rec)
+            ZeroMod::cr_create_tex(impl->call_rec, *ppVolumeTexture, ZeroMod::ZM_CR_TEX_VOLUME,
+                Width, Height, Levels, Usage, Format, Pool);
+    }
+    return hr;
 }
 
 HRESULT MyID3D9Device::CreateCubeTexture(UINT EdgeLength, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DCubeTexture9** ppCubeTexture, HANDLE* pSharedHandle) {
-    return impl->inner->CreateCubeTexture(EdgeLength, Levels, Usage, Format, Pool, ppCubeTexture, pSharedHandle);
+    HRESULT hr = impl->inner->CreateCubeTexture(EdgeLength, Levels, Usage, Format, Pool, ppCubeTexture, pSharedHandle);
+    if (SUCCEEDED(hr) && ppCubeTexture && *ppCubeTexture) {
+        ZeroMod::res_put(impl->res_table, *ppCubeTexture, EdgeLength, EdgeLength, Format, ZeroMod::ZM_RES_OTHER);
+        if (impl->call_rec)
+            ZeroMod::cr_create_tex(impl->call_rec, *ppCubeTexture, ZeroMod::ZM_CR_TEX_CUBE,
+                EdgeLength, EdgeLength, Levels, Usage, Format, Pool);
+    }
+    return hr;
 }
 
 HRESULT MyID3D9Device::CreateIndexBuffer(UINT Length, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DIndexBuffer9** ppIndexBuffer, HANDLE* pSharedHandle) {
@@ -4450,11 +4618,17 @@ HRESULT MyID3D9Device::CreateDepthStencilSurface(UINT Width, UINT Height, D3DFOR
 }
 
 HRESULT MyID3D9Device::UpdateSurface(IDirect3DSurface9* src_surface, const RECT* src_rect, IDirect3DSurface9* dest_surface, const POINT* dest_point) {
-    return impl->inner->UpdateSurface(src_surface, src_rect, dest_surface, dest_point);
+    HRESULT hr = impl->inner->UpdateSurface(src_surface, src_rect, dest_surface, dest_point);
+    if (SUCCEEDED(hr) && impl->cpu_scaler)
+        impl->cps_feed_update(src_surface, src_rect, dest_surface, dest_point);
+    return hr;
 }
 
 HRESULT MyID3D9Device::UpdateTexture(IDirect3DBaseTexture9* pSourceTexture, IDirect3DBaseTexture9* pDestinationTexture) {
-    return impl->inner->UpdateTexture(pSourceTexture, pDestinationTexture);
+    HRESULT hr = impl->inner->UpdateTexture(pSourceTexture, pDestinationTexture);
+    if (SUCCEEDED(hr) && impl->cpu_scaler)
+        impl->cps_feed_update(pSourceTexture, pDestinationTexture);
+    return hr;
 }
 
 HRESULT MyID3D9Device::GetRenderTargetData(IDirect3DSurface9* pRenderTarget, IDirect3DSurface9* pDestSurface) {
@@ -4558,13 +4732,14 @@ HRESULT MyID3D9Device::Clear(
 {
 
     // Count clears on the composite RT when wanted is armed
-    if (impl->wanted.active && (flags & D3DCLEAR_TARGET)) {
-        IDirect3DSurface9* rt0 = nullptr;
-        if (SUCCEEDED(impl->inner->GetRenderTarget(0, &rt0)) && rt0) {
-            D3DSURFACE_DESC rd{};
-            rt0->GetDesc(&rd);
+    if (impl->call_rec)
+        ZeroMod::cr_clear(impl->call_rec, rect_count, flags, color);
 
-            if (rd.Width == 1280 && rd.Height == 960) {
+    if (impl->wanted.active && (flags & D3DCLEAR_TARGET)) {
+        impl->sync_binds();
+        const ZeroMod::zm_draw_binds& db = impl->draw_binds;
+        if (db.rt0) {
+            if (db.rt0_w == 1280 && db.rt0_h == 960) {
                 // Count only black-opaque (0xFF000000) and white-transparent (0x00FFFFFF)
                 const bool is_black_opaque = (color == D3DCOLOR_ARGB(255, 0, 0, 0));
                 const bool is_white_transparent = (color == D3DCOLOR_ARGB(0, 255, 255, 255));
@@ -4580,7 +4755,6 @@ HRESULT MyID3D9Device::Clear(
                     }
                 }
             }
-            rt0->Release();
         }
     }
 
@@ -4614,17 +4788,22 @@ HRESULT MyID3D9Device::SetViewport(const D3DVIEWPORT9* viewport)
         if (impl->get_viewport_from_current_rt(fixed) && fixed.Width && fixed.Height) {
             impl->cached_vp = fixed;
             log_vp("SANITIZED->forward", fixed);
-            return impl->inner->SetViewport(&fixed);
+            HRESULT hr = impl->inner->SetViewport(&fixed);
+            impl->track_viewport(hr, fixed);
+            return hr;
         }
 
         // fallback: forward original (let D3D decide)
         log_vp("SANITIZE_FAIL->forward_original", *viewport);
+        ZeroMod::db_invalidate(impl->draw_binds, ZeroMod::ZM_DB_VP);
         return impl->inner->SetViewport(viewport);
     }
 
     impl->cached_vp = *viewport;
     log_vp("forward", *viewport);
-    return impl->inner->SetViewport(viewport);
+    HRESULT hr = impl->inner->SetViewport(viewport);
+    impl->track_viewport(hr, *viewport);
+    return hr;
 }
 
 HRESULT MyID3D9Device::GetViewport(D3DVIEWPORT9* pViewport) {
@@ -4668,15 +4847,28 @@ HRESULT MyID3D9Device::GetRenderState(D3DRENDERSTATETYPE State, DWORD* pValue) {
 }
 
 HRESULT MyID3D9Device::CreateStateBlock(D3DSTATEBLOCKTYPE Type, IDirect3DStateBlock9** ppSB) {
-    return impl->inner->CreateStateBlock(Type, ppSB);
+    HRESULT hr = impl->inner->CreateStateBlock(Type, ppSB);
+    // Wrapped so Apply() can invalidate the state filter
+    if (SUCCEEDED(hr) && ppSB && *ppSB)
+        new MyIDirect3DStateBlock9(ppSB, this, &impl->state_filter, &impl->draw_binds);
+    return hr;
 }
 
 HRESULT MyID3D9Device::BeginStateBlock() {
-    return impl->inner->BeginStateBlock();
+    HRESULT hr = impl->inner->BeginStateBlock();
+    // While recording, Set* calls don't reach the device state
+    if (SUCCEEDED(hr))
+        ZeroMod::sf_begin_record(impl->state_filter);
+    return hr;
 }
 
 HRESULT MyID3D9Device::EndStateBlock(IDirect3DStateBlock9** ppSB) {
-    return impl->inner->EndStateBlock(ppSB);
+    HRESULT hr = impl->inner->EndStateBlock(ppSB);
+    ZeroMod::sf_end_record(impl->state_filter);
+    ZeroMod::db_invalidate(impl->draw_binds, ZeroMod::ZM_DB_ALL);
+    if (SUCCEEDED(hr) && ppSB && *ppSB)
+        new MyIDirect3DStateBlock9(ppSB, this, &impl->state_filter, &impl->draw_binds);
+    return hr;
 }
 
 HRESULT MyID3D9Device::SetClipStatus(const D3DCLIPSTATUS9* clip_status) {
@@ -4696,7 +4888,16 @@ HRESULT MyID3D9Device::GetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYP
 }
 
 HRESULT MyID3D9Device::SetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value) {
-    return impl->inner->SetTextureStageState(Stage, Type, Value);
+    const bool forward = ZeroMod::sf_tss(impl->state_filter, Stage, Type, Value);
+    if (impl->call_rec && !impl->state_filter.recording)
+        ZeroMod::cr_state(impl->call_rec, ZeroMod::ZM_CR_OP_SET_TSS, Stage, Type, Value, forward);
+    if (!forward)
+        return D3D_OK;
+
+    HRESULT hr = impl->inner->SetTextureStageState(Stage, Type, Value);
+    if (FAILED(hr))
+        ZeroMod::sf_invalidate(impl->state_filter);
+    return hr;
 }
 
 HRESULT MyID3D9Device::GetSamplerState(DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD* pValue) {
@@ -4776,7 +4977,10 @@ HRESULT MyID3D9Device::GetFVF(DWORD* pFVF) {
 }
 
 HRESULT MyID3D9Device::CreateVertexShader(const DWORD* byte_code, IDirect3DVertexShader9** shader) {
-    return impl->inner->CreateVertexShader(byte_code, shader);
+    HRESULT hr = impl->inner->CreateVertexShader(byte_code, shader);
+    if (SUCCEEDED(hr) && impl->call_rec && shader && *shader)
+        ZeroMod::cr_shader(impl->call_rec, *shader, ZeroMod::ZM_CR_SHADER_VS, byte_code);
+    return hr;
 }
 
 HRESULT MyID3D9Device::GetVertexShader(IDirect3DVertexShader9** ppShader) {
@@ -4875,6 +5079,8 @@ HRESULT MyID3D9Device::CreatePixelShader(
     inner_ps = nullptr;
 
     *shader = (IDirect3DPixelShader9*)wrap;
+    if (impl->call_rec)
+        ZeroMod::cr_shader(impl->call_rec, wrap, ZeroMod::ZM_CR_SHADER_PS, byte_code);
     return hr;
 }
 
@@ -0,0 +1,93 @@
+#include "d3d9stateblock.h"
+#include "log.h"
+#include "globals.h"
+
+#define LOG_MFUN(...) LOG_MFUN_DEF(MyIDirect3DStateBlock9, __VA_ARGS__)
+
+class MyIDirect3DStateBlock9::Impl {
+public:
+    IDirect3DStateBlock9* inner;
+    IDirect3DDevice9* device;               // the proxy device, referenced
+    ZeroMod::zm_state_filter* filter;       // both live in the device's Impl
+    ZeroMod::zm_draw_binds* binds;
+    LONG refs;
+
+    Impl(IDirect3DStateBlock9* in, IDirect3DDevice9* dev, ZeroMod::zm_state_filter* sf, ZeroMod::zm_draw_binds* db)
+        : inner(in), device(dev), filter(sf), binds(db), refs(1) {
+        if (device)
+            device->AddRef();
+    }
+};
+
+MyIDirect3DStateBlock9::MyIDirect3DStateBlock9(IDirect3DStateBlock9** inner, IDirect3DDevice9* device,
+    ZeroMod::zm_state_filter* filter, ZeroMod::zm_draw_binds* binds)
+    : impl(new Impl(*inner, device, filter, binds))
+{
+    *inner = this;
+}
+
+MyIDirect3DStateBlock9::~MyIDirect3DStateBlock9()
+{
+    if (impl->inner)
+        impl->inner->Release();
+    if (impl->device)
+        impl->device->Release();
+    delete impl;
+}
+
+HRESULT STDMETHODCALLTYPE MyIDirect3DStateBlock9::QueryInterface(REFIID riid, void** ppvObject) {
+    LOG_MFUN("QueryInterface", LOG_ARG(riid), LOG_ARG(ppvObject));
+    if (!ppvObject)
+        return E_POINTER;
+    if (riid == IID_IUnknown || riid == IID_IDirect3DStateBlock9) {
+        AddRef();
+        *ppvObject = this;
+        return S_OK;
+    }
+    *ppvObject = nullptr;
+    return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE MyIDirect3DStateBlock9::AddRef() {
+    LOG_MFUN("AddRef");
+    return (ULONG)InterlockedIncrement(&impl->refs);
+}
+
+ULONG STDMETHODCALLTYPE MyIDirect3DStateBlock9::Release() {
+    LOG_MFUN("Release");
+    ULONG refs = (ULONG)InterlockedDecrement(&impl->refs);
+    if (refs == 0)
+        delete this;
+    return refs;
+}
+
+HRESULT STDMETHODCALLTYPE MyIDirect3DStateBlock9::GetDevice(IDirect3DDevice9** ppDevice) {
+    LOG_MFUN("GetDevice", LOG_ARG(ppDevice));
+    if (!ppDevice)
+        return D3DERR_INVALIDCALL;
+    *ppDevice = impl->device;
+    if (impl->device)
+        impl->device->AddRef();
+    return impl->device ? D3D_OK : D3DERR_INVALIDCALL;
+}
+
+HRESULT STDMETHODCALLTYPE MyIDirect3DStateBlock9::Capture() {
+    LOG_MFUN("Capture");
+    return impl->inner->Capture();
+}
+
+HRESULT STDMETHODCALLTYPE MyIDirect3DStateBlock9::Apply() {
+    LOG_MFUN("Apply");
+    HRESULT hr = impl->inner->Apply();
+    // The block may hold any subset of states; don't try to track which.
+    if (impl->filter)
+        ZeroMod::sf_invalidate(*impl->filter);
+    // Blocks capture textures and the viewport, not render targets
+    if (impl->binds)
+        ZeroMod::db_invalidate(*impl->binds, ZeroMod::ZM_DB_TEX0 | ZeroMod::ZM_DB_VP);
+    return hr;
+}
+
+IDirect3DStateBlock9*& MyIDirect3DStateBlock9::get_inner() {
+    return impl->inner;
+}
@@ -0,0 +1,34 @@
+#ifndef D3D9STATEBLOCK_H
+#define D3D9STATEBLOCK_H
+
+#include <d3d9.h>
+#include "state_filter.h"
+#include "draw_binds.h"
+
+// Wraps the game's state blocks so Apply() can invalidate the device's
+// redundant-state filter and draw bindings; the driver changes state
+// behind the proxy there.
+class MyIDirect3DStateBlock9 : public IDirect3DStateBlock9 {
+    class Impl;
+    Impl* impl;
+
+public:
+    // Takes over the reference in *inner and replaces it with the wrapper.
+    MyIDirect3DStateBlock9(IDirect3DStateBlock9** inner, IDirect3DDevice9* device,
+        ZeroMod::zm_state_filter* filter, ZeroMod::zm_draw_binds* binds);
+    virtual ~MyIDirect3DStateBlock9();
+
+    // COM interface methods
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override;
+    ULONG STDMETHODCALLTYPE AddRef() override;
+    ULONG STDMETHODCALLTYPE Release() override;
+
+    // IDirect3DStateBlock9 methods
+    HRESULT STDMETHODCALLTYPE GetDevice(IDirect3DDevice9** ppDevice) override;
+    HRESULT STDMETHODCALLTYPE Capture() override;
+    HRESULT STDMETHODCALLTYPE Apply() override;
+
+    IDirect3DStateBlock9*& get_inner();
+};
+
+#endif // D3D9STATEBLOCK_H
@@ -11,6 +11,7 @@
 #include <cstdlib>
 #include <cstdio>
 #include "slang_d3d9_preset_load.h"
+#include "slang_d3d9_async.h"
 
 namespace ZeroMod {
 
@@ -29,39 +30,14 @@ namespace ZeroMod {
         d3d9->final_viewport.Width = 4;
         d3d9->final_viewport.Height = 4;
         d3d9->slang_rt = nullptr;
+        d3d9->slang_job = nullptr;
         d3d9->shader_path = nullptr;
         d3d9->shader_preset = false;
         d3d9->shader_reload_pending = false;
         d3d9->shader_is_path = false;
 
-        zm_slang_vertex vertices[4] = {
-            { -1,  1, 0, 1,   0,0 }, // TL
-            { -1, -1, 0, 1,   0,1 }, // BL
-            {  1,  1, 0, 1,   1,0 }, // TR
-            {  1, -1, 0, 1,   1,1 }, // BR
-        };
-
-        // Initialize vertex buffer
-        if (FAILED(d3d9->dev->CreateVertexBuffer(sizeof(vertices), 0, 0, D3DPOOL_MANAGED, &d3d9->frame_vbo, NULL))) {
-            d3d9_gfx_free(d3d9);
-            return NULL;
-        }
-
-        void* pVertices = nullptr; // Initialize pVertices
-        if (FAILED(d3d9->frame_vbo->Lock(0, sizeof(vertices), (void**)&pVertices, 0))) {
-            d3d9_gfx_free(d3d9);
-            return NULL;
-        }
-        memcpy(pVertices, vertices, sizeof(vertices));
-        d3d9->frame_vbo->Unlock();
-
-        D3DVERTEXELEMENT9 decl[] = {
-            { 0,  0, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 },
-            { 0, 16, D3DDECLTYPE_FLOAT2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 1 },
-            D3DDECL_END()
-        };
-
-        if (!d3d9_vertex_declaration_new(d3d9->dev, decl, (void**)&d3d9->vertex_decl)) {
+        // Static fullscreen quad + blit VS, written once
+        if (!quad_create(d3d9->dev, d3d9->quad)) {
             d3d9_gfx_free(d3d9);
             return NULL;
         }
@@ -80,18 +56,15 @@ namespace ZeroMod {
             return;
         }
 
+        // worker frees the job itself once it notices
+        slang_d3d9_async_cancel(d3d9);
+
         d3d9->magic = 0;
 
-        IDirect3DVertexBuffer9* vb = d3d9->frame_vbo;
-        IDirect3DVertexDeclaration9* vd = d3d9->vertex_decl;
         IDirect3DPixelShader9* ps = d3d9->pixel_shader;
-
-        d3d9->frame_vbo = nullptr;
-        d3d9->vertex_decl = nullptr;
         d3d9->pixel_shader = nullptr;
 
-        if (vb) vb->Release();
-        if (vd) vd->Release();
+        quad_release(d3d9->quad);
         if (ps) ps->Release();
 
         if (d3d9->shader_path) {
@@ -113,6 +86,11 @@ namespace ZeroMod {
         if (!d3d9 || d3d9->magic != 0x39564433)
             return false;
 
+#if ZM_SLANG_ASYNC_COMPILE
+        // frame boundary: swap in a chain the worker finished
+        slang_d3d9_async_poll(d3d9);
+#endif
+
         if (!d3d9->shader_reload_pending)
             return true;
 
@@ -125,11 +103,19 @@ namespace ZeroMod {
         {
             OutputDebugStringA("[ZeroMod] d3d9_gfx_frame: slang preset reload pending\n");
 
+#if ZM_SLANG_ASYNC_COMPILE
+            // Parse + compile off-thread; current chain keeps drawing until the swap
+            ok = ZeroMod::slang_d3d9_async_begin(d3d9);
+
+            if (!ok)
+                OutputDebugStringA("[ZeroMod] d3d9_gfx_frame: slang async compile failed to start\n");
+#else
             // Parse-only for now (no runtime compilation/binds yet)
             ok = ZeroMod::slang_d3d9_load_preset_parse_only(d3d9);
 
             if (!ok)
                 OutputDebugStringA("[ZeroMod] d3d9_gfx_frame: slang preset parse failed\n");
+#endif
         }
 
         // IMPORTANT: do not let any failure keep this set, or it will hard-loop reload attempts.
@@ -236,6 +222,7 @@ namespace ZeroMod {
         if (!shader_source || !*shader_source) {
             OutputDebugStringA("[ZeroMod] d3d9_gfx_set_shader: clearing shader\n");
             zm_set_shader_path(d3d9, nullptr);
+            slang_d3d9_async_cancel(d3d9);
 
             return true;
         }
@@ -2,6 +2,7 @@
 #define D3D9VIDEO_H
 
 #include "d3d9_common.h"
+#include "quad.h"
 #include "../RetroArch/RetroArch/libretro-common/include/gfx/math/matrix_4x4.h"
 #ifdef __cplusplus
 #include <string>
@@ -10,10 +11,7 @@
 
 namespace ZeroMod {
 
-    struct zm_slang_vertex {
-        float x, y, z, w;  // TEXCOORD0 (Position)
-        float u, v;        // TEXCOORD1 (TexCoord)
-    };
+    struct zm_job;
 
     struct video_viewport_t {
         int x;
@@ -47,6 +45,7 @@ namespace ZeroMod {
         UINT quad_h = 0;
 
         void* slang_rt;
+        zm_job* slang_job;  // in-flight background compile (slang_d3d9_async)
 
         unsigned cur_mon_id;
         unsigned dev_rotation;
@@ -107,8 +106,7 @@ namespace ZeroMod {
         size_t overlays_size;
         overlay_t* overlays;
 
-        LPDIRECT3DVERTEXBUFFER9 frame_vbo;
-        LPDIRECT3DVERTEXDECLARATION9 vertex_decl;
+        zm_quad quad;
         IDirect3DPixelShader9* pixel_shader;
           
         zm_zero_stage_rt zero_pre = { nullptr, nullptr, 0, 0 };
@@ -0,0 +1,277 @@
+#include "draw_binds.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace ZeroMod {
+
+    static unsigned res_hash(const void* key, unsigned mask)
+    {
+        // COM objects are at least 8-byte aligned; fold the high bits in
+        uint64_t k = (uint64_t)(uintptr_t)key;
+        k ^= k >> 17;
+        k *= 0x9E3779B97F4A7C15ull;
+        return (unsigned)(k >> 32) & mask;
+    }
+
+    // {5A4D5253-7472-6B00-9E37-79B97F4A7C15}
+    static const GUID ZM_RES_TRACKER_GUID =
+        { 0x5a4d5253, 0x7472, 0x6b00, { 0x9e, 0x37, 0x79, 0xb9, 0x7f, 0x4a, 0x7c, 0x15 } };
+
+    // One reference from the table entry, one from the texture's private
+    // data until the texture goes away
+    struct zm_res_tracker final : IUnknown
+    {
+        volatile LONG refs = 1;
+
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** out) override
+        {
+            if (!out)
+                return E_POINTER;
+            if (riid == IID_IUnknown) {
+                AddRef();
+                *out = this;
+                return S_OK;
+            }
+            *out = nullptr;
+            return E_NOINTERFACE;
+        }
+        ULONG STDMETHODCALLTYPE AddRef() override { return (ULONG)InterlockedIncrement(&refs); }
+        ULONG STDMETHODCALLTYPE Release() override
+        {
+            const LONG r = InterlockedDecrement(&refs);
+            if (r == 0)
+                delete this;
+            return (ULONG)r;
+        }
+    };
+
+    static bool res_alive(const zm_res_desc& e)
+    {
+        return e.tracker && e.tracker->refs > 1;
+    }
+
+    static void res_drop(zm_res_desc& e)
+    {
+        if (e.tracker)
+            e.tracker->Release();
+        e.tracker = nullptr;
+    }
+
+    static void res_clear(zm_res_table& rt)
+    {
+        for (unsigned i = 0; i < rt.cap; ++i)
+            res_drop(rt.slots[i]);
+        if (rt.slots)
+            memset(rt.slots, 0, rt.cap * sizeof(zm_res_desc));
+        rt.count = 0;
+    }
+
+    static const zm_res_desc* res_find(const zm_res_table& rt, const void* key)
+    {
+        if (!rt.cap || !key)
+            return nullptr;
+
+        const unsigned mask = rt.cap - 1;
+        unsigned h = res_hash(key, mask);
+        while (rt.slots[h].key) {
+            if (rt.slots[h].key == key)
+                return &rt.slots[h];
+            h = (h + 1) & mask;
+        }
+        return nullptr;
+    }
+
+    static bool res_grow(zm_res_table& rt)
+    {
+        const unsigned cap = rt.cap ? rt.cap * 2 : 1024;
+        zm_res_desc* slots = (zm_res_desc*)calloc(cap, sizeof(zm_res_desc));
+        if (!slots)
+            return false;
+
+        for (unsigned i = 0; i < rt.cap; ++i) {
+            const zm_res_desc& e = rt.slots[i];
+            if (!e.key)
+                continue;
+            unsigned h = res_hash(e.key, cap - 1);
+            while (slots[h].key)
+                h = (h + 1) & (cap - 1);
+            slots[h] = e;
+        }
+
+        free(rt.slots);
+        rt.slots = slots;
+        rt.cap = cap;
+        return true;
+    }
+
+    void res_put(zm_res_table& rt, IDirect3DBaseTexture9* tex, UINT width, UINT height, D3DFORMAT format, uint8_t kind)
+    {
+        if (!tex)
+            return;
+        const void* key = tex;
+
+        // Replaces (and releases) a tracker an earlier entry put there
+        zm_res_tracker* tracker = new zm_res_tracker();
+        if (FAILED(tex->SetPrivateData(ZM_RES_TRACKER_GUID, static_cast<IUnknown*>(tracker), sizeof(IUnknown*), D3DSPD_IUNKNOWN))) {
+            tracker->Release();
+            tracker = nullptr;
+        }
+
+        // Addresses of released textures pile up; start over rather than grow forever
+        if (rt.count >= ZM_RES_TABLE_MAX)
+            res_clear(rt);
+        if ((rt.count + 1) * 4 > rt.cap * 3 && !res_grow(rt)) {
+            if (tracker)
+                tracker->Release();
+            return;
+        }
+
+        const unsigned mask = rt.cap - 1;
+        unsigned h = res_hash(key, mask);
+        while (rt.slots[h].key && rt.slots[h].key != key)
+            h = (h + 1) & mask;
+
+        zm_res_desc& e = rt.slots[h];
+        if (!e.key)
+            rt.count++;
+        res_drop(e);
+        e.key = key;
+        e.width = width;
+        e.height = height;
+        e.format = format;
+        e.kind = kind;
+        // Without a tracker the entry can't be trusted; it stays as a
+        // placeholder and is described again on every lookup
+        e.tracker = tracker;
+    }
+
+    void res_free(zm_res_table& rt)
+    {
+        res_clear(rt);
+        free(rt.slots);
+        rt.slots = nullptr;
+        rt.cap = 0;
+        rt.count = 0;
+    }
+
+    const zm_res_desc* res_texture_desc(zm_res_table& rt, IDirect3DBaseTexture9* tex)
+    {
+        if (!tex)
+            return nullptr;
+        const zm_res_desc* e = res_find(rt, tex);
+        if (e && res_alive(*e))
+            return e;
+
+        // Not created through the proxy, or a new texture where a released
+        // one was: describe it now
+        zm_res_desc d = {};
+        d.key = tex;
+        d.kind = ZM_RES_OTHER;
+        d.format = D3DFMT_UNKNOWN;
+        IDirect3DTexture9* t2d = nullptr;
+        if (SUCCEEDED(tex->QueryInterface(IID_IDirect3DTexture9, (void**)&t2d)) && t2d) {
+            D3DSURFACE_DESC sd = {};
+            const HRESULT hr = t2d->GetLevelDesc(0, &sd);
+            t2d->Release();
+            if (FAILED(hr))
+                return nullptr;
+            d.width = sd.Width;
+            d.height = sd.Height;
+            d.format = sd.Format;
+            d.kind = ZM_RES_TEX2D;
+        }
+        res_put(rt, tex, d.width, d.height, d.format, d.kind);
+
+        e = res_find(rt, tex);
+        if (e && res_alive(*e))
+            return e;
+        rt.scratch = d;
+        return &rt.scratch;
+    }
+
+    void db_set_rt0(zm_draw_binds& db, IDirect3DSurface9* rt0)
+    {
+        D3DSURFACE_DESC d = {};
+        if (!rt0 || FAILED(rt0->GetDesc(&d))) {
+            db_invalidate(db, ZM_DB_RT0 | ZM_DB_VP);
+            return;
+        }
+
+        db.rt0 = rt0;
+        db.rt0_w = d.Width;
+        db.rt0_h = d.Height;
+
+        // SetRenderTarget(0) resets the viewport to the full target
+        db.vp.X = 0;
+        db.vp.Y = 0;
+        db.vp.Width = d.Width;
+        db.vp.Height = d.Height;
+        db.vp.MinZ = 0.0f;
+        db.vp.MaxZ = 1.0f;
+        db.known |= ZM_DB_RT0 | ZM_DB_VP;
+    }
+
+    void db_set_tex0(zm_draw_binds& db, zm_res_table& rt, IDirect3DBaseTexture9* tex)
+    {
+        db.tex0 = tex;
+        db.tex0_2d = nullptr;
+        db.tex0_w = 0;
+        db.tex0_h = 0;
+
+        const zm_res_desc* e = res_texture_desc(rt, tex);
+        if (e && e->kind == ZM_RES_TEX2D) {
+            // single inheritance: the base pointer is the texture
+            db.tex0_2d = static_cast<IDirect3DTexture9*>(tex);
+            db.tex0_w = e->width;
+            db.tex0_h = e->height;
+        }
+        db.known |= ZM_DB_TEX0;
+    }
+
+    void db_set_viewport(zm_draw_binds& db, const D3DVIEWPORT9& vp)
+    {
+        db.vp = vp;
+        db.known |= ZM_DB_VP;
+    }
+
+    void db_sync(zm_draw_binds& db, zm_res_table& rt, IDirect3DDevice9* dev)
+    {
+#if !ZM_DRAW_BINDS
+        db.known = 0;
+#endif
+        if (!dev || db.known == ZM_DB_ALL)
+            return;
+
+        if (!(db.known & ZM_DB_RT0)) {
+            IDirect3DSurface9* rt0 = nullptr;
+            db.rt0 = nullptr;
+            db.rt0_w = db.rt0_h = 0;
+            if (SUCCEEDED(dev->GetRenderTarget(0, &rt0)) && rt0) {
+                D3DSURFACE_DESC d = {};
+                if (SUCCEEDED(rt0->GetDesc(&d))) {
+                    db.rt0 = rt0;
+                    db.rt0_w = d.Width;
+                    db.rt0_h = d.Height;
+                }
+                rt0->Release();
+            }
+            db.known |= ZM_DB_RT0;
+        }
+
+        if (!(db.known & ZM_DB_TEX0)) {
+            IDirect3DBaseTexture9* tex = nullptr;
+            dev->GetTexture(0, &tex);
+            db_set_tex0(db, rt, tex);
+            if (tex)
+                tex->Release();
+        }
+
+        if (!(db.known & ZM_DB_VP)) {
+            D3DVIEWPORT9 vp = {};
+            dev->GetViewport(&vp);
+            db_set_viewport(db, vp);
+        }
+    }
+
+} // namespace ZeroMod
@@ -0,0 +1,93 @@
+#pragma once
+#include <d3d9.h>
+#include <stdint.h>
+
+// ---- Proxy-side draw bindings ----
+// DrawPrimitive's classification (flash kill, swallow, latch, game rect)
+// needs the RT0 size, the stage 0 texture size and the viewport on every
+// strip draw. Instead of Get*/QueryInterface/GetLevelDesc round-trips per
+// draw, the proxy mirrors those bindings from its own Set* entry points
+// and looks texture sizes up in a descriptor table filled at creation.
+// Anything that sets them behind the proxy invalidates the mirror; the
+// next draw re-reads just the invalid parts from the device.
+// Set ZM_DRAW_BINDS to 0 to re-read everything on every draw.
+#define ZM_DRAW_BINDS 1
+
+// Descriptor table entries before it is dropped and refilled lazily
+#define ZM_RES_TABLE_MAX 16384
+
+namespace ZeroMod {
+
+    enum : uint8_t {
+        ZM_RES_NONE = 0,
+        ZM_RES_TEX2D,       // IDirect3DTexture9, level 0 size
+        ZM_RES_OTHER,       // cube/volume: not a 2D match for anything
+    };
+
+    struct zm_res_tracker;
+
+    struct zm_res_desc
+    {
+        const void* key;
+        UINT width;
+        UINT height;
+        D3DFORMAT format;
+        uint8_t kind;       // ZM_RES_*
+        zm_res_tracker* tracker;
+    };
+
+    // Open-addressed, keyed by the texture pointer. Each entry's texture
+    // carries a tracker as IUnknown private data; the runtime releases it
+    // when the texture is destroyed, so an entry whose tracker nobody else
+    // holds is for a dead texture and is described again. That covers
+    // textures made behind the proxy (slang targets, LUTs, filter temps,
+    // the CPU scaler ring) landing on a released texture's address.
+    struct zm_res_table
+    {
+        zm_res_desc* slots;
+        unsigned cap;       // power of two (0 = not allocated)
+        unsigned count;
+        zm_res_desc scratch; // a texture that refused the tracker, not kept
+    };
+
+    void res_put(zm_res_table& rt, IDirect3DBaseTexture9* tex, UINT width, UINT height, D3DFORMAT format, uint8_t kind);
+    void res_free(zm_res_table& rt);
+
+    // Table lookup; a miss or a dead entry is described from the texture
+    // and recorded.
+    const zm_res_desc* res_texture_desc(zm_res_table& rt, IDirect3DBaseTexture9* tex);
+
+    enum : uint32_t {
+        ZM_DB_RT0 = 1u << 0,
+        ZM_DB_TEX0 = 1u << 1,
+        ZM_DB_VP = 1u << 2,
+        ZM_DB_ALL = ZM_DB_RT0 | ZM_DB_TEX0 | ZM_DB_VP,
+    };
+
+    // What the device has bound; pointers are not referenced (the device
+    // holds them while they are bound).
+    struct zm_draw_binds
+    {
+        uint32_t known;             // ZM_DB_*
+
+        IDirect3DSurface9* rt0;
+        UINT rt0_w, rt0_h;
+
+        IDirect3DBaseTexture9* tex0;
+        IDirect3DTexture9* tex0_2d; // tex0 when it is a 2D texture, else null
+        UINT tex0_w, tex0_h;
+
+        D3DVIEWPORT9 vp;
+    };
+
+    // Call after the device accepted the Set*
+    void db_set_rt0(zm_draw_binds& db, IDirect3DSurface9* rt0);    // also resets the viewport
+    void db_set_tex0(zm_draw_binds& db, zm_res_table& rt, IDirect3DBaseTexture9* tex);
+    void db_set_viewport(zm_draw_binds& db, const D3DVIEWPORT9& vp);
+
+    inline void db_invalidate(zm_draw_binds& db, uint32_t what) { db.known &= ~what; }
+
+    // Re-read whatever isn't known from the device
+    void db_sync(zm_draw_binds& db, zm_res_table& rt, IDirect3DDevice9* dev);
+
+} // namespace ZeroMod
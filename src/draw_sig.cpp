@@ -0,0 +1,166 @@
+#include "draw_sig.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+namespace ZeroMod {
+
+    const zm_draw_sig k_draw_sigs[ZM_DS_COUNT] = {
+        // ZM_DS_PRE_WANT_COMPOSITE
+        { "pre_want_composite",
+          ZM_DK_STRIP_QUAD | ZM_DK_RT_COMPOSITE,
+          ZM_DK_WANTED },
+        // ZM_DS_COMPOSITE_FULL
+        { "composite_full",
+          ZM_DK_STRIP_QUAD | ZM_DK_WANTED | ZM_DK_SRC_TEX | ZM_DK_RT_COMPOSITE | ZM_DK_VP_FULL_RT,
+          0 },
+        // ZM_DS_SWALLOW_GAME_LAYER
+        { "swallow_game_layer",
+          ZM_DK_STRIP_QUAD | ZM_DK_WANTED | ZM_DK_SRC_TEX | ZM_DK_RT_COMPOSITE | ZM_DK_VP_FULL_RT |
+          ZM_DK_T0_2D | ZM_DK_T0_GAME_LAYER,
+          0 },
+        // ZM_DS_LATCH_COMPOSITE
+        { "latch_composite",
+          ZM_DK_STRIP_QUAD | ZM_DK_WANTED | ZM_DK_CHAIN | ZM_DK_SRC_TEX | ZM_DK_T0_2D | ZM_DK_T0_COMPOSITE,
+          0 },
+        // ZM_DS_LATCH_EXPIRE
+        { "latch_expire",
+          ZM_DK_STRIP_QUAD | ZM_DK_WANTED | ZM_DK_CHAIN | ZM_DK_SRC_TEX | ZM_DK_LATCHED | ZM_DK_LATCH_STALE,
+          0 },
+        // ZM_DS_GAME_RECT_4_3 / _3_2: a subset of latch_composite, so the
+        // latch is always fresh on these draws (no ZM_DK_LATCHED test)
+        { "game_rect_4_3",
+          ZM_DK_STRIP_QUAD | ZM_DK_WANTED | ZM_DK_CHAIN | ZM_DK_SRC_TEX |
+          ZM_DK_RT_BACKBUFFER | ZM_DK_T0_2D | ZM_DK_T0_COMPOSITE | ZM_DK_VP_SUBRECT | ZM_DK_VP_4_3,
+          0 },
+        { "game_rect_3_2",
+          ZM_DK_STRIP_QUAD | ZM_DK_WANTED | ZM_DK_CHAIN | ZM_DK_SRC_TEX |
+          ZM_DK_RT_BACKBUFFER | ZM_DK_T0_2D | ZM_DK_T0_COMPOSITE | ZM_DK_VP_SUBRECT | ZM_DK_VP_3_2,
+          0 },
+        // ZM_DS_LEGACY
+        { "legacy",
+          ZM_DK_STRIP_QUAD,
+          ZM_DK_WANTED },
+    };
+
+    static bool ds_is_4_3(uint32_t w, uint32_t h)
+    {
+        return w && h && (w * 3 == h * 4);
+    }
+
+    static bool ds_is_3_2(uint32_t w, uint32_t h)
+    {
+        if (!w || !h) return false;
+
+        // 3:2 => w*2 == h*3, with tiny tolerance for rounding
+        const uint64_t lhs = (uint64_t)w * 2ull;
+        const uint64_t rhs = (uint64_t)h * 3ull;
+        const uint64_t diff = (lhs > rhs) ? (lhs - rhs) : (rhs - lhs);
+        return diff <= 8;
+    }
+
+    uint32_t ds_bind_key(const zm_draw_bind_state& s)
+    {
+        uint32_t key = ZM_DK_STRIP_QUAD;
+        if (s.rt0) {
+            if (s.rt0_w == 1280 && s.rt0_h == 960)
+                key |= ZM_DK_RT_COMPOSITE;
+            if (s.rt0_w == s.bb_w && s.rt0_h == s.bb_h)
+                key |= ZM_DK_RT_BACKBUFFER;
+
+            const bool vp_full = (s.vp_x == 0 && s.vp_y == 0 && s.vp_w == s.rt0_w && s.vp_h == s.rt0_h);
+            if (vp_full)
+                key |= ZM_DK_VP_FULL_RT;
+            if (s.vp_w > 0 && s.vp_h > 0 &&
+                s.vp_w <= s.rt0_w && s.vp_h <= s.rt0_h && !vp_full)
+                key |= ZM_DK_VP_SUBRECT;
+            if (ds_is_4_3(s.vp_w, s.vp_h))
+                key |= ZM_DK_VP_4_3;
+            if (ds_is_3_2(s.vp_w, s.vp_h))
+                key |= ZM_DK_VP_3_2;
+        }
+        if (s.tex0_2d)
+            key |= ZM_DK_T0_2D;
+        if (s.tex0_w == 512 && s.tex0_h == 384)
+            key |= ZM_DK_T0_GAME_LAYER;
+        if (s.tex0_w == 1280 && s.tex0_h == 960)
+            key |= ZM_DK_T0_COMPOSITE;
+        return key;
+    }
+
+    bool ds_compile(zm_draw_matcher& m, const zm_draw_sig* sigs, uint32_t count)
+    {
+        if (!sigs || count > 32)
+            return false;
+
+        memset(m.slice, 0, sizeof(m.slice));
+        for (uint32_t r = 0; r < count; ++r) {
+            // Requires and forbids the same bit: never matches
+            if (sigs[r].require & sigs[r].forbid)
+                continue;
+            for (int s = 0; s < 4; ++s) {
+                const uint32_t req = (sigs[r].require >> (s * 8)) & 0xFF;
+                const uint32_t care = ((sigs[r].require | sigs[r].forbid) >> (s * 8)) & 0xFF;
+                for (uint32_t b = 0; b < 256; ++b) {
+                    if ((b & care) == req)
+                        m.slice[s][b] |= 1u << r;
+                }
+            }
+        }
+
+        m.sigs = sigs;
+        m.count = count;
+        m.compiled = true;
+        return true;
+    }
+
+    uint32_t ds_match_count(zm_draw_matcher& m, uint32_t key)
+    {
+        const uint32_t hit = ds_match(m, key);
+        m.draws++;
+        for (uint32_t h = hit; h; h &= h - 1) {
+            uint32_t r = 0;
+            while (!(h & (1u << r)))
+                ++r;
+            m.hits[r]++;
+        }
+        return hit;
+    }
+
+    uint64_t ds_now_ns()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void ds_add_time(zm_draw_matcher& m, uint64_t ns)
+    {
+        m.timed++;
+        m.timed_ns += ns;
+    }
+
+    size_t ds_format_stats(const zm_draw_matcher& m, char* out, size_t cap)
+    {
+        if (!out || !cap)
+            return 0;
+
+        size_t n = 0;
+        int w = snprintf(out, cap, "[ZeroMod] draw sigs: %llu draws, %.0f ns/draw (key+match, %llu sampled)\n",
+            (unsigned long long)m.draws,
+            m.timed ? (double)m.timed_ns / (double)m.timed : 0.0,
+            (unsigned long long)m.timed);
+        if (w > 0)
+            n = ((size_t)w < cap) ? (size_t)w : cap - 1;
+
+        for (uint32_t r = 0; r < m.count && n + 1 < cap; ++r) {
+            w = snprintf(out + n, cap - n, "[ZeroMod]   %-20s %llu\n",
+                m.sigs[r].name, (unsigned long long)m.hits[r]);
+            if (w <= 0)
+                break;
+            n += ((size_t)w < cap - n) ? (size_t)w : cap - n - 1;
+        }
+        return n;
+    }
+
+} // namespace ZeroMod
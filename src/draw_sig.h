@@ -0,0 +1,121 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ---- Draw signature matcher ----
+// DrawPrimitive's interception tests are expressed as a table of draw
+// signatures over a packed per-draw key (one bit per predicate). Each
+// signature lists the key bits it requires set and the bits it requires
+// clear. ds_compile turns the table into four 256-entry byte-slice
+// tables, so matching every signature at once is four loads and three
+// ANDs with no branches. No D3D types in here: keys can be captured and
+// replayed against the matcher on any platform.
+// Log per-signature hit counts every N matched draws (0 = never)
+#define ZM_DRAW_SIG_STATS_INTERVAL 20000
+// Time one draw in N (key build + match) for the stats line
+#define ZM_DRAW_SIG_TIME_SAMPLE 64
+// Draws a composite latch stays valid for before it is dropped
+#define ZM_DRAW_SIG_LATCH_WINDOW 400
+
+#define ZM_DS_BIT(rule) (1u << (rule))
+
+namespace ZeroMod {
+
+    // Per-draw key bits
+    enum : uint32_t {
+        ZM_DK_STRIP_QUAD = 1u << 0,     // D3DPT_TRIANGLESTRIP, 2 primitives
+        ZM_DK_RT_COMPOSITE = 1u << 1,   // RT0 is 1280x960
+        ZM_DK_RT_BACKBUFFER = 1u << 2,  // RT0 matches the backbuffer size
+        ZM_DK_T0_2D = 1u << 3,          // stage 0 holds a 2D texture
+        ZM_DK_T0_GAME_LAYER = 1u << 4,  // stage 0 is 512x384
+        ZM_DK_T0_COMPOSITE = 1u << 5,   // stage 0 is 1280x960
+        ZM_DK_VP_FULL_RT = 1u << 6,     // viewport covers RT0 exactly
+        ZM_DK_VP_SUBRECT = 1u << 7,     // non-empty, inside RT0, not all of it
+        ZM_DK_VP_4_3 = 1u << 8,
+        ZM_DK_VP_3_2 = 1u << 9,
+        ZM_DK_WANTED = 1u << 10,        // a game-rect chain is armed
+        ZM_DK_CHAIN = 1u << 11,
+        ZM_DK_SRC_TEX = 1u << 12,
+        ZM_DK_LATCHED = 1u << 13,       // composite fingerprint seen
+        ZM_DK_LATCH_STALE = 1u << 14,   // ... more than ZM_DRAW_SIG_LATCH_WINDOW draws ago
+
+        // The bits ds_bind_key decides
+        ZM_DK_BIND_MASK = ZM_DK_STRIP_QUAD | ZM_DK_RT_COMPOSITE | ZM_DK_RT_BACKBUFFER |
+            ZM_DK_T0_2D | ZM_DK_T0_GAME_LAYER | ZM_DK_T0_COMPOSITE |
+            ZM_DK_VP_FULL_RT | ZM_DK_VP_SUBRECT | ZM_DK_VP_4_3 | ZM_DK_VP_3_2,
+    };
+
+    // Signatures, in the order DrawPrimitive acts on them
+    enum : uint32_t {
+        ZM_DS_PRE_WANT_COMPOSITE = 0,   // flash-kill candidate
+        ZM_DS_COMPOSITE_FULL,           // full-viewport draw into the composite
+        ZM_DS_SWALLOW_GAME_LAYER,       // game layer -> composite blit
+        ZM_DS_LATCH_COMPOSITE,          // composite sampled: latch it
+        ZM_DS_LATCH_EXPIRE,
+        ZM_DS_GAME_RECT_4_3,            // run the chain into the game rect
+        ZM_DS_GAME_RECT_3_2,
+        ZM_DS_LEGACY,                   // Impl::Draw filter path
+        ZM_DS_COUNT
+    };
+
+    struct zm_draw_sig
+    {
+        const char* name;
+        uint32_t require;               // key bits that must be set
+        uint32_t forbid;                // key bits that must be clear
+    };
+
+    extern const zm_draw_sig k_draw_sigs[ZM_DS_COUNT];
+
+    // What a strip quad's binding bits are worked out from
+    struct zm_draw_bind_state
+    {
+        bool rt0;                       // an RT0 is bound
+        uint32_t rt0_w, rt0_h;
+        uint32_t bb_w, bb_h;            // backbuffer
+        uint32_t vp_x, vp_y, vp_w, vp_h;
+        bool tex0_2d;
+        uint32_t tex0_w, tex0_h;
+    };
+
+    // The ZM_DK_BIND_MASK part of a strip quad's key; the caller ORs in the
+    // chain/latch bits. Shared with the replay tool so both build it the same way.
+    uint32_t ds_bind_key(const zm_draw_bind_state& s);
+
+    struct zm_draw_matcher
+    {
+        bool compiled;
+        const zm_draw_sig* sigs;
+        uint32_t count;
+        uint32_t slice[4][256];         // byte value -> signatures it allows
+
+        // stats
+        uint64_t hits[32];
+        uint64_t draws;
+        uint64_t timed;
+        uint64_t timed_ns;
+    };
+
+    // sigs: at most 32 entries; one that requires and forbids the same bit never matches
+    bool ds_compile(zm_draw_matcher& m, const zm_draw_sig* sigs, uint32_t count);
+
+    // Bit i set = sigs[i] matches key
+    inline uint32_t ds_match(const zm_draw_matcher& m, uint32_t key)
+    {
+        return m.slice[0][key & 0xFF] &
+            m.slice[1][(key >> 8) & 0xFF] &
+            m.slice[2][(key >> 16) & 0xFF] &
+            m.slice[3][key >> 24];
+    }
+
+    // ds_match + hit counting
+    uint32_t ds_match_count(zm_draw_matcher& m, uint32_t key);
+
+    // For the sampled per-draw cost
+    uint64_t ds_now_ns();
+    void ds_add_time(zm_draw_matcher& m, uint64_t ns);
+
+    // One line per signature plus the average cost; returns bytes written
+    size_t ds_format_stats(const zm_draw_matcher& m, char* out, size_t cap);
+
+} // namespace ZeroMod
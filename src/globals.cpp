@@ -5,6 +5,7 @@
 
 Config* default_config = nullptr;
 Ini* default_ini = nullptr;
+Input* default_input = nullptr;
 
 static Logger dummy_logger(_T("dummy.log"), nullptr, nullptr);
 Logger* default_logger = &dummy_logger;
@@ -3,11 +3,13 @@
 
 class Config;
 class Ini;
+class Input;
 class Logger;
 class Overlay;
 
 extern Config* default_config;
 extern Ini* default_ini;
+extern Input* default_input;
 extern Logger* default_logger;
 extern Overlay* default_overlay;
 
@@ -0,0 +1,264 @@
+#include "gpu_prof.h"
+
+#include <windows.h>
+#include <stdarg.h>
+#include <string.h>
+
+namespace ZeroMod {
+
+    zm_gpu_prof g_gpu_prof;
+
+    static void zm_gp_dbgf(const char* fmt, ...)
+    {
+        char b[512];
+        va_list va;
+        va_start(va, fmt);
+        _vsnprintf(b, sizeof(b), fmt, va);
+        va_end(va);
+        b[sizeof(b) - 1] = '\0';
+        OutputDebugStringA(b);
+    }
+
+    static void gp_release(IDirect3DQuery9*& q)
+    {
+        if (q) {
+            q->Release();
+            q = nullptr;
+        }
+    }
+
+    static bool gp_create(zm_gpu_prof& gp, D3DQUERYTYPE type, IDirect3DQuery9** q)
+    {
+        if (SUCCEEDED(gp.dev->CreateQuery(type, q)) && *q)
+            return true;
+
+        *q = nullptr;
+        if (!gp.unsupported) {
+            gp.unsupported = true;
+            zm_gp_dbgf("[ZeroMod] gpu profiler: timestamp queries not supported (type %d)\n", (int)type);
+        }
+        return false;
+    }
+
+    static void gp_add(zm_gpu_prof& gp, const char* label, double ms)
+    {
+        zm_gpu_stat* st = nullptr;
+        for (unsigned i = 0; i < gp.stat_count; ++i) {
+            if (strcmp(gp.stats[i].label, label) == 0) {
+                st = &gp.stats[i];
+                break;
+            }
+        }
+        if (!st) {
+            if (gp.stat_count >= ZM_GPU_PROF_MAX_PASSES)
+                return;
+            st = &gp.stats[gp.stat_count++];
+            memset(st, 0, sizeof(*st));
+            memcpy(st->label, label, sizeof(st->label));
+        }
+        st->ms_sum += ms;
+        if (ms > st->ms_max)
+            st->ms_max = ms;
+        st->samples++;
+    }
+
+    static void gp_publish(zm_gpu_prof& gp)
+    {
+        char b[2048];
+        int n = _snprintf(b, sizeof(b), "GPU ms (%u frames, %llu skipped, %llu disjoint)  avg    max\n",
+            gp.collected, (unsigned long long)gp.skipped, (unsigned long long)gp.disjoint);
+        for (unsigned i = 0; i < gp.stat_count && n >= 0 && (size_t)n < sizeof(b); ++i) {
+            const zm_gpu_stat& st = gp.stats[i];
+            const int w = _snprintf(b + n, sizeof(b) - n, "%-24s %6.3f %6.3f\n",
+                st.label, st.ms_sum / st.samples, st.ms_max);
+            if (w < 0)
+                break;
+            n += w;
+        }
+        b[sizeof(b) - 1] = '\0';
+
+        gp.text = b;
+        gp.text_new = true;
+        OutputDebugStringA(b);
+
+        gp.stat_count = 0;
+        gp.collected = 0;
+    }
+
+    static void gp_csv(zm_gpu_prof& gp, bool csv, const zm_gpu_frame& f, const double* ms)
+    {
+        if (!csv) {
+            if (gp.csv) {
+                fclose(gp.csv);
+                gp.csv = nullptr;
+            }
+            return;
+        }
+        if (!gp.csv) {
+            gp.csv = fopen(ZM_GPU_PROF_CSV_FILE, "w");
+            if (!gp.csv)
+                return;
+            fputs("frame,pass,ms\n", gp.csv);
+        }
+        for (unsigned i = 0; i < f.count; ++i)
+            fprintf(gp.csv, "%llu,%s,%.4f\n", (unsigned long long)f.frame, f.passes[i].label, ms[i]);
+    }
+
+    // Reads a finished set; leaves it pending if any result isn't in yet
+    static void gp_read(zm_gpu_prof& gp, zm_gpu_frame& f, bool csv)
+    {
+        BOOL disjoint = FALSE;
+        UINT64 freq = 0;
+        HRESULT hr = f.disjoint->GetData(&disjoint, sizeof(disjoint), 0);
+        if (hr == S_OK)
+            hr = f.freq->GetData(&freq, sizeof(freq), 0);
+
+        double ms[ZM_GPU_PROF_MAX_PASSES];
+        for (unsigned i = 0; i < f.count && hr == S_OK; ++i) {
+            UINT64 t0 = 0, t1 = 0;
+            hr = f.passes[i].begin->GetData(&t0, sizeof(t0), 0);
+            if (hr == S_OK)
+                hr = f.passes[i].end->GetData(&t1, sizeof(t1), 0);
+            ms[i] = (hr == S_OK && freq && t1 >= t0) ? (double)(t1 - t0) * 1000.0 / (double)freq : 0.0;
+        }
+
+        if (hr == S_FALSE)
+            return;
+
+        // Done with it either way; failures (lost device) just lose the frame
+        f.pending = false;
+        if (FAILED(hr))
+            return;
+        if (disjoint || !freq) {
+            gp.disjoint++;
+            return;
+        }
+
+        for (unsigned i = 0; i < f.count; ++i)
+            gp_add(gp, f.passes[i].label, ms[i]);
+        gp_csv(gp, csv, f, ms);
+
+        if (++gp.collected >= ZM_GPU_PROF_PUBLISH_INTERVAL)
+            gp_publish(gp);
+    }
+
+    void gp_discard(zm_gpu_prof& gp, bool release)
+    {
+        for (unsigned s = 0; s < ZM_GPU_PROF_FRAMES; ++s) {
+            zm_gpu_frame& f = gp.sets[s];
+            f.pending = false;
+            f.count = 0;
+            if (!release)
+                continue;
+            gp_release(f.disjoint);
+            gp_release(f.freq);
+            for (unsigned i = 0; i < f.created; ++i) {
+                gp_release(f.passes[i].begin);
+                gp_release(f.passes[i].end);
+            }
+            f.created = 0;
+        }
+        gp.cur = nullptr;
+    }
+
+    void gp_frame(zm_gpu_prof& gp, IDirect3DDevice9* dev, bool enabled, bool csv)
+    {
+#if !ZM_GPU_PROF
+        enabled = false;
+#endif
+        if (dev != gp.dev) {
+            gp_discard(gp, true);
+            gp.dev = dev;
+            gp.unsupported = false;
+        }
+
+        if (gp.cur) {
+            gp.cur->disjoint->Issue(D3DISSUE_END);
+            gp.cur->freq->Issue(D3DISSUE_END);
+            gp.cur->pending = true;
+            gp.cur = nullptr;
+        }
+
+        for (unsigned s = 0; s < ZM_GPU_PROF_FRAMES; ++s) {
+            if (gp.sets[s].pending)
+                gp_read(gp, gp.sets[s], csv);
+        }
+
+        if (!enabled || gp.unsupported || !dev) {
+            if (gp.enabled) {
+                gp_discard(gp, false);
+                gp.stat_count = 0;
+                gp.collected = 0;
+                gp.text.clear();
+                gp.text_new = true;
+                if (gp.csv) {
+                    fclose(gp.csv);
+                    gp.csv = nullptr;
+                }
+            }
+            gp.enabled = false;
+            return;
+        }
+        gp.enabled = true;
+
+        zm_gpu_frame& f = gp.sets[gp.frame % ZM_GPU_PROF_FRAMES];
+        const uint64_t frame = gp.frame++;
+        if (f.pending) {
+            // The GPU is more than ZM_GPU_PROF_FRAMES behind: don't wait for it
+            gp.skipped++;
+            return;
+        }
+        if (!f.disjoint && !gp_create(gp, D3DQUERYTYPE_TIMESTAMPDISJOINT, &f.disjoint))
+            return;
+        if (!f.freq && !gp_create(gp, D3DQUERYTYPE_TIMESTAMPFREQ, &f.freq))
+            return;
+
+        f.frame = frame;
+        f.count = 0;
+        f.disjoint->Issue(D3DISSUE_BEGIN);
+        gp.cur = &f;
+    }
+
+    int gp_pass_begin(zm_gpu_prof& gp, const char* label)
+    {
+        zm_gpu_frame* f = gp.cur;
+        if (!f || f->count >= ZM_GPU_PROF_MAX_PASSES)
+            return -1;
+
+        zm_gpu_pass& p = f->passes[f->count];
+        if (f->count >= f->created) {
+            if (!gp_create(gp, D3DQUERYTYPE_TIMESTAMP, &p.begin))
+                return -1;
+            if (!gp_create(gp, D3DQUERYTYPE_TIMESTAMP, &p.end)) {
+                gp_release(p.begin);
+                return -1;
+            }
+            f->created++;
+        }
+
+        if (!label)
+            label = "?";
+        const size_t n = strnlen(label, sizeof(p.label) - 1);
+        memcpy(p.label, label, n);
+        p.label[n] = '\0';
+        p.begin->Issue(D3DISSUE_END);
+        return (int)f->count++;
+    }
+
+    void gp_pass_end(zm_gpu_prof& gp, int pass)
+    {
+        zm_gpu_frame* f = gp.cur;
+        if (f && pass >= 0 && (unsigned)pass < f->count)
+            f->passes[pass].end->Issue(D3DISSUE_END);
+    }
+
+    bool gp_overlay_text(zm_gpu_prof& gp, std::string& out)
+    {
+        if (!gp.text_new)
+            return false;
+        out = gp.text;
+        gp.text_new = false;
+        return true;
+    }
+
+} // namespace ZeroMod
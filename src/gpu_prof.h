@@ -0,0 +1,117 @@
+#pragma once
+#include <d3d9.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+// ---- GPU timestamp profiler for injected passes ----
+// Each frame gets a query set: TIMESTAMPDISJOINT + TIMESTAMPFREQ around
+// the frame and a TIMESTAMP pair per profiled pass. Sets rotate through a
+// pool ZM_GPU_PROF_FRAMES deep and are read with GetData(flags 0), never
+// D3DGETDATA_FLUSH, so nothing waits on the GPU: a set whose results
+// aren't in yet when its turn comes round again makes that frame go
+// unprofiled instead. Only IDirect3DQuery9::Issue/GetData and
+// IDirect3DDevice9::CreateQuery are used, so the scheduling can be driven
+// by fake queries that answer late.
+// Set ZM_GPU_PROF to 0 to compile the scopes out.
+#define ZM_GPU_PROF 1
+// Query sets in flight
+#define ZM_GPU_PROF_FRAMES 4
+// Timestamp pairs per frame
+#define ZM_GPU_PROF_MAX_PASSES 32
+// Collected frames per overlay/log update
+#define ZM_GPU_PROF_PUBLISH_INTERVAL 60
+// Written next to the ini when [profiler] csv=true
+#define ZM_GPU_PROF_CSV_FILE "zeromod_gpu_profile.csv"
+
+namespace ZeroMod {
+
+    struct zm_gpu_pass
+    {
+        char label[32];
+        IDirect3DQuery9* begin;
+        IDirect3DQuery9* end;
+    };
+
+    struct zm_gpu_frame
+    {
+        IDirect3DQuery9* disjoint;
+        IDirect3DQuery9* freq;
+        zm_gpu_pass passes[ZM_GPU_PROF_MAX_PASSES];
+        unsigned count;             // passes issued
+        unsigned created;           // timestamp pairs created so far
+        uint64_t frame;
+        bool pending;               // ended, results not read yet
+    };
+
+    struct zm_gpu_stat
+    {
+        char label[32];
+        double ms_sum;
+        double ms_max;
+        unsigned samples;
+    };
+
+    struct zm_gpu_prof
+    {
+        IDirect3DDevice9* dev;      // not referenced; set by gp_frame
+        bool enabled;
+        bool unsupported;           // CreateQuery(TIMESTAMP*) failed
+        zm_gpu_frame sets[ZM_GPU_PROF_FRAMES];
+        zm_gpu_frame* cur;          // set being recorded (null = this frame isn't profiled)
+        uint64_t frame;             // sets[frame % ZM_GPU_PROF_FRAMES] is recorded next
+
+        zm_gpu_stat stats[ZM_GPU_PROF_MAX_PASSES];
+        unsigned stat_count;
+        unsigned collected;         // frames since the last publish
+        uint64_t skipped;           // no free set
+        uint64_t disjoint;          // results thrown away (clock changed)
+
+        FILE* csv;
+        std::string text;
+        bool text_new;
+    };
+
+    // One per process: the slang passes don't see the device Impl
+    extern zm_gpu_prof g_gpu_prof;
+
+    // Once per Present, before the real Present: closes the frame's set,
+    // reads whatever sets have finished and opens the next one.
+    void gp_frame(zm_gpu_prof& gp, IDirect3DDevice9* dev, bool enabled, bool csv);
+
+    // -1 when the frame isn't profiled or is full
+    int gp_pass_begin(zm_gpu_prof& gp, const char* label);
+    void gp_pass_end(zm_gpu_prof& gp, int pass);
+
+    // Drop every set in flight (device reset / teardown); release = free the queries too
+    void gp_discard(zm_gpu_prof& gp, bool release);
+
+    // Latest per-pass table; false when nothing new since the last call
+    bool gp_overlay_text(zm_gpu_prof& gp, std::string& out);
+
+    class zm_gpu_scope
+    {
+        int pass;
+
+    public:
+        explicit zm_gpu_scope(const char* label)
+            : pass(g_gpu_prof.cur ? gp_pass_begin(g_gpu_prof, label) : -1) {}
+        ~zm_gpu_scope()
+        {
+            if (pass >= 0)
+                gp_pass_end(g_gpu_prof, pass);
+        }
+
+        zm_gpu_scope(const zm_gpu_scope&) = delete;
+        zm_gpu_scope& operator=(const zm_gpu_scope&) = delete;
+    };
+
+} // namespace ZeroMod
+
+#if ZM_GPU_PROF
+#define ZM_GPU_CAT2(a, b) a##b
+#define ZM_GPU_CAT(a, b) ZM_GPU_CAT2(a, b)
+#define ZM_GPU_SCOPE(label) ZeroMod::zm_gpu_scope ZM_GPU_CAT(zm_gpu_, __LINE__)(label)
+#else
+#define ZM_GPU_SCOPE(label) do {} while (0)
+#endif
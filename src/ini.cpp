@@ -3,6 +3,7 @@
 #include "main.h"
 #include "conf.h"
 #include "globals.h"
+#include "ini_parse.h"
 
 #ifndef ENABLE_LOGGER
 #define ENABLE_LOGGER 1
@@ -10,6 +11,14 @@
 
 #define ENABLE_SLANG_SHADER 1
 
+// Fallback file-time poll when the directory can't be watched
+#define INI_POLL_MS 250
+// Quiet time after a change notification before reading, so an editor's
+// truncate-then-write lands as one reload
+#define INI_SETTLE_MS 30
+// Larger files aren't an ini this mod wrote
+#define INI_MAX_BYTES (1 << 20)
+
 namespace {
 
     typedef MAP_ENUM(::BYTE) VkMapEnum; // Fully qualify BYTE
@@ -270,52 +279,229 @@ class Ini::Impl {
 
     HANDLE file = INVALID_HANDLE_VALUE;
     UINT64 ini_time = 0;
-    bool thread_running = true;
+    // Set by ~Ini; the thread closes it and deletes the Impl
+    HANDLE stop_event = NULL;
+
+    // Last parsed file, to apply only the keys that changed
+    ZeroMod::zm_ini_table ini_keys;
+    ZeroMod::zm_ini_table ini_keys_next;
+    UINT ini_codepage = CP_ACP;
+    bool ini_full = true;
+    std::string ini_bytes;
 
     static DWORD WINAPI ini_ThreadProc(LPVOID lpParameter) {
         return ((Impl*)lpParameter)->ini_proc();
     }
 
+    UINT64 ini_file_time() {
+        UINT64 time = 0;
+        HANDLE h = CreateFile(
+            file_name,
+            GENERIC_READ,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL,
+            NULL
+        );
+
+        if (h != INVALID_HANDLE_VALUE) {
+            GetFileTime(h, NULL, NULL, (LPFILETIME)&time);
+            CloseHandle(h);
+        }
+        return time;
+    }
+
+    void ini_reload_if_changed() {
+        UINT64 time = ini_file_time();
+        if (time && (!ini_time || ini_time != time)) {
+            char b[256];
+            _snprintf(b, sizeof(b),
+                "[ZeroMod] INI CHANGE DETECTED: old=%llu new=%llu -> calling load_ini\n",
+                (unsigned long long)ini_time,
+                (unsigned long long)time);
+            OutputDebugStringA(b);
+            load_ini();
+            ini_time = time;
+        }
+    }
+
     DWORD ini_proc() {
-        while (1) {
-            if (!thread_running) {
-                delete this;
-                return 0;
-            }
+        if (!ini_watch()) {
+            OutputDebugStringA("[ZeroMod] INI: directory watch unavailable or failed, polling\n");
+            ini_poll();
+        }
+        CloseHandle(stop_event);
+        delete this;
+        return 0;
+    }
 
-            UINT64 time = 0;
-            HANDLE h = CreateFile(
-                file_name,
-                GENERIC_READ,
-                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
-                NULL,
-                OPEN_EXISTING,
-                FILE_ATTRIBUTE_NORMAL,
-                NULL
-            );
+    void ini_poll() {
+        do {
+            ini_reload_if_changed();
+        } while (WaitForSingleObject(stop_event, INI_POLL_MS) == WAIT_TIMEOUT);
+    }
+
+    // Sleeps in ReadDirectoryChangesW until something in the ini's
+    // directory changes. True once stop_event is set; false when the watch
+    // can't be set up or fails later, so the caller polls instead.
+    bool ini_watch() {
+        // Directory part and file part of the ini path, the latter as the notifications spell it
+        _tstring path(file_name);
+        _tstring::size_type slash = path.find_last_of(_T("\\/"));
+        _tstring dir = slash == _tstring::npos ? _tstring(_T(".")) : path.substr(0, slash);
+        _tstring name = slash == _tstring::npos ? path : path.substr(slash + 1);
+#ifdef _UNICODE
+        std::wstring wname = name;
+#else
+        std::wstring wname(MultiByteToWideChar(CP_ACP, 0, name.c_str(), -1, NULL, 0), L'\0');
+        MultiByteToWideChar(CP_ACP, 0, name.c_str(), -1, wname.data(), (int)wname.size());
+        wname.resize(wcslen(wname.c_str()));
+#endif
 
-            if (h != INVALID_HANDLE_VALUE) {
-                GetFileTime(h, NULL, NULL, (LPFILETIME)&time);
-                CloseHandle(h);
+        HANDLE dir_handle = CreateFile(
+            dir.c_str(),
+            FILE_LIST_DIRECTORY,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL,
+            OPEN_EXISTING,
+            FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+            NULL
+        );
+        if (dir_handle == INVALID_HANDLE_VALUE) return false;
+
+        OVERLAPPED ov = {};
+        ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+        if (!ov.hEvent) {
+            CloseHandle(dir_handle);
+            return false;
+        }
+
+        // Catch anything written before the first wait
+        ini_reload_if_changed();
+
+        DWORD changes[1024];
+        bool stopped = false;
+        for (;;) {
+            ResetEvent(ov.hEvent);
+            if (!ReadDirectoryChangesW(dir_handle, changes, sizeof(changes), FALSE,
+                FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE,
+                NULL, &ov, NULL)) {
+                break;
             }
 
-            if (time && (!ini_time || ini_time != time)) {
-                char b[256];
-                _snprintf(b, sizeof(b),
-                    "[ZeroMod] INI CHANGE DETECTED: old=%llu new=%llu -> calling load_ini\n",
-                    (unsigned long long)ini_time,
-                    (unsigned long long)time);
-                OutputDebugStringA(b);
-                load_ini();
-                ini_time = time;
+            HANDLE waits[2] = { ov.hEvent, stop_event };
+            DWORD w = WaitForMultipleObjects(2, waits, FALSE, INFINITE);
+            DWORD len = 0;
+            if (w != WAIT_OBJECT_0) {
+                CancelIo(dir_handle);
+                GetOverlappedResult(dir_handle, &ov, &len, TRUE);
+                stopped = w == WAIT_OBJECT_0 + 1;
+                break;
+            }
+            // e.g. the directory went away: the poll loop takes over
+            if (!GetOverlappedResult(dir_handle, &ov, &len, FALSE)) break;
+
+            // len 0: more changes than fit the buffer, so ours may be among them
+            bool hit = len == 0;
+            for (BYTE* p = (BYTE*)changes; !hit && len;) {
+                FILE_NOTIFY_INFORMATION* fni = (FILE_NOTIFY_INFORMATION*)p;
+                hit = fni->FileNameLength / sizeof(WCHAR) == wname.size() &&
+                    _wcsnicmp(fni->FileName, wname.c_str(), wname.size()) == 0;
+                if (!fni->NextEntryOffset) break;
+                p += fni->NextEntryOffset;
             }
+            if (!hit) continue;
 
-            Sleep(250);
+            if (WaitForSingleObject(stop_event, INI_SETTLE_MS) != WAIT_TIMEOUT) {
+                stopped = true;
+                break;
+            }
+            ini_reload_if_changed();
         }
+
+        CloseHandle(ov.hEvent);
+        CloseHandle(dir_handle);
+        return stopped;
     }
 
     Impl(LPCTSTR file_name) : file_name(file_name) {
-        CreateThread(NULL, 0, ini_ThreadProc, this, 0, NULL);
+        stop_event = CreateEvent(NULL, TRUE, FALSE, NULL);
+        if (stop_event) CreateThread(NULL, 0, ini_ThreadProc, this, 0, NULL);
+    }
+
+    // Reads the whole file and parses it into ini_keys_next; false when it can't be read
+    bool ini_read() {
+        HANDLE h = CreateFile(
+            (_tstring(_T(".\\")) + file_name).c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL,
+            NULL
+        );
+        if (h == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER size = {};
+        bool ok = GetFileSizeEx(h, &size) && size.QuadPart <= INI_MAX_BYTES;
+        DWORD read = 0;
+        if (ok) {
+            ini_bytes.resize((size_t)size.QuadPart);
+            ok = !size.QuadPart || ReadFile(h, ini_bytes.data(), (DWORD)size.QuadPart, &read, NULL);
+            ini_bytes.resize(read);
+        }
+        CloseHandle(h);
+        if (!ok) return false;
+
+        // Same encodings GetPrivateProfileString reads: UTF-16LE with a BOM, else bytes
+        ini_codepage = CP_ACP;
+        const char* data = ini_bytes.data();
+        size_t n = ini_bytes.size();
+        if (n >= 2 && (BYTE)data[0] == 0xFF && (BYTE)data[1] == 0xFE) {
+            int len = WideCharToMultiByte(CP_UTF8, 0, (LPCWSTR)(data + 2), (int)((n - 2) / 2), NULL, 0, NULL, NULL);
+            std::string utf8(len > 0 ? len : 0, '\0');
+            if (len > 0) WideCharToMultiByte(CP_UTF8, 0, (LPCWSTR)(data + 2), (int)((n - 2) / 2), utf8.data(), len, NULL, NULL);
+            ini_bytes = std::move(utf8);
+            data = ini_bytes.data();
+            n = ini_bytes.size();
+            ini_codepage = CP_UTF8;
+        }
+        else if (n >= 3 && (BYTE)data[0] == 0xEF && (BYTE)data[1] == 0xBB && (BYTE)data[2] == 0xBF) {
+            data += 3;
+            n -= 3;
+            ini_codepage = CP_UTF8;
+        }
+
+        ZeroMod::ip_parse(ini_keys_next, data, n);
+        return true;
+    }
+
+    // GetPrivateProfileString over the parsed table: false when the key
+    // hasn't changed since the last load (nothing to apply), else its value
+    // (empty when missing) in out[out_size]
+    bool ini_value(const char* section, const char* key, LPTSTR out, DWORD out_size) {
+        if (!ini_full && !ZeroMod::ip_changed(ini_keys, ini_keys_next, section, key)) return false;
+
+        *out = 0;
+        const std::string* v = ZeroMod::ip_find(ini_keys_next, section, key);
+        if (!v || v->empty()) return true;
+#ifdef _UNICODE
+        int len = MultiByteToWideChar(ini_codepage, 0, v->data(), (int)v->size(), out, out_size - 1);
+        out[len > 0 ? len : 0] = 0;
+        // Too long for the buffer: keep what fits, like GetPrivateProfileString
+        if (len <= 0 && GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
+            std::wstring w(MultiByteToWideChar(ini_codepage, 0, v->data(), (int)v->size(), NULL, 0), L'\0');
+            MultiByteToWideChar(ini_codepage, 0, v->data(), (int)v->size(), w.data(), (int)w.size());
+            w.resize(out_size - 1);
+            memcpy(out, w.c_str(), out_size * sizeof(WCHAR));
+        }
+#else
+        size_t len = v->size() < out_size - 1 ? v->size() : out_size - 1;
+        memcpy(out, v->data(), len);
+        out[len] = 0;
+#endif
+        return true;
     }
 
     void ini_file_init() {
@@ -346,14 +532,17 @@ class Ini::Impl {
         OutputDebugStringA("[ZeroMod] INI: load_ini ENTER\n");
         if (!config) { OutputDebugStringA("[ZeroMod] INI: load_ini abort (config null)\n"); return; }
         OutputDebugStringA("[ZeroMod] INI: load_ini EXIT\n");
-        config->begin_config();
+        ConfigValues* cfg = config->begin_config();
+
+        // Missing file reads as empty, as with GetPrivateProfileString
+        if (!ini_read()) ini_keys_next.keys.clear();
 
         const DWORD n_size = MAX_PATH + 1;
         TCHAR returned_string[n_size] = {};
 
-#define GET_INI_VALUE(n) do { \
-    GetPrivateProfileString(_T(STRINGIFY(SECTION)), _T(#n), NULL, returned_string, n_size, (_tstring(_T(".\\")) + file_name).c_str()); \
-} while (0)
+        // Skips the rest of the enclosing do/while (0) when the key didn't change
+#define GET_INI_VALUE(n) \
+    if (!ini_value(STRINGIFY(SECTION), #n, returned_string, n_size)) break
 
 #define OVERLAY_PUSH_INVALID_VALUE(v) overlay("Invalid [" LSTRINGIFY(SECTION) "]." #v " value")
 
@@ -363,7 +552,7 @@ class Ini::Impl {
     if (!v && *returned_string && _tcsicmp(returned_string, _T("FALSE")) != 0) { \
         OVERLAY_PUSH_INVALID_VALUE(v); \
     } \
-    config->k = v; \
+    cfg->k = v; \
 } while (0)
 #define GET_SET_CONFIG_BOOL_VALUE(v) GET_SET_CONFIG_BOOL_VALUE_KEY(v, v)
 
@@ -373,7 +562,7 @@ class Ini::Impl {
     if (returned_string + _tcslen(returned_string) != endptr) v = -1; \
 } while (0)
 
-#define GET_SET_CONFIG_UINT_VALUE(v) do { \
+#define GET_SET_CONFIG_UINT_VALUE_KEY(v, k) do { \
     GET_INI_VALUE(v); \
     long v; \
     GET_LONG_VALUE(v); \
@@ -381,11 +570,9 @@ class Ini::Impl {
         OVERLAY_PUSH_INVALID_VALUE(v); \
         v = 0; \
     } \
-    if (config->v != (UINT)v) { \
-        config->v = v; \
-        config->UPDATED_VAR = true; \
-    } \
+    cfg->k = v; \
 } while (0)
+#define GET_SET_CONFIG_UINT_VALUE(v) GET_SET_CONFIG_UINT_VALUE_KEY(v, v)
 
 #ifdef _UNICODE
 #define GET_UTF8_VAL(v) do { \
@@ -408,17 +595,14 @@ class Ini::Impl {
     GET_INI_VALUE(v); \
     std::string v; \
     GET_UTF8_VAL(v); \
-    if (v != config->k) { \
-        config->k = v; \
-        config->k ## _updated = true; \
-    } \
+    cfg->k = std::move(v); \
 } while (0)
 #define GET_SET_CONFIG_UTF8_VALUE(v) GET_SET_CONFIG_UTF8_VALUE_KEY(v, v)
 
 #define GET_SET_CONFIG_VK_VALUE(v) do { \
     GET_INI_VALUE(hotkey_ ## v); \
-    config->log_ ## v ## _hotkey = ini_parse_vk_comb(returned_string); \
-    if (*returned_string && !config->log_ ## v ## _hotkey.size()) \
+    cfg->log_ ## v ## _hotkey = ini_parse_vk_comb(returned_string); \
+    if (*returned_string && !cfg->log_ ## v ## _hotkey.size()) \
         overlay("Invalid hotkey for log " #v); \
 } while (0)
 
@@ -431,6 +615,21 @@ class Ini::Impl {
 #endif
 
 
+#undef SECTION
+
+#define SECTION capture
+
+        GET_SET_CONFIG_BOOL_VALUE_KEY(enabled, capture_enabled);
+        GET_SET_CONFIG_BOOL_VALUE_KEY(contents, capture_contents);
+
+#undef SECTION
+
+#define SECTION profiler
+
+        GET_SET_CONFIG_BOOL_VALUE_KEY(enabled, profiler_enabled);
+        GET_SET_CONFIG_BOOL_VALUE_KEY(csv, profiler_csv);
+        GET_SET_CONFIG_BOOL_VALUE_KEY(gpu, profiler_gpu);
+
 #undef SECTION
 
 #define SECTION graphics
@@ -439,15 +638,13 @@ class Ini::Impl {
         GET_SET_CONFIG_BOOL_VALUE(linear);
         GET_SET_CONFIG_BOOL_VALUE(enhanced);
 
-#define UPDATED_VAR linear_test_updated
         GET_SET_CONFIG_UINT_VALUE(linear_test_width);
         GET_SET_CONFIG_UINT_VALUE(linear_test_height);
-#undef UPDATED_VAR
 
 #ifdef ENABLE_SLANG_SHADER
         GET_SET_CONFIG_UTF8_VALUE_KEY(slang_shader, slang_shader_2d);
         {
-            const std::string& s = config->slang_shader_2d;
+            const std::string& s = cfg->slang_shader_2d;
             char b[512];
             _snprintf(
                 b, sizeof(b),
@@ -468,68 +665,80 @@ class Ini::Impl {
         {
             char b[512];
             _snprintf(b, sizeof(b),
-                "[ZeroMod] INI: gba='%s' gba_upd=%d  ds='%s' ds_upd=%d\n",
-                config->slang_shader_gba.c_str(),
-                (int)config->slang_shader_gba_updated.load(),
-                config->slang_shader_ds.c_str(),
-                (int)config->slang_shader_ds_updated.load());
+                "[ZeroMod] INI: gba='%s'  ds='%s'\n",
+                cfg->slang_shader_gba.c_str(),
+                cfg->slang_shader_ds.c_str());
             OutputDebugStringA(b);
         }
 #endif
 
 
+#undef SECTION
+
+#define SECTION input
+
+        GET_SET_CONFIG_UINT_VALUE_KEY(poll_hz, input_poll_hz);
+
+#undef SECTION
+
+#define SECTION cpu_scaler
+
+        GET_SET_CONFIG_BOOL_VALUE_KEY(enabled, cpu_scaler_enabled);
+        GET_SET_CONFIG_UINT_VALUE_KEY(factor, cpu_scaler_factor);
+        GET_SET_CONFIG_UINT_VALUE_KEY(threads, cpu_scaler_threads);
+
 #undef SECTION
 
 #define SECTION toggles
 
-        {
+        do {
             GET_INI_VALUE(hotkey_shader_toggle);
-            config->hotkey_shader_toggle = ini_parse_vk_comb(returned_string);
-            if (!config->hotkey_shader_toggle.size()) {
-                config->hotkey_shader_toggle = { VK_OEM_3 }; // ` key
+            cfg->hotkey_shader_toggle = ini_parse_vk_comb(returned_string);
+            if (!cfg->hotkey_shader_toggle.size()) {
+                cfg->hotkey_shader_toggle = { VK_OEM_3 }; // ` key
             }
-        }
-        {
+        } while (0);
+        do {
             GET_INI_VALUE(hotkey_shader_toggle_pad);
-            config->hotkey_shader_toggle_pad = ini_parse_vk_comb(returned_string);
-            if (!config->hotkey_shader_toggle_pad.size()) {
-                config->hotkey_shader_toggle_pad = { XINPUT_VK_LS };
+            cfg->hotkey_shader_toggle_pad = ini_parse_vk_comb(returned_string);
+            if (!cfg->hotkey_shader_toggle_pad.size()) {
+                cfg->hotkey_shader_toggle_pad = { XINPUT_VK_LS };
             }
-        }
-        {
+        } while (0);
+        do {
             GET_INI_VALUE(hotkey_flash_kill);
-            config->hotkey_flash_kill = ini_parse_vk_comb(returned_string);
-            if (!config->hotkey_flash_kill.size()) {
-                config->hotkey_flash_kill = { 0x31 };
+            cfg->hotkey_flash_kill = ini_parse_vk_comb(returned_string);
+            if (!cfg->hotkey_flash_kill.size()) {
+                cfg->hotkey_flash_kill = { 0x31 };
             }
-        }
-        {
+        } while (0);
+        do {
             GET_INI_VALUE(hotkey_flash_kill_pad);
-            config->hotkey_flash_kill_pad = ini_parse_vk_comb(returned_string);
-            if (!config->hotkey_flash_kill_pad.size()) {
-                config->hotkey_flash_kill_pad = { XINPUT_VK_RS };
+            cfg->hotkey_flash_kill_pad = ini_parse_vk_comb(returned_string);
+            if (!cfg->hotkey_flash_kill_pad.size()) {
+                cfg->hotkey_flash_kill_pad = { XINPUT_VK_RS };
             }
-        }
-        {
+        } while (0);
+        do {
             GET_INI_VALUE(hotkey_transparent_cutscenes);
-            config->hotkey_transparent_cutscenes = ini_parse_vk_comb(returned_string);
-            if (!config->hotkey_transparent_cutscenes.size()) {
-                config->hotkey_transparent_cutscenes = { 0x32 };
+            cfg->hotkey_transparent_cutscenes = ini_parse_vk_comb(returned_string);
+            if (!cfg->hotkey_transparent_cutscenes.size()) {
+                cfg->hotkey_transparent_cutscenes = { 0x32 };
             }
-        }
-        {
+        } while (0);
+        do {
             GET_INI_VALUE(hotkey_transparent_cutscenes_pad);
-            config->hotkey_transparent_cutscenes_pad = ini_parse_vk_comb(returned_string);
-            if (!config->hotkey_transparent_cutscenes_pad.size()) {
-                config->hotkey_transparent_cutscenes_pad = { XINPUT_VK_RT };
+            cfg->hotkey_transparent_cutscenes_pad = ini_parse_vk_comb(returned_string);
+            if (!cfg->hotkey_transparent_cutscenes_pad.size()) {
+                cfg->hotkey_transparent_cutscenes_pad = { XINPUT_VK_RT };
             }
-        }
+        } while (0);
 
 #undef SECTION
 
 #define SECTION defaults
 
-        {
+        do {
             GET_INI_VALUE(shader_toggle);
             if (*returned_string) {
                 bool val = _tcsicmp(returned_string, _T("TRUE")) == 0;
@@ -540,8 +749,8 @@ class Ini::Impl {
                     config->shader_toggle = val;
                 }
             }
-        }
-        {
+        } while (0);
+        do {
             GET_INI_VALUE(flash_kill);
             if (*returned_string) {
                 bool val = _tcsicmp(returned_string, _T("TRUE")) == 0;
@@ -553,8 +762,8 @@ class Ini::Impl {
                 }
             }
             // else keeps hardcoded default (false)
-        }
-        {
+        } while (0);
+        do {
             GET_INI_VALUE(transparent_cutscenes);
             if (*returned_string) {
                 bool val = _tcsicmp(returned_string, _T("TRUE")) == 0;
@@ -566,15 +775,19 @@ class Ini::Impl {
                 }
             }
             // else keeps hardcoded default (true)
-        }
+        } while (0);
 
 #undef SECTION
 
+        std::swap(ini_keys, ini_keys_next);
+        ini_full = false;
         config->end_config();
     }
 
     void set_config(Config* config) {
         this->config = config;
+        // A new Config gets every key, not just the changed ones
+        ini_full = true;
         load_ini();
     }
 
@@ -589,7 +802,8 @@ Ini::Ini(LPCTSTR file_name, Overlay* overlay, Config* config) : impl(new Impl{ f
 }
 
 Ini::~Ini() {
-    impl->thread_running = false;
+    if (impl->stop_event) SetEvent(impl->stop_event);
+    else delete impl;
 }
 
 void Ini::set_config(Config* config) {
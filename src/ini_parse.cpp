@@ -0,0 +1,114 @@
+#include "ini_parse.h"
+
+#include <string.h>
+
+namespace ZeroMod {
+
+    static bool ip_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    static char ip_lower(char c)
+    {
+        return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
+    }
+
+    static void ip_trim(const char*& b, const char*& e)
+    {
+        while (b < e && ip_space(*b))
+            ++b;
+        while (e > b && ip_space(e[-1]))
+            --e;
+    }
+
+    static void ip_append_lower(std::string& out, const char* b, const char* e)
+    {
+        for (; b < e; ++b)
+            out += ip_lower(*b);
+    }
+
+    static std::string ip_name(const char* section, const char* key)
+    {
+        std::string name;
+        ip_append_lower(name, section, section + strlen(section));
+        name += '\n';
+        ip_append_lower(name, key, key + strlen(key));
+        return name;
+    }
+
+    void ip_parse(zm_ini_table& t, const char* data, size_t n)
+    {
+        t.keys.clear();
+
+        std::string section;
+        std::string name;
+        const char* p = data;
+        const char* end = data + n;
+        while (p < end) {
+            const char* line = p;
+            while (p < end && *p != '\n')
+                ++p;
+            const char* line_end = p;
+            if (p < end)
+                ++p;
+
+            ip_trim(line, line_end);
+            if (line == line_end || *line == ';')
+                continue;
+
+            if (*line == '[') {
+                const char* close = line + 1;
+                while (close < line_end && *close != ']')
+                    ++close;
+                const char* sb = line + 1;
+                const char* se = close;
+                ip_trim(sb, se);
+                section.clear();
+                ip_append_lower(section, sb, se);
+                continue;
+            }
+
+            const char* eq = line;
+            while (eq < line_end && *eq != '=')
+                ++eq;
+            if (eq == line_end)
+                continue;
+
+            const char* kb = line;
+            const char* ke = eq;
+            const char* vb = eq + 1;
+            const char* ve = line_end;
+            ip_trim(kb, ke);
+            ip_trim(vb, ve);
+            if (kb == ke)
+                continue;
+            if (ve - vb >= 2 && (*vb == '"' || *vb == '\'') && ve[-1] == *vb) {
+                ++vb;
+                --ve;
+            }
+
+            name = section;
+            name += '\n';
+            ip_append_lower(name, kb, ke);
+            t.keys.emplace(name, std::string(vb, ve));
+        }
+    }
+
+    const std::string* ip_find(const zm_ini_table& t, const char* section, const char* key)
+    {
+        const auto it = t.keys.find(ip_name(section, key));
+        return it != t.keys.end() ? &it->second : nullptr;
+    }
+
+    bool ip_changed(const zm_ini_table& before, const zm_ini_table& after, const char* section, const char* key)
+    {
+        const std::string name = ip_name(section, key);
+        const auto a = before.keys.find(name);
+        const auto b = after.keys.find(name);
+        if ((a == before.keys.end()) != (b == after.keys.end()))
+            return true;
+        return a != before.keys.end() && a->second != b->second;
+    }
+
+} // namespace ZeroMod
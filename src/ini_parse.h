@@ -0,0 +1,35 @@
+#pragma once
+#include <stddef.h>
+#include <string>
+#include <unordered_map>
+
+// ---- Single-pass ini parser ----
+// The ini file is read into memory once per reload and turned into a
+// section/key -> value table in one pass, instead of one
+// GetPrivateProfileString call (each re-opening and re-parsing the file)
+// per key. Follows GetPrivateProfileString where the mod's ini relies on
+// it: section and key names are case-insensitive, whitespace around keys
+// and values is trimmed, a value wrapped in matching quotes loses them,
+// lines starting with ';' and lines without '=' are skipped, and the
+// first occurrence of a key wins. Bytes are kept as they are; the caller
+// knows the code page. No Windows types, so tools/zm_ini_bench.cpp can
+// parse on Linux.
+
+namespace ZeroMod {
+
+    struct zm_ini_table
+    {
+        // "section\nkey" (lowercase) -> value
+        std::unordered_map<std::string, std::string> keys;
+    };
+
+    // Replaces t's contents with the keys in data[0..n)
+    void ip_parse(zm_ini_table& t, const char* data, size_t n);
+
+    // Null when the key isn't there; section/key are ASCII
+    const std::string* ip_find(const zm_ini_table& t, const char* section, const char* key);
+
+    // True when the key was added, removed or got a different value
+    bool ip_changed(const zm_ini_table& before, const zm_ini_table& after, const char* section, const char* key);
+
+} // namespace ZeroMod
@@ -0,0 +1,142 @@
+#include "input.h"
+#include "conf.h"
+
+#include <Xinput.h>
+
+namespace {
+
+    const struct {
+        BYTE vk;
+        WORD mask;
+    } pad_buttons[] = {
+        { XINPUT_VK_RS,         XINPUT_GAMEPAD_RIGHT_THUMB },
+        { XINPUT_VK_LS,         XINPUT_GAMEPAD_LEFT_THUMB },
+        { XINPUT_VK_A,          XINPUT_GAMEPAD_A },
+        { XINPUT_VK_B,          XINPUT_GAMEPAD_B },
+        { XINPUT_VK_X,          XINPUT_GAMEPAD_X },
+        { XINPUT_VK_Y,          XINPUT_GAMEPAD_Y },
+        { XINPUT_VK_LB,         XINPUT_GAMEPAD_LEFT_SHOULDER },
+        { XINPUT_VK_RB,         XINPUT_GAMEPAD_RIGHT_SHOULDER },
+        { XINPUT_VK_START,      XINPUT_GAMEPAD_START },
+        { XINPUT_VK_BACK,       XINPUT_GAMEPAD_BACK },
+        { XINPUT_VK_DPAD_UP,    XINPUT_GAMEPAD_DPAD_UP },
+        { XINPUT_VK_DPAD_DOWN,  XINPUT_GAMEPAD_DPAD_DOWN },
+        { XINPUT_VK_DPAD_LEFT,  XINPUT_GAMEPAD_DPAD_LEFT },
+        { XINPUT_VK_DPAD_RIGHT, XINPUT_GAMEPAD_DPAD_RIGHT },
+    };
+
+}
+
+class Input::Impl {
+public:
+    Config* config;
+    int config_reader;
+    // Set by ~Input; the thread detaches, closes it and deletes the Impl
+    HANDLE stop_event = NULL;
+
+    ZeroMod::zm_input_queue queues[ZeroMod::ZM_IN_QUEUE_COUNT];
+
+    // Input thread only
+    ZeroMod::zm_input_map map;
+    UINT64 map_version = ~0ull;
+    DWORD poll_ms = 1000 / ZM_INPUT_POLL_HZ;
+    bool pad_connected = true;
+    ULONGLONG pad_retry_at = 0;
+
+    Impl(Config* config) : config(config), config_reader(config ? config->attach_reader() : -1) {
+        for (ZeroMod::zm_input_queue& q : queues)
+            ZeroMod::in_queue_init(q);
+        ZeroMod::in_map_init(map, XINPUT_VK_BASE);
+        stop_event = CreateEvent(NULL, TRUE, FALSE, NULL);
+        if (stop_event) CreateThread(NULL, 0, input_ThreadProc, this, 0, NULL);
+    }
+
+    static DWORD WINAPI input_ThreadProc(LPVOID lpParameter) {
+        return ((Impl*)lpParameter)->input_proc();
+    }
+
+    DWORD input_proc() {
+        do {
+            poll();
+        } while (WaitForSingleObject(stop_event, poll_ms) == WAIT_TIMEOUT);
+
+        if (config) config->detach_reader(config_reader);
+        CloseHandle(stop_event);
+        delete this;
+        return 0;
+    }
+
+    void add(BYTE event, const std::vector<BYTE>& combo) {
+        ZeroMod::in_map_add(map, event, combo.data(), combo.size());
+    }
+
+    // Rebuilds the combos when a new config snapshot is out
+    void update_map() {
+        const ConfigValues* c = config ? config->snapshot(config_reader) : nullptr;
+        if (!c || c->version == map_version) return;
+        map_version = c->version;
+
+        ZeroMod::in_map_init(map, XINPUT_VK_BASE);
+        add(ZeroMod::ZM_IN_SHADER_TOGGLE, c->hotkey_shader_toggle);
+        add(ZeroMod::ZM_IN_SHADER_TOGGLE, c->hotkey_shader_toggle_pad);
+        add(ZeroMod::ZM_IN_FLASH_KILL, c->hotkey_flash_kill);
+        add(ZeroMod::ZM_IN_FLASH_KILL, c->hotkey_flash_kill_pad);
+        add(ZeroMod::ZM_IN_TRANSPARENT_CUTSCENES, c->hotkey_transparent_cutscenes);
+        add(ZeroMod::ZM_IN_TRANSPARENT_CUTSCENES, c->hotkey_transparent_cutscenes_pad);
+        add(ZeroMod::ZM_IN_LOG_TOGGLE, c->log_toggle_hotkey);
+        add(ZeroMod::ZM_IN_LOG_FRAME, c->log_frame_hotkey);
+
+        UINT hz = c->input_poll_hz ? c->input_poll_hz : ZM_INPUT_POLL_HZ;
+        if (hz < ZM_INPUT_POLL_HZ_MIN) hz = ZM_INPUT_POLL_HZ_MIN;
+        if (hz > ZM_INPUT_POLL_HZ_MAX) hz = ZM_INPUT_POLL_HZ_MAX;
+        poll_ms = 1000 / hz;
+    }
+
+    void sample_pad(BYTE* down) {
+        if (!map.uses_pad) return;
+
+        ULONGLONG now = GetTickCount64();
+        if (!pad_connected && now < pad_retry_at) return;
+
+        XINPUT_STATE state{};
+        bool connected = XInputGetState(0, &state) == ERROR_SUCCESS;
+        if (connected != pad_connected)
+            OutputDebugStringA(connected ? "[ZeroMod] Input: pad connected\n" : "[ZeroMod] Input: pad disconnected\n");
+        pad_connected = connected;
+        if (!connected) {
+            pad_retry_at = now + ZM_INPUT_PAD_RETRY_MS;
+            return;
+        }
+
+        const XINPUT_GAMEPAD& gp = state.Gamepad;
+        for (const auto& b : pad_buttons) {
+            if (gp.wButtons & b.mask) ZeroMod::in_set_key(down, b.vk);
+        }
+        if (gp.bLeftTrigger > XINPUT_GAMEPAD_TRIGGER_THRESHOLD) ZeroMod::in_set_key(down, XINPUT_VK_LT);
+        if (gp.bRightTrigger > XINPUT_GAMEPAD_TRIGGER_THRESHOLD) ZeroMod::in_set_key(down, XINPUT_VK_RT);
+    }
+
+    void poll() {
+        update_map();
+
+        // Each key once, however many combos share it
+        BYTE down[32] = {};
+        for (UINT vk = 1; vk < XINPUT_VK_BASE; ++vk) {
+            if (ZeroMod::in_key(map.used, (BYTE)vk) && (GetAsyncKeyState(vk) & 0x8000))
+                ZeroMod::in_set_key(down, (BYTE)vk);
+        }
+        sample_pad(down);
+        ZeroMod::in_map_edges(map, down, queues);
+    }
+};
+
+Input::Input(Config* config) : impl(new Impl(config)) {}
+
+Input::~Input() {
+    if (impl->stop_event) SetEvent(impl->stop_event);
+    else delete impl;
+}
+
+bool Input::next_event(int queue, BYTE& event) {
+    return ZeroMod::in_pop(impl->queues[queue], event);
+}
@@ -0,0 +1,36 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "main.h"
+#include "globals.h"
+#include "input_edge.h"
+
+// ---- Input thread ----
+// One thread samples the keys and pad buttons that the configured hotkeys
+// use ([toggles] hotkey_*, [logging] hotkey_*) at [input] poll_hz, and
+// turns presses into events (input_edge.h) for the render thread and the
+// Logger to drain once per frame. When XInputGetState fails (no pad), the
+// pad is tried again only every ZM_INPUT_PAD_RETRY_MS, since that call is
+// slow on a disconnected slot.
+// Poll rate when the ini doesn't set one
+#define ZM_INPUT_POLL_HZ 250
+#define ZM_INPUT_POLL_HZ_MIN 10
+#define ZM_INPUT_POLL_HZ_MAX 1000
+// Time between XInputGetState calls while the pad is disconnected
+#define ZM_INPUT_PAD_RETRY_MS 2000
+
+class Config;
+
+class Input {
+    class Impl;
+    Impl* impl;
+
+public:
+    Input(Config* config);
+    ~Input();
+
+    // Consumer side of one of the ZM_IN_Q_* queues; false when empty
+    bool next_event(int queue, BYTE& event);
+};
+
+#endif // INPUT_H
@@ -0,0 +1,77 @@
+#include "input_edge.h"
+
+#include <string.h>
+
+namespace ZeroMod {
+
+    void in_queue_init(zm_input_queue& q)
+    {
+        q.head.store(0, std::memory_order_relaxed);
+        q.tail.store(0, std::memory_order_relaxed);
+        q.dropped.store(0, std::memory_order_relaxed);
+    }
+
+    bool in_push(zm_input_queue& q, uint8_t event)
+    {
+        const uint32_t h = q.head.load(std::memory_order_relaxed);
+        if (h - q.tail.load(std::memory_order_acquire) >= ZM_IN_QUEUE_SIZE) {
+            q.dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        q.events[h & (ZM_IN_QUEUE_SIZE - 1)] = event;
+        q.head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool in_pop(zm_input_queue& q, uint8_t& event)
+    {
+        const uint32_t t = q.tail.load(std::memory_order_relaxed);
+        if (q.head.load(std::memory_order_acquire) == t)
+            return false;
+        event = q.events[t & (ZM_IN_QUEUE_SIZE - 1)];
+        q.tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    void in_map_init(zm_input_map& m, uint8_t pad_base)
+    {
+        m.bindings.clear();
+        memset(m.used, 0, sizeof(m.used));
+        m.uses_pad = false;
+        m.pad_base = pad_base;
+    }
+
+    void in_map_add(zm_input_map& m, uint8_t event, const uint8_t* keys, size_t n)
+    {
+        if (!n)
+            return;
+
+        zm_input_binding b = {};
+        b.event = event;
+        b.n = (uint8_t)(n < ZM_IN_MAX_COMBO ? n : ZM_IN_MAX_COMBO);
+        b.down = true;
+        for (uint8_t i = 0; i < b.n; ++i) {
+            b.keys[i] = keys[i];
+            in_set_key(m.used, keys[i]);
+            if (keys[i] >= m.pad_base)
+                m.uses_pad = true;
+        }
+        m.bindings.push_back(b);
+    }
+
+    int in_map_edges(zm_input_map& m, const uint8_t down[32], zm_input_queue* queues)
+    {
+        int pushed = 0;
+        for (zm_input_binding& b : m.bindings) {
+            bool all = true;
+            for (uint8_t i = 0; i < b.n && all; ++i)
+                all = in_key(down, b.keys[i]);
+
+            if (all && !b.down)
+                pushed += in_push(queues[in_event_queue(b.event)], b.event);
+            b.down = all;
+        }
+        return pushed;
+    }
+
+} // namespace ZeroMod
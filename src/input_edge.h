@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// ---- Hotkey edge detection and event queues ----
+// The input thread samples every key the configured combos use into a
+// 256-bit "down" map (keyboard VKs, plus the XINPUT_VK_* codes for the
+// pad), and in_map_edges turns a combo going from up to down into one
+// event. Events go into single-producer/single-consumer rings, one per
+// consumer: the render thread drains toggles, the Logger drains its own.
+// An empty drain is one acquire load. Nothing in here calls the OS, so
+// tools/zm_input_bench.cpp can drive it on Linux.
+// Keys per combo; longer combos are cut
+#define ZM_IN_MAX_COMBO 8
+// Events per queue (power of two); past this, events are dropped
+#define ZM_IN_QUEUE_SIZE 64
+
+static_assert((ZM_IN_QUEUE_SIZE & (ZM_IN_QUEUE_SIZE - 1)) == 0, "ZM_IN_QUEUE_SIZE must be a power of two");
+
+namespace ZeroMod {
+
+    enum zm_input_event : uint8_t {
+        ZM_IN_SHADER_TOGGLE,
+        ZM_IN_FLASH_KILL,
+        ZM_IN_TRANSPARENT_CUTSCENES,
+        ZM_IN_LOG_TOGGLE,
+        ZM_IN_LOG_FRAME,
+        ZM_IN_EVENT_COUNT
+    };
+
+    enum zm_input_queue_id {
+        ZM_IN_Q_RENDER,     // toggles
+        ZM_IN_Q_LOG,        // Logger hotkeys
+        ZM_IN_QUEUE_COUNT
+    };
+
+    struct zm_input_queue
+    {
+        alignas(64) std::atomic<uint32_t> head;     // producer
+        alignas(64) std::atomic<uint32_t> tail;     // consumer
+        std::atomic<uint32_t> dropped;
+        uint8_t events[ZM_IN_QUEUE_SIZE];
+    };
+
+    struct zm_input_binding
+    {
+        uint8_t event;
+        uint8_t n;
+        uint8_t keys[ZM_IN_MAX_COMBO];
+        bool down;
+    };
+
+    struct zm_input_map
+    {
+        std::vector<zm_input_binding> bindings;
+        uint8_t used[32];       // every key some combo needs
+        bool uses_pad;          // some combo needs a code >= pad_base
+        uint8_t pad_base;
+    };
+
+    void in_queue_init(zm_input_queue& q);
+    // Producer side; false when the queue was full
+    bool in_push(zm_input_queue& q, uint8_t event);
+    // Consumer side; false when empty
+    bool in_pop(zm_input_queue& q, uint8_t& event);
+
+    // Codes >= pad_base are pad buttons
+    void in_map_init(zm_input_map& m, uint8_t pad_base);
+    // Empty combos are ignored. A new binding counts as held until it is
+    // first seen released, so a combo held across a reload doesn't fire.
+    void in_map_add(zm_input_map& m, uint8_t event, const uint8_t* keys, size_t n);
+
+    static inline bool in_key(const uint8_t* map, uint8_t vk)
+    {
+        return (map[vk >> 3] >> (vk & 7)) & 1;
+    }
+
+    static inline void in_set_key(uint8_t* map, uint8_t vk)
+    {
+        map[vk >> 3] |= (uint8_t)(1 << (vk & 7));
+    }
+
+    // Pushes an event for every combo that went down since the last call
+    // into the queue its event belongs to; returns how many
+    int in_map_edges(zm_input_map& m, const uint8_t down[32], zm_input_queue* queues);
+
+    static inline int in_event_queue(uint8_t event)
+    {
+        return event >= ZM_IN_LOG_TOGGLE ? ZM_IN_Q_LOG : ZM_IN_Q_RENDER;
+    }
+
+} // namespace ZeroMod
@@ -2,6 +2,7 @@
 #include "globals.h"
 #include "overlay.h"
 #include "conf.h"
+#include "input.h"
 #include <d3d9types.h>
 #include "d3d9buffer.h"
 #include "d3d9texture1d.h"
@@ -11,6 +12,8 @@
 #include "d3d9depthstencilview.h"
 #include "d3d9inputlayout.h"
 #include "MyID3DIndexBuffer9.h"
+#include "log_ring.h"
+#include <atomic>
 #include <map>
 #include <string>
 
@@ -26,6 +29,41 @@
 #include "../HLSLcc/include/hlslcc.h"
 #pragma GCC diagnostic pop
 
+// Longest record; the rest of a longer one is cut off
+#define LOG_RECORD_LEN 4096
+// Writer wakes at least this often between frames
+#define LOG_FLUSH_MS 100
+// How long stopping waits for the writer's last write
+#define LOG_STOP_WAIT_MS 2000
+
+namespace {
+    // Fixed buffer a record is formatted into, so logging doesn't allocate
+    class LogRecordBuf : public std::streambuf {
+        alignas(4) char b[LOG_RECORD_LEN];
+
+    public:
+        LogRecordBuf() { reset(0); }
+        // reserve: header bytes in front of the text. The tail is kept
+        // back for the newline and padding log_end adds.
+        void reset(size_t reserve) { setp(b + reserve, b + sizeof(b) - 4); }
+        char* data() { return b; }
+        size_t size() const { return pptr() - b; }
+    };
+
+    struct LogThread {
+        LogRecordBuf buf;
+        std::ostream os;
+        bool busy;
+        LogThread() : os(&buf), busy(false) {}
+    };
+
+    std::atomic<UINT> logger_ids{ 0 };
+
+    // Slot of the calling thread in the logger that last saw it
+    thread_local UINT log_thread_owner = 0;
+    thread_local int log_thread_slot = -1;
+}
+
 class Logger::Impl {
 public:
     Impl(LPCTSTR file_name, Config* config, Overlay* overlay);
@@ -33,6 +71,8 @@ public:
 
     bool log_begin(Logger* outer);
     void log_end(Logger* outer);
+    void log_bin_write(uint8_t* rec, size_t n);
+    std::ostream& stream();
 
     void set_overlay(Overlay* overlay);
     void set_config(Config* config);
@@ -43,27 +83,38 @@ private:
     bool file_init();
     void file_shutdown();
     void update_config();
-
-    bool hotkey_active(const std::vector<BYTE>& vks) const;
+    bool start();
+    void stop();
+    bool writer_reap(DWORD wait_ms);
+    int thread_slot();
+    void writer();
+    static DWORD WINAPI writer_proc(LPVOID param);
 
     LPCTSTR file_name;
     Config* config;
+    int config_reader;
     Overlay* overlay;
-    bool started;
+    const UINT id;
+    std::atomic<bool> started;
     UINT64 start_count;
-    UINT64 frame_count;
+    std::atomic<UINT64> frame_count;
     HANDLE file;
-    std::ostringstream oss;
-    cs_wrapper oss_cs;
+
+    ZeroMod::zm_log_rings rings;
+    LogThread* threads[ZM_LOG_MAX_THREADS];
+    HANDLE writer_thread;
+    HANDLE writer_wake;
+    HANDLE writer_done;
+    std::atomic<bool> writer_stop;
+    char* staging;
+    uint32_t bin_defs;      // binary call sites already described in the file
 
     bool log_enabled;
-    bool log_toggle_hotkey_active;
-    bool log_frame_hotkey_active;
     bool log_frame_active;
 };
 
 Logger::Logger(LPCTSTR file_name, Config* config, Overlay* overlay)
-    : impl(new Impl(file_name, config, overlay)), oss(std::cout) {}
+    : impl(new Impl(file_name, config, overlay)) {}
 
 Logger::~Logger() {
     delete impl;
@@ -98,7 +149,7 @@ void Logger::log_item(PIXEL_SHADER_ALPHA_DISCARD item) const {
 }
 
 void Logger::log_item(const ShaderLogger& a) const {
-    oss << "Shader Source: " << a.source << "\n";
+    oss() << "Shader Source: " << a.source << "\n";
 }
 
 void Logger::set_overlay(Overlay* overlay) {
@@ -125,6 +176,14 @@ void Logger::log_end() {
     impl->log_end(this);
 }
 
+void Logger::log_bin_write(uint8_t* rec, size_t n) {
+    impl->log_bin_write(rec, n);
+}
+
+std::ostream& Logger::oss() const {
+    return impl->stream();
+}
+
 void Logger::log_assign() const {
     log_item(" = ");
 }
@@ -207,13 +266,13 @@ void Logger::log_null() const {
 
 template<>
 void Logger::log_item(bool a) const {
-    oss << std::boolalpha << a;
-    oss.flags(std::ios::fmtflags{});
+    oss() << std::boolalpha << a;
+    oss().flags(std::ios::fmtflags{});
 }
 
 template<>
 void Logger::log_item(CHAR a) const {
-    oss << a;
+    oss() << a;
 }
 
 template<>
@@ -224,7 +283,7 @@ void Logger::log_item(WCHAR a) const {
 
 template<>
 void Logger::log_item(LPCSTR a) const {
-    oss << a;
+    oss() << a;
 }
 
 
@@ -366,45 +425,181 @@ void Logger::log_item(LPCWSTR a) const {
 }
 
 void Logger::log_item(const std::string& a) const {
-    oss << a;
+    oss() << a;
 }
 
 Logger::Impl::Impl(LPCTSTR file_name, Config* config, Overlay* overlay)
-    : file_name(file_name), config(config), overlay(overlay),
-    started(false), start_count(0), frame_count(0),
-    file(INVALID_HANDLE_VALUE), log_enabled(false),
-    log_toggle_hotkey_active(false), log_frame_hotkey_active(false),
+    : file_name(file_name), config(config),
+    config_reader(config ? config->attach_reader() : -1), overlay(overlay),
+    id(++logger_ids), started(false), start_count(0), frame_count(0),
+    file(INVALID_HANDLE_VALUE), threads(),
+    writer_thread(NULL), writer_wake(NULL), writer_done(NULL),
+    writer_stop(false), staging(nullptr), bin_defs(0), log_enabled(false),
     log_frame_active(false) {
+    ZeroMod::lr_init(rings, ZM_LOG_FULL_POLICY);
+#if ZM_LOG_BINARY
+    rings.drop_note = ZeroMod::lb_drop_note;
+#endif
     update_config();
 }
 
 Logger::Impl::~Impl() {
+    stop();
     file_shutdown();
+    ZeroMod::lr_free(rings);
+    if (config) config->detach_reader(config_reader);
+    for (LogThread* t : threads) delete t;
+}
+
+int Logger::Impl::thread_slot() {
+    if (log_thread_owner != id) {
+        log_thread_owner = id;
+        log_thread_slot = ZeroMod::lr_attach(rings, GetCurrentThreadId());
+        // Only ever touched by the thread owning the slot
+        if (log_thread_slot >= 0 && !threads[log_thread_slot])
+            threads[log_thread_slot] = new LogThread;
+    }
+    return log_thread_slot;
+}
+
+std::ostream& Logger::Impl::stream() {
+    // Outside a record (or on a thread without a ring) items go where they always did
+    if (log_thread_owner == id && log_thread_slot >= 0) {
+        LogThread* t = threads[log_thread_slot];
+        if (t && t->busy) return t->os;
+    }
+    return std::cout;
 }
 
 bool Logger::Impl::log_begin(Logger* outer) {
     if (!started) return false;
-    oss_cs.begin_cs();
-    if (oss.tellp() || (file == INVALID_HANDLE_VALUE && !file_init())) {
-        oss_cs.end_cs();
+    const int slot = thread_slot();
+    if (slot < 0) {
+        rings.overflow.fetch_add(1, std::memory_order_relaxed);
         return false;
     }
-    outer->log_item("("); 
-    outer->log_item(")("); 
-    outer->log_item(static_cast<DWORD>(GetCurrentThreadId()));
-    outer->log_item(")");
+    LogThread* t = threads[slot];
+    if (t->busy) return false;
+    t->busy = true;
+    t->os.clear();
+#if ZM_LOG_BINARY
+    // Thread and frame go in the TEXT record header
+    t->buf.reset(4 + sizeof(ZeroMod::zm_lb_call));
+#else
+    t->buf.reset(0);
+    t->os << '(' << frame_count.load(std::memory_order_relaxed) << ")(" << GetCurrentThreadId() << ") ";
+#endif
     return true;
 }
 
 void Logger::Impl::log_end(Logger* outer) {
-    DWORD written = 0;
-    std::ostringstream::pos_type len = oss.tellp();
-    if (len != -1) {
-        WriteFile(file, oss.str().c_str(), len, &written, NULL);
+    const int slot = log_thread_slot;
+    LogThread* t = threads[slot];
+    char* b = t->buf.data();
+    size_t len = t->buf.size();
+    b[len++] = '\n';
+#if ZM_LOG_BINARY
+    const size_t bytes = ZeroMod::lb_pad((uint32_t)len);
+    memset(b + len, 0, bytes - len);
+    const uint32_t head = ZeroMod::lb_head(ZeroMod::ZM_LB_OP_TEXT, (uint32_t)bytes);
+    const ZeroMod::zm_lb_call c = { 0, 0, 0, (uint32_t)GetCurrentThreadId(), (uint32_t)frame_count.load(std::memory_order_relaxed) };
+    memcpy(b, &head, 4);
+    memcpy(b + 4, &c, sizeof(c));
+    len = bytes;
+#endif
+    ZeroMod::lr_write(rings, slot, b, len);
+    t->busy = false;
+}
+
+void Logger::Impl::log_bin_write(uint8_t* rec, size_t n) {
+    const int slot = thread_slot();
+    if (slot < 0) {
+        rings.overflow.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ZeroMod::zm_lb_call c;
+    memcpy(&c, rec + 4, sizeof(c));
+    c.tid = GetCurrentThreadId();
+    c.frame = (uint32_t)frame_count.load(std::memory_order_relaxed);
+    memcpy(rec + 4, &c, sizeof(c));
+    ZeroMod::lr_write(rings, slot, (const char*)rec, n);
+}
+
+bool Logger::Impl::start() {
+    if (started) return true;
+    // A writer stop() gave up on may still be draining; a second one on
+    // the same rings would race it
+    if (writer_thread && !writer_reap(0)) return false;
+    if (!file_init()) return false;
+
+    staging = new char[ZM_LOG_WRITE_BYTES];
+    writer_wake = CreateEvent(NULL, FALSE, FALSE, NULL);
+    writer_done = CreateEvent(NULL, TRUE, FALSE, NULL);
+    writer_stop = false;
+    rings.closed.store(false);
+    writer_thread = writer_wake && writer_done ? CreateThread(NULL, 0, writer_proc, this, 0, NULL) : NULL;
+    if (!writer_thread) {
+        if (writer_wake) CloseHandle(writer_wake);
+        if (writer_done) CloseHandle(writer_done);
+        writer_wake = writer_done = NULL;
+        delete[] staging;
+        staging = nullptr;
+        return false;
+    }
+    start_count = frame_count;
+    started = true;
+    return true;
+}
+
+void Logger::Impl::stop() {
+    if (!writer_thread) return;
+    started = false;
+    // Blocked producers give up instead of waiting on a writer that's leaving
+    rings.closed.store(true);
+    writer_stop = true;
+    SetEvent(writer_wake);
+    // Writer is wedged: keep its handles and buffer, start() reaps them once
+    // it says it's done, and refuses to start another until then
+    writer_reap(LOG_STOP_WAIT_MS);
+}
+
+bool Logger::Impl::writer_reap(DWORD wait_ms) {
+    // Not the thread handle: under the loader lock (DLL detach) the thread
+    // can't finish exiting, but it can still say it's done writing
+    if (WaitForSingleObject(writer_done, wait_ms) != WAIT_OBJECT_0) return false;
+    CloseHandle(writer_thread);
+    CloseHandle(writer_wake);
+    CloseHandle(writer_done);
+    writer_thread = writer_wake = writer_done = NULL;
+    delete[] staging;
+    staging = nullptr;
+    return true;
+}
+
+DWORD WINAPI Logger::Impl::writer_proc(LPVOID param) {
+    static_cast<Impl*>(param)->writer();
+    return 0;
+}
+
+void Logger::Impl::writer() {
+    for (;;) {
+        WaitForSingleObject(writer_wake, LOG_FLUSH_MS);
+        const bool last = writer_stop;
+        size_t len;
+#if ZM_LOG_BINARY
+        // Call sites first, so a decoder reading front to back mostly has them
+        if ((len = ZeroMod::lb_encode_defs(&bin_defs, staging, ZM_LOG_WRITE_BYTES))) {
+            DWORD written = 0;
+            WriteFile(file, staging, (DWORD)len, &written, NULL);
+        }
+#endif
+        while ((len = ZeroMod::lr_drain(rings, staging, ZM_LOG_WRITE_BYTES))) {
+            DWORD written = 0;
+            WriteFile(file, staging, (DWORD)len, &written, NULL);
+        }
+        if (last) break;
     }
-    oss.clear();
-    oss.seekp(0);
-    oss_cs.end_cs();
+    SetEvent(writer_done);
 }
 
 bool Logger::Impl::file_init() {
@@ -413,6 +608,11 @@ bool Logger::Impl::file_init() {
     if (file == INVALID_HANDLE_VALUE) {
         return false;
     }
+#if ZM_LOG_BINARY
+    const ZeroMod::zm_lb_file_header h = { ZM_LB_MAGIC, ZM_LB_VERSION, sizeof(h), 0 };
+    DWORD written = 0;
+    WriteFile(file, &h, sizeof(h), &written, NULL);
+#endif
     return true;
 }
 
@@ -426,58 +626,49 @@ void Logger::Impl::file_shutdown() {
 void Logger::Impl::update_config() {
     if (log_frame_active) {
         log_frame_active = false;
+        if (!log_enabled) stop();
     }
 
-    if (!config) return;
-    config->begin_config();
+    const ConfigValues* c = config ? config->snapshot(config_reader) : nullptr;
+    if (!c) return;
 
-    if (log_enabled != config->logging_enabled) {
-        if ((log_enabled = config->logging_enabled)) {
+    if (log_enabled != c->logging_enabled) {
+        if ((log_enabled = c->logging_enabled)) {
             if (!get_started()) {
+                start();
             }
         }
         else {
             if (get_started()) {
+                stop();
             }
         }
     }
 
-    if (config->hwnd.load() != GetForegroundWindow()) goto end;
-    if (hotkey_active(config->log_toggle_hotkey)) {
-        if (!log_toggle_hotkey_active) {
-            log_toggle_hotkey_active = true;
+    // Presses of the [logging] hotkeys, edge-detected by the input thread
+    BYTE event;
+    while (default_input && default_input->next_event(ZeroMod::ZM_IN_Q_LOG, event)) {
+        if (config->hwnd.load() != GetForegroundWindow()) continue;
+        if (event == ZeroMod::ZM_IN_LOG_TOGGLE) {
             if (!get_started()) {
+                start();
             }
             else {
+                stop();
             }
         }
-    }
-    else {
-        log_toggle_hotkey_active = false;
-    }
-    if (hotkey_active(config->log_frame_hotkey)) {
-        if (!log_frame_hotkey_active) {
-            log_frame_hotkey_active = true;
+        else if (event == ZeroMod::ZM_IN_LOG_FRAME) {
+            if (!get_started()) {
+                log_frame_active = start();
+            }
         }
     }
-    else {
-        log_frame_hotkey_active = false;
-    }
-
-end:
-    config->end_config();
-}
-
-bool Logger::Impl::hotkey_active(const std::vector<BYTE>& vks) const {
-    if (!vks.size()) return false;
-    for (BYTE vk : vks) {
-        if (!GetAsyncKeyState(vk)) return false;
-    }
-    return true;
 }
 
 void Logger::Impl::set_config(Config* config) {
+    if (this->config) this->config->detach_reader(config_reader);
     this->config = config;
+    config_reader = config ? config->attach_reader() : -1;
     update_config();
 }
 
@@ -490,5 +681,25 @@ bool Logger::Impl::get_started() const {
 }
 
 void Logger::Impl::next_frame() {
-    frame_count++;
+    const UINT64 frame = ++frame_count;
+    if (started) {
+        // Frame delimiter, then hand the frame to the writer in one go
+        const int slot = thread_slot();
+        if (slot >= 0) {
+#if ZM_LOG_BINARY
+            char b[4 + sizeof(ZeroMod::zm_lb_frame)];
+            const uint32_t head = ZeroMod::lb_head(ZeroMod::ZM_LB_OP_FRAME, sizeof(b));
+            const ZeroMod::zm_lb_frame f = { (uint32_t)frame };
+            memcpy(b, &head, 4);
+            memcpy(b + 4, &f, sizeof(f));
+            ZeroMod::lr_write(rings, slot, b, sizeof(b));
+#else
+            char b[64];
+            int len = _snprintf(b, sizeof(b), "---- frame %llu ----\n", (unsigned long long)frame);
+            if (len > 0) ZeroMod::lr_write(rings, slot, b, len);
+#endif
+        }
+        SetEvent(writer_wake);
+    }
+    update_config();
 }
\ No newline at end of file
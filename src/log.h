@@ -19,6 +19,7 @@
 #include "d3d9vertexshader.h"
 #include "d3d9pixelshader.h"
 #include "globals.h"
+#include "log_bin.h"
 
 #include "half/include/half.hpp"
 
@@ -61,7 +62,14 @@ class Logger;
 // Logger Macros
 #define LOG_STARTED ((default_logger) && (default_logger)->get_started())
 #define LOG_FUN(_, ...) do { if LOG_STARTED (default_logger)->log_fun(std::string(__FILE__) + ":" + __func__, ## __VA_ARGS__); } while (0)
+#if ZM_LOG_BINARY
+// Call site id on first use, raw argument values after that (log_bin.h)
+#define LOG_MFUN_DEF(n, ...) do { if LOG_STARTED { \
+    static const uint16_t zm_lb_id = Logger::log_bin_register(#n "::", __func__, LOG_ARG(this), ## __VA_ARGS__); \
+    (default_logger)->log_bin(zm_lb_id, LOG_ARG(this), ## __VA_ARGS__); } } while (0)
+#else
 #define LOG_MFUN_DEF(n, ...) do { if LOG_STARTED (default_logger)->log_fun(std::string(#n "::") + __func__, LOG_ARG(this), ## __VA_ARGS__); } while (0)
+#endif
 
 #else
 
@@ -339,13 +347,57 @@ struct UInt {
     explicit UInt(unsigned int v) : value(v) {}
 };
 
+// Binary encodings of the wrapper types, decoded the way their log_item prints them
+namespace ZeroMod {
+    template<class T>
+    struct zm_lb_enc<NumHexLogger<T>> {
+        using V = std::conditional_t<std::is_pointer_v<T>, uint64_t, T>;
+        static constexpr zm_lb_arg_type type() { return { ZM_LB_T_HEX, (uint8_t)sizeof(V) }; }
+        static uint8_t* put(uint8_t* p, uint8_t* end, const NumHexLogger<T>& v) {
+            if constexpr (std::is_pointer_v<T>)
+                return lb_put_raw(p, end, (uint64_t)(uintptr_t)v.a);
+            else
+                return lb_put_raw(p, end, v.a);
+        }
+    };
+
+    template<int L, class T>
+    struct zm_lb_enc<NumLenLoggerBase<L, T>> : zm_lb_enc<T> {
+        static uint8_t* put(uint8_t* p, uint8_t* end, const NumLenLoggerBase<L, T>& v) { return zm_lb_enc<T>::put(p, end, v.a); }
+    };
+
+    template<class T>
+    struct zm_lb_enc<DefaultLogger<T>> : zm_lb_enc<T> {
+        static uint8_t* put(uint8_t* p, uint8_t* end, const DefaultLogger<T>& v) { return zm_lb_enc<T>::put(p, end, v.a); }
+    };
+
+    template<>
+    struct zm_lb_enc<StringLogger> : zm_lb_enc<const char*> {
+        static uint8_t* put(uint8_t* p, uint8_t* end, const StringLogger& v) { return zm_lb_enc<const char*>::put(p, end, v.a); }
+    };
+
+    template<>
+    struct zm_lb_enc<CharLogger> : zm_lb_enc<char> {
+        static uint8_t* put(uint8_t* p, uint8_t* end, const CharLogger& v) { return zm_lb_enc<char>::put(p, end, v.a); }
+    };
+
+    template<>
+    struct zm_lb_enc<GUID> {
+        static constexpr zm_lb_arg_type type() { return { ZM_LB_T_GUID, 16 }; }
+        static uint8_t* put(uint8_t* p, uint8_t* end, const GUID& v) { return lb_put_raw(p, end, v); }
+    };
+}
+
 class Logger {
     class Impl;
     Impl* impl;
-    std::ostream& oss;
+    // The calling thread's record between log_begin and log_end
+    std::ostream& oss() const;
 
     bool log_begin();
     void log_end();
+    // Fills in thread and frame and queues a CALL record
+    void log_bin_write(uint8_t* rec, size_t n);
 
     void log_assign() const;
     void log_sep() const;
@@ -434,7 +486,7 @@ class Logger {
 
     template<class T>
     std::enable_if_t<std::is_arithmetic_v<T>> log_item(T a) const {
-        oss << +a;
+        oss() << +a;
     }
 
     void log_item(bool a) const;
@@ -457,14 +509,14 @@ class Logger {
 
     template<int L, class T>
     void log_item(NumLenLoggerBase<L, T> a) const {
-        oss << std::setfill('0') << std::setw(L) << +a.a;
-        oss.flags(std::ios::fmtflags{});
+        oss() << std::setfill('0') << std::setw(L) << +a.a;
+        oss().flags(std::ios::fmtflags{});
     }
 
     template<class T>
     void log_item(NumHexLogger<T> a) const {
-        oss << std::hex << std::showbase << +a.a;
-        oss.flags(std::ios::fmtflags{});
+        oss() << std::hex << std::showbase << +a.a;
+        oss().flags(std::ios::fmtflags{});
     }
 
     template<class T>
@@ -473,12 +525,13 @@ class Logger {
         UINT n = sizeof(a.a);
         UINT bits = std::numeric_limits<BYTE>::digits;
         BYTE m = (BYTE)1 << (bits - 1);
-        oss << "0b";
+        std::ostream& os = oss();
+        os << "0b";
         for (UINT i = n; i > 0;) {
             --i;
             BYTE c = b[i];
             for (UINT j = 0; j < bits; ++j) {
-                oss << (c & m ? "1" : "0");
+                os << (c & m ? "1" : "0");
                 c <<= 1;
             }
         }
@@ -599,6 +652,22 @@ public:
     bool get_started() const;
     void next_frame();
 
+    // Binary LOG_MFUN backend (log_bin.h)
+    template<class... Ts>
+    static uint16_t log_bin_register(LPCSTR cls, LPCSTR fun, const Ts&... as) {
+        ZeroMod::zm_lb_event ev = {};
+        ev.cls = cls;
+        ev.fun = fun;
+        ZeroMod::lb_describe(ev, as...);
+        return ZeroMod::lb_register(ev);
+    }
+    template<class... Ts>
+    void log_bin(uint16_t id, const Ts&... as) {
+        if (!id) return;
+        alignas(4) uint8_t b[ZM_LB_MAX_RECORD];
+        log_bin_write(b, ZeroMod::lb_encode_call(b, id, as...));
+    }
+
     public:
         void log_error(const char* msg) {
             log_item("LOG_ERROR");
@@ -0,0 +1,100 @@
+#include "log_bin.h"
+
+#include <atomic>
+
+namespace ZeroMod {
+
+    struct zm_lb_slot
+    {
+        zm_lb_event ev;
+        std::atomic<bool> ready;
+    };
+
+    static zm_lb_slot g_lb_events[ZM_LB_MAX_EVENTS];
+    static std::atomic<uint32_t> g_lb_claimed{ 0 };
+
+    uint16_t lb_register(const zm_lb_event& ev)
+    {
+        // Called from a function-local static's initializer, so once per call site
+        const uint32_t i = g_lb_claimed.fetch_add(1, std::memory_order_relaxed);
+        if (i >= ZM_LB_MAX_EVENTS)
+            return 0;
+        g_lb_events[i].ev = ev;
+        g_lb_events[i].ready.store(true, std::memory_order_release);
+        return (uint16_t)(i + 1);
+    }
+
+    static size_t lb_put_name(char* out, size_t cap, size_t n, const char* s)
+    {
+        const size_t len = s ? strlen(s) : 0;
+        if (n + len + 1 > cap)
+            return 0;
+        memcpy(out + n, s, len);
+        out[n + len] = '\0';
+        return n + len + 1;
+    }
+
+    static size_t lb_encode_def(const zm_lb_event& ev, uint16_t id, char* out, size_t cap)
+    {
+        zm_lb_def d;
+        memset(&d, 0, sizeof(d));
+        d.id = id;
+        d.argc = ev.argc;
+        memcpy(d.args, ev.types, sizeof(d.args));
+
+        size_t n = 4 + sizeof(d);
+        if (n > cap)
+            return 0;
+        memcpy(out + 4, &d, sizeof(d));
+
+        // "Class::" and __func__ go in as one name
+        const size_t cls = ev.cls ? strlen(ev.cls) : 0;
+        if (n + cls > cap)
+            return 0;
+        memcpy(out + n, ev.cls, cls);
+        n = lb_put_name(out, cap, n + cls, ev.fun);
+        for (unsigned a = 0; a < ev.argc && n; ++a)
+            n = lb_put_name(out, cap, n, ev.names[a]);
+
+        const size_t bytes = n ? lb_pad((uint32_t)n) : 0;
+        if (!bytes || bytes > cap)
+            return 0;
+        memset(out + n, 0, bytes - n);
+        const uint32_t head = lb_head(ZM_LB_OP_DEF, (uint32_t)bytes);
+        memcpy(out, &head, 4);
+        return bytes;
+    }
+
+    size_t lb_encode_defs(uint32_t* emitted, char* out, size_t cap)
+    {
+        size_t n = 0;
+        uint32_t claimed = g_lb_claimed.load(std::memory_order_relaxed);
+        if (claimed > ZM_LB_MAX_EVENTS)
+            claimed = ZM_LB_MAX_EVENTS;
+
+        for (uint32_t i = *emitted; i < claimed; ++i) {
+            // A call site still filling its slot comes out next time
+            if (!g_lb_events[i].ready.load(std::memory_order_acquire))
+                break;
+            const size_t w = lb_encode_def(g_lb_events[i].ev, (uint16_t)(i + 1), out + n, cap - n);
+            if (!w)
+                break;
+            n += w;
+            *emitted = i + 1;
+        }
+        return n;
+    }
+
+    size_t lb_drop_note(char* out, size_t cap, uint64_t dropped)
+    {
+        const uint32_t bytes = 4 + sizeof(zm_lb_dropped);
+        if (cap < bytes)
+            return 0;
+        const uint32_t head = lb_head(ZM_LB_OP_DROPPED, bytes);
+        const zm_lb_dropped d = { (uint32_t)(dropped > UINT32_MAX ? UINT32_MAX : dropped) };
+        memcpy(out, &head, 4);
+        memcpy(out + 4, &d, sizeof(d));
+        return bytes;
+    }
+
+} // namespace ZeroMod
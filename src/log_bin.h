@@ -0,0 +1,204 @@
+#pragma once
+#include "log_bin_format.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+
+// ---- Binary LOG_MFUN backend ----
+// With ZM_LOG_BINARY a LOG_MFUN call doesn't format anything: its call
+// site registers once (a function-local static, so the id is fixed for
+// the run) and every call after that memcpys the raw argument values into
+// a CALL record for the logger's rings. tools/zm_log_decode.cpp turns the
+// file back into the text the logger would have written. zm_lb_enc<T>
+// picks the stored form per argument type; log.h adds the wrapper types
+// (NumHexLogger, StringLogger, ...). Types it doesn't know are stored
+// raw when small and trivially copyable, otherwise by address.
+// Off by default: the log stays plain text. Set ZM_LOG_BINARY to 1 for the
+// binary path when LOG_MFUN formatting shows up in a profile.
+#define ZM_LOG_BINARY 0
+// Call sites per run
+#define ZM_LB_MAX_EVENTS 1024
+
+namespace ZeroMod {
+
+    struct zm_lb_event
+    {
+        const char* cls;                // "Class::" (string literal)
+        const char* fun;                // __func__
+        uint8_t argc;
+        zm_lb_arg_type types[ZM_LB_MAX_ARGS];
+        const char* names[ZM_LB_MAX_ARGS];
+    };
+
+    // Id of the call site (1-based), 0 once the table is full
+    uint16_t lb_register(const zm_lb_event& ev);
+
+    // Writer side: DEF records for call sites registered since *emitted
+    size_t lb_encode_defs(uint32_t* emitted, char* out, size_t cap);
+    // DROPPED record, for zm_log_rings::drop_note
+    size_t lb_drop_note(char* out, size_t cap, uint64_t dropped);
+
+    // ---- argument encodings ----
+    template<class T>
+    inline uint8_t* lb_put_raw(uint8_t* p, uint8_t* end, const T& v)
+    {
+        if ((size_t)(end - p) < sizeof(v))
+            return nullptr;
+        memcpy(p, &v, sizeof(v));
+        return p + sizeof(v);
+    }
+
+    inline uint8_t* lb_put_str(uint8_t* p, uint8_t* end, const char* s, size_t n)
+    {
+        if (!s) {
+            if (p == end)
+                return nullptr;
+            *p = 0xFF;
+            return p + 1;
+        }
+        if (n > ZM_LB_MAX_STR - 1)
+            n = ZM_LB_MAX_STR - 1;
+        if ((size_t)(end - p) < n + 1)
+            return nullptr;
+        *p = (uint8_t)n;
+        memcpy(p + 1, s, n);
+        return p + 1 + n;
+    }
+
+    template<class T, class = void>
+    struct zm_lb_enc
+    {
+        // Small PODs are kept whole; anything else (interfaces, containers) by address
+        static constexpr bool raw = std::is_trivially_copyable_v<T> && sizeof(T) <= 64;
+        static constexpr zm_lb_arg_type type() { return raw ? zm_lb_arg_type{ ZM_LB_T_BYTES, (uint8_t)sizeof(T) } : zm_lb_arg_type{ ZM_LB_T_PTR, 8 }; }
+        static uint8_t* put(uint8_t* p, uint8_t* end, const T& v)
+        {
+            if constexpr (raw)
+                return lb_put_raw(p, end, v);
+            else
+                return lb_put_raw(p, end, (uint64_t)(uintptr_t)&v);
+        }
+    };
+
+    template<class T>
+    struct zm_lb_enc<T, std::enable_if_t<std::is_integral_v<T> || std::is_enum_v<T>>>
+    {
+        static constexpr zm_lb_arg_type type()
+        {
+            if constexpr (std::is_same_v<T, bool>)
+                return { ZM_LB_T_BOOL, 1 };
+            else if constexpr (std::is_same_v<T, char>)
+                return { ZM_LB_T_CHAR, 1 };
+            else if constexpr (std::is_enum_v<T>)
+                return { std::is_signed_v<std::underlying_type_t<T>> ? ZM_LB_T_INT : ZM_LB_T_UINT, (uint8_t)sizeof(T) };
+            else
+                return { std::is_signed_v<T> ? ZM_LB_T_INT : ZM_LB_T_UINT, (uint8_t)sizeof(T) };
+        }
+        static uint8_t* put(uint8_t* p, uint8_t* end, T v) { return lb_put_raw(p, end, v); }
+    };
+
+    template<class T>
+    struct zm_lb_enc<T, std::enable_if_t<std::is_floating_point_v<T>>>
+    {
+        static constexpr zm_lb_arg_type type() { return { ZM_LB_T_FLOAT, (uint8_t)sizeof(T) }; }
+        static uint8_t* put(uint8_t* p, uint8_t* end, T v) { return lb_put_raw(p, end, v); }
+    };
+
+    template<class T>
+    struct zm_lb_enc<T*>
+    {
+        static constexpr zm_lb_arg_type type() { return { ZM_LB_T_PTR, 8 }; }
+        static uint8_t* put(uint8_t* p, uint8_t* end, const T* v) { return lb_put_raw(p, end, (uint64_t)(uintptr_t)v); }
+    };
+
+    template<>
+    struct zm_lb_enc<const char*>
+    {
+        static constexpr zm_lb_arg_type type() { return { ZM_LB_T_STR, 0 }; }
+        static uint8_t* put(uint8_t* p, uint8_t* end, const char* v) { return lb_put_str(p, end, v, v ? strlen(v) : 0); }
+    };
+
+    template<>
+    struct zm_lb_enc<char*> : zm_lb_enc<const char*> {};
+
+    template<>
+    struct zm_lb_enc<const wchar_t*>
+    {
+        static constexpr zm_lb_arg_type type() { return { ZM_LB_T_STR, 0 }; }
+        static uint8_t* put(uint8_t* p, uint8_t* end, const wchar_t* v)
+        {
+            if (!v)
+                return lb_put_str(p, end, nullptr, 0);
+            // ASCII only; the decoder isn't the place for code pages
+            char b[ZM_LB_MAX_STR];
+            size_t n = 0;
+            for (; v[n] && n < sizeof(b) - 1; ++n)
+                b[n] = v[n] < 0x80 ? (char)v[n] : '?';
+            return lb_put_str(p, end, b, n);
+        }
+    };
+
+    template<>
+    struct zm_lb_enc<wchar_t*> : zm_lb_enc<const wchar_t*> {};
+
+    template<>
+    struct zm_lb_enc<std::string>
+    {
+        static constexpr zm_lb_arg_type type() { return { ZM_LB_T_STR, 0 }; }
+        static uint8_t* put(uint8_t* p, uint8_t* end, const std::string& v) { return lb_put_str(p, end, v.data(), v.size()); }
+    };
+
+    template<class T>
+    using zm_lb_enc_t = zm_lb_enc<std::remove_cv_t<std::decay_t<T>>>;
+
+    // ---- call sites ----
+    inline void lb_describe(zm_lb_event&) {}
+
+    template<class T, class... Ts>
+    inline void lb_describe(zm_lb_event& ev, const char* name, const T&, const Ts&... as)
+    {
+        if (ev.argc < ZM_LB_MAX_ARGS) {
+            ev.types[ev.argc] = zm_lb_enc_t<T>::type();
+            ev.names[ev.argc] = name;
+            ev.argc++;
+        }
+        lb_describe(ev, as...);
+    }
+
+    inline void lb_put_args(uint8_t*&, uint8_t*, unsigned&) {}
+
+    template<class T, class... Ts>
+    inline void lb_put_args(uint8_t*& p, uint8_t* end, unsigned& argc, const char*, const T& v, const Ts&... as)
+    {
+        if (argc >= ZM_LB_MAX_ARGS)
+            return;
+        uint8_t* q = zm_lb_enc_t<T>::put(p, end, v);
+        // Out of room: the record ends after the last argument that fit
+        if (!q)
+            return;
+        p = q;
+        argc++;
+        lb_put_args(p, end, argc, as...);
+    }
+
+    // CALL record for a registered call site into b[ZM_LB_MAX_RECORD]; tid
+    // and frame are left 0 for the logger to fill in. Returns the size.
+    template<class... Ts>
+    inline size_t lb_encode_call(uint8_t* b, uint16_t id, const Ts&... as)
+    {
+        uint8_t* p = b + 4 + sizeof(zm_lb_call);
+        unsigned argc = 0;
+        lb_put_args(p, b + ZM_LB_MAX_RECORD, argc, as...);
+
+        const zm_lb_call c = { id, (uint8_t)argc, 0, 0, 0 };
+        memcpy(b + 4, &c, sizeof(c));
+        const uint32_t bytes = lb_pad((uint32_t)(p - b));
+        memset(p, 0, b + bytes - p);
+        const uint32_t head = lb_head(ZM_LB_OP_CALL, bytes);
+        memcpy(b, &head, 4);
+        return bytes;
+    }
+
+} // namespace ZeroMod
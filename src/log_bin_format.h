@@ -0,0 +1,91 @@
+#pragma once
+#include <stdint.h>
+
+// ---- Binary log format ----
+// Shared by the logger (log_bin.h) and the offline decoder
+// (tools/zm_log_decode.cpp), so no D3D or Windows types in here.
+//
+// File: zm_lb_file_header, then records back to back. Every record starts
+// with a 32-bit head (opcode in the low 8 bits, record size in bytes
+// including the head in the high 24) and is padded to 4 bytes. A LOG_MFUN
+// call site is described once by a DEF record (name, argument names and
+// type codes) and after that costs a CALL record holding only the raw
+// argument values. DEF records can land after the first CALL that uses
+// them (rings drain in slot order), so decoders read all DEFs first.
+
+#define ZM_LB_MAGIC 0x424C4D5Au // "ZMLB"
+#define ZM_LB_VERSION 1
+// Arguments per call site (this included)
+#define ZM_LB_MAX_ARGS 16
+// Encoded CALL record; a call that doesn't fit is cut after its last whole argument
+#define ZM_LB_MAX_RECORD 512
+// Strings are stored up to this many bytes
+#define ZM_LB_MAX_STR 255
+
+namespace ZeroMod {
+
+    struct zm_lb_file_header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t header_bytes;          // sizeof(zm_lb_file_header)
+        uint32_t flags;
+    };
+
+    enum : uint8_t {
+        ZM_LB_OP_NOP = 0,
+        ZM_LB_OP_DEF,                   // zm_lb_def, then "name\0" and per argument "arg\0"
+        ZM_LB_OP_CALL,                  // zm_lb_call, then the argument values
+        ZM_LB_OP_TEXT,                  // zm_lb_call (id 0), then a text record as the text logger would write it
+        ZM_LB_OP_FRAME,                 // zm_lb_frame
+        ZM_LB_OP_DROPPED,               // zm_lb_dropped
+        ZM_LB_OP_COUNT
+    };
+
+    // How an argument value is stored and printed
+    enum : uint8_t {
+        ZM_LB_T_NONE = 0,
+        ZM_LB_T_INT,                    // signed, size 1/2/4/8
+        ZM_LB_T_UINT,                   // unsigned, size 1/2/4/8
+        ZM_LB_T_HEX,                    // NumHexLogger: unsigned, printed 0x...
+        ZM_LB_T_FLOAT,                  // size 4/8
+        ZM_LB_T_BOOL,                   // 1 byte
+        ZM_LB_T_CHAR,                   // 1 byte
+        ZM_LB_T_PTR,                    // 8 bytes, printed like a pointer (NULL for 0)
+        ZM_LB_T_STR,                    // 1 byte length, then the bytes; size 0; 0xFF length = null
+        ZM_LB_T_GUID,                   // 16 bytes
+        ZM_LB_T_BYTES,                  // raw object of the given size, printed as a hex dump
+        ZM_LB_T_COUNT
+    };
+
+    struct zm_lb_arg_type
+    {
+        uint8_t code;                   // ZM_LB_T_*
+        uint8_t size;                   // stored bytes (0 for STR)
+    };
+
+    inline uint32_t lb_head(uint32_t op, uint32_t bytes) { return op | (bytes << 8); }
+    inline uint32_t lb_head_op(uint32_t head) { return head & 0xFF; }
+    inline uint32_t lb_head_bytes(uint32_t head) { return head >> 8; }
+    inline uint32_t lb_pad(uint32_t bytes) { return (bytes + 3) & ~3u; }
+
+    // Payloads (after the head word)
+    struct zm_lb_def
+    {
+        uint16_t id;
+        uint8_t argc;
+        uint8_t pad;
+        zm_lb_arg_type args[ZM_LB_MAX_ARGS];
+    };
+    struct zm_lb_call
+    {
+        uint16_t id;
+        uint8_t argc;                   // arguments actually stored
+        uint8_t pad;
+        uint32_t tid;
+        uint32_t frame;
+    };
+    struct zm_lb_frame { uint32_t frame; };
+    struct zm_lb_dropped { uint32_t records; };
+
+} // namespace ZeroMod
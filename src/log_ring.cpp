@@ -0,0 +1,142 @@
+#include "log_ring.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#define zm_lr_yield() SwitchToThread()
+#else
+#include <sched.h>
+#define zm_lr_yield() sched_yield()
+#endif
+
+namespace ZeroMod {
+
+    static size_t lr_text_drop_note(char* out, size_t cap, uint64_t dropped)
+    {
+        const int w = snprintf(out, cap, "[log] %llu records dropped (ring full)\n", (unsigned long long)dropped);
+        return w > 0 && (size_t)w < cap ? (size_t)w : 0;
+    }
+
+    void lr_init(zm_log_rings& lr, int policy)
+    {
+        for (uint32_t i = 0; i < ZM_LOG_MAX_THREADS; ++i)
+            lr.rings[i].store(nullptr, std::memory_order_relaxed);
+        lr.claimed.store(0, std::memory_order_relaxed);
+        lr.overflow.store(0, std::memory_order_relaxed);
+        lr.policy.store(policy, std::memory_order_relaxed);
+        lr.closed.store(false, std::memory_order_relaxed);
+        lr.reported = 0;
+        lr.drop_note = lr_text_drop_note;
+    }
+
+    void lr_free(zm_log_rings& lr)
+    {
+        for (uint32_t i = 0; i < ZM_LOG_MAX_THREADS; ++i)
+            delete lr.rings[i].exchange(nullptr, std::memory_order_acquire);
+        lr.claimed.store(0, std::memory_order_relaxed);
+    }
+
+    int lr_attach(zm_log_rings& lr, uint32_t tid)
+    {
+        // A thread that attached before keeps its ring
+        const uint32_t n = lr.claimed.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < n && i < ZM_LOG_MAX_THREADS; ++i) {
+            const zm_log_ring* r = lr.rings[i].load(std::memory_order_acquire);
+            if (r && r->tid == tid)
+                return (int)i;
+        }
+
+        const uint32_t slot = lr.claimed.fetch_add(1, std::memory_order_acq_rel);
+        if (slot >= ZM_LOG_MAX_THREADS)
+            return -1;
+
+        zm_log_ring* r = new (std::nothrow) zm_log_ring;
+        if (!r)
+            return -1;
+        r->head.store(0, std::memory_order_relaxed);
+        r->tail.store(0, std::memory_order_relaxed);
+        r->dropped.store(0, std::memory_order_relaxed);
+        r->tid = tid;
+        lr.rings[slot].store(r, std::memory_order_release);
+        return (int)slot;
+    }
+
+    bool lr_write(zm_log_rings& lr, int slot, const char* rec, size_t n)
+    {
+        zm_log_ring* r = slot >= 0 ? lr.rings[slot].load(std::memory_order_relaxed) : nullptr;
+        if (!r || n > ZM_LOG_RING_BYTES) {
+            lr.overflow.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        const uint32_t h = r->head.load(std::memory_order_relaxed);
+        for (;;) {
+            const uint32_t used = h - r->tail.load(std::memory_order_acquire);
+            if (ZM_LOG_RING_BYTES - used >= n)
+                break;
+            if (lr.policy.load(std::memory_order_relaxed) != ZM_LOG_BLOCK ||
+                lr.closed.load(std::memory_order_relaxed)) {
+                r->dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            zm_lr_yield();
+        }
+
+        const uint32_t at = h & (ZM_LOG_RING_BYTES - 1);
+        const size_t first = n < (size_t)(ZM_LOG_RING_BYTES - at) ? n : (size_t)(ZM_LOG_RING_BYTES - at);
+        memcpy(r->data + at, rec, first);
+        memcpy(r->data, rec + first, n - first);
+        r->head.store(h + (uint32_t)n, std::memory_order_release);
+        return true;
+    }
+
+    uint64_t lr_dropped(const zm_log_rings& lr)
+    {
+        uint64_t d = lr.overflow.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < ZM_LOG_MAX_THREADS; ++i) {
+            const zm_log_ring* r = lr.rings[i].load(std::memory_order_acquire);
+            if (r)
+                d += r->dropped.load(std::memory_order_relaxed);
+        }
+        return d;
+    }
+
+    size_t lr_drain(zm_log_rings& lr, char* out, size_t cap)
+    {
+        size_t n = 0;
+        for (uint32_t i = 0; i < ZM_LOG_MAX_THREADS; ++i) {
+            zm_log_ring* r = lr.rings[i].load(std::memory_order_acquire);
+            if (!r)
+                continue;
+
+            const uint32_t t = r->tail.load(std::memory_order_relaxed);
+            const uint32_t avail = r->head.load(std::memory_order_acquire) - t;
+            if (!avail)
+                continue;
+            // Whole rings only, so a record is never split across writes
+            if (avail > cap - n)
+                return n;
+
+            const uint32_t at = t & (ZM_LOG_RING_BYTES - 1);
+            const size_t first = avail < ZM_LOG_RING_BYTES - at ? avail : ZM_LOG_RING_BYTES - at;
+            memcpy(out + n, r->data + at, first);
+            memcpy(out + n + first, r->data, avail - first);
+            n += avail;
+            r->tail.store(t + avail, std::memory_order_release);
+        }
+
+        const uint64_t dropped = lr_dropped(lr);
+        if (dropped != lr.reported) {
+            const size_t w = lr.drop_note(out + n, cap - n, dropped - lr.reported);
+            if (w) {
+                n += w;
+                lr.reported = dropped;
+            }
+        }
+        return n;
+    }
+
+} // namespace ZeroMod
@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// ---- Per-thread log rings ----
+// Every thread that logs gets its own single-producer byte ring on its
+// first record, so producers never share a lock. A record is copied in
+// whole and only then published, and the writer thread drains whole
+// rings into one staging buffer that goes to the file in a single write,
+// so lines from different threads never interleave mid-record. When a
+// ring is full the record is dropped and counted (ZM_LOG_DROP) or the
+// producer yields until the writer makes room (ZM_LOG_BLOCK). Nothing in
+// here calls the OS besides a yield, so tools/zm_log_bench.cpp can drive
+// the rings on Linux.
+#define ZM_LOG_DROP 0
+#define ZM_LOG_BLOCK 1
+// What a full ring does
+#define ZM_LOG_FULL_POLICY ZM_LOG_DROP
+// Bytes per thread (power of two)
+#define ZM_LOG_RING_BYTES (256 * 1024)
+// Threads that can log; records from any thread past this are dropped
+#define ZM_LOG_MAX_THREADS 32
+// Staging buffer per write; at least one full ring
+#define ZM_LOG_WRITE_BYTES (1024 * 1024)
+
+static_assert((ZM_LOG_RING_BYTES & (ZM_LOG_RING_BYTES - 1)) == 0, "ZM_LOG_RING_BYTES must be a power of two");
+static_assert(ZM_LOG_WRITE_BYTES >= ZM_LOG_RING_BYTES, "a full ring must fit one write");
+
+namespace ZeroMod {
+
+    struct zm_log_ring
+    {
+        alignas(64) std::atomic<uint32_t> head;     // producer
+        alignas(64) std::atomic<uint32_t> tail;     // writer
+        std::atomic<uint32_t> dropped;
+        uint32_t tid;
+        char data[ZM_LOG_RING_BYTES];
+    };
+
+    struct zm_log_rings
+    {
+        std::atomic<zm_log_ring*> rings[ZM_LOG_MAX_THREADS];
+        std::atomic<uint32_t> claimed;      // slots handed out (may still be null while allocating)
+        std::atomic<uint32_t> overflow;     // records from threads without a slot
+        std::atomic<int> policy;
+        std::atomic<bool> closed;           // writer gone: ZM_LOG_BLOCK producers drop instead
+
+        // Writer only
+        uint64_t reported;                  // drops already noted in the output
+        // Writes the drop note for the file format in use; 0 when it doesn't fit
+        size_t (*drop_note)(char* out, size_t cap, uint64_t dropped);
+    };
+
+    // Drop notes default to a text line
+    void lr_init(zm_log_rings& lr, int policy);
+    // Writer must be stopped
+    void lr_free(zm_log_rings& lr);
+
+    // Slot of the ring owned by tid, claiming one on first use; -1 when
+    // every slot is taken. Callers cache the result per thread.
+    int lr_attach(zm_log_rings& lr, uint32_t tid);
+
+    // Producer side; false when the record was dropped
+    bool lr_write(zm_log_rings& lr, int slot, const char* rec, size_t n);
+
+    // Writer side: copies whole rings into out while they fit and returns
+    // the byte count; 0 once everything published has been taken. Notes
+    // new drops in the output as a line of its own.
+    size_t lr_drain(zm_log_rings& lr, char* out, size_t cap);
+
+    uint64_t lr_dropped(const zm_log_rings& lr);
+
+} // namespace ZeroMod
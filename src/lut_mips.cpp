@@ -0,0 +1,127 @@
+#include "lut_mips.h"
+
+#if ZM_LM_SIMD && defined(__SSE2__)
+#define ZM_LM_HAVE_SSE2 1
+#include <emmintrin.h>
+#else
+#define ZM_LM_HAVE_SSE2 0
+#endif
+
+namespace ZeroMod {
+
+    int lm_best_isa()
+    {
+        return ZM_LM_HAVE_SSE2 ? ZM_LM_SSE2 : ZM_LM_SCALAR;
+    }
+
+    const char* lm_isa_name(int isa)
+    {
+        return isa == ZM_LM_SSE2 ? "sse2" : "scalar";
+    }
+
+    unsigned lm_level_count(uint32_t w, uint32_t h)
+    {
+        unsigned n = 1;
+        while (w > 1 || h > 1) {
+            w = w > 1 ? w / 2 : 1;
+            h = h > 1 ? h / 2 : 1;
+            ++n;
+        }
+        return n;
+    }
+
+    size_t lm_chain_pixels(uint32_t w, uint32_t h, unsigned levels)
+    {
+        size_t n = 0;
+        for (unsigned l = 0; l < levels; ++l) {
+            n += (size_t)w * h;
+            w = w > 1 ? w / 2 : 1;
+            h = h > 1 ? h / 2 : 1;
+        }
+        return n;
+    }
+
+    static inline uint32_t lm_avg4(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+    {
+        uint32_t out = 0;
+        for (int s = 0; s < 32; s += 8) {
+            const uint32_t sum = (a >> s & 0xFF) + (b >> s & 0xFF) + (c >> s & 0xFF) + (d >> s & 0xFF);
+            out |= ((sum + 2) >> 2) << s;
+        }
+        return out;
+    }
+
+    // Destination pixels [x0, x1) of one row; r0/r1 are the two source rows
+    // (the same row when the source is one high)
+    static void lm_row_scalar(uint32_t* dst, const uint32_t* r0, const uint32_t* r1,
+        uint32_t sw, uint32_t x0, uint32_t x1)
+    {
+        for (uint32_t x = x0; x < x1; ++x) {
+            const uint32_t a = 2 * x, b = a + 1 < sw ? a + 1 : a;
+            dst[x] = lm_avg4(r0[a], r0[b], r1[a], r1[b]);
+        }
+    }
+
+#if ZM_LM_HAVE_SSE2
+    // Four destination pixels from eight source pixels per row
+    static uint32_t lm_row_sse2(uint32_t* dst, const uint32_t* r0, const uint32_t* r1, uint32_t dw)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16(2);
+        uint32_t x = 0;
+        for (; x + 4 <= dw; x += 4) {
+            const __m128i a0 = _mm_loadu_si128((const __m128i*)(r0 + 2 * x));
+            const __m128i a1 = _mm_loadu_si128((const __m128i*)(r0 + 2 * x + 4));
+            const __m128i b0 = _mm_loadu_si128((const __m128i*)(r1 + 2 * x));
+            const __m128i b1 = _mm_loadu_si128((const __m128i*)(r1 + 2 * x + 4));
+
+            // Vertical sums, two source pixels per register
+            const __m128i v0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+            const __m128i v1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+            const __m128i v2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+            const __m128i v3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+            // Horizontal pairs: low half of each register plus its high half
+            __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi64(v0, v1), _mm_unpackhi_epi64(v0, v1));
+            __m128i s1 = _mm_add_epi16(_mm_unpacklo_epi64(v2, v3), _mm_unpackhi_epi64(v2, v3));
+            s0 = _mm_srli_epi16(_mm_add_epi16(s0, two), 2);
+            s1 = _mm_srli_epi16(_mm_add_epi16(s1, two), 2);
+            _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(s0, s1));
+        }
+        return x;
+    }
+#endif
+
+    void lm_downsample(uint32_t* dst, const uint32_t* src, uint32_t sw, uint32_t sh, int isa)
+    {
+        const uint32_t dw = sw > 1 ? sw / 2 : 1;
+        const uint32_t dh = sh > 1 ? sh / 2 : 1;
+        for (uint32_t y = 0; y < dh; ++y) {
+            const uint32_t* r0 = src + (size_t)(2 * y) * sw;
+            const uint32_t* r1 = 2 * y + 1 < sh ? r0 + sw : r0;
+            uint32_t* out = dst + (size_t)y * dw;
+            uint32_t x = 0;
+#if ZM_LM_HAVE_SSE2
+            // A one-wide source has no pair to read
+            if (isa >= ZM_LM_SSE2 && sw > 1)
+                x = lm_row_sse2(out, r0, r1, dw);
+#else
+            (void)isa;
+#endif
+            lm_row_scalar(out, r0, r1, sw, x, dw);
+        }
+    }
+
+    void lm_build_chain(uint32_t* chain, uint32_t w, uint32_t h, unsigned levels, int isa)
+    {
+        uint32_t* src = chain;
+        for (unsigned l = 1; l < levels; ++l) {
+            uint32_t* dst = src + (size_t)w * h;
+            lm_downsample(dst, src, w, h, isa);
+            w = w > 1 ? w / 2 : 1;
+            h = h > 1 ? h / 2 : 1;
+            src = dst;
+        }
+    }
+
+} // namespace ZeroMod
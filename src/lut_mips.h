@@ -0,0 +1,42 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ---- LUT mip chains ----
+// Builds the mip levels of a decoded A8R8G8B8 LUT on the CPU, for presets
+// that set mipmap_input on a texture (slang_d3d9_lut.cpp). Each level is a
+// 2x2 box of the one above, (a + b + c + d + 2) >> 2 per channel, down to
+// 1x1; sizes halve and round down like D3D's, so an odd last row or column
+// is left out, and a side already at 1 repeats its texel. The SSE2 kernel
+// does four destination pixels a step and gives the same bytes as the
+// scalar code. Nothing in here calls the OS, so tools/zm_lut_mips_bench.cpp
+// can drive it on Linux.
+// 0 builds the scalar code only
+#define ZM_LM_SIMD 1
+
+namespace ZeroMod {
+
+    enum zm_lm_isa {
+        ZM_LM_SCALAR,
+        ZM_LM_SSE2,
+    };
+
+    // Best this build has (SSE2 is part of x86-64)
+    int lm_best_isa();
+    const char* lm_isa_name(int isa);
+
+    // Levels down to 1x1 for a w x h image, level 0 included
+    unsigned lm_level_count(uint32_t w, uint32_t h);
+
+    // Pixels in levels 0..levels-1 together
+    size_t lm_chain_pixels(uint32_t w, uint32_t h, unsigned levels);
+
+    // One level: 'src' is sw x sh, 'dst' gets max(sw / 2, 1) x max(sh / 2, 1).
+    // Both tightly packed.
+    void lm_downsample(uint32_t* dst, const uint32_t* src, uint32_t sw, uint32_t sh, int isa = ZM_LM_SSE2);
+
+    // 'chain' holds level 0 (w x h) followed by room for the rest; fills
+    // levels 1..levels-1 in order, each right after the one before
+    void lm_build_chain(uint32_t* chain, uint32_t w, uint32_t h, unsigned levels, int isa = ZM_LM_SSE2);
+
+} // namespace ZeroMod
@@ -3,9 +3,11 @@
 #include "dinput8_dll.h"
 #include "conf.h"
 #include "ini.h"
+#include "input.h"
 #include "globals.h"
 #include "dxgiswapchain.h"
 #include "log.h"
+#include "stage_prof.h"
 #include "../RetroArch/retroarch.h"
 #include "../RetroArch/RetroArch/retroarch.h"
 #include <algorithm>
@@ -49,7 +51,8 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpReserved) {
 
             default_config = new Config();
             default_ini = new Ini(INI_FILE_NAME, default_overlay, default_config);
-            default_logger = new Logger(LOG_FILE_NAME, default_config, default_overlay);
+            default_logger = new Logger(ZM_LOG_BINARY ? LOG_BIN_FILE_NAME : LOG_FILE_NAME, default_config, default_overlay);
+            default_input = new Input(default_config);
 
             char b[256];
             _snprintf(b, sizeof(b),
@@ -88,6 +91,10 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpReserved) {
     case DLL_PROCESS_DETACH:
         try {
             base_dll_shutdown();
+            ZeroMod::prof_shutdown();
+
+            delete default_input;
+            default_input = nullptr;
 
             delete default_logger;
             default_logger = nullptr;
@@ -95,6 +95,8 @@ struct _tstring_view_icmp {
 
 #define MOD_NAME "MMZZXLC FilterMod"
 #define LOG_FILE_NAME _T("filter-mod.log")
+// Logger output with ZM_LOG_BINARY (tools/zm_log_decode.cpp turns it into text)
+#define LOG_BIN_FILE_NAME _T("filter-mod.zmlb")
 #define INI_FILE_NAME _T("filter-mod.ini")
 
 inline void zm_notimpl(const char* func) {
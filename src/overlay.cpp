@@ -31,6 +31,7 @@ class Overlay::Impl {
         UINT64 time = 0;
     };
     std::deque<Text> texts;
+    std::string stats_text;
 
     void push_text_base(std::string&& s) {
         std::cerr << s << std::endl;
@@ -297,6 +298,23 @@ class Overlay::Impl {
             ImGui::End();
         }
 
+        if (!stats_text.empty()) {
+            ImGui::SetNextWindowPos(ImVec2(10, display_size.y - 10), ImGuiCond_Always, ImVec2(0, 1));
+            ImGui::SetNextWindowBgAlpha(0.35f);
+
+            ImGui::Begin(
+                "Stats",
+                NULL,
+                ImGuiWindowFlags_NoTitleBar |
+                ImGuiWindowFlags_AlwaysAutoResize |
+                ImGuiWindowFlags_NoMove |
+                ImGuiWindowFlags_NoSavedSettings |
+                ImGuiWindowFlags_NoInputs
+            );
+            ImGui::TextUnformatted(stats_text.c_str());
+            ImGui::End();
+        }
+
         static int once = 0;
         if (once++ == 0) OutputDebugStringA("[ZeroMod] Overlay::present() is running\n");
         ImGui::Render();
@@ -369,3 +387,9 @@ void Overlay::set_log_message(const std::string& message) {
     impl->end_text();
 }
 
+void Overlay::set_stats_text(std::string text) {
+    impl->begin_text();
+    impl->stats_text = std::move(text);
+    impl->end_text();
+}
+
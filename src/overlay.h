@@ -70,6 +70,9 @@ public:
     }
 
     void set_log_message(const std::string& message);
+
+    // Fixed panel under the messages (profiler table); empty hides it
+    void set_stats_text(std::string text);
 };
 
 struct OverlayPtr {
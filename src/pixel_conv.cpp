@@ -0,0 +1,412 @@
+#include "pixel_conv.h"
+
+#include <math.h>
+#include <string.h>
+#include "half/include/half.hpp"
+
+#if ZM_PC_SIMD && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PC_X86 1
+#include <immintrin.h>
+#else
+#define PC_X86 0
+#endif
+
+namespace ZeroMod {
+
+    // Decodes n pixels to A8R8G8B8 / encodes n A8R8G8B8 pixels
+    typedef void (*pc_dec_fn)(const void* src, uint32_t* argb, uint32_t n);
+    typedef void (*pc_enc_fn)(const uint32_t* argb, void* dst, uint32_t n);
+
+    // ---- scalar ----
+    namespace pc_scalar {
+
+        static inline uint32_t up5(uint32_t v) { return (v * 527 + 23) >> 6; }
+        static inline uint32_t up6(uint32_t v) { return (v * 259 + 33) >> 6; }
+        static inline uint32_t up4(uint32_t v) { return v * 17; }
+        static inline uint32_t down(uint32_t v, uint32_t max)
+        {
+            const uint32_t t = v * max + 127;
+            return (t + 1 + (t >> 8)) >> 8;
+        }
+        static inline uint32_t argb(uint32_t a, uint32_t r, uint32_t g, uint32_t b)
+        {
+            return a << 24 | r << 16 | g << 8 | b;
+        }
+
+        static void dec_565(const void* src, uint32_t* d, uint32_t n)
+        {
+            const uint16_t* s = (const uint16_t*)src;
+            for (uint32_t i = 0; i < n; ++i) {
+                const uint32_t v = s[i];
+                d[i] = argb(255, up5(v >> 11), up6((v >> 5) & 63), up5(v & 31));
+            }
+        }
+
+        static void dec_x1555(const void* src, uint32_t* d, uint32_t n)
+        {
+            const uint16_t* s = (const uint16_t*)src;
+            for (uint32_t i = 0; i < n; ++i) {
+                const uint32_t v = s[i];
+                d[i] = argb(255, up5((v >> 10) & 31), up5((v >> 5) & 31), up5(v & 31));
+            }
+        }
+
+        static void dec_a1555(const void* src, uint32_t* d, uint32_t n)
+        {
+            const uint16_t* s = (const uint16_t*)src;
+            for (uint32_t i = 0; i < n; ++i) {
+                const uint32_t v = s[i];
+                d[i] = argb(v & 0x8000 ? 255 : 0, up5((v >> 10) & 31), up5((v >> 5) & 31), up5(v & 31));
+            }
+        }
+
+        static void dec_4444(const void* src, uint32_t* d, uint32_t n)
+        {
+            const uint16_t* s = (const uint16_t*)src;
+            for (uint32_t i = 0; i < n; ++i) {
+                const uint32_t v = s[i];
+                d[i] = argb(up4(v >> 12), up4((v >> 8) & 15), up4((v >> 4) & 15), up4(v & 15));
+            }
+        }
+
+        static void dec_x888(const void* src, uint32_t* d, uint32_t n)
+        {
+            const uint32_t* s = (const uint32_t*)src;
+            for (uint32_t i = 0; i < n; ++i)
+                d[i] = s[i] | 0xFF000000u;
+        }
+
+        // Clamped like maxps/minps, so NaN goes to 0
+        static inline uint32_t unorm8(float f)
+        {
+            f = f > 0.0f ? f : 0.0f;
+            f = f < 1.0f ? f : 1.0f;
+            return (uint32_t)lrintf(f * 255.0f);
+        }
+
+        static void dec_f16(const void* src, uint32_t* d, uint32_t n)
+        {
+            const uint8_t* s = (const uint8_t*)src;
+            for (uint32_t i = 0; i < n; ++i) {
+                // R, G, B, A in memory
+                half_float::half h[4];
+                memcpy(h, s + (size_t)i * 8, 8);
+                d[i] = argb(unorm8(h[3]), unorm8(h[0]), unorm8(h[1]), unorm8(h[2]));
+            }
+        }
+
+        static void enc_8888(const uint32_t* s, void* dst, uint32_t n)
+        {
+            memcpy(dst, s, (size_t)n * 4);
+        }
+
+        static void enc_565(const uint32_t* s, void* dst, uint32_t n)
+        {
+            uint16_t* d = (uint16_t*)dst;
+            for (uint32_t i = 0; i < n; ++i) {
+                const uint32_t v = s[i];
+                d[i] = (uint16_t)(down((v >> 16) & 255, 31) << 11 | down((v >> 8) & 255, 63) << 5 | down(v & 255, 31));
+            }
+        }
+
+        static void enc_1555(const uint32_t* s, void* dst, uint32_t n)
+        {
+            uint16_t* d = (uint16_t*)dst;
+            for (uint32_t i = 0; i < n; ++i) {
+                const uint32_t v = s[i];
+                d[i] = (uint16_t)((v >> 31) << 15 | down((v >> 16) & 255, 31) << 10 |
+                    down((v >> 8) & 255, 31) << 5 | down(v & 255, 31));
+            }
+        }
+
+        static void enc_4444(const uint32_t* s, void* dst, uint32_t n)
+        {
+            uint16_t* d = (uint16_t*)dst;
+            for (uint32_t i = 0; i < n; ++i) {
+                const uint32_t v = s[i];
+                d[i] = (uint16_t)(down(v >> 24, 15) << 12 | down((v >> 16) & 255, 15) << 8 |
+                    down((v >> 8) & 255, 15) << 4 | down(v & 255, 15));
+            }
+        }
+
+        static inline half_float::half unorm8_half(uint32_t v)
+        {
+            return half_float::half_cast<half_float::half, std::round_to_nearest>((float)v / 255.0f);
+        }
+
+        static void enc_f16(const uint32_t* s, void* dst, uint32_t n)
+        {
+            uint8_t* d = (uint8_t*)dst;
+            for (uint32_t i = 0; i < n; ++i) {
+                const uint32_t v = s[i];
+                const half_float::half h[4] = {
+                    unorm8_half((v >> 16) & 255), unorm8_half((v >> 8) & 255),
+                    unorm8_half(v & 255), unorm8_half(v >> 24),
+                };
+                memcpy(d + (size_t)i * 8, h, 8);
+            }
+        }
+
+    } // namespace pc_scalar
+
+#if PC_X86
+
+    // ---- SSE2, 8 pixels ----
+#pragma GCC push_options
+#pragma GCC target("sse2")
+    namespace pc_sse2 {
+
+        typedef __m128i V;
+        enum { LANES = 8 };
+
+        static inline V ldu(const void* p) { return _mm_loadu_si128((const __m128i*)p); }
+        static inline void stu(void* p, V v) { _mm_storeu_si128((__m128i*)p, v); }
+        static inline V set16(int v) { return _mm_set1_epi16((short)v); }
+        static inline V set32(uint32_t v) { return _mm_set1_epi32((int)v); }
+        static inline V add16(V a, V b) { return _mm_add_epi16(a, b); }
+        static inline V mul16(V a, V b) { return _mm_mullo_epi16(a, b); }
+        static inline V and_(V a, V b) { return _mm_and_si128(a, b); }
+        static inline V or_(V a, V b) { return _mm_or_si128(a, b); }
+        static inline V srl16(V a, int n) { return _mm_srli_epi16(a, n); }
+        static inline V sra16(V a, int n) { return _mm_srai_epi16(a, n); }
+        static inline V sll16(V a, int n) { return _mm_slli_epi16(a, n); }
+
+        // lo = b | g << 8, hi = r | a << 8 per pixel
+        static inline void widen(uint32_t* d, V lo, V hi)
+        {
+            stu(d, _mm_unpacklo_epi16(lo, hi));
+            stu(d + 4, _mm_unpackhi_epi16(lo, hi));
+        }
+
+        // Channel at bit 'shift' of 8 pixels, in 16-bit lanes
+        static inline V narrow(const uint32_t* s, int shift)
+        {
+            const V m = _mm_set1_epi32(255);
+            return _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(ldu(s), shift), m),
+                _mm_and_si128(_mm_srli_epi32(ldu(s + 4), shift), m));
+        }
+
+#include "pixel_conv_kernel.h"
+
+        // No F16C below AVX2
+        static void dec_f16(const void* src, uint32_t* d, uint32_t n) { pc_scalar::dec_f16(src, d, n); }
+        static void enc_f16(const uint32_t* s, void* dst, uint32_t n) { pc_scalar::enc_f16(s, dst, n); }
+
+    } // namespace pc_sse2
+#pragma GCC pop_options
+
+    // ---- AVX2 + F16C, 16 pixels ----
+#pragma GCC push_options
+#pragma GCC target("avx2,f16c")
+    namespace pc_avx2 {
+
+        typedef __m256i V;
+        enum { LANES = 16 };
+
+        static inline V ldu(const void* p) { return _mm256_loadu_si256((const __m256i*)p); }
+        static inline void stu(void* p, V v) { _mm256_storeu_si256((__m256i*)p, v); }
+        static inline V set16(int v) { return _mm256_set1_epi16((short)v); }
+        static inline V set32(uint32_t v) { return _mm256_set1_epi32((int)v); }
+        static inline V add16(V a, V b) { return _mm256_add_epi16(a, b); }
+        static inline V mul16(V a, V b) { return _mm256_mullo_epi16(a, b); }
+        static inline V and_(V a, V b) { return _mm256_and_si256(a, b); }
+        static inline V or_(V a, V b) { return _mm256_or_si256(a, b); }
+        static inline V srl16(V a, int n) { return _mm256_srli_epi16(a, n); }
+        static inline V sra16(V a, int n) { return _mm256_srai_epi16(a, n); }
+        static inline V sll16(V a, int n) { return _mm256_slli_epi16(a, n); }
+
+        // The unpacks work per 128-bit lane: pixels 0-3 | 8-11 and 4-7 | 12-15
+        static inline void widen(uint32_t* d, V lo, V hi)
+        {
+            const V a = _mm256_unpacklo_epi16(lo, hi);
+            const V b = _mm256_unpackhi_epi16(lo, hi);
+            stu(d, _mm256_permute2x128_si256(a, b, 0x20));
+            stu(d + 8, _mm256_permute2x128_si256(a, b, 0x31));
+        }
+
+        // The pack interleaves 64-bit halves of the two loads; 0xD8 undoes it
+        static inline V narrow(const uint32_t* s, int shift)
+        {
+            const V m = _mm256_set1_epi32(255);
+            const V p = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(ldu(s), shift), m),
+                _mm256_and_si256(_mm256_srli_epi32(ldu(s + 8), shift), m));
+            return _mm256_permute4x64_epi64(p, 0xD8);
+        }
+
+#include "pixel_conv_kernel.h"
+
+        // 4 pixels per step; halves are R, G, B, A, A8R8G8B8 bytes B, G, R, A
+        static void dec_f16(const void* src, uint32_t* d, uint32_t n)
+        {
+            const uint16_t* s = (const uint16_t*)src;
+            const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), k = _mm256_set1_ps(255.0f);
+            const V swap_rb = _mm256_setr_epi8(
+                2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+            const V order = _mm256_setr_epi32(0, 4, 1, 5, 0, 0, 0, 0);
+            uint32_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                __m256 f0 = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(s + (size_t)i * 4)));
+                __m256 f1 = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(s + (size_t)i * 4 + 8)));
+                // max/min return the second operand for NaN, like the scalar clamp
+                f0 = _mm256_min_ps(_mm256_max_ps(f0, zero), one);
+                f1 = _mm256_min_ps(_mm256_max_ps(f1, zero), one);
+                const V i0 = _mm256_cvtps_epi32(_mm256_mul_ps(f0, k));
+                const V i1 = _mm256_cvtps_epi32(_mm256_mul_ps(f1, k));
+                // Pixels 0, 2 in the low lane and 1, 3 in the high one
+                V p = _mm256_packus_epi32(i0, i1);
+                p = _mm256_packus_epi16(p, p);
+                p = _mm256_shuffle_epi8(p, swap_rb);
+                p = _mm256_permutevar8x32_epi32(p, order);
+                _mm_storeu_si128((__m128i*)(d + i), _mm256_castsi256_si128(p));
+            }
+            pc_scalar::dec_f16(s + (size_t)i * 4, d + i, n - i);
+        }
+
+        static void enc_f16(const uint32_t* s, void* dst, uint32_t n)
+        {
+            uint16_t* d = (uint16_t*)dst;
+            const __m256 k = _mm256_set1_ps(255.0f);
+            const __m128i swap_rb = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+            uint32_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                const __m128i p = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(s + i)), swap_rb);
+                const __m256 f0 = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(p)), k);
+                const __m256 f1 = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(p, 8))), k);
+                _mm_storeu_si128((__m128i*)(d + (size_t)i * 4), _mm256_cvtps_ph(f0, _MM_FROUND_TO_NEAREST_INT));
+                _mm_storeu_si128((__m128i*)(d + (size_t)i * 4 + 8), _mm256_cvtps_ph(f1, _MM_FROUND_TO_NEAREST_INT));
+            }
+            pc_scalar::enc_f16(s + i, d + (size_t)i * 4, n - i);
+        }
+
+    } // namespace pc_avx2
+#pragma GCC pop_options
+
+#define PC_FNS(name) { pc_scalar::name, pc_sse2::name, pc_avx2::name }
+#else
+#define PC_FNS(name) { pc_scalar::name, pc_scalar::name, pc_scalar::name }
+#endif // PC_X86
+
+    struct pc_codec
+    {
+        uint32_t format;
+        uint32_t bpp;
+        const char* name;
+        pc_dec_fn dec[3];       // per zm_pc_isa; null for A8R8G8B8, which is the chunk format
+        pc_enc_fn enc[3];
+    };
+
+    static const pc_codec pc_codecs[] = {
+        { ZM_PC_A8R8G8B8, 4, "A8R8G8B8", {}, { pc_scalar::enc_8888, pc_scalar::enc_8888, pc_scalar::enc_8888 } },
+        { ZM_PC_X8R8G8B8, 4, "X8R8G8B8", PC_FNS(dec_x888), { pc_scalar::enc_8888, pc_scalar::enc_8888, pc_scalar::enc_8888 } },
+        { ZM_PC_R5G6B5, 2, "R5G6B5", PC_FNS(dec_565), PC_FNS(enc_565) },
+        { ZM_PC_X1R5G5B5, 2, "X1R5G5B5", PC_FNS(dec_x1555), PC_FNS(enc_1555) },
+        { ZM_PC_A1R5G5B5, 2, "A1R5G5B5", PC_FNS(dec_a1555), PC_FNS(enc_1555) },
+        { ZM_PC_A4R4G4B4, 2, "A4R4G4B4", PC_FNS(dec_4444), PC_FNS(enc_4444) },
+        { ZM_PC_A16B16G16R16F, 8, "A16B16G16R16F", PC_FNS(dec_f16), PC_FNS(enc_f16) },
+    };
+
+#undef PC_FNS
+
+    static const pc_codec* pc_find(uint32_t format)
+    {
+        for (const pc_codec& c : pc_codecs)
+            if (c.format == format)
+                return &c;
+        return nullptr;
+    }
+
+    int pc_cpu_isa()
+    {
+#if PC_X86
+        static int isa = -1;
+        if (isa < 0) {
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c"))
+                isa = ZM_PC_AVX2;
+            else if (__builtin_cpu_supports("sse2"))
+                isa = ZM_PC_SSE2;
+            else
+                isa = ZM_PC_SCALAR;
+        }
+        return isa;
+#else
+        return ZM_PC_SCALAR;
+#endif
+    }
+
+    const char* pc_isa_name(int isa)
+    {
+        switch (isa) {
+        case ZM_PC_AVX2: return "avx2";
+        case ZM_PC_SSE2: return "sse2";
+        default: return "scalar";
+        }
+    }
+
+    uint32_t pc_bytes_per_pixel(uint32_t format)
+    {
+        const pc_codec* c = pc_find(format);
+        return c ? c->bpp : 0;
+    }
+
+    const char* pc_format_name(uint32_t format)
+    {
+        const pc_codec* c = pc_find(format);
+        return c ? c->name : nullptr;
+    }
+
+    bool pc_convert(
+        void* dst, size_t dst_pitch, uint32_t dst_format, uint32_t dst_x, uint32_t dst_y,
+        const void* src, size_t src_pitch, uint32_t src_format, const zm_pc_rect& src_rect,
+        int isa)
+    {
+        const pc_codec* sc = pc_find(src_format);
+        const pc_codec* dc = pc_find(dst_format);
+        if (!sc || !dc || !dst || !src || src_rect.right < src_rect.left || src_rect.bottom < src_rect.top)
+            return false;
+
+        const uint32_t w = src_rect.right - src_rect.left;
+        const uint32_t h = src_rect.bottom - src_rect.top;
+        const uint8_t* s = (const uint8_t*)src + src_rect.top * src_pitch + (size_t)src_rect.left * sc->bpp;
+        uint8_t* d = (uint8_t*)dst + dst_y * dst_pitch + (size_t)dst_x * dc->bpp;
+
+        if (src_format == dst_format) {
+            for (uint32_t y = 0; y < h; ++y)
+                memcpy(d + y * dst_pitch, s + y * src_pitch, (size_t)w * sc->bpp);
+            return true;
+        }
+
+        const int best = pc_cpu_isa();
+        if (isa > best) isa = best;
+        if (isa < ZM_PC_SCALAR) isa = ZM_PC_SCALAR;
+        const pc_dec_fn dec = sc->dec[isa];
+        const pc_enc_fn enc = dc->enc[isa];
+        const bool to_8888 = enc == pc_scalar::enc_8888;
+
+        uint32_t chunk[ZM_PC_CHUNK];
+        for (uint32_t y = 0; y < h; ++y) {
+            const uint8_t* srow = s + y * src_pitch;
+            uint8_t* drow = d + y * dst_pitch;
+            if (to_8888) {
+                // Decode straight into the destination; A8R8G8B8 -> X8R8G8B8 is a copy
+                if (dec)
+                    dec(srow, (uint32_t*)drow, w);
+                else
+                    memcpy(drow, srow, (size_t)w * 4);
+                continue;
+            }
+            for (uint32_t x = 0; x < w; x += ZM_PC_CHUNK) {
+                const uint32_t n = w - x < ZM_PC_CHUNK ? w - x : ZM_PC_CHUNK;
+                const uint32_t* argb = (const uint32_t*)(srow + (size_t)x * 4);
+                if (dec) {
+                    dec(srow + (size_t)x * sc->bpp, chunk, n);
+                    argb = chunk;
+                }
+                enc(argb, drow + (size_t)x * dc->bpp, n);
+            }
+        }
+        return true;
+    }
+
+} // namespace ZeroMod
@@ -0,0 +1,68 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ---- Pixel format conversion ----
+// Copies a block of pixels between the D3D9 formats the mod's CPU paths
+// meet (FormatConversion.h wraps it for D3DFORMAT callers). Conversions go
+// through A8R8G8B8 a chunk of ZM_PC_CHUNK pixels at a time: each format
+// decodes to it and encodes from it, so any pair works. Channels widen and
+// narrow with round(v * 255 / max) and round(v * max / 255), which makes
+// 16-bit -> 32-bit -> 16-bit lossless; A16B16G16R16F clamps to 0..1 on its
+// way to 8 bits and uses the half library's round-to-nearest-even on the
+// way back. The same format on both sides is a row copy.
+//
+// The 16- and 32-bit kernels have SSE2 and AVX2 versions, and the half
+// format uses F16C in the AVX2 ones (every AVX2 CPU has it); CPUID picks
+// the highest the CPU and OS support. Every path gives the same bytes as
+// the scalar code. Nothing in here calls the OS, so
+// tools/zm_pixconv_bench.cpp can drive it on Linux.
+// 0 builds the scalar code only
+#define ZM_PC_SIMD 1
+// Pixels decoded to A8R8G8B8 per step
+#define ZM_PC_CHUNK 256
+
+namespace ZeroMod {
+
+    // Same values as D3DFORMAT
+    enum zm_pc_format : uint32_t {
+        ZM_PC_UNKNOWN = 0,
+        ZM_PC_A8R8G8B8 = 21,
+        ZM_PC_X8R8G8B8 = 22,
+        ZM_PC_R5G6B5 = 23,
+        ZM_PC_X1R5G5B5 = 24,
+        ZM_PC_A1R5G5B5 = 25,
+        ZM_PC_A4R4G4B4 = 26,
+        ZM_PC_A16B16G16R16F = 113,
+    };
+
+    enum zm_pc_isa {
+        ZM_PC_SCALAR,
+        ZM_PC_SSE2,
+        ZM_PC_AVX2,             // with F16C
+    };
+
+    // Half-open, like a RECT
+    struct zm_pc_rect
+    {
+        uint32_t left, top, right, bottom;
+    };
+
+    // Best instruction set this CPU and OS run, from CPUID (cached)
+    int pc_cpu_isa();
+    const char* pc_isa_name(int isa);
+
+    // 0 / null for a format not handled here
+    uint32_t pc_bytes_per_pixel(uint32_t format);
+    const char* pc_format_name(uint32_t format);
+
+    // Converts src_rect of src into dst at (dst_x, dst_y). Rows are 'pitch'
+    // bytes apart on each side; the caller keeps both blocks in bounds.
+    // isa: the highest to use, lowered to what the CPU has. False when a
+    // format isn't handled.
+    bool pc_convert(
+        void* dst, size_t dst_pitch, uint32_t dst_format, uint32_t dst_x, uint32_t dst_y,
+        const void* src, size_t src_pitch, uint32_t src_format, const zm_pc_rect& src_rect,
+        int isa = ZM_PC_AVX2);
+
+} // namespace ZeroMod
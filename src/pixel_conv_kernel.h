@@ -0,0 +1,124 @@
+// Pixel conversion kernels shared by the SSE2 and AVX2 builds.
+// pixel_conv.cpp includes this once per instruction set, inside a
+// namespace that defines the vector type V, LANES (16-bit lanes per V) and
+// the ops below, so there is no include guard. Each kernel does the whole
+// vectors of a run and leaves the rest to the scalar one.
+
+// round(v * 255 / 31), round(v * 255 / 63), v * 255 / 15
+static inline V up5(V v) { return srl16(add16(mul16(v, set16(527)), set16(23)), 6); }
+static inline V up6(V v) { return srl16(add16(mul16(v, set16(259)), set16(33)), 6); }
+static inline V up4(V v) { return mul16(v, set16(17)); }
+
+// round(v * max / 255) for v in 0..255; t / 255 as (t + 1 + (t >> 8)) >> 8
+static inline V down(V v, int max)
+{
+    const V t = add16(mul16(v, set16(max)), set16(127));
+    return srl16(add16(add16(t, set16(1)), srl16(t, 8)), 8);
+}
+
+// LANES pixels from four 8-bit channels in 16-bit lanes
+static inline void put(uint32_t* d, V a, V r, V g, V b)
+{
+    widen(d, or_(b, sll16(g, 8)), or_(r, sll16(a, 8)));
+}
+
+static void dec_565(const void* src, uint32_t* d, uint32_t n)
+{
+    const uint16_t* s = (const uint16_t*)src;
+    const V m5 = set16(31), m6 = set16(63), a = set16(255);
+    uint32_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        const V v = ldu(s + i);
+        put(d + i, a, up5(srl16(v, 11)), up6(and_(srl16(v, 5), m6)), up5(and_(v, m5)));
+    }
+    pc_scalar::dec_565(s + i, d + i, n - i);
+}
+
+static void dec_x1555(const void* src, uint32_t* d, uint32_t n)
+{
+    const uint16_t* s = (const uint16_t*)src;
+    const V m5 = set16(31), a = set16(255);
+    uint32_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        const V v = ldu(s + i);
+        put(d + i, a, up5(and_(srl16(v, 10), m5)), up5(and_(srl16(v, 5), m5)), up5(and_(v, m5)));
+    }
+    pc_scalar::dec_x1555(s + i, d + i, n - i);
+}
+
+static void dec_a1555(const void* src, uint32_t* d, uint32_t n)
+{
+    const uint16_t* s = (const uint16_t*)src;
+    const V m5 = set16(31), m8 = set16(255);
+    uint32_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        const V v = ldu(s + i);
+        put(d + i, and_(sra16(v, 15), m8),
+            up5(and_(srl16(v, 10), m5)), up5(and_(srl16(v, 5), m5)), up5(and_(v, m5)));
+    }
+    pc_scalar::dec_a1555(s + i, d + i, n - i);
+}
+
+static void dec_4444(const void* src, uint32_t* d, uint32_t n)
+{
+    const uint16_t* s = (const uint16_t*)src;
+    const V m4 = set16(15);
+    uint32_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        const V v = ldu(s + i);
+        put(d + i, up4(srl16(v, 12)), up4(and_(srl16(v, 8), m4)),
+            up4(and_(srl16(v, 4), m4)), up4(and_(v, m4)));
+    }
+    pc_scalar::dec_4444(s + i, d + i, n - i);
+}
+
+static void dec_x888(const void* src, uint32_t* d, uint32_t n)
+{
+    const uint32_t* s = (const uint32_t*)src;
+    const V a = set32(0xFF000000u);
+    uint32_t i = 0;
+    for (; i + LANES / 2 <= n; i += LANES / 2)
+        stu(d + i, or_(ldu(s + i), a));
+    pc_scalar::dec_x888(s + i, d + i, n - i);
+}
+
+static void enc_565(const uint32_t* s, void* dst, uint32_t n)
+{
+    uint16_t* d = (uint16_t*)dst;
+    uint32_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        const V r = down(narrow(s + i, 16), 31);
+        const V g = down(narrow(s + i, 8), 63);
+        const V b = down(narrow(s + i, 0), 31);
+        stu(d + i, or_(or_(sll16(r, 11), sll16(g, 5)), b));
+    }
+    pc_scalar::enc_565(s + i, d + i, n - i);
+}
+
+static void enc_1555(const uint32_t* s, void* dst, uint32_t n)
+{
+    uint16_t* d = (uint16_t*)dst;
+    uint32_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        const V a = srl16(narrow(s + i, 24), 7);
+        const V r = down(narrow(s + i, 16), 31);
+        const V g = down(narrow(s + i, 8), 31);
+        const V b = down(narrow(s + i, 0), 31);
+        stu(d + i, or_(or_(sll16(a, 15), sll16(r, 10)), or_(sll16(g, 5), b)));
+    }
+    pc_scalar::enc_1555(s + i, d + i, n - i);
+}
+
+static void enc_4444(const uint32_t* s, void* dst, uint32_t n)
+{
+    uint16_t* d = (uint16_t*)dst;
+    uint32_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        const V a = down(narrow(s + i, 24), 15);
+        const V r = down(narrow(s + i, 16), 15);
+        const V g = down(narrow(s + i, 8), 15);
+        const V b = down(narrow(s + i, 0), 15);
+        stu(d + i, or_(or_(sll16(a, 12), sll16(r, 8)), or_(sll16(g, 4), b)));
+    }
+    pc_scalar::enc_4444(s + i, d + i, n - i);
+}
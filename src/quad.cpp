@@ -0,0 +1,86 @@
+#include "quad.h"
+
+#include <d3dx9.h>
+#include <windows.h>
+#include <string.h>
+
+namespace ZeroMod {
+
+    static const char* s_blit_vs =
+        "float4 pos_xform : register(c0);\n"
+        "float4 uv_xform  : register(c1);\n"
+        "struct VSO { float4 pos : POSITION; float2 uv : TEXCOORD0; };\n"
+        "VSO main(float4 pos : TEXCOORD0, float2 uv : TEXCOORD1) {\n"
+        "    VSO o;\n"
+        "    o.pos = float4(pos.xy * pos_xform.xy + pos_xform.zw, 0.0, 1.0);\n"
+        "    o.uv = uv * uv_xform.xy + uv_xform.zw;\n"
+        "    return o;\n"
+        "}\n";
+
+    bool quad_create(IDirect3DDevice9* dev, zm_quad& q)
+    {
+        q.vb = nullptr;
+        q.decl = nullptr;
+        q.vs = nullptr;
+        if (!dev) return false;
+
+        const UINT bytes = sizeof(g_quad_vertices);
+        if (FAILED(dev->CreateVertexBuffer(bytes, D3DUSAGE_WRITEONLY, 0, D3DPOOL_MANAGED, &q.vb, NULL))) {
+            q.vb = nullptr;
+            quad_release(q);
+            return false;
+        }
+
+        void* p = nullptr;
+        if (FAILED(q.vb->Lock(0, bytes, &p, 0)) || !p) {
+            quad_release(q);
+            return false;
+        }
+        memcpy(p, g_quad_vertices, bytes);
+        q.vb->Unlock();
+
+        const D3DVERTEXELEMENT9 decl[] = {
+            { 0,  0, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 },
+            { 0, 16, D3DDECLTYPE_FLOAT2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 1 },
+            D3DDECL_END()
+        };
+        if (FAILED(dev->CreateVertexDeclaration(decl, &q.decl))) {
+            q.decl = nullptr;
+            quad_release(q);
+            return false;
+        }
+
+        ID3DXBuffer* code = nullptr;
+        ID3DXBuffer* err = nullptr;
+        HRESULT hr = D3DXCompileShader(
+            s_blit_vs, (UINT)strlen(s_blit_vs),
+            nullptr, nullptr,
+            "main", "vs_2_0",
+            0, &code, &err, nullptr);
+
+        if (SUCCEEDED(hr) && code) {
+            if (FAILED(dev->CreateVertexShader((const DWORD*)code->GetBufferPointer(), &q.vs)))
+                q.vs = nullptr;
+            code->Release();
+        }
+        else if (err) {
+            OutputDebugStringA("[ZeroMod] quad blit_vs FAILED: ");
+            OutputDebugStringA((const char*)err->GetBufferPointer());
+        }
+        if (err) err->Release();
+
+        if (!q.vs) {
+            quad_release(q);
+            return false;
+        }
+        return true;
+    }
+
+    void quad_release(zm_quad& q)
+    {
+        if (q.vs) { q.vs->Release(); q.vs = nullptr; }
+        if (q.decl) { q.decl->Release(); q.decl = nullptr; }
+        if (q.vb) { q.vb->Release(); q.vb = nullptr; }
+    }
+
+} // namespace ZeroMod
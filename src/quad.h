@@ -0,0 +1,59 @@
+#pragma once
+#include <d3d9.h>
+#include "state_delta.h"
+
+// ---- Static fullscreen quad ----
+// One MANAGED vertex buffer, written once at creation, shared by every
+// post-processing draw (slang passes, crop/history copies, final blit,
+// overlay composite). Blits that need a sub-rectangle of the source or a
+// different placement go through the blit vertex shader's constants
+// instead of re-locking the buffer or drawing with DrawPrimitiveUP.
+// Creation (quad.cpp) needs D3DX; the draws (quad_draw.cpp) build against
+// tools/fake_d3d9, so tools/zm_quad_check.cpp runs them on a fake device.
+
+namespace ZeroMod {
+
+    struct zm_slang_vertex {
+        float x, y, z, w;  // TEXCOORD0 (Position)
+        float u, v;        // TEXCOORD1 (TexCoord)
+    };
+
+    // StartVertex of each variant baked into the buffer (triangle strip, 2 prims)
+    enum : UINT {
+        ZM_QUAD_FULL = 0,   // clip -1..1, uv 0..1, TL BL TR BR
+        ZM_QUAD_VERTS = 4
+    };
+
+    // The buffer's contents
+    extern const zm_slang_vertex g_quad_vertices[ZM_QUAD_VERTS];
+
+    struct zm_quad
+    {
+        IDirect3DVertexBuffer9* vb;
+        IDirect3DVertexDeclaration9* decl;
+        IDirect3DVertexShader9* vs;   // blit VS: c0 = pos scale/offset, c1 = uv scale/offset
+    };
+
+    // Vertex buffer + declaration + blit VS. False leaves 'q' empty.
+    bool quad_create(IDirect3DDevice9* dev, zm_quad& q);
+    void quad_release(zm_quad& q);
+
+    // Bind stream 0 + declaration (slang passes bring their own VS).
+    void quad_bind(zm_state_delta& sd, const zm_quad& q);
+
+    // Blit VS constants for quad_blit: c0 = pos scale/offset, c1 = uv scale/offset
+    void quad_blit_xform(
+        UINT vp_w, UINT vp_h,
+        float u0, float v0, float u1, float v1,
+        float pos_xform[4], float uv_xform[4]);
+
+    // Cover the current viewport (vp_w x vp_h) with uv rect (u0,v0)-(u1,v1).
+    // Binds the quad and blit VS and writes c0/c1; PS, textures and
+    // sampler/render state are the caller's.
+    HRESULT quad_blit(
+        zm_state_delta& sd,
+        const zm_quad& q,
+        UINT vp_w, UINT vp_h,
+        float u0, float v0, float u1, float v1);
+
+} // namespace ZeroMod
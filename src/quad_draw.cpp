@@ -0,0 +1,55 @@
+#include "quad.h"
+
+namespace ZeroMod {
+
+    const zm_slang_vertex g_quad_vertices[ZM_QUAD_VERTS] = {
+        { -1,  1, 0, 1,   0,0 }, // TL
+        { -1, -1, 0, 1,   0,1 }, // BL
+        {  1,  1, 0, 1,   1,0 }, // TR
+        {  1, -1, 0, 1,   1,1 }, // BR
+    };
+
+    void quad_bind(zm_state_delta& sd, const zm_quad& q)
+    {
+        sd_stream0(sd, q.vb, 0, sizeof(zm_slang_vertex));
+        sd_decl(sd, q.decl);
+    }
+
+    void quad_blit_xform(
+        UINT vp_w, UINT vp_h,
+        float u0, float v0, float u1, float v1,
+        float pos_xform[4], float uv_xform[4])
+    {
+        // Shift by half a pixel so texel centers land on pixel centers (D3D9 rasterization rules)
+        pos_xform[0] = 1.0f;
+        pos_xform[1] = 1.0f;
+        pos_xform[2] = -1.0f / (float)vp_w;
+        pos_xform[3] = 1.0f / (float)vp_h;
+
+        uv_xform[0] = u1 - u0;
+        uv_xform[1] = v1 - v0;
+        uv_xform[2] = u0;
+        uv_xform[3] = v0;
+    }
+
+    HRESULT quad_blit(
+        zm_state_delta& sd,
+        const zm_quad& q,
+        UINT vp_w, UINT vp_h,
+        float u0, float v0, float u1, float v1)
+    {
+        if (!sd.dev || !q.vb || !q.vs || !vp_w || !vp_h)
+            return E_FAIL;
+
+        float pos_xform[4], uv_xform[4];
+        quad_blit_xform(vp_w, vp_h, u0, v0, u1, v1, pos_xform, uv_xform);
+
+        quad_bind(sd, q);
+        sd_vs(sd, q.vs);
+        sd_vs_consts(sd, 0, pos_xform, 1);
+        sd_vs_consts(sd, 1, uv_xform, 1);
+
+        return sd.dev->DrawPrimitive(D3DPT_TRIANGLESTRIP, ZM_QUAD_FULL, 2);
+    }
+
+} // namespace ZeroMod
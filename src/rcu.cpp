@@ -0,0 +1,97 @@
+#include "rcu.h"
+
+namespace ZeroMod {
+
+    void rcu_init(zm_rcu& r, void* initial, void (*free_fn)(void* p))
+    {
+        r.current.store(initial, std::memory_order_relaxed);
+        r.epoch.store(0, std::memory_order_relaxed);
+        for (int i = 0; i < ZM_RCU_MAX_READERS; ++i) {
+            r.readers[i].epoch.store(ZM_RCU_IDLE, std::memory_order_relaxed);
+            r.readers[i].used.store(false, std::memory_order_relaxed);
+            r.readers[i].held = nullptr;
+        }
+        r.retired.clear();
+        r.free_fn = free_fn;
+    }
+
+    void rcu_free(zm_rcu& r)
+    {
+        for (const zm_rcu_retired& d : r.retired)
+            r.free_fn(d.p);
+        r.retired.clear();
+        r.free_fn(r.current.exchange(nullptr, std::memory_order_acquire));
+    }
+
+    int rcu_attach(zm_rcu& r)
+    {
+        for (int i = 0; i < ZM_RCU_MAX_READERS; ++i) {
+            bool expected = false;
+            if (r.readers[i].used.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+                r.readers[i].held = nullptr;
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    void rcu_detach(zm_rcu& r, int slot)
+    {
+        if (slot < 0)
+            return;
+        r.readers[slot].held = nullptr;
+        r.readers[slot].epoch.store(ZM_RCU_IDLE, std::memory_order_release);
+        r.readers[slot].used.store(false, std::memory_order_release);
+    }
+
+    const void* rcu_refresh(zm_rcu& r, int slot)
+    {
+        zm_rcu_reader& rd = r.readers[slot];
+        const void* p = r.current.load(std::memory_order_acquire);
+        if (p == rd.held)
+            return p;
+
+        // Announce the epoch before taking the pointer: the writer frees
+        // nothing retired at or after it until this slot moves on. Both
+        // sides are seq_cst so the store can't pass the load below.
+        rd.epoch.store(r.epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+        p = r.current.load(std::memory_order_seq_cst);
+        rd.held = p;
+        return p;
+    }
+
+    void rcu_publish(zm_rcu& r, void* p)
+    {
+        void* old = r.current.exchange(p, std::memory_order_seq_cst);
+        const uint64_t e = r.epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+        if (old)
+            r.retired.push_back({ old, e });
+
+        uint64_t oldest = ZM_RCU_IDLE;
+        for (int i = 0; i < ZM_RCU_MAX_READERS; ++i) {
+            const uint64_t re = r.readers[i].epoch.load(std::memory_order_seq_cst);
+            if (re < oldest)
+                oldest = re;
+        }
+
+        size_t keep = 0;
+        for (size_t i = 0; i < r.retired.size(); ++i) {
+            if (r.retired[i].epoch <= oldest)
+                r.free_fn(r.retired[i].p);
+            else
+                r.retired[keep++] = r.retired[i];
+        }
+        r.retired.resize(keep);
+    }
+
+    void* rcu_current(const zm_rcu& r)
+    {
+        return r.current.load(std::memory_order_acquire);
+    }
+
+    size_t rcu_pending(const zm_rcu& r)
+    {
+        return r.retired.size();
+    }
+
+} // namespace ZeroMod
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// ---- Snapshot publishing with deferred free ----
+// One writer replaces an immutable object behind an atomic pointer;
+// readers pick the current one up at a point of their choosing (once per
+// frame) and keep using it until the next time, without a lock. Each
+// reader has a slot holding the publish epoch it last refreshed at. A
+// replaced object is tagged with the epoch its replacement bumped to and
+// freed by a later publish once every slot is idle or at that epoch, i.e.
+// every reader has refreshed past it. A refresh that finds the same
+// pointer it already holds is a single acquire load. Nothing in here
+// calls the OS, so tools/zm_conf_stress.cpp can drive it on Linux.
+// Readers; attaching past this fails
+#define ZM_RCU_MAX_READERS 16
+
+namespace ZeroMod {
+
+    struct zm_rcu_reader
+    {
+        alignas(64) std::atomic<uint64_t> epoch;    // ZM_RCU_IDLE when holding nothing
+        std::atomic<bool> used;
+        const void* held;                           // reader only
+    };
+
+    struct zm_rcu_retired
+    {
+        void* p;
+        uint64_t epoch;
+    };
+
+    struct zm_rcu
+    {
+        std::atomic<void*> current;
+        std::atomic<uint64_t> epoch;
+        zm_rcu_reader readers[ZM_RCU_MAX_READERS];
+
+        // Writer only
+        std::vector<zm_rcu_retired> retired;
+        void (*free_fn)(void* p);
+    };
+
+    static const uint64_t ZM_RCU_IDLE = ~0ull;
+
+    void rcu_init(zm_rcu& r, void* initial, void (*free_fn)(void* p));
+    // No readers or writer left: frees the current object and everything retired
+    void rcu_free(zm_rcu& r);
+
+    // Reader slot, or -1 when all are taken
+    int rcu_attach(zm_rcu& r);
+    // Drops what the slot holds; the slot can be attached again
+    void rcu_detach(zm_rcu& r, int slot);
+
+    // Reader's quiescent point: the previous pointer may be freed after
+    // this, the returned one stays valid until the next refresh or detach
+    const void* rcu_refresh(zm_rcu& r, int slot);
+
+    // Single writer: makes p current, then frees whatever no reader can
+    // still hold
+    void rcu_publish(zm_rcu& r, void* p);
+
+    // Writer side: the current object, for copying before an edit
+    void* rcu_current(const zm_rcu& r);
+
+    // Retired objects not yet freed
+    size_t rcu_pending(const zm_rcu& r);
+
+} // namespace ZeroMod
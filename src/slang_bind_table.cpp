@@ -0,0 +1,200 @@
+#include "slang_bind_table.h"
+
+#include <string.h>
+
+namespace ZeroMod {
+
+    // False = this constant can't be expressed as float4 registers
+    static bool zm_bt_add_const(
+        slang_const_op* ops,
+        uint32_t& num,
+        const slang_refl_uniform& u)
+    {
+        const slang_refl_const& d = u.c;
+        if (num >= ZM_SLANG_MAX_CONST_OPS)
+            return false;
+
+        if (!d.float4 || d.regs == 0 || (unsigned)d.reg + d.regs > ZM_SLANG_MAX_VS_CONSTS)
+            return false;
+
+        slang_const_op op{};
+        op.source = u.source;
+        op.reg = d.reg;
+        op.regs = d.regs;
+
+        if (d.cls == ZM_RC_MAT_ROWS || d.cls == ZM_RC_MAT_COLS)
+        {
+            if (d.rows != 4 || d.cols != 4 || u.bytes < sizeof(float) * 16)
+                return false;
+            op.layout = (d.cls == ZM_RC_MAT_ROWS) ? ZM_CL_MAT_ROWS : ZM_CL_MAT_COLS;
+            op.cols = 4;
+            op.dwords = 16;
+            if (op.regs > 4) op.regs = 4;
+        }
+        else
+        {
+            if (d.cls != ZM_RC_VECTOR || (u.bytes & 3) != 0 || d.cols == 0 || d.cols > 4)
+                return false;
+            op.layout = d.is_int ? ZM_CL_INT : ZM_CL_FLOAT;
+            op.cols = (uint8_t)d.cols;
+
+            const uint32_t dw = u.bytes / 4;
+            const uint32_t max_dw = (uint32_t)op.regs * op.cols;
+            op.dwords = (uint16_t)(dw < max_dw ? dw : max_dw);
+        }
+
+        ops[num++] = op;
+        return true;
+    }
+
+    static bool zm_bt_span(const slang_const_op* ops, uint32_t num, unsigned max_regs, uint16_t& lo, uint16_t& hi)
+    {
+        lo = hi = 0;
+        if (!num)
+            return true;
+
+        unsigned l = ~0u, h = 0;
+        for (uint32_t i = 0; i < num; ++i)
+        {
+            if (ops[i].reg < l) l = ops[i].reg;
+            if ((unsigned)ops[i].reg + ops[i].regs > h) h = (unsigned)ops[i].reg + ops[i].regs;
+        }
+        if (h > max_regs)
+            return false;
+
+        lo = (uint16_t)l;
+        hi = (uint16_t)h;
+        return true;
+    }
+
+    static void zm_bt_samplers(const slang_refl_const* consts, unsigned num, slang_pass_bindings& out)
+    {
+        int first = -1;
+        for (unsigned i = 0; i < num && out.num_samplers < ZM_SLANG_MAX_SAMPLERS; ++i)
+        {
+            const slang_refl_const& c = consts[i];
+            if (c.cls != ZM_RC_SAMPLER || !c.name || !c.name[0])
+                continue;
+
+            slang_sampler_bind& s = out.samplers[out.num_samplers++];
+            s.stage = (uint8_t)c.reg;
+            s.pass = 0xFF;
+            strncpy(s.name, c.name, sizeof(s.name) - 1);
+
+            slang_sampler_classify(c.name, s.kind, s.index);
+            if (s.kind == ZM_SAMP_SOURCE)
+                out.source_stage = (int32_t)c.reg;
+
+            if (first < 0)
+                first = (int)c.reg;
+        }
+
+        if (out.source_stage < 0)
+            out.source_stage = first;
+    }
+
+    bool slang_bind_table_build(
+        const slang_refl_uniform* vs,
+        unsigned num_vs,
+        const slang_refl_uniform* ps,
+        unsigned num_ps,
+        const slang_refl_const* ps_consts,
+        unsigned num_ps_consts,
+        slang_pass_bindings& out)
+    {
+        memset(&out, 0, sizeof(out));
+        out.source_stage = -1;
+
+        zm_bt_samplers(ps_consts, num_ps_consts, out);
+
+        bool ok = true;
+        for (unsigned i = 0; ok && i < num_vs; ++i)
+            ok = zm_bt_add_const(out.vs, out.num_vs, vs[i]);
+        for (unsigned i = 0; ok && i < num_ps; ++i)
+            ok = zm_bt_add_const(out.ps, out.num_ps, ps[i]);
+
+        ok = ok &&
+            zm_bt_span(out.vs, out.num_vs, ZM_SLANG_MAX_VS_CONSTS, out.vs_lo, out.vs_hi) &&
+            zm_bt_span(out.ps, out.num_ps, ZM_SLANG_MAX_PS_CONSTS, out.ps_lo, out.ps_hi);
+
+        if (!ok) {
+            out.num_vs = out.num_ps = 0;
+            out.vs_lo = out.vs_hi = out.ps_lo = out.ps_hi = 0;
+            return false;
+        }
+        out.consts_packed = 1;
+        return true;
+    }
+
+    static bool zm_bt_ops_valid(const slang_const_op* ops, uint32_t num, uint16_t lo, uint16_t hi, unsigned max_regs)
+    {
+        if (num > ZM_SLANG_MAX_CONST_OPS || hi > max_regs || lo > hi)
+            return false;
+
+        for (uint32_t i = 0; i < num; ++i)
+        {
+            const slang_const_op& op = ops[i];
+            if (op.reg < lo || (unsigned)op.reg + op.regs > hi) return false;
+            if (op.layout > ZM_CL_MAT_COLS || op.cols == 0 || op.cols > 4) return false;
+            if (op.dwords > (unsigned)op.regs * op.cols) return false;
+            if ((op.source >> 16) > ZM_SLOT_IDENTITY) return false;
+        }
+        return true;
+    }
+
+    bool slang_bindings_validate(const slang_pass_bindings& b)
+    {
+        if (b.num_samplers > ZM_SLANG_MAX_SAMPLERS || b.source_stage < -1 || b.source_stage > 15)
+            return false;
+
+        for (uint32_t i = 0; i < b.num_samplers; ++i)
+            if (b.samplers[i].kind > ZM_SAMP_FEEDBACK || b.samplers[i].stage > 15 ||
+                b.samplers[i].index > ZM_SLANG_MAX_HISTORY)
+                return false;
+
+        return zm_bt_ops_valid(b.vs, b.num_vs, b.vs_lo, b.vs_hi, ZM_SLANG_MAX_VS_CONSTS) &&
+            zm_bt_ops_valid(b.ps, b.num_ps, b.ps_lo, b.ps_hi, ZM_SLANG_MAX_PS_CONSTS);
+    }
+
+    bool slang_name_index(const char* name, const char* prefix, unsigned& idx)
+    {
+        const size_t n = strlen(prefix);
+        if (strncmp(name, prefix, n) != 0 || !name[n])
+            return false;
+
+        unsigned v = 0;
+        for (const char* p = name + n; *p; ++p) {
+            if (*p < '0' || *p > '9' || v > 0xFFFF)
+                return false;
+            v = v * 10 + (unsigned)(*p - '0');
+        }
+        idx = v;
+        return true;
+    }
+
+    void slang_sampler_classify(const char* name, uint8_t& kind, uint8_t& index)
+    {
+        unsigned n = 0;
+        kind = ZM_SAMP_ALIAS;
+        index = 0;
+
+        if (strcmp(name, "Source") == 0)
+            kind = ZM_SAMP_SOURCE;
+        else if (strcmp(name, "Original") == 0)
+            kind = ZM_SAMP_ORIGINAL;
+        else if (slang_name_index(name, "OriginalHistory", n)) {
+            // OriginalHistory0 is the current frame
+            kind = n ? ZM_SAMP_HISTORY : ZM_SAMP_ORIGINAL;
+            index = (uint8_t)(n < ZM_SLANG_MAX_HISTORY ? n : ZM_SLANG_MAX_HISTORY);
+        }
+        else if (slang_name_index(name, "PassFeedback", n))
+            kind = ZM_SAMP_FEEDBACK;
+        else {
+            const size_t len = strlen(name);
+            const size_t fl = sizeof("Feedback") - 1;
+            if (len > fl && strcmp(name + len - fl, "Feedback") == 0)
+                kind = ZM_SAMP_FEEDBACK;
+        }
+    }
+
+} // namespace ZeroMod
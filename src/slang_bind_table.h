@@ -0,0 +1,138 @@
+#pragma once
+#include <stdint.h>
+
+// ---- Per-pass binding tables ----
+// Every uniform and sampler a pass uses, flattened to register ranges at
+// build time so the draw path never touches ID3DXConstantTable. The table
+// is plain data (no pointers) and is stored in the pass cache as-is.
+// slang_d3d9_bindings.cpp reads the constant tables into the plain
+// reflection below and slang_bind_table_build does the rest; nothing in
+// here needs d3d9, so tools/zm_bind_table_check.cpp builds tables from a
+// synthetic reflection on Linux.
+#define ZM_SLANG_MAX_CONST_OPS 128
+#define ZM_SLANG_MAX_SAMPLERS 16
+#define ZM_SLANG_MAX_VS_CONSTS 256
+#define ZM_SLANG_MAX_PS_CONSTS 224
+// RetroArch's GFX_MAX_FRAME_HISTORY, checked where both are visible
+#define ZM_SLANG_MAX_HISTORY 128
+
+namespace ZeroMod {
+
+    // Uniform value sources (kind << 16 | index)
+    enum : uint32_t {
+        ZM_SLOT_NONE = 0,
+        ZM_SLOT_UNIFORM = 1,     // map->uniforms[index]
+        ZM_SLOT_TEXSIZE = 2,     // map->textures[index & 0xFF].size, array element index >> 8
+        ZM_SLOT_PARAM = 3,       // shader->parameters[index].current
+        ZM_SLOT_HALFPIXEL = 4,   // per-pass gl_HalfPixel
+        ZM_SLOT_IDENTITY = 5,    // identity 4x4 (MVP)
+    };
+
+    // Register packing, matching what ID3DXConstantTable does
+    enum : uint8_t {
+        ZM_CL_FLOAT = 0,     // SetFloatArray: raw dwords, 'cols' per register
+        ZM_CL_INT = 1,       // SetIntArray on a float register: converted to float
+        ZM_CL_MAT_ROWS = 2,  // SetMatrixTranspose, row_major storage
+        ZM_CL_MAT_COLS = 3,  // SetMatrixTranspose, column_major storage
+    };
+
+    // What a PS sampler reads
+    enum : uint8_t {
+        ZM_SAMP_SOURCE = 0,
+        ZM_SAMP_ORIGINAL = 1,
+        ZM_SAMP_ALIAS = 2,   // another pass' output, by #pragma name or PassOutputN
+        ZM_SAMP_HISTORY = 3, // OriginalHistoryN, N >= 1
+        ZM_SAMP_FEEDBACK = 4,// a pass' previous-frame output (PassFeedbackN / <alias>Feedback)
+        ZM_SAMP_LUT = 5,     // a preset texture by id; set when aliases resolve, never stored
+    };
+
+    struct slang_const_op
+    {
+        uint32_t source;   // ZM_SLOT_*
+        uint16_t reg;      // first float4 register
+        uint16_t regs;     // register count
+        uint16_t dwords;   // source dwords to pack
+        uint8_t  cols;     // components per register
+        uint8_t  layout;   // ZM_CL_*
+    };
+
+    struct slang_sampler_bind
+    {
+        uint8_t stage;
+        uint8_t kind;      // ZM_SAMP_*
+        uint8_t pass;      // ALIAS/FEEDBACK: resolved pass index, 0xFF = missing (uses Source)
+        uint8_t index;     // ZM_SAMP_HISTORY: frames back, ZM_SAMP_LUT: shader->lut index
+        char    name[64];
+    };
+
+    struct slang_pass_bindings
+    {
+        uint32_t num_vs;
+        uint32_t num_ps;
+        uint32_t num_samplers;
+        uint32_t consts_packed;    // 0 -> uniforms need the constant-table path
+        int32_t  source_stage;     // sampler register for "Source", -1 = none
+        uint16_t vs_lo, vs_hi;     // register span [lo, hi)
+        uint16_t ps_lo, ps_hi;
+
+        slang_const_op vs[ZM_SLANG_MAX_CONST_OPS];
+        slang_const_op ps[ZM_SLANG_MAX_CONST_OPS];
+        slang_sampler_bind samplers[ZM_SLANG_MAX_SAMPLERS];
+    };
+
+    // Reflection classes
+    enum : uint8_t {
+        ZM_RC_VECTOR = 0,    // scalar / vector / array of them
+        ZM_RC_MAT_ROWS = 1,
+        ZM_RC_MAT_COLS = 2,
+        ZM_RC_SAMPLER = 3,   // sampler2D
+        ZM_RC_OTHER = 4,
+    };
+
+    // One constant of a stage's reflection, what D3DXCONSTANT_DESC says about it
+    struct slang_refl_const
+    {
+        const char* name;
+        uint8_t  cls;      // ZM_RC_*
+        uint8_t  is_int;   // int or bool data
+        uint8_t  float4;   // in float4 registers (D3DXRS_FLOAT4)
+        uint16_t reg;      // first register (sampler stage for ZM_RC_SAMPLER)
+        uint16_t regs;
+        uint16_t rows;
+        uint16_t cols;
+    };
+
+    // A uniform to bind: its reflection, where its value comes from
+    // (ZM_SLOT_*) and how many bytes of it the UBO / push block holds
+    struct slang_refl_uniform
+    {
+        slang_refl_const c;
+        uint32_t source;
+        uint32_t bytes;
+    };
+
+    // Fills 'out' from a pass' reflection: one op per uniform in the order
+    // given, the register spans, and every sampler with its kind, Source's
+    // stage (else the first sampler's). False when a uniform can't be
+    // expressed as float4 registers; the ops are then cleared and
+    // consts_packed stays 0, so the pass keeps the constant-table path.
+    // Samplers are filled either way.
+    bool slang_bind_table_build(
+        const slang_refl_uniform* vs,
+        unsigned num_vs,
+        const slang_refl_uniform* ps,
+        unsigned num_ps,
+        const slang_refl_const* ps_consts,
+        unsigned num_ps_consts,
+        slang_pass_bindings& out);
+
+    // Bounds check for a table that came from disk.
+    bool slang_bindings_validate(const slang_pass_bindings& b);
+
+    // Sampler name -> ZM_SAMP_* (+ history depth). No alias lookup.
+    void slang_sampler_classify(const char* name, uint8_t& kind, uint8_t& index);
+
+    // "<prefix><digits>" -> digits
+    bool slang_name_index(const char* name, const char* prefix, unsigned& idx);
+
+} // namespace ZeroMod
@@ -0,0 +1,159 @@
+#include "slang_cache_format.h"
+#include "../smhasher/MurmurHash3.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace ZeroMod {
+
+    void scf_put_bytes(std::vector<uint8_t>& b, const void* p, size_t n)
+    {
+        const uint8_t* s = (const uint8_t*)p;
+        b.insert(b.end(), s, s + n);
+    }
+
+    void scf_put_u32(std::vector<uint8_t>& b, uint32_t v)
+    {
+        scf_put_bytes(b, &v, sizeof(v));
+    }
+
+    void scf_put_blob(std::vector<uint8_t>& b, const void* p, uint32_t n)
+    {
+        scf_put_u32(b, n);
+        if (n) scf_put_bytes(b, p, n);
+    }
+
+    bool zm_sc_reader::get(void* dst, size_t n)
+    {
+        if ((size_t)(end - p) < n) return false;
+        memcpy(dst, p, n);
+        p += n;
+        return true;
+    }
+
+    bool zm_sc_reader::get_blob(void*& out, uint32_t& n)
+    {
+        out = nullptr;
+        if (!get_u32(n)) return false;
+        if ((size_t)(end - p) < n) return false;
+        char* m = (char*)malloc((size_t)n + 1);
+        if (!m) return false;
+        memcpy(m, p, n);
+        m[n] = '\0';
+        p += n;
+        out = m;
+        return true;
+    }
+
+    void scf_pass_key(const std::string& expanded, const zm_spm& meta, const zm_sc_key_in& in, uint64_t out_key[2])
+    {
+        std::vector<uint8_t> b;
+        b.reserve(expanded.size() + 4096);
+
+        scf_put_u32(b, ZM_SC_MAGIC);
+        scf_put_u32(b, ZM_SC_VERSION);
+        scf_put_u32(b, in.compile_flags);
+        scf_put_blob(b, in.vs_profile, (uint32_t)strlen(in.vs_profile));
+        scf_put_blob(b, in.ps_profile, (uint32_t)strlen(in.ps_profile));
+        scf_put_bytes(b, expanded.data(), expanded.size());
+
+        // The pass' own #pragma parameters, not the preset-wide list: that
+        // one depends on which passes registered theirs first. Uniforms are
+        // stored by parameter id, so the list order doesn't matter on load.
+        scf_put_u32(b, (uint32_t)meta.params.size());
+        for (const zm_spm_param& p : meta.params) {
+            scf_put_blob(b, p.id.data(), (uint32_t)p.id.size());
+            scf_put_bytes(b, &p.initial, sizeof(p.initial));
+            scf_put_bytes(b, &p.minimum, sizeof(p.minimum));
+            scf_put_bytes(b, &p.maximum, sizeof(p.maximum));
+            scf_put_bytes(b, &p.step, sizeof(p.step));
+        }
+
+        scf_put_u32(b, in.pass);
+        scf_put_u32(b, in.num_passes);
+        for (unsigned i = 0; i < in.num_aliases; ++i)
+            scf_put_blob(b, in.aliases[i], (uint32_t)strlen(in.aliases[i]));
+        scf_put_u32(b, in.num_luts);
+        for (unsigned i = 0; i < in.num_luts; ++i)
+            scf_put_blob(b, in.lut_ids[i], (uint32_t)strlen(in.lut_ids[i]));
+
+        MurmurHash3_x64_128(b.data(), (int)b.size(), 0, out_key);
+    }
+
+    void scf_file_name(const uint64_t key[2], char* out, size_t n)
+    {
+        snprintf(out, n, "%016llx%016llx.zmsc", (unsigned long long)key[0], (unsigned long long)key[1]);
+    }
+
+    void scf_header(const uint64_t key[2], const std::vector<uint8_t>& payload, zm_sc_header& out)
+    {
+        out = {};
+        out.magic = ZM_SC_MAGIC;
+        out.version = ZM_SC_VERSION;
+        out.key[0] = key[0];
+        out.key[1] = key[1];
+        out.payload_size = (uint32_t)payload.size();
+        MurmurHash3_x86_32(payload.data(), (int)payload.size(), 0, &out.payload_hash);
+    }
+
+    bool scf_header_ok(const zm_sc_header& h, const uint64_t key[2])
+    {
+        return h.magic == ZM_SC_MAGIC &&
+            h.version == ZM_SC_VERSION &&
+            h.key[0] == key[0] && h.key[1] == key[1] &&
+            h.payload_size > 0 && h.payload_size < (64u << 20);
+    }
+
+    bool scf_payload_ok(const zm_sc_header& h, const uint8_t* payload, size_t n)
+    {
+        if (n != h.payload_size)
+            return false;
+        uint32_t hash = 0;
+        MurmurHash3_x86_32(payload, (int)n, 0, &hash);
+        return hash == h.payload_hash;
+    }
+
+    void scf_put_code(
+        std::vector<uint8_t>& b,
+        const char* alias,
+        const char* hlsl_vs,
+        const char* hlsl_ps,
+        const void* vs_code, uint32_t vs_size,
+        const void* ps_code, uint32_t ps_size)
+    {
+        char a[64] = {};
+        if (alias) strncpy(a, alias, sizeof(a) - 1);
+        scf_put_bytes(b, a, sizeof(a));
+
+        scf_put_blob(b, hlsl_vs, (uint32_t)strlen(hlsl_vs));
+        scf_put_blob(b, hlsl_ps, (uint32_t)strlen(hlsl_ps));
+        scf_put_blob(b, vs_code, vs_size);
+        scf_put_blob(b, ps_code, ps_size);
+    }
+
+    bool scf_get_code(
+        zm_sc_reader& r,
+        char alias[64],
+        char*& hlsl_vs,
+        char*& hlsl_ps,
+        void*& vs_code, uint32_t& vs_size,
+        void*& ps_code, uint32_t& ps_size)
+    {
+        void* vs_hlsl = nullptr; uint32_t vs_hlsl_n = 0;
+        void* ps_hlsl = nullptr; uint32_t ps_hlsl_n = 0;
+        vs_code = ps_code = nullptr;
+
+        const bool ok = r.get(alias, 64) &&
+            r.get_blob(vs_hlsl, vs_hlsl_n) &&
+            r.get_blob(ps_hlsl, ps_hlsl_n) &&
+            r.get_blob(vs_code, vs_size) &&
+            r.get_blob(ps_code, ps_size);
+
+        hlsl_vs = (char*)vs_hlsl;
+        hlsl_ps = (char*)ps_hlsl;
+        alias[63] = '\0';
+        return ok;
+    }
+
+} // namespace ZeroMod
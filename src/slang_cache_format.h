@@ -0,0 +1,101 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "slang_pass_meta.h"
+
+// ---- Slang pass cache: key and entry format ----
+// The device-free half of slang_d3d9_cache.cpp: the bytes a pass' cache key
+// hashes and the layout of a .zmsc entry up to its reflection (header,
+// payload hash, alias, both HLSL stages and both bytecode blobs). The
+// uniform and binding tables that follow need the runtime's semantics map
+// and stay in slang_d3d9_cache.cpp. Nothing in here touches the file
+// system or the OS, so tools/zm_slang_cache_bench.cpp keys and reads
+// entries exactly as the game does.
+
+namespace ZeroMod {
+
+    // Bump when the on-disk layout or anything feeding the HLSL changes.
+    const uint32_t ZM_SC_MAGIC = 0x43534D5A; // 'ZMSC'
+    const uint32_t ZM_SC_VERSION = 4;
+
+    struct zm_sc_header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key[2];
+        uint32_t payload_size;
+        uint32_t payload_hash;
+    };
+
+    // What slang_process treats as a semantic besides the source: pass
+    // index and count, every pass alias (PassOutput / <alias> /
+    // <alias>Feedback) and every LUT id
+    struct zm_sc_key_in
+    {
+        const char* vs_profile;
+        const char* ps_profile;
+        uint32_t compile_flags;
+        unsigned pass;
+        unsigned num_passes;
+        const char* const* aliases;     // num_aliases, "" when a pass has none
+        unsigned num_aliases;
+        const char* const* lut_ids;
+        unsigned num_luts;
+    };
+
+    // Key of a pass: 'expanded' (its include-expanded source), 'meta' (the
+    // spm_parse of it; only its own #pragma parameters go in, not the
+    // preset-wide list) and 'in'.
+    void scf_pass_key(const std::string& expanded, const zm_spm& meta, const zm_sc_key_in& in, uint64_t out_key[2]);
+
+    // "<key as 32 hex digits>.zmsc"
+    void scf_file_name(const uint64_t key[2], char* out, size_t n);
+
+    // ---- blob helpers ----
+    void scf_put_bytes(std::vector<uint8_t>& b, const void* p, size_t n);
+    void scf_put_u32(std::vector<uint8_t>& b, uint32_t v);
+    void scf_put_blob(std::vector<uint8_t>& b, const void* p, uint32_t n);
+
+    struct zm_sc_reader
+    {
+        const uint8_t* p;
+        const uint8_t* end;
+
+        bool get(void* dst, size_t n);
+        bool get_u32(uint32_t& v) { return get(&v, sizeof(v)); }
+
+        // Returns a malloc'd copy (NUL terminated so it works for HLSL too)
+        bool get_blob(void*& out, uint32_t& n);
+    };
+
+    // Header for 'payload' stored under 'key'
+    void scf_header(const uint64_t key[2], const std::vector<uint8_t>& payload, zm_sc_header& out);
+
+    // Magic, version, key and a sane payload size; read the payload only then
+    bool scf_header_ok(const zm_sc_header& h, const uint64_t key[2]);
+
+    // The payload read back matches the header's hash
+    bool scf_payload_ok(const zm_sc_header& h, const uint8_t* payload, size_t n);
+
+    // The front of every payload. 'alias' is stored in a fixed 64 bytes.
+    void scf_put_code(
+        std::vector<uint8_t>& b,
+        const char* alias,
+        const char* hlsl_vs,
+        const char* hlsl_ps,
+        const void* vs_code, uint32_t vs_size,
+        const void* ps_code, uint32_t ps_size);
+
+    // Reads what scf_put_code wrote; the strings and blobs are malloc'd
+    // (free them on failure too). False on a truncated payload.
+    bool scf_get_code(
+        zm_sc_reader& r,
+        char alias[64],
+        char*& hlsl_vs,
+        char*& hlsl_ps,
+        void*& vs_code, uint32_t& vs_size,
+        void*& ps_code, uint32_t& ps_size);
+
+} // namespace ZeroMod
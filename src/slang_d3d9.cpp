@@ -1,6 +1,16 @@
 ﻿#include "slang_d3d9.h"
+#include "slang_d3d9_cache.h"
+#include "slang_d3d9_bindings.h"
+#include "const_shadow.h"
+#include "slang_d3d9_async.h"
+#include "slang_d3d9_rtpool.h"
+#include "slang_d3d9_preset_load.h"
+#include "slang_d3d9_lut.h"
+#include "slang_prepare_batch.h"
+#include "slang_frame_store.h"
 #include "d3d9video.h"
 #include "log.h"
+#include "gpu_prof.h"
 
 #include "../retroarch/retroarch/gfx/video_shader_parse.h"
 #include "../retroarch/retroarch/gfx/drivers_shader/slang_process.h"
@@ -13,8 +23,22 @@
 #include <vector>
 #include <stdint.h>
 
+static_assert(ZM_SFS_MAX_PASSES == GFX_MAX_SHADERS, "slang_frame_store.h is out of step with RetroArch");
+
 #define ZM_DUMP_PASS0_HLSL 0
 
+// Part of the pass cache key; change both together.
+#define ZM_SLANG_COMPILE_FLAGS D3DXSHADER_OPTIMIZATION_LEVEL3
+
+// ---- Shadowed constant upload ----
+// Each pass packs its uniforms into float4 registers through its binding
+// table (slang_d3d9_bindings.h), diffs against what is already on the device and uploads only
+// the dirty span (const_shadow.h) with one Set*ShaderConstantF per stage.
+// Set to 0 for the per-name ID3DXConstantTable path.
+#define ZM_SLANG_CONST_SHADOW 1
+// Log upload counters every N chain frames (0 = never)
+#define ZM_SLANG_CONST_STATS_INTERVAL 600
+
 #ifndef ZEROMOD_FLOAT4_T_DEFINED
 #define ZEROMOD_FLOAT4_T_DEFINED
 
@@ -43,6 +67,10 @@ typedef struct float4_t
 
 namespace ZeroMod {
 
+    // Anything that reads or writes the shared video_shader while passes
+    // are being prepared on several threads.
+    static cs_wrapper slang_process_cs;
+
     struct d3d9_slang_runtime
     {
         char* built_for_path;
@@ -62,6 +90,54 @@ namespace ZeroMod {
 
         uint32_t live_frame_count = 0;
         int32_t  live_frame_dir = 1;
+
+        // Array-backed semantics: OriginalHistoryN, PassOutputN, PassFeedbackN.
+        // slang_process indexes these through the map strides.
+        IDirect3DTexture9* live_history_tex[GFX_MAX_FRAME_HISTORY + 1];
+        float4_t           live_history_size[GFX_MAX_FRAME_HISTORY + 1];
+        IDirect3DTexture9* live_pass_tex[GFX_MAX_SHADERS];
+        float4_t           live_pass_size[GFX_MAX_SHADERS];
+        IDirect3DTexture9* live_feedback_tex[GFX_MAX_SHADERS];
+        float4_t           live_feedback_size[GFX_MAX_SHADERS];
+
+        // Preset textures (textures = ...), one LUT cache reference each,
+        // sampled with their own wrap/filter rather than the pass'.
+        unsigned num_luts;
+        IDirect3DTexture9*   live_lut_tex[GFX_MAX_TEXTURES];
+        float4_t             live_lut_size[GFX_MAX_TEXTURES];
+        D3DTEXTUREADDRESS    lut_addr[GFX_MAX_TEXTURES];
+        D3DTEXTUREFILTERTYPE lut_filter[GFX_MAX_TEXTURES];
+        D3DTEXTUREFILTERTYPE lut_mip[GFX_MAX_TEXTURES];
+
+        // OriginalHistory ring of history_depth + 1 frames and the feedback
+        // pairs' halves, by index (slang_frame_store.h). The Original from k
+        // frames ago is history_tex[sfs_history_slot(frames, k)].
+        slang_frame_store frames;
+        UINT history_w, history_h;
+        IDirect3DTexture9* history_tex[GFX_MAX_FRAME_HISTORY + 1];
+        IDirect3DSurface9* history_surf[GFX_MAX_FRAME_HISTORY + 1];
+
+        // Points at the live_* fields above; binding-table slots decode against it.
+        semantics_map_t map;
+
+        // Intermediate pass targets. Outlives chain rebuilds so a preset
+        // swap or resize can pick up surfaces that are already allocated.
+        slang_rt_pool rt_pool;
+
+        // What we last wrote to the device constant registers. Only trusted
+        // within one slang_d3d9_frame: the caller's state block restores the
+        // game's constants afterwards.
+        zm_const_shadow vs_shadow;
+        zm_const_shadow ps_shadow;
+        float    const_scratch[ZM_SLANG_MAX_VS_CONSTS][4];
+
+        // upload counters (current frame / accumulated since last stats line)
+        uint32_t const_calls_frame;
+        uint32_t const_bytes_frame;
+        uint64_t const_calls_total;
+        uint64_t const_bytes_total;
+        uint64_t const_skipped_total;
+        uint32_t const_frames;
     };
     static void slang_pass_clear(d3d9_slang_pass& p)
     {
@@ -71,12 +147,30 @@ namespace ZeroMod {
         if (p.vs) { p.vs->Release(); p.vs = nullptr; }
         if (p.ps) { p.ps->Release(); p.ps = nullptr; }
 
-        if (p.rt_surf) { p.rt_surf->Release(); p.rt_surf = nullptr; }
-        if (p.rt) { p.rt->Release();      p.rt = nullptr; }
+        // pool-owned
+        p.rt_surf = nullptr;
+        p.rt = nullptr;
+        p.rt_slot = -1;
+        p.rt_last_reader = 0;
+
+        for (int k = 0; k < 2; ++k) {
+            if (p.fb_surf[k]) { p.fb_surf[k]->Release(); p.fb_surf[k] = nullptr; }
+            if (p.fb_tex[k]) { p.fb_tex[k]->Release();  p.fb_tex[k] = nullptr; }
+        }
+        p.feedback = false;
 
         if (p.hlsl_vs) { free(p.hlsl_vs); p.hlsl_vs = nullptr; }
         if (p.hlsl_ps) { free(p.hlsl_ps); p.hlsl_ps = nullptr; }
 
+        // reflection arrays are malloc'd by slang_process / the pass cache
+        for (int c = 0; c < SLANG_CBUFFER_MAX; ++c)
+            if (p.sem.cbuffers[c].uniforms) free(p.sem.cbuffers[c].uniforms);
+        if (p.sem.textures) free(p.sem.textures);
+        p.sem = {};
+
+        if (p.bind) { free(p.bind); p.bind = nullptr; }
+        p.consts_planned = false;
+
         p.compiled = false;
         p.sem_valid = false;  //compiled pass program owned
         p.source_sampler_reg = -1;
@@ -98,7 +192,7 @@ namespace ZeroMod {
     }
 
     static bool slang_bind_and_draw_pass(
-        IDirect3DDevice9* dev,
+        zm_state_delta& sd,
         d3d9_video_struct* d3d9,
         d3d9_slang_runtime* rt,
         d3d9_slang_pass& P,
@@ -116,58 +210,236 @@ namespace ZeroMod {
         b[sizeof(b) - 1] = '\0';
         OutputDebugStringA(b);
     }
-    static bool slang_ensure_rt(
+    // Last pass that samples each intermediate output (slang_rt_slots.cpp)
+    static void slang_rt_liveness(d3d9_slang_runtime* rt)
+    {
+        const unsigned N = rt->num_passes;
+
+        const slang_pass_bindings* binds[GFX_MAX_SHADERS];
+        unsigned last[GFX_MAX_SHADERS];
+        for (unsigned k = 0; k < N; ++k)
+            binds[k] = rt->passes[k].bind;
+
+        rts_last_readers(binds, N, ZM_SLANG_RT_ALIASING != 0, last);
+
+        for (unsigned j = 0; j < N; ++j)
+            rt->passes[j].rt_last_reader = last[j];
+
+        for (unsigned j = 0; j + 1 < N; ++j)
+            zm_dbgf("[ZeroMod] pass%u: output live until pass%u\n", j, rt->passes[j].rt_last_reader);
+    }
+
+    static inline float4_t zm_size4(UINT w, UINT h)
+    {
+        return { (float)w, (float)h, 1.0f / (float)w, 1.0f / (float)h };
+    }
+
+    // Black, so history/feedback reads before the first write are defined.
+    static bool zm_create_cleared_rt(
         IDirect3DDevice9* dev,
-        d3d9_slang_pass& p,
-        UINT w,
-        UINT h,
-        bool fp_fbo
-    )
+        UINT w, UINT h,
+        D3DFORMAT fmt,
+        IDirect3DTexture9** tex,
+        IDirect3DSurface9** surf)
     {
-        if (!dev || !w || !h)
+        *tex = nullptr;
+        *surf = nullptr;
+
+        if (FAILED(dev->CreateTexture(w, h, 1, D3DUSAGE_RENDERTARGET, fmt, D3DPOOL_DEFAULT, tex, nullptr)) || !*tex)
+            return false;
+
+        if (FAILED((*tex)->GetSurfaceLevel(0, surf)) || !*surf) {
+            (*tex)->Release();
+            *tex = nullptr;
+            *surf = nullptr;
             return false;
+        }
+
+        dev->ColorFill(*surf, nullptr, D3DCOLOR_ARGB(0, 0, 0, 0));
+        return true;
+    }
+
+    static void slang_history_release(d3d9_slang_runtime* rt)
+    {
+        for (unsigned k = 0; k <= GFX_MAX_FRAME_HISTORY; ++k) {
+            if (rt->history_surf[k]) { rt->history_surf[k]->Release(); rt->history_surf[k] = nullptr; }
+            if (rt->history_tex[k]) { rt->history_tex[k]->Release();  rt->history_tex[k] = nullptr; }
+            rt->live_history_tex[k] = nullptr;
+        }
+        sfs_history_reset(rt->frames);
+        rt->history_w = rt->history_h = 0;
+    }
+
+    static bool slang_history_ensure(IDirect3DDevice9* dev, d3d9_slang_runtime* rt, UINT w, UINT h)
+    {
+        const unsigned n = sfs_history_slots(rt->frames);
 
-        // If existing RT matches size, keep it.
-        if (p.rt && p.rt_surf)
+        if (rt->history_w == w && rt->history_h == h && rt->history_tex[n - 1])
+            return true;
+
+        // Size change: old frames no longer line up, start from black
+        slang_history_release(rt);
+
+        for (unsigned k = 0; k < n; ++k) {
+            if (!zm_create_cleared_rt(dev, w, h, D3DFMT_A8R8G8B8, &rt->history_tex[k], &rt->history_surf[k])) {
+                zm_dbgf("[ZeroMod] slang history: CreateTexture %ux%u FAILED (%u/%u)\n", w, h, k, n);
+                slang_history_release(rt);
+                return false;
+            }
+        }
+
+        rt->history_w = w;
+        rt->history_h = h;
+        zm_dbgf("[ZeroMod] slang history: %u frames @ %ux%u\n", n, w, h);
+        return true;
+    }
+
+    static void slang_history_publish(d3d9_slang_runtime* rt)
+    {
+        const unsigned n = sfs_history_slots(rt->frames);
+        const float4_t sz = zm_size4(rt->history_w, rt->history_h);
+
+        for (unsigned k = 0; k < n; ++k) {
+            rt->live_history_tex[k] = rt->history_tex[sfs_history_slot(rt->frames, k)];
+            rt->live_history_size[k] = sz;
+        }
+    }
+
+    static bool slang_feedback_ensure(IDirect3DDevice9* dev, d3d9_slang_runtime* rt, unsigned i, UINT w, UINT h, D3DFORMAT fmt)
+    {
+        d3d9_slang_pass& p = rt->passes[i];
+        if (p.fb_tex[0] && p.fb_tex[1])
         {
             D3DSURFACE_DESC d{};
-            if (SUCCEEDED(p.rt->GetLevelDesc(0, &d)) &&
-                d.Width == w && d.Height == h)
-            {
+            if (SUCCEEDED(p.fb_tex[0]->GetLevelDesc(0, &d)) &&
+                d.Width == w && d.Height == h && d.Format == fmt)
                 return true;
-            }
         }
 
-        // Release old
-        if (p.rt_surf) { p.rt_surf->Release(); p.rt_surf = nullptr; }
-        if (p.rt) { p.rt->Release();      p.rt = nullptr; }
+        for (int k = 0; k < 2; ++k) {
+            if (p.fb_surf[k]) { p.fb_surf[k]->Release(); p.fb_surf[k] = nullptr; }
+            if (p.fb_tex[k]) { p.fb_tex[k]->Release();  p.fb_tex[k] = nullptr; }
+        }
+        sfs_fb_reset(rt->frames, i, false);
 
-        // Pick format
+        for (int k = 0; k < 2; ++k) {
+            if (!zm_create_cleared_rt(dev, w, h, fmt, &p.fb_tex[k], &p.fb_surf[k]))
+                return false;
+        }
+        sfs_fb_reset(rt->frames, i, true);
+        return true;
+    }
+
+    // This frame's output target for a pass: borrowed from the pool, or the
+    // current half of the pass' own pair if something reads its feedback.
+    static bool slang_acquire_pass_rt(
+        IDirect3DDevice9* dev,
+        d3d9_slang_runtime* rt,
+        unsigned i,
+        UINT w,
+        UINT h,
+        bool fp_fbo
+    )
+    {
+        d3d9_slang_pass& p = rt->passes[i];
         // NOTE: D3D9 floating RT support depends on device caps; this mirrors CG-style behavior.
         const D3DFORMAT fmt = fp_fbo ? D3DFMT_A16B16G16R16F : D3DFMT_A8R8G8B8;
 
-        HRESULT hr = dev->CreateTexture(
-            w, h,
-            1,
-            D3DUSAGE_RENDERTARGET,
-            fmt,
-            D3DPOOL_DEFAULT,
-            &p.rt,
-            nullptr);
+        if (p.feedback)
+        {
+            if (!slang_feedback_ensure(dev, rt, i, w, h, fmt))
+                return false;
+            p.rt = p.fb_tex[sfs_fb_write(rt->frames, i)];
+            p.rt_surf = p.fb_surf[sfs_fb_write(rt->frames, i)];
+            return true;
+        }
 
-        if (FAILED(hr) || !p.rt)
+        const int slot = slang_rt_pool_acquire(rt->rt_pool, dev, w, h, fmt, p.rt_slot);
+        if (slot < 0)
             return false;
 
-        hr = p.rt->GetSurfaceLevel(0, &p.rt_surf);
-        if (FAILED(hr) || !p.rt_surf)
+        p.rt_slot = slot;
+        p.rt = rt->rt_pool.slots[slot].tex;
+        p.rt_surf = rt->rt_pool.slots[slot].surf;
+        return true;
+    }
+
+    // How much frame history the chain needs. slang_process records
+    // history_size / pass[].feedback in the preset, but cache hits skip it,
+    // so the binding tables are scanned as well.
+    static void slang_history_plan(d3d9_slang_runtime* rt, const video_shader* shader)
+    {
+        const unsigned N = rt->num_passes;
+        unsigned depth = shader->history_size > 0 ? (unsigned)shader->history_size : 0;
+
+        for (unsigned j = 0; j < N; ++j)
+            rt->passes[j].feedback = shader->pass[j].feedback;
+
+        auto note_feedback = [&](unsigned j) {
+            if (j < N) rt->passes[j].feedback = true;
+        };
+
+        for (unsigned k = 0; k < N; ++k)
         {
-            p.rt->Release();
-            p.rt = nullptr;
-            return false;
+            const d3d9_slang_pass& P = rt->passes[k];
+            if (P.bind)
+            {
+                const slang_pass_bindings& b = *P.bind;
+                for (unsigned s = 0; s < b.num_samplers; ++s) {
+                    if (b.samplers[s].kind == ZM_SAMP_HISTORY && b.samplers[s].index > depth)
+                        depth = b.samplers[s].index;
+                    if (b.samplers[s].kind == ZM_SAMP_FEEDBACK)
+                        note_feedback(b.samplers[s].pass);
+                }
+
+                const slang_const_op* ops[2] = { b.vs, b.ps };
+                const uint32_t nops[2] = { b.num_vs, b.num_ps };
+                for (int st = 0; st < 2; ++st) {
+                    for (uint32_t o = 0; o < nops[st]; ++o) {
+                        const uint32_t src = ops[st][o].source;
+                        if ((src >> 16) != ZM_SLOT_TEXSIZE) continue;
+                        const uint32_t sem = src & 0xFF;
+                        const uint32_t elem = (src >> 8) & 0xFF;
+                        if (sem == SLANG_TEXTURE_SEMANTIC_ORIGINAL_HISTORY && elem > depth) depth = elem;
+                        if (sem == SLANG_TEXTURE_SEMANTIC_PASS_FEEDBACK) note_feedback(elem);
+                    }
+                }
+            }
+            else if (P.ps_ct)
+            {
+                D3DXCONSTANTTABLE_DESC td{};
+                if (FAILED(P.ps_ct->GetDesc(&td)))
+                    continue;
+
+                for (UINT c = 0; c < td.Constants; ++c) {
+                    D3DXCONSTANT_DESC cd{};
+                    UINT n = 1;
+                    D3DXHANDLE h = P.ps_ct->GetConstant(nullptr, c);
+                    if (!h || FAILED(P.ps_ct->GetConstantDesc(h, &cd, &n))) continue;
+                    if (cd.Type != D3DXPT_SAMPLER2D || !cd.Name) continue;
+
+                    uint8_t kind = 0, index = 0;
+                    slang_sampler_classify(cd.Name, kind, index);
+                    if (kind == ZM_SAMP_HISTORY && index > depth)
+                        depth = index;
+                    if (kind == ZM_SAMP_FEEDBACK)
+                        note_feedback(slang_sampler_resolve_pass(cd.Name, kind, shader, N));
+                }
+            }
         }
 
-        return true;
+        if (depth > GFX_MAX_FRAME_HISTORY)
+            depth = GFX_MAX_FRAME_HISTORY;
+        rt->frames.history_depth = depth;
+
+        unsigned fb = 0;
+        for (unsigned j = 0; j < N; ++j)
+            if (rt->passes[j].feedback) fb++;
+
+        if (depth || fb)
+            zm_dbgf("[ZeroMod] slang frame store: history=%u feedback passes=%u\n", depth, fb);
     }
+
     static bool ensure_zero_rt(IDirect3DDevice9* dev, zm_zero_stage_rt& Z, UINT w, UINT h)
     {
         if (!dev || !w || !h) return false;
@@ -236,85 +508,6 @@ namespace ZeroMod {
         return { w, h, 1.0f / w, 1.0f / h };
     }
 
-    static D3DXHANDLE zm_find_ct_handle(ID3DXConstantTable* ct, const char* id)
-    {
-        if (!ct || !id || !id[0]) return nullptr;
-
-        // MVP special-case (shader emits global_MVP)
-        if (_stricmp(id, "MVP") == 0)
-            return ct->GetConstantByName(nullptr, "global_MVP");
-
-        auto try_name = [&](const char* name) -> D3DXHANDLE {
-            return name ? ct->GetConstantByName(nullptr, name) : nullptr;
-            };
-
-        auto try_fmt1 = [&](const char* fmt, const char* a) -> D3DXHANDLE {
-            char buf[128];
-            _snprintf(buf, sizeof(buf), fmt, a);
-            return try_name(buf);
-            };
-
-        auto try_fmt2 = [&](const char* fmt, const char* a, const char* b) -> D3DXHANDLE {
-            char buf[128];
-            _snprintf(buf, sizeof(buf), fmt, a, b);
-            return try_name(buf);
-            };
-
-        auto try_all_for_id = [&](const char* s) -> D3DXHANDLE
-            {
-                // 1) raw
-                if (D3DXHANDLE h = try_name(s)) return h;
-
-                // 2) params_foo / params.foo
-                if (D3DXHANDLE h = try_fmt1("params_%s", s)) return h;
-                if (D3DXHANDLE h = try_fmt1("params.%s", s)) return h;
-
-                // 3) global_foo / global.foo
-                if (D3DXHANDLE h = try_fmt1("global_%s", s)) return h;
-                if (D3DXHANDLE h = try_fmt1("global.%s", s)) return h;
-
-                // 4) NEW: registers_foo (SPIRV-Cross common)
-                if (D3DXHANDLE h = try_fmt1("registers_%s", s)) return h;
-
-                // 5) NEW: Push.registers_foo (cbuffer-scoped exposure)
-                if (D3DXHANDLE h = try_fmt1("Push.registers_%s", s)) return h;
-
-                // 6) NEW: sometimes just Push.foo
-                if (D3DXHANDLE h = try_fmt1("Push.%s", s)) return h;
-
-                // 7) NEW: occasionally global/params can wrap registers_
-                if (D3DXHANDLE h = try_fmt2("global_%s%s", "registers_", s)) return h; // "global_registers_Foo"
-                if (D3DXHANDLE h = try_fmt2("params_%s%s", "registers_", s)) return h;
-
-                return nullptr;
-            };
-
-        // First pass: exact id
-        if (D3DXHANDLE h = try_all_for_id(id))
-            return h;
-
-        // Second pass: case-normalized variant (covers brighten_scanlines vs BRIGHTEN_SCANLINES)
-        {
-            char up[128];
-            char lo[128];
-
-            _snprintf(up, sizeof(up), "%s", id);
-            _snprintf(lo, sizeof(lo), "%s", id);
-
-            for (char* p = up; *p; ++p) *p = (char)toupper((unsigned char)*p);
-            for (char* p = lo; *p; ++p) *p = (char)tolower((unsigned char)*p);
-
-            if (_stricmp(up, id) != 0) {
-                if (D3DXHANDLE h = try_all_for_id(up)) return h;
-            }
-            if (_stricmp(lo, id) != 0) {
-                if (D3DXHANDLE h = try_all_for_id(lo)) return h;
-            }
-        }
-
-        return nullptr;
-    }
-
     static bool zm_set_uniform_by_desc(
         IDirect3DDevice9* dev,
         ID3DXConstantTable* ct,
@@ -383,50 +576,98 @@ namespace ZeroMod {
         // Float (and everything else as float slots)
         return SUCCEEDED(ct->SetFloatArray(dev, h, (const float*)data, dwords));
     }
-    static IDirect3DTexture9* zm_find_alias_rt_tex(
+    // Texture behind a classified sampler. Anything missing keeps Source so
+    // things don't go black.
+    static IDirect3DTexture9* zm_sampler_tex(
         const d3d9_slang_runtime* rt,
-        const video_shader* preset,   // d3d9->shader
-        const char* alias)
+        uint8_t kind,
+        uint8_t pass,
+        uint8_t index,
+        IDirect3DTexture9* in_tex)
     {
-        if (!rt || !preset || !alias || !alias[0]) return nullptr;
+        IDirect3DTexture9* tex = nullptr;
 
-        const unsigned N = rt->num_passes;
-        for (unsigned j = 0; j < N; ++j)
+        switch (kind)
         {
-            const char* a = preset->pass[j].alias;
-            if (a && a[0] && strcmp(a, alias) == 0)
-                return rt->passes[j].rt; // RT texture for that earlier pass
+        case ZM_SAMP_ORIGINAL:
+            tex = rt->live_original_tex;
+            break;
+        case ZM_SAMP_HISTORY:
+            if (index <= rt->frames.history_depth)
+                tex = rt->live_history_tex[index];
+            break;
+        case ZM_SAMP_ALIAS:
+            // this frame's output of an earlier pass
+            if (pass < rt->num_passes)
+                tex = rt->passes[pass].rt;
+            break;
+        case ZM_SAMP_FEEDBACK:
+            // last frame's output: the half of the pair not being rendered
+            if (pass < rt->num_passes && rt->passes[pass].feedback)
+                tex = rt->passes[pass].fb_tex[sfs_fb_read(rt->frames, pass)];
+            break;
+        case ZM_SAMP_LUT:
+            if (index < rt->num_luts)
+                tex = rt->live_lut_tex[index];
+            break;
+        default:
+            break;
+        }
+
+        return tex ? tex : in_tex;
+    }
+    static D3DTEXTUREADDRESS zm_addr_from_wrap(gfx_wrap_type w)
+    {
+        switch (w) {
+        case RARCH_WRAP_BORDER: return D3DTADDRESS_BORDER;
+        case RARCH_WRAP_EDGE:   return D3DTADDRESS_CLAMP;
+        case RARCH_WRAP_REPEAT: return D3DTADDRESS_WRAP;
+        case RARCH_WRAP_MIRRORED_REPEAT: return D3DTADDRESS_MIRROR;
+        default: return D3DTADDRESS_CLAMP;
         }
-        return nullptr;
     }
+
+    static D3DTEXTUREFILTERTYPE zm_filt_from_filter(unsigned f)
+    {
+        return (f == RARCH_FILTER_NEAREST) ? D3DTEXF_POINT : D3DTEXF_LINEAR;
+    }
+
+    static void zm_set_pass_sampler(
+        zm_state_delta& sd,
+        int stage,
+        IDirect3DTexture9* tex,
+        D3DTEXTUREADDRESS addr,
+        D3DTEXTUREFILTERTYPE ff,
+        D3DTEXTUREFILTERTYPE mip = D3DTEXF_NONE)
+    {
+        sd_texture(sd, stage, tex);
+
+        sd_sampler(sd, stage, D3DSAMP_ADDRESSU, addr);
+        sd_sampler(sd, stage, D3DSAMP_ADDRESSV, addr);
+        sd_sampler(sd, stage, D3DSAMP_MAGFILTER, ff);
+        sd_sampler(sd, stage, D3DSAMP_MINFILTER, ff);
+        sd_sampler(sd, stage, D3DSAMP_MIPFILTER, mip);
+        // >>> kill gamma state leakage
+        sd_sampler(sd, stage, D3DSAMP_SRGBTEXTURE, FALSE);
+        if (addr == D3DTADDRESS_BORDER)
+            sd_sampler(sd, stage, D3DSAMP_BORDERCOLOR, 0x00000000);
+    }
+
     static void zm_bind_all_ps_samplers_by_ct(
-        IDirect3DDevice9* dev,
+        zm_state_delta& sd,
         d3d9_video_struct* d3d9,
         d3d9_slang_runtime* rt,
         const d3d9_slang_pass& P,
         const video_shader_pass& cfg,
         IDirect3DTexture9* in_tex)
     {
-        if (!dev || !d3d9 || !rt || !P.ps_ct || !in_tex) return;
+        if (!sd.dev || !d3d9 || !rt || !P.ps_ct || !in_tex) return;
 
         D3DXCONSTANTTABLE_DESC td{};
         if (FAILED(P.ps_ct->GetDesc(&td))) return;
 
-        auto addr_from_wrap = [](gfx_wrap_type w) -> D3DTEXTUREADDRESS {
-            switch (w) {
-            case RARCH_WRAP_BORDER: return D3DTADDRESS_BORDER;
-            case RARCH_WRAP_EDGE:   return D3DTADDRESS_CLAMP;
-            case RARCH_WRAP_REPEAT: return D3DTADDRESS_WRAP;
-            case RARCH_WRAP_MIRRORED_REPEAT: return D3DTADDRESS_MIRROR;
-            default: return D3DTADDRESS_CLAMP;
-            }
-            };
-        auto filt_from_filter = [](unsigned f) -> D3DTEXTUREFILTERTYPE {
-            return (f == RARCH_FILTER_NEAREST) ? D3DTEXF_POINT : D3DTEXF_LINEAR;
-            };
-
-        const D3DTEXTUREADDRESS addr = addr_from_wrap(cfg.wrap);
-        const D3DTEXTUREFILTERTYPE ff = filt_from_filter(cfg.filter);
+        const D3DTEXTUREADDRESS addr = zm_addr_from_wrap(cfg.wrap);
+        const D3DTEXTUREFILTERTYPE ff = zm_filt_from_filter(cfg.filter);
 
         for (UINT i = 0; i < td.Constants; ++i)
         {
@@ -444,37 +685,24 @@ namespace ZeroMod {
             const int stage = (int)cd.RegisterIndex;
             if (stage < 0) continue;
 
-            IDirect3DTexture9* tex = nullptr;
-
-            if (strcmp(cd.Name, "Source") == 0)
-            {
-                tex = in_tex;
-            }
-            else if (strcmp(cd.Name, "Original") == 0)
-            {
-                tex = rt->live_original_tex ? rt->live_original_tex : in_tex;
-            }
-            else
-            {
-                // Alias samplers: refpass, scalefx_pass0, etc.
-                tex = zm_find_alias_rt_tex(rt, &d3d9->shader, cd.Name);
-
-                // Optional fallback if alias missing (keeps things from going black)
-                if (!tex)
-                    tex = in_tex;
+            // Source / Original / OriginalHistoryN / alias / PassOutputN / feedback / LUT
+            uint8_t kind = 0, index = 0;
+            slang_sampler_classify(cd.Name, kind, index);
+            const uint8_t pass = slang_sampler_resolve_pass(cd.Name, kind, &d3d9->shader, rt->num_passes);
+            if (kind == ZM_SAMP_ALIAS && pass == 0xFF) {
+                const uint8_t lut = slang_sampler_resolve_lut(cd.Name, &d3d9->shader);
+                if (lut != 0xFF) {
+                    kind = ZM_SAMP_LUT;
+                    index = lut;
+                }
             }
 
-            dev->SetTexture(stage, tex);
+            IDirect3DTexture9* tex = zm_sampler_tex(rt, kind, pass, index, in_tex);
 
-            dev->SetSamplerState(stage, D3DSAMP_ADDRESSU, addr);
-            dev->SetSamplerState(stage, D3DSAMP_ADDRESSV, addr);
-            dev->SetSamplerState(stage, D3DSAMP_MAGFILTER, ff);
-            dev->SetSamplerState(stage, D3DSAMP_MINFILTER, ff);
-            dev->SetSamplerState(stage, D3DSAMP_MIPFILTER, D3DTEXF_NONE);
-            // >>> kill gamma state leakage
-            dev->SetSamplerState(stage, D3DSAMP_SRGBTEXTURE, FALSE);
-            if (addr == D3DTADDRESS_BORDER)
-                dev->SetSamplerState(stage, D3DSAMP_BORDERCOLOR, 0x00000000);
+            if (kind == ZM_SAMP_LUT && index < rt->num_luts)
+                zm_set_pass_sampler(sd, stage, tex, rt->lut_addr[index], rt->lut_filter[index], rt->lut_mip[index]);
+            else
+                zm_set_pass_sampler(sd, stage, tex, addr, ff);
 
             zm_draw_dbgf("[SAMPLER-BIND] pass='%s' name='%s' stage=%d tex=%p\n",
                 (cfg.alias[0] ? cfg.alias : "(none)"), cd.Name, stage, (void*)tex);
@@ -523,19 +751,19 @@ namespace ZeroMod {
 
         for (auto& it : vec4s)
         {
-            if (D3DXHANDLE h = zm_find_ct_handle(ct, it.name))
+            if (D3DXHANDLE h = slang_find_ct_handle(ct, it.name))
                 ct->SetFloatArray(dev, h, (const float*)it.v, 4);
         }
 
         // FrameCount (uint) - use 0 
-        if (D3DXHANDLE h = zm_find_ct_handle(ct, "FrameCount"))
+        if (D3DXHANDLE h = slang_find_ct_handle(ct, "FrameCount"))
             ct->SetInt(dev, h, 0);
 
         // shader params - hard-force defaults to prove parameter path
-        if (D3DXHANDLE h = zm_find_ct_handle(ct, "brighten_scanlines"))
+        if (D3DXHANDLE h = slang_find_ct_handle(ct, "brighten_scanlines"))
             ct->SetFloat(dev, h, 16.0f);
 
-        if (D3DXHANDLE h = zm_find_ct_handle(ct, "brighten_lcd"))
+        if (D3DXHANDLE h = slang_find_ct_handle(ct, "brighten_lcd"))
             ct->SetFloat(dev, h, 4.0f);
     }
 
@@ -556,7 +784,7 @@ namespace ZeroMod {
             if (_stricmp(u.id, "MVP") == 0)
                 continue;
 
-            D3DXHANDLE h = zm_find_ct_handle(ct, u.id);
+            D3DXHANDLE h = slang_find_ct_handle(ct, u.id);
             if (!h)
                 continue;
 
@@ -585,7 +813,7 @@ namespace ZeroMod {
             // ---- DEBUG: show which IDs slang is giving (PS) ----
             zm_draw_dbgf("[SEM-PS] id='%s' size=%u\n", u.id, (unsigned)u.size);
 
-            D3DXHANDLE h = zm_find_ct_handle(ct, u.id);
+            D3DXHANDLE h = slang_find_ct_handle(ct, u.id);
 
             // Keep failure signal.
             if (!h)
@@ -634,6 +862,139 @@ namespace ZeroMod {
         ct->SetFloatArray(dev, hhp, hp, 4);
     }
 
+    // ---------------------------------------------------------------------
+    // Shadowed constant upload
+    // ---------------------------------------------------------------------
+
+    static const D3DXMATRIX zm_identity_mvp(
+        1, 0, 0, 0,
+        0, 1, 0, 0,
+        0, 0, 1, 0,
+        0, 0, 0, 1);
+
+    static const void* zm_const_source(
+        d3d9_video_struct* d3d9,
+        d3d9_slang_runtime* rt,
+        const d3d9_slang_pass& P,
+        uint32_t slot)
+    {
+        switch (slot >> 16)
+        {
+        case ZM_SLOT_HALFPIXEL: return P.halfpixel;
+        case ZM_SLOT_IDENTITY:  return &zm_identity_mvp;
+        default:
+        {
+            void* data = nullptr;
+            slang_slot_decode(slot, &rt->map, &d3d9->shader, data);
+            return data;
+        }
+        }
+    }
+
+    static void zm_upload_consts(
+        zm_state_delta& sd,
+        d3d9_video_struct* d3d9,
+        d3d9_slang_runtime* rt,
+        const d3d9_slang_pass& P,
+        bool ps)
+    {
+        const slang_pass_bindings& b = *P.bind;
+        const slang_const_op* ops = ps ? b.ps : b.vs;
+        const unsigned num = ps ? b.num_ps : b.num_vs;
+        const unsigned lo = ps ? b.ps_lo : b.vs_lo;
+        const unsigned hi = ps ? b.ps_hi : b.vs_hi;
+        if (!num)
+            return;
+
+        zm_const_shadow& shadow = ps ? rt->ps_shadow : rt->vs_shadow;
+        float (*img)[4] = rt->const_scratch;
+
+        // Start from the device image so gaps inside the span upload unchanged.
+        csh_begin(shadow, img, lo, hi);
+        for (unsigned i = 0; i < num; ++i)
+        {
+            if (const void* src = zm_const_source(d3d9, rt, P, ops[i].source))
+                csh_pack(img, ops[i], src);
+        }
+
+        unsigned first = 0, count = 0;
+        if (!csh_dirty_span(shadow, img, ops, num, first, count)) {
+            rt->const_skipped_total++;
+            return;
+        }
+
+        if (ps) sd_ps_consts(sd, first, img[first], count);
+        else    sd_vs_consts(sd, first, img[first], count);
+        csh_commit(shadow, img, first, count);
+
+        rt->const_calls_frame++;
+        rt->const_bytes_frame += count * (unsigned)sizeof(img[0]);
+    }
+
+    // Samplers straight from the binding table: no constant-table walk per draw.
+    static void zm_bind_ps_samplers(
+        zm_state_delta& sd,
+        d3d9_slang_runtime* rt,
+        const d3d9_slang_pass& P,
+        const video_shader_pass& cfg,
+        IDirect3DTexture9* in_tex)
+    {
+        const D3DTEXTUREADDRESS addr = zm_addr_from_wrap(cfg.wrap);
+        const D3DTEXTUREFILTERTYPE ff = zm_filt_from_filter(cfg.filter);
+
+        const slang_pass_bindings& b = *P.bind;
+        for (unsigned i = 0; i < b.num_samplers; ++i)
+        {
+            const slang_sampler_bind& s = b.samplers[i];
+
+            IDirect3DTexture9* tex = zm_sampler_tex(rt, s.kind, s.pass, s.index, in_tex);
+
+            if (s.kind == ZM_SAMP_LUT && s.index < rt->num_luts)
+                zm_set_pass_sampler(sd, s.stage, tex, rt->lut_addr[s.index], rt->lut_filter[s.index], rt->lut_mip[s.index]);
+            else
+                zm_set_pass_sampler(sd, s.stage, tex, addr, ff);
+
+            zm_draw_dbgf("[SAMPLER-BIND] pass='%s' name='%s' stage=%d tex=%p\n",
+                (cfg.alias[0] ? cfg.alias : "(none)"), s.name, (int)s.stage, (void*)tex);
+        }
+    }
+
+    static void zm_const_invalidate(d3d9_slang_runtime* rt)
+    {
+        csh_invalidate(rt->vs_shadow);
+        csh_invalidate(rt->ps_shadow);
+    }
+
+    // Chain entry: the device registers are whatever the game left there.
+    static void zm_const_frame_begin(d3d9_slang_runtime* rt)
+    {
+        zm_const_invalidate(rt);
+        rt->const_calls_frame = 0;
+        rt->const_bytes_frame = 0;
+    }
+
+    static void zm_const_frame_end(d3d9_slang_runtime* rt)
+    {
+        rt->const_calls_total += rt->const_calls_frame;
+        rt->const_bytes_total += rt->const_bytes_frame;
+
+#if ZM_SLANG_CONST_STATS_INTERVAL
+        if (++rt->const_frames >= ZM_SLANG_CONST_STATS_INTERVAL)
+        {
+            const double f = (double)rt->const_frames;
+            zm_dbgf("[ZeroMod] slang consts: %.1f calls/frame, %.0f bytes/frame, %.1f skipped/frame (%u frames)\n",
+                (double)rt->const_calls_total / f,
+                (double)rt->const_bytes_total / f,
+                (double)rt->const_skipped_total / f,
+                rt->const_frames);
+            rt->const_calls_total = 0;
+            rt->const_bytes_total = 0;
+            rt->const_skipped_total = 0;
+            rt->const_frames = 0;
+        }
+#endif
+    }
+
     static void zm_free_cstr(char*& p)
     {
         if (p) { free(p); p = NULL; }
@@ -645,10 +1006,36 @@ namespace ZeroMod {
         zm_free_cstr(rt->built_for_path);
         for (unsigned i = 0; i < rt->num_passes; i++)
             slang_pass_clear(rt->passes[i]);
+        slang_history_release(rt);
+        rt->frames = {};
+        for (unsigned i = 0; i < rt->num_luts; i++) {
+            slang_lut_release(rt->live_lut_tex[i]);
+            rt->live_lut_tex[i] = nullptr;
+        }
+        rt->num_luts = 0;
         rt->num_passes = 0;
         rt->built = false;
     }
 
+    // Takes over the references slang_lut_upload handed out for shader's LUTs
+    static void slang_runtime_set_luts(
+        d3d9_slang_runtime* rt,
+        const video_shader* shader,
+        IDirect3DTexture9* const* tex,
+        unsigned count)
+    {
+        for (unsigned i = 0; i < count; ++i)
+        {
+            const video_shader_lut& lut = shader->lut[i];
+            rt->live_lut_tex[i] = tex[i];
+            rt->live_lut_size[i] = size4_from_tex(tex[i]);
+            rt->lut_addr[i] = zm_addr_from_wrap(lut.wrap);
+            rt->lut_filter[i] = zm_filt_from_filter(lut.filter);
+            rt->lut_mip[i] = tex[i]->GetLevelCount() > 1 ? D3DTEXF_LINEAR : D3DTEXF_NONE;
+        }
+        rt->num_luts = count;
+    }
+
     bool slang_d3d9_runtime_create(d3d9_video_struct* d3d9)
     {
         if (!d3d9 || d3d9->magic != 0x39564433)
@@ -677,6 +1064,7 @@ namespace ZeroMod {
             return;
 
         runtime_clear(rt);
+        slang_rt_pool_destroy(rt->rt_pool);
         free(rt);
         d3d9->slang_rt = NULL;
 
@@ -713,119 +1101,604 @@ namespace ZeroMod {
         }
     }
 
-    static bool d3d9_compile_shader(
-        IDirect3DDevice9* dev,
+    // Device-free: HLSL -> bytecode. Safe off the render thread.
+    static bool d3d9_compile_bytecode(
         const char* src,
         const char* entry,
         const char* profile,
+        ID3DXBuffer** out_code)
+    {
+        if (!src || !entry || !profile || !out_code)
+            return false;
+
+        *out_code = nullptr;
+
+        ID3DXBuffer* code = nullptr;
+        ID3DXBuffer* err = nullptr;
+
+        HRESULT hr = D3DXCompileShader(
+            src,
+            (UINT)strlen(src),
+            nullptr, nullptr,
+            entry,
+            profile,
+            ZM_SLANG_COMPILE_FLAGS,
+            &code,
+            &err,
+            nullptr);
+
+        if (FAILED(hr) || !code)
+        {
+            char buf[256];
+            _snprintf(buf, sizeof(buf),
+                "[ZeroMod] D3DXCompileShader FAILED hr=0x%08lX entry='%s' profile='%s'\n",
+                (unsigned long)hr,
+                entry ? entry : "(null)",
+                profile ? profile : "(null)");
+            OutputDebugStringA(buf);
+
+            if (err && err->GetBufferPointer())
+            {
+                OutputDebugStringA("[ZeroMod] ---- Compiler Error ----\n");
+                OutputDebugStringA((char*)err->GetBufferPointer());
+                OutputDebugStringA("\n[ZeroMod] -----------------------\n");
+            }
+            else
+            {
+                OutputDebugStringA("[ZeroMod] No compiler error blob.\n");
+            }
+
+            // Dump the exact HLSL that failed
+            static volatile LONG fail_id = 0;
+            char path[260];
+            _snprintf(path, sizeof(path),
+                "C:\\temp\\zm_compile_fail_%ld_%s_%s.hlsl",
+                (long)InterlockedIncrement(&fail_id) - 1,
+                profile,
+                entry);
+
+            FILE* f = nullptr;
+            fopen_s(&f, path, "wb");
+            if (f)
+            {
+                fwrite(src, 1, strlen(src), f);
+                fclose(f);
+                OutputDebugStringA("[ZeroMod] Wrote failing HLSL to C:\\temp\\\n");
+            }
+
+            if (err) err->Release();
+            if (code) code->Release();
+            return false;
+        }
+
+        if (err) err->Release();
+        *out_code = code;
+        return true;
+    }
+
+    // Render thread: bytecode -> device shader + constant table.
+    static bool d3d9_create_shader_from_code(
+        IDirect3DDevice9* dev,
+        const void* code,
+        bool is_vs,
         IDirect3DVertexShader9** out_vs,
         IDirect3DPixelShader9** out_ps,
         ID3DXConstantTable** out_ct)
     {
-        if (!dev || !src || !entry || !profile)
+        if (!dev || !code)
+            return false;
+
+        if (out_vs) *out_vs = nullptr;
+        if (out_ps) *out_ps = nullptr;
+        if (out_ct) *out_ct = nullptr;
+
+        HRESULT hr = is_vs
+            ? (out_vs ? dev->CreateVertexShader((const DWORD*)code, out_vs) : E_INVALIDARG)
+            : (out_ps ? dev->CreatePixelShader((const DWORD*)code, out_ps) : E_INVALIDARG);
+        if (FAILED(hr))
+            return false;
+
+        // CT is embedded in the bytecode (CTAB comment block)
+        if (out_ct && FAILED(D3DXGetShaderConstantTable((const DWORD*)code, out_ct)))
+        {
+            if (out_vs && *out_vs) { (*out_vs)->Release(); *out_vs = nullptr; }
+            if (out_ps && *out_ps) { (*out_ps)->Release(); *out_ps = nullptr; }
+            return false;
+        }
+        return true;
+    }
+
+    static void* zm_dup_code(ID3DXBuffer* b, uint32_t& size)
+    {
+        size = (uint32_t)b->GetBufferSize();
+        void* m = malloc(size);
+        if (m) memcpy(m, b->GetBufferPointer(), size);
+        return m;
+    }
+
+    // Flatten the pass' uniforms/samplers to registers (device-free). No table
+    // just means the draw path falls back to constant-table lookups.
+    static void zm_prepare_bindings(
+        const video_shader* shader,
+        unsigned i,
+        const semantics_map_t* map,
+        slang_cache_entry& out)
+    {
+        slang_pass_bindings* b = (slang_pass_bindings*)calloc(1, sizeof(slang_pass_bindings));
+        if (!b)
+            return;
+
+        if (!slang_bindings_build(out.vs_code, out.ps_code, out.sem, map, shader, i, *b)) {
+            zm_dbgf("[ZeroMod] pass%u: binding table build FAILED\n", i);
+            free(b);
+            return;
+        }
+        out.bind = b;
+    }
+
+    // What slang_process would have registered for pass i: its #pragma name
+    // as the alias if the preset gave none, and each #pragma parameter the
+    // shared list doesn't have yet. Caller holds slang_process_cs.
+    static void zm_register_pass_meta(video_shader* shader, unsigned i, const zm_spm& meta)
+    {
+        video_shader_pass& sp = shader->pass[i];
+        if (!sp.alias[0] && !meta.name.empty())
+            strncpy(sp.alias, meta.name.c_str(), sizeof(sp.alias) - 1);
+
+        for (const zm_spm_param& p : meta.params)
+        {
+            bool have = false;
+            for (unsigned k = 0; k < shader->num_parameters && !have; ++k)
+                have = p.id == shader->parameters[k].id;
+            if (have)
+                continue;
+            if (shader->num_parameters >= GFX_MAX_PARAMETERS) {
+                zm_dbgf("[ZeroMod] pass%u: too many parameters, '%s' dropped\n", i, p.id.c_str());
+                continue;
+            }
+
+            video_shader_parameter& d = shader->parameters[shader->num_parameters++];
+            memset(&d, 0, sizeof(d));
+            strncpy(d.id, p.id.c_str(), sizeof(d.id) - 1);
+            strncpy(d.desc, p.desc.c_str(), sizeof(d.desc) - 1);
+            d.initial = p.initial;
+            d.current = p.initial;
+            d.minimum = p.minimum;
+            d.maximum = p.maximum;
+            d.step = p.step;
+            d.pass = (int)i;
+        }
+    }
+
+    bool slang_d3d9_prepare_pass(
+        video_shader* shader,
+        unsigned i,
+        const semantics_map_t* map,
+        const std::string* source,
+        slang_cache_entry& out)
+    {
+        if (!shader || !map || i >= shader->passes)
+            return false;
+
+        slang_cache_entry_free(out);
+        video_shader_pass& sp = shader->pass[i];
+
+#if ZM_SLANG_DISK_CACHE
+        uint64_t cache_key[2] = {};
+        zm_spm meta;
+        slang_process_cs.begin_cs();
+        const bool have_key = source && slang_cache_pass_key(shader, i, *source,
+            "vs_3_0", "ps_3_0", ZM_SLANG_COMPILE_FLAGS, cache_key, &meta);
+        // slang_process won't run on a hit, so its parameters go in here;
+        // the load then finds parameter uniforms by id
+        if (have_key)
+            zm_register_pass_meta(shader, i, meta);
+        const bool hit = have_key && slang_cache_load(cache_key, map, shader, out);
+        slang_process_cs.end_cs();
+
+        // Warm path: HLSL, bytecode and reflection come from disk; no glslang / SPIRV-Cross / D3DX.
+        if (hit)
+        {
+            zm_dbgf("[ZeroMod] pass%u: cache HIT %016llx%016llx\n", i,
+                (unsigned long long)cache_key[0], (unsigned long long)cache_key[1]);
+
+            // keep shader.pass[i] looking exactly like slang_process left it
+            if (sp.source.string.vertex) free(sp.source.string.vertex);
+            if (sp.source.string.fragment) free(sp.source.string.fragment);
+            sp.source.string.vertex = _strdup(out.hlsl_vs);
+            sp.source.string.fragment = _strdup(out.hlsl_ps);
+
+            if (!sp.alias[0] && out.alias[0])
+                strncpy(sp.alias, out.alias, sizeof(sp.alias) - 1);
+
+            if (!out.bind)
+                zm_prepare_bindings(shader, i, map, out);
+            return true;
+        }
+#endif
+
+        // slang_process appends to the shared parameter list (prepare_passes
+        // has registered them already), so it runs under the lock; the D3DX
+        // compile below is what actually goes wide.
+        pass_semantics_t sem = {};
+        slang_process_cs.begin_cs();
+        bool ok = slang_process(shader, i, RARCH_SHADER_HLSL, 30, map, &sem);
+        slang_process_cs.end_cs();
+        if (!ok) {
+            zm_dbgf("[ZeroMod] pass%u: slang_process FAILED (vs_ptr=%p ps_ptr=%p)\n", i,
+                (void*)sp.source.string.vertex, (void*)sp.source.string.fragment);
+            return false;
+        }
+
+        // samplers are bound by CT name, texture reflection isn't used
+        if (sem.textures) { free(sem.textures); sem.textures = nullptr; }
+        out.sem = sem;
+        zm_dbgf("[ZeroMod] pass%u: slang_process OK\n", i);
+
+        // generated HLSL now lives in shader.pass[i].source.string.*
+        const char* vs_src = sp.source.string.vertex;
+        const char* ps_src = sp.source.string.fragment;
+
+        if (!vs_src || !*vs_src) {
+            zm_dbgf("[ZeroMod] pass%u: VS source is null/empty\n", i);
+            slang_cache_entry_free(out);
+            return false;
+        }
+        if (!ps_src || !*ps_src) {
+            zm_dbgf("[ZeroMod] pass%u: PS source is null/empty\n", i);
+            slang_cache_entry_free(out);
+            return false;
+        }
+
+        zm_dbgf("[ZeroMod] pass%u: VS len=%u | PS len=%u\n",
+            i, (unsigned)strlen(vs_src), (unsigned)strlen(ps_src));
+
+#if defined(ZM_DUMP_PASS0_HLSL)
+        if (i == 0) {
+            static bool dumped0 = false;
+            if (!dumped0) {
+                dumped0 = true;
+                FILE* f = nullptr;
+                fopen_s(&f, "C:\\temp\\pass0_vs_src.hlsl", "wb");
+                if (f) { fwrite(vs_src, 1, strlen(vs_src), f); fclose(f); }
+                fopen_s(&f, "C:\\temp\\pass0_ps_src.hlsl", "wb");
+                if (f) { fwrite(ps_src, 1, strlen(ps_src), f); fclose(f); }
+                OutputDebugStringA("[ZeroMod] dumped pass0 VS/PS to C:\\temp\\\n");
+            }
+        }
+#endif
+
+        ID3DXBuffer* vs_code = nullptr;
+        ID3DXBuffer* ps_code = nullptr;
+
+        if (!d3d9_compile_bytecode(vs_src, "main", "vs_3_0", &vs_code))
+        {
+            zm_dbgf("[ZeroMod] pass%u: VS compile FAILED\n", i);
+            slang_cache_entry_free(out);
+            return false;
+        }
+        if (!d3d9_compile_bytecode(ps_src, "main", "ps_3_0", &ps_code))
+        {
+            zm_dbgf("[ZeroMod] pass%u: PS compile FAILED\n", i);
+            vs_code->Release();
+            slang_cache_entry_free(out);
             return false;
+        }
+
+        out.vs_code = zm_dup_code(vs_code, out.vs_size);
+        out.ps_code = zm_dup_code(ps_code, out.ps_size);
+        vs_code->Release();
+        ps_code->Release();
+
+        out.hlsl_vs = _strdup(vs_src);
+        out.hlsl_ps = _strdup(ps_src);
+        strncpy(out.alias, sp.alias, sizeof(out.alias) - 1);
+
+        if (!out.vs_code || !out.ps_code || !out.hlsl_vs || !out.hlsl_ps) {
+            slang_cache_entry_free(out);
+            return false;
+        }
+
+        zm_prepare_bindings(shader, i, map, out);
+
+#if ZM_SLANG_DISK_CACHE
+        if (have_key)
+        {
+            slang_process_cs.begin_cs();
+            slang_cache_store(cache_key, map, shader, out.alias,
+                out.hlsl_vs, out.hlsl_ps,
+                out.vs_code, out.vs_size,
+                out.ps_code, out.ps_size,
+                out.sem, out.bind);
+            slang_process_cs.end_cs();
+        }
+#endif
+        return true;
+    }
+
+    // What the scheduler (slang_prepare_batch.h) hands back per pass
+    struct slang_prepare_ctx
+    {
+        video_shader* shader;
+        const semantics_map_t* map;
+        const slang_pass_sources* sources;
+        slang_cache_entry* out;
+    };
+
+    static void slang_prepare_lock(void*) { slang_process_cs.begin_cs(); }
+    static void slang_prepare_unlock(void*) { slang_process_cs.end_cs(); }
+
+    static void slang_prepare_register(void* ctx, unsigned i)
+    {
+        slang_prepare_ctx* c = (slang_prepare_ctx*)ctx;
+        zm_spm meta;
+        if (c->sources->ok[i] && spm_parse(c->sources->text[i].data(), c->sources->text[i].size(), meta))
+            zm_register_pass_meta(c->shader, i, meta);
+    }
+
+    static bool slang_prepare_one(void* ctx, unsigned i)
+    {
+        slang_prepare_ctx* c = (slang_prepare_ctx*)ctx;
+        const std::string* source = c->sources && c->sources->ok[i] ? &c->sources->text[i] : nullptr;
+        return slang_d3d9_prepare_pass(c->shader, i, c->map, source, c->out[i]);
+    }
+
+    static DWORD WINAPI slang_prepare_worker(LPVOID param)
+    {
+        spb_worker(*(zm_spb*)param);
+        return 0;
+    }
+
+    bool slang_d3d9_prepare_passes(
+        video_shader* shader,
+        unsigned passes,
+        const semantics_map_t* map,
+        const slang_pass_sources* sources,
+        slang_cache_entry* out,
+        const std::atomic<int>* cancel)
+    {
+        if (!shader || !map || !out || passes == 0 || passes > GFX_MAX_SHADERS)
+            return false;
+
+        slang_prepare_ctx c = { shader, map, sources, out };
+        zm_spb b;
+        b.passes = passes;
+        b.cancel = cancel;
+        b.ctx = &c;
+        b.register_pass = sources ? slang_prepare_register : nullptr;
+        b.prepare = slang_prepare_one;
+        b.lock = slang_prepare_lock;
+        b.unlock = slang_prepare_unlock;
+
+        // Register every pass' alias and parameters in pass order first, as a
+        // serial build would. slang_process then only meets ids it already
+        // has, so the shared list comes out the same however the workers
+        // interleave.
+        spb_register(b);
+
+        SYSTEM_INFO si = {};
+        GetSystemInfo(&si);
+        const unsigned workers = spb_workers((unsigned)si.dwNumberOfProcessors, passes);
+
+        LARGE_INTEGER t0, t1, f;
+        QueryPerformanceCounter(&t0);
+
+        // The calling thread is worker 0; the rest are spun up per batch.
+        HANDLE threads[ZM_SLANG_COMPILE_THREADS] = {};
+        DWORD spawned = 0;
+        for (unsigned w = 1; w < workers; ++w)
+        {
+            HANDLE h = CreateThread(NULL, 0, slang_prepare_worker, &b, 0, NULL);
+            if (h) threads[spawned++] = h;
+        }
+
+        spb_worker(b);
+
+        if (spawned) {
+            WaitForMultipleObjects(spawned, threads, TRUE, INFINITE);
+            for (DWORD w = 0; w < spawned; ++w)
+                CloseHandle(threads[w]);
+        }
+
+        QueryPerformanceCounter(&t1);
+        QueryPerformanceFrequency(&f);
+        const bool failed = b.failed.load() != 0;
+        zm_dbgf("[ZeroMod] slang_prepare_passes: %u passes on %lu threads in %.2f ms%s\n",
+            passes, (unsigned long)(spawned + 1),
+            (double)(t1.QuadPart - t0.QuadPart) * 1000.0 / (double)f.QuadPart,
+            failed ? " (FAILED)" : "");
+
+        if (failed) {
+            for (unsigned i = 0; i < passes; ++i)
+                slang_cache_entry_free(out[i]);
+            return false;
+        }
+        return true;
+    }
+
+    // Render thread half: create device objects from a prepared pass.
+    // Takes ownership of prep's HLSL and uniform tables.
+    static bool slang_commit_pass(
+        IDirect3DDevice9* dev,
+        const video_shader* shader,
+        unsigned num_passes,
+        unsigned i,
+        slang_cache_entry& prep,
+        d3d9_slang_pass& P)
+    {
+        slang_pass_clear(P);
+
+        if (!d3d9_create_shader_from_code(dev, prep.vs_code, true, &P.vs, nullptr, &P.vs_ct))
+        {
+            zm_dbgf("[ZeroMod] pass%u: CreateVertexShader FAILED\n", i);
+            return false;
+        }
+        if (!d3d9_create_shader_from_code(dev, prep.ps_code, false, nullptr, &P.ps, &P.ps_ct))
+        {
+            zm_dbgf("[ZeroMod] pass%u: CreatePixelShader FAILED\n", i);
+            slang_pass_clear(P);
+            return false;
+        }
 
-        if (out_vs) *out_vs = nullptr;
-        if (out_ps) *out_ps = nullptr;
-        if (out_ct) *out_ct = nullptr;
+        zm_dbgf("[ZeroMod] pass%u: compile OK (vs=%p ps=%p)\n", i, P.vs, P.ps);
 
-        ID3DXBuffer* code = nullptr;
-        ID3DXBuffer* err = nullptr;
-        ID3DXConstantTable* ct = nullptr;
+        P.sem = prep.sem;
+        P.sem_valid = true;
+        prep.sem = {};
 
-        HRESULT hr = D3DXCompileShader(
-            src,
-            (UINT)strlen(src),
-            nullptr, nullptr,
-            entry,
-            profile,
-            D3DXSHADER_OPTIMIZATION_LEVEL3,
-            &code,
-            &err,
-            out_ct ? &ct : nullptr);
+        // Binding table was built off-thread from the same bytecode
+        P.bind = prep.bind;
+        prep.bind = nullptr;
+        if (P.bind)
+            slang_bindings_resolve_aliases(*P.bind, shader, num_passes);
 
-        if (FAILED(hr) || !code)
-        {
-            char buf[256];
-            _snprintf(buf, sizeof(buf),
-                "[ZeroMod] D3DXCompileShader FAILED hr=0x%08lX entry='%s' profile='%s'\n",
-                (unsigned long)hr,
-                entry ? entry : "(null)",
-                profile ? profile : "(null)");
-            OutputDebugStringA(buf);
+#if ZM_SLANG_CONST_SHADOW
+        P.consts_planned = P.bind && P.bind->consts_packed;
+#endif
 
-            if (err && err->GetBufferPointer())
-            {
-                OutputDebugStringA("[ZeroMod] ---- Compiler Error ----\n");
-                OutputDebugStringA((char*)err->GetBufferPointer());
-                OutputDebugStringA("\n[ZeroMod] -----------------------\n");
-            }
-            else
-            {
-                OutputDebugStringA("[ZeroMod] No compiler error blob.\n");
-            }
+        // --- TL init: resolve PS sampler register for "Source" ---
+        P.source_sampler_reg = -1;
+        P.tl_inited = true;
 
-            // Dump the exact HLSL that failed
-            static int fail_id = 0;
-            char path[260];
-            _snprintf(path, sizeof(path),
-                "C:\\temp\\zm_compile_fail_%d_%s_%s.hlsl",
-                fail_id++,
-                profile,
-                entry);
+        if (P.bind)
+        {
+            P.source_sampler_reg = P.bind->source_stage;
+        }
+        else if (P.ps_ct)
+        {
+            int reg = -1;
 
-            FILE* f = nullptr;
-            fopen_s(&f, path, "wb");
-            if (f)
+            D3DXHANDLE hs = P.ps_ct->GetConstantByName(nullptr, "Source");
+            if (hs)
             {
-                fwrite(src, 1, strlen(src), f);
-                fclose(f);
-                OutputDebugStringA("[ZeroMod] Wrote failing HLSL to C:\\temp\\\n");
+                D3DXCONSTANT_DESC cd{};
+                UINT n = 1;
+                if (SUCCEEDED(P.ps_ct->GetConstantDesc(hs, &cd, &n)))
+                    reg = (int)cd.RegisterIndex;
             }
 
-            if (err) err->Release();
-            if (code) code->Release();
-            if (ct) ct->Release();
-            return false;
+            if (reg < 0)
+                reg = zm_find_first_sampler2d_register(P.ps_ct);
+
+            P.source_sampler_reg = reg;
         }
 
-        const bool isVS = (strncmp(profile, "vs_", 3) == 0);
-        const bool isPS = (strncmp(profile, "ps_", 3) == 0);
+        if (P.source_sampler_reg < 0)
+            zm_dbgf("[ZeroMod] pass%u: WARNING: no sampler2D found in PS CT; falling back to s0\n", i);
 
-        if (out_vs && isVS)
+        // per-pass checks
+        if (P.vs_ct)
         {
-            hr = dev->CreateVertexShader((DWORD*)code->GetBufferPointer(), out_vs);
-            if (FAILED(hr) || !*out_vs)
-            {
-                code->Release();
-                if (err) err->Release();
-                if (ct) ct->Release();
-                return false;
-            }
+            if (!P.vs_ct->GetConstantByName(nullptr, "gl_HalfPixel"))
+                zm_dbgf("[ZeroMod] pass%u: NOTE: VS missing gl_HalfPixel\n", i);
+            if (!P.vs_ct->GetConstantByName(nullptr, "global_MVP"))
+                zm_dbgf("[ZeroMod] pass%u: NOTE: VS missing global_MVP\n", i);
         }
 
-        if (out_ps && isPS)
+        // Keep copies for inspection/debug
+        P.hlsl_vs = prep.hlsl_vs;
+        P.hlsl_ps = prep.hlsl_ps;
+        prep.hlsl_vs = nullptr;
+        prep.hlsl_ps = nullptr;
+
+        P.compiled = true;
+        return true;
+    }
+
+    // Build-time semantics values are placeholders.
+    // slang_process wants pointers; real values will be pushed per-pass at runtime via CT.
+    static void slang_runtime_semantics_map(
+        d3d9_video_struct* d3d9,
+        d3d9_slang_runtime* rt)
+    {
         {
-            hr = dev->CreatePixelShader((DWORD*)code->GetBufferPointer(), out_ps);
-            if (FAILED(hr) || !*out_ps)
-            {
-                code->Release();
-                if (err) err->Release();
-                if (ct) ct->Release();
-                return false;
-            }
+            // actual content backing texture is always 256x192.
+            // “240x160” is an implicit crop handled by overscan/VPOS, NOT by changing sizes.
+            const float OW = 256.0f;
+            const float OH = 192.0f;
+
+            rt->live_original_tex = nullptr;                    // only need the pointer to exist
+            rt->live_original_size = { OW, OH, 1.0f / OW, 1.0f / OH };
+
+            // For build-time, keep SourceSize sane/nonzero.
+            rt->live_source_size = rt->live_original_size;
+
+            // Output/FinalViewport placeholders: nonzero and stable.
+            // 256x192 is fine; 256x256 arbitrary.
+            rt->live_output_size = rt->live_original_size;
+            rt->live_final_viewport = rt->live_original_size;
+
+            rt->live_frame_count = 0;
+            rt->live_frame_dir = 1;
         }
 
-        code->Release();
-        if (err) err->Release();
+        semantics_map_t& semantics_map = rt->map;
+        semantics_map = {};
+        semantics_map.textures[SLANG_TEXTURE_SEMANTIC_ORIGINAL].image = &rt->live_original_tex;
+        semantics_map.textures[SLANG_TEXTURE_SEMANTIC_ORIGINAL].size = &rt->live_original_size;
+        semantics_map.textures[SLANG_TEXTURE_SEMANTIC_SOURCE].image = &rt->live_original_tex;
+        semantics_map.textures[SLANG_TEXTURE_SEMANTIC_SOURCE].size = &rt->live_source_size;
+
+        for (unsigned k = 0; k <= GFX_MAX_FRAME_HISTORY; ++k)
+            rt->live_history_size[k] = rt->live_original_size;
+        for (unsigned k = 0; k < GFX_MAX_SHADERS; ++k)
+            rt->live_pass_size[k] = rt->live_feedback_size[k] = rt->live_original_size;
+
+        texture_map_t& hist = semantics_map.textures[SLANG_TEXTURE_SEMANTIC_ORIGINAL_HISTORY];
+        hist.image = rt->live_history_tex;
+        hist.image_stride = sizeof(rt->live_history_tex[0]);
+        hist.size = rt->live_history_size;
+        hist.size_stride = sizeof(rt->live_history_size[0]);
+
+        texture_map_t& outp = semantics_map.textures[SLANG_TEXTURE_SEMANTIC_PASS_OUTPUT];
+        outp.image = rt->live_pass_tex;
+        outp.image_stride = sizeof(rt->live_pass_tex[0]);
+        outp.size = rt->live_pass_size;
+        outp.size_stride = sizeof(rt->live_pass_size[0]);
+
+        texture_map_t& fb = semantics_map.textures[SLANG_TEXTURE_SEMANTIC_PASS_FEEDBACK];
+        fb.image = rt->live_feedback_tex;
+        fb.image_stride = sizeof(rt->live_feedback_tex[0]);
+        fb.size = rt->live_feedback_size;
+        fb.size_stride = sizeof(rt->live_feedback_size[0]);
+
+        // Filled by slang_runtime_set_luts; only the addresses matter here
+        texture_map_t& user = semantics_map.textures[SLANG_TEXTURE_SEMANTIC_USER];
+        user.image = rt->live_lut_tex;
+        user.image_stride = sizeof(rt->live_lut_tex[0]);
+        user.size = rt->live_lut_size;
+        user.size_stride = sizeof(rt->live_lut_size[0]);
+
+        semantics_map.uniforms[SLANG_SEMANTIC_MVP] = &d3d9->mvp;
+        semantics_map.uniforms[SLANG_SEMANTIC_OUTPUT] = &rt->live_output_size;
+        semantics_map.uniforms[SLANG_SEMANTIC_FINAL_VIEWPORT] = &rt->live_final_viewport;
+        semantics_map.uniforms[SLANG_SEMANTIC_FRAME_COUNT] = &rt->live_frame_count;
+        semantics_map.uniforms[SLANG_SEMANTIC_FRAME_DIRECTION] = &rt->live_frame_dir;
+    }
+
+    static void slang_log_parsed_passes(const video_shader* shader, unsigned passes)
+    {
+        for (unsigned i = 0; i < passes; i++)
+        {
+            const video_shader_pass& p = shader->pass[i];
 
-        // hand off CT to caller if requested, otherwise release it
-        if (out_ct)
-            *out_ct = ct;
-        else if (ct)
-            ct->Release();
+            zm_dbgf("[ZeroMod] pass[%u] alias='%s' srcpath='%s'\n",
+                i, p.alias, p.source.path);
 
-        return true;
+            zm_dbgf("[ZeroMod] pass[%u] fbo=(%s,%s sx=%.3f sy=%.3f abs=%ux%u fp=%d srgb=%d) wrap=%s filter=%s mip=%d feedback=%d mod=%u\n",
+                i,
+                scale_to_str(p.fbo.type_x),
+                scale_to_str(p.fbo.type_y),
+                p.fbo.scale_x, p.fbo.scale_y,
+                p.fbo.abs_x, p.fbo.abs_y,
+                (int)p.fbo.fp_fbo,
+                (int)p.fbo.srgb_fbo,
+                wrap_to_str(p.wrap),
+                filter_to_str(p.filter),
+                (int)p.mipmap,
+                (int)p.feedback,
+                (unsigned)p.frame_count_mod);
+        }
     }
 
     bool slang_d3d9_runtime_build_from_parsed(d3d9_video_struct* d3d9)
@@ -852,8 +1725,20 @@ namespace ZeroMod {
             // else fall through to rebuild (previous build incomplete)
         }
 
+        // LUTs go up before the old chain lets go of its references, so
+        // one both presets use stays in the cache
+        slang_lut_set luts;
+        IDirect3DTexture9* lut_tex[GFX_MAX_TEXTURES] = {};
+        if (!slang_lut_decode(&d3d9->shader, luts, nullptr) ||
+            !slang_lut_upload(d3d9->dev, &d3d9->shader, luts, lut_tex))
+        {
+            zm_dbgf("[ZeroMod] slang_runtime_build_from_parsed: LUT load FAILED\n");
+            return false;
+        }
+
         // Clear previous build state
         runtime_clear(rt);
+        slang_runtime_set_luts(rt, &d3d9->shader, lut_tex, luts.count);
 
         // Capture current preset identity
         if (d3d9->shader_path)
@@ -874,191 +1759,137 @@ namespace ZeroMod {
         rt->num_passes = passes;
 
         // Log each pass
-        for (unsigned i = 0; i < passes; i++)
-        {
-            const video_shader_pass& p = d3d9->shader.pass[i];
-
-            zm_dbgf("[ZeroMod] pass[%u] alias='%s' srcpath='%s'\n",
-                i, p.alias, p.source.path);
-
-            zm_dbgf("[ZeroMod] pass[%u] fbo=(%s,%s sx=%.3f sy=%.3f abs=%ux%u fp=%d srgb=%d) wrap=%s filter=%s mip=%d feedback=%d mod=%u\n",
-                i,
-                scale_to_str(p.fbo.type_x),
-                scale_to_str(p.fbo.type_y),
-                p.fbo.scale_x, p.fbo.scale_y,
-                p.fbo.abs_x, p.fbo.abs_y,
-                (int)p.fbo.fp_fbo,
-                (int)p.fbo.srgb_fbo,
-                wrap_to_str(p.wrap),
-                filter_to_str(p.filter),
-                (int)p.mipmap,
-                (int)p.feedback,
-                (unsigned)p.frame_count_mod);
-        }
+        slang_log_parsed_passes(&d3d9->shader, passes);
 
         if (passes == 0) {
             zm_dbgf("[ZeroMod] slang_runtime_build_from_parsed: passes==0\n");
             return false;
         }
 
+        slang_runtime_semantics_map(d3d9, rt);
+
         // ---------------------------------------------------------------------
         // MULTI-PASS COMPILE LOOP
         // ---------------------------------------------------------------------
-        for (unsigned i = 0; i < passes; ++i)
+        // Passes are independent until device-object creation: cross-compile
+        // them all concurrently, then create shaders in order on this thread.
+        slang_pass_sources sources;
+        slang_d3d9_pass_sources(d3d9->shader_path, &d3d9->shader, sources);
+
+        slang_cache_entry prep[GFX_MAX_SHADERS];
+        bool ok = slang_d3d9_prepare_passes(&d3d9->shader, passes, &rt->map, &sources, prep, nullptr);
+
+        for (unsigned i = 0; ok && i < passes; ++i)
         {
             d3d9_slang_pass& P = rt->passes[i];
             slang_pass_clear(P);
+            ok = slang_commit_pass(d3d9->dev, &d3d9->shader, passes, i, prep[i], P);
+        }
 
-            zm_dbgf("[ZeroMod] pass%u: begin compile block\n", i);
-
-            // IMPORTANT:
-            // Build-time semantics values are placeholders.
-            // slang_process wants pointers; real values will be pushed per-pass at runtime via CT.
-            {
-                // actual content backing texture is always 256x192.
-                // “240x160” is an implicit crop handled by overscan/VPOS, NOT by changing sizes.
-                const float OW = 256.0f;
-                const float OH = 192.0f;
-
-                rt->live_original_tex = nullptr;                    // only need the pointer to exist
-                rt->live_original_size = { OW, OH, 1.0f / OW, 1.0f / OH };
-
-                // For build-time, keep SourceSize sane/nonzero.
-                rt->live_source_size = rt->live_original_size;
-
-                // Output/FinalViewport placeholders: nonzero and stable.
-                // 256x192 is fine; 256x256 arbitrary.
-                rt->live_output_size = rt->live_original_size;
-                rt->live_final_viewport = rt->live_original_size;
-
-                rt->live_frame_count = 0;
-                rt->live_frame_dir = 1;
-            }
-
-            semantics_map_t semantics_map = {};
-            semantics_map.textures[SLANG_TEXTURE_SEMANTIC_ORIGINAL].image = &rt->live_original_tex;
-            semantics_map.textures[SLANG_TEXTURE_SEMANTIC_ORIGINAL].size = &rt->live_original_size;
-            semantics_map.textures[SLANG_TEXTURE_SEMANTIC_SOURCE].image = &rt->live_original_tex;
-            semantics_map.textures[SLANG_TEXTURE_SEMANTIC_SOURCE].size = &rt->live_source_size;
-
-            semantics_map.uniforms[SLANG_SEMANTIC_MVP] = &d3d9->mvp;
-            semantics_map.uniforms[SLANG_SEMANTIC_OUTPUT] = &rt->live_output_size;
-            semantics_map.uniforms[SLANG_SEMANTIC_FINAL_VIEWPORT] = &rt->live_final_viewport;
-            semantics_map.uniforms[SLANG_SEMANTIC_FRAME_COUNT] = &rt->live_frame_count;
-            semantics_map.uniforms[SLANG_SEMANTIC_FRAME_DIRECTION] = &rt->live_frame_dir;
-
-            pass_semantics_t sem = {};
-            bool ok = slang_process(&d3d9->shader, i, RARCH_SHADER_HLSL, 30, &semantics_map, &sem);
-            if (!ok) {
-                const char* v = d3d9->shader.pass[i].source.string.vertex;
-                const char* p = d3d9->shader.pass[i].source.string.fragment;
-                zm_dbgf("[ZeroMod] pass%u: slang_process FAILED (vs_ptr=%p ps_ptr=%p)\n", i, (void*)v, (void*)p);
-                P.sem = {};
-                P.sem_valid = false;
-                return false;
-            }
+        for (unsigned i = 0; i < passes; ++i)
+            slang_cache_entry_free(prep[i]);
 
-            P.sem = sem;
-            P.sem_valid = true;
-            zm_dbgf("[ZeroMod] pass%u: slang_process OK\n", i);
+        if (!ok)
+            return false;
 
-            // generated HLSL now lives in shader.pass[i].source.string.*
-            const char* vs_src = d3d9->shader.pass[i].source.string.vertex;
-            const char* ps_src = d3d9->shader.pass[i].source.string.fragment;
+        slang_rt_liveness(rt);
+        slang_history_plan(rt, &d3d9->shader);
 
-            if (!vs_src || !*vs_src) {
-                zm_dbgf("[ZeroMod] pass%u: VS source is null/empty\n", i);
-                return false;
-            }
-            if (!ps_src || !*ps_src) {
-                zm_dbgf("[ZeroMod] pass%u: PS source is null/empty\n", i);
-                return false;
-            }
+        zm_dbgf("[ZeroMod] slang_runtime_build_from_parsed: rt->built will be set TRUE now\n");
+        rt->built = true;
+        zm_dbgf("[ZeroMod] slang_runtime_build_from_parsed: BUILT (passes=%u)\n", rt->num_passes);
 
-            zm_dbgf("[ZeroMod] pass%u: VS len=%u | PS len=%u\n",
-                i, (unsigned)strlen(vs_src), (unsigned)strlen(ps_src));
+        return true;
+    }
 
-#if defined(ZM_DUMP_PASS0_HLSL)
-            if (i == 0) {
-                static bool dumped0 = false;
-                if (!dumped0) {
-                    dumped0 = true;
-                    FILE* f = nullptr;
-                    fopen_s(&f, "C:\\temp\\pass0_vs_src.hlsl", "wb");
-                    if (f) { fwrite(vs_src, 1, strlen(vs_src), f); fclose(f); }
-                    fopen_s(&f, "C:\\temp\\pass0_ps_src.hlsl", "wb");
-                    if (f) { fwrite(ps_src, 1, strlen(ps_src), f); fclose(f); }
-                    OutputDebugStringA("[ZeroMod] dumped pass0 VS/PS to C:\\temp\\\n");
-                }
-            }
-#endif
+    bool slang_d3d9_runtime_adopt_prepared(
+        d3d9_video_struct* d3d9,
+        const char* path,
+        video_shader* parsed,
+        slang_cache_entry* prep,
+        unsigned num_passes,
+        const semantics_map_t* prep_map,
+        slang_lut_set* luts)
+    {
+        if (!d3d9 || d3d9->magic != 0x39564433 || !parsed || !prep || !prep_map || !luts)
+            return false;
 
-            // Compile VS
-            if (!d3d9_compile_shader(d3d9->dev, vs_src, "main", "vs_3_0",
-                &P.vs, nullptr, &P.vs_ct))
-            {
-                zm_dbgf("[ZeroMod] pass%u: VS compile FAILED\n", i);
-                return false;
-            }
+        if (num_passes == 0 || num_passes > GFX_MAX_SHADERS || num_passes != parsed->passes)
+            return false;
 
-            // Compile PS
-            if (!d3d9_compile_shader(d3d9->dev, ps_src, "main", "ps_3_0",
-                nullptr, &P.ps, &P.ps_ct))
-            {
-                zm_dbgf("[ZeroMod] pass%u: PS compile FAILED\n", i);
-                return false;
-            }
+        if (!slang_d3d9_runtime_create(d3d9))
+            return false;
 
-            zm_dbgf("[ZeroMod] pass%u: compile OK (vs=%p ps=%p)\n", i, P.vs, P.ps);
+        d3d9_slang_runtime* rt = (d3d9_slang_runtime*)d3d9->slang_rt;
 
-            // --- TL init: resolve PS sampler register for "Source" ---
-            P.source_sampler_reg = -1;
-            P.tl_inited = true;
+        // While the old chain still holds its LUTs, so shared ones stay
+        // cached; a failure here keeps the current chain.
+        IDirect3DTexture9* lut_tex[GFX_MAX_TEXTURES] = {};
+        const unsigned num_luts = luts->count;
+        if (!slang_lut_upload(d3d9->dev, parsed, *luts, lut_tex)) {
+            zm_dbgf("[ZeroMod] slang_runtime_adopt_prepared: LUT upload FAILED\n");
+            return false;
+        }
 
-            if (P.ps_ct)
-            {
-                int reg = -1;
+        zm_dbgf("[ZeroMod] slang_runtime_adopt_prepared: path='%s' passes=%u params=%u\n",
+            path ? path : "(null)", num_passes, (unsigned)parsed->num_parameters);
+        slang_log_parsed_passes(parsed, num_passes);
 
-                D3DXHANDLE hs = P.ps_ct->GetConstantByName(nullptr, "Source");
-                if (hs)
-                {
-                    D3DXCONSTANT_DESC cd{};
-                    UINT n = 1;
-                    if (SUCCEEDED(P.ps_ct->GetConstantDesc(hs, &cd, &n)))
-                        reg = (int)cd.RegisterIndex;
-                }
+        // Only addresses inside rt go into the map; the placeholder sizes it
+        // writes are overwritten by the next frame the old chain draws.
+        slang_runtime_semantics_map(d3d9, rt);
 
-                if (reg < 0)
-                    reg = zm_find_first_sampler2d_register(P.ps_ct);
+        // Create the new chain's device objects next to the old chain, which
+        // keeps rendering unless every pass made it.
+        d3d9_slang_pass* staged = (d3d9_slang_pass*)calloc(num_passes, sizeof(d3d9_slang_pass));
+        bool ok = staged != nullptr;
+        for (unsigned i = 0; ok && i < num_passes; ++i)
+        {
+            // worker staging -> live runtime map, still against the worker's shader
+            ok = slang_sem_rebind(prep[i].sem, prep_map, parsed, &rt->map, parsed) &&
+                slang_commit_pass(d3d9->dev, parsed, num_passes, i, prep[i], staged[i]);
+        }
 
-                P.source_sampler_reg = reg;
+        if (!ok) {
+            zm_dbgf("[ZeroMod] slang_runtime_adopt_prepared: FAILED, keeping current chain\n");
+            if (staged) {
+                for (unsigned i = 0; i < num_passes; ++i)
+                    slang_pass_clear(staged[i]);
+                free(staged);
             }
+            for (unsigned i = 0; i < num_luts; ++i)
+                slang_lut_release(lut_tex[i]);
+            return false;
+        }
 
-            if (P.source_sampler_reg < 0)
-                zm_dbgf("[ZeroMod] pass%u: WARNING: no sampler2D found in PS CT; falling back to s0\n", i);
+        // Swap point: old chain and old parsed preset go away together.
+        runtime_clear(rt);
+        slang_d3d9_free_parsed_shader(&d3d9->shader);
+        memcpy(&d3d9->shader, parsed, sizeof(d3d9->shader));
+        d3d9->shader_preset = true;
+        slang_runtime_set_luts(rt, &d3d9->shader, lut_tex, num_luts);
+
+        // Parameter uniforms still point into 'parsed'; same layout, so
+        // moving them to d3d9->shader can't fail.
+        for (unsigned i = 0; i < num_passes; ++i)
+        {
+            slang_sem_rebind(staged[i].sem, &rt->map, parsed, &rt->map, &d3d9->shader);
+            rt->passes[i] = staged[i];
+        }
+        free(staged);
 
-            // per-pass checks
-            if (P.vs_ct)
-            {
-                if (!P.vs_ct->GetConstantByName(nullptr, "gl_HalfPixel"))
-                    zm_dbgf("[ZeroMod] pass%u: NOTE: VS missing gl_HalfPixel\n", i);
-                if (!P.vs_ct->GetConstantByName(nullptr, "global_MVP"))
-                    zm_dbgf("[ZeroMod] pass%u: NOTE: VS missing global_MVP\n", i);
-            }
+        // d3d9->shader owns the pass sources now
+        memset(parsed, 0, sizeof(*parsed));
 
-            // Keep copies for inspection/debug
-            if (P.hlsl_vs) { free(P.hlsl_vs); P.hlsl_vs = nullptr; }
-            if (P.hlsl_ps) { free(P.hlsl_ps); P.hlsl_ps = nullptr; }
-            P.hlsl_vs = _strdup(vs_src);
-            P.hlsl_ps = _strdup(ps_src);
+        if (path)
+            rt->built_for_path = _strdup(path);
+        rt->num_passes = num_passes;
 
-            P.compiled = true;
-        }
+        slang_rt_liveness(rt);
+        slang_history_plan(rt, &d3d9->shader);
 
-        zm_dbgf("[ZeroMod] slang_runtime_build_from_parsed: rt->built will be set TRUE now\n");
         rt->built = true;
-        zm_dbgf("[ZeroMod] slang_runtime_build_from_parsed: BUILT (passes=%u)\n", rt->num_passes);
-
+        zm_dbgf("[ZeroMod] slang_runtime_adopt_prepared: BUILT (passes=%u)\n", rt->num_passes);
         return true;
     }
 
@@ -1071,108 +1902,61 @@ namespace ZeroMod {
         if (!d3d9->shader_preset)
             return;
 
+#if ZM_SLANG_ASYNC_COMPILE
+        // Chains are built by the worker and swapped in at Present;
+        // never compile on the draw path.
+        return;
+#else
         // Ensure runtime exists and is built for current preset.
         slang_d3d9_runtime_build_from_parsed(d3d9);
+#endif
     }
-    static void slang_update_quad_pos_xy(IDirect3DVertexBuffer9* vb, float sx, float sy)
-    {
-        if (!vb) return;
-
-        zm_slang_vertex* v = nullptr;
-        if (FAILED(vb->Lock(0, 0, (void**)&v, 0)) || !v) return;
-
-        // TL, BL, TR, BR strip order
-        v[0].x = -sx; v[0].y = +sy;
-        v[1].x = -sx; v[1].y = -sy;
-        v[2].x = +sx; v[2].y = +sy;
-        v[3].x = +sx; v[3].y = -sy;
-
-        vb->Unlock();
-    }
-
-    static void slang_set_quad_uv_rect(IDirect3DVertexBuffer9* vb, float u0, float v0, float u1, float v1)
-    {
-        if (!vb) return;
-
-        zm_slang_vertex* v = nullptr;
-        if (FAILED(vb->Lock(0, 0, (void**)&v, 0)) || !v) return;
-
-        // TL, BL, TR, BR strip order
-        v[0].u = u0; v[0].v = v0; // TL
-        v[1].u = u0; v[1].v = v1; // BL
-        v[2].u = u1; v[2].v = v0; // TR
-        v[3].u = u1; v[3].v = v1; // BR
-
-        vb->Unlock();
-    }
-
-    static void slang_reset_quad_uv(IDirect3DVertexBuffer9* vb)
-    {
-        slang_set_quad_uv_rect(vb, 0.0f, 0.0f, 1.0f, 1.0f);
-    }
-
-    static bool draw_fixedfunc_textured_quad_rhw_xy(
-        IDirect3DDevice9* dev,
+    // Fixed-function textured blit covering the current viewport (vp_w x vp_h),
+    // through the static quad + blit VS.
+    static bool draw_fixedfunc_textured_quad(
+        zm_state_delta& sd,
+        const zm_quad& quad,
         IDirect3DTexture9* tex,
-        int dst_x, int dst_y,          // <-- top-left in RT/backbuffer
-        UINT dst_w, UINT dst_h,        // size of quad
+        UINT vp_w, UINT vp_h,
         float u0, float v0, float u1, float v1,
         bool point_filter)
     {
-        if (!dev || !tex || !dst_w || !dst_h) return false;
-
-        struct FFVtx { float x, y, z, rhw; float u, v; };
-        const DWORD FVF = D3DFVF_XYZRHW | D3DFVF_TEX1;
-
-        // D3D9 pixel center convention
-        const float x0 = (float)dst_x - 0.5f;
-        const float y0 = (float)dst_y - 0.5f;
-        const float x1 = (float)(dst_x + (int)dst_w) - 0.5f;
-        const float y1 = (float)(dst_y + (int)dst_h) - 0.5f;
+        if (!sd.dev || !tex || !vp_w || !vp_h) return false;
 
-        FFVtx v[4] = {
-            { x0, y0, 0.0f, 1.0f,  u0, v0 }, // TL
-            { x0, y1, 0.0f, 1.0f,  u0, v1 }, // BL
-            { x1, y0, 0.0f, 1.0f,  u1, v0 }, // TR
-            { x1, y1, 0.0f, 1.0f,  u1, v1 }, // BR
-        };
-
-        dev->SetVertexShader(nullptr);
-        dev->SetPixelShader(nullptr);
-        dev->SetVertexDeclaration(nullptr);
-        dev->SetFVF(FVF);
+        sd_ps(sd, nullptr);
 
-        dev->SetTexture(0, tex);
+        sd_texture(sd, 0, tex);
 
-        dev->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
-        dev->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
-        dev->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1);
-        dev->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
-        dev->SetTextureStageState(1, D3DTSS_COLOROP, D3DTOP_DISABLE);
-        dev->SetTextureStageState(1, D3DTSS_ALPHAOP, D3DTOP_DISABLE);
+        sd_tss(sd, 0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
+        sd_tss(sd, 0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
+        sd_tss(sd, 0, D3DTSS_ALPHAOP, D3DTOP_SELECTARG1);
+        sd_tss(sd, 0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+        sd_tss(sd, 1, D3DTSS_COLOROP, D3DTOP_DISABLE);
+        sd_tss(sd, 1, D3DTSS_ALPHAOP, D3DTOP_DISABLE);
 
-        dev->SetSamplerState(0, D3DSAMP_ADDRESSU, D3DTADDRESS_CLAMP);
-        dev->SetSamplerState(0, D3DSAMP_ADDRESSV, D3DTADDRESS_CLAMP);
-        dev->SetSamplerState(0, D3DSAMP_MIPFILTER, D3DTEXF_NONE);
+        sd_sampler(sd, 0, D3DSAMP_ADDRESSU, D3DTADDRESS_CLAMP);
+        sd_sampler(sd, 0, D3DSAMP_ADDRESSV, D3DTADDRESS_CLAMP);
+        sd_sampler(sd, 0, D3DSAMP_MIPFILTER, D3DTEXF_NONE);
 
         const D3DTEXTUREFILTERTYPE f = point_filter ? D3DTEXF_POINT : D3DTEXF_LINEAR;
-        dev->SetSamplerState(0, D3DSAMP_MINFILTER, f);
-        dev->SetSamplerState(0, D3DSAMP_MAGFILTER, f);
+        sd_sampler(sd, 0, D3DSAMP_MINFILTER, f);
+        sd_sampler(sd, 0, D3DSAMP_MAGFILTER, f);
 
-        dev->SetSamplerState(0, D3DSAMP_SRGBTEXTURE, FALSE);
+        sd_sampler(sd, 0, D3DSAMP_SRGBTEXTURE, FALSE);
 
-        dev->SetRenderState(D3DRS_ZENABLE, FALSE);
-        dev->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
-        dev->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
-        dev->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
-        dev->SetRenderState(D3DRS_ALPHATESTENABLE, FALSE);
-        dev->SetRenderState(D3DRS_COLORWRITEENABLE, 0xF);
-        dev->SetRenderState(D3DRS_SRGBWRITEENABLE, FALSE);
+        sd_rs(sd, D3DRS_ZENABLE, FALSE);
+        sd_rs(sd, D3DRS_ZWRITEENABLE, FALSE);
+        sd_rs(sd, D3DRS_CULLMODE, D3DCULL_NONE);
+        sd_rs(sd, D3DRS_ALPHABLENDENABLE, FALSE);
+        sd_rs(sd, D3DRS_ALPHATESTENABLE, FALSE);
+        sd_rs(sd, D3DRS_COLORWRITEENABLE, 0xF);
+        sd_rs(sd, D3DRS_SRGBWRITEENABLE, FALSE);
 
-        return SUCCEEDED(dev->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, v, sizeof(FFVtx)));
+        return SUCCEEDED(quad_blit(sd, quad, vp_w, vp_h, u0, v0, u1, v1));
     }
 
     bool slang_d3d9_frame(
+        zm_state_delta& sd,
         d3d9_video_struct* d3d9,
         IDirect3DTexture9* src_tex,
         IDirect3DSurface9* dst_rtv,
@@ -1196,6 +1980,17 @@ namespace ZeroMod {
 
         IDirect3DDevice9* dev = d3d9->dev;
 
+        zm_const_frame_begin(rt);
+
+        // Pool targets are only held for one frame; forget last frame's
+        // borrows (rt_slot is kept as the preferred slot).
+        slang_rt_pool_frame_begin(rt->rt_pool);
+        for (unsigned i = 0; i < rt->num_passes; ++i) {
+            rt->passes[i].rt = nullptr;
+            rt->passes[i].rt_surf = nullptr;
+        }
+        size_t rt_dedicated_bytes = 0;
+
         // Resolve default viewport
         if (!vp_w || !vp_h) {
             D3DSURFACE_DESC d{};
@@ -1218,48 +2013,26 @@ namespace ZeroMod {
             }
         }
 
-        // --- Save state ---
-        IDirect3DSurface9* rt_saved = nullptr;
-        IDirect3DSurface9* ds_saved = nullptr;
-        D3DVIEWPORT9       vp_saved = {};
-        IDirect3DVertexShader9* vs_saved = nullptr;
-        IDirect3DPixelShader9* ps_saved = nullptr;
-        IDirect3DBaseTexture9* tex0_saved = nullptr;
-
-        dev->GetRenderTarget(0, &rt_saved);
-        dev->GetDepthStencilSurface(&ds_saved);
-        dev->GetViewport(&vp_saved);
-
-        dev->GetVertexShader(&vs_saved);
-        dev->GetPixelShader(&ps_saved);
-        dev->GetTexture(0, &tex0_saved);
+        // The caller normally holds the state scope (it draws the overlay
+        // after us); standalone, this frame restores what it touched itself.
+        const bool own_scope = !sd_active(sd);
+        if (own_scope)
+            sd_begin(sd, dev);
 
         auto restore_state = [&]() {
-            dev->SetTexture(0, tex0_saved);
-            dev->SetVertexShader(vs_saved);
-            dev->SetPixelShader(ps_saved);
-
-            dev->SetRenderTarget(0, rt_saved);
-            dev->SetDepthStencilSurface(ds_saved);
-            dev->SetViewport(&vp_saved);
-
-            if (tex0_saved) { tex0_saved->Release(); tex0_saved = nullptr; }
-            if (vs_saved) { vs_saved->Release();   vs_saved = nullptr; }
-            if (ps_saved) { ps_saved->Release();   ps_saved = nullptr; }
-            if (rt_saved) { rt_saved->Release();   rt_saved = nullptr; }
-            if (ds_saved) { ds_saved->Release();   ds_saved = nullptr; }
+            if (own_scope)
+                sd_end(sd);
             };
 
         // Baseline states
-        dev->SetDepthStencilSurface(nullptr);
-        dev->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
-        dev->SetRenderState(D3DRS_ZENABLE, FALSE);
-        dev->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
-        dev->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
+        sd_ds(sd, nullptr);
+        sd_rs(sd, D3DRS_ALPHABLENDENABLE, FALSE);
+        sd_rs(sd, D3DRS_ZENABLE, FALSE);
+        sd_rs(sd, D3DRS_ZWRITEENABLE, FALSE);
+        sd_rs(sd, D3DRS_CULLMODE, D3DCULL_NONE);
 
         // Bind quad stream (same as apply_pass0)
-        dev->SetStreamSource(0, d3d9->frame_vbo, 0, sizeof(zm_slang_vertex));
-        dev->SetVertexDeclaration(d3d9->vertex_decl);
+        quad_bind(sd, d3d9->quad);
 
         // Source dims
         D3DSURFACE_DESC srcd{};
@@ -1295,7 +2068,8 @@ namespace ZeroMod {
             int_w = 240 * k;
             int_h = 160 * k;
 
-            if (!ensure_zero_rt(dev, d3d9->zero_pre, 240, 160)) { restore_state(); return false; }
+            // with history on, the crop lands straight in the history ring
+            if (!rt->frames.history_depth && !ensure_zero_rt(dev, d3d9->zero_pre, 240, 160)) { restore_state(); return false; }
             if (!ensure_zero_rt(dev, d3d9->zero_out, int_w, int_h)) { restore_state(); return false; }
         }
         // ZM-INT: Force integer scaling for ZX path
@@ -1322,26 +2096,53 @@ namespace ZeroMod {
 
         const unsigned N = rt->num_passes;
 
+        // Once per frame, however often the chain draws in it: the feedback
+        // pairs flip, so last frame's output becomes this frame's
+        // PassFeedback, and the oldest history slot takes this frame's Original
+        sfs_frame_begin(rt->frames, frame_count);
+        for (unsigned i = 0; i < N; ++i)
+        {
+            d3d9_slang_pass& P = rt->passes[i];
+            if (!P.feedback || !P.fb_tex[0])
+                continue;
+            rt->live_feedback_tex[i] = P.fb_tex[sfs_fb_read(rt->frames, i)];
+            rt->live_feedback_size[i] = size4_from_tex(P.fb_tex[0]);
+        }
+
+        const bool history = rt->frames.history_depth > 0;
+        if (history) {
+            if (!slang_history_ensure(dev, rt, do_active_crop ? 240 : orig_w, do_active_crop ? 160 : orig_h)) {
+                restore_state();
+                return false;
+            }
+        }
+        IDirect3DTexture9* original_tex = src_tex;
+
+        // A final pass with feedback renders offscreen and is blitted like zero_out
+        const bool last_feedback = rt->passes[N - 1].feedback;
+        const bool final_offscreen = (int_w != ow || int_h != oh) || last_feedback;
+
         if (do_active_crop)
         {
+            const unsigned head = sfs_history_slot(rt->frames, 0);
+            IDirect3DSurface9* crop_surf = history ? rt->history_surf[head] : d3d9->zero_pre.surf;
+            IDirect3DTexture9* crop_tex = history ? rt->history_tex[head] : d3d9->zero_pre.tex;
+
             // Render cropped active image into integer-scaled RT (int_w x int_h)
-            dev->SetRenderTarget(0, d3d9->zero_pre.surf);
+            sd_rt(sd, crop_surf);
             D3DVIEWPORT9 vp0{};
             vp0.X = 0; vp0.Y = 0;
             vp0.Width = 240;
             vp0.Height = 160;
             vp0.MinZ = 0; vp0.MaxZ = 1;
-            dev->SetViewport(&vp0);
+            sd_viewport(sd, vp0);
 
-            dev->SetRenderState(D3DRS_SCISSORTESTENABLE, FALSE);
-
-            // Fullscreen quad, but UV cropped to active rect
-            slang_update_quad_pos_xy(d3d9->frame_vbo, 1.0f, 1.0f);
+            sd_rs(sd, D3DRS_SCISSORTESTENABLE, FALSE);
 
+            // Fullscreen quad, UV cropped to active rect (blit VS constants).
             // Draw with POINT to preserve exact integer scaling
-            if (!draw_fixedfunc_textured_quad_rhw_xy(
-                dev, src_tex,
-                0, 0,
+            if (!draw_fixedfunc_textured_quad(
+                sd, d3d9->quad, src_tex,
                 240, 160,
                 crop_u0, crop_v0, crop_u1, crop_v1,
                 true))
@@ -1349,12 +2150,8 @@ namespace ZeroMod {
                 restore_state();
                 return false;
             }
-            // Ensure shader pass quad is always full-screen and full UVs
-            slang_update_quad_pos_xy(d3d9->frame_vbo, 1.0f, 1.0f);
-            slang_reset_quad_uv(d3d9->frame_vbo);
-
             // Now feed shader chain from the integer-scaled texture
-            in_tex = d3d9->zero_pre.tex;
+            in_tex = crop_tex;
             D3DSURFACE_DESC t{};
             in_tex->GetLevelDesc(0, &t);
             zm_draw_dbgf("[CHECK] in_tex GetLevelDesc = %ux%u\n", (unsigned)t.Width, (unsigned)t.Height);
@@ -1363,9 +2160,37 @@ namespace ZeroMod {
 
             // original lattice for the preset is now 240x160
             rt->live_original_tex = in_tex;
+            original_tex = in_tex;
+        }
+        else if (history)
+        {
+            // Capture this frame's Original into the ring head (the only copy;
+            // older frames stay where they are)
+            sd_rt(sd, rt->history_surf[sfs_history_slot(rt->frames, 0)]);
+            D3DVIEWPORT9 vh{};
+            vh.Width = orig_w;
+            vh.Height = orig_h;
+            vh.MinZ = 0.0f; vh.MaxZ = 1.0f;
+            sd_viewport(sd, vh);
+            sd_rs(sd, D3DRS_SCISSORTESTENABLE, FALSE);
+
+            if (!draw_fixedfunc_textured_quad(
+                sd, d3d9->quad, src_tex,
+                orig_w, orig_h,
+                0.0f, 0.0f, 1.0f, 1.0f,
+                true))
+            {
+                restore_state();
+                return false;
+            }
         }
-        dev->SetStreamSource(0, d3d9->frame_vbo, 0, sizeof(zm_slang_vertex));
-        dev->SetVertexDeclaration(d3d9->vertex_decl);
+        if (history)
+            slang_history_publish(rt);
+
+        // The crop/history blits wrote the blit VS transform into c0-c1
+        csh_forget(rt->vs_shadow, 0, 2);
+
+        quad_bind(sd, d3d9->quad);
 
         for (unsigned i = 0; i < N; ++i)
         {
@@ -1398,7 +2223,7 @@ namespace ZeroMod {
 
             // --- Select render target surface ---
             IDirect3DSurface9* out_surf = nullptr;
-            if (i == N - 1) {
+            if (i == N - 1 && !P.feedback) {
                 if (int_w != ow || int_h != oh)
                     out_surf = d3d9->zero_out.surf;
                 else
@@ -1406,34 +2231,39 @@ namespace ZeroMod {
             }
             else {
                 const bool want_fp = (cfg.fbo.fp_fbo != 0);
-                if (!slang_ensure_rt(dev, P, out_w, out_h, want_fp)) {
+                if (!slang_acquire_pass_rt(dev, rt, i, out_w, out_h, want_fp)) {
                     restore_state();
                     return false;
                 }
                 out_surf = P.rt_surf;
+                if (!P.feedback)
+                    rt_dedicated_bytes += slang_rt_bytes(out_w, out_h,
+                        want_fp ? D3DFMT_A16B16G16R16F : D3DFMT_A8R8G8B8);
             }
+            rt->live_pass_tex[i] = P.rt;
+            rt->live_pass_size[i] = zm_size4(out_w, out_h);
 
-            dev->SetRenderTarget(0, out_surf);
+            sd_rt(sd, out_surf);
 
             // --- Viewport + scissor ---
             D3DVIEWPORT9 pass_vp{};
             if (i == N - 1) {
                 // FINAL PASS:
-                if (int_w != ow || int_h != oh) {
+                if (final_offscreen) {
                     pass_vp.X = 0;
                     pass_vp.Y = 0;
                     pass_vp.Width = (DWORD)eff_vp_w;
                     pass_vp.Height = (DWORD)eff_vp_h;
-                    dev->SetRenderState(D3DRS_SCISSORTESTENABLE, FALSE);
+                    sd_rs(sd, D3DRS_SCISSORTESTENABLE, FALSE);
                 }
                 else {
                     pass_vp.X = (DWORD)ox;
                     pass_vp.Y = (DWORD)oy;
                     pass_vp.Width = (DWORD)ow;
                     pass_vp.Height = (DWORD)oh;
-                    dev->SetRenderState(D3DRS_SCISSORTESTENABLE, TRUE);
+                    sd_rs(sd, D3DRS_SCISSORTESTENABLE, TRUE);
                     RECT sr{ (LONG)ox, (LONG)oy, (LONG)(ox + ow), (LONG)(oy + oh) };
-                    dev->SetScissorRect(&sr);
+                    sd_scissor(sd, sr);
                 }
             }
             else {
@@ -1442,18 +2272,18 @@ namespace ZeroMod {
                 pass_vp.Y = 0;
                 pass_vp.Width = (DWORD)out_w;
                 pass_vp.Height = (DWORD)out_h;
-                dev->SetRenderState(D3DRS_SCISSORTESTENABLE, FALSE);
+                sd_rs(sd, D3DRS_SCISSORTESTENABLE, FALSE);
             }
             pass_vp.MinZ = 0.0f;
             pass_vp.MaxZ = 1.0f;
-            dev->SetViewport(&pass_vp);
+            sd_viewport(sd, pass_vp);
 
             // --- Update live semantics for THIS pass ---
             {
                 // The actual input texture is always 256x192.
                 // Any “240x160” is an *implicit* crop handled by overscan/VPos, NOT by changing sizes.
                 // Therefore OriginalSize should match the actual original content texture.
-                rt->live_original_tex = do_active_crop ? d3d9->zero_pre.tex : src_tex;
+                rt->live_original_tex = original_tex;
                 rt->live_original_size = size4_from_tex(rt->live_original_tex);
 
                 float4_t orig_sz = size4_from_tex(src_tex); // container 256x192
@@ -1612,11 +2442,17 @@ namespace ZeroMod {
             }
 #endif
             // Draw this pass (factored from apply_pass0)
-            if (!slang_bind_and_draw_pass(dev, d3d9, rt, P, cfg, in_tex, pass_vp)) {
+            if (!slang_bind_and_draw_pass(sd, d3d9, rt, P, cfg, in_tex, pass_vp)) {
                 restore_state();
                 return false;
             }
 
+            // Outputs nobody reads after this pass go back to the pool
+            for (unsigned j = 0; j + 1 < N && j <= i; ++j) {
+                if (rt->passes[j].rt_last_reader == i)
+                    slang_rt_pool_release(rt->rt_pool, rt->passes[j].rt_slot);
+            }
+
             // Next input texture is the RT just rendered (intermediate only)
             if (i != N - 1) {
                 zm_draw_dbgf("[MP] after pass%u: out=%ux%u  P.rt=%p  P.rt_surf=%p\n",
@@ -1630,12 +2466,14 @@ namespace ZeroMod {
                 in_h = out_h;
             }
         }
-        if (int_w != ow || int_h != oh)
+        if (final_offscreen)
         {
+            IDirect3DTexture9* final_tex = last_feedback ? rt->passes[N - 1].rt : d3d9->zero_out.tex;
+
             const UINT dx = (ow > eff_vp_w) ? (ow - eff_vp_w) / 2 : 0;
             const UINT dy = (oh > eff_vp_h) ? (oh - eff_vp_h) / 2 : 0;
 
-            dev->SetRenderTarget(0, dst_rtv);
+            sd_rt(sd, dst_rtv);
 
             D3DVIEWPORT9 vpF{};
             vpF.X = (DWORD)(ox + dx);
@@ -1643,36 +2481,32 @@ namespace ZeroMod {
             vpF.Width = (DWORD)eff_vp_w;
             vpF.Height = (DWORD)eff_vp_h;
             vpF.MinZ = 0.0f; vpF.MaxZ = 1.0f;
-            dev->SetViewport(&vpF);
+            sd_viewport(sd, vpF);
 
-            dev->SetRenderState(D3DRS_SCISSORTESTENABLE, TRUE);
+            sd_rs(sd, D3DRS_SCISSORTESTENABLE, TRUE);
             RECT sr{ (LONG)ox, (LONG)oy, (LONG)(ox + ow), (LONG)(oy + oh) };
-            dev->SetScissorRect(&sr);
-
-            // reuse your quad (full UVs)
-            slang_update_quad_pos_xy(d3d9->frame_vbo, 1.0f, 1.0f);
-            slang_reset_quad_uv(d3d9->frame_vbo);
+            sd_scissor(sd, sr);
 
             // set RT/viewport/scissor
-            dev->SetRenderTarget(0, dst_rtv);
-            dev->SetViewport(&vpF);
-            dev->SetScissorRect(&sr);
+            sd_rt(sd, dst_rtv);
+            sd_viewport(sd, vpF);
+            sd_scissor(sd, sr);
 
             // RIGHT BEFORE FINAL BLIT (the draw)
-            dev->SetSamplerState(0, D3DSAMP_MINFILTER, D3DTEXF_POINT);
-            dev->SetSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_POINT);
-            dev->SetSamplerState(0, D3DSAMP_MIPFILTER, D3DTEXF_NONE);
+            sd_sampler(sd, 0, D3DSAMP_MINFILTER, D3DTEXF_POINT);
+            sd_sampler(sd, 0, D3DSAMP_MAGFILTER, D3DTEXF_POINT);
+            sd_sampler(sd, 0, D3DSAMP_MIPFILTER, D3DTEXF_NONE);
 
             // log sizes RIGHT BEFORE FINAL BLIT
             D3DSURFACE_DESC zd{};
-            d3d9->zero_out.tex->GetLevelDesc(0, &zd);
-            zm_draw_dbgf("[FINAL BLIT] zero_out=%ux%u dst=%ux%u\n",
+            final_tex->GetLevelDesc(0, &zd);
+            zm_draw_dbgf("[FINAL BLIT] final=%ux%u dst=%ux%u\n",
                 (unsigned)zd.Width, (unsigned)zd.Height,
                 (unsigned)eff_vp_w, (unsigned)eff_vp_h);
 
-            if (!draw_fixedfunc_textured_quad_rhw_xy(
-                dev, d3d9->zero_out.tex,
-                (int)(ox + dx), (int)(oy + dy),   // <--- APPLY the 200px offset here
+            // vpF already carries the centering offset
+            if (!draw_fixedfunc_textured_quad(
+                sd, d3d9->quad, final_tex,
                 eff_vp_w, eff_vp_h,               // size on screen
                 0.0f, 0.0f, 1.0f, 1.0f,           // full UVs
                 true))
@@ -1682,13 +2516,16 @@ namespace ZeroMod {
             }
         }
 
+        zm_const_frame_end(rt);
+        slang_rt_pool_frame_end(rt->rt_pool, rt_dedicated_bytes, N ? N - 1 : 0);
+
         // Restore caller state
         restore_state();
         return true;
     }
 
     static bool slang_bind_and_draw_pass(
-        IDirect3DDevice9* dev,
+        zm_state_delta& sd,
         d3d9_video_struct* d3d9,
         d3d9_slang_runtime* rt,
         d3d9_slang_pass& P,
@@ -1697,29 +2534,59 @@ namespace ZeroMod {
         const D3DVIEWPORT9& pass_vp
     )
     {
-        if (!dev || !d3d9 || !rt || !P.compiled || !P.vs || !P.ps || !in_tex)
+        if (!sd.dev || !d3d9 || !rt || !P.compiled || !P.vs || !P.ps || !in_tex)
             return false;
+        IDirect3DDevice9* dev = sd.dev;
         // Clear a small known range to prevent state leakage (D3D9 hazard)
         for (int st = 0; st < 4; ++st)
-            dev->SetTexture(st, nullptr);
+            sd_texture(sd, st, nullptr);
 
         for (int st = 0; st < 8; ++st)  // or however many used
-            dev->SetSamplerState(st, D3DSAMP_SRGBTEXTURE, FALSE);
+            sd_sampler(sd, st, D3DSAMP_SRGBTEXTURE, FALSE);
+
+        // Bind shaders
+        if (FAILED(sd_vs(sd, P.vs))) return false;
+        if (FAILED(sd_ps(sd, P.ps)))  return false;
 
-        // halfpixel must match THIS pass viewport
-        set_halfpixel_vs(dev, P.vs_ct, pass_vp.Width, pass_vp.Height);
+        // Constant-table writes don't go through the state delta; save the
+        // whole register file once so the caller's constants come back.
+#if ZM_SLANG_CONST_SHADOW
+        if (!P.consts_planned || !P.sem_valid)
+#endif
+        {
+            sd_touch_vs_consts(sd, 0, ZM_SD_MAX_VS_CONSTS);
+            sd_touch_ps_consts(sd, 0, ZM_SD_MAX_PS_CONSTS);
+        }
 
-        // Identity MVP
-        D3DXMATRIX I;
-        D3DXMatrixIdentity(&I);
-        set_mvp_vs(dev, P.vs_ct, &I);
+#if ZM_SLANG_CONST_SHADOW
+        if (P.consts_planned)
+        {
+            // halfpixel must match THIS pass viewport; MVP is the identity in the table
+            P.halfpixel[0] = pass_vp.Width ? 1.0f / (float)pass_vp.Width : 0.0f;
+            P.halfpixel[1] = pass_vp.Height ? 1.0f / (float)pass_vp.Height : 0.0f;
+            P.halfpixel[2] = 0.0f;
+            P.halfpixel[3] = 0.0f;
+
+            zm_upload_consts(sd, d3d9, rt, P, false);
+            zm_upload_consts(sd, d3d9, rt, P, true);
+        }
+        else
+#endif
+        {
+            // constant table writes below bypass the shadow
+            zm_const_invalidate(rt);
 
-        // Bind shaders
-        if (FAILED(dev->SetVertexShader(P.vs))) return false;
-        if (FAILED(dev->SetPixelShader(P.ps)))  return false;
+            // halfpixel must match THIS pass viewport
+            set_halfpixel_vs(dev, P.vs_ct, pass_vp.Width, pass_vp.Height);
+
+            // Identity MVP
+            D3DXMATRIX I;
+            D3DXMatrixIdentity(&I);
+            set_mvp_vs(dev, P.vs_ct, &I);
+        }
 
         // Upload cbuffers from semantics
-        if (P.sem_valid)
+        if (P.sem_valid && !P.consts_planned)
         {
             const cbuffer_sem_t& ubo = P.sem.cbuffers[SLANG_CBUFFER_UBO];
             const cbuffer_sem_t& pc = P.sem.cbuffers[SLANG_CBUFFER_PC];
@@ -1750,6 +2617,7 @@ namespace ZeroMod {
                 rt->live_original_size.x, rt->live_original_size.y);
         }
 
+#if ZM_VERBOSE_DRAW
         auto dump_sampler = [&](ID3DXConstantTable* ct, const char* name) -> int
             {
                 if (!ct) { zm_draw_dbgf("    sampler '%s': ct=null\n", name); return -1; }
@@ -1765,10 +2633,15 @@ namespace ZeroMod {
         dump_sampler(P.ps_ct, "Source");
         dump_sampler(P.ps_ct, "Original");
         zm_draw_dbgf("    P.source_sampler_reg=%d\n", (int)P.source_sampler_reg);
+#endif
 
         // Bind ALL sampler2D slots declared in PS (Source/Original/alias samplers)
-        zm_bind_all_ps_samplers_by_ct(dev, d3d9, rt, P, cfg, in_tex);
+        if (P.bind)
+            zm_bind_ps_samplers(sd, rt, P, cfg, in_tex);
+        else
+            zm_bind_all_ps_samplers_by_ct(sd, d3d9, rt, P, cfg, in_tex);
 
+#if ZM_VERBOSE_DRAW
         // --- POST-BIND PROOF (after SetTexture calls) ---
         if (P.ps_ct) {
             int sSrc = -1, sOrg = -1;
@@ -1786,17 +2659,26 @@ namespace ZeroMod {
             if (tS) tS->Release();
             if (tO) tO->Release();
         }
+#endif
 
         // Baseline render states
-        dev->SetRenderState(D3DRS_ZENABLE, FALSE);
-        dev->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
-        dev->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
-        dev->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
-        dev->SetRenderState(D3DRS_ALPHATESTENABLE, FALSE);
-        dev->SetRenderState(D3DRS_COLORWRITEENABLE, 0xF);
-        dev->SetRenderState(D3DRS_SRGBWRITEENABLE, (cfg.fbo.srgb_fbo != 0) ? TRUE : FALSE);
-
-        HRESULT hr_dp = dev->DrawPrimitive(D3DPT_TRIANGLESTRIP, 0, 2);
+        sd_rs(sd, D3DRS_ZENABLE, FALSE);
+        sd_rs(sd, D3DRS_ZWRITEENABLE, FALSE);
+        sd_rs(sd, D3DRS_CULLMODE, D3DCULL_NONE);
+        sd_rs(sd, D3DRS_ALPHABLENDENABLE, FALSE);
+        sd_rs(sd, D3DRS_ALPHATESTENABLE, FALSE);
+        sd_rs(sd, D3DRS_COLORWRITEENABLE, 0xF);
+        sd_rs(sd, D3DRS_SRGBWRITEENABLE, (cfg.fbo.srgb_fbo != 0) ? TRUE : FALSE);
+
+        HRESULT hr_dp;
+        {
+            char label[32];
+            label[0] = '\0';
+            if (g_gpu_prof.cur)
+                _snprintf(label, sizeof(label), "slang %u %s", (unsigned)(&P - rt->passes), cfg.alias);
+            ZM_GPU_SCOPE(label);
+            hr_dp = dev->DrawPrimitive(D3DPT_TRIANGLESTRIP, ZM_QUAD_FULL, 2);
+        }
         zm_draw_dbgf("[DRAW] pass alias='%s' hr=0x%08X\n", cfg.alias, (unsigned)hr_dp);
         return SUCCEEDED(hr_dp);
     }
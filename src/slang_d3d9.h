@@ -1,8 +1,13 @@
 #pragma once
 #include <d3d9.h>
+#include <stdint.h>
+#include <string>
+#include <atomic>
 #include "d3d9video.h"
 #include <d3dx9shader.h>
 #include "../retroarch/retroarch/gfx/drivers_shader/slang_process.h"
+#include "slang_d3d9_bindings.h"
+#include "state_delta.h"
 
 extern IDirect3DSurface9* last_slang_rtv;
 
@@ -22,7 +27,10 @@ namespace ZeroMod {
 
 	struct slang_d3d9_runtime;
 
+	// State changes go through 'sd'. If the caller has no scope open, the
+	// frame opens one and restores on return.
 	bool slang_d3d9_frame(
+		zm_state_delta& sd,
 		d3d9_video_struct* d3d9,
 		IDirect3DTexture9* src_tex,
 		IDirect3DSurface9* dst_rtv,
@@ -42,8 +50,17 @@ namespace ZeroMod {
 		ID3DXConstantTable* vs_ct = nullptr;
 		ID3DXConstantTable* ps_ct = nullptr;
 
+		// Borrowed from the runtime's RT pool for the current frame only
 		IDirect3DTexture9* rt = nullptr;
 		IDirect3DSurface9* rt_surf = nullptr;
+		int rt_slot;               // pool slot last frame, -1 = none
+		unsigned rt_last_reader;   // last pass index that samples this output
+
+		// PassFeedback: owned ping-pong pair instead of a pool target. The
+		// runtime's frame store says which half is this frame's output.
+		bool feedback;
+		IDirect3DTexture9* fb_tex[2];
+		IDirect3DSurface9* fb_surf[2];
 
 		char* hlsl_vs = nullptr;
 		char* hlsl_ps = nullptr;
@@ -55,6 +72,11 @@ namespace ZeroMod {
 		bool sem_valid = false;
         int  source_sampler_reg;   // -1 = unknown
         bool tl_inited;
+
+		// Register/sampler bindings flattened at build time (malloc'd, may be null)
+		slang_pass_bindings* bind;
+		bool consts_planned;       // false -> per-name ID3DXConstantTable path
+		float halfpixel[4];        // gl_HalfPixel backing, refreshed per draw
 	};
 
 	// Allocate runtime object (no device calls)
@@ -68,6 +90,46 @@ namespace ZeroMod {
 	// Logs and marks runtime as ready.
 	bool slang_d3d9_runtime_build_from_parsed(d3d9_video_struct* d3d9);
 
+	struct slang_cache_entry;
+	struct slang_lut_set;
+	struct slang_pass_sources;
+
+	// Device-free half of a pass build: glslang -> SPIRV-Cross -> D3DX bytecode
+	// (or the pass cache). Worker-safe; uniform pointers in out.sem refer to map/shader.
+	// 'source' is the pass' expanded source the cache is keyed on; null skips the cache.
+	bool slang_d3d9_prepare_pass(
+		video_shader* shader,
+		unsigned i,
+		const semantics_map_t* map,
+		const std::string* source,
+		slang_cache_entry& out);
+
+	// prepare_pass for passes [0, passes) on a small thread pool, then join.
+	// Stops early if *cancel becomes nonzero. All-or-nothing: on failure out[] is freed.
+	// 'sources' (slang_d3d9_pass_sources for the same preset) may be null; with
+	// them, aliases and parameters are registered in pass order before any
+	// worker starts, so shader->parameters doesn't depend on thread timing.
+	bool slang_d3d9_prepare_passes(
+		video_shader* shader,
+		unsigned passes,
+		const semantics_map_t* map,
+		const slang_pass_sources* sources,
+		slang_cache_entry* out,
+		const std::atomic<int>* cancel);
+
+	// Render thread: swap a worker-prepared chain in. Moves 'parsed' into d3d9->shader,
+	// rebinds uniforms from prep_map to the live runtime and creates the device objects,
+	// LUT textures from the worker-decoded 'luts' included. Every pass is created
+	// before the swap; on failure the current chain and 'parsed' are left as they were.
+	bool slang_d3d9_runtime_adopt_prepared(
+		d3d9_video_struct* d3d9,
+		const char* path,
+		video_shader* parsed,
+		slang_cache_entry* prep,
+		unsigned num_passes,
+		const semantics_map_t* prep_map,
+		slang_lut_set* luts);
+
 	// Per-frame tick hook (Call from Present)
 	// Will only re-build and emit once-per-change logs.
 	void slang_d3d9_runtime_tick(d3d9_video_struct* d3d9);
@@ -0,0 +1,207 @@
+#include "slang_d3d9_async.h"
+#include "slang_d3d9.h"
+#include "slang_d3d9_cache.h"
+#include "slang_d3d9_preset_load.h"
+#include "slang_d3d9_lut.h"
+#include "slang_job.h"
+
+#include <windows.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+namespace ZeroMod {
+
+    // Lifetime and state in zm_job (slang_job.h)
+    struct slang_compile_job : zm_job
+    {
+        char* path = nullptr;
+        video_shader* shader = nullptr;   // parsed by the worker, moved into d3d9->shader on swap
+        unsigned num_passes = 0;
+        slang_cache_entry prep[GFX_MAX_SHADERS];
+        slang_lut_set luts = {};          // decoded by the worker, uploaded on swap
+
+        // Worker-side semantics backing. slang_process only records these
+        // addresses; they're rebound to the live runtime at swap.
+        IDirect3DTexture9* stage_tex = nullptr;
+        float stage_original[4] = {};
+        float stage_source[4] = {};
+        float stage_output[4] = {};
+        float stage_final_vp[4] = {};
+        uint32_t stage_frame_count = 0;
+        int32_t stage_frame_dir = 1;
+        math_matrix_4x4 stage_mvp = {};
+        float stage_history[GFX_MAX_FRAME_HISTORY + 1][4] = {};
+        float stage_pass_output[GFX_MAX_SHADERS][4] = {};
+        float stage_feedback[GFX_MAX_SHADERS][4] = {};
+        float stage_lut[GFX_MAX_TEXTURES][4] = {};
+        semantics_map_t map = {};
+
+        LARGE_INTEGER t_begin = {};
+        LARGE_INTEGER t_done = {};
+    };
+
+    static void zm_async_dbgf(const char* fmt, ...)
+    {
+        char b[768];
+        va_list va;
+        va_start(va, fmt);
+        _vsnprintf(b, sizeof(b), fmt, va);
+        va_end(va);
+        b[sizeof(b) - 1] = '\0';
+        OutputDebugStringA(b);
+    }
+
+    static double zm_qpc_ms(const LARGE_INTEGER& a, const LARGE_INTEGER& b)
+    {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return (double)(b.QuadPart - a.QuadPart) * 1000.0 / (double)f.QuadPart;
+    }
+
+    static void job_destroy(zm_job* base)
+    {
+        slang_compile_job* j = static_cast<slang_compile_job*>(base);
+        for (unsigned i = 0; i < GFX_MAX_SHADERS; ++i)
+            slang_cache_entry_free(j->prep[i]);
+        slang_lut_set_free(j->luts);
+
+        if (j->shader) {
+            slang_d3d9_free_parsed_shader(j->shader);
+            free(j->shader);
+        }
+        if (j->path) free(j->path);
+        delete j;
+    }
+
+    static DWORD WINAPI slang_job_proc(LPVOID param)
+    {
+        slang_compile_job* j = (slang_compile_job*)param;
+
+        bool ok = slang_d3d9_parse_preset(j->path, j->shader);
+        if (ok) {
+            unsigned passes = j->shader->passes;
+            if (passes > GFX_MAX_SHADERS) passes = GFX_MAX_SHADERS;
+            j->num_passes = passes;
+            ok = passes > 0;
+        }
+
+        if (ok)
+            ok = slang_lut_decode(j->shader, j->luts, &j->cancel);
+
+        // From the parse just done, not whichever preset the cache saw last
+        slang_pass_sources sources;
+        if (ok)
+            slang_d3d9_pass_sources(j->path, j->shader, sources);
+
+        if (ok)
+            ok = slang_d3d9_prepare_passes(j->shader, j->num_passes, &j->map, &sources, j->prep, &j->cancel);
+
+        QueryPerformanceCounter(&j->t_done);
+        job_finish(j, ok);
+        return 0;
+    }
+
+    bool slang_d3d9_async_begin(d3d9_video_struct* d3d9)
+    {
+        if (!d3d9 || d3d9->magic != 0x39564433)
+            return false;
+
+        if (!d3d9->shader_is_path || !d3d9->shader_path || !*d3d9->shader_path)
+            return false;
+
+        // A newer request always wins.
+        job_cancel(d3d9->slang_job);
+
+        slang_compile_job* j = new slang_compile_job();
+        job_init(j, job_destroy);
+        j->path = _strdup(d3d9->shader_path);
+        j->shader = (video_shader*)calloc(1, sizeof(video_shader));
+        if (!j->path || !j->shader) {
+            job_abort(j);
+            return false;
+        }
+
+        j->stage_original[0] = j->stage_source[0] = j->stage_output[0] = j->stage_final_vp[0] = 256.0f;
+        j->stage_original[1] = j->stage_source[1] = j->stage_output[1] = j->stage_final_vp[1] = 192.0f;
+
+        semantics_map_t& m = j->map;
+        m.textures[SLANG_TEXTURE_SEMANTIC_ORIGINAL].image = &j->stage_tex;
+        m.textures[SLANG_TEXTURE_SEMANTIC_ORIGINAL].size = j->stage_original;
+        m.textures[SLANG_TEXTURE_SEMANTIC_SOURCE].image = &j->stage_tex;
+        m.textures[SLANG_TEXTURE_SEMANTIC_SOURCE].size = j->stage_source;
+
+        // Arrays need the same strides as the live map so slots line up
+        m.textures[SLANG_TEXTURE_SEMANTIC_ORIGINAL_HISTORY].image = &j->stage_tex;
+        m.textures[SLANG_TEXTURE_SEMANTIC_ORIGINAL_HISTORY].size = j->stage_history;
+        m.textures[SLANG_TEXTURE_SEMANTIC_ORIGINAL_HISTORY].size_stride = sizeof(j->stage_history[0]);
+        m.textures[SLANG_TEXTURE_SEMANTIC_PASS_OUTPUT].image = &j->stage_tex;
+        m.textures[SLANG_TEXTURE_SEMANTIC_PASS_OUTPUT].size = j->stage_pass_output;
+        m.textures[SLANG_TEXTURE_SEMANTIC_PASS_OUTPUT].size_stride = sizeof(j->stage_pass_output[0]);
+        m.textures[SLANG_TEXTURE_SEMANTIC_PASS_FEEDBACK].image = &j->stage_tex;
+        m.textures[SLANG_TEXTURE_SEMANTIC_PASS_FEEDBACK].size = j->stage_feedback;
+        m.textures[SLANG_TEXTURE_SEMANTIC_PASS_FEEDBACK].size_stride = sizeof(j->stage_feedback[0]);
+        m.textures[SLANG_TEXTURE_SEMANTIC_USER].image = &j->stage_tex;
+        m.textures[SLANG_TEXTURE_SEMANTIC_USER].size = j->stage_lut;
+        m.textures[SLANG_TEXTURE_SEMANTIC_USER].size_stride = sizeof(j->stage_lut[0]);
+
+        m.uniforms[SLANG_SEMANTIC_MVP] = &j->stage_mvp;
+        m.uniforms[SLANG_SEMANTIC_OUTPUT] = j->stage_output;
+        m.uniforms[SLANG_SEMANTIC_FINAL_VIEWPORT] = j->stage_final_vp;
+        m.uniforms[SLANG_SEMANTIC_FRAME_COUNT] = &j->stage_frame_count;
+        m.uniforms[SLANG_SEMANTIC_FRAME_DIRECTION] = &j->stage_frame_dir;
+
+        QueryPerformanceCounter(&j->t_begin);
+
+        HANDLE h = CreateThread(NULL, 0, slang_job_proc, j, 0, NULL);
+        if (!h) {
+            zm_async_dbgf("[ZeroMod] slang_async: CreateThread FAILED (%lu)\n", (unsigned long)GetLastError());
+            job_abort(j);
+            return false;
+        }
+        CloseHandle(h);
+
+        d3d9->slang_job = j;
+        zm_async_dbgf("[ZeroMod] slang_async: compiling '%s' in background\n", j->path);
+        return true;
+    }
+
+    void slang_d3d9_async_poll(d3d9_video_struct* d3d9)
+    {
+        if (!d3d9 || d3d9->magic != 0x39564433)
+            return;
+
+        slang_compile_job* j = static_cast<slang_compile_job*>(job_take(d3d9->slang_job));
+        if (!j)
+            return;
+
+        if (j->state.load() == ZM_JOB_DONE)
+        {
+            LARGE_INTEGER t0, t1;
+            QueryPerformanceCounter(&t0);
+            bool ok = slang_d3d9_runtime_adopt_prepared(
+                d3d9, j->path, j->shader, j->prep, j->num_passes, &j->map, &j->luts);
+            QueryPerformanceCounter(&t1);
+
+            zm_async_dbgf("[ZeroMod] slang_async: '%s' %s (worker %.2f ms, render thread %.2f ms)\n",
+                j->path, ok ? "swapped in" : "swap FAILED",
+                zm_qpc_ms(j->t_begin, j->t_done), zm_qpc_ms(t0, t1));
+        }
+        else
+        {
+            zm_async_dbgf("[ZeroMod] slang_async: '%s' compile FAILED, keeping current chain\n", j->path);
+        }
+
+        job_release(j);
+    }
+
+    void slang_d3d9_async_cancel(d3d9_video_struct* d3d9)
+    {
+        if (!d3d9)
+            return;
+
+        job_cancel(d3d9->slang_job);
+    }
+
+} // namespace ZeroMod
@@ -0,0 +1,22 @@
+#pragma once
+#include "d3d9video.h"
+
+// ---- Background slang preset compile ----
+// Parse + glslang + SPIRV-Cross + D3DX bytecode run on a worker thread; the
+// finished chain is swapped in at Present. Only CreateVertexShader/
+// CreatePixelShader run on the render thread. The old chain keeps drawing
+// until the swap. Set to 0 for the old synchronous parse/build path.
+#define ZM_SLANG_ASYNC_COMPILE 1
+
+namespace ZeroMod {
+
+    // Kick a compile of d3d9->shader_path. Supersedes any job already in flight.
+    bool slang_d3d9_async_begin(d3d9_video_struct* d3d9);
+
+    // Call once per Present: swaps in a finished chain (or drops a failed one).
+    void slang_d3d9_async_poll(d3d9_video_struct* d3d9);
+
+    // Abandon the in-flight job (the worker frees it when it notices).
+    void slang_d3d9_async_cancel(d3d9_video_struct* d3d9);
+
+} // namespace ZeroMod
@@ -0,0 +1,437 @@
+#include "slang_d3d9_bindings.h"
+
+#include <windows.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#include <vector>
+
+static_assert(ZM_SLANG_MAX_HISTORY == GFX_MAX_FRAME_HISTORY, "slang_bind_table.h is out of step with RetroArch");
+
+namespace ZeroMod {
+
+    static void zm_bind_dbgf(const char* fmt, ...)
+    {
+        char b[512];
+        va_list va;
+        va_start(va, fmt);
+        _vsnprintf(b, sizeof(b), fmt, va);
+        va_end(va);
+        b[sizeof(b) - 1] = '\0';
+        OutputDebugStringA(b);
+    }
+
+    // Array length behind each texture semantic's size pointer
+    static uint32_t zm_texsize_count(uint32_t semantic)
+    {
+        switch (semantic) {
+        case SLANG_TEXTURE_SEMANTIC_ORIGINAL_HISTORY: return GFX_MAX_FRAME_HISTORY + 1;
+        case SLANG_TEXTURE_SEMANTIC_PASS_OUTPUT:
+        case SLANG_TEXTURE_SEMANTIC_PASS_FEEDBACK:    return GFX_MAX_SHADERS;
+        case SLANG_TEXTURE_SEMANTIC_USER:             return GFX_MAX_TEXTURES;
+        default:                                      return 1;
+        }
+    }
+
+    // ---- uniform slot encode/decode ----
+    bool slang_slot_encode(
+        const void* data,
+        const semantics_map_t* map,
+        const video_shader* shader,
+        uint32_t& slot)
+    {
+        slot = ZM_SLOT_NONE;
+        if (!data)
+            return true;
+
+        for (uint32_t i = 0; i < SLANG_NUM_BASE_SEMANTICS; ++i) {
+            if (map->uniforms[i] && map->uniforms[i] == data) {
+                slot = (ZM_SLOT_UNIFORM << 16) | i;
+                return true;
+            }
+        }
+
+        for (uint32_t i = 0; i < SLANG_NUM_TEXTURE_SEMANTICS; ++i) {
+            const texture_map_t& t = map->textures[i];
+            if (!t.size)
+                continue;
+
+            const ptrdiff_t off = (const uint8_t*)data - (const uint8_t*)t.size;
+            if (off == 0) {
+                slot = (ZM_SLOT_TEXSIZE << 16) | i;
+                return true;
+            }
+            if (off > 0 && t.size_stride && (size_t)off % t.size_stride == 0) {
+                const size_t elem = (size_t)off / t.size_stride;
+                if (elem < zm_texsize_count(i)) {
+                    slot = (ZM_SLOT_TEXSIZE << 16) | ((uint32_t)elem << 8) | i;
+                    return true;
+                }
+            }
+        }
+
+        // address match only, so this still works on a shader that was just moved out
+        for (uint32_t i = 0; i < GFX_MAX_PARAMETERS; ++i) {
+            if (&shader->parameters[i].current == data) {
+                slot = (ZM_SLOT_PARAM << 16) | i;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool slang_slot_decode(
+        uint32_t slot,
+        const semantics_map_t* map,
+        video_shader* shader,
+        void*& data)
+    {
+        const uint32_t kind = slot >> 16;
+        const uint32_t idx = slot & 0xFFFF;
+
+        data = nullptr;
+        switch (kind)
+        {
+        case ZM_SLOT_NONE:
+            return true;
+        case ZM_SLOT_UNIFORM:
+            if (idx >= SLANG_NUM_BASE_SEMANTICS) return false;
+            data = map->uniforms[idx];
+            return data != nullptr;
+        case ZM_SLOT_TEXSIZE:
+        {
+            const uint32_t sem = idx & 0xFF;
+            const uint32_t elem = idx >> 8;
+            if (sem >= SLANG_NUM_TEXTURE_SEMANTICS || elem >= zm_texsize_count(sem)) return false;
+            const texture_map_t& t = map->textures[sem];
+            if (!t.size || (elem && !t.size_stride)) return false;
+            data = (uint8_t*)t.size + elem * t.size_stride;
+            return true;
+        }
+        case ZM_SLOT_PARAM:
+            if (idx >= shader->num_parameters || idx >= GFX_MAX_PARAMETERS) return false;
+            data = &shader->parameters[idx].current;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    D3DXHANDLE slang_find_ct_handle(ID3DXConstantTable* ct, const char* id)
+    {
+        if (!ct || !id || !id[0]) return nullptr;
+
+        // MVP special-case (shader emits global_MVP)
+        if (_stricmp(id, "MVP") == 0)
+            return ct->GetConstantByName(nullptr, "global_MVP");
+
+        auto try_name = [&](const char* name) -> D3DXHANDLE {
+            return name ? ct->GetConstantByName(nullptr, name) : nullptr;
+            };
+
+        auto try_fmt1 = [&](const char* fmt, const char* a) -> D3DXHANDLE {
+            char buf[128];
+            _snprintf(buf, sizeof(buf), fmt, a);
+            return try_name(buf);
+            };
+
+        auto try_fmt2 = [&](const char* fmt, const char* a, const char* b) -> D3DXHANDLE {
+            char buf[128];
+            _snprintf(buf, sizeof(buf), fmt, a, b);
+            return try_name(buf);
+            };
+
+        auto try_all_for_id = [&](const char* s) -> D3DXHANDLE
+            {
+                // 1) raw
+                if (D3DXHANDLE h = try_name(s)) return h;
+
+                // 2) params_foo / params.foo
+                if (D3DXHANDLE h = try_fmt1("params_%s", s)) return h;
+                if (D3DXHANDLE h = try_fmt1("params.%s", s)) return h;
+
+                // 3) global_foo / global.foo
+                if (D3DXHANDLE h = try_fmt1("global_%s", s)) return h;
+                if (D3DXHANDLE h = try_fmt1("global.%s", s)) return h;
+
+                // 4) NEW: registers_foo (SPIRV-Cross common)
+                if (D3DXHANDLE h = try_fmt1("registers_%s", s)) return h;
+
+                // 5) NEW: Push.registers_foo (cbuffer-scoped exposure)
+                if (D3DXHANDLE h = try_fmt1("Push.registers_%s", s)) return h;
+
+                // 6) NEW: sometimes just Push.foo
+                if (D3DXHANDLE h = try_fmt1("Push.%s", s)) return h;
+
+                // 7) NEW: occasionally global/params can wrap registers_
+                if (D3DXHANDLE h = try_fmt2("global_%s%s", "registers_", s)) return h; // "global_registers_Foo"
+                if (D3DXHANDLE h = try_fmt2("params_%s%s", "registers_", s)) return h;
+
+                return nullptr;
+            };
+
+        // First pass: exact id
+        if (D3DXHANDLE h = try_all_for_id(id))
+            return h;
+
+        // Second pass: case-normalized variant (covers brighten_scanlines vs BRIGHTEN_SCANLINES)
+        {
+            char up[128];
+            char lo[128];
+
+            _snprintf(up, sizeof(up), "%s", id);
+            _snprintf(lo, sizeof(lo), "%s", id);
+
+            for (char* p = up; *p; ++p) *p = (char)toupper((unsigned char)*p);
+            for (char* p = lo; *p; ++p) *p = (char)tolower((unsigned char)*p);
+
+            if (_stricmp(up, id) != 0) {
+                if (D3DXHANDLE h = try_all_for_id(up)) return h;
+            }
+            if (_stricmp(lo, id) != 0) {
+                if (D3DXHANDLE h = try_all_for_id(lo)) return h;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // The reflection of one constant
+    static bool zm_bind_refl(ID3DXConstantTable* ct, D3DXHANDLE h, slang_refl_const& out)
+    {
+        D3DXCONSTANT_DESC d{};
+        UINT n = 1;
+        if (FAILED(ct->GetConstantDesc(h, &d, &n)))
+            return false;
+
+        out = {};
+        out.name = d.Name;
+        out.cls = d.Class == D3DXPC_MATRIX_ROWS ? ZM_RC_MAT_ROWS
+            : d.Class == D3DXPC_MATRIX_COLUMNS ? ZM_RC_MAT_COLS
+            : (d.Class == D3DXPC_OBJECT && d.Type == D3DXPT_SAMPLER2D) ? ZM_RC_SAMPLER
+            : (d.Class == D3DXPC_SCALAR || d.Class == D3DXPC_VECTOR) ? ZM_RC_VECTOR
+            : ZM_RC_OTHER;
+        out.is_int = d.Type == D3DXPT_INT || d.Type == D3DXPT_BOOL;
+        out.float4 = d.RegisterSet == D3DXRS_FLOAT4;
+        out.reg = (uint16_t)(d.RegisterIndex < 0xFFFF ? d.RegisterIndex : 0xFFFF);
+        out.regs = (uint16_t)(d.RegisterCount < 0xFFFF ? d.RegisterCount : 0xFFFF);
+        out.rows = (uint16_t)d.Rows;
+        out.cols = (uint16_t)d.Columns;
+        return true;
+    }
+
+    // False = a constant couldn't be described; the pass then keeps the
+    // constant-table path for its uniforms.
+    static bool zm_bind_add_uniform(
+        std::vector<slang_refl_uniform>& out,
+        ID3DXConstantTable* ct,
+        D3DXHANDLE h,
+        uint32_t source,
+        UINT bytes)
+    {
+        slang_refl_uniform u{};
+        if (!zm_bind_refl(ct, h, u.c))
+            return false;
+        u.source = source;
+        u.bytes = bytes;
+        out.push_back(u);
+        return true;
+    }
+
+    static bool zm_bind_add_cbuffer(
+        std::vector<slang_refl_uniform>& out,
+        ID3DXConstantTable* ct,
+        const cbuffer_sem_t& cb,
+        const semantics_map_t* map,
+        const video_shader* shader,
+        unsigned pass,
+        const char* stage)
+    {
+        if (!cb.uniforms || cb.uniform_count <= 0)
+            return true;
+
+        for (int i = 0; i < cb.uniform_count; i++)
+        {
+            const uniform_sem_t& u = cb.uniforms[i];
+            if (!u.data || u.size == 0 || u.id[0] == 0)
+                continue;
+
+            // MVP has its own op
+            if (_stricmp(u.id, "MVP") == 0)
+                continue;
+
+            D3DXHANDLE h = slang_find_ct_handle(ct, u.id);
+            if (!h) {
+                zm_bind_dbgf("[ZeroMod] pass%u: %s uniform NOT FOUND: '%s' size=%u\n",
+                    pass, stage, u.id, (unsigned)u.size);
+                continue;
+            }
+
+            uint32_t slot = 0;
+            if (!slang_slot_encode(u.data, map, shader, slot) ||
+                !zm_bind_add_uniform(out, ct, h, slot, (UINT)u.size))
+                return false;
+        }
+        return true;
+    }
+
+    // Every constant of a table, for the samplers
+    static void zm_bind_all(ID3DXConstantTable* ct, std::vector<slang_refl_const>& out)
+    {
+        D3DXCONSTANTTABLE_DESC td{};
+        if (FAILED(ct->GetDesc(&td)))
+            return;
+
+        for (UINT i = 0; i < td.Constants; ++i)
+        {
+            slang_refl_const c;
+            if (D3DXHANDLE h = ct->GetConstant(nullptr, i))
+                if (zm_bind_refl(ct, h, c))
+                    out.push_back(c);
+        }
+    }
+
+    bool slang_bindings_build(
+        const void* vs_code,
+        const void* ps_code,
+        const pass_semantics_t& sem,
+        const semantics_map_t* map,
+        const video_shader* shader,
+        unsigned pass,
+        slang_pass_bindings& out)
+    {
+        memset(&out, 0, sizeof(out));
+        out.source_stage = -1;
+
+        if (!vs_code || !ps_code || !map || !shader)
+            return false;
+
+        ID3DXConstantTable* vct = nullptr;
+        ID3DXConstantTable* pct = nullptr;
+        if (FAILED(D3DXGetShaderConstantTable((const DWORD*)vs_code, &vct)) ||
+            FAILED(D3DXGetShaderConstantTable((const DWORD*)ps_code, &pct)))
+        {
+            if (vct) vct->Release();
+            return false;
+        }
+
+        // Same coverage and order as the constant-table path:
+        // gl_HalfPixel, MVP, then UBO/push constants per stage.
+        const cbuffer_sem_t& ubo = sem.cbuffers[SLANG_CBUFFER_UBO];
+        const cbuffer_sem_t& pc = sem.cbuffers[SLANG_CBUFFER_PC];
+        const uint32_t VS_MASK = SLANG_STAGE_VERTEX_MASK;
+        const uint32_t PS_MASK = SLANG_STAGE_FRAGMENT_MASK;
+
+        std::vector<slang_refl_uniform> vs, ps;
+        std::vector<slang_refl_const> ps_all;
+        bool ok = true;
+
+        if (D3DXHANDLE h = vct->GetConstantByName(nullptr, "gl_HalfPixel"))
+            ok = zm_bind_add_uniform(vs, vct, h, ZM_SLOT_HALFPIXEL << 16, sizeof(float) * 4);
+
+        D3DXHANDLE hm = vct->GetConstantByName(nullptr, "global_MVP");
+        if (!hm) hm = vct->GetConstantByName(nullptr, "MVP");
+        if (!hm) hm = vct->GetConstantByName(nullptr, "params_MVP");
+        if (ok && hm)
+            ok = zm_bind_add_uniform(vs, vct, hm, ZM_SLOT_IDENTITY << 16, sizeof(float) * 16);
+
+        if (ok && (ubo.stage_mask & VS_MASK)) ok = zm_bind_add_cbuffer(vs, vct, ubo, map, shader, pass, "VS");
+        if (ok && (pc.stage_mask & VS_MASK))  ok = zm_bind_add_cbuffer(vs, vct, pc, map, shader, pass, "VS");
+        if (ok && (ubo.stage_mask & PS_MASK)) ok = zm_bind_add_cbuffer(ps, pct, ubo, map, shader, pass, "PS");
+        if (ok && (pc.stage_mask & PS_MASK))  ok = zm_bind_add_cbuffer(ps, pct, pc, map, shader, pass, "PS");
+
+        // Names point into the tables, so the build runs before they go
+        zm_bind_all(pct, ps_all);
+        const bool packed = slang_bind_table_build(
+            vs.data(), (unsigned)vs.size(), ps.data(), (unsigned)ps.size(),
+            ps_all.data(), (unsigned)ps_all.size(), out);
+        if (!ok && packed) {
+            out.num_vs = out.num_ps = 0;
+            out.vs_lo = out.vs_hi = out.ps_lo = out.ps_hi = 0;
+            out.consts_packed = 0;
+        }
+        ok = ok && packed;
+
+        vct->Release();
+        pct->Release();
+
+        if (ok) {
+            zm_bind_dbgf("[ZeroMod] pass%u: bindings vs=%u ops c%u..c%u ps=%u ops c%u..c%u samplers=%u\n", pass,
+                out.num_vs, (unsigned)out.vs_lo, (unsigned)out.vs_hi,
+                out.num_ps, (unsigned)out.ps_lo, (unsigned)out.ps_hi, out.num_samplers);
+        }
+        else {
+            zm_bind_dbgf("[ZeroMod] pass%u: constants not float4-packable, using constant table path\n", pass);
+        }
+        return true;
+    }
+
+    uint8_t slang_sampler_resolve_pass(
+        const char* name,
+        uint8_t kind,
+        const video_shader* shader,
+        unsigned num_passes)
+    {
+        if (!name || !shader || (kind != ZM_SAMP_ALIAS && kind != ZM_SAMP_FEEDBACK))
+            return 0xFF;
+
+        unsigned n = 0;
+        if (slang_name_index(name, kind == ZM_SAMP_ALIAS ? "PassOutput" : "PassFeedback", n))
+            return (n < num_passes && n < 0xFF) ? (uint8_t)n : 0xFF;
+
+        // <alias> / <alias>Feedback
+        size_t len = strlen(name);
+        if (kind == ZM_SAMP_FEEDBACK)
+            len -= sizeof("Feedback") - 1;
+
+        for (unsigned j = 0; j < num_passes && j < 0xFF; ++j)
+        {
+            const char* a = shader->pass[j].alias;
+            if (a && a[0] && strlen(a) == len && strncmp(a, name, len) == 0)
+                return (uint8_t)j;
+        }
+        return 0xFF;
+    }
+
+    uint8_t slang_sampler_resolve_lut(const char* name, const video_shader* shader)
+    {
+        if (!name || !shader)
+            return 0xFF;
+
+        for (unsigned j = 0; j < shader->luts && j < GFX_MAX_TEXTURES; ++j)
+            if (strcmp(shader->lut[j].id, name) == 0)
+                return (uint8_t)j;
+        return 0xFF;
+    }
+
+    void slang_bindings_resolve_aliases(
+        slang_pass_bindings& b,
+        const video_shader* shader,
+        unsigned num_passes)
+    {
+        for (uint32_t i = 0; i < b.num_samplers; ++i)
+        {
+            slang_sampler_bind& s = b.samplers[i];
+            s.name[sizeof(s.name) - 1] = '\0';
+            if (s.kind == ZM_SAMP_LUT) {
+                s.kind = ZM_SAMP_ALIAS;
+                s.index = 0;
+            }
+            s.pass = slang_sampler_resolve_pass(s.name, s.kind, shader, num_passes);
+
+            // Pass aliases win over LUT ids, as in slang_process
+            if (s.kind == ZM_SAMP_ALIAS && s.pass == 0xFF) {
+                const uint8_t lut = slang_sampler_resolve_lut(s.name, shader);
+                if (lut != 0xFF) {
+                    s.kind = ZM_SAMP_LUT;
+                    s.index = lut;
+                }
+            }
+        }
+    }
+
+} // namespace ZeroMod
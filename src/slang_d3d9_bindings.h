@@ -0,0 +1,60 @@
+#pragma once
+#include <d3d9.h>
+#include <d3dx9shader.h>
+#include <stdint.h>
+#include "../retroarch/retroarch/gfx/video_shader_parse.h"
+#include "../retroarch/retroarch/gfx/drivers_shader/slang_process.h"
+#include "slang_bind_table.h"
+
+// ---- Binding tables from D3DX reflection ----
+// Builds the slang_bind_table.h tables from the constant tables embedded in
+// a pass' bytecode, and encodes uniform pointers as slots.
+
+namespace ZeroMod {
+
+    // Pointer <-> slot for map/parameter-backed uniforms. Parameters match by address.
+    bool slang_slot_encode(
+        const void* data,
+        const semantics_map_t* map,
+        const video_shader* shader,
+        uint32_t& slot);
+
+    // Map/parameter kinds only; HALFPIXEL/IDENTITY belong to the runtime.
+    bool slang_slot_decode(
+        uint32_t slot,
+        const semantics_map_t* map,
+        video_shader* shader,
+        void*& data);
+
+    // Name lookup with the SPIRV-Cross prefixes (params_, global_, registers_, Push. ...)
+    D3DXHANDLE slang_find_ct_handle(ID3DXConstantTable* ct, const char* id);
+
+    // Device-free: reads the constant tables embedded in the bytecode and
+    // hands them to slang_bind_table_build.
+    bool slang_bindings_build(
+        const void* vs_code,
+        const void* ps_code,
+        const pass_semantics_t& sem,
+        const semantics_map_t* map,
+        const video_shader* shader,
+        unsigned pass,
+        slang_pass_bindings& out);
+
+    // ALIAS/FEEDBACK sampler name -> pass index, 0xFF if nothing matches.
+    uint8_t slang_sampler_resolve_pass(
+        const char* name,
+        uint8_t kind,
+        const video_shader* shader,
+        unsigned num_passes);
+
+    // Sampler name -> shader->lut index, 0xFF if no LUT has that id.
+    uint8_t slang_sampler_resolve_lut(const char* name, const video_shader* shader);
+
+    // Alias/feedback samplers -> pass index. Aliases are only final once every pass is prepared.
+    // An alias no pass has that names a LUT becomes ZM_SAMP_LUT.
+    void slang_bindings_resolve_aliases(
+        slang_pass_bindings& b,
+        const video_shader* shader,
+        unsigned num_passes);
+
+} // namespace ZeroMod
@@ -0,0 +1,356 @@
+#include "slang_d3d9_cache.h"
+#include "slang_d3d9_bindings.h"
+#include "slang_cache_format.h"
+#include "slang_pass_meta.h"
+
+#include <windows.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <vector>
+
+namespace ZeroMod {
+
+    static void zm_sc_dbgf(const char* fmt, ...)
+    {
+        char b[512];
+        va_list va;
+        va_start(va, fmt);
+        _vsnprintf(b, sizeof(b), fmt, va);
+        va_end(va);
+        b[sizeof(b) - 1] = '\0';
+        OutputDebugStringA(b);
+    }
+
+    static void zm_sc_path(const uint64_t key[2], char* out, size_t n)
+    {
+        char name[64];
+        scf_file_name(key, name, sizeof(name));
+        _snprintf(out, n, "%s\\%s", ZM_SLANG_CACHE_DIR, name);
+        out[n - 1] = '\0';
+    }
+
+    void slang_cache_entry_free(slang_cache_entry& e)
+    {
+        if (e.hlsl_vs) { free(e.hlsl_vs); e.hlsl_vs = nullptr; }
+        if (e.hlsl_ps) { free(e.hlsl_ps); e.hlsl_ps = nullptr; }
+        if (e.vs_code) { free(e.vs_code); e.vs_code = nullptr; }
+        if (e.ps_code) { free(e.ps_code); e.ps_code = nullptr; }
+        e.vs_size = 0;
+        e.ps_size = 0;
+
+        for (int c = 0; c < SLANG_CBUFFER_MAX; ++c) {
+            if (e.sem.cbuffers[c].uniforms) {
+                free(e.sem.cbuffers[c].uniforms);
+                e.sem.cbuffers[c].uniforms = nullptr;
+            }
+        }
+        e.sem = {};
+        e.alias[0] = '\0';
+
+        if (e.bind) { free(e.bind); e.bind = nullptr; }
+    }
+
+    bool slang_sem_rebind(
+        pass_semantics_t& sem,
+        const semantics_map_t* from_map,
+        const video_shader* from_shader,
+        const semantics_map_t* to_map,
+        video_shader* to_shader)
+    {
+        if (!from_map || !from_shader || !to_map || !to_shader)
+            return false;
+
+        for (int c = 0; c < SLANG_CBUFFER_MAX; ++c)
+        {
+            cbuffer_sem_t& cb = sem.cbuffers[c];
+            if (!cb.uniforms) continue;
+
+            for (int i = 0; i < cb.uniform_count; ++i)
+            {
+                uniform_sem_t& u = cb.uniforms[i];
+                uint32_t slot = 0;
+                if (!slang_slot_encode(u.data, from_map, from_shader, slot) ||
+                    !slang_slot_decode(slot, to_map, to_shader, u.data))
+                {
+                    zm_sc_dbgf("[ZeroMod] slang_sem_rebind: can't rebind '%s'\n", u.id);
+                    u.data = nullptr;
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool slang_cache_pass_key(
+        const video_shader* shader,
+        unsigned pass,
+        const std::string& expanded,
+        const char* vs_profile,
+        const char* ps_profile,
+        DWORD compile_flags,
+        uint64_t out_key[2],
+        zm_spm* meta)
+    {
+        if (!shader || pass >= shader->passes || !out_key)
+            return false;
+
+        zm_spm own;
+        if (!spm_parse(expanded.data(), expanded.size(), own))
+            return false;
+
+        const char* aliases[GFX_MAX_SHADERS];
+        const char* lut_ids[GFX_MAX_TEXTURES];
+        zm_sc_key_in in = {};
+        in.vs_profile = vs_profile;
+        in.ps_profile = ps_profile;
+        in.compile_flags = (uint32_t)compile_flags;
+        in.pass = pass;
+        in.num_passes = shader->passes;
+        in.num_aliases = shader->passes < GFX_MAX_SHADERS ? shader->passes : GFX_MAX_SHADERS;
+        for (unsigned i = 0; i < in.num_aliases; ++i)
+            aliases[i] = shader->pass[i].alias;
+        in.aliases = aliases;
+        in.num_luts = shader->luts < GFX_MAX_TEXTURES ? shader->luts : GFX_MAX_TEXTURES;
+        for (unsigned i = 0; i < in.num_luts; ++i)
+            lut_ids[i] = shader->lut[i].id;
+        in.lut_ids = lut_ids;
+
+        scf_pass_key(expanded, own, in, out_key);
+        if (meta)
+            *meta = std::move(own);
+        return true;
+    }
+
+    static int zm_sc_find_param(const video_shader* shader, const char* id)
+    {
+        unsigned params = shader->num_parameters < GFX_MAX_PARAMETERS ? shader->num_parameters : GFX_MAX_PARAMETERS;
+        for (unsigned i = 0; i < params; ++i)
+            if (strcmp(shader->parameters[i].id, id) == 0)
+                return (int)i;
+        return -1;
+    }
+
+    // Parameter slots were stored with the writer's list index; point them
+    // at this shader's entry of the same id
+    static bool zm_sc_remap_ops(slang_const_op* ops, uint32_t num, const int* remap)
+    {
+        for (uint32_t i = 0; i < num; ++i)
+        {
+            if ((ops[i].source >> 16) != ZM_SLOT_PARAM)
+                continue;
+            const uint32_t old = ops[i].source & 0xFFFF;
+            if (old >= GFX_MAX_PARAMETERS || remap[old] < 0)
+                return false;
+            ops[i].source = (ZM_SLOT_PARAM << 16) | (uint32_t)remap[old];
+        }
+        return true;
+    }
+
+    bool slang_cache_load(
+        const uint64_t key[2],
+        const semantics_map_t* map,
+        video_shader* shader,
+        slang_cache_entry& out)
+    {
+        if (!key || !map || !shader)
+            return false;
+
+        char path[MAX_PATH];
+        zm_sc_path(key, path, sizeof(path));
+
+        FILE* f = nullptr;
+        fopen_s(&f, path, "rb");
+        if (!f)
+            return false;
+
+        zm_sc_header h{};
+        std::vector<uint8_t> payload;
+        bool ok = fread(&h, sizeof(h), 1, f) == 1 && scf_header_ok(h, key);
+        if (ok) {
+            payload.resize(h.payload_size);
+            ok = fread(payload.data(), 1, payload.size(), f) == payload.size();
+        }
+        fclose(f);
+
+        ok = ok && scf_payload_ok(h, payload.data(), payload.size());
+        if (!ok) {
+            zm_sc_dbgf("[ZeroMod] slang_cache: corrupt entry '%s' (ignored)\n", path);
+            return false;
+        }
+
+        slang_cache_entry_free(out);
+
+        // writer's parameter index -> ours
+        std::vector<int> remap(GFX_MAX_PARAMETERS, -1);
+
+        zm_sc_reader r{ payload.data(), payload.data() + payload.size() };
+        ok = scf_get_code(r, out.alias, out.hlsl_vs, out.hlsl_ps,
+            out.vs_code, out.vs_size, out.ps_code, out.ps_size);
+
+        for (int c = 0; ok && c < SLANG_CBUFFER_MAX; ++c)
+        {
+            cbuffer_sem_t& cb = out.sem.cbuffers[c];
+            uint32_t stage_mask = 0, binding = 0, size = 0, count = 0;
+
+            ok = r.get_u32(stage_mask) && r.get_u32(binding) &&
+                r.get_u32(size) && r.get_u32(count) && count < 4096;
+            if (!ok) break;
+
+            cb.stage_mask = stage_mask;
+            cb.binding = binding;
+            cb.size = size;
+            cb.uniform_count = (int)count;
+            if (!count) continue;
+
+            cb.uniforms = (uniform_sem_t*)calloc(count, sizeof(uniform_sem_t));
+            ok = cb.uniforms != nullptr;
+
+            for (uint32_t i = 0; ok && i < count; ++i)
+            {
+                uniform_sem_t& u = cb.uniforms[i];
+                uint32_t usize = 0, uoffset = 0, slot = 0;
+
+                ok = r.get(u.id, sizeof(u.id)) &&
+                    r.get_u32(usize) && r.get_u32(uoffset) && r.get_u32(slot);
+                u.id[sizeof(u.id) - 1] = '\0';
+
+                // A parameter uniform is named after the parameter
+                if (ok && (slot >> 16) == ZM_SLOT_PARAM) {
+                    const uint32_t old = slot & 0xFFFF;
+                    const int now = zm_sc_find_param(shader, u.id);
+                    ok = old < GFX_MAX_PARAMETERS && now >= 0;
+                    if (ok) {
+                        remap[old] = now;
+                        slot = (ZM_SLOT_PARAM << 16) | (uint32_t)now;
+                    }
+                }
+                ok = ok && slang_slot_decode(slot, map, shader, u.data);
+
+                u.size = usize;
+                u.offset = uoffset;
+            }
+        }
+
+        // binding table: raw POD, 0 bytes if the pass had none
+        if (ok) {
+            void* bind = nullptr;
+            uint32_t bind_n = 0;
+            ok = r.get_blob(bind, bind_n);
+            if (ok && bind_n) {
+                ok = bind_n == sizeof(slang_pass_bindings) &&
+                    slang_bindings_validate(*(const slang_pass_bindings*)bind);
+                if (ok) {
+                    // Rebuilt from the bytecode if a parameter can't be placed
+                    slang_pass_bindings* t = (slang_pass_bindings*)bind;
+                    if (zm_sc_remap_ops(t->vs, t->num_vs, remap.data()) &&
+                        zm_sc_remap_ops(t->ps, t->num_ps, remap.data()))
+                        out.bind = t;
+                    else
+                        free(bind);
+                }
+                else free(bind);
+            }
+            else if (bind) {
+                free(bind);
+            }
+        }
+
+        if (!ok || !out.hlsl_vs || !out.hlsl_ps || !out.vs_size || !out.ps_size) {
+            zm_sc_dbgf("[ZeroMod] slang_cache: bad payload '%s' (ignored)\n", path);
+            slang_cache_entry_free(out);
+            return false;
+        }
+
+        return true;
+    }
+
+    bool slang_cache_store(
+        const uint64_t key[2],
+        const semantics_map_t* map,
+        const video_shader* shader,
+        const char* alias,
+        const char* hlsl_vs,
+        const char* hlsl_ps,
+        const void* vs_code, uint32_t vs_size,
+        const void* ps_code, uint32_t ps_size,
+        const pass_semantics_t& sem,
+        const slang_pass_bindings* bind)
+    {
+        if (!key || !map || !shader || !hlsl_vs || !hlsl_ps ||
+            !vs_code || !vs_size || !ps_code || !ps_size)
+            return false;
+
+        std::vector<uint8_t> b;
+        b.reserve(strlen(hlsl_vs) + strlen(hlsl_ps) + vs_size + ps_size + 4096);
+
+        scf_put_code(b, alias, hlsl_vs, hlsl_ps, vs_code, vs_size, ps_code, ps_size);
+
+        for (int c = 0; c < SLANG_CBUFFER_MAX; ++c)
+        {
+            const cbuffer_sem_t& cb = sem.cbuffers[c];
+            const uint32_t count = (cb.uniforms && cb.uniform_count > 0) ? (uint32_t)cb.uniform_count : 0;
+
+            scf_put_u32(b, cb.stage_mask);
+            scf_put_u32(b, cb.binding);
+            scf_put_u32(b, cb.size);
+            scf_put_u32(b, count);
+
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const uniform_sem_t& u = cb.uniforms[i];
+                uint32_t slot = 0;
+                if (!slang_slot_encode(u.data, map, shader, slot)) {
+                    zm_sc_dbgf("[ZeroMod] slang_cache: uniform '%s' has unknown backing, not caching pass\n", u.id);
+                    return false;
+                }
+
+                char id[sizeof(u.id)] = {};
+                strncpy(id, u.id, sizeof(id) - 1);
+                scf_put_bytes(b, id, sizeof(id));
+                scf_put_u32(b, (uint32_t)u.size);
+                scf_put_u32(b, (uint32_t)u.offset);
+                scf_put_u32(b, slot);
+            }
+        }
+
+        // alias pass indices are per preset; resolve_aliases redoes them on load
+        if (bind) scf_put_blob(b, bind, sizeof(*bind));
+        else      scf_put_u32(b, 0);
+
+        zm_sc_header h;
+        scf_header(key, b, h);
+
+        CreateDirectoryA(ZM_SLANG_CACHE_DIR, nullptr);
+
+        char path[MAX_PATH];
+        char tmp[MAX_PATH];
+        zm_sc_path(key, path, sizeof(path));
+        _snprintf(tmp, sizeof(tmp), "%s.%lu.tmp", path, (unsigned long)GetCurrentThreadId());
+        tmp[sizeof(tmp) - 1] = '\0';
+
+        FILE* f = nullptr;
+        fopen_s(&f, tmp, "wb");
+        if (!f) {
+            zm_sc_dbgf("[ZeroMod] slang_cache: can't write '%s'\n", tmp);
+            return false;
+        }
+
+        bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+            fwrite(b.data(), 1, b.size(), f) == b.size();
+        ok = (fclose(f) == 0) && ok;
+
+        // write-then-rename so a crash never leaves a half entry under the real name
+        if (!ok || !MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING)) {
+            DeleteFileA(tmp);
+            zm_sc_dbgf("[ZeroMod] slang_cache: store FAILED '%s'\n", path);
+            return false;
+        }
+
+        zm_sc_dbgf("[ZeroMod] slang_cache: stored '%s' (%u bytes)\n", path, (unsigned)(sizeof(h) + b.size()));
+        return true;
+    }
+
+} // namespace ZeroMod
@@ -0,0 +1,89 @@
+#pragma once
+#include <d3d9.h>
+#include <stdint.h>
+#include "../retroarch/retroarch/gfx/video_shader_parse.h"
+#include "../retroarch/retroarch/gfx/drivers_shader/slang_process.h"
+#include "slang_d3d9_bindings.h"
+#include "slang_pass_meta.h"
+
+// ---- Persistent slang pass cache ----
+// Warm preset loads skip glslang -> SPIRV-Cross -> D3DXCompileShader entirely.
+// Set to 0 to always run the full compiler pipeline.
+#define ZM_SLANG_DISK_CACHE 1
+
+// Relative to the game dir, same as filter-mod.ini / filter-mod.log
+#define ZM_SLANG_CACHE_DIR "filter-mod-cache"
+
+namespace ZeroMod {
+
+    // Everything a pass needs to skip the compiler. The constant tables live
+    // inside the bytecode (CTAB comment), so D3DXGetShaderConstantTable
+    // rebuilds them on load. Also used as the in-memory "prepared pass"
+    // handed from the compile stage to device-object creation.
+    struct slang_cache_entry
+    {
+        char* hlsl_vs = nullptr;
+        char* hlsl_ps = nullptr;
+
+        void* vs_code = nullptr;
+        uint32_t vs_size = 0;
+        void* ps_code = nullptr;
+        uint32_t ps_size = 0;
+
+        char alias[64] = {};
+        pass_semantics_t sem = {};  // uniform data pointers resolved against the map on load
+
+        slang_pass_bindings* bind = nullptr;  // malloc'd; null if the table couldn't be built
+    };
+
+    void slang_cache_entry_free(slang_cache_entry& e);
+
+    // Re-point uniform data pointers from one map/shader pair to another
+    // (e.g. worker staging -> live runtime). Parameters match by address.
+    bool slang_sem_rebind(
+        pass_semantics_t& sem,
+        const semantics_map_t* from_map,
+        const video_shader* from_shader,
+        const semantics_map_t* to_map,
+        video_shader* to_shader);
+
+    // Content key: 'expanded', the pass' include-expanded source (see
+    // slang_d3d9_pass_sources), + its own #pragma parameters + pass index,
+    // aliases and LUT ids + profiles + compile flags + format version.
+    // Nothing that depends on the order passes were prepared in. 'meta', if
+    // given, gets the pass' pragmas. False on a malformed #pragma parameter.
+    bool slang_cache_pass_key(
+        const video_shader* shader,
+        unsigned pass,
+        const std::string& expanded,
+        const char* vs_profile,
+        const char* ps_profile,
+        DWORD compile_flags,
+        uint64_t out_key[2],
+        zm_spm* meta = nullptr);
+
+    // Load + rebind uniform pointers against 'map'/'shader'. Parameter
+    // uniforms are found by id, so they have to be registered in 'shader'
+    // already. False on miss or corrupt file.
+    bool slang_cache_load(
+        const uint64_t key[2],
+        const semantics_map_t* map,
+        video_shader* shader,
+        slang_cache_entry& out);
+
+    // Store a freshly compiled pass. Uniform pointers in 'sem' are encoded
+    // as map/parameter slots; a pass with a pointer we can't encode is not cached.
+    // The binding table is stored verbatim.
+    bool slang_cache_store(
+        const uint64_t key[2],
+        const semantics_map_t* map,
+        const video_shader* shader,
+        const char* alias,
+        const char* hlsl_vs,
+        const char* hlsl_ps,
+        const void* vs_code, uint32_t vs_size,
+        const void* ps_code, uint32_t ps_size,
+        const pass_semantics_t& sem,
+        const slang_pass_bindings* bind);
+
+} // namespace ZeroMod
@@ -0,0 +1,341 @@
+#include "slang_d3d9_lut.h"
+#include "lut_mips.h"
+#include "main.h"
+#include "../smhasher/MurmurHash3.h"
+
+#include "../RetroArch/RetroArch/libretro-common/include/formats/image.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <vector>
+
+namespace ZeroMod {
+
+    struct zm_lut_entry
+    {
+        uint64_t key[2];
+        IDirect3DDevice9* dev;
+        IDirect3DTexture9* tex;
+        unsigned refs;          // chains holding it
+    };
+
+    // Every chain's LUTs. Entries are added and released on the render
+    // thread; decode workers only look keys up.
+    static std::vector<zm_lut_entry> zm_lut_cache;
+    static cs_wrapper zm_lut_cache_cs;
+
+    static void zm_lut_dbgf(const char* fmt, ...)
+    {
+        char b[768];
+        va_list va;
+        va_start(va, fmt);
+        _vsnprintf(b, sizeof(b), fmt, va);
+        va_end(va);
+        b[sizeof(b) - 1] = '\0';
+        OutputDebugStringA(b);
+    }
+
+    static bool zm_lut_read(const char* path, std::vector<uint8_t>& out)
+    {
+        FILE* f = nullptr;
+        fopen_s(&f, path, "rb");
+        if (!f)
+            return false;
+
+        bool ok = fseek(f, 0, SEEK_END) == 0;
+        const long size = ok ? ftell(f) : -1;
+        ok = size > 0 && fseek(f, 0, SEEK_SET) == 0;
+        if (ok) {
+            out.resize((size_t)size);
+            ok = fread(out.data(), 1, out.size(), f) == out.size();
+        }
+        fclose(f);
+        return ok;
+    }
+
+    static bool zm_lut_cached(const uint64_t key[2])
+    {
+        bool found = false;
+        zm_lut_cache_cs.begin_cs();
+        for (const zm_lut_entry& e : zm_lut_cache)
+            if (e.key[0] == key[0] && e.key[1] == key[1]) { found = true; break; }
+        zm_lut_cache_cs.end_cs();
+        return found;
+    }
+
+    // New reference to the device's texture for 'key', null if there is none
+    static IDirect3DTexture9* zm_lut_acquire(IDirect3DDevice9* dev, const uint64_t key[2])
+    {
+        IDirect3DTexture9* tex = nullptr;
+        zm_lut_cache_cs.begin_cs();
+        for (zm_lut_entry& e : zm_lut_cache)
+        {
+            if (e.dev == dev && e.key[0] == key[0] && e.key[1] == key[1]) {
+                e.refs++;
+                tex = e.tex;
+                break;
+            }
+        }
+        zm_lut_cache_cs.end_cs();
+        return tex;
+    }
+
+    // Reads and hashes one LUT, then decodes it unless 'skip_cached' and the
+    // cache already has that key
+    static bool zm_lut_decode_one(const video_shader_lut& lut, slang_lut_image& img, bool skip_cached)
+    {
+        std::vector<uint8_t> bytes;
+        if (!zm_lut_read(lut.path, bytes)) {
+            zm_lut_dbgf("[ZeroMod] slang_lut: can't read '%s'\n", lut.path);
+            return false;
+        }
+
+        // Same image, different mip chain: a different texture
+        MurmurHash3_x64_128(bytes.data(), (int)bytes.size(), lut.mipmap ? 1 : 0, img.key);
+        if (skip_cached && zm_lut_cached(img.key))
+            return true;
+
+        texture_image ti = {};
+        ti.supports_rgba = false;   // 0xAARRGGBB, what A8R8G8B8 wants
+        if (!image_texture_load_buffer(&ti, image_texture_get_type(lut.path), bytes.data(), bytes.size()) ||
+            !ti.pixels || !ti.width || !ti.height)
+        {
+            zm_lut_dbgf("[ZeroMod] slang_lut: can't decode '%s'\n", lut.path);
+            image_texture_free(&ti);
+            return false;
+        }
+
+        img.w = ti.width;
+        img.h = ti.height;
+        img.levels = lut.mipmap ? lm_level_count(img.w, img.h) : 1;
+        img.pixels = (uint32_t*)malloc(lm_chain_pixels(img.w, img.h, img.levels) * sizeof(uint32_t));
+        if (img.pixels) {
+            memcpy(img.pixels, ti.pixels, (size_t)img.w * img.h * sizeof(uint32_t));
+            lm_build_chain(img.pixels, img.w, img.h, img.levels);
+        }
+        image_texture_free(&ti);
+        return img.pixels != nullptr;
+    }
+
+    struct zm_lut_batch
+    {
+        const video_shader* shader;
+        slang_lut_set* out;
+        const std::atomic<int>* cancel;
+
+        volatile LONG next;
+        volatile LONG failed;
+    };
+
+    static DWORD WINAPI zm_lut_worker(LPVOID param)
+    {
+        zm_lut_batch* b = (zm_lut_batch*)param;
+
+        for (;;)
+        {
+            if (InterlockedCompareExchange(&b->failed, 0, 0))
+                break;
+            if (b->cancel && b->cancel->load()) {
+                InterlockedExchange(&b->failed, 1);
+                break;
+            }
+
+            const LONG i = InterlockedIncrement(&b->next) - 1;
+            if (i >= (LONG)b->out->count)
+                break;
+
+            if (!zm_lut_decode_one(b->shader->lut[i], b->out->img[i], true))
+                InterlockedExchange(&b->failed, 1);
+        }
+        return 0;
+    }
+
+    bool slang_lut_decode(
+        const video_shader* shader,
+        slang_lut_set& out,
+        const std::atomic<int>* cancel)
+    {
+        memset(&out, 0, sizeof(out));
+        if (!shader)
+            return false;
+
+        out.count = shader->luts < GFX_MAX_TEXTURES ? shader->luts : GFX_MAX_TEXTURES;
+        if (out.count == 0)
+            return true;
+
+        zm_lut_batch b = {};
+        b.shader = shader;
+        b.out = &out;
+        b.cancel = cancel;
+
+        SYSTEM_INFO si = {};
+        GetSystemInfo(&si);
+        unsigned workers = (unsigned)si.dwNumberOfProcessors;
+        if (workers > ZM_SLANG_LUT_THREADS) workers = ZM_SLANG_LUT_THREADS;
+        if (workers > out.count) workers = out.count;
+        if (workers < 1) workers = 1;
+
+        LARGE_INTEGER t0, t1, f;
+        QueryPerformanceCounter(&t0);
+
+        // The calling thread is worker 0, as in slang_d3d9_prepare_passes
+        HANDLE threads[ZM_SLANG_LUT_THREADS] = {};
+        DWORD spawned = 0;
+        for (unsigned w = 1; w < workers; ++w)
+        {
+            HANDLE h = CreateThread(NULL, 0, zm_lut_worker, &b, 0, NULL);
+            if (h) threads[spawned++] = h;
+        }
+
+        zm_lut_worker(&b);
+
+        if (spawned) {
+            WaitForMultipleObjects(spawned, threads, TRUE, INFINITE);
+            for (DWORD w = 0; w < spawned; ++w)
+                CloseHandle(threads[w]);
+        }
+
+        unsigned decoded = 0;
+        for (unsigned i = 0; i < out.count; ++i)
+            decoded += out.img[i].pixels != nullptr;
+
+        QueryPerformanceCounter(&t1);
+        QueryPerformanceFrequency(&f);
+        zm_lut_dbgf("[ZeroMod] slang_lut_decode: %u LUTs (%u decoded, %u cached) on %lu threads in %.2f ms%s\n",
+            out.count, decoded, out.count - decoded, (unsigned long)(spawned + 1),
+            (double)(t1.QuadPart - t0.QuadPart) * 1000.0 / (double)f.QuadPart,
+            b.failed ? " (FAILED)" : "");
+
+        if (b.failed) {
+            slang_lut_set_free(out);
+            return false;
+        }
+        return true;
+    }
+
+    void slang_lut_set_free(slang_lut_set& set)
+    {
+        for (unsigned i = 0; i < set.count; ++i)
+        {
+            free(set.img[i].pixels);
+            set.img[i].pixels = nullptr;
+        }
+    }
+
+    // Managed pool, so a device reset doesn't take the LUTs with it
+    static IDirect3DTexture9* zm_lut_create(IDirect3DDevice9* dev, const slang_lut_image& img)
+    {
+        IDirect3DTexture9* tex = nullptr;
+        if (FAILED(dev->CreateTexture(img.w, img.h, img.levels, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &tex, NULL)))
+            return nullptr;
+
+        const uint32_t* src = img.pixels;
+        UINT w = img.w, h = img.h;
+        for (unsigned l = 0; l < img.levels; ++l)
+        {
+            D3DLOCKED_RECT lr;
+            if (FAILED(tex->LockRect(l, &lr, NULL, 0))) {
+                tex->Release();
+                return nullptr;
+            }
+            for (UINT y = 0; y < h; ++y)
+                memcpy((uint8_t*)lr.pBits + (size_t)y * lr.Pitch, src + (size_t)y * w, w * sizeof(uint32_t));
+            tex->UnlockRect(l);
+
+            src += (size_t)w * h;
+            w = w > 1 ? w / 2 : 1;
+            h = h > 1 ? h / 2 : 1;
+        }
+
+        zm_lut_entry e = {};
+        e.key[0] = img.key[0];
+        e.key[1] = img.key[1];
+        e.dev = dev;
+        e.tex = tex;
+        e.refs = 1;
+        zm_lut_cache_cs.begin_cs();
+        zm_lut_cache.push_back(e);
+        zm_lut_cache_cs.end_cs();
+        return tex;
+    }
+
+    bool slang_lut_upload(
+        IDirect3DDevice9* dev,
+        const video_shader* shader,
+        slang_lut_set& set,
+        IDirect3DTexture9** tex)
+    {
+        if (!dev || !shader || !tex)
+            return false;
+
+        bool ok = true;
+        unsigned held = 0;
+        for (unsigned i = 0; ok && i < set.count; ++i)
+        {
+            slang_lut_image& img = set.img[i];
+            const video_shader_lut& lut = shader->lut[i];
+
+            // Also catches a LUT listed twice in one preset
+            IDirect3DTexture9* t = zm_lut_acquire(dev, img.key);
+            const bool shared = t != nullptr;
+
+            // The chains that had it were freed after the decode looked
+            if (!t && !img.pixels)
+                ok = zm_lut_decode_one(lut, img, false);
+            if (ok && !t)
+                t = zm_lut_create(dev, img);
+
+            free(img.pixels);
+            img.pixels = nullptr;
+
+            if (!t) {
+                zm_lut_dbgf("[ZeroMod] slang_lut: '%s' (%s) FAILED\n", lut.id, lut.path);
+                ok = false;
+                break;
+            }
+            tex[held++] = t;
+
+            D3DSURFACE_DESC d = {};
+            t->GetLevelDesc(0, &d);
+            zm_lut_dbgf("[ZeroMod] slang_lut: '%s' %ux%u levels=%lu %s\n",
+                lut.id, (unsigned)d.Width, (unsigned)d.Height, (unsigned long)t->GetLevelCount(),
+                shared ? "shared" : "created");
+        }
+
+        slang_lut_set_free(set);
+        if (!ok) {
+            while (held)
+                slang_lut_release(tex[--held]);
+            return false;
+        }
+        return true;
+    }
+
+    void slang_lut_release(IDirect3DTexture9* tex)
+    {
+        if (!tex)
+            return;
+
+        IDirect3DTexture9* last = nullptr;
+        zm_lut_cache_cs.begin_cs();
+        for (size_t i = 0; i < zm_lut_cache.size(); ++i)
+        {
+            zm_lut_entry& e = zm_lut_cache[i];
+            if (e.tex != tex)
+                continue;
+            if (--e.refs == 0) {
+                last = e.tex;
+                zm_lut_cache.erase(zm_lut_cache.begin() + i);
+            }
+            break;
+        }
+        zm_lut_cache_cs.end_cs();
+
+        if (last)
+            last->Release();
+    }
+
+} // namespace ZeroMod
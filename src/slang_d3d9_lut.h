@@ -0,0 +1,61 @@
+#pragma once
+#include <windows.h>
+#include <d3d9.h>
+#include <stdint.h>
+#include <atomic>
+#include "../retroarch/retroarch/gfx/video_shader_parse.h"
+
+// ---- Slang LUT textures ----
+// The images a preset lists under textures = ... . slang_lut_decode reads
+// and decodes them with RetroArch's image loader (rpng / rjpeg / rtga /
+// rbmp) on up to ZM_SLANG_LUT_THREADS threads and builds the mip chain on
+// the CPU (lut_mips.h) for a LUT with mipmap set; it makes no device
+// calls, so the async compile worker runs it next to the pass builds.
+// slang_lut_upload then creates the textures on the render thread.
+//
+// Textures live in one refcounted cache shared by every chain (2D, GBA,
+// DS), keyed by a hash of the image file's bytes and the mipmap flag:
+// chains using the same LUT hold the same IDirect3DTexture9, and an image
+// the cache already has isn't decoded again.
+#define ZM_SLANG_LUT_THREADS 4
+
+namespace ZeroMod {
+
+    struct slang_lut_image
+    {
+        uint64_t key[2];
+        uint32_t w, h;
+        unsigned levels;
+        uint32_t* pixels;   // A8R8G8B8, levels back to back; null when the cache had the key
+    };
+
+    struct slang_lut_set
+    {
+        unsigned count;
+        slang_lut_image img[GFX_MAX_TEXTURES];
+    };
+
+    // Worker-safe. Reads, hashes and decodes shader->lut[0, luts). Stops
+    // early if *cancel becomes nonzero. All-or-nothing: on failure the set
+    // is freed.
+    bool slang_lut_decode(
+        const video_shader* shader,
+        slang_lut_set& out,
+        const std::atomic<int>* cancel);
+
+    // Frees pixels that weren't uploaded
+    void slang_lut_set_free(slang_lut_set& set);
+
+    // Render thread. tex[i] gets the texture for shader->lut[i], holding one
+    // cache reference each (give back with slang_lut_release); a LUT that
+    // left the cache since it was decoded is decoded again here. Pixels are
+    // freed as they go up. On failure nothing is held.
+    bool slang_lut_upload(
+        IDirect3DDevice9* dev,
+        const video_shader* shader,
+        slang_lut_set& set,
+        IDirect3DTexture9** tex);
+
+    void slang_lut_release(IDirect3DTexture9* tex);
+
+} // namespace ZeroMod
@@ -1,13 +1,21 @@
 #include "slang_d3d9_preset_load.h"
+#include "slang_preset_cache.h"
+#include "main.h"
 
 #include "../RetroArch/RetroArch/libretro-common/include/file/config_file.h"
+#include "../RetroArch/RetroArch/libretro-common/include/lists/string_list.h"
 
 #include "../retroarch/retroarch/gfx/video_shader_parse.h"
+#include "../retroarch/retroarch/gfx/drivers_shader/glslang_util.h"
 
 #include <string.h> // memset
 #include <stdio.h>
 #include <stdlib.h> 
 
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace ZeroMod {
 
     static const char* zm_wrap_to_str(enum gfx_wrap_type w)
@@ -140,78 +148,270 @@ namespace ZeroMod {
     }
 
 
-    static void d3d9_clear_parsed_preset(d3d9_video_struct* d3d9)
+    void slang_d3d9_free_parsed_shader(video_shader* shader)
     {
-        if (!d3d9)
+        if (!shader)
             return;
 
-        unsigned passes = d3d9->shader.passes;
+        unsigned passes = shader->passes;
         if (passes > GFX_MAX_SHADERS)
             passes = GFX_MAX_SHADERS;
 
         for (unsigned i = 0; i < passes; i++)
         {
-            free(d3d9->shader.pass[i].source.string.vertex);
-            free(d3d9->shader.pass[i].source.string.fragment);
-            d3d9->shader.pass[i].source.string.vertex = NULL;
-            d3d9->shader.pass[i].source.string.fragment = NULL;
+            free(shader->pass[i].source.string.vertex);
+            free(shader->pass[i].source.string.fragment);
+            shader->pass[i].source.string.vertex = NULL;
+            shader->pass[i].source.string.fragment = NULL;
         }
 
-        memset(&d3d9->shader, 0, sizeof(d3d9->shader));
-        d3d9->shader_preset = false;
+        memset(shader, 0, sizeof(*shader));
     }
 
-
-    bool slang_d3d9_load_preset_parse_only(d3d9_video_struct* d3d9)
+    // The bytes slang_cache_pass_key hashes for a pass file
+    static bool zm_expand_pass_source(const char* path, std::string& out)
     {
-#if defined(HAVE_SLANG)
-        if (!d3d9 || d3d9->magic != 0x39564433)
+        struct string_list* lines = string_list_new();
+        if (!lines)
             return false;
 
-        if (!d3d9->shader_is_path || !d3d9->shader_path || !*d3d9->shader_path)
+        const bool ok = glslang_read_shader_file(path, lines, true);
+        out.clear();
+        if (ok) {
+            for (size_t i = 0; i < lines->size; ++i) {
+                if (lines->elems[i].data)
+                    out += lines->elems[i].data;
+                out += '\n';
+            }
+        }
+        string_list_free(lines);
+        return ok;
+    }
+
+#if ZM_SLANG_PRESET_CACHE
+    // What a cache entry holds: the shader as slang_d3d9_parse_preset
+    // returns it, and each pass file's expanded source
+    struct zm_parsed_preset
+    {
+        video_shader shader;
+        std::vector<std::pair<std::string, std::string>> sources;
+    };
+
+    static zm_spc zm_preset_cache;
+    static cs_wrapper zm_preset_cache_cs;
+
+    static void zm_parsed_preset_free(void* value)
+    {
+        zm_parsed_preset* p = (zm_parsed_preset*)value;
+        slang_d3d9_free_parsed_shader(&p->shader);
+        delete p;
+    }
+
+    // The pass source strings are the only parts on the heap
+    static void zm_copy_parsed_shader(video_shader* dst, const video_shader* src)
+    {
+        memcpy(dst, src, sizeof(*dst));
+
+        unsigned passes = src->passes;
+        if (passes > GFX_MAX_SHADERS)
+            passes = GFX_MAX_SHADERS;
+
+        for (unsigned i = 0; i < passes; i++)
         {
-            d3d9->shader_reload_pending = false;
+            const video_shader_pass& sp = src->pass[i];
+            dst->pass[i].source.string.vertex = sp.source.string.vertex ? _strdup(sp.source.string.vertex) : NULL;
+            dst->pass[i].source.string.fragment = sp.source.string.fragment ? _strdup(sp.source.string.fragment) : NULL;
+        }
+    }
+
+    static void zm_cache_parsed_preset(const char* path, const video_shader* shader)
+    {
+        zm_parsed_preset* p = new zm_parsed_preset();
+        std::vector<std::string> files;
+        spc_add_preset_files(path, files);
+
+        unsigned passes = shader->passes;
+        if (passes > GFX_MAX_SHADERS)
+            passes = GFX_MAX_SHADERS;
+
+        for (unsigned i = 0; i < passes; i++)
+        {
+            const char* src = shader->pass[i].source.path;
+            if (!src[0])
+                continue;
+            spc_add_source_files(src, files);
+
+            std::string text;
+            if (zm_expand_pass_source(src, text))
+                p->sources.emplace_back(src, std::move(text));
+        }
+        zm_copy_parsed_shader(&p->shader, shader);
+
+        zm_preset_cache_cs.begin_cs();
+        const bool ok = spc_store(zm_preset_cache, path, files, p, zm_parsed_preset_free);
+        zm_preset_cache_cs.end_cs();
+
+        char b[512];
+        _snprintf(b, sizeof(b), ok
+            ? "[ZeroMod] slang preset cached: path='%s' files=%u\n"
+            : "[ZeroMod] slang preset not cached, a file can't be stat'ed: path='%s' files=%u\n",
+            path, (unsigned)files.size());
+        OutputDebugStringA(b);
+    }
+#endif
+
+    bool slang_d3d9_pass_sources(const char* preset, const video_shader* shader, slang_pass_sources& out)
+    {
+        if (!shader)
             return false;
+
+        unsigned passes = shader->passes;
+        if (passes > GFX_MAX_SHADERS)
+            passes = GFX_MAX_SHADERS;
+
+        for (unsigned i = 0; i < GFX_MAX_SHADERS; i++)
+        {
+            out.text[i].clear();
+            out.ok[i] = false;
         }
 
-        d3d9_clear_parsed_preset(d3d9);
+#if ZM_SLANG_PRESET_CACHE
+        // The lookup re-stats the preset's files, so a stale entry is
+        // dropped here rather than handing out old text
+        if (preset && *preset)
+        {
+            zm_preset_cache_cs.begin_cs();
+            const zm_parsed_preset* p = (const zm_parsed_preset*)spc_lookup(zm_preset_cache, preset);
+            for (unsigned i = 0; p && i < passes; i++)
+            {
+                for (const auto& s : p->sources) {
+                    if (s.first == shader->pass[i].source.path) {
+                        out.text[i] = s.second;
+                        out.ok[i] = true;
+                        break;
+                    }
+                }
+            }
+            zm_preset_cache_cs.end_cs();
+        }
+#else
+        (void)preset;
+#endif
+
+        bool ok = true;
+        for (unsigned i = 0; i < passes; i++)
+        {
+            const char* path = shader->pass[i].source.path;
+            if (!out.ok[i])
+                out.ok[i] = path[0] && zm_expand_pass_source(path, out.text[i]);
+            ok = ok && out.ok[i];
+        }
+        return ok;
+    }
+
+    static void d3d9_clear_parsed_preset(d3d9_video_struct* d3d9)
+    {
+        if (!d3d9)
+            return;
+
+        slang_d3d9_free_parsed_shader(&d3d9->shader);
+        d3d9->shader_preset = false;
+    }
+
+    bool slang_d3d9_parse_preset(const char* path, video_shader* out)
+    {
+#if defined(HAVE_SLANG)
+        if (!path || !*path || !out)
+            return false;
+
+        slang_d3d9_free_parsed_shader(out);
+
+#if ZM_SLANG_PRESET_CACHE
+        zm_preset_cache_cs.begin_cs();
+        const zm_parsed_preset* hit = (const zm_parsed_preset*)spc_lookup(zm_preset_cache, path);
+        if (hit)
+            zm_copy_parsed_shader(out, &hit->shader);
+        zm_preset_cache_cs.end_cs();
 
-        config_file_t* conf = video_shader_read_preset(d3d9->shader_path);
+        if (hit)
+        {
+            char b[512];
+            _snprintf(b, sizeof(b),
+                "[ZeroMod] slang preset from cache: path='%s' passes=%u luts=%u history=%u\n",
+                path,
+                (unsigned)out->passes,
+                (unsigned)out->luts,
+                (unsigned)out->history_size);
+            OutputDebugStringA(b);
+            return true;
+        }
+#endif
+
+        config_file_t* conf = video_shader_read_preset(path);
         if (!conf)
         {
-            OutputDebugStringA("[ZeroMod] slang_d3d9_load_preset_parse_only: video_shader_read_preset failed\n");
-            d3d9->shader_reload_pending = false;
+            OutputDebugStringA("[ZeroMod] slang_d3d9_parse_preset: video_shader_read_preset failed\n");
             return false;
         }
 
-        if (!video_shader_read_conf_preset(conf, &d3d9->shader))
+        if (!video_shader_read_conf_preset(conf, out))
         {
-            OutputDebugStringA("[ZeroMod] slang_d3d9_load_preset_parse_only: video_shader_read_conf_preset failed\n");
+            OutputDebugStringA("[ZeroMod] slang_d3d9_parse_preset: video_shader_read_conf_preset failed\n");
             config_file_free(conf);
-            d3d9_clear_parsed_preset(d3d9);
-            d3d9->shader_reload_pending = false;
+            slang_d3d9_free_parsed_shader(out);
             return false;
         }
 
-        video_shader_resolve_current_parameters(conf, &d3d9->shader);
-        zm_log_shader_summary("parsed_preset", &d3d9->shader);
+        video_shader_resolve_current_parameters(conf, out);
+        zm_log_shader_summary("parsed_preset", out);
         config_file_free(conf);
 
-
-        d3d9->shader_preset = true;
-        d3d9->shader_reload_pending = false;
-
         {
             char b[512];
             _snprintf(b, sizeof(b),
                 "[ZeroMod] slang preset parsed OK: path='%s' passes=%u luts=%u history=%u\n",
-                d3d9->shader_path,
-                (unsigned)d3d9->shader.passes,
-                (unsigned)d3d9->shader.luts,
-                (unsigned)d3d9->shader.history_size);
+                path,
+                (unsigned)out->passes,
+                (unsigned)out->luts,
+                (unsigned)out->history_size);
             OutputDebugStringA(b);
         }
 
+#if ZM_SLANG_PRESET_CACHE
+        zm_cache_parsed_preset(path, out);
+#endif
+        return true;
+#else
+        (void)path;
+        (void)out;
+        return false;
+#endif
+    }
+
+    bool slang_d3d9_load_preset_parse_only(d3d9_video_struct* d3d9)
+    {
+#if defined(HAVE_SLANG)
+        if (!d3d9 || d3d9->magic != 0x39564433)
+            return false;
+
+        if (!d3d9->shader_is_path || !d3d9->shader_path || !*d3d9->shader_path)
+        {
+            d3d9->shader_reload_pending = false;
+            return false;
+        }
+
+        d3d9_clear_parsed_preset(d3d9);
+
+        if (!slang_d3d9_parse_preset(d3d9->shader_path, &d3d9->shader))
+        {
+            d3d9_clear_parsed_preset(d3d9);
+            d3d9->shader_reload_pending = false;
+            return false;
+        }
+
+        d3d9->shader_preset = true;
+        d3d9->shader_reload_pending = false;
+
         return true;
 #else
         (void)d3d9;
@@ -1,7 +1,33 @@
 #pragma once
 #include "d3d9video.h"
+#include <string>
+
+// ---- Parsed preset cache ----
+// slang_d3d9_parse_preset keeps each parse (slang_preset_cache.h) with the
+// include-expanded source of every pass, so selecting a preset again only
+// stats the files it was read from. Set to 0 to parse every time.
+#define ZM_SLANG_PRESET_CACHE 1
 
 namespace ZeroMod {
 	bool slang_d3d9_load_preset_parse_only(d3d9_video_struct* d3d9);
+
+	// Parse a preset into a standalone video_shader (no d3d9 state touched, worker-safe).
+	bool slang_d3d9_parse_preset(const char* path, video_shader* out);
+
+	// Free generated pass sources and zero the struct.
+	void slang_d3d9_free_parsed_shader(video_shader* shader);
+
+	// Include-expanded source of each pass, one '\n' after each line as
+	// glslang_read_shader_file splits it
+	struct slang_pass_sources
+	{
+		std::string text[GFX_MAX_SHADERS];
+		bool ok[GFX_MAX_SHADERS];
+	};
+
+	// Sources for the passes of 'shader', parsed from 'preset': taken from
+	// that preset's cache entry while its files are unchanged, else read
+	// from disk. False if a pass file can't be read (its ok[] stays false).
+	bool slang_d3d9_pass_sources(const char* preset, const video_shader* shader, slang_pass_sources& out);
 }
 
@@ -0,0 +1,136 @@
+#include "slang_d3d9_rtpool.h"
+
+#include <windows.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace ZeroMod {
+
+    static void zm_pool_dbgf(const char* fmt, ...)
+    {
+        char b[512];
+        va_list va;
+        va_start(va, fmt);
+        _vsnprintf(b, sizeof(b), fmt, va);
+        va_end(va);
+        b[sizeof(b) - 1] = '\0';
+        OutputDebugStringA(b);
+    }
+
+    static double zm_mb(size_t bytes)
+    {
+        return (double)bytes / (1024.0 * 1024.0);
+    }
+
+    size_t slang_rt_bytes(UINT w, UINT h, D3DFORMAT fmt)
+    {
+        size_t bpp = 4;
+        switch (fmt) {
+        case D3DFMT_A16B16G16R16F: bpp = 8; break;
+        case D3DFMT_A32B32G32R32F: bpp = 16; break;
+        default: break;
+        }
+        return (size_t)w * (size_t)h * bpp;
+    }
+
+    static void slot_free(slang_rt_pool& pool, int i)
+    {
+        slang_rt_slot& s = pool.slots[i];
+        if (s.surf) { s.surf->Release(); s.surf = nullptr; }
+        if (s.tex) { s.tex->Release(); s.tex = nullptr; }
+        rts_drop(pool.book, i);
+    }
+
+    void slang_rt_pool_frame_begin(slang_rt_pool& pool)
+    {
+        rts_frame_begin(pool.book);
+    }
+
+    void slang_rt_pool_frame_end(slang_rt_pool& pool, size_t dedicated_bytes, unsigned intermediates)
+    {
+        slang_rt_slots& b = pool.book;
+        for (int i = 0; i < ZM_SLANG_RT_POOL_MAX; ++i)
+            if (rts_expired(b, i))
+                slot_free(pool, i);
+
+        rts_frame_end(b);
+
+        if (dedicated_bytes == pool.logged_dedicated && b.frame_peak_in_use == pool.logged_pooled)
+            return;
+
+        pool.logged_dedicated = dedicated_bytes;
+        pool.logged_pooled = b.frame_peak_in_use;
+
+        zm_pool_dbgf("[ZeroMod] rt_pool: %u intermediates, dedicated %.2f MB -> pooled %.2f MB "
+            "(%u surfaces, %.2f MB allocated, peak %.2f MB, creates=%llu reuses=%llu)\n",
+            intermediates, zm_mb(dedicated_bytes), zm_mb(b.frame_peak_in_use),
+            b.count, zm_mb(b.bytes), zm_mb(b.peak_bytes),
+            (unsigned long long)b.creates, (unsigned long long)b.reuses);
+    }
+
+    int slang_rt_pool_acquire(
+        slang_rt_pool& pool,
+        IDirect3DDevice9* dev,
+        UINT w, UINT h,
+        D3DFORMAT fmt,
+        int prefer)
+    {
+        if (!dev || !w || !h)
+            return -1;
+
+        const int hit = rts_reuse(pool.book, w, h, (uint32_t)fmt, prefer);
+        if (hit >= 0)
+            return hit;
+
+        const int victim = rts_victim(pool.book);
+        if (victim < 0) {
+            zm_pool_dbgf("[ZeroMod] rt_pool: FULL (%u slots held), %ux%u fmt=%u\n",
+                (unsigned)ZM_SLANG_RT_POOL_MAX, w, h, (unsigned)fmt);
+            return -1;
+        }
+
+        slot_free(pool, victim);
+        slang_rt_slot& s = pool.slots[victim];
+
+        HRESULT hr = dev->CreateTexture(
+            w, h,
+            1,
+            D3DUSAGE_RENDERTARGET,
+            fmt,
+            D3DPOOL_DEFAULT,
+            &s.tex,
+            nullptr);
+        if (FAILED(hr) || !s.tex) {
+            s.tex = nullptr;
+            zm_pool_dbgf("[ZeroMod] rt_pool: CreateTexture %ux%u fmt=%u FAILED hr=0x%08X\n",
+                w, h, (unsigned)fmt, (unsigned)hr);
+            return -1;
+        }
+
+        hr = s.tex->GetSurfaceLevel(0, &s.surf);
+        if (FAILED(hr) || !s.surf) {
+            s.surf = nullptr;
+            s.tex->Release();
+            s.tex = nullptr;
+            return -1;
+        }
+
+        return rts_fill(pool.book, victim, w, h, (uint32_t)fmt, slang_rt_bytes(w, h, fmt));
+    }
+
+    void slang_rt_pool_release(slang_rt_pool& pool, int slot)
+    {
+        rts_release(pool.book, slot);
+    }
+
+    void slang_rt_pool_destroy(slang_rt_pool& pool)
+    {
+        for (int i = 0; i < ZM_SLANG_RT_POOL_MAX; ++i)
+            slot_free(pool, i);
+
+        pool.logged_dedicated = 0;
+        pool.logged_pooled = 0;
+    }
+
+} // namespace ZeroMod
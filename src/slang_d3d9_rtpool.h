@@ -0,0 +1,55 @@
+#pragma once
+#include <d3d9.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "slang_rt_slots.h"
+
+// ---- Render-target pool for slang intermediate passes ----
+// Intermediate pass outputs are borrowed from a pool bucketed by size and
+// format instead of each pass owning a texture. The slot choice, aliasing
+// and eviction rules live in slang_rt_slots.cpp; this side owns the
+// textures.
+
+namespace ZeroMod {
+
+    struct slang_rt_slot
+    {
+        IDirect3DTexture9* tex;
+        IDirect3DSurface9* surf;
+    };
+
+    struct slang_rt_pool
+    {
+        slang_rt_slot slots[ZM_SLANG_RT_POOL_MAX];
+        slang_rt_slots book;
+
+        // last logged layout, so the summary only prints on change
+        size_t logged_dedicated;
+        size_t logged_pooled;
+    };
+
+    size_t slang_rt_bytes(UINT w, UINT h, D3DFORMAT fmt);
+
+    // All slots become free. Call before the first pass of a frame.
+    void slang_rt_pool_frame_begin(slang_rt_pool& pool);
+
+    // Evict idle slots and log a VRAM summary when the layout changed.
+    // dedicated_bytes = what one texture per intermediate pass would cost.
+    void slang_rt_pool_frame_end(slang_rt_pool& pool, size_t dedicated_bytes, unsigned intermediates);
+
+    // A free slot matching (w, h, fmt), preferring 'prefer' (last frame's slot)
+    // so a steady chain keeps the same textures. Returns the slot index or -1.
+    int slang_rt_pool_acquire(
+        slang_rt_pool& pool,
+        IDirect3DDevice9* dev,
+        UINT w, UINT h,
+        D3DFORMAT fmt,
+        int prefer);
+
+    void slang_rt_pool_release(slang_rt_pool& pool, int slot);
+
+    // Release every texture (device teardown / Reset).
+    void slang_rt_pool_destroy(slang_rt_pool& pool);
+
+} // namespace ZeroMod
@@ -0,0 +1,41 @@
+#include "slang_frame_store.h"
+
+namespace ZeroMod {
+
+    void sfs_history_reset(slang_frame_store& fs)
+    {
+        fs.history_head = 0;
+    }
+
+    void sfs_fb_reset(slang_frame_store& fs, unsigned pass, bool live)
+    {
+        if (pass >= ZM_SFS_MAX_PASSES)
+            return;
+        fs.fb_live[pass] = live;
+        fs.fb_cur[pass] = 0;
+    }
+
+    bool sfs_frame_begin(slang_frame_store& fs, uint64_t frame)
+    {
+        if (fs.started && fs.frame == frame)
+            return false;
+        fs.started = true;
+        fs.frame = frame;
+
+        // The oldest slot becomes this frame's; everything else ages by one
+        const unsigned n = sfs_history_slots(fs);
+        fs.history_head = (fs.history_head + n - 1) % n;
+
+        for (unsigned i = 0; i < ZM_SFS_MAX_PASSES; ++i)
+            if (fs.fb_live[i])
+                fs.fb_cur[i] ^= 1;
+        return true;
+    }
+
+    unsigned sfs_history_slot(const slang_frame_store& fs, unsigned k)
+    {
+        const unsigned n = sfs_history_slots(fs);
+        return (fs.history_head + k % n) % n;
+    }
+
+} // namespace ZeroMod
@@ -0,0 +1,55 @@
+#pragma once
+#include <stdint.h>
+
+// ---- Frame history and feedback indices ----
+// Which slot of the OriginalHistory ring and which half of each pass'
+// PassFeedback pair a frame writes and which ones it samples, without the
+// textures: slang_d3d9.cpp keeps the render targets in arrays indexed by
+// these calls. A new frame only moves indices, so nothing already stored
+// is copied. The oldest ring slot becomes this frame's Original, and every
+// feedback pair flips: this frame renders into one half while readers
+// sample last frame's output from the other. Both happen once per frame,
+// however many times the chain is drawn in it. Nothing in here calls the
+// OS, so tools/zm_frame_store_check.cpp drives it.
+// Passes that can own a pair (RetroArch's GFX_MAX_SHADERS)
+#define ZM_SFS_MAX_PASSES 64
+
+namespace ZeroMod {
+
+    struct slang_frame_store
+    {
+        unsigned history_depth;     // earlier frames kept (history_size); the ring has one more slot
+        unsigned history_head;      // ring slot of this frame's Original
+
+        bool fb_live[ZM_SFS_MAX_PASSES];    // pass i's pair is allocated
+        uint8_t fb_cur[ZM_SFS_MAX_PASSES];  // half pass i renders into this frame
+
+        bool started;
+        uint64_t frame;             // frame the indices last moved for
+    };
+
+    inline unsigned sfs_history_slots(const slang_frame_store& fs) { return fs.history_depth + 1; }
+
+    // The ring was (re)allocated or released: its frames are all black, so
+    // which slot is the head doesn't matter
+    void sfs_history_reset(slang_frame_store& fs);
+
+    // Pass i's pair was (re)allocated (live) or released; a new pair renders
+    // into half 0 first
+    void sfs_fb_reset(slang_frame_store& fs, unsigned pass, bool live);
+
+    // Start of a chain draw for 'frame'. The first draw of a frame moves the
+    // ring head back one slot and flips every live pair; later draws in the
+    // same frame reuse the same slots. True when the indices moved.
+    bool sfs_frame_begin(slang_frame_store& fs, uint64_t frame);
+
+    // Ring slot of the Original from k frames ago (0 = this frame)
+    unsigned sfs_history_slot(const slang_frame_store& fs, unsigned k);
+
+    // Half of pass i's pair this frame renders into
+    inline unsigned sfs_fb_write(const slang_frame_store& fs, unsigned pass) { return fs.fb_cur[pass]; }
+
+    // Half its PassFeedback samples: last frame's output
+    inline unsigned sfs_fb_read(const slang_frame_store& fs, unsigned pass) { return fs.fb_cur[pass] ^ 1u; }
+
+} // namespace ZeroMod
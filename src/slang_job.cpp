@@ -0,0 +1,50 @@
+#include "slang_job.h"
+
+namespace ZeroMod {
+
+    void job_init(zm_job* j, void (*destroy)(zm_job*))
+    {
+        j->destroy = destroy;
+        j->cancel.store(0);
+        j->state.store(ZM_JOB_RUNNING);
+        j->refs.store(2);
+    }
+
+    void job_abort(zm_job* j)
+    {
+        j->refs.store(1);
+        job_release(j);
+    }
+
+    void job_release(zm_job* j)
+    {
+        if (j->refs.fetch_sub(1) == 1)
+            j->destroy(j);
+    }
+
+    void job_finish(zm_job* j, bool ok)
+    {
+        j->state.store(ok ? ZM_JOB_DONE : ZM_JOB_FAILED);
+        job_release(j);
+    }
+
+    void job_cancel(zm_job*& slot)
+    {
+        zm_job* j = slot;
+        if (!j)
+            return;
+        slot = nullptr;
+        j->cancel.store(1);
+        job_release(j);
+    }
+
+    zm_job* job_take(zm_job*& slot)
+    {
+        zm_job* j = slot;
+        if (!j || j->state.load() == ZM_JOB_RUNNING)
+            return nullptr;
+        slot = nullptr;
+        return j;
+    }
+
+} // namespace ZeroMod
@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+
+// ---- Background job lifetime ----
+// The refcount and state machine behind slang_d3d9_async.cpp's preset
+// compile, without the thread or the payload. A job starts with two
+// references, the owner's (the render thread's slot) and the worker's.
+// The worker publishes DONE or FAILED and drops its reference. The owner
+// either takes the finished job out of its slot at a poll, or cancels it:
+// the cancel flag is raised and the worker notices at its next check.
+// Whoever drops the last reference frees the job through 'destroy', so a
+// superseded or cancelled job never needs a join. Nothing in here calls
+// the OS, so tools/zm_slang_swap_mock.cpp drives it with std::thread.
+
+namespace ZeroMod {
+
+    enum {
+        ZM_JOB_RUNNING = 0,
+        ZM_JOB_DONE = 1,
+        ZM_JOB_FAILED = 2,
+    };
+
+    struct zm_job
+    {
+        std::atomic<int> refs{ 0 };     // owner + worker
+        std::atomic<int> cancel{ 0 };
+        std::atomic<int> state{ ZM_JOB_RUNNING };
+        void (*destroy)(zm_job* j) = nullptr;
+    };
+
+    // Both references, before the worker is started
+    void job_init(zm_job* j, void (*destroy)(zm_job*));
+
+    // The worker never started: frees the job
+    void job_abort(zm_job* j);
+
+    void job_release(zm_job* j);
+
+    // Worker side: publish the outcome, then drop the worker's reference.
+    // The job may be gone when this returns.
+    void job_finish(zm_job* j, bool ok);
+
+    // Owner side. 'slot' holds the job in flight or null.
+
+    // Raise the cancel flag of the job in 'slot', if any, and drop the
+    // owner's reference. Also how a newer job supersedes it.
+    void job_cancel(zm_job*& slot);
+
+    // The job in 'slot' once it has finished, its state DONE or FAILED,
+    // with 'slot' cleared; the caller releases it when done with the
+    // result. Null while it runs or when there is none.
+    zm_job* job_take(zm_job*& slot);
+
+} // namespace ZeroMod
@@ -0,0 +1,73 @@
+#include "slang_pass_meta.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace ZeroMod {
+
+    static bool spm_starts(const std::string& line, const char* prefix)
+    {
+        return line.compare(0, strlen(prefix), prefix) == 0;
+    }
+
+    static bool spm_line(const std::string& line, zm_spm& out)
+    {
+        if (spm_starts(line, "#pragma name ")) {
+            size_t at = sizeof("#pragma name ") - 1;
+            while (at < line.size() && line[at] == ' ')
+                ++at;
+            size_t end = line.size();
+            while (end > at && (line[end - 1] == ' ' || line[end - 1] == '\t'))
+                --end;
+            if (out.name.empty())
+                out.name = line.substr(at, end - at);
+            return true;
+        }
+
+        if (!spm_starts(line, "#pragma parameter"))
+            return true;
+
+        // Same pattern as RetroArch's glslang_parse_meta; no step means a tenth of the range
+        char id[64] = {};
+        char desc[64] = {};
+        zm_spm_param p;
+        int n = sscanf(line.c_str(), "#pragma parameter %63s \"%63[^\"]\" %f %f %f %f",
+            id, desc, &p.initial, &p.minimum, &p.maximum, &p.step);
+        if (n == 5) {
+            p.step = 0.1f * (p.maximum - p.minimum);
+            n = 6;
+        }
+        if (n != 6)
+            return false;
+
+        p.id = id;
+        p.desc = desc;
+        for (const zm_spm_param& q : out.params)
+            if (q.id == p.id)
+                return true;
+        out.params.push_back(p);
+        return true;
+    }
+
+    bool spm_parse(const char* text, size_t len, zm_spm& out)
+    {
+        out.name.clear();
+        out.params.clear();
+        if (!text)
+            return true;
+
+        size_t at = 0;
+        while (at < len) {
+            const char* nl = (const char*)memchr(text + at, '\n', len - at);
+            const size_t end = nl ? (size_t)(nl - text) : len;
+            std::string line(text + at, end - at);
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (!line.empty() && line[0] == '#' && !spm_line(line, out))
+                return false;
+            at = end + 1;
+        }
+        return true;
+    }
+
+} // namespace ZeroMod
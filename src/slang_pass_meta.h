@@ -0,0 +1,35 @@
+#pragma once
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// ---- Slang pass pragmas ----
+// The #pragma name and #pragma parameter lines of an include-expanded
+// .slang, read the way slang_process reads them. prepare_passes registers
+// every pass's alias and parameters in pass order before the concurrent
+// prepare, the pass cache keys a pass on its own parameters instead of the
+// preset-wide list, and a cache hit registers them since slang_process
+// doesn't run. Plain C++.
+
+namespace ZeroMod {
+
+    struct zm_spm_param
+    {
+        std::string id;
+        std::string desc;
+        float initial = 0.0f;
+        float minimum = 0.0f;
+        float maximum = 0.0f;
+        float step = 0.0f;
+    };
+
+    struct zm_spm
+    {
+        std::string name;                   // #pragma name, empty if none
+        std::vector<zm_spm_param> params;   // first declaration of each id, in source order
+    };
+
+    // False on a malformed #pragma parameter line
+    bool spm_parse(const char* text, size_t len, zm_spm& out);
+
+} // namespace ZeroMod
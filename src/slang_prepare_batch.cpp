@@ -0,0 +1,44 @@
+#include "slang_prepare_batch.h"
+
+namespace ZeroMod {
+
+    unsigned spb_workers(unsigned cores, unsigned passes)
+    {
+        unsigned workers = cores;
+        if (workers > ZM_SLANG_COMPILE_THREADS) workers = ZM_SLANG_COMPILE_THREADS;
+        if (workers > passes) workers = passes;
+        if (workers < 1) workers = 1;
+        return workers;
+    }
+
+    void spb_register(zm_spb& b)
+    {
+        if (!b.register_pass)
+            return;
+        b.lock(b.ctx);
+        for (unsigned i = 0; i < b.passes; ++i)
+            b.register_pass(b.ctx, i);
+        b.unlock(b.ctx);
+    }
+
+    void spb_worker(zm_spb& b)
+    {
+        for (;;)
+        {
+            if (b.failed.load())
+                break;
+            if (b.cancel && b.cancel->load()) {
+                b.failed.store(1);
+                break;
+            }
+
+            const unsigned i = b.next.fetch_add(1);
+            if (i >= b.passes)
+                break;
+
+            if (!b.prepare(b.ctx, i))
+                b.failed.store(1);
+        }
+    }
+
+} // namespace ZeroMod
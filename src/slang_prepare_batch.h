@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+
+// ---- Concurrent pass preparation: scheduling ----
+// How slang_d3d9_prepare_passes spreads a preset's passes over threads,
+// without the threads or the passes. Every pass' pragmas are registered in
+// pass order under the caller's lock first, so the shared parameter list
+// comes out as a serial build leaves it. Workers then take pass indices off
+// one shared counter until it runs out, the batch fails or the cancel flag
+// is raised. The caller starts the threads (the calling thread is worker
+// 0) and does the work of a pass in 'prepare', taking the same lock around
+// slang_process. Nothing in here calls the OS, so
+// tools/zm_slang_prepare_bench.cpp drives it with std::thread and a mutex.
+// Upper bound on threads used to prepare a preset's passes in parallel.
+#define ZM_SLANG_COMPILE_THREADS 8
+
+namespace ZeroMod {
+
+    struct zm_spb
+    {
+        unsigned passes = 0;
+        const std::atomic<int>* cancel = nullptr;   // may be null
+
+        void* ctx = nullptr;
+        // Pass i's alias and parameters into the shared lists; null to skip
+        // the registration
+        void (*register_pass)(void* ctx, unsigned i) = nullptr;
+        // Everything else for pass i, on a worker; false fails the batch
+        bool (*prepare)(void* ctx, unsigned i) = nullptr;
+        void (*lock)(void* ctx) = nullptr;
+        void (*unlock)(void* ctx) = nullptr;
+
+        std::atomic<unsigned> next{ 0 };
+        std::atomic<int> failed{ 0 };
+    };
+
+    // min(cores, ZM_SLANG_COMPILE_THREADS, passes), at least 1
+    unsigned spb_workers(unsigned cores, unsigned passes);
+
+    // register_pass for every pass, in order, under one lock
+    void spb_register(zm_spb& b);
+
+    // One worker's loop; run it on every thread of the batch
+    void spb_worker(zm_spb& b);
+
+} // namespace ZeroMod
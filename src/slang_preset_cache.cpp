@@ -0,0 +1,196 @@
+#include "slang_preset_cache.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace ZeroMod {
+
+    bool spc_stamp(const char* path, zm_spc_stamp& out)
+    {
+        if (!path || !*path)
+            return false;
+#ifdef _WIN32
+        // 100 ns write times; _stat's are whole seconds
+        WIN32_FILE_ATTRIBUTE_DATA a;
+        if (!GetFileAttributesExA(path, GetFileExInfoStandard, &a))
+            return false;
+        out.size = (int64_t)((uint64_t)a.nFileSizeHigh << 32 | a.nFileSizeLow);
+        out.mtime = (int64_t)((uint64_t)a.ftLastWriteTime.dwHighDateTime << 32 | a.ftLastWriteTime.dwLowDateTime);
+#else
+        struct stat st;
+        if (stat(path, &st) != 0)
+            return false;
+        out.size = (int64_t)st.st_size;
+        out.mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+        out.path = path;
+        return true;
+    }
+
+    static bool spc_is_absolute(const std::string& p)
+    {
+        return (!p.empty() && (p[0] == '/' || p[0] == '\\')) || (p.size() > 1 && p[1] == ':');
+    }
+
+    // 'rel' as seen from the file 'from'
+    static std::string spc_resolve(const std::string& from, const std::string& rel)
+    {
+        if (spc_is_absolute(rel))
+            return rel;
+        const size_t slash = from.find_last_of("/\\");
+        return slash == std::string::npos ? rel : from.substr(0, slash + 1) + rel;
+    }
+
+    // Calls 'fn' with each line of 'path'; false when it can't be read
+    template <typename F>
+    static bool spc_each_line(const std::string& path, F fn)
+    {
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f)
+            return false;
+        char line[4096];
+        while (fgets(line, sizeof(line), f)) {
+            size_t n = strlen(line);
+            while (n && (line[n - 1] == '\n' || line[n - 1] == '\r'))
+                line[--n] = '\0';
+            fn(line);
+        }
+        fclose(f);
+        return true;
+    }
+
+    // The path after a directive, with or without quotes
+    static std::string spc_directive_arg(const char* s)
+    {
+        while (*s == ' ' || *s == '\t')
+            ++s;
+        if (*s == '"') {
+            const char* end = strchr(++s, '"');
+            return end ? std::string(s, end) : std::string();
+        }
+        const char* end = s + strlen(s);
+        while (end > s && (end[-1] == ' ' || end[-1] == '\t'))
+            --end;
+        return std::string(s, end);
+    }
+
+    static void spc_add_tree(const std::string& path, const char* directive, int depth,
+        std::vector<std::string>& files)
+    {
+        if (depth > ZM_SPC_MAX_DEPTH || std::find(files.begin(), files.end(), path) != files.end())
+            return;
+        // Listed even when it can't be read, so the store fails rather than
+        // caching a parse that didn't see it
+        files.push_back(path);
+
+        const size_t dn = strlen(directive);
+        std::vector<std::string> children;
+        spc_each_line(path, [&](const char* line) {
+            if (strncmp(line, directive, dn) == 0 && (line[dn] == ' ' || line[dn] == '\t' || line[dn] == '"')) {
+                const std::string arg = spc_directive_arg(line + dn);
+                if (!arg.empty())
+                    children.push_back(spc_resolve(path, arg));
+            }
+        });
+        for (const std::string& c : children)
+            spc_add_tree(c, directive, depth + 1, files);
+    }
+
+    void spc_add_preset_files(const char* preset, std::vector<std::string>& files)
+    {
+        if (preset && *preset)
+            spc_add_tree(preset, "#reference", 0, files);
+    }
+
+    void spc_add_source_files(const char* source, std::vector<std::string>& files)
+    {
+        if (source && *source)
+            spc_add_tree(source, "#include", 0, files);
+    }
+
+    static void spc_drop(zm_spc& c, size_t i)
+    {
+        zm_spc_entry& e = c.entries[i];
+        if (e.free_fn && e.value)
+            e.free_fn(e.value);
+        c.entries.erase(c.entries.begin() + i);
+    }
+
+    void* spc_lookup(zm_spc& c, const char* key)
+    {
+        if (!key)
+            return nullptr;
+        for (size_t i = 0; i < c.entries.size(); ++i) {
+            zm_spc_entry& e = c.entries[i];
+            if (e.key != key)
+                continue;
+
+            for (const zm_spc_stamp& f : e.files) {
+                zm_spc_stamp now;
+                ++c.stats;
+                if (!spc_stamp(f.path.c_str(), now) || now.size != f.size || now.mtime != f.mtime) {
+                    ++c.stale;
+                    ++c.misses;
+                    spc_drop(c, i);
+                    return nullptr;
+                }
+            }
+            ++c.hits;
+            e.used = ++c.clock;
+            return e.value;
+        }
+        ++c.misses;
+        return nullptr;
+    }
+
+    bool spc_store(zm_spc& c, const char* key, const std::vector<std::string>& files,
+        void* value, zm_spc_free_fn free_fn)
+    {
+        zm_spc_entry e;
+        e.key = key ? key : "";
+        e.value = value;
+        e.free_fn = free_fn;
+        e.used = ++c.clock;
+        e.files.reserve(files.size());
+        for (const std::string& f : files) {
+            zm_spc_stamp s;
+            ++c.stats;
+            if (!spc_stamp(f.c_str(), s)) {
+                if (free_fn && value)
+                    free_fn(value);
+                return false;
+            }
+            e.files.push_back(std::move(s));
+        }
+
+        for (size_t i = 0; i < c.entries.size(); ++i) {
+            if (c.entries[i].key == e.key) {
+                spc_drop(c, i);
+                break;
+            }
+        }
+        while (!c.entries.empty() && c.entries.size() >= (c.max_entries ? c.max_entries : 1)) {
+            size_t oldest = 0;
+            for (size_t i = 1; i < c.entries.size(); ++i)
+                if (c.entries[i].used < c.entries[oldest].used)
+                    oldest = i;
+            spc_drop(c, oldest);
+        }
+        c.entries.push_back(std::move(e));
+        return true;
+    }
+
+    void spc_clear(zm_spc& c)
+    {
+        while (!c.entries.empty())
+            spc_drop(c, c.entries.size() - 1);
+    }
+
+} // namespace ZeroMod
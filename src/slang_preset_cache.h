@@ -0,0 +1,78 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// ---- Parsed preset cache ----
+// Keeps what parsing a .slangp produced, keyed by the preset path, with
+// the size and modification time of every file the parse read: the
+// preset, the presets it #references, each pass's .slang and everything
+// those #include. A lookup stats those files and only hands the entry
+// back when none of them changed, so selecting a preset again costs a
+// stat call per file instead of re-reading and re-parsing them all. What
+// an entry holds is up to the caller (slang_d3d9_preset_load.cpp keeps
+// the video_shader and the include-expanded pass sources); it is freed
+// through the callback given to spc_store. Not thread safe; the caller
+// locks. The only OS call is the file stamp, so
+// tools/zm_preset_cache_bench.cpp can drive it on Linux.
+// Presets kept by default; the least recently used one goes first
+#define ZM_SPC_MAX_ENTRIES 8
+// #reference / #include nesting followed when collecting files
+#define ZM_SPC_MAX_DEPTH 16
+
+namespace ZeroMod {
+
+    struct zm_spc_stamp
+    {
+        std::string path;
+        int64_t size = 0;
+        int64_t mtime = 0;      // as fine as the file system keeps it
+    };
+
+    typedef void (*zm_spc_free_fn)(void* value);
+
+    struct zm_spc_entry
+    {
+        std::string key;
+        std::vector<zm_spc_stamp> files;
+        void* value = nullptr;
+        zm_spc_free_fn free_fn = nullptr;
+        uint64_t used = 0;
+    };
+
+    struct zm_spc
+    {
+        std::vector<zm_spc_entry> entries;
+        size_t max_entries = ZM_SPC_MAX_ENTRIES;
+        uint64_t clock = 0;
+
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t stale = 0;     // found, but a file changed
+        uint64_t stats = 0;     // files stamped, lookups and stores
+    };
+
+    // False when 'path' can't be stat'ed
+    bool spc_stamp(const char* path, zm_spc_stamp& out);
+
+    // Adds 'preset' and the presets it #references, recursively
+    void spc_add_preset_files(const char* preset, std::vector<std::string>& files);
+
+    // Adds a .slang and the files it #includes, recursively
+    void spc_add_source_files(const char* source, std::vector<std::string>& files);
+
+    // The value stored under 'key' if none of its files changed, else null.
+    // An entry with a changed file is dropped.
+    void* spc_lookup(zm_spc& c, const char* key);
+
+    // Stamps 'files' and keeps 'value' under 'key', replacing an older
+    // entry and evicting the least recently used one past max_entries.
+    // When a file can't be stat'ed nothing is kept, 'value' is freed and
+    // the result is false.
+    bool spc_store(zm_spc& c, const char* key, const std::vector<std::string>& files,
+        void* value, zm_spc_free_fn free_fn);
+
+    void spc_clear(zm_spc& c);
+
+} // namespace ZeroMod
@@ -0,0 +1,148 @@
+#include "slang_rt_slots.h"
+#include "slang_bind_table.h"
+
+namespace ZeroMod {
+
+    static int rts_take(slang_rt_slots& s, int i)
+    {
+        slang_rt_entry& e = s.e[i];
+        e.in_use = true;
+        e.last_used = s.frame;
+
+        s.in_use_bytes += e.bytes;
+        if (s.in_use_bytes > s.frame_peak_in_use)
+            s.frame_peak_in_use = s.in_use_bytes;
+        return i;
+    }
+
+    static bool rts_matches(const slang_rt_entry& e, uint32_t w, uint32_t h, uint32_t fmt)
+    {
+        return e.held && !e.in_use && e.w == w && e.h == h && e.fmt == fmt;
+    }
+
+    void rts_frame_begin(slang_rt_slots& s)
+    {
+        s.frame++;
+        for (unsigned i = 0; i < ZM_SLANG_RT_POOL_MAX; ++i)
+            s.e[i].in_use = false;
+        s.in_use_bytes = 0;
+        s.frame_peak_in_use = 0;
+    }
+
+    bool rts_expired(const slang_rt_slots& s, int slot)
+    {
+        const slang_rt_entry& e = s.e[slot];
+        return e.held && !e.in_use && s.frame - e.last_used > ZM_SLANG_RT_POOL_IDLE_FRAMES;
+    }
+
+    void rts_frame_end(slang_rt_slots& s)
+    {
+        if (s.bytes > s.peak_bytes)
+            s.peak_bytes = s.bytes;
+    }
+
+    int rts_reuse(slang_rt_slots& s, uint32_t w, uint32_t h, uint32_t fmt, int prefer)
+    {
+        if (prefer >= 0 && prefer < ZM_SLANG_RT_POOL_MAX && rts_matches(s.e[prefer], w, h, fmt)) {
+            s.reuses++;
+            return rts_take(s, prefer);
+        }
+
+        for (int i = 0; i < ZM_SLANG_RT_POOL_MAX; ++i)
+        {
+            if (rts_matches(s.e[i], w, h, fmt)) {
+                s.reuses++;
+                return rts_take(s, i);
+            }
+        }
+        return -1;
+    }
+
+    int rts_victim(const slang_rt_slots& s)
+    {
+        int victim = -1;
+        for (int i = 0; i < ZM_SLANG_RT_POOL_MAX; ++i)
+        {
+            const slang_rt_entry& e = s.e[i];
+            if (!e.held) return i;
+            if (e.in_use || e.last_used == s.frame)
+                continue;
+            if (victim < 0 || e.last_used < s.e[victim].last_used)
+                victim = i;
+        }
+        return victim;
+    }
+
+    void rts_drop(slang_rt_slots& s, int slot)
+    {
+        slang_rt_entry& e = s.e[slot];
+        if (e.held) {
+            if (e.in_use)
+                s.in_use_bytes -= e.bytes;
+            s.bytes -= e.bytes;
+            s.count--;
+        }
+        e = slang_rt_entry{};
+    }
+
+    int rts_fill(slang_rt_slots& s, int slot, uint32_t w, uint32_t h, uint32_t fmt, size_t bytes)
+    {
+        slang_rt_entry& e = s.e[slot];
+        e.w = w;
+        e.h = h;
+        e.fmt = fmt;
+        e.bytes = bytes;
+        e.held = true;
+        s.count++;
+        s.bytes += bytes;
+        s.creates++;
+        return rts_take(s, slot);
+    }
+
+    void rts_release(slang_rt_slots& s, int slot)
+    {
+        if (slot < 0 || slot >= ZM_SLANG_RT_POOL_MAX)
+            return;
+
+        slang_rt_entry& e = s.e[slot];
+        if (!e.in_use)
+            return;
+
+        e.in_use = false;
+        s.in_use_bytes -= e.bytes;
+    }
+
+    void rts_last_readers(
+        const slang_pass_bindings* const* binds,
+        unsigned num_passes,
+        bool aliasing,
+        unsigned* last_reader)
+    {
+        const unsigned N = num_passes;
+
+        bool tables = aliasing;
+        for (unsigned k = 0; k < N; ++k)
+            if (!binds[k])
+                tables = false;
+
+        for (unsigned j = 0; j < N; ++j)
+            last_reader[j] = tables ? j + 1 : N - 1;
+
+        if (!tables)
+            return;
+
+        for (unsigned k = 0; k < N; ++k)
+        {
+            const slang_pass_bindings& b = *binds[k];
+            for (unsigned s = 0; s < b.num_samplers; ++s)
+            {
+                const slang_sampler_bind& sb = b.samplers[s];
+                if (sb.kind != ZM_SAMP_ALIAS || sb.pass >= k)
+                    continue;
+                if (last_reader[sb.pass] < k)
+                    last_reader[sb.pass] = k;
+            }
+        }
+    }
+
+} // namespace ZeroMod
@@ -0,0 +1,87 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ---- Render-target pool bookkeeping ----
+// Which pooled surface each intermediate pass draws into, and when one
+// goes away, without touching the device: slang_d3d9_rtpool.cpp creates
+// and releases the textures around these calls, tools/zm_rtpool_report.cpp
+// drives the same calls with a fake allocator on Linux. A pass' output
+// goes back to the pool once the last pass that reads it has drawn, so
+// passes with disjoint lifetimes share VRAM. Resizes and preset swaps
+// reuse matching surfaces; anything idle for ZM_SLANG_RT_POOL_IDLE_FRAMES
+// is released.
+// Set ZM_SLANG_RT_ALIASING to 0 to keep every output alive for the whole frame.
+#define ZM_SLANG_RT_ALIASING 1
+#define ZM_SLANG_RT_POOL_MAX 32
+#define ZM_SLANG_RT_POOL_IDLE_FRAMES 120
+
+namespace ZeroMod {
+
+    struct slang_pass_bindings;
+
+    struct slang_rt_entry
+    {
+        uint32_t w, h;
+        uint32_t fmt;           // D3DFORMAT
+        size_t bytes;
+        bool held;              // a surface is allocated for this slot
+        bool in_use;            // held by a pass for the rest of this frame
+        uint64_t last_used;     // pool frame index
+    };
+
+    struct slang_rt_slots
+    {
+        slang_rt_entry e[ZM_SLANG_RT_POOL_MAX];
+        unsigned count;
+        uint64_t frame;
+
+        size_t bytes;            // currently allocated
+        size_t peak_bytes;       // max 'bytes' seen
+        size_t in_use_bytes;     // held right now
+        size_t frame_peak_in_use;
+
+        uint64_t creates;
+        uint64_t reuses;
+    };
+
+    // All slots become free. Call before the first pass of a frame.
+    void rts_frame_begin(slang_rt_slots& s);
+
+    // A slot idle for longer than ZM_SLANG_RT_POOL_IDLE_FRAMES; the caller
+    // releases its surface and calls rts_drop.
+    bool rts_expired(const slang_rt_slots& s, int slot);
+
+    // After the evictions: updates peak_bytes.
+    void rts_frame_end(slang_rt_slots& s);
+
+    // A free slot holding (w, h, fmt), preferring 'prefer' (last frame's
+    // slot) so a steady chain keeps the same textures. Takes it and returns
+    // its index, -1 when there is none.
+    int rts_reuse(slang_rt_slots& s, uint32_t w, uint32_t h, uint32_t fmt, int prefer);
+
+    // Where a new surface goes: an empty slot, else the stalest one nobody
+    // touched this frame (the caller releases its surface and calls rts_drop
+    // first). -1 when every slot is held.
+    int rts_victim(const slang_rt_slots& s);
+
+    // The slot's surface was released.
+    void rts_drop(slang_rt_slots& s, int slot);
+
+    // A new surface was created in 'slot'; takes it and returns 'slot'.
+    int rts_fill(slang_rt_slots& s, int slot, uint32_t w, uint32_t h, uint32_t fmt, size_t bytes);
+
+    // The pass holding 'slot' has no readers left this frame.
+    void rts_release(slang_rt_slots& s, int slot);
+
+    // Last pass that samples each intermediate output: the next pass
+    // (Source) or the furthest alias reader. Without aliasing, or when a
+    // pass has no binding table (the constant-table path looks aliases up
+    // by name at draw time), every output lives until the last pass.
+    void rts_last_readers(
+        const slang_pass_bindings* const* binds,
+        unsigned num_passes,
+        bool aliasing,
+        unsigned* last_reader);
+
+} // namespace ZeroMod
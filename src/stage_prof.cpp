@@ -0,0 +1,210 @@
+#include "stage_prof.h"
+
+#include <atomic>
+#include <stdarg.h>
+#include <stdio.h>
+
+namespace ZeroMod {
+
+    bool g_prof_enabled = false;
+
+    static void zm_prof_dbgf(const char* fmt, ...)
+    {
+        char b[512];
+        va_list va;
+        va_start(va, fmt);
+        _vsnprintf(b, sizeof(b), fmt, va);
+        va_end(va);
+        b[sizeof(b) - 1] = '\0';
+        OutputDebugStringA(b);
+    }
+
+    struct zm_prof_state
+    {
+        zm_prof_ring ring;
+        std::atomic<bool> on;
+        std::atomic<bool> csv;
+        std::atomic<bool> quit;
+        HANDLE thread;
+        HANDLE wake;        // auto-reset, set once per frame
+        HANDLE done;        // the thread has left its loop
+        double tick_ms;
+
+        // Profiler thread only
+        zm_prof_frames frames;
+        FILE* csv_file;
+
+        CRITICAL_SECTION text_cs;
+        std::string text;
+        bool text_new;
+    };
+
+    static zm_prof_state g_prof;
+
+    void prof_push(uint32_t stage, uint32_t ticks)
+    {
+        spr_push(g_prof.ring, stage, ticks);
+    }
+
+    static void prof_publish_text(zm_prof_state& p, std::string&& text)
+    {
+        EnterCriticalSection(&p.text_cs);
+        p.text = std::move(text);
+        p.text_new = true;
+        LeaveCriticalSection(&p.text_cs);
+    }
+
+    static void prof_csv(zm_prof_state& p, const zm_prof_frames& f)
+    {
+        const bool want = p.csv.load(std::memory_order_relaxed);
+        if (!want) {
+            if (p.csv_file) {
+                fclose(p.csv_file);
+                p.csv_file = nullptr;
+            }
+            return;
+        }
+
+        if (!p.csv_file) {
+            p.csv_file = fopen(ZM_PROF_CSV_FILE, "w");
+            if (!p.csv_file) {
+                zm_prof_dbgf("[ZeroMod] profiler: can't open %s\n", ZM_PROF_CSV_FILE);
+                p.csv.store(false);
+                return;
+            }
+            fputs("frame", p.csv_file);
+            for (uint32_t s = 0; s < ZM_PS_COUNT; ++s)
+                fprintf(p.csv_file, ",%s_ms", spr_stage_name(s));
+            fputs(",dropped\n", p.csv_file);
+        }
+
+        fprintf(p.csv_file, "%llu", (unsigned long long)f.frame);
+        for (uint32_t s = 0; s < ZM_PS_COUNT; ++s)
+            fprintf(p.csv_file, ",%.4f", (double)f.cur[s] * p.tick_ms);
+        fprintf(p.csv_file, ",%u\n", p.ring.dropped.load(std::memory_order_relaxed));
+    }
+
+    static void prof_frame_done(void* ctx, const zm_prof_frames& f, bool publish)
+    {
+        zm_prof_state& p = *(zm_prof_state*)ctx;
+        prof_csv(p, f);
+        if (publish)
+            prof_publish_text(p, spr_table(f, p.tick_ms, p.ring.dropped.load(std::memory_order_relaxed)));
+    }
+
+    static void prof_reset(zm_prof_state& p)
+    {
+        spr_reset(p.frames);
+        p.ring.dropped.store(0, std::memory_order_relaxed);
+        if (p.csv_file) {
+            fclose(p.csv_file);
+            p.csv_file = nullptr;
+        }
+        prof_publish_text(p, std::string());
+    }
+
+    static DWORD WINAPI prof_thread_proc(LPVOID param)
+    {
+        zm_prof_state& p = *(zm_prof_state*)param;
+        bool active = false;
+
+        for (;;) {
+            // Woken per frame; the timeout only bounds how stale the ring
+            // gets if Present stops coming
+            WaitForSingleObject(p.wake, ZM_PROF_IDLE_MS);
+            const bool quit = p.quit.load(std::memory_order_acquire);
+
+            spr_drain(p.ring, p.frames, prof_frame_done, &p);
+
+            const bool on = p.on.load(std::memory_order_relaxed) && !quit;
+            if (active && !on)
+                prof_reset(p);
+            active = on;
+            if (quit)
+                break;
+        }
+        SetEvent(p.done);
+        return 0;
+    }
+
+    void prof_frame(bool enabled, bool csv)
+    {
+        zm_prof_state& p = g_prof;
+#if !ZM_STAGE_PROF
+        enabled = false;
+#endif
+        if (enabled && !p.thread) {
+            LARGE_INTEGER f;
+            QueryPerformanceFrequency(&f);
+            p.tick_ms = 1000.0 / (double)f.QuadPart;
+            InitializeCriticalSection(&p.text_cs);
+
+            p.quit.store(false);
+            p.wake = CreateEvent(NULL, FALSE, FALSE, NULL);
+            p.done = CreateEvent(NULL, TRUE, FALSE, NULL);
+            p.thread = p.wake && p.done ? CreateThread(NULL, 0, prof_thread_proc, &p, 0, NULL) : NULL;
+            if (!p.thread) {
+                zm_prof_dbgf("[ZeroMod] profiler: CreateThread FAILED (%lu)\n", (unsigned long)GetLastError());
+                if (p.wake) CloseHandle(p.wake);
+                if (p.done) CloseHandle(p.done);
+                p.wake = p.done = NULL;
+                DeleteCriticalSection(&p.text_cs);
+                enabled = false;
+            }
+            else {
+                zm_prof_dbgf("[ZeroMod] profiler: started\n");
+            }
+        }
+
+        p.csv.store(csv, std::memory_order_relaxed);
+        p.on.store(enabled, std::memory_order_relaxed);
+        g_prof_enabled = enabled;
+        if (enabled)
+            prof_push(ZM_PS_FRAME_MARK, 0);
+        // Also when just turned off, so the thread resets promptly
+        if (p.thread)
+            SetEvent(p.wake);
+    }
+
+    void prof_shutdown()
+    {
+        zm_prof_state& p = g_prof;
+        if (!p.thread)
+            return;
+
+        g_prof_enabled = false;
+        p.on.store(false, std::memory_order_relaxed);
+        p.quit.store(true, std::memory_order_release);
+        SetEvent(p.wake);
+
+        // Not the thread handle: under the loader lock (DLL detach) the
+        // thread can't finish exiting, but it can still say it's done
+        if (WaitForSingleObject(p.done, ZM_PROF_STOP_WAIT_MS) != WAIT_OBJECT_0) {
+            zm_prof_dbgf("[ZeroMod] profiler: thread didn't stop, leaving it\n");
+            return;
+        }
+        CloseHandle(p.thread);
+        CloseHandle(p.wake);
+        CloseHandle(p.done);
+        p.thread = p.wake = p.done = NULL;
+        DeleteCriticalSection(&p.text_cs);
+        zm_prof_dbgf("[ZeroMod] profiler: stopped\n");
+    }
+
+    bool prof_overlay_text(std::string& out)
+    {
+        zm_prof_state& p = g_prof;
+        if (!p.thread)
+            return false;
+
+        EnterCriticalSection(&p.text_cs);
+        const bool fresh = p.text_new;
+        if (fresh) {
+            out = p.text;
+            p.text_new = false;
+        }
+        LeaveCriticalSection(&p.text_cs);
+        return fresh;
+    }
+
+} // namespace ZeroMod
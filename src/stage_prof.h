@@ -0,0 +1,79 @@
+#pragma once
+#include <windows.h>
+#include <stdint.h>
+#include <string>
+#include "stage_prof_ring.h"
+
+// ---- CPU stage profiler ----
+// ZM_PROF_SCOPE(stage) times the rest of the enclosing block with QPC and
+// pushes {stage, ticks} into the sample ring (stage_prof_ring.h); it never
+// blocks or allocates. A background thread drains the ring into the frame
+// window and publishes its min/avg/p99 table for the overlay, optionally
+// appending one CSV row per frame. The thread sleeps on an event
+// prof_frame sets once per frame; prof_shutdown stops it. With [profiler]
+// enabled=false a scope is one load of g_prof_enabled and not-taken tests
+// on that one value: the constructor keeps it in the scope instead of the
+// destructor checking t0.
+// Set ZM_STAGE_PROF to 0 to compile the scopes out.
+#define ZM_STAGE_PROF 1
+// Longest the profiler thread sleeps without a frame
+#define ZM_PROF_IDLE_MS 100
+// How long prof_shutdown waits for the thread
+#define ZM_PROF_STOP_WAIT_MS 500
+// Written next to the ini when [profiler] csv=true
+#define ZM_PROF_CSV_FILE "zeromod_profile.csv"
+
+namespace ZeroMod {
+
+    // Only written at Present, on the render thread
+    extern bool g_prof_enabled;
+
+    void prof_push(uint32_t stage, uint32_t ticks);
+
+    class zm_prof_scope
+    {
+        LARGE_INTEGER t0;
+        uint32_t stage;
+        const bool on;
+
+    public:
+        explicit zm_prof_scope(uint32_t stage) : stage(stage), on(g_prof_enabled)
+        {
+            if (on)
+                QueryPerformanceCounter(&t0);
+        }
+
+        ~zm_prof_scope()
+        {
+            if (on) {
+                LARGE_INTEGER t1;
+                QueryPerformanceCounter(&t1);
+                prof_push(stage, (uint32_t)(t1.QuadPart - t0.QuadPart));
+            }
+        }
+
+        zm_prof_scope(const zm_prof_scope&) = delete;
+        zm_prof_scope& operator=(const zm_prof_scope&) = delete;
+    };
+
+    // Once per Present, before any scope in it: marks the frame boundary,
+    // applies the ini toggles (starts the profiler thread on first enable)
+    // and wakes the profiler thread
+    void prof_frame(bool enabled, bool csv);
+
+    // Stops the profiler thread and closes the CSV. DLL detach.
+    void prof_shutdown();
+
+    // Latest min/avg/p99 table; false when nothing new since the last call.
+    // Empty text = profiler off.
+    bool prof_overlay_text(std::string& out);
+
+} // namespace ZeroMod
+
+#if ZM_STAGE_PROF
+#define ZM_PROF_CAT2(a, b) a##b
+#define ZM_PROF_CAT(a, b) ZM_PROF_CAT2(a, b)
+#define ZM_PROF_SCOPE(stage) ZeroMod::zm_prof_scope ZM_PROF_CAT(zm_prof_, __LINE__)(stage)
+#else
+#define ZM_PROF_SCOPE(stage) do {} while (0)
+#endif
@@ -0,0 +1,138 @@
+#include "stage_prof_ring.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+namespace ZeroMod {
+
+    static const char* const k_stage_names[ZM_PS_COUNT] = {
+        "present", "impl_present", "update_config", "overlay",
+        "gfx_frame", "driver_present", "draw_intercept", "slang_frame",
+        "cpu_scaler",
+    };
+
+    const char* spr_stage_name(uint32_t stage)
+    {
+        return stage < ZM_PS_COUNT ? k_stage_names[stage] : "?";
+    }
+
+    bool spr_push(zm_prof_ring& r, uint32_t stage, uint32_t ticks)
+    {
+        const uint32_t h = r.head.load(std::memory_order_relaxed);
+        if (h - r.tail.load(std::memory_order_acquire) >= ZM_PROF_RING) {
+            r.dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        zm_prof_sample& s = r.ring[h & (ZM_PROF_RING - 1)];
+        s.stage = stage;
+        s.ticks = ticks;
+        r.head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    static void spr_end_frame(zm_prof_frames& f, spr_frame_fn frame_done, void* ctx)
+    {
+        // Samples before the first marker belong to a partial frame
+        if (f.in_frame) {
+            for (uint32_t s = 0; s < ZM_PS_COUNT; ++s) {
+                f.hist[s][f.hist_pos] = (uint32_t)std::min<uint64_t>(f.cur[s], UINT32_MAX);
+                f.hist_calls[s][f.hist_pos] = f.cur_calls[s];
+            }
+            f.hist_pos = (f.hist_pos + 1) % ZM_PROF_WINDOW;
+            if (f.hist_n < ZM_PROF_WINDOW)
+                f.hist_n++;
+
+            const bool publish = ++f.since_publish >= ZM_PROF_PUBLISH_INTERVAL;
+            if (publish)
+                f.since_publish = 0;
+            if (frame_done)
+                frame_done(ctx, f, publish);
+        }
+
+        memset(f.cur, 0, sizeof(f.cur));
+        memset(f.cur_calls, 0, sizeof(f.cur_calls));
+        f.in_frame = true;
+        f.frame++;
+    }
+
+    void spr_drain(zm_prof_ring& r, zm_prof_frames& f, spr_frame_fn frame_done, void* ctx)
+    {
+        uint32_t t = r.tail.load(std::memory_order_relaxed);
+        const uint32_t h = r.head.load(std::memory_order_acquire);
+        for (; t != h; ++t) {
+            const zm_prof_sample s = r.ring[t & (ZM_PROF_RING - 1)];
+            if (s.stage == ZM_PS_FRAME_MARK) {
+                spr_end_frame(f, frame_done, ctx);
+            }
+            else if (s.stage < ZM_PS_COUNT) {
+                f.cur[s.stage] += s.ticks;
+                f.cur_calls[s.stage]++;
+            }
+        }
+        r.tail.store(t, std::memory_order_release);
+    }
+
+    void spr_reset(zm_prof_frames& f)
+    {
+        memset(f.cur, 0, sizeof(f.cur));
+        memset(f.cur_calls, 0, sizeof(f.cur_calls));
+        f.hist_n = 0;
+        f.hist_pos = 0;
+        f.since_publish = 0;
+        f.in_frame = false;
+    }
+
+    bool spr_stage_stats(const zm_prof_frames& f, uint32_t stage, zm_prof_stats& out)
+    {
+        if (stage >= ZM_PS_COUNT || !f.hist_n)
+            return false;
+
+        uint32_t tmp[ZM_PROF_WINDOW];
+        uint64_t sum = 0, calls = 0;
+        for (uint32_t i = 0; i < f.hist_n; ++i) {
+            tmp[i] = f.hist[stage][i];
+            sum += tmp[i];
+            calls += f.hist_calls[stage][i];
+        }
+        if (!calls)
+            return false;
+        std::sort(tmp, tmp + f.hist_n);
+
+        out.avg = (double)sum / f.hist_n;
+        out.min = tmp[0];
+        out.p99 = tmp[(f.hist_n * 99 + 99) / 100 - 1];
+        out.calls = (double)calls / f.hist_n;
+        return true;
+    }
+
+    std::string spr_table(const zm_prof_frames& f, double tick_ms, uint32_t dropped)
+    {
+        char b[2048];
+        size_t n = (size_t)snprintf(b, sizeof(b), "CPU ms (%u frames)  avg    min    p99  calls\n", f.hist_n);
+
+        for (uint32_t s = 0; s < ZM_PS_COUNT && n < sizeof(b); ++s) {
+            zm_prof_stats st;
+            if (!spr_stage_stats(f, s, st))
+                continue;
+            const int w = snprintf(b + n, sizeof(b) - n, "%-16s %6.3f %6.3f %6.3f %6.1f\n",
+                k_stage_names[s],
+                st.avg * tick_ms,
+                (double)st.min * tick_ms,
+                (double)st.p99 * tick_ms,
+                st.calls);
+            if (w < 0)
+                break;
+            n += (size_t)w;
+        }
+        if (n > sizeof(b) - 1)
+            n = sizeof(b) - 1;
+        b[n] = '\0';
+
+        std::string text(b);
+        if (dropped)
+            text += "dropped samples: " + std::to_string(dropped) + "\n";
+        return text;
+    }
+
+} // namespace ZeroMod
@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+// ---- CPU stage profiler: sample ring and frame window ----
+// The parts of the stage profiler that don't need the OS. The render
+// thread pushes {stage, ticks} into a fixed-size single-producer ring; a
+// full ring drops the sample and counts it. The profiler thread drains
+// the ring, sums each stage between frame marks (samples before the first
+// mark belong to a partial frame and are ignored), keeps the last
+// ZM_PROF_WINDOW frames and formats min/avg/p99 from them. stage_prof.cpp
+// owns the thread, the events, QPC and the CSV file. Nothing in here calls
+// the OS, so tools/zm_stage_prof_check.cpp drives it with std::thread.
+// Samples in flight between the render thread and the profiler thread (power of two)
+#define ZM_PROF_RING 16384
+// Frames the min/avg/p99 figures cover
+#define ZM_PROF_WINDOW 120
+// Frames between overlay updates
+#define ZM_PROF_PUBLISH_INTERVAL 30
+
+static_assert((ZM_PROF_RING & (ZM_PROF_RING - 1)) == 0, "ZM_PROF_RING must be a power of two");
+
+namespace ZeroMod {
+
+    enum : uint32_t {
+        // Stages nest: present covers the next five, draw_intercept covers slang_frame
+        ZM_PS_PRESENT = 0,          // all of MyID3D9Device::Present
+        ZM_PS_IMPL_PRESENT,         // Impl::present
+        ZM_PS_UPDATE_CONFIG,        // ... of which update_config
+        ZM_PS_OVERLAY,
+        ZM_PS_GFX_FRAME,            // d3d9_gfx_frame for all slang targets
+        ZM_PS_DRIVER_PRESENT,       // inner->Present
+        ZM_PS_DRAW_INTERCEPT,       // DrawPrimitive (game draws only)
+        ZM_PS_SLANG_FRAME,          // slang_d3d9_frame from the game-rect path
+        ZM_PS_CPU_SCALER,           // ... or the CPU scaler's fetch + draw in its place
+        ZM_PS_COUNT,
+        ZM_PS_FRAME_MARK = 0xFF,    // ring only: a new frame starts
+    };
+
+    struct zm_prof_sample
+    {
+        uint32_t stage;
+        uint32_t ticks;
+    };
+
+    // Render thread produces, profiler thread consumes
+    struct zm_prof_ring
+    {
+        zm_prof_sample ring[ZM_PROF_RING];
+        std::atomic<uint32_t> head{ 0 };
+        std::atomic<uint32_t> tail{ 0 };
+        std::atomic<uint32_t> dropped{ 0 };
+    };
+
+    // Profiler thread only
+    struct zm_prof_frames
+    {
+        uint64_t cur[ZM_PS_COUNT];
+        uint32_t cur_calls[ZM_PS_COUNT];
+        uint32_t hist[ZM_PS_COUNT][ZM_PROF_WINDOW];     // ticks per frame, clamped
+        uint32_t hist_calls[ZM_PS_COUNT][ZM_PROF_WINDOW];
+        uint32_t hist_n;
+        uint32_t hist_pos;
+        uint32_t since_publish;
+        uint64_t frame;         // frame marks seen
+        bool in_frame;
+    };
+
+    // One stage over the window, in ticks
+    struct zm_prof_stats
+    {
+        double avg;
+        uint32_t min;
+        uint32_t p99;
+        double calls;           // per frame
+    };
+
+    // Producer; false when the ring was full and the sample was dropped
+    bool spr_push(zm_prof_ring& r, uint32_t stage, uint32_t ticks);
+
+    // Called for every frame a mark closes, before its sums are cleared;
+    // 'publish' is set every ZM_PROF_PUBLISH_INTERVAL frames
+    typedef void (*spr_frame_fn)(void* ctx, const zm_prof_frames& f, bool publish);
+
+    // Consumer: folds every published sample into 'f' and frees its slot
+    void spr_drain(zm_prof_ring& r, zm_prof_frames& f, spr_frame_fn frame_done, void* ctx);
+
+    // Empty window, no frame in progress; leaves 'frame' alone
+    void spr_reset(zm_prof_frames& f);
+
+    // false when the stage had no calls in the window
+    bool spr_stage_stats(const zm_prof_frames& f, uint32_t stage, zm_prof_stats& out);
+
+    // The overlay table: one line per stage with calls, in milliseconds
+    std::string spr_table(const zm_prof_frames& f, double tick_ms, uint32_t dropped);
+
+    const char* spr_stage_name(uint32_t stage);
+
+} // namespace ZeroMod
@@ -0,0 +1,395 @@
+#include "state_delta.h"
+
+#include <windows.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace ZeroMod {
+
+    static void zm_sd_dbgf(const char* fmt, ...)
+    {
+        char b[512];
+        va_list va;
+        va_start(va, fmt);
+        _vsnprintf(b, sizeof(b), fmt, va);
+        va_end(va);
+        b[sizeof(b) - 1] = '\0';
+        OutputDebugStringA(b);
+    }
+
+    // Only writes inside a delta-tracked scope record anything
+    static bool sd_tracking(const zm_state_delta& sd)
+    {
+        return sd.dev && !sd.full;
+    }
+
+    static void sd_release(IUnknown* p)
+    {
+        if (p) p->Release();
+    }
+
+    void sd_begin(zm_state_delta& sd, IDirect3DDevice9* dev)
+    {
+        if (sd.dev)
+            sd_end(sd);
+        if (!dev)
+            return;
+
+        sd.dev = dev;
+        sd.save_calls = 0;
+        sd.restore_calls = 0;
+
+        memset(sd.rs_touched, 0, sizeof(sd.rs_touched));
+        memset(sd.samp_touched, 0, sizeof(sd.samp_touched));
+        memset(sd.tss_touched, 0, sizeof(sd.tss_touched));
+        memset(sd.vsc_touched, 0, sizeof(sd.vsc_touched));
+        memset(sd.psc_touched, 0, sizeof(sd.psc_touched));
+        sd.tex_touched = 0;
+        sd.misc = 0;
+
+        // A pure device can't report state; nothing to diff against
+        if (!sd.probed) {
+            DWORD v = 0;
+            sd.pure = FAILED(dev->GetRenderState(D3DRS_ZENABLE, &v));
+            sd.probed = true;
+            if (sd.pure)
+                zm_sd_dbgf("[ZeroMod] state delta: pure device, using D3DSBT_ALL\n");
+        }
+
+        if (!ZM_STATE_DELTA || sd.pure) {
+            if (SUCCEEDED(dev->CreateStateBlock(D3DSBT_ALL, &sd.full)) && sd.full)
+                sd.full->Capture();
+            else
+                sd.full = nullptr;
+            sd.fallbacks++;
+        }
+    }
+
+    static void sd_restore_consts(
+        zm_state_delta& sd,
+        const uint32_t* touched,
+        const float (*saved)[4],
+        unsigned max_regs,
+        bool ps)
+    {
+        // One Set* per contiguous run of touched registers
+        unsigned r = 0;
+        while (r < max_regs)
+        {
+            if (!((touched[r >> 5] >> (r & 31)) & 1u)) { ++r; continue; }
+
+            const unsigned first = r;
+            while (r < max_regs && ((touched[r >> 5] >> (r & 31)) & 1u))
+                ++r;
+
+            if (ps) sd.dev->SetPixelShaderConstantF(first, saved[first], r - first);
+            else    sd.dev->SetVertexShaderConstantF(first, saved[first], r - first);
+            sd.restore_calls++;
+        }
+    }
+
+    void sd_end(zm_state_delta& sd)
+    {
+        IDirect3DDevice9* dev = sd.dev;
+        if (!dev)
+            return;
+
+        if (sd.full) {
+            sd.full->Apply();
+            sd.full->Release();
+            sd.full = nullptr;
+        }
+        else {
+            // RT first: SetRenderTarget resets the viewport
+            if (sd.misc & ZM_SD_RT0) { dev->SetRenderTarget(0, sd.rt0); sd.restore_calls++; sd_release(sd.rt0); }
+            if (sd.misc & ZM_SD_DS) { dev->SetDepthStencilSurface(sd.ds); sd.restore_calls++; sd_release(sd.ds); }
+            if (sd.misc & ZM_SD_VIEWPORT) { dev->SetViewport(&sd.vp); sd.restore_calls++; }
+            if (sd.misc & ZM_SD_SCISSOR) { dev->SetScissorRect(&sd.scissor); sd.restore_calls++; }
+            if (sd.misc & ZM_SD_VS) { dev->SetVertexShader(sd.vs); sd.restore_calls++; sd_release(sd.vs); }
+            if (sd.misc & ZM_SD_PS) { dev->SetPixelShader(sd.ps); sd.restore_calls++; sd_release(sd.ps); }
+            // decl and FVF overwrite each other; put back whichever the caller had
+            if (sd.misc & ZM_SD_DECL) {
+                if (sd.decl || !(sd.misc & ZM_SD_FVF)) { dev->SetVertexDeclaration(sd.decl); sd.restore_calls++; }
+                sd_release(sd.decl);
+            }
+            if (sd.misc & ZM_SD_FVF) {
+                if (!(sd.misc & ZM_SD_DECL) || !sd.decl) { dev->SetFVF(sd.fvf); sd.restore_calls++; }
+            }
+            if (sd.misc & ZM_SD_STREAM0) {
+                dev->SetStreamSource(0, sd.vb0, sd.vb0_offset, sd.vb0_stride);
+                sd.restore_calls++;
+                sd_release(sd.vb0);
+            }
+
+            for (unsigned s = 0; s < ZM_SD_MAX_STAGES; ++s)
+            {
+                if ((sd.tex_touched >> s) & 1u) {
+                    dev->SetTexture(s, sd.tex[s]);
+                    sd.restore_calls++;
+                    sd_release(sd.tex[s]);
+                }
+                uint32_t m = sd.samp_touched[s];
+                for (unsigned t = 0; m; ++t, m >>= 1) {
+                    if (!(m & 1u)) continue;
+                    dev->SetSamplerState(s, (D3DSAMPLERSTATETYPE)t, sd.samp[s][t]);
+                    sd.restore_calls++;
+                }
+            }
+            for (unsigned s = 0; s < ZM_SD_MAX_TSS_STAGES; ++s)
+            {
+                uint64_t m = sd.tss_touched[s];
+                for (unsigned t = 0; m; ++t, m >>= 1) {
+                    if (!(m & 1ull)) continue;
+                    dev->SetTextureStageState(s, (D3DTEXTURESTAGESTATETYPE)t, sd.tss[s][t]);
+                    sd.restore_calls++;
+                }
+            }
+            for (unsigned w = 0; w < ZM_SD_MAX_RS / 32; ++w)
+            {
+                uint32_t m = sd.rs_touched[w];
+                for (unsigned r = w * 32; m; ++r, m >>= 1) {
+                    if (!(m & 1u)) continue;
+                    dev->SetRenderState((D3DRENDERSTATETYPE)r, sd.rs[r]);
+                    sd.restore_calls++;
+                }
+            }
+
+            sd_restore_consts(sd, sd.vsc_touched, sd.vsc, ZM_SD_MAX_VS_CONSTS, false);
+            sd_restore_consts(sd, sd.psc_touched, sd.psc, ZM_SD_MAX_PS_CONSTS, true);
+        }
+
+        sd.misc = 0;
+        sd.tex_touched = 0;
+        sd.dev = nullptr;
+
+        sd.save_total += sd.save_calls;
+        sd.restore_total += sd.restore_calls;
+
+#if ZM_STATE_DELTA_STATS_INTERVAL
+        if (++sd.frames >= ZM_STATE_DELTA_STATS_INTERVAL)
+        {
+            const double f = (double)sd.frames;
+            zm_sd_dbgf("[ZeroMod] state delta: %.1f saved + %.1f restored/frame "
+                "(%u frames, %u full-block fallbacks)\n",
+                (double)sd.save_total / f,
+                (double)sd.restore_total / f,
+                sd.frames, sd.fallbacks);
+            sd.save_total = 0;
+            sd.restore_total = 0;
+            sd.frames = 0;
+            sd.fallbacks = 0;
+        }
+#endif
+    }
+
+    HRESULT sd_rs(zm_state_delta& sd, D3DRENDERSTATETYPE state, DWORD value)
+    {
+        const unsigned r = (unsigned)state;
+        if (sd_tracking(sd) && r < ZM_SD_MAX_RS && !((sd.rs_touched[r >> 5] >> (r & 31)) & 1u)) {
+            sd.dev->GetRenderState(state, &sd.rs[r]);
+            sd.rs_touched[r >> 5] |= 1u << (r & 31);
+            sd.save_calls++;
+        }
+        return sd.dev ? sd.dev->SetRenderState(state, value) : D3DERR_INVALIDCALL;
+    }
+
+    HRESULT sd_sampler(zm_state_delta& sd, DWORD stage, D3DSAMPLERSTATETYPE type, DWORD value)
+    {
+        const unsigned t = (unsigned)type;
+        if (sd_tracking(sd) && stage < ZM_SD_MAX_STAGES && t < ZM_SD_MAX_SAMP &&
+            !((sd.samp_touched[stage] >> t) & 1u))
+        {
+            sd.dev->GetSamplerState(stage, type, &sd.samp[stage][t]);
+            sd.samp_touched[stage] |= 1u << t;
+            sd.save_calls++;
+        }
+        return sd.dev ? sd.dev->SetSamplerState(stage, type, value) : D3DERR_INVALIDCALL;
+    }
+
+    HRESULT sd_tss(zm_state_delta& sd, DWORD stage, D3DTEXTURESTAGESTATETYPE type, DWORD value)
+    {
+        const unsigned t = (unsigned)type;
+        if (sd_tracking(sd) && stage < ZM_SD_MAX_TSS_STAGES && t < ZM_SD_MAX_TSS &&
+            !((sd.tss_touched[stage] >> t) & 1ull))
+        {
+            sd.dev->GetTextureStageState(stage, type, &sd.tss[stage][t]);
+            sd.tss_touched[stage] |= 1ull << t;
+            sd.save_calls++;
+        }
+        return sd.dev ? sd.dev->SetTextureStageState(stage, type, value) : D3DERR_INVALIDCALL;
+    }
+
+    HRESULT sd_texture(zm_state_delta& sd, DWORD stage, IDirect3DBaseTexture9* tex)
+    {
+        if (sd_tracking(sd) && stage < ZM_SD_MAX_STAGES && !((sd.tex_touched >> stage) & 1u)) {
+            sd.tex[stage] = nullptr;
+            sd.dev->GetTexture(stage, &sd.tex[stage]);
+            sd.tex_touched |= 1u << stage;
+            sd.save_calls++;
+        }
+        return sd.dev ? sd.dev->SetTexture(stage, tex) : D3DERR_INVALIDCALL;
+    }
+
+    static void sd_save_viewport(zm_state_delta& sd)
+    {
+        if (sd_tracking(sd) && !(sd.misc & ZM_SD_VIEWPORT)) {
+            sd.dev->GetViewport(&sd.vp);
+            sd.misc |= ZM_SD_VIEWPORT;
+            sd.save_calls++;
+        }
+    }
+
+    HRESULT sd_rt(zm_state_delta& sd, IDirect3DSurface9* surf)
+    {
+        if (sd_tracking(sd) && !(sd.misc & ZM_SD_RT0)) {
+            sd.rt0 = nullptr;
+            sd.dev->GetRenderTarget(0, &sd.rt0);
+            sd.misc |= ZM_SD_RT0;
+            sd.save_calls++;
+        }
+        sd_save_viewport(sd);
+        return sd.dev ? sd.dev->SetRenderTarget(0, surf) : D3DERR_INVALIDCALL;
+    }
+
+    HRESULT sd_ds(zm_state_delta& sd, IDirect3DSurface9* surf)
+    {
+        if (sd_tracking(sd) && !(sd.misc & ZM_SD_DS)) {
+            sd.ds = nullptr;
+            sd.dev->GetDepthStencilSurface(&sd.ds);
+            sd.misc |= ZM_SD_DS;
+            sd.save_calls++;
+        }
+        return sd.dev ? sd.dev->SetDepthStencilSurface(surf) : D3DERR_INVALIDCALL;
+    }
+
+    HRESULT sd_viewport(zm_state_delta& sd, const D3DVIEWPORT9& vp)
+    {
+        sd_save_viewport(sd);
+        return sd.dev ? sd.dev->SetViewport(&vp) : D3DERR_INVALIDCALL;
+    }
+
+    HRESULT sd_scissor(zm_state_delta& sd, const RECT& rc)
+    {
+        if (sd_tracking(sd) && !(sd.misc & ZM_SD_SCISSOR)) {
+            sd.dev->GetScissorRect(&sd.scissor);
+            sd.misc |= ZM_SD_SCISSOR;
+            sd.save_calls++;
+        }
+        return sd.dev ? sd.dev->SetScissorRect(&rc) : D3DERR_INVALIDCALL;
+    }
+
+    HRESULT sd_vs(zm_state_delta& sd, IDirect3DVertexShader9* vs)
+    {
+        if (sd_tracking(sd) && !(sd.misc & ZM_SD_VS)) {
+            sd.vs = nullptr;
+            sd.dev->GetVertexShader(&sd.vs);
+            sd.misc |= ZM_SD_VS;
+            sd.save_calls++;
+        }
+        return sd.dev ? sd.dev->SetVertexShader(vs) : D3DERR_INVALIDCALL;
+    }
+
+    HRESULT sd_ps(zm_state_delta& sd, IDirect3DPixelShader9* ps)
+    {
+        if (sd_tracking(sd) && !(sd.misc & ZM_SD_PS)) {
+            sd.ps = nullptr;
+            sd.dev->GetPixelShader(&sd.ps);
+            sd.misc |= ZM_SD_PS;
+            sd.save_calls++;
+        }
+        return sd.dev ? sd.dev->SetPixelShader(ps) : D3DERR_INVALIDCALL;
+    }
+
+    // Setting either one clobbers the other, so both are saved together
+    static void sd_save_input_layout(zm_state_delta& sd)
+    {
+        if (!sd_tracking(sd) || (sd.misc & ZM_SD_DECL))
+            return;
+        sd.decl = nullptr;
+        sd.dev->GetVertexDeclaration(&sd.decl);
+        sd.dev->GetFVF(&sd.fvf);
+        sd.misc |= ZM_SD_DECL | ZM_SD_FVF;
+        sd.save_calls += 2;
+    }
+
+    HRESULT sd_decl(zm_state_delta& sd, IDirect3DVertexDeclaration9* decl)
+    {
+        sd_save_input_layout(sd);
+        return sd.dev ? sd.dev->SetVertexDeclaration(decl) : D3DERR_INVALIDCALL;
+    }
+
+    HRESULT sd_fvf(zm_state_delta& sd, DWORD fvf)
+    {
+        sd_save_input_layout(sd);
+        return sd.dev ? sd.dev->SetFVF(fvf) : D3DERR_INVALIDCALL;
+    }
+
+    HRESULT sd_stream0(zm_state_delta& sd, IDirect3DVertexBuffer9* vb, UINT offset, UINT stride)
+    {
+        if (sd_tracking(sd) && !(sd.misc & ZM_SD_STREAM0)) {
+            sd.vb0 = nullptr;
+            sd.vb0_offset = sd.vb0_stride = 0;
+            sd.dev->GetStreamSource(0, &sd.vb0, &sd.vb0_offset, &sd.vb0_stride);
+            sd.misc |= ZM_SD_STREAM0;
+            sd.save_calls++;
+        }
+        return sd.dev ? sd.dev->SetStreamSource(0, vb, offset, stride) : D3DERR_INVALIDCALL;
+    }
+
+    static void sd_touch_consts(
+        zm_state_delta& sd,
+        uint32_t* touched,
+        float (*saved)[4],
+        unsigned max_regs,
+        UINT first,
+        UINT count,
+        bool ps)
+    {
+        if (!sd_tracking(sd) || first >= max_regs)
+            return;
+        if (count > max_regs - first)
+            count = max_regs - first;
+
+        // One Get* per contiguous run not saved yet
+        unsigned r = first;
+        const unsigned end = first + count;
+        while (r < end)
+        {
+            if ((touched[r >> 5] >> (r & 31)) & 1u) { ++r; continue; }
+
+            const unsigned run = r;
+            while (r < end && !((touched[r >> 5] >> (r & 31)) & 1u)) {
+                touched[r >> 5] |= 1u << (r & 31);
+                ++r;
+            }
+
+            if (ps) sd.dev->GetPixelShaderConstantF(run, saved[run], r - run);
+            else    sd.dev->GetVertexShaderConstantF(run, saved[run], r - run);
+            sd.save_calls++;
+        }
+    }
+
+    void sd_touch_vs_consts(zm_state_delta& sd, UINT first, UINT count)
+    {
+        sd_touch_consts(sd, sd.vsc_touched, sd.vsc, ZM_SD_MAX_VS_CONSTS, first, count, false);
+    }
+
+    void sd_touch_ps_consts(zm_state_delta& sd, UINT first, UINT count)
+    {
+        sd_touch_consts(sd, sd.psc_touched, sd.psc, ZM_SD_MAX_PS_CONSTS, first, count, true);
+    }
+
+    HRESULT sd_vs_consts(zm_state_delta& sd, UINT first, const float* data, UINT count)
+    {
+        sd_touch_vs_consts(sd, first, count);
+        return sd.dev ? sd.dev->SetVertexShaderConstantF(first, data, count) : D3DERR_INVALIDCALL;
+    }
+
+    HRESULT sd_ps_consts(zm_state_delta& sd, UINT first, const float* data, UINT count)
+    {
+        sd_touch_ps_consts(sd, first, count);
+        return sd.dev ? sd.dev->SetPixelShaderConstantF(first, data, count) : D3DERR_INVALIDCALL;
+    }
+
+} // namespace ZeroMod
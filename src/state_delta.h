@@ -0,0 +1,116 @@
+#pragma once
+#include <d3d9.h>
+#include <stdint.h>
+
+// ---- Minimal-delta state save/restore ----
+// Injected draws (slang chain, overlay composite) change device state
+// through a zm_state_delta instead of running inside a D3DSBT_ALL state
+// block. The first write to a state reads its current value once; sd_end
+// puts back exactly the states that were written and nothing else.
+// A pure device (Get* unsupported) falls back to a D3DSBT_ALL block.
+// Set ZM_STATE_DELTA to 0 to always use the full state block.
+#define ZM_STATE_DELTA 1
+// Log save/restore counters every N injected frames (0 = never)
+#define ZM_STATE_DELTA_STATS_INTERVAL 600
+
+#define ZM_SD_MAX_RS 256            // D3DRENDERSTATETYPE
+#define ZM_SD_MAX_STAGES 16         // PS texture/sampler stages
+#define ZM_SD_MAX_SAMP 14           // D3DSAMPLERSTATETYPE
+#define ZM_SD_MAX_TSS_STAGES 8
+#define ZM_SD_MAX_TSS 33            // D3DTEXTURESTAGESTATETYPE
+#define ZM_SD_MAX_VS_CONSTS 256
+#define ZM_SD_MAX_PS_CONSTS 224
+
+namespace ZeroMod {
+
+    // Single-valued states, one bit each in zm_state_delta::misc
+    enum : uint32_t {
+        ZM_SD_RT0 = 1u << 0,
+        ZM_SD_DS = 1u << 1,
+        ZM_SD_VIEWPORT = 1u << 2,
+        ZM_SD_SCISSOR = 1u << 3,
+        ZM_SD_VS = 1u << 4,
+        ZM_SD_PS = 1u << 5,
+        ZM_SD_DECL = 1u << 6,
+        ZM_SD_FVF = 1u << 7,
+        ZM_SD_STREAM0 = 1u << 8,
+    };
+
+    struct zm_state_delta
+    {
+        IDirect3DDevice9* dev;      // null outside a begin/end scope
+        IDirect3DStateBlock9* full; // pure-device fallback
+        bool probed;
+        bool pure;
+
+        // touched bits + the value each state had before its first write
+        uint32_t rs_touched[ZM_SD_MAX_RS / 32];
+        DWORD rs[ZM_SD_MAX_RS];
+
+        uint32_t samp_touched[ZM_SD_MAX_STAGES];
+        DWORD samp[ZM_SD_MAX_STAGES][ZM_SD_MAX_SAMP];
+
+        uint64_t tss_touched[ZM_SD_MAX_TSS_STAGES];
+        DWORD tss[ZM_SD_MAX_TSS_STAGES][ZM_SD_MAX_TSS];
+
+        uint32_t tex_touched;
+        IDirect3DBaseTexture9* tex[ZM_SD_MAX_STAGES];
+
+        uint32_t misc;              // ZM_SD_*
+        IDirect3DSurface9* rt0;
+        IDirect3DSurface9* ds;
+        D3DVIEWPORT9 vp;
+        RECT scissor;
+        IDirect3DVertexShader9* vs;
+        IDirect3DPixelShader9* ps;
+        IDirect3DVertexDeclaration9* decl;
+        DWORD fvf;
+        IDirect3DVertexBuffer9* vb0;
+        UINT vb0_offset, vb0_stride;
+
+        uint32_t vsc_touched[ZM_SD_MAX_VS_CONSTS / 32];
+        float vsc[ZM_SD_MAX_VS_CONSTS][4];
+        uint32_t psc_touched[ZM_SD_MAX_PS_CONSTS / 32];
+        float psc[ZM_SD_MAX_PS_CONSTS][4];
+
+        // Get*/Set* calls issued by the delta (this scope, then running totals)
+        unsigned save_calls;
+        unsigned restore_calls;
+        uint64_t save_total;
+        uint64_t restore_total;
+        unsigned frames;
+        unsigned fallbacks;
+    };
+
+    inline bool sd_active(const zm_state_delta& sd) { return sd.dev != nullptr; }
+
+    // Open a scope on 'dev'. Nothing is read until a state is written.
+    void sd_begin(zm_state_delta& sd, IDirect3DDevice9* dev);
+
+    // Restore every state written since sd_begin and close the scope.
+    void sd_end(zm_state_delta& sd);
+
+    // Write-through setters; the first write to a state saves its old value.
+    // Only valid inside a scope (D3DERR_INVALIDCALL otherwise).
+    HRESULT sd_rs(zm_state_delta& sd, D3DRENDERSTATETYPE state, DWORD value);
+    HRESULT sd_sampler(zm_state_delta& sd, DWORD stage, D3DSAMPLERSTATETYPE type, DWORD value);
+    HRESULT sd_tss(zm_state_delta& sd, DWORD stage, D3DTEXTURESTAGESTATETYPE type, DWORD value);
+    HRESULT sd_texture(zm_state_delta& sd, DWORD stage, IDirect3DBaseTexture9* tex);
+    HRESULT sd_rt(zm_state_delta& sd, IDirect3DSurface9* surf);    // RT0; also saves the viewport it resets
+    HRESULT sd_ds(zm_state_delta& sd, IDirect3DSurface9* surf);
+    HRESULT sd_viewport(zm_state_delta& sd, const D3DVIEWPORT9& vp);
+    HRESULT sd_scissor(zm_state_delta& sd, const RECT& rc);
+    HRESULT sd_vs(zm_state_delta& sd, IDirect3DVertexShader9* vs);
+    HRESULT sd_ps(zm_state_delta& sd, IDirect3DPixelShader9* ps);
+    HRESULT sd_decl(zm_state_delta& sd, IDirect3DVertexDeclaration9* decl);
+    HRESULT sd_fvf(zm_state_delta& sd, DWORD fvf);
+    HRESULT sd_stream0(zm_state_delta& sd, IDirect3DVertexBuffer9* vb, UINT offset, UINT stride);
+    HRESULT sd_vs_consts(zm_state_delta& sd, UINT first, const float* data, UINT count);
+    HRESULT sd_ps_consts(zm_state_delta& sd, UINT first, const float* data, UINT count);
+
+    // For writes that bypass the setters (ID3DXConstantTable): save the
+    // register range now so sd_end puts it back.
+    void sd_touch_vs_consts(zm_state_delta& sd, UINT first, UINT count);
+    void sd_touch_ps_consts(zm_state_delta& sd, UINT first, UINT count);
+
+} // namespace ZeroMod
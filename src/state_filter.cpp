@@ -0,0 +1,170 @@
+#include "state_filter.h"
+
+#include <windows.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace ZeroMod {
+
+    static void zm_sf_dbgf(const char* fmt, ...)
+    {
+        char b[512];
+        va_list va;
+        va_start(va, fmt);
+        _vsnprintf(b, sizeof(b), fmt, va);
+        va_end(va);
+        b[sizeof(b) - 1] = '\0';
+        OutputDebugStringA(b);
+    }
+
+    // Sampler/texture stage -> shadow slot, -1 = not tracked
+    static int sf_slot(DWORD stage)
+    {
+        if (stage < 16)
+            return (int)stage;
+        if (stage == D3DDMAPSAMPLER)
+            return 16;
+        if (stage >= D3DVERTEXTEXTURESAMPLER0 && stage <= D3DVERTEXTEXTURESAMPLER3)
+            return 17 + (int)(stage - D3DVERTEXTEXTURESAMPLER0);
+        return -1;
+    }
+
+    static bool sf_pass(zm_state_filter& sf)
+    {
+        sf.forwarded++;
+        return true;
+    }
+
+    bool sf_rs(zm_state_filter& sf, D3DRENDERSTATETYPE state, DWORD value)
+    {
+        const unsigned r = (unsigned)state;
+        if (!ZM_STATE_FILTER || sf.recording || r >= ZM_SF_MAX_RS)
+            return sf_pass(sf);
+
+        uint32_t& known = sf.rs_known[r >> 5];
+        const uint32_t bit = 1u << (r & 31);
+        if ((known & bit) && sf.rs[r] == value) {
+            sf.filtered++;
+            return false;
+        }
+        sf.rs[r] = value;
+        known |= bit;
+        return sf_pass(sf);
+    }
+
+    bool sf_sampler(zm_state_filter& sf, DWORD sampler, D3DSAMPLERSTATETYPE type, DWORD value)
+    {
+        const int s = sf_slot(sampler);
+        const unsigned t = (unsigned)type;
+        if (!ZM_STATE_FILTER || sf.recording || s < 0 || t >= ZM_SF_MAX_SAMP)
+            return sf_pass(sf);
+
+        const uint32_t bit = 1u << t;
+        if ((sf.samp_known[s] & bit) && sf.samp[s][t] == value) {
+            sf.filtered++;
+            return false;
+        }
+        sf.samp[s][t] = value;
+        sf.samp_known[s] |= bit;
+        return sf_pass(sf);
+    }
+
+    bool sf_tss(zm_state_filter& sf, DWORD stage, D3DTEXTURESTAGESTATETYPE type, DWORD value)
+    {
+        const unsigned t = (unsigned)type;
+        if (!ZM_STATE_FILTER || sf.recording || stage >= ZM_SF_TSS_STAGES || t >= ZM_SF_MAX_TSS)
+            return sf_pass(sf);
+
+        const uint64_t bit = 1ull << t;
+        if ((sf.tss_known[stage] & bit) && sf.tss[stage][t] == value) {
+            sf.filtered++;
+            return false;
+        }
+        sf.tss[stage][t] = value;
+        sf.tss_known[stage] |= bit;
+        return sf_pass(sf);
+    }
+
+    bool sf_texture(zm_state_filter& sf, DWORD stage, IDirect3DBaseTexture9* tex)
+    {
+        const int s = sf_slot(stage);
+        if (!ZM_STATE_FILTER || sf.recording || s < 0)
+            return sf_pass(sf);
+
+        // The device holds a reference to the bound texture, so the pointer
+        // can't be recycled while the shadow says it is bound.
+        const uint32_t bit = 1u << s;
+        if ((sf.tex_known & bit) && sf.tex[s] == tex) {
+            sf.filtered++;
+            return false;
+        }
+        sf.tex[s] = tex;
+        sf.tex_known |= bit;
+        return sf_pass(sf);
+    }
+
+    void sf_invalidate(zm_state_filter& sf)
+    {
+        memset(sf.rs_known, 0, sizeof(sf.rs_known));
+        memset(sf.samp_known, 0, sizeof(sf.samp_known));
+        memset(sf.tss_known, 0, sizeof(sf.tss_known));
+        sf.tex_known = 0;
+    }
+
+    void sf_invalidate_rs(zm_state_filter& sf, D3DRENDERSTATETYPE state)
+    {
+        const unsigned r = (unsigned)state;
+        if (r < ZM_SF_MAX_RS)
+            sf.rs_known[r >> 5] &= ~(1u << (r & 31));
+    }
+
+    void sf_invalidate_sampler(zm_state_filter& sf, DWORD sampler)
+    {
+        const int s = sf_slot(sampler);
+        if (s >= 0)
+            sf.samp_known[s] = 0;
+    }
+
+    void sf_invalidate_texture(zm_state_filter& sf, DWORD stage)
+    {
+        const int s = sf_slot(stage);
+        if (s >= 0)
+            sf.tex_known &= ~(1u << s);
+    }
+
+    void sf_begin_record(zm_state_filter& sf)
+    {
+        sf.recording = true;
+    }
+
+    void sf_end_record(zm_state_filter& sf)
+    {
+        sf.recording = false;
+    }
+
+    void sf_frame_end(zm_state_filter& sf)
+    {
+        sf.filtered_total += sf.filtered;
+        sf.forwarded_total += sf.forwarded;
+        sf.filtered = 0;
+        sf.forwarded = 0;
+
+#if ZM_STATE_FILTER_STATS_INTERVAL
+        if (++sf.frames >= ZM_STATE_FILTER_STATS_INTERVAL)
+        {
+            const double f = (double)sf.frames;
+            const uint64_t all = sf.filtered_total + sf.forwarded_total;
+            zm_sf_dbgf("[ZeroMod] state filter: %.1f filtered + %.1f forwarded/frame (%.1f%% redundant, %u frames)\n",
+                (double)sf.filtered_total / f,
+                (double)sf.forwarded_total / f,
+                all ? 100.0 * (double)sf.filtered_total / (double)all : 0.0,
+                sf.frames);
+            sf.filtered_total = 0;
+            sf.forwarded_total = 0;
+            sf.frames = 0;
+        }
+#endif
+    }
+
+} // namespace ZeroMod
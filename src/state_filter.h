@@ -0,0 +1,68 @@
+#pragma once
+#include <d3d9.h>
+#include <stdint.h>
+
+// ---- Redundant state filter ----
+// Flat shadow of the render, sampler and texture-stage states and bound
+// textures the game sets through MyID3D9Device. A Set* whose value already
+// matches the shadow is dropped before it reaches the driver. Anything
+// that changes device state behind the proxy's back (Reset, state block
+// Apply, the proxy's own direct writes) invalidates the affected entries.
+// Set ZM_STATE_FILTER to 0 to forward every call.
+#define ZM_STATE_FILTER 1
+// Log filtered/forwarded counters every N presented frames (0 = never)
+#define ZM_STATE_FILTER_STATS_INTERVAL 600
+
+#define ZM_SF_MAX_RS 256            // D3DRENDERSTATETYPE
+#define ZM_SF_SAMPLERS 21           // PS 0-15, D3DDMAPSAMPLER, D3DVERTEXTEXTURESAMPLER0-3
+#define ZM_SF_MAX_SAMP 14           // D3DSAMPLERSTATETYPE
+#define ZM_SF_TSS_STAGES 8
+#define ZM_SF_MAX_TSS 33            // D3DTEXTURESTAGESTATETYPE
+
+namespace ZeroMod {
+
+    struct zm_state_filter
+    {
+        // known bits: the shadow value is what the device has
+        uint32_t rs_known[ZM_SF_MAX_RS / 32];
+        DWORD rs[ZM_SF_MAX_RS];
+
+        uint32_t samp_known[ZM_SF_SAMPLERS];
+        DWORD samp[ZM_SF_SAMPLERS][ZM_SF_MAX_SAMP];
+
+        uint64_t tss_known[ZM_SF_TSS_STAGES];
+        DWORD tss[ZM_SF_TSS_STAGES][ZM_SF_MAX_TSS];
+
+        uint32_t tex_known;
+        IDirect3DBaseTexture9* tex[ZM_SF_SAMPLERS];   // compared only, no reference held
+
+        // Between BeginStateBlock/EndStateBlock calls are recorded, not applied
+        bool recording;
+
+        unsigned filtered;          // this frame
+        unsigned forwarded;
+        uint64_t filtered_total;
+        uint64_t forwarded_total;
+        unsigned frames;
+    };
+
+    // True if the call must reach the device; the shadow then takes 'value'.
+    // False means the device already has it.
+    bool sf_rs(zm_state_filter& sf, D3DRENDERSTATETYPE state, DWORD value);
+    bool sf_sampler(zm_state_filter& sf, DWORD sampler, D3DSAMPLERSTATETYPE type, DWORD value);
+    bool sf_tss(zm_state_filter& sf, DWORD stage, D3DTEXTURESTAGESTATETYPE type, DWORD value);
+    bool sf_texture(zm_state_filter& sf, DWORD stage, IDirect3DBaseTexture9* tex);
+
+    // Forget what the device holds (after a direct write or a failed Set*)
+    void sf_invalidate(zm_state_filter& sf);
+    void sf_invalidate_rs(zm_state_filter& sf, D3DRENDERSTATETYPE state);
+    void sf_invalidate_sampler(zm_state_filter& sf, DWORD sampler);
+    void sf_invalidate_texture(zm_state_filter& sf, DWORD stage);
+
+    void sf_begin_record(zm_state_filter& sf);
+    void sf_end_record(zm_state_filter& sf);
+
+    // Per-frame counters (call from Present)
+    void sf_frame_end(zm_state_filter& sf);
+
+} // namespace ZeroMod
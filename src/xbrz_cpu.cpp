@@ -0,0 +1,307 @@
+#include "xbrz_cpu.h"
+
+#include <math.h>
+#include <string.h>
+
+#if ZM_XBRZ_SIMD && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define XB_X86 1
+#include <immintrin.h>
+#else
+#define XB_X86 0
+#endif
+
+namespace ZeroMod {
+
+    // xbrz-freescale.slang constants
+    static const float XB_WR = 0.2627f;
+    static const float XB_WG = 0.6780f;
+    static const float XB_WB = 0.0593f;
+    static const float XB_SCALE_B = 0.5f / (1.0f - 0.0593f);
+    static const float XB_SCALE_R = 0.5f / (1.0f - 0.2627f);
+    static const float XB_EQUAL_TOLERANCE = 30.0f / 255.0f;
+    static const float XB_STEEP_THRESHOLD = 2.2f;
+    static const float XB_DOMINANT_THRESHOLD = 3.6f;
+
+    // Code byte of a corner; byte 0..3 = z, w, y, x (bottom right, bottom
+    // left, top right, top left), the order the shader mixes them in
+    enum : uint32_t {
+        XB_ON = 1,          // blendResult != BLEND_NONE
+        XB_LINE = 2,        // doLineBlend
+        XB_SHALLOW = 4,     // haveShallowLine
+        XB_STEEP = 8,       // haveSteepLine
+        XB_PICK = 16,       // blendPix is the second neighbour below
+    };
+
+    // Weight shapes per corner: plain, line, line + shallow, line + steep, both
+    enum { XB_SHAPES = 5 };
+
+    // blendPix candidates per corner as (dx, dy): mix(first, second, step(...))
+    static const int xb_pick[4][2][2] = {
+        { { 0, 1 }, { 1, 0 } },     // z: H, F
+        { { 0, 1 }, { -1, 0 } },    // w: H, D
+        { { 1, 0 }, { 0, -1 } },    // y: F, B
+        { { -1, 0 }, { 0, -1 } },   // x: D, B
+    };
+
+    // ---- scalar ----
+    namespace xb_scalar {
+
+        typedef float V;
+        typedef bool M;
+        typedef uint32_t I;
+        enum { LANES = 1 };
+
+        static inline V ld(const float* p) { return *p; }
+        static inline V set(float v) { return v; }
+        static inline V add(V a, V b) { return a + b; }
+        static inline V sub(V a, V b) { return a - b; }
+        static inline V mul(V a, V b) { return a * b; }
+        static inline V root(V a) { return sqrtf(a); }
+        static inline M lt(V a, V b) { return a < b; }
+        static inline M le(V a, V b) { return a <= b; }
+        static inline M eq(V a, V b) { return a == b; }
+        static inline M both(M a, M b) { return a && b; }
+        static inline M either(M a, M b) { return a || b; }
+        static inline M but(M a, M b) { return a && !b; }
+        static inline M not_(M a) { return !a; }
+        static inline I bits(M m, uint32_t v) { return m ? v : 0; }
+        static inline I ior(I a, I b) { return a | b; }
+        static inline void st(uint32_t* p, I v) { *p = v; }
+
+#include "xbrz_cpu_kernel.h"
+
+    } // namespace xb_scalar
+
+#if XB_X86
+
+    // ---- SSE4.1, 4 texels ----
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+    namespace xb_sse41 {
+
+        typedef __m128 V;
+        typedef __m128 M;
+        typedef __m128i I;
+        enum { LANES = 4 };
+
+        static inline V ld(const float* p) { return _mm_loadu_ps(p); }
+        static inline V set(float v) { return _mm_set1_ps(v); }
+        static inline V add(V a, V b) { return _mm_add_ps(a, b); }
+        static inline V sub(V a, V b) { return _mm_sub_ps(a, b); }
+        static inline V mul(V a, V b) { return _mm_mul_ps(a, b); }
+        static inline V root(V a) { return _mm_sqrt_ps(a); }
+        static inline M lt(V a, V b) { return _mm_cmplt_ps(a, b); }
+        static inline M le(V a, V b) { return _mm_cmple_ps(a, b); }
+        static inline M eq(V a, V b) { return _mm_cmpeq_ps(a, b); }
+        static inline M both(M a, M b) { return _mm_and_ps(a, b); }
+        static inline M either(M a, M b) { return _mm_or_ps(a, b); }
+        static inline M but(M a, M b) { return _mm_andnot_ps(b, a); }
+        static inline M not_(M a) { return _mm_xor_ps(a, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+        static inline I bits(M m, uint32_t v) { return _mm_and_si128(_mm_castps_si128(m), _mm_set1_epi32((int)v)); }
+        static inline I ior(I a, I b) { return _mm_or_si128(a, b); }
+        static inline void st(uint32_t* p, I v) { _mm_storeu_si128((__m128i*)p, v); }
+
+#include "xbrz_cpu_kernel.h"
+
+    } // namespace xb_sse41
+#pragma GCC pop_options
+
+    // ---- AVX2, 8 texels ----
+#pragma GCC push_options
+#pragma GCC target("avx2")
+    namespace xb_avx2 {
+
+        typedef __m256 V;
+        typedef __m256 M;
+        typedef __m256i I;
+        enum { LANES = 8 };
+
+        static inline V ld(const float* p) { return _mm256_loadu_ps(p); }
+        static inline V set(float v) { return _mm256_set1_ps(v); }
+        static inline V add(V a, V b) { return _mm256_add_ps(a, b); }
+        static inline V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+        static inline V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+        static inline V root(V a) { return _mm256_sqrt_ps(a); }
+        static inline M lt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        static inline M le(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+        static inline M eq(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+        static inline M both(M a, M b) { return _mm256_and_ps(a, b); }
+        static inline M either(M a, M b) { return _mm256_or_ps(a, b); }
+        static inline M but(M a, M b) { return _mm256_andnot_ps(b, a); }
+        static inline M not_(M a) { return _mm256_xor_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(-1))); }
+        static inline I bits(M m, uint32_t v) { return _mm256_and_si256(_mm256_castps_si256(m), _mm256_set1_epi32((int)v)); }
+        static inline I ior(I a, I b) { return _mm256_or_si256(a, b); }
+        static inline void st(uint32_t* p, I v) { _mm256_storeu_si256((__m256i*)p, v); }
+
+#include "xbrz_cpu_kernel.h"
+
+    } // namespace xb_avx2
+#pragma GCC pop_options
+
+#endif // XB_X86
+
+    int xb_cpu_isa()
+    {
+#if XB_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return ZM_XBRZ_AVX2;
+        if (__builtin_cpu_supports("sse4.1"))
+            return ZM_XBRZ_SSE41;
+#endif
+        return ZM_XBRZ_SCALAR;
+    }
+
+    const char* xb_isa_name(int isa)
+    {
+        switch (isa) {
+        case ZM_XBRZ_AVX2: return "avx2";
+        case ZM_XBRZ_SSE41: return "sse4.1";
+        default: return "scalar";
+        }
+    }
+
+    // get_left_ratio
+    static float xb_left_ratio(float px, float py, float ox, float oy, float dx, float dy, float scale)
+    {
+        const float p0x = px - ox, p0y = py - oy;
+        const float k = (p0x * dx + p0y * dy) / (dx * dx + dy * dy);
+        const float vx = (p0x - dx * k) * scale;
+        const float vy = (p0y - dy * k) * scale;
+        const float o = p0x * -dy + p0y * dx;
+        const float side = o > 0.0f ? 1.0f : (o < 0.0f ? -1.0f : 0.0f);
+        const float v = side * sqrtf(vx * vx + vy * vy);
+
+        // smoothstep(-sqrt(2)/2, sqrt(2)/2, v)
+        const float e = sqrtf(2.0f) / 2.0f;
+        float t = (v + e) / (e + e);
+        t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+        return t * t * (3.0f - 2.0f * t);
+    }
+
+    static void xb_build_weights(zm_xbrz& x)
+    {
+        // Per corner: origin and direction without a line, the unit the
+        // line origin lies along, and what a shallow / steep line adds to
+        // the direction
+        static const float base_o[4][2] = { { 0, 1 }, { -1, 0 }, { 1, 0 }, { 0, -1 } };
+        static const float base_d[4][2] = { { 1, -1 }, { 1, 1 }, { -1, -1 }, { -1, 1 } };
+        static const float shallow_d[4][2] = { { 1, 0 }, { 0, 1 }, { 0, -1 }, { -1, 0 } };
+        static const float steep_d[4][2] = { { 0, -1 }, { 1, 0 }, { -1, 0 }, { 0, 1 } };
+
+        const uint32_t f = x.factor;
+        const uint32_t ff = f * f;
+        x.weight.assign((size_t)4 * XB_SHAPES * ff, 0.0f);
+
+        for (unsigned q = 0; q < 4; ++q) {
+            for (unsigned shape = 0; shape < XB_SHAPES; ++shape) {
+                const bool line = shape != 0;
+                const bool shallow = shape == 2 || shape == 4;
+                const bool steep = shape == 3 || shape == 4;
+
+                const float oe = line ? (shallow ? 0.25f : 0.5f) : 1.0f / sqrtf(2.0f);
+                const float ox = base_o[q][0] * oe, oy = base_o[q][1] * oe;
+                float dx = base_d[q][0], dy = base_d[q][1];
+                if (shallow) { dx += shallow_d[q][0]; dy += shallow_d[q][1]; }
+                if (steep) { dx += steep_d[q][0]; dy += steep_d[q][1]; }
+
+                float* w = &x.weight[(q * XB_SHAPES + shape) * ff];
+                for (uint32_t j = 0; j < f; ++j) {
+                    const float py = ((float)j + 0.5f) / (float)f - 0.5f;
+                    for (uint32_t k = 0; k < f; ++k) {
+                        const float px = ((float)k + 0.5f) / (float)f - 0.5f;
+                        w[j * f + k] = xb_left_ratio(px, py, ox, oy, dx, dy, (float)f);
+                    }
+                }
+            }
+        }
+    }
+
+    bool xb_init(zm_xbrz& x, uint32_t w, uint32_t h, uint32_t factor, int isa)
+    {
+        if (!w || !h || w > ZM_XBRZ_MAX_DIM || h > ZM_XBRZ_MAX_DIM)
+            return false;
+        if (factor < ZM_XBRZ_FACTOR_MIN || factor > ZM_XBRZ_FACTOR_MAX)
+            return false;
+
+        const int best = xb_cpu_isa();
+        x.isa = isa < best ? isa : best;
+        x.w = w;
+        x.h = h;
+        x.factor = factor;
+
+        // The widest load starts LANES - 1 texels before the last one and
+        // reaches two past it
+        x.stride = ((w + 7) & ~7u) + 8;
+        const size_t n = (size_t)x.stride * (h + 4);
+        x.r.assign(n, 0.0f);
+        x.g.assign(n, 0.0f);
+        x.b.assign(n, 0.0f);
+
+        xb_build_weights(x);
+        return true;
+    }
+
+    void xb_load(zm_xbrz& x, const void* bits, size_t pitch, int format)
+    {
+        for (uint32_t y = 0; y < x.h; ++y) {
+            const uint8_t* src = (const uint8_t*)bits + y * pitch;
+            const size_t row = (size_t)(y + 2) * x.stride + 2;
+            float* r = &x.r[row];
+            float* g = &x.g[row];
+            float* b = &x.b[row];
+
+            switch (format) {
+            case ZM_XBRZ_RGB565:
+                for (uint32_t i = 0; i < x.w; ++i) {
+                    uint16_t p;
+                    memcpy(&p, src + i * 2, 2);
+                    r[i] = (float)(p >> 11) / 31.0f;
+                    g[i] = (float)((p >> 5) & 63) / 63.0f;
+                    b[i] = (float)(p & 31) / 31.0f;
+                }
+                break;
+            case ZM_XBRZ_XRGB1555:
+                for (uint32_t i = 0; i < x.w; ++i) {
+                    uint16_t p;
+                    memcpy(&p, src + i * 2, 2);
+                    r[i] = (float)((p >> 10) & 31) / 31.0f;
+                    g[i] = (float)((p >> 5) & 31) / 31.0f;
+                    b[i] = (float)(p & 31) / 31.0f;
+                }
+                break;
+            default:
+                for (uint32_t i = 0; i < x.w; ++i) {
+                    r[i] = (float)src[i * 4 + 2] / 255.0f;
+                    g[i] = (float)src[i * 4 + 1] / 255.0f;
+                    b[i] = (float)src[i * 4 + 0] / 255.0f;
+                }
+                break;
+            }
+        }
+    }
+
+    void xb_run(const zm_xbrz& x, uint32_t y0, uint32_t y1, void* dst, size_t dst_pitch)
+    {
+        if (y1 > x.h)
+            y1 = x.h;
+        if (y0 >= y1)
+            return;
+
+        uint8_t* d = (uint8_t*)dst;
+        switch (x.isa) {
+#if XB_X86
+        case ZM_XBRZ_AVX2:
+            xb_avx2::run_rows(x, y0, y1, d, dst_pitch);
+            break;
+        case ZM_XBRZ_SSE41:
+            xb_sse41::run_rows(x, y0, y1, d, dst_pitch);
+            break;
+#endif
+        default:
+            xb_scalar::run_rows(x, y0, y1, d, dst_pitch);
+            break;
+        }
+    }
+
+} // namespace ZeroMod
@@ -0,0 +1,74 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// ---- xBRZ freescale on the CPU ----
+// custom/shaders/xbrz-freescale.slang (the single-pass one) at an integer
+// factor, for the CPU scaler backend (cpu_scaler.h). What the shader works
+// out again for every output pixel -- the blend of each of the four
+// corners, whether it is a line and how steep, and which neighbour it
+// blends towards -- depends only on the texel, so it is done once per
+// texel into a 32-bit code. At an integer factor the blend weights depend
+// on nothing but the corner's shape and the pixel's place in its block,
+// so they are a table built at xb_init, and an output pixel is E mixed
+// towards at most four neighbours. Texels whose code is 0 (most of a
+// frame) are a plain fill.
+//
+// The per-texel analysis runs on 8 (AVX2) or 4 (SSE4.1) texels at a time
+// when the CPU has it, chosen at xb_init; every instruction set computes
+// the same IEEE single-precision operations, so all of them give the same
+// bytes as the scalar code. Texels outside the frame are black, like the
+// runtime's clamp_to_border sampling. Source rows are independent, so
+// callers hand bands of them to threads. Nothing in here calls the OS, so
+// tools/zm_xbrz_check.cpp can drive it on Linux.
+// Output factors
+#define ZM_XBRZ_FACTOR_MIN 2
+#define ZM_XBRZ_FACTOR_MAX 6
+// Largest source edge
+#define ZM_XBRZ_MAX_DIM 1024
+// 0 builds the scalar code only
+#define ZM_XBRZ_SIMD 1
+
+namespace ZeroMod {
+
+    enum zm_xbrz_isa {
+        ZM_XBRZ_SCALAR,
+        ZM_XBRZ_SSE41,
+        ZM_XBRZ_AVX2,
+    };
+
+    enum zm_xbrz_format {
+        ZM_XBRZ_XRGB8888,       // A8R8G8B8 / X8R8G8B8
+        ZM_XBRZ_RGB565,
+        ZM_XBRZ_XRGB1555,       // A1R5G5B5 / X1R5G5B5
+    };
+
+    struct zm_xbrz
+    {
+        uint32_t w, h, factor;
+        int isa;                    // zm_xbrz_isa in use
+        uint32_t stride;            // plane row length in floats
+        // Source channels in 0..1, two texels of black around the frame
+        std::vector<float> r, g, b;
+        // [corner][shape][factor * factor] blend weights
+        std::vector<float> weight;
+    };
+
+    // Best instruction set this CPU runs
+    int xb_cpu_isa();
+    const char* xb_isa_name(int isa);
+
+    // isa: the highest to use; lowered to what the CPU has. False for a
+    // size or factor out of range.
+    bool xb_init(zm_xbrz& x, uint32_t w, uint32_t h, uint32_t factor, int isa = ZM_XBRZ_AVX2);
+
+    // The frame to scale, w x h pixels in 'format', rows 'pitch' bytes apart
+    void xb_load(zm_xbrz& x, const void* bits, size_t pitch, int format);
+
+    // Source rows [y0, y1) into output rows [y0 * factor, y1 * factor) of
+    // dst: X8R8G8B8 with alpha 255, rows 'dst_pitch' bytes apart, row 0 at
+    // dst. Safe to call for disjoint bands from several threads.
+    void xb_run(const zm_xbrz& x, uint32_t y0, uint32_t y1, void* dst, size_t dst_pitch);
+
+} // namespace ZeroMod
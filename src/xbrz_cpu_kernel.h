@@ -0,0 +1,221 @@
+// xBRZ freescale kernel body. xbrz_cpu.cpp includes this once per
+// instruction set, inside a namespace that defines the lane type V, its
+// mask M, the code vector I, LANES and the ops below, so there is no
+// include guard. Names follow custom/shaders/xbrz-freescale.slang.
+
+struct px3 { V r, g, b; };
+
+struct planes { const float* r; const float* g; const float* b; };
+
+static inline px3 tap(const planes& p, ptrdiff_t o)
+{
+    px3 c = { ld(p.r + o), ld(p.g + o), ld(p.b + o) };
+    return c;
+}
+
+// DistYCbCr; symmetric, so each pair is computed once
+static inline V dist(const px3& a, const px3& b)
+{
+    const V dr = sub(a.r, b.r);
+    const V dg = sub(a.g, b.g);
+    const V db = sub(a.b, b.b);
+    const V y = add(add(mul(dr, set(XB_WR)), mul(dg, set(XB_WG))), mul(db, set(XB_WB)));
+    const V cb = mul(set(XB_SCALE_B), sub(db, y));
+    const V cr = mul(set(XB_SCALE_R), sub(dr, y));
+    return root(add(add(mul(y, y), mul(cb, cb)), mul(cr, cr)));
+}
+
+// eq(): exact match
+static inline M same(const px3& a, const px3& b)
+{
+    return both(both(eq(a.r, b.r), eq(a.g, b.g)), eq(a.b, b.b));
+}
+
+// IsPixEqual, from the distance
+static inline M near_(V d)
+{
+    return lt(d, set(XB_EQUAL_TOLERANCE));
+}
+
+// a + b + c + d + 4 * e, in the shader's order
+static inline V sum5(V a, V b, V c, V d, V e)
+{
+    return add(add(add(add(a, b), c), d), mul(set(4.0f), e));
+}
+
+// One corner's code byte at 'shift'
+static inline I corner(M on, M line, M shallow, M steep, M pick, int shift)
+{
+    const M ln = both(on, line);
+    I c = bits(on, (uint32_t)XB_ON << shift);
+    c = ior(c, bits(ln, (uint32_t)XB_LINE << shift));
+    c = ior(c, bits(both(ln, shallow), (uint32_t)XB_SHALLOW << shift));
+    c = ior(c, bits(both(ln, steep), (uint32_t)XB_STEEP << shift));
+    return ior(c, bits(both(on, pick), (uint32_t)XB_PICK << shift));
+}
+
+// Codes for source row y, LANES texels at a time (may write up to
+// LANES - 1 past x.w)
+static void analyse_row(const zm_xbrz& x, uint32_t y, uint32_t* code)
+{
+    const ptrdiff_t s = (ptrdiff_t)x.stride;
+    const size_t row = (size_t)(y + 2) * x.stride + 2;
+    const V steep_t = set(XB_STEEP_THRESHOLD);
+    const V dominant_t = set(XB_DOMINANT_THRESHOLD);
+
+    for (uint32_t i = 0; i < x.w; i += LANES) {
+        const planes p = { &x.r[row + i], &x.g[row + i], &x.b[row + i] };
+        auto P = [&](int dx, int dy) { return tap(p, dy * s + dx); };
+
+        const px3 A = P(-1, -1), B = P(0, -1), C = P(1, -1);
+        const px3 D = P(-1, 0), E = P(0, 0), F = P(1, 0);
+        const px3 G = P(-1, 1), H = P(0, 1), I_ = P(1, 1);
+
+        const V d_GE = dist(G, E), d_EC = dist(E, C), d_HF = dist(H, F), d_DH = dist(D, H);
+        const V d_BF = dist(B, F), d_EI = dist(E, I_), d_DB = dist(D, B), d_AE = dist(A, E);
+
+        // blendResult.z (bottom right)
+        const V dist_H_F = sum5(d_GE, d_EC, dist(P(0, 2), I_), dist(I_, P(2, 0)), d_HF);
+        const V dist_E_I = sum5(d_DH, dist(H, P(1, 2)), d_BF, dist(F, P(2, 1)), d_EI);
+        const M z_skip = either(both(same(E, F), same(H, I_)), both(same(E, H), same(F, I_)));
+        const M z_on = but(but(but(lt(dist_H_F, dist_E_I), same(E, F)), same(E, H)), z_skip);
+        const M z_dom = lt(mul(dominant_t, dist_H_F), dist_E_I);
+
+        // blendResult.w (bottom left)
+        const V dist_G_E = sum5(dist(P(-2, 1), D), d_DB, dist(P(-1, 2), H), d_HF, d_GE);
+        const V dist_D_H = sum5(dist(P(-2, 0), G), dist(G, P(0, 2)), d_AE, d_EI, d_DH);
+        const M w_skip = either(both(same(D, E), same(G, H)), both(same(D, G), same(E, H)));
+        const M w_on = but(but(but(lt(dist_D_H, dist_G_E), same(E, D)), same(E, H)), w_skip);
+        const M w_dom = lt(mul(dominant_t, dist_D_H), dist_G_E);
+
+        // blendResult.y (top right)
+        const V dist_E_C = sum5(d_DB, dist(B, P(1, -2)), d_HF, dist(F, P(2, -1)), d_EC);
+        const V dist_B_F = sum5(d_AE, d_EI, dist(P(0, -2), C), dist(C, P(2, 0)), d_BF);
+        const M y_skip = either(both(same(B, C), same(E, F)), both(same(B, E), same(C, F)));
+        const M y_on = but(but(but(lt(dist_B_F, dist_E_C), same(E, B)), same(E, F)), y_skip);
+        const M y_dom = lt(mul(dominant_t, dist_B_F), dist_E_C);
+
+        // blendResult.x (top left)
+        const V dist_D_B = sum5(dist(P(-2, 0), A), dist(A, P(0, -2)), d_GE, d_EC, d_DB);
+        const V dist_A_E = sum5(dist(P(-2, -1), D), d_DH, dist(P(-1, -2), B), d_BF, d_AE);
+        const M x_skip = either(both(same(A, B), same(D, E)), both(same(A, D), same(B, E)));
+        const M x_on = but(but(but(lt(dist_D_B, dist_A_E), same(E, D)), same(E, B)), x_skip);
+        const M x_dom = lt(mul(dominant_t, dist_D_B), dist_A_E);
+
+        const M n_EG = near_(d_GE), n_EC = near_(d_EC), n_EI = near_(d_EI), n_EA = near_(d_AE);
+        const M n_GH = near_(dist(G, H)), n_HI = near_(dist(H, I_)), n_IF = near_(dist(I_, F));
+        const M n_FC = near_(dist(F, C)), n_AD = near_(dist(A, D)), n_DG = near_(dist(D, G));
+        const M n_CB = near_(dist(C, B)), n_BA = near_(dist(B, A));
+
+        I c;
+        {
+            const V d_FG = dist(F, G), d_HC = dist(H, C);
+            const M line = either(z_dom, not_(either(either(but(y_on, n_EG), but(w_on, n_EC)),
+                but(both(both(both(n_GH, n_HI), n_IF), n_FC), n_EI))));
+            const M shallow = but(but(le(mul(steep_t, d_FG), d_HC), same(E, G)), same(D, G));
+            const M steep = but(but(le(mul(steep_t, d_HC), d_FG), same(E, C)), same(B, C));
+            c = corner(z_on, line, shallow, steep, le(dist(E, F), dist(E, H)), 0);
+        }
+        {
+            const V d_HA = dist(H, A), d_DI = dist(D, I_);
+            const M line = either(w_dom, not_(either(either(but(z_on, n_EA), but(x_on, n_EI)),
+                but(both(both(both(n_AD, n_DG), n_GH), n_HI), n_EG))));
+            const M shallow = but(but(le(mul(steep_t, d_HA), d_DI), same(E, A)), same(B, A));
+            const M steep = but(but(le(mul(steep_t, d_DI), d_HA), same(E, I_)), same(F, I_));
+            c = ior(c, corner(w_on, line, shallow, steep, le(dist(E, D), dist(E, H)), 8));
+        }
+        {
+            const V d_BI = dist(B, I_), d_FA = dist(F, A);
+            const M line = either(y_dom, not_(either(either(but(x_on, n_EI), but(z_on, n_EA)),
+                but(both(both(both(n_IF, n_FC), n_CB), n_BA), n_EC))));
+            const M shallow = but(but(le(mul(steep_t, d_BI), d_FA), same(E, I_)), same(H, I_));
+            const M steep = but(but(le(mul(steep_t, d_FA), d_BI), same(E, A)), same(D, A));
+            c = ior(c, corner(y_on, line, shallow, steep, le(dist(E, B), dist(E, F)), 16));
+        }
+        {
+            const V d_DC = dist(D, C), d_BG = dist(B, G);
+            const M line = either(x_dom, not_(either(either(but(w_on, n_EC), but(y_on, n_EG)),
+                but(both(both(both(n_CB, n_BA), n_AD), n_DG), n_EA))));
+            const M shallow = but(but(le(mul(steep_t, d_DC), d_BG), same(E, C)), same(F, C));
+            const M steep = but(but(le(mul(steep_t, d_BG), d_DC), same(E, G)), same(H, G));
+            c = ior(c, corner(x_on, line, shallow, steep, le(dist(E, B), dist(E, D)), 24));
+        }
+        st(code + i, c);
+    }
+}
+
+static inline uint32_t pack(float r, float g, float b)
+{
+    return 0xFF000000u
+        | (uint32_t)(r * 255.0f + 0.5f) << 16
+        | (uint32_t)(g * 255.0f + 0.5f) << 8
+        | (uint32_t)(b * 255.0f + 0.5f);
+}
+
+static void run_rows(const zm_xbrz& x, uint32_t y0, uint32_t y1, uint8_t* dst, size_t pitch)
+{
+    uint32_t code[ZM_XBRZ_MAX_DIM + 8];
+    const uint32_t f = x.factor;
+    const uint32_t ff = f * f;
+    const ptrdiff_t s = (ptrdiff_t)x.stride;
+
+    for (uint32_t y = y0; y < y1; ++y) {
+        analyse_row(x, y, code);
+
+        const size_t row = (size_t)(y + 2) * x.stride + 2;
+        const float* r = &x.r[row];
+        const float* g = &x.g[row];
+        const float* b = &x.b[row];
+        uint8_t* out_row = dst + (size_t)y * f * pitch;
+
+        for (uint32_t i = 0; i < x.w; ++i) {
+            const uint32_t c = code[i];
+            uint32_t* out = (uint32_t*)out_row + (size_t)i * f;
+
+            if (!c) {
+                const uint32_t e = pack(r[i], g[i], b[i]);
+                for (uint32_t j = 0; j < f; ++j) {
+                    uint32_t* o = (uint32_t*)((uint8_t*)out + j * pitch);
+                    for (uint32_t k = 0; k < f; ++k)
+                        o[k] = e;
+                }
+                continue;
+            }
+
+            // The blending corners in the shader's order, with their
+            // weights and the neighbour each mixes towards
+            const float* wt[4];
+            float nr[4], ng[4], nb[4];
+            unsigned n = 0;
+            for (unsigned q = 0; q < 4; ++q) {
+                const uint32_t cq = (c >> (q * 8)) & 0xFF;
+                if (!(cq & XB_ON))
+                    continue;
+                const unsigned shape = (cq & XB_LINE)
+                    ? 1 + ((cq & XB_SHALLOW) ? 1 : 0) + ((cq & XB_STEEP) ? 2 : 0)
+                    : 0;
+                wt[n] = &x.weight[(q * XB_SHAPES + shape) * ff];
+                const int* d = xb_pick[q][(cq & XB_PICK) ? 1 : 0];
+                const ptrdiff_t at = (ptrdiff_t)i + d[1] * s + d[0];
+                nr[n] = r[at];
+                ng[n] = g[at];
+                nb[n] = b[at];
+                ++n;
+            }
+
+            for (uint32_t j = 0; j < f; ++j) {
+                uint32_t* o = (uint32_t*)((uint8_t*)out + j * pitch);
+                for (uint32_t k = 0; k < f; ++k) {
+                    float pr = r[i], pg = g[i], pb = b[i];
+                    for (unsigned q = 0; q < n; ++q) {
+                        const float t = wt[q][j * f + k];
+                        pr = pr * (1.0f - t) + nr[q] * t;
+                        pg = pg * (1.0f - t) + ng[q] * t;
+                        pb = pb * (1.0f - t) + nb[q] * t;
+                    }
+                    o[k] = pack(pr, pg, pb);
+                }
+            }
+        }
+    }
+}
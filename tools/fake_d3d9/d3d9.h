@@ -0,0 +1,152 @@
+#pragma once
+// The slice of d3d9.h that the proxy's device-side helpers (state_delta,
+// state_filter, gpu_prof, draw_binds, quad_draw) use, for building them on Linux against a fake
+// device in tools/. Interfaces are abstract classes with the real method
+// names and argument lists, so a test implements only what it records;
+// enum values match the SDK's. The texture and surface calls draw_binds
+// makes and DrawPrimitive fail unless a fake overrides them. Not a d3d9
+// implementation.
+
+#include "windows.h"
+
+typedef enum _D3DRENDERSTATETYPE {
+    D3DRS_ZENABLE = 7,
+    D3DRS_FORCE_DWORD = 0x7fffffff
+} D3DRENDERSTATETYPE;
+
+typedef enum _D3DSAMPLERSTATETYPE {
+    D3DSAMP_ADDRESSU = 1,
+    D3DSAMP_FORCE_DWORD = 0x7fffffff
+} D3DSAMPLERSTATETYPE;
+
+typedef enum _D3DTEXTURESTAGESTATETYPE {
+    D3DTSS_COLOROP = 1,
+    D3DTSS_FORCE_DWORD = 0x7fffffff
+} D3DTEXTURESTAGESTATETYPE;
+
+typedef enum _D3DSTATEBLOCKTYPE {
+    D3DSBT_ALL = 1,
+    D3DSBT_PIXELSTATE = 2,
+    D3DSBT_VERTEXSTATE = 3,
+    D3DSBT_FORCE_DWORD = 0x7fffffff
+} D3DSTATEBLOCKTYPE;
+
+typedef enum _D3DQUERYTYPE {
+    D3DQUERYTYPE_TIMESTAMP = 10,
+    D3DQUERYTYPE_TIMESTAMPDISJOINT = 11,
+    D3DQUERYTYPE_TIMESTAMPFREQ = 12,
+    D3DQUERYTYPE_FORCE_DWORD = 0x7fffffff
+} D3DQUERYTYPE;
+
+#define D3DISSUE_END (1 << 0)
+#define D3DISSUE_BEGIN (1 << 1)
+#define D3DGETDATA_FLUSH (1 << 0)
+
+typedef enum _D3DPRIMITIVETYPE {
+    D3DPT_TRIANGLELIST = 4,
+    D3DPT_TRIANGLESTRIP = 5,
+    D3DPT_FORCE_DWORD = 0x7fffffff
+} D3DPRIMITIVETYPE;
+
+typedef enum _D3DFORMAT {
+    D3DFMT_UNKNOWN = 0,
+    D3DFMT_A8R8G8B8 = 21,
+    D3DFMT_X8R8G8B8 = 22,
+    D3DFMT_FORCE_DWORD = 0x7fffffff
+} D3DFORMAT;
+
+// Only the fields the helpers read
+typedef struct _D3DSURFACE_DESC {
+    D3DFORMAT Format;
+    UINT Width;
+    UINT Height;
+} D3DSURFACE_DESC;
+
+#define D3DSPD_IUNKNOWN 0x00000001L
+
+typedef struct _D3DVIEWPORT9 {
+    DWORD X, Y, Width, Height;
+    float MinZ, MaxZ;
+} D3DVIEWPORT9;
+
+#define D3DDMAPSAMPLER 256
+#define D3DVERTEXTEXTURESAMPLER0 (D3DDMAPSAMPLER + 1)
+#define D3DVERTEXTEXTURESAMPLER1 (D3DDMAPSAMPLER + 2)
+#define D3DVERTEXTEXTURESAMPLER2 (D3DDMAPSAMPLER + 3)
+#define D3DVERTEXTEXTURESAMPLER3 (D3DDMAPSAMPLER + 4)
+
+#define D3DERR_INVALIDCALL ((HRESULT)0x8876086CL)
+#define D3DERR_NOTAVAILABLE ((HRESULT)0x8876086AL)
+#define D3DERR_DEVICELOST ((HRESULT)0x88760868L)
+
+inline const IID IID_IDirect3DTexture9 =
+    { 0x85c31227, 0x3de5, 0x4f00, { 0x9b, 0x3a, 0xf1, 0x1a, 0xc3, 0x8c, 0x18, 0xb5 } };
+
+struct IDirect3DBaseTexture9 : IUnknown
+{
+    virtual HRESULT SetPrivateData(REFGUID, const void*, DWORD, DWORD) { return D3DERR_INVALIDCALL; }
+};
+
+struct IDirect3DTexture9 : IDirect3DBaseTexture9
+{
+    virtual HRESULT GetLevelDesc(UINT, D3DSURFACE_DESC*) { return D3DERR_INVALIDCALL; }
+};
+
+struct IDirect3DSurface9 : IUnknown
+{
+    virtual HRESULT GetDesc(D3DSURFACE_DESC*) { return D3DERR_INVALIDCALL; }
+};
+struct IDirect3DVertexShader9 : IUnknown {};
+struct IDirect3DPixelShader9 : IUnknown {};
+struct IDirect3DVertexDeclaration9 : IUnknown {};
+struct IDirect3DVertexBuffer9 : IUnknown {};
+
+struct IDirect3DStateBlock9 : IUnknown
+{
+    virtual HRESULT Capture() = 0;
+    virtual HRESULT Apply() = 0;
+};
+
+struct IDirect3DQuery9 : IUnknown
+{
+    virtual HRESULT Issue(DWORD dwIssueFlags) = 0;
+    virtual HRESULT GetData(void* pData, DWORD dwSize, DWORD dwGetDataFlags) = 0;
+};
+
+struct IDirect3DDevice9 : IUnknown
+{
+    virtual HRESULT CreateStateBlock(D3DSTATEBLOCKTYPE Type, IDirect3DStateBlock9** ppSB) = 0;
+    virtual HRESULT CreateQuery(D3DQUERYTYPE Type, IDirect3DQuery9** ppQuery) = 0;
+
+    virtual HRESULT SetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget) = 0;
+    virtual HRESULT GetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9** ppRenderTarget) = 0;
+    virtual HRESULT SetDepthStencilSurface(IDirect3DSurface9* pNewZStencil) = 0;
+    virtual HRESULT GetDepthStencilSurface(IDirect3DSurface9** ppZStencilSurface) = 0;
+    virtual HRESULT SetViewport(const D3DVIEWPORT9* pViewport) = 0;
+    virtual HRESULT GetViewport(D3DVIEWPORT9* pViewport) = 0;
+    virtual HRESULT SetRenderState(D3DRENDERSTATETYPE State, DWORD Value) = 0;
+    virtual HRESULT GetRenderState(D3DRENDERSTATETYPE State, DWORD* pValue) = 0;
+    virtual HRESULT GetTexture(DWORD Stage, IDirect3DBaseTexture9** ppTexture) = 0;
+    virtual HRESULT SetTexture(DWORD Stage, IDirect3DBaseTexture9* pTexture) = 0;
+    virtual HRESULT GetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD* pValue) = 0;
+    virtual HRESULT SetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value) = 0;
+    virtual HRESULT GetSamplerState(DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD* pValue) = 0;
+    virtual HRESULT SetSamplerState(DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD Value) = 0;
+    virtual HRESULT SetScissorRect(const RECT* pRect) = 0;
+    virtual HRESULT GetScissorRect(RECT* pRect) = 0;
+    virtual HRESULT SetVertexDeclaration(IDirect3DVertexDeclaration9* pDecl) = 0;
+    virtual HRESULT GetVertexDeclaration(IDirect3DVertexDeclaration9** ppDecl) = 0;
+    virtual HRESULT SetFVF(DWORD FVF) = 0;
+    virtual HRESULT GetFVF(DWORD* pFVF) = 0;
+    virtual HRESULT SetVertexShader(IDirect3DVertexShader9* pShader) = 0;
+    virtual HRESULT GetVertexShader(IDirect3DVertexShader9** ppShader) = 0;
+    virtual HRESULT SetVertexShaderConstantF(UINT StartRegister, const float* pConstantData, UINT Vector4fCount) = 0;
+    virtual HRESULT GetVertexShaderConstantF(UINT StartRegister, float* pConstantData, UINT Vector4fCount) = 0;
+    virtual HRESULT SetStreamSource(UINT StreamNumber, IDirect3DVertexBuffer9* pStreamData, UINT OffsetInBytes, UINT Stride) = 0;
+    virtual HRESULT GetStreamSource(UINT StreamNumber, IDirect3DVertexBuffer9** ppStreamData, UINT* pOffsetInBytes, UINT* pStride) = 0;
+    virtual HRESULT SetPixelShader(IDirect3DPixelShader9* pShader) = 0;
+    virtual HRESULT GetPixelShader(IDirect3DPixelShader9** ppShader) = 0;
+    virtual HRESULT SetPixelShaderConstantF(UINT StartRegister, const float* pConstantData, UINT Vector4fCount) = 0;
+    virtual HRESULT GetPixelShaderConstantF(UINT StartRegister, float* pConstantData, UINT Vector4fCount) = 0;
+    virtual HRESULT DrawPrimitive(D3DPRIMITIVETYPE, UINT, UINT) { return D3DERR_INVALIDCALL; }
+};
@@ -0,0 +1,79 @@
+#pragma once
+// The few Win32 names the device-side helpers use, for the Linux builds
+// in tools/ (see d3d9.h next to this file).
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef uint32_t DWORD;
+typedef unsigned int UINT;
+typedef int32_t HRESULT;
+typedef int BOOL;
+typedef uint64_t UINT64;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+
+#define STDMETHODCALLTYPE
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+
+#define S_OK ((HRESULT)0)
+#define S_FALSE ((HRESULT)1)
+#define E_FAIL ((HRESULT)0x80004005L)
+#define E_POINTER ((HRESULT)0x80004003L)
+#define E_NOINTERFACE ((HRESULT)0x80004002L)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+typedef struct tagRECT {
+    int32_t left, top, right, bottom;
+} RECT;
+
+typedef struct _GUID {
+    uint32_t Data1;
+    uint16_t Data2, Data3;
+    uint8_t Data4[8];
+} GUID, IID;
+typedef const GUID& REFGUID;
+typedef const IID& REFIID;
+
+inline bool operator==(REFGUID a, REFGUID b)
+{
+    return a.Data1 == b.Data1 && a.Data2 == b.Data2 && a.Data3 == b.Data3 &&
+        memcmp(a.Data4, b.Data4, sizeof(a.Data4)) == 0;
+}
+
+inline const IID IID_IUnknown =
+    { 0x00000000, 0x0000, 0x0000, { 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+
+inline LONG InterlockedIncrement(volatile LONG* p) { return __atomic_add_fetch(p, 1, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedDecrement(volatile LONG* p) { return __atomic_sub_fetch(p, 1, __ATOMIC_SEQ_CST); }
+
+struct IUnknown
+{
+    virtual ~IUnknown() {}
+    // Fakes that hand out only one interface needn't answer
+    virtual HRESULT QueryInterface(REFIID, void** ppvObject)
+    {
+        if (ppvObject) *ppvObject = nullptr;
+        return E_NOINTERFACE;
+    }
+    virtual ULONG AddRef() = 0;
+    virtual ULONG Release() = 0;
+};
+
+#define _vsnprintf vsnprintf
+#define _snprintf snprintf
+
+// Debug output goes to stderr only when a tool asks for it
+inline bool g_fake_debug_output = false;
+inline void OutputDebugStringA(const char* s)
+{
+    if (g_fake_debug_output)
+        fputs(s, stderr);
+}
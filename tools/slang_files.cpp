@@ -0,0 +1,154 @@
+#include "slang_files.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+namespace ZeroMod {
+
+    bool read_file(const std::string& path, std::string& out)
+    {
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f) return false;
+        char buf[65536];
+        size_t n;
+        out.clear();
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+            out.append(buf, n);
+        fclose(f);
+        return true;
+    }
+
+    bool write_file(const std::string& path, const std::string& data)
+    {
+        FILE* f = fopen(path.c_str(), "wb");
+        if (!f) return false;
+        const bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+        return fclose(f) == 0 && ok;
+    }
+
+    std::string join(const std::string& from, const std::string& rel)
+    {
+        if (!rel.empty() && rel[0] == '/')
+            return rel;
+        const size_t slash = from.find_last_of('/');
+        return slash == std::string::npos ? rel : from.substr(0, slash + 1) + rel;
+    }
+
+    std::string trim(const std::string& s)
+    {
+        size_t a = 0, b = s.size();
+        while (a < b && (s[a] == ' ' || s[a] == '\t' || s[a] == '\r')) ++a;
+        while (b > a && (s[b - 1] == ' ' || s[b - 1] == '\t' || s[b - 1] == '\r')) --b;
+        std::string t = s.substr(a, b - a);
+        if (t.size() >= 2 && t.front() == '"' && t.back() == '"')
+            t = t.substr(1, t.size() - 2);
+        return t;
+    }
+
+    std::vector<std::string> lines_of(const std::string& text)
+    {
+        std::vector<std::string> out;
+        size_t at = 0;
+        while (at < text.size()) {
+            size_t nl = text.find('\n', at);
+            if (nl == std::string::npos) nl = text.size();
+            std::string l = text.substr(at, nl - at);
+            if (!l.empty() && l.back() == '\r') l.pop_back();
+            out.push_back(l);
+            at = nl + 1;
+        }
+        return out;
+    }
+
+    static bool read_preset_at(const std::string& path, std::map<std::string, std::string>& kv, int depth)
+    {
+        std::string text;
+        if (depth > ZM_SF_MAX_DEPTH || !read_file(path, text))
+            return false;
+        for (const std::string& l : lines_of(text)) {
+            if (l.compare(0, 10, "#reference") == 0) {
+                if (!read_preset_at(join(path, trim(l.substr(10))), kv, depth + 1))
+                    return false;
+                continue;
+            }
+            if (l.empty() || l[0] == '#')
+                continue;
+            const size_t eq = l.find('=');
+            if (eq == std::string::npos)
+                continue;
+            const std::string key = trim(l.substr(0, eq));
+            std::string value = trim(l.substr(eq + 1));
+            if (key.compare(0, 6, "shader") == 0 && key != "shaders")
+                value = join(path, value);
+            kv[key] = value;
+        }
+        return true;
+    }
+
+    bool read_preset(const std::string& path, std::map<std::string, std::string>& kv)
+    {
+        return read_preset_at(path, kv, 0);
+    }
+
+    static bool expand_at(const std::string& path, std::string& out, int depth)
+    {
+        std::string text;
+        if (depth > ZM_SF_MAX_DEPTH || !read_file(path, text))
+            return false;
+        for (const std::string& l : lines_of(text)) {
+            if (l.compare(0, 9, "#include ") == 0) {
+                if (!expand_at(join(path, trim(l.substr(9))), out, depth + 1))
+                    return false;
+                continue;
+            }
+            out += l;
+            out += '\n';
+        }
+        return true;
+    }
+
+    bool expand(const std::string& path, std::string& out)
+    {
+        return expand_at(path, out, 0);
+    }
+
+    void split_stages(const std::string& expanded, std::string& vs, std::string& fs)
+    {
+        int stage = 0;      // 0 shared, 1 vertex, 2 fragment
+        for (const std::string& l : lines_of(expanded)) {
+            const std::string t = trim(l);
+            if (t.compare(0, 14, "#pragma stage ") == 0) {
+                stage = t.find("vertex") != std::string::npos ? 1 : 2;
+                continue;
+            }
+            if (t.compare(0, 13, "#pragma name ") == 0 || t.compare(0, 15, "#pragma format ") == 0 ||
+                t.compare(0, 17, "#pragma parameter") == 0)
+                continue;
+            if (stage != 2) vs += l + "\n";
+            if (stage != 1) fs += l + "\n";
+        }
+    }
+
+    void find_presets(const std::string& dir, std::vector<std::string>& out)
+    {
+        DIR* d = opendir(dir.c_str());
+        if (!d)
+            return;
+        while (struct dirent* e = readdir(d)) {
+            const std::string name = e->d_name;
+            if (name == "." || name == "..")
+                continue;
+            const std::string path = dir + "/" + name;
+            struct stat st;
+            if (stat(path.c_str(), &st) != 0)
+                continue;
+            if (S_ISDIR(st.st_mode))
+                find_presets(path, out);
+            else if (name.size() > 7 && name.compare(name.size() - 7, 7, ".slangp") == 0)
+                out.push_back(path);
+        }
+        closedir(d);
+    }
+
+} // namespace ZeroMod
@@ -0,0 +1,44 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+
+// ---- Slang preset files, host side ----
+// What the slang tools need to read presets and passes the way the DLL
+// does, without RetroArch's file layer: the preset's key = value pairs with
+// #reference followed, and a pass' source with #include expanded in place
+// (slang_d3d9_pass_sources' job in the DLL). Paths are relative to the file
+// that names them, '/' separated.
+// #reference / #include nesting followed, as ZM_SPC_MAX_DEPTH
+#define ZM_SF_MAX_DEPTH 16
+
+namespace ZeroMod {
+
+    bool read_file(const std::string& path, std::string& out);
+    bool write_file(const std::string& path, const std::string& data);
+
+    // 'rel' against the directory of 'from'
+    std::string join(const std::string& from, const std::string& rel);
+
+    // Blanks off both ends, then one pair of surrounding quotes
+    std::string trim(const std::string& s);
+
+    // Split on '\n', a trailing '\r' dropped from each line
+    std::vector<std::string> lines_of(const std::string& text);
+
+    // key = value of a preset and the presets it #references; later ones
+    // win, shaderN values resolved against the file that set them
+    bool read_preset(const std::string& path, std::map<std::string, std::string>& kv);
+
+    // 'path' with every #include replaced by the file it names, appended
+    // to 'out'. False when a file can't be read or nesting is too deep.
+    bool expand(const std::string& path, std::string& out);
+
+    // The vertex and fragment halves of an expanded pass, slang pragmas
+    // dropped, like slang_preprocess
+    void split_stages(const std::string& expanded, std::string& vs, std::string& fs);
+
+    // Every .slangp under 'dir', recursively, appended unsorted
+    void find_presets(const std::string& dir, std::vector<std::string>& out);
+
+} // namespace ZeroMod
@@ -0,0 +1,1896 @@
+#include "spv_exec.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+namespace ZeroMod {
+
+    namespace {
+
+        // SPIR-V opcodes, decorations and enums used below (SPIR-V 1.0-1.6)
+        enum : uint32_t {
+            OpUndef = 1, OpName = 5, OpMemberName = 6, OpExtInstImport = 11, OpExtInst = 12,
+            OpEntryPoint = 15, OpCapability = 17,
+            OpTypeVoid = 19, OpTypeBool = 20, OpTypeInt = 21, OpTypeFloat = 22, OpTypeVector = 23,
+            OpTypeMatrix = 24, OpTypeImage = 25, OpTypeSampler = 26, OpTypeSampledImage = 27,
+            OpTypeArray = 28, OpTypeRuntimeArray = 29, OpTypeStruct = 30, OpTypePointer = 32,
+            OpTypeFunction = 33,
+            OpConstantTrue = 41, OpConstantFalse = 42, OpConstant = 43, OpConstantComposite = 44,
+            OpConstantNull = 46, OpSpecConstantTrue = 48, OpSpecConstantFalse = 49,
+            OpSpecConstant = 50, OpSpecConstantComposite = 51,
+            OpFunction = 54, OpFunctionParameter = 55, OpFunctionEnd = 56, OpFunctionCall = 57,
+            OpVariable = 59, OpLoad = 61, OpStore = 62, OpCopyMemory = 63,
+            OpAccessChain = 65, OpInBoundsAccessChain = 66,
+            OpDecorate = 71, OpMemberDecorate = 72,
+            OpVectorExtractDynamic = 77, OpVectorInsertDynamic = 78, OpVectorShuffle = 79,
+            OpCompositeConstruct = 80, OpCompositeExtract = 81, OpCompositeInsert = 82,
+            OpCopyObject = 83, OpTranspose = 84, OpSampledImage = 86,
+            OpImageSampleImplicitLod = 87, OpImageSampleExplicitLod = 88,
+            OpImageSampleProjImplicitLod = 91, OpImageSampleProjExplicitLod = 92,
+            OpImageFetch = 95, OpImage = 100, OpImageQuerySizeLod = 103, OpImageQuerySize = 104,
+            OpImageQueryLevels = 106,
+            OpConvertFToU = 109, OpConvertFToS = 110, OpConvertSToF = 111, OpConvertUToF = 112,
+            OpUConvert = 113, OpSConvert = 114, OpFConvert = 115, OpBitcast = 124,
+            OpSNegate = 126, OpFNegate = 127, OpIAdd = 128, OpFAdd = 129, OpISub = 130,
+            OpFSub = 131, OpIMul = 132, OpFMul = 133, OpUDiv = 134, OpSDiv = 135, OpFDiv = 136,
+            OpUMod = 137, OpSRem = 138, OpSMod = 139, OpFRem = 140, OpFMod = 141,
+            OpVectorTimesScalar = 142, OpMatrixTimesScalar = 143, OpVectorTimesMatrix = 144,
+            OpMatrixTimesVector = 145, OpMatrixTimesMatrix = 146, OpOuterProduct = 147, OpDot = 148,
+            OpAny = 154, OpAll = 155, OpIsNan = 156, OpIsInf = 157,
+            OpLogicalEqual = 164, OpLogicalNotEqual = 165, OpLogicalOr = 166, OpLogicalAnd = 167,
+            OpLogicalNot = 168, OpSelect = 169, OpIEqual = 170, OpINotEqual = 171,
+            OpUGreaterThan = 172, OpSGreaterThan = 173, OpUGreaterThanEqual = 174,
+            OpSGreaterThanEqual = 175, OpULessThan = 176, OpSLessThan = 177,
+            OpULessThanEqual = 178, OpSLessThanEqual = 179,
+            OpFOrdEqual = 180, OpFUnordEqual = 181, OpFOrdNotEqual = 182, OpFUnordNotEqual = 183,
+            OpFOrdLessThan = 184, OpFUnordLessThan = 185, OpFOrdGreaterThan = 186,
+            OpFUnordGreaterThan = 187, OpFOrdLessThanEqual = 188, OpFUnordLessThanEqual = 189,
+            OpFOrdGreaterThanEqual = 190, OpFUnordGreaterThanEqual = 191,
+            OpShiftRightLogical = 194, OpShiftRightArithmetic = 195, OpShiftLeftLogical = 196,
+            OpBitwiseOr = 197, OpBitwiseXor = 198, OpBitwiseAnd = 199, OpNot = 200,
+            OpDPdx = 207, OpFwidthCoarse = 215,
+            OpPhi = 245, OpLoopMerge = 246, OpSelectionMerge = 247, OpLabel = 248, OpBranch = 249,
+            OpBranchConditional = 250, OpSwitch = 251, OpKill = 252, OpReturn = 253,
+            OpReturnValue = 254, OpUnreachable = 255, OpTerminateInvocation = 4416,
+        };
+
+        // Internal opcodes, past the SPIR-V range
+        enum : uint32_t {
+            XCopy = 0x10000,    // mem[dst..+n] = mem[a..+n]
+            XLoadPtr,           // mem[dst..+n] = mem[mem[a]..+n]
+            XLoadU,             // gather from the uniform blob, pool offsets
+            XLoadUC,            // contiguous uniform load
+            XInsert,
+            XPhis,
+            XGlsl,
+            XDeriv,
+            XQueryLevels,
+        };
+
+        enum : uint32_t {
+            DecBlock = 2, DecBufferBlock = 3, DecRowMajor = 4, DecArrayStride = 6,
+            DecMatrixStride = 7, DecBuiltIn = 11, DecFlat = 14, DecLocation = 30,
+            DecBinding = 33, DecOffset = 35,
+        };
+
+        enum : uint32_t {
+            BuiltInPosition = 0, BuiltInFragCoord = 15, BuiltInVertexIndex = 42,
+        };
+
+        enum : uint32_t {
+            ScUniformConstant = 0, ScInput = 1, ScUniform = 2, ScOutput = 3, ScPrivate = 6,
+            ScFunction = 7, ScPushConstant = 9, ScStorageBuffer = 12,
+        };
+
+        enum : uint32_t {
+            ImConstOffset = 0x8, ImOffset = 0x10,
+        };
+
+        // GLSL.std.450
+        enum : uint32_t {
+            GRound = 1, GRoundEven, GTrunc, GFAbs, GSAbs, GFSign, GSSign, GFloor, GCeil, GFract,
+            GRadians, GDegrees, GSin, GCos, GTan, GAsin, GAcos, GAtan, GSinh, GCosh, GTanh,
+            GAsinh, GAcosh, GAtanh, GAtan2, GPow, GExp, GLog, GExp2, GLog2, GSqrt, GInverseSqrt,
+            GDeterminant, GMatrixInverse, GModf, GModfStruct, GFMin, GUMin, GSMin, GFMax, GUMax,
+            GSMax, GFClamp, GUClamp, GSClamp, GFMix, GIMix, GStep, GSmoothStep, GFma, GFrexp,
+            GFrexpStruct, GLdexp, GPackSnorm4x8, GPackUnorm4x8, GPackSnorm2x16, GPackUnorm2x16,
+            GPackHalf2x16, GPackDouble2x32, GUnpackSnorm2x16, GUnpackUnorm2x16, GUnpackHalf2x16,
+            GUnpackSnorm4x8, GUnpackUnorm4x8, GUnpackDouble2x32, GLength, GDistance, GCross,
+            GNormalize, GFaceForward, GReflect, GRefract, GFindILsb, GFindSMsb, GFindUMsb,
+            GNMin = 79, GNMax, GNClamp,
+        };
+
+        // Pointers into the uniform blob carry this bit and a byte offset;
+        // other pointers are word offsets into the invocation's memory
+        const uint32_t UNIFORM_PTR = 0x80000000u;
+
+        struct id_info
+        {
+            // Any result
+            uint32_t type = 0;
+            uint32_t slot = ~0u;
+            bool is_const = false;
+            bool is_label = false;
+            uint32_t func = ~0u;
+            uint32_t mstride = 0;       // explicit-layout pointers that end in or under a matrix
+            std::string name;
+
+            // Decorations
+            uint32_t location = ~0u;
+            uint32_t binding = ~0u;
+            uint32_t builtin = ~0u;
+            uint32_t array_stride = 0;
+            bool flat = false;
+            bool block = false;
+            bool buffer_block = false;
+
+            // Types
+            uint32_t op = 0;
+            uint32_t words = 0;         // packed size
+            uint32_t elem = 0;          // component, column, element or pointee type
+            uint32_t count = 0;         // vector size, matrix columns, array length
+            uint32_t storage = 0;
+            zm_spv_kind kind = ZM_SPV_OTHER;
+            std::vector<uint32_t> members;
+            std::vector<uint32_t> member_offset;
+            std::vector<uint32_t> member_mstride;
+            std::vector<uint32_t> member_builtin;
+            std::vector<uint8_t> member_rowmajor;
+            std::vector<std::string> member_names;
+        };
+
+        struct insn
+        {
+            uint32_t op;
+            uint32_t n;
+            uint32_t dst;
+            uint32_t a, b, c;
+            uint32_t aux, aux2;
+        };
+
+        struct function
+        {
+            uint32_t pc = ~0u;
+            std::vector<uint32_t> params;       // slots
+        };
+
+        struct frame
+        {
+            uint32_t ret_pc;
+            uint32_t dst;
+            uint32_t words;
+            uint32_t cur, prev;
+        };
+
+        inline float F(uint32_t w) { float f; memcpy(&f, &w, 4); return f; }
+        inline uint32_t W(float f) { uint32_t w; memcpy(&w, &f, 4); return w; }
+        inline int32_t I(uint32_t w) { return (int32_t)w; }
+
+        int32_t f_to_s(float f)
+        {
+            if (!(f == f)) return 0;
+            if (f >= 2147483647.0f) return INT32_MAX;
+            if (f <= -2147483648.0f) return INT32_MIN;
+            return (int32_t)f;
+        }
+
+        uint32_t f_to_u(float f)
+        {
+            if (!(f > 0)) return 0;
+            if (f >= 4294967295.0f) return UINT32_MAX;
+            return (uint32_t)f;
+        }
+
+    } // namespace
+
+    struct zm_spv_module
+    {
+        std::vector<id_info> ids;
+        std::vector<insn> code;
+        std::vector<uint32_t> pool;
+        std::vector<function> funcs;
+        std::vector<uint32_t> init;                         // memory template
+        std::vector<std::pair<uint32_t, uint32_t>> resets;  // (offset, words) reset per invocation
+        std::vector<zm_spv_var> inputs, outputs, uniforms, samplers;
+        uint32_t uniform_size = 0;
+        uint32_t main_func = ~0u;
+        uint32_t frag_coord = ~0u, vertex_index = ~0u, position = ~0u;
+        uint32_t glsl_ext = ~0u;
+        bool derivatives = false;
+    };
+
+    struct zm_spv_exec
+    {
+        const zm_spv_module* m;
+        std::vector<uint32_t> mem;
+        std::vector<frame> stack;
+        std::vector<uint32_t> scratch;
+        const uint8_t* uniforms = nullptr;
+        const zm_spv_texture* textures = nullptr;
+        uint64_t steps = 0;
+        uint64_t samples = 0;
+        const char* error = "";
+    };
+
+    namespace {
+
+        struct decoder
+        {
+            zm_spv_module& m;
+            std::string& error;
+            const uint32_t* words;
+            size_t count;
+            int stage;
+
+            uint32_t entry = ~0u;
+            std::vector<uint32_t> interface_ids;
+            function* fn = nullptr;
+            std::vector<uint32_t> phi_fixups;       // pool offsets holding value ids until the end
+            std::vector<uint32_t> label_pc;
+
+            decoder(zm_spv_module& m, std::string& error) : m(m), error(error) {}
+
+            bool fail(const std::string& what)
+            {
+                if (error.empty()) error = what;
+                return false;
+            }
+
+            bool fail_op(const char* what, uint32_t op)
+            {
+                return fail(std::string(what) + " (opcode " + std::to_string(op) + ")");
+            }
+
+            static std::string str(const uint32_t* w, size_t n)
+            {
+                std::string s;
+                for (size_t i = 0; i < n * 4; ++i) {
+                    const char c = (char)(w[i / 4] >> (8 * (i % 4)));
+                    if (!c) break;
+                    s += c;
+                }
+                return s;
+            }
+
+            id_info& id(uint32_t i)
+            {
+                static id_info none;
+                return i < m.ids.size() ? m.ids[i] : none;
+            }
+
+            uint32_t alloc(uint32_t n)
+            {
+                const uint32_t at = (uint32_t)m.init.size();
+                m.init.resize(m.init.size() + n, 0);
+                return at;
+            }
+
+            // Memory that goes back to its template value before every invocation
+            uint32_t alloc_reset(uint32_t n)
+            {
+                const uint32_t at = alloc(n);
+                if (!m.resets.empty() && m.resets.back().first + m.resets.back().second == at)
+                    m.resets.back().second += n;
+                else if (n)
+                    m.resets.push_back({ at, n });
+                return at;
+            }
+
+            uint32_t result(uint32_t type, uint32_t rid)
+            {
+                id_info& r = id(rid);
+                r.type = type;
+                r.slot = alloc(std::max(id(type).words, 1u));
+                return r.slot;
+            }
+
+            uint32_t slot(uint32_t i)
+            {
+                const uint32_t s = id(i).slot;
+                if (s == ~0u) fail("use of an id with no value: %" + std::to_string(i));
+                return s == ~0u ? 0 : s;
+            }
+
+            uint32_t words_of(uint32_t i) { return id(id(i).type).words; }
+
+            bool scalar(uint32_t i) { return id(id(i).type).op != OpTypeVector; }
+
+            uint32_t const_u32(uint32_t i)
+            {
+                if (!id(i).is_const) {
+                    fail("expected a constant: %" + std::to_string(i));
+                    return 0;
+                }
+                return m.init[id(i).slot];
+            }
+
+            insn& emit(uint32_t op, uint32_t dst = 0, uint32_t n = 0)
+            {
+                m.code.push_back(insn{ op, n, dst, 0, 0, 0, 0, 0 });
+                return m.code.back();
+            }
+
+            bool explicit_layout(uint32_t storage)
+            {
+                return storage == ScUniform || storage == ScPushConstant;
+            }
+
+            // Explicit (offset/stride decorated) size in bytes
+            uint32_t xsize(uint32_t t, uint32_t mstride)
+            {
+                const id_info& ty = id(t);
+                switch (ty.op) {
+                case OpTypeBool: case OpTypeInt: case OpTypeFloat: return 4;
+                case OpTypeVector: return 4 * ty.count;
+                case OpTypeMatrix: return ty.count * (mstride ? mstride : 16);
+                case OpTypeArray: return ty.count * ty.array_stride;
+                case OpTypeStruct: {
+                    uint32_t end = 0;
+                    for (size_t i = 0; i < ty.members.size(); ++i)
+                        end = std::max(end, ty.member_offset[i] + xsize(ty.members[i], ty.member_mstride[i]));
+                    return end;
+                }
+                default: return 0;
+                }
+            }
+
+            // Byte offset of every packed word of a type in explicit layout
+            bool gather(uint32_t t, uint32_t off, uint32_t mstride, std::vector<uint32_t>& out)
+            {
+                const id_info& ty = id(t);
+                switch (ty.op) {
+                case OpTypeBool: case OpTypeInt: case OpTypeFloat:
+                    out.push_back(off);
+                    return true;
+                case OpTypeVector:
+                    for (uint32_t i = 0; i < ty.count; ++i)
+                        out.push_back(off + 4 * i);
+                    return true;
+                case OpTypeMatrix:
+                    for (uint32_t c = 0; c < ty.count; ++c)
+                        gather(ty.elem, off + c * (mstride ? mstride : 16), 0, out);
+                    return true;
+                case OpTypeArray:
+                    if (!ty.array_stride) return fail("uniform array without ArrayStride");
+                    for (uint32_t i = 0; i < ty.count; ++i)
+                        if (!gather(ty.elem, off + i * ty.array_stride, mstride, out)) return false;
+                    return true;
+                case OpTypeStruct:
+                    for (size_t i = 0; i < ty.members.size(); ++i) {
+                        if (ty.member_rowmajor[i]) return fail("row_major uniform matrices are not supported");
+                        if (!gather(ty.members[i], off + ty.member_offset[i], ty.member_mstride[i], out)) return false;
+                    }
+                    return true;
+                default:
+                    return fail("unsupported type in a uniform block");
+                }
+            }
+
+            // Leaf members of a block for spv_uniforms
+            void reflect_uniforms(uint32_t t, uint32_t off, const std::string& prefix)
+            {
+                const id_info& ty = id(t);
+                for (size_t i = 0; i < ty.members.size(); ++i) {
+                    const id_info& mt = id(ty.members[i]);
+                    const std::string name = prefix + (i < ty.member_names.size() ? ty.member_names[i] : std::string());
+                    const uint32_t moff = off + ty.member_offset[i];
+                    if (mt.op == OpTypeStruct) {
+                        reflect_uniforms(ty.members[i], moff, name + ".");
+                        continue;
+                    }
+                    zm_spv_var v{};
+                    v.name = name;
+                    v.location = ~0u;
+                    v.offset = moff;
+                    v.kind = mt.kind;
+                    v.array = 1;
+                    v.stride = 0;
+                    v.words = mt.words;
+                    uint32_t leaf = ty.members[i];
+                    if (mt.op == OpTypeArray) {
+                        v.array = mt.count;
+                        v.stride = mt.array_stride;
+                        leaf = mt.elem;
+                        v.words = id(leaf).words;
+                    }
+                    if (id(leaf).op == OpTypeMatrix) {
+                        // Matrices: 'array' columns of 'words' components, 'stride' apart
+                        v.array = id(leaf).count;
+                        v.stride = ty.member_mstride[i] ? ty.member_mstride[i] : 16;
+                        v.words = id(id(leaf).elem).count;
+                    }
+                    m.uniforms.push_back(v);
+                }
+            }
+
+            uint32_t packed_member_offset(const id_info& ty, uint32_t member)
+            {
+                uint32_t off = 0;
+                for (uint32_t i = 0; i < member && i < ty.members.size(); ++i)
+                    off += id(ty.members[i]).words;
+                return off;
+            }
+
+            bool type(uint32_t op, const uint32_t* o, uint32_t n)
+            {
+                id_info& t = id(o[0]);
+                t.op = op;
+                switch (op) {
+                case OpTypeVoid:
+                    t.words = 0;
+                    break;
+                case OpTypeBool:
+                    t.words = 1;
+                    t.kind = ZM_SPV_BOOL;
+                    break;
+                case OpTypeInt:
+                case OpTypeFloat:
+                    if (o[1] != 32) return fail_op("only 32-bit scalars are supported", op);
+                    t.words = 1;
+                    t.kind = op == OpTypeFloat ? ZM_SPV_FLOAT : (n > 2 && o[2] ? ZM_SPV_INT : ZM_SPV_UINT);
+                    break;
+                case OpTypeVector:
+                case OpTypeMatrix:
+                    t.elem = o[1];
+                    t.count = o[2];
+                    t.words = t.count * id(o[1]).words;
+                    t.kind = id(o[1]).kind;
+                    break;
+                case OpTypeArray:
+                    t.elem = o[1];
+                    t.count = const_u32(o[2]);
+                    t.words = t.count * id(o[1]).words;
+                    t.kind = id(o[1]).kind;
+                    break;
+                case OpTypeStruct:
+                    t.members.assign(o + 1, o + n);
+                    t.member_offset.resize(t.members.size(), 0);
+                    t.member_mstride.resize(t.members.size(), 0);
+                    t.member_builtin.resize(t.members.size(), ~0u);
+                    t.member_rowmajor.resize(t.members.size(), 0);
+                    t.member_names.resize(t.members.size());
+                    t.words = 0;
+                    for (uint32_t mt : t.members)
+                        t.words += id(mt).words;
+                    break;
+                case OpTypePointer:
+                    t.storage = o[1];
+                    t.elem = o[2];
+                    t.words = 1;
+                    break;
+                case OpTypeImage:
+                    if (o[2] != 1) return fail("only 2D images are supported");
+                    t.words = 1;
+                    break;
+                case OpTypeSampler:
+                case OpTypeSampledImage:
+                    t.words = 1;
+                    break;
+                case OpTypeFunction:
+                    t.words = 0;
+                    break;
+                default:
+                    return fail_op("unsupported type", op);
+                }
+                return true;
+            }
+
+            bool constant(uint32_t op, const uint32_t* o, uint32_t n)
+            {
+                const uint32_t s = result(o[0], o[1]);
+                id(o[1]).is_const = true;
+                switch (op) {
+                case OpConstantTrue: case OpSpecConstantTrue: m.init[s] = 1; break;
+                case OpConstantFalse: case OpSpecConstantFalse: m.init[s] = 0; break;
+                case OpConstant: case OpSpecConstant:
+                    if (n != 3) return fail_op("only 32-bit constants are supported", op);
+                    m.init[s] = o[2];
+                    break;
+                case OpConstantComposite:
+                case OpSpecConstantComposite: {
+                    uint32_t at = s;
+                    for (uint32_t i = 2; i < n; ++i) {
+                        const uint32_t w = words_of(o[i]);
+                        std::copy_n(m.init.begin() + slot(o[i]), w, m.init.begin() + at);
+                        at += w;
+                    }
+                    break;
+                }
+                default:    // OpConstantNull
+                    break;
+                }
+                return true;
+            }
+
+            bool variable(const uint32_t* o, uint32_t n)
+            {
+                const uint32_t type = o[0], rid = o[1], storage = o[2];
+                const uint32_t pointee = id(type).elem;
+                const uint32_t s = result(type, rid);
+                const id_info& pt = id(pointee);
+
+                switch (storage) {
+                case ScUniformConstant:
+                    if (pt.op != OpTypeSampledImage)
+                        return fail("only combined image samplers (sampler2D) are supported: " + id(rid).name);
+                    m.init[s] = alloc(1);
+                    m.init[m.init[s]] = (uint32_t)m.samplers.size();
+                    {
+                        zm_spv_var v{};
+                        v.name = id(rid).name;
+                        v.location = id(rid).binding;
+                        v.words = 1;
+                        v.array = 1;
+                        v.kind = ZM_SPV_OTHER;
+                        m.samplers.push_back(v);
+                    }
+                    return true;
+                case ScUniform:
+                case ScPushConstant: {
+                    if (storage == ScUniform && pt.buffer_block) return fail("storage buffers are not supported");
+                    if (pt.op != OpTypeStruct) return fail("uniform that is not a block: " + id(rid).name);
+                    std::vector<uint32_t> tmp;
+                    if (!gather(pointee, 0, 0, tmp)) return false;
+                    const uint32_t base = (m.uniform_size + 15) & ~15u;
+                    m.uniform_size = base + xsize(pointee, 0);
+                    m.init[s] = UNIFORM_PTR | base;
+                    reflect_uniforms(pointee, base, "");
+                    return true;
+                }
+                case ScInput:
+                case ScOutput:
+                case ScPrivate:
+                case ScFunction: {
+                    const uint32_t at = storage == ScInput ? alloc(pt.words) : alloc_reset(pt.words);
+                    m.init[s] = at;
+                    if (n > 3) {
+                        if (storage == ScFunction) {
+                            insn& c = emit(XCopy, at, pt.words);
+                            c.a = slot(o[3]);
+                        }
+                        else {
+                            std::copy_n(m.init.begin() + slot(o[3]), pt.words, m.init.begin() + at);
+                        }
+                    }
+                    if (storage == ScInput || storage == ScOutput)
+                        interface_var(rid, pointee, at, storage == ScInput);
+                    return true;
+                }
+                default:
+                    return fail("unsupported storage class " + std::to_string(storage) + ": " + id(rid).name);
+                }
+            }
+
+            void interface_var(uint32_t rid, uint32_t pointee, uint32_t at, bool input)
+            {
+                const id_info& v = id(rid);
+                const id_info& pt = id(pointee);
+                if (v.builtin != ~0u) {
+                    if (v.builtin == BuiltInFragCoord) m.frag_coord = at;
+                    if (v.builtin == BuiltInVertexIndex) m.vertex_index = at;
+                    if (v.builtin == BuiltInPosition && !input) m.position = at;
+                    return;
+                }
+                if (pt.op == OpTypeStruct) {
+                    // gl_PerVertex
+                    for (size_t i = 0; i < pt.members.size(); ++i)
+                        if (pt.member_builtin[i] == BuiltInPosition && !input)
+                            m.position = at + packed_member_offset(pt, (uint32_t)i);
+                    if (v.location == ~0u) return;
+                }
+                zm_spv_var var{};
+                var.name = v.name;
+                var.location = v.location;
+                var.offset = at;
+                var.words = pt.words;
+                var.array = 1;
+                var.kind = pt.kind;
+                var.flat = v.flat;
+                (input ? m.inputs : m.outputs).push_back(var);
+            }
+
+            // Explicit-layout or packed access chain
+            bool access_chain(const uint32_t* o, uint32_t n)
+            {
+                const uint32_t rtype = o[0], rid = o[1], base = o[2];
+                const id_info& bt = id(id(base).type);
+                const bool x = explicit_layout(bt.storage);
+                uint32_t t = bt.elem;
+                uint32_t mstride = id(base).mstride;
+                uint32_t off = 0;
+                std::vector<uint32_t> dyn;      // (index slot, stride, last valid index)
+
+                for (uint32_t i = 3; i < n; ++i) {
+                    const id_info& ty = id(t);
+                    const uint32_t ix = o[i];
+                    if (ty.op == OpTypeStruct) {
+                        const uint32_t mi = const_u32(ix);
+                        if (mi >= ty.members.size()) return fail("struct member index out of range");
+                        off += x ? ty.member_offset[mi] : packed_member_offset(ty, mi);
+                        if (x && ty.member_rowmajor[mi]) return fail("row_major uniform matrices are not supported");
+                        mstride = x ? ty.member_mstride[mi] : 0;
+                        t = ty.members[mi];
+                        continue;
+                    }
+                    uint32_t stride, len = ty.count;
+                    switch (ty.op) {
+                    case OpTypeArray:
+                        if (x && !ty.array_stride) return fail("uniform array without ArrayStride");
+                        stride = x ? ty.array_stride : id(ty.elem).words;
+                        break;
+                    case OpTypeMatrix:
+                        stride = x ? (mstride ? mstride : 16) : id(ty.elem).words;
+                        break;
+                    case OpTypeVector:
+                        stride = x ? 4 : 1;
+                        break;
+                    default:
+                        return fail("access chain into a scalar");
+                    }
+                    if (id(ix).is_const) {
+                        const uint32_t k = std::min(const_u32(ix), len - 1);
+                        off += k * stride;
+                    }
+                    else {
+                        dyn.push_back(slot(ix));
+                        dyn.push_back(stride);
+                        dyn.push_back(len - 1);
+                    }
+                    t = ty.elem;
+                }
+
+                const uint32_t s = result(rtype, rid);
+                id(rid).mstride = mstride;
+                insn& c = emit(OpAccessChain, s, (uint32_t)dyn.size() / 3);
+                c.a = slot(base);
+                c.aux = off;
+                c.aux2 = (uint32_t)m.pool.size();
+                m.pool.insert(m.pool.end(), dyn.begin(), dyn.end());
+                return true;
+            }
+
+            bool load(const uint32_t* o)
+            {
+                const uint32_t rtype = o[0], rid = o[1], ptr = o[2];
+                const id_info& ptype = id(id(ptr).type);
+                const uint32_t s = result(rtype, rid);
+                const uint32_t w = id(rtype).words;
+                if (!explicit_layout(ptype.storage)) {
+                    insn& c = emit(XLoadPtr, s, w);
+                    c.a = slot(ptr);
+                    return true;
+                }
+                std::vector<uint32_t> offs;
+                if (!gather(rtype, 0, id(ptr).mstride, offs)) return false;
+                bool contiguous = true;
+                for (size_t i = 0; i < offs.size(); ++i)
+                    contiguous = contiguous && offs[i] == 4 * i;
+                insn& c = emit(contiguous ? XLoadUC : XLoadU, s, (uint32_t)offs.size());
+                c.a = slot(ptr);
+                c.aux = (uint32_t)m.pool.size();
+                if (!contiguous) m.pool.insert(m.pool.end(), offs.begin(), offs.end());
+                return true;
+            }
+
+            // Word offset and type of a composite member path
+            bool composite_path(uint32_t t, const uint32_t* ix, uint32_t n, uint32_t& off, uint32_t& out_t)
+            {
+                off = 0;
+                for (uint32_t i = 0; i < n; ++i) {
+                    const id_info& ty = id(t);
+                    if (ty.op == OpTypeStruct) {
+                        if (ix[i] >= ty.members.size()) return fail("composite index out of range");
+                        off += packed_member_offset(ty, ix[i]);
+                        t = ty.members[ix[i]];
+                    }
+                    else {
+                        if (ix[i] >= ty.count) return fail("composite index out of range");
+                        off += ix[i] * id(ty.elem).words;
+                        t = ty.elem;
+                    }
+                }
+                out_t = t;
+                return true;
+            }
+
+            bool glsl(const uint32_t* o, uint32_t n)
+            {
+                const uint32_t rtype = o[0], rid = o[1], g = o[3];
+                const uint32_t* args = o + 4;
+                const uint32_t nargs = n - 4;
+                switch (g) {
+                case GMatrixInverse: case GModfStruct: case GFrexp: case GFrexpStruct:
+                case GPackSnorm4x8: case GPackSnorm2x16: case GPackUnorm2x16: case GPackHalf2x16:
+                case GPackDouble2x32: case GUnpackSnorm2x16: case GUnpackUnorm2x16: case GUnpackHalf2x16:
+                case GUnpackSnorm4x8: case GUnpackDouble2x32:
+                    return fail("unsupported GLSL.std.450 instruction " + std::to_string(g));
+                default:
+                    if (g < GRound || g > GNClamp || (g > GFindUMsb && g < GNMin))
+                        return fail("unsupported GLSL.std.450 instruction " + std::to_string(g));
+                    break;
+                }
+                const uint32_t s = result(rtype, rid);
+                uint32_t comps = id(rtype).words;
+                // Reductions and matrix ops are sized by their first operand
+                if (g == GLength || g == GDistance || g == GDeterminant || g == GPackUnorm4x8)
+                    comps = words_of(args[0]);
+                insn& c = emit(XGlsl, s, comps);
+                c.aux = g;
+                c.a = nargs > 0 ? slot(args[0]) : 0;
+                c.b = nargs > 1 ? slot(args[1]) : 0;
+                c.c = nargs > 2 ? slot(args[2]) : 0;
+                for (uint32_t i = 0; i < nargs && i < 3; ++i)
+                    if (id(id(args[i]).type).op != OpTypeVector && id(rtype).op == OpTypeVector)
+                        c.aux2 |= 1u << i;
+                if (g == GDeterminant) c.aux2 = id(id(args[0]).type).count;
+                return true;
+            }
+
+            bool image(uint32_t op, const uint32_t* o, uint32_t n)
+            {
+                const uint32_t s = result(o[0], o[1]);
+                insn& c = emit(op, s, id(o[0]).words);
+                c.a = slot(o[2]);
+                if (op == OpImageQuerySizeLod || op == OpImageQuerySize || op == OpImageQueryLevels)
+                    return true;
+                c.b = slot(o[3]);
+                c.aux2 = words_of(o[3]);
+                if (n > 4) {
+                    const uint32_t mask = o[4];
+                    // Operands follow in bit order: Bias, Lod, Grad (2), ConstOffset, Offset
+                    uint32_t at = 5;
+                    if (mask & 0x1) ++at;
+                    if (mask & 0x2) ++at;
+                    if (mask & 0x4) at += 2;
+                    if (mask & (ImConstOffset | ImOffset)) {
+                        if (at >= n) return fail("truncated image operands");
+                        c.aux = 1;
+                        c.c = slot(o[at]);
+                    }
+                    if (mask & ~0x1Fu) return fail("unsupported image operands");
+                }
+                return true;
+            }
+
+            bool function_op(uint32_t op, const uint32_t* o, uint32_t n)
+            {
+                switch (op) {
+                case OpFunctionParameter:
+                    fn->params.push_back(result(o[0], o[1]));
+                    return true;
+                case OpLabel:
+                    if (o[0] >= label_pc.size()) return fail("label id out of range");
+                    label_pc[o[0]] = (uint32_t)m.code.size();
+                    emit(OpLabel).a = o[0];
+                    return true;
+                case OpLoopMerge:
+                case OpSelectionMerge:
+                    return true;
+                case OpVariable:
+                    return variable(o, n);
+                case OpLoad:
+                    return load(o);
+                case OpStore: {
+                    const id_info& pt = id(id(o[0]).type);
+                    if (explicit_layout(pt.storage)) return fail("store to a uniform");
+                    insn& c = emit(OpStore, 0, words_of(o[1]));
+                    c.a = slot(o[0]);
+                    c.b = slot(o[1]);
+                    return true;
+                }
+                case OpCopyMemory: {
+                    const id_info& pt = id(id(o[0]).type);
+                    const id_info& st = id(id(o[1]).type);
+                    if (explicit_layout(pt.storage) || explicit_layout(st.storage))
+                        return fail("OpCopyMemory with a uniform");
+                    insn& c = emit(OpCopyMemory, 0, id(pt.elem).words);
+                    c.a = slot(o[0]);
+                    c.b = slot(o[1]);
+                    return true;
+                }
+                case OpAccessChain:
+                case OpInBoundsAccessChain:
+                    return access_chain(o, n);
+                case OpFunctionCall: {
+                    const uint32_t s = id(o[0]).words ? result(o[0], o[1]) : 0;
+                    insn& c = emit(OpFunctionCall, s, n - 3);
+                    c.b = o[2];         // function id, patched later
+                    c.c = id(o[0]).words;
+                    c.aux = (uint32_t)m.pool.size();
+                    for (uint32_t i = 3; i < n; ++i) {
+                        m.pool.push_back(slot(o[i]));
+                        m.pool.push_back(words_of(o[i]));
+                    }
+                    return true;
+                }
+                case OpPhi: {
+                    const uint32_t s = result(o[0], o[1]);
+                    // Consecutive phis of a block read their inputs before any of them is written
+                    if (m.code.empty() || m.code.back().op != XPhis) {
+                        insn& g = emit(XPhis);
+                        g.aux = (uint32_t)m.pool.size();
+                    }
+                    ++m.code.back().n;
+                    m.pool.push_back(s);
+                    m.pool.push_back(id(o[0]).words);
+                    m.pool.push_back((n - 2) / 2);
+                    for (uint32_t i = 2; i + 1 < n; i += 2) {
+                        phi_fixups.push_back((uint32_t)m.pool.size());
+                        m.pool.push_back(o[i]);
+                        m.pool.push_back(o[i + 1]);
+                    }
+                    return true;
+                }
+                case OpBranch: {
+                    insn& c = emit(OpBranch);
+                    c.a = o[0];
+                    return true;
+                }
+                case OpBranchConditional: {
+                    insn& c = emit(OpBranchConditional);
+                    c.a = slot(o[0]);
+                    c.b = o[1];
+                    c.c = o[2];
+                    return true;
+                }
+                case OpSwitch: {
+                    insn& c = emit(OpSwitch, 0, (n - 2) / 2);
+                    c.a = slot(o[0]);
+                    c.b = o[1];
+                    c.aux = (uint32_t)m.pool.size();
+                    for (uint32_t i = 2; i + 1 < n; i += 2) {
+                        m.pool.push_back(o[i]);
+                        m.pool.push_back(o[i + 1]);
+                    }
+                    return true;
+                }
+                case OpReturn:
+                case OpKill:
+                case OpTerminateInvocation:
+                case OpUnreachable:
+                    emit(op == OpTerminateInvocation ? (uint32_t)OpKill : op);
+                    return true;
+                case OpReturnValue: {
+                    insn& c = emit(OpReturnValue, 0, words_of(o[0]));
+                    c.a = slot(o[0]);
+                    return true;
+                }
+                case OpUndef:
+                    result(o[0], o[1]);
+                    return true;
+                case OpExtInst:
+                    if (o[2] != m.glsl_ext) return fail("unsupported extended instruction set");
+                    return glsl(o, n);
+                case OpImageSampleImplicitLod:
+                case OpImageSampleExplicitLod:
+                case OpImageSampleProjImplicitLod:
+                case OpImageSampleProjExplicitLod:
+                case OpImageFetch:
+                case OpImageQuerySizeLod:
+                case OpImageQuerySize:
+                    return image(op, o, n);
+                case OpImageQueryLevels:
+                    emit(XQueryLevels, result(o[0], o[1]), 1);
+                    return true;
+                case OpSampledImage:
+                case OpImage:
+                case OpCopyObject: {
+                    insn& c = emit(XCopy, result(o[0], o[1]), id(o[0]).words);
+                    c.a = slot(o[2]);
+                    return true;
+                }
+                case OpCompositeConstruct: {
+                    const uint32_t s = result(o[0], o[1]);
+                    insn& c = emit(OpCompositeConstruct, s, n - 2);
+                    c.aux = (uint32_t)m.pool.size();
+                    for (uint32_t i = 2; i < n; ++i) {
+                        m.pool.push_back(slot(o[i]));
+                        m.pool.push_back(words_of(o[i]));
+                    }
+                    return true;
+                }
+                case OpCompositeExtract: {
+                    uint32_t off, t;
+                    if (!composite_path(id(o[2]).type, o + 3, n - 3, off, t)) return false;
+                    insn& c = emit(XCopy, result(o[0], o[1]), id(o[0]).words);
+                    c.a = slot(o[2]) + off;
+                    return true;
+                }
+                case OpCompositeInsert: {
+                    uint32_t off, t;
+                    if (!composite_path(o[0], o + 4, n - 4, off, t)) return false;
+                    insn& c = emit(XInsert, result(o[0], o[1]), id(o[0]).words);
+                    c.a = slot(o[3]);
+                    c.b = slot(o[2]);
+                    c.aux = off;
+                    c.aux2 = words_of(o[2]);
+                    return true;
+                }
+                case OpVectorShuffle: {
+                    const uint32_t s = result(o[0], o[1]);
+                    const uint32_t n1 = words_of(o[2]);
+                    insn& c = emit(OpVectorShuffle, s, n - 4);
+                    c.aux = (uint32_t)m.pool.size();
+                    for (uint32_t i = 4; i < n; ++i) {
+                        const uint32_t k = o[i];
+                        m.pool.push_back(k == 0xFFFFFFFFu ? ~0u : k < n1 ? slot(o[2]) + k : slot(o[3]) + k - n1);
+                    }
+                    return true;
+                }
+                case OpVectorExtractDynamic: {
+                    insn& c = emit(op, result(o[0], o[1]), words_of(o[2]));
+                    c.a = slot(o[2]);
+                    c.b = slot(o[3]);
+                    return true;
+                }
+                case OpVectorInsertDynamic: {
+                    insn& c = emit(op, result(o[0], o[1]), id(o[0]).words);
+                    c.a = slot(o[2]);
+                    c.b = slot(o[3]);
+                    c.c = slot(o[4]);
+                    return true;
+                }
+                case OpMatrixTimesVector:
+                case OpVectorTimesMatrix:
+                case OpMatrixTimesMatrix:
+                case OpOuterProduct:
+                case OpTranspose: {
+                    insn& c = emit(op, result(o[0], o[1]), id(o[0]).words);
+                    c.a = slot(o[2]);
+                    if (op != OpTranspose) c.b = slot(o[3]);
+                    const id_info& at = id(id(o[2]).type);
+                    const id_info& bt = id(op != OpTranspose ? id(o[3]).type : 0);
+                    if (op == OpMatrixTimesVector || op == OpMatrixTimesMatrix || op == OpTranspose) {
+                        c.aux = id(at.elem).count;      // rows
+                        c.aux2 = at.count;              // columns
+                        if (op == OpMatrixTimesMatrix) c.c = bt.count;
+                    }
+                    else if (op == OpVectorTimesMatrix) {
+                        c.aux = id(bt.elem).count;
+                        c.aux2 = bt.count;
+                    }
+                    else {
+                        c.aux = at.count;               // outer product: rows from a, columns from b
+                        c.aux2 = bt.count;
+                    }
+                    return true;
+                }
+                case OpDot:
+                case OpAny:
+                case OpAll: {
+                    insn& c = emit(op, result(o[0], o[1]), words_of(o[2]));
+                    c.a = slot(o[2]);
+                    if (op == OpDot) c.b = slot(o[3]);
+                    return true;
+                }
+                case OpSelect: {
+                    insn& c = emit(op, result(o[0], o[1]), id(o[0]).words);
+                    c.a = slot(o[2]);
+                    c.b = slot(o[3]);
+                    c.c = slot(o[4]);
+                    c.aux2 = words_of(o[2]) == 1 && id(o[0]).words > 1;
+                    return true;
+                }
+                default:
+                    break;
+                }
+
+                if (op >= OpDPdx && op <= OpFwidthCoarse) {
+                    m.derivatives = true;
+                    emit(XDeriv, result(o[0], o[1]), id(o[0]).words);
+                    return true;
+                }
+
+                // Component-wise unary and binary ops
+                switch (op) {
+                case OpConvertFToU: case OpConvertFToS: case OpConvertSToF: case OpConvertUToF:
+                case OpUConvert: case OpSConvert: case OpFConvert: case OpBitcast:
+                case OpSNegate: case OpFNegate: case OpNot: case OpLogicalNot:
+                case OpIsNan: case OpIsInf: {
+                    insn& c = emit(op, result(o[0], o[1]), id(o[0]).words);
+                    c.a = slot(o[2]);
+                    return true;
+                }
+                case OpIAdd: case OpFAdd: case OpISub: case OpFSub: case OpIMul: case OpFMul:
+                case OpUDiv: case OpSDiv: case OpFDiv: case OpUMod: case OpSRem: case OpSMod:
+                case OpFRem: case OpFMod: case OpVectorTimesScalar: case OpMatrixTimesScalar:
+                case OpLogicalEqual: case OpLogicalNotEqual: case OpLogicalOr: case OpLogicalAnd:
+                case OpIEqual: case OpINotEqual: case OpUGreaterThan: case OpSGreaterThan:
+                case OpUGreaterThanEqual: case OpSGreaterThanEqual: case OpULessThan:
+                case OpSLessThan: case OpULessThanEqual: case OpSLessThanEqual:
+                case OpFOrdEqual: case OpFUnordEqual: case OpFOrdNotEqual: case OpFUnordNotEqual:
+                case OpFOrdLessThan: case OpFUnordLessThan: case OpFOrdGreaterThan:
+                case OpFUnordGreaterThan: case OpFOrdLessThanEqual: case OpFUnordLessThanEqual:
+                case OpFOrdGreaterThanEqual: case OpFUnordGreaterThanEqual:
+                case OpShiftRightLogical: case OpShiftRightArithmetic: case OpShiftLeftLogical:
+                case OpBitwiseOr: case OpBitwiseXor: case OpBitwiseAnd: {
+                    const uint32_t rw = id(o[0]).words;
+                    insn& c = emit(op == OpVectorTimesScalar || op == OpMatrixTimesScalar ? (uint32_t)OpFMul : op,
+                        result(o[0], o[1]), rw);
+                    c.a = slot(o[2]);
+                    c.b = slot(o[3]);
+                    if (rw > 1 && words_of(o[2]) == 1) c.aux2 |= 1;
+                    if (rw > 1 && words_of(o[3]) == 1) c.aux2 |= 2;
+                    return true;
+                }
+                default:
+                    return fail_op("unsupported instruction", op);
+                }
+            }
+
+            bool run(const uint32_t* w, size_t n, int st)
+            {
+                words = w;
+                count = n;
+                stage = st;
+                if (n < 5 || w[0] != 0x07230203u) return fail("not a SPIR-V module");
+                const uint32_t bound = w[3];
+                if (!bound || bound > (1u << 22)) return fail("bad id bound");
+                m.ids.resize(bound);
+                label_pc.assign(bound, ~0u);
+
+                size_t pos = 5;
+                while (pos < n) {
+                    const uint32_t op = w[pos] & 0xFFFF, wc = w[pos] >> 16;
+                    if (!wc || pos + wc > n) return fail("truncated instruction");
+                    const uint32_t* o = w + pos + 1;
+                    const uint32_t on = wc - 1;
+                    pos += wc;
+
+                    if (fn) {
+                        if (op == OpFunctionEnd) { fn = nullptr; continue; }
+                        if (op == 8 || op == 317) continue;     // OpLine / OpNoLine
+                        if (!function_op(op, o, on)) return false;
+                        if (!error.empty()) return false;
+                        continue;
+                    }
+
+                    switch (op) {
+                    case OpCapability: {
+                        // Shader, Matrix, Sampled1D, ImageQuery and friends are fine; wide types fail at the type
+                        break;
+                    }
+                    case OpExtInstImport:
+                        if (str(o + 1, on - 1) == "GLSL.std.450") m.glsl_ext = o[0];
+                        break;
+                    case OpEntryPoint:
+                        if (entry == ~0u && (int)o[0] == stage) {
+                            entry = o[1];
+                            const size_t skip = (str(o + 2, on - 2).size() + 4) / 4;
+                            interface_ids.assign(o + 2 + skip, o + on);
+                        }
+                        break;
+                    case OpName:
+                        id(o[0]).name = str(o + 1, on - 1);
+                        break;
+                    case OpMemberName: {
+                        id_info& t = id(o[0]);
+                        if (t.member_names.size() <= o[1]) t.member_names.resize(o[1] + 1);
+                        t.member_names[o[1]] = str(o + 2, on - 2);
+                        break;
+                    }
+                    case OpDecorate: {
+                        id_info& t = id(o[0]);
+                        const uint32_t v = on > 2 ? o[2] : 0;
+                        switch (o[1]) {
+                        case DecBlock: t.block = true; break;
+                        case DecBufferBlock: t.buffer_block = true; break;
+                        case DecArrayStride: t.array_stride = v; break;
+                        case DecBuiltIn: t.builtin = v; break;
+                        case DecFlat: t.flat = true; break;
+                        case DecLocation: t.location = v; break;
+                        case DecBinding: t.binding = v; break;
+                        default: break;
+                        }
+                        break;
+                    }
+                    case OpMemberDecorate: {
+                        id_info& t = id(o[0]);
+                        const uint32_t mi = o[1], v = on > 3 ? o[3] : 0;
+                        if (t.member_offset.size() <= mi) {
+                            t.member_offset.resize(mi + 1, 0);
+                            t.member_mstride.resize(mi + 1, 0);
+                            t.member_builtin.resize(mi + 1, ~0u);
+                            t.member_rowmajor.resize(mi + 1, 0);
+                        }
+                        switch (o[2]) {
+                        case DecOffset: t.member_offset[mi] = v; break;
+                        case DecMatrixStride: t.member_mstride[mi] = v; break;
+                        case DecBuiltIn: t.member_builtin[mi] = v; break;
+                        case DecRowMajor: t.member_rowmajor[mi] = 1; break;
+                        default: break;
+                        }
+                        break;
+                    }
+                    case OpTypeStruct: {
+                        // Keep member decorations seen before the type
+                        id_info& t = id(o[0]);
+                        std::vector<uint32_t> off = t.member_offset, ms = t.member_mstride, bi = t.member_builtin;
+                        std::vector<uint8_t> rm = t.member_rowmajor;
+                        std::vector<std::string> names = t.member_names;
+                        if (!type(op, o, on)) return false;
+                        for (size_t i = 0; i < t.members.size(); ++i) {
+                            if (i < off.size()) {
+                                t.member_offset[i] = off[i];
+                                t.member_mstride[i] = ms[i];
+                                t.member_builtin[i] = bi[i];
+                                t.member_rowmajor[i] = rm[i];
+                            }
+                            if (i < names.size()) t.member_names[i] = names[i];
+                        }
+                        break;
+                    }
+                    case OpTypeVoid: case OpTypeBool: case OpTypeInt: case OpTypeFloat:
+                    case OpTypeVector: case OpTypeMatrix: case OpTypeImage: case OpTypeSampler:
+                    case OpTypeSampledImage: case OpTypeArray: case OpTypePointer:
+                    case OpTypeFunction:
+                        if (!type(op, o, on)) return false;
+                        break;
+                    case OpTypeRuntimeArray:
+                        return fail("runtime arrays are not supported");
+                    case OpConstantTrue: case OpConstantFalse: case OpConstant:
+                    case OpConstantComposite: case OpConstantNull: case OpSpecConstantTrue:
+                    case OpSpecConstantFalse: case OpSpecConstant: case OpSpecConstantComposite:
+                        if (!constant(op, o, on)) return false;
+                        break;
+                    case OpVariable:
+                        if (!variable(o, on)) return false;
+                        break;
+                    case OpUndef:
+                        result(o[0], o[1]);
+                        break;
+                    case OpFunction: {
+                        id(o[1]).func = (uint32_t)m.funcs.size();
+                        m.funcs.emplace_back();
+                        fn = &m.funcs.back();
+                        fn->pc = (uint32_t)m.code.size();
+                        if (o[1] == entry) m.main_func = id(o[1]).func;
+                        break;
+                    }
+                    case 52:    // OpSpecConstantOp
+                        return fail("OpSpecConstantOp is not supported");
+                    default:
+                        // Debug info, execution modes, memory model, extensions
+                        break;
+                    }
+                    if (!error.empty()) return false;
+                }
+
+                if (entry == ~0u || m.main_func == ~0u)
+                    return fail(stage == ZM_SPV_VERTEX ? "no vertex entry point" : "no fragment entry point");
+
+                // Patch branch targets and calls now that every label and function is known
+                auto pc_of = [&](uint32_t label, uint32_t& out) {
+                    if (label >= label_pc.size() || label_pc[label] == ~0u) return fail("branch to an unknown label");
+                    out = label_pc[label];
+                    return true;
+                };
+                for (insn& c : m.code) {
+                    switch (c.op) {
+                    case OpBranch:
+                        if (!pc_of(c.a, c.a)) return false;
+                        break;
+                    case OpBranchConditional:
+                        if (!pc_of(c.b, c.b) || !pc_of(c.c, c.c)) return false;
+                        break;
+                    case OpSwitch:
+                        if (!pc_of(c.b, c.b)) return false;
+                        for (uint32_t i = 0; i < c.n; ++i)
+                            if (!pc_of(m.pool[c.aux + 2 * i + 1], m.pool[c.aux + 2 * i + 1])) return false;
+                        break;
+                    case OpFunctionCall: {
+                        const uint32_t f = id(c.b).func;
+                        if (f == ~0u) return fail("call to an unknown function");
+                        if (m.funcs[f].params.size() != c.n) return fail("call with the wrong argument count");
+                        c.b = f;
+                        break;
+                    }
+                    default:
+                        break;
+                    }
+                }
+                for (uint32_t at : phi_fixups)
+                    m.pool[at] = slot(m.pool[at]);
+                return error.empty();
+            }
+        };
+
+        // ---- Sampling ----
+
+        inline int wrap_coord(int x, int n, uint8_t wrap, bool& outside)
+        {
+            if (x >= 0 && x < n) return x;
+            switch (wrap) {
+            case ZM_SPV_WRAP_EDGE:
+                return x < 0 ? 0 : n - 1;
+            case ZM_SPV_WRAP_REPEAT:
+                x %= n;
+                return x < 0 ? x + n : x;
+            case ZM_SPV_WRAP_MIRROR: {
+                int m2 = x % (2 * n);
+                if (m2 < 0) m2 += 2 * n;
+                return m2 < n ? m2 : 2 * n - 1 - m2;
+            }
+            default:
+                outside = true;
+                return 0;
+            }
+        }
+
+        inline void texel(const zm_spv_texture& t, int x, int y, float* out)
+        {
+            bool outside = false;
+            x = wrap_coord(x, (int)t.w, t.wrap, outside);
+            y = wrap_coord(y, (int)t.h, t.wrap, outside);
+            if (outside) {
+                out[0] = out[1] = out[2] = out[3] = 0;
+                return;
+            }
+            memcpy(out, t.rgba + 4 * ((size_t)y * t.w + x), 16);
+        }
+
+        void sample(const zm_spv_texture& t, float u, float v, int ox, int oy, float* out)
+        {
+            if (!t.rgba || !t.w || !t.h) {
+                out[0] = out[1] = out[2] = out[3] = 0;
+                return;
+            }
+            const float fx = u * (float)t.w, fy = v * (float)t.h;
+            if (!t.linear) {
+                texel(t, (int)floorf(fx) + ox, (int)floorf(fy) + oy, out);
+                return;
+            }
+            const float sx = fx - 0.5f, sy = fy - 0.5f;
+            const float x0f = floorf(sx), y0f = floorf(sy);
+            const float ax = sx - x0f, ay = sy - y0f;
+            const int x0 = (int)x0f + ox, y0 = (int)y0f + oy;
+            float t00[4], t10[4], t01[4], t11[4];
+            texel(t, x0, y0, t00);
+            texel(t, x0 + 1, y0, t10);
+            texel(t, x0, y0 + 1, t01);
+            texel(t, x0 + 1, y0 + 1, t11);
+            for (int i = 0; i < 4; ++i) {
+                const float top = t00[i] + (t10[i] - t00[i]) * ax;
+                const float bot = t01[i] + (t11[i] - t01[i]) * ax;
+                out[i] = top + (bot - top) * ay;
+            }
+        }
+
+        float glsl1(uint32_t g, float x, float y, float z)
+        {
+            switch (g) {
+            case GRound: return roundf(x);
+            case GRoundEven: return nearbyintf(x);
+            case GTrunc: return truncf(x);
+            case GFAbs: return fabsf(x);
+            case GFSign: return x > 0 ? 1.0f : x < 0 ? -1.0f : 0.0f;
+            case GFloor: return floorf(x);
+            case GCeil: return ceilf(x);
+            case GFract: return x - floorf(x);
+            case GRadians: return x * 0.017453292519943295f;
+            case GDegrees: return x * 57.29577951308232f;
+            case GSin: return sinf(x);
+            case GCos: return cosf(x);
+            case GTan: return tanf(x);
+            case GAsin: return asinf(x);
+            case GAcos: return acosf(x);
+            case GAtan: return atanf(x);
+            case GSinh: return sinhf(x);
+            case GCosh: return coshf(x);
+            case GTanh: return tanhf(x);
+            case GAsinh: return asinhf(x);
+            case GAcosh: return acoshf(x);
+            case GAtanh: return atanhf(x);
+            case GAtan2: return atan2f(x, y);
+            case GPow: return powf(x, y);
+            case GExp: return expf(x);
+            case GLog: return logf(x);
+            case GExp2: return exp2f(x);
+            case GLog2: return log2f(x);
+            case GSqrt: return sqrtf(x);
+            case GInverseSqrt: return 1.0f / sqrtf(x);
+            case GFMin: return y < x ? y : x;
+            case GFMax: return x < y ? y : x;
+            case GNMin: return fminf(x, y);
+            case GNMax: return fmaxf(x, y);
+            case GFClamp: return std::min(std::max(x, y), z);
+            case GNClamp: return fminf(fmaxf(x, y), z);
+            case GFMix: return x * (1.0f - z) + y * z;
+            case GStep: return y < x ? 0.0f : 1.0f;
+            case GSmoothStep: {
+                const float t = std::min(std::max((z - x) / (y - x), 0.0f), 1.0f);
+                return t * t * (3.0f - 2.0f * t);
+            }
+            case GFma: return x * y + z;
+            default: return 0;
+            }
+        }
+
+        int32_t find_msb(int32_t v)
+        {
+            uint32_t u = v < 0 ? ~(uint32_t)v : (uint32_t)v;
+            int32_t r = -1;
+            while (u) { ++r; u >>= 1; }
+            return r;
+        }
+
+        float det(const uint32_t* M, uint32_t n)
+        {
+            auto e = [&](uint32_t c, uint32_t r) { return F(M[c * n + r]); };
+            if (n == 2) return e(0, 0) * e(1, 1) - e(1, 0) * e(0, 1);
+            if (n == 3)
+                return e(0, 0) * (e(1, 1) * e(2, 2) - e(2, 1) * e(1, 2))
+                    - e(1, 0) * (e(0, 1) * e(2, 2) - e(2, 1) * e(0, 2))
+                    + e(2, 0) * (e(0, 1) * e(1, 2) - e(1, 1) * e(0, 2));
+            float d = 0;
+            for (uint32_t c = 0; c < 4; ++c) {
+                uint32_t sub[9];
+                for (uint32_t cc = 0, k = 0; cc < 4; ++cc) {
+                    if (cc == c) continue;
+                    for (uint32_t r = 1; r < 4; ++r)
+                        sub[k * 3 + (r - 1)] = M[cc * 4 + r];
+                    ++k;
+                }
+                d += ((c & 1) ? -1.0f : 1.0f) * e(c, 0) * det(sub, 3);
+            }
+            return d;
+        }
+
+        void run_glsl(zm_spv_exec* e, const insn& c)
+        {
+            uint32_t* M = e->mem.data();
+            const uint32_t n = c.n;
+            const uint32_t ma = (c.aux2 & 1) ? 0 : ~0u, mb = (c.aux2 & 2) ? 0 : ~0u, mc = (c.aux2 & 4) ? 0 : ~0u;
+            auto A = [&](uint32_t i) { return F(M[c.a + (i & ma)]); };
+            auto B = [&](uint32_t i) { return F(M[c.b + (i & mb)]); };
+            auto C = [&](uint32_t i) { return F(M[c.c + (i & mc)]); };
+            auto dot = [&](uint32_t pa, uint32_t pb) {
+                float s = 0;
+                for (uint32_t i = 0; i < n; ++i) s += F(M[pa + i]) * F(M[pb + i]);
+                return s;
+            };
+
+            switch (c.aux) {
+            case GSAbs: case GSSign: case GUMin: case GSMin: case GUMax: case GSMax:
+            case GUClamp: case GSClamp: case GFindILsb: case GFindSMsb: case GFindUMsb:
+                for (uint32_t i = 0; i < n; ++i) {
+                    const uint32_t x = M[c.a + (i & ma)], y = M[c.b + (i & mb)], z = M[c.c + (i & mc)];
+                    uint32_t r = 0;
+                    switch (c.aux) {
+                    case GSAbs: r = (uint32_t)(I(x) < 0 ? -(int64_t)I(x) : I(x)); break;
+                    case GSSign: r = (uint32_t)(I(x) > 0 ? 1 : I(x) < 0 ? -1 : 0); break;
+                    case GUMin: r = std::min(x, y); break;
+                    case GSMin: r = (uint32_t)std::min(I(x), I(y)); break;
+                    case GUMax: r = std::max(x, y); break;
+                    case GSMax: r = (uint32_t)std::max(I(x), I(y)); break;
+                    case GUClamp: r = std::min(std::max(x, y), z); break;
+                    case GSClamp: r = (uint32_t)std::min(std::max(I(x), I(y)), I(z)); break;
+                    case GFindILsb: {
+                        int32_t b = -1;
+                        for (int k = 0; k < 32; ++k) if (x >> k & 1) { b = k; break; }
+                        r = (uint32_t)b;
+                        break;
+                    }
+                    case GFindSMsb: r = (uint32_t)find_msb(I(x)); break;
+                    case GFindUMsb: {
+                        int32_t b = -1;
+                        for (int k = 31; k >= 0; --k) if (x >> k & 1) { b = k; break; }
+                        r = (uint32_t)b;
+                        break;
+                    }
+                    }
+                    M[c.dst + i] = r;
+                }
+                return;
+            case GLength:
+                M[c.dst] = W(sqrtf(dot(c.a, c.a)));
+                return;
+            case GDistance: {
+                float s = 0;
+                for (uint32_t i = 0; i < n; ++i) {
+                    const float d = F(M[c.a + i]) - F(M[c.b + i]);
+                    s += d * d;
+                }
+                M[c.dst] = W(sqrtf(s));
+                return;
+            }
+            case GNormalize: {
+                const float l = sqrtf(dot(c.a, c.a));
+                for (uint32_t i = 0; i < n; ++i) M[c.dst + i] = W(F(M[c.a + i]) / l);
+                return;
+            }
+            case GCross: {
+                const float a0 = A(0), a1 = A(1), a2 = A(2), b0 = B(0), b1 = B(1), b2 = B(2);
+                M[c.dst] = W(a1 * b2 - b1 * a2);
+                M[c.dst + 1] = W(a2 * b0 - b2 * a0);
+                M[c.dst + 2] = W(a0 * b1 - b0 * a1);
+                return;
+            }
+            case GFaceForward: {
+                const float d = dot(c.c, c.b);
+                for (uint32_t i = 0; i < n; ++i) M[c.dst + i] = W(d < 0 ? A(i) : -A(i));
+                return;
+            }
+            case GReflect: {
+                const float d = dot(c.b, c.a);
+                for (uint32_t i = 0; i < n; ++i) M[c.dst + i] = W(A(i) - 2.0f * d * B(i));
+                return;
+            }
+            case GRefract: {
+                const float d = dot(c.b, c.a), eta = F(M[c.c]);
+                const float k = 1.0f - eta * eta * (1.0f - d * d);
+                for (uint32_t i = 0; i < n; ++i)
+                    M[c.dst + i] = W(k < 0 ? 0.0f : eta * A(i) - (eta * d + sqrtf(k)) * B(i));
+                return;
+            }
+            case GDeterminant:
+                M[c.dst] = W(det(M + c.a, c.aux2));
+                return;
+            case GModf:
+                for (uint32_t i = 0; i < n; ++i) {
+                    const float x = A(i), w = truncf(x);
+                    M[M[c.b] + i] = W(w);
+                    M[c.dst + i] = W(x - w);
+                }
+                return;
+            case GLdexp:
+                for (uint32_t i = 0; i < n; ++i) M[c.dst + i] = W(ldexpf(A(i), I(M[c.b + (i & mb)])));
+                return;
+            case GIMix:
+                for (uint32_t i = 0; i < n; ++i) M[c.dst + i] = M[c.c + (i & mc)] ? M[c.b + (i & mb)] : M[c.a + (i & ma)];
+                return;
+            case GPackUnorm4x8: {
+                uint32_t r = 0;
+                for (uint32_t i = 0; i < 4; ++i)
+                    r |= (uint32_t)roundf(std::min(std::max(A(i), 0.0f), 1.0f) * 255.0f) << (8 * i);
+                M[c.dst] = r;
+                return;
+            }
+            case GUnpackUnorm4x8:
+                for (uint32_t i = 0; i < 4; ++i) M[c.dst + i] = W((float)((M[c.a] >> (8 * i)) & 0xFF) / 255.0f);
+                return;
+            default:
+                for (uint32_t i = 0; i < n; ++i) M[c.dst + i] = W(glsl1(c.aux, A(i), B(i), C(i)));
+                return;
+            }
+        }
+
+    } // namespace
+
+    zm_spv_module* spv_load(const uint32_t* words, size_t count, int stage, std::string& error)
+    {
+        error.clear();
+        zm_spv_module* m = new zm_spv_module();
+        decoder d(*m, error);
+        if (!d.run(words, count, stage)) {
+            if (error.empty()) error = "invalid module";
+            delete m;
+            return nullptr;
+        }
+        return m;
+    }
+
+    void spv_free(zm_spv_module* m)
+    {
+        delete m;
+    }
+
+    const std::vector<zm_spv_var>& spv_inputs(const zm_spv_module* m) { return m->inputs; }
+    const std::vector<zm_spv_var>& spv_outputs(const zm_spv_module* m) { return m->outputs; }
+    const std::vector<zm_spv_var>& spv_uniforms(const zm_spv_module* m) { return m->uniforms; }
+    const std::vector<zm_spv_var>& spv_samplers(const zm_spv_module* m) { return m->samplers; }
+    uint32_t spv_uniform_size(const zm_spv_module* m) { return m->uniform_size; }
+    bool spv_uses_derivatives(const zm_spv_module* m) { return m->derivatives; }
+
+    zm_spv_exec* spv_exec_create(const zm_spv_module* m)
+    {
+        zm_spv_exec* e = new zm_spv_exec();
+        e->m = m;
+        e->mem = m->init;
+        e->stack.reserve(16);
+        return e;
+    }
+
+    void spv_exec_free(zm_spv_exec* e)
+    {
+        delete e;
+    }
+
+    void spv_bind(zm_spv_exec* e, const uint8_t* uniforms, const zm_spv_texture* textures)
+    {
+        e->uniforms = uniforms;
+        e->textures = textures;
+    }
+
+    void spv_set_input(zm_spv_exec* e, size_t index, const float* v)
+    {
+        const zm_spv_var& in = e->m->inputs[index];
+        for (uint32_t i = 0; i < in.words; ++i) {
+            uint32_t w = W(v[i]);
+            if (in.kind == ZM_SPV_INT) w = (uint32_t)f_to_s(v[i]);
+            else if (in.kind == ZM_SPV_UINT || in.kind == ZM_SPV_BOOL) w = f_to_u(v[i]);
+            e->mem[in.offset + i] = w;
+        }
+    }
+
+    void spv_get_output(const zm_spv_exec* e, size_t index, float* v)
+    {
+        const zm_spv_var& out = e->m->outputs[index];
+        for (uint32_t i = 0; i < out.words; ++i) {
+            const uint32_t w = e->mem[out.offset + i];
+            v[i] = out.kind == ZM_SPV_INT ? (float)I(w) : (out.kind == ZM_SPV_UINT || out.kind == ZM_SPV_BOOL) ? (float)w : F(w);
+        }
+    }
+
+    void spv_set_frag_coord(zm_spv_exec* e, const float v[4])
+    {
+        if (e->m->frag_coord == ~0u) return;
+        for (int i = 0; i < 4; ++i) e->mem[e->m->frag_coord + i] = W(v[i]);
+    }
+
+    void spv_set_vertex_index(zm_spv_exec* e, int32_t index)
+    {
+        if (e->m->vertex_index != ~0u) e->mem[e->m->vertex_index] = (uint32_t)index;
+    }
+
+    void spv_get_position(const zm_spv_exec* e, float v[4])
+    {
+        for (int i = 0; i < 4; ++i)
+            v[i] = e->m->position == ~0u ? 0.0f : F(e->mem[e->m->position + i]);
+    }
+
+    const char* spv_exec_error(const zm_spv_exec* e) { return e->error; }
+    uint64_t spv_steps(const zm_spv_exec* e) { return e->steps; }
+    uint64_t spv_samples(const zm_spv_exec* e) { return e->samples; }
+
+    zm_spv_result spv_run(zm_spv_exec* e)
+    {
+        const zm_spv_module* m = e->m;
+        for (const auto& r : m->resets)
+            memcpy(e->mem.data() + r.first, m->init.data() + r.first, 4 * (size_t)r.second);
+        e->stack.clear();
+
+        const insn* code = m->code.data();
+        const uint32_t* pool = m->pool.data();
+        uint32_t* M = e->mem.data();
+        const uint8_t* U = e->uniforms;
+        uint32_t pc = m->funcs[m->main_func].pc;
+        uint32_t cur = 0, prev = 0;
+        uint64_t steps = 0;
+
+        auto uword = [&](uint32_t ptr) {
+            uint32_t w;
+            memcpy(&w, U + (ptr & ~UNIFORM_PTR), 4);
+            return w;
+        };
+
+#define ZM_SPV_EACH(EXPR) \
+        for (uint32_t i = 0; i < c.n; ++i) { \
+            const uint32_t x = M[c.a + (i & ma)], y = M[c.b + (i & mb)]; \
+            (void)x; (void)y; \
+            M[c.dst + i] = (EXPR); \
+        } \
+        break;
+
+        for (;;) {
+            if (++steps > ZM_SPV_MAX_STEPS) {
+                e->steps += steps;
+                e->error = "step limit reached";
+                return ZM_SPV_ERROR;
+            }
+            const insn& c = code[pc++];
+            const uint32_t ma = (c.aux2 & 1) ? 0 : ~0u, mb = (c.aux2 & 2) ? 0 : ~0u;
+
+            switch (c.op) {
+            case OpLabel:
+                prev = cur;
+                cur = c.a;
+                --steps;
+                break;
+            case XCopy:
+                memmove(M + c.dst, M + c.a, 4 * (size_t)c.n);
+                break;
+            case XLoadPtr:
+                memcpy(M + c.dst, M + M[c.a], 4 * (size_t)c.n);
+                break;
+            case XLoadUC:
+                memcpy(M + c.dst, U + (M[c.a] & ~UNIFORM_PTR), 4 * (size_t)c.n);
+                break;
+            case XLoadU:
+                for (uint32_t i = 0; i < c.n; ++i) M[c.dst + i] = uword(M[c.a] + pool[c.aux + i]);
+                break;
+            case OpStore:
+                memcpy(M + M[c.a], M + c.b, 4 * (size_t)c.n);
+                break;
+            case OpCopyMemory:
+                memmove(M + M[c.a], M + M[c.b], 4 * (size_t)c.n);
+                break;
+            case OpAccessChain: {
+                uint32_t p = M[c.a] + c.aux;
+                for (uint32_t i = 0; i < c.n; ++i) {
+                    const uint32_t* d = pool + c.aux2 + 3 * i;
+                    int32_t k = I(M[d[0]]);
+                    k = k < 0 ? 0 : (uint32_t)k > d[2] ? (int32_t)d[2] : k;
+                    p += (uint32_t)k * d[1];
+                }
+                M[c.dst] = p;
+                break;
+            }
+            case XInsert:
+                memcpy(M + c.dst, M + c.a, 4 * (size_t)c.n);
+                memcpy(M + c.dst + c.aux, M + c.b, 4 * (size_t)c.aux2);
+                break;
+            case OpCompositeConstruct: {
+                uint32_t at = c.dst;
+                for (uint32_t i = 0; i < c.n; ++i) {
+                    memcpy(M + at, M + pool[c.aux + 2 * i], 4 * (size_t)pool[c.aux + 2 * i + 1]);
+                    at += pool[c.aux + 2 * i + 1];
+                }
+                break;
+            }
+            case OpVectorShuffle:
+                for (uint32_t i = 0; i < c.n; ++i) {
+                    const uint32_t s = pool[c.aux + i];
+                    M[c.dst + i] = s == ~0u ? 0 : M[s];
+                }
+                break;
+            case OpVectorExtractDynamic: {
+                const uint32_t k = M[c.b];
+                M[c.dst] = M[c.a + (k < c.n ? k : 0)];
+                break;
+            }
+            case OpVectorInsertDynamic: {
+                memcpy(M + c.dst, M + c.a, 4 * (size_t)c.n);
+                const uint32_t k = M[c.c];
+                if (k < c.n) M[c.dst + k] = M[c.b];
+                break;
+            }
+            case XPhis: {
+                // Gather every phi of the group first, then write
+                e->scratch.clear();
+                uint32_t at = c.aux;
+                for (uint32_t k = 0; k < c.n; ++k) {
+                    const uint32_t w = pool[at + 1], preds = pool[at + 2];
+                    uint32_t src = ~0u;
+                    for (uint32_t j = 0; j < preds; ++j)
+                        if (pool[at + 3 + 2 * j + 1] == prev) src = pool[at + 3 + 2 * j];
+                    for (uint32_t i = 0; i < w; ++i)
+                        e->scratch.push_back(src == ~0u ? 0 : M[src + i]);
+                    at += 3 + 2 * preds;
+                }
+                at = c.aux;
+                size_t s = 0;
+                for (uint32_t k = 0; k < c.n; ++k) {
+                    const uint32_t w = pool[at + 1];
+                    memcpy(M + pool[at], e->scratch.data() + s, 4 * (size_t)w);
+                    s += w;
+                    at += 3 + 2 * pool[at + 2];
+                }
+                break;
+            }
+            case OpBranch:
+                pc = c.a;
+                break;
+            case OpBranchConditional:
+                pc = M[c.a] ? c.b : c.c;
+                break;
+            case OpSwitch: {
+                const uint32_t v = M[c.a];
+                pc = c.b;
+                for (uint32_t i = 0; i < c.n; ++i)
+                    if (pool[c.aux + 2 * i] == v) { pc = pool[c.aux + 2 * i + 1]; break; }
+                break;
+            }
+            case OpFunctionCall: {
+                const function& f = m->funcs[c.b];
+                for (uint32_t i = 0; i < c.n; ++i)
+                    memcpy(M + f.params[i], M + pool[c.aux + 2 * i], 4 * (size_t)pool[c.aux + 2 * i + 1]);
+                e->stack.push_back(frame{ pc, c.dst, c.c, cur, prev });
+                pc = f.pc;
+                break;
+            }
+            case OpReturnValue:
+            case OpReturn:
+                if (e->stack.empty()) {
+                    e->steps += steps;
+                    return ZM_SPV_DONE;
+                }
+                {
+                    const frame f = e->stack.back();
+                    e->stack.pop_back();
+                    if (c.op == OpReturnValue) memcpy(M + f.dst, M + c.a, 4 * (size_t)c.n);
+                    pc = f.ret_pc;
+                    cur = f.cur;
+                    prev = f.prev;
+                }
+                break;
+            case OpKill:
+                e->steps += steps;
+                return ZM_SPV_KILLED;
+            case OpUnreachable:
+                e->steps += steps;
+                e->error = "reached OpUnreachable";
+                return ZM_SPV_ERROR;
+
+            case OpImageSampleImplicitLod:
+            case OpImageSampleExplicitLod:
+            case OpImageSampleProjImplicitLod:
+            case OpImageSampleProjExplicitLod:
+            case OpImageFetch:
+            case OpImageQuerySizeLod:
+            case OpImageQuerySize: {
+                const uint32_t ti = M[c.a];
+                static const zm_spv_texture none = { nullptr, 0, 0, false, ZM_SPV_WRAP_BORDER };
+                const zm_spv_texture& t = (e->textures && ti < m->samplers.size()) ? e->textures[ti] : none;
+                if (c.op == OpImageQuerySizeLod || c.op == OpImageQuerySize) {
+                    M[c.dst] = t.w;
+                    M[c.dst + 1] = t.h;
+                    break;
+                }
+                int ox = 0, oy = 0;
+                if (c.aux) {
+                    ox = I(M[c.c]);
+                    oy = I(M[c.c + 1]);
+                }
+                float out[4];
+                if (c.op == OpImageFetch) {
+                    const int x = I(M[c.b]) + ox, y = I(M[c.b + 1]) + oy;
+                    if (t.rgba && x >= 0 && y >= 0 && (uint32_t)x < t.w && (uint32_t)y < t.h)
+                        memcpy(out, t.rgba + 4 * ((size_t)y * t.w + x), 16);
+                    else
+                        out[0] = out[1] = out[2] = out[3] = 0;
+                }
+                else {
+                    float u = F(M[c.b]), v = F(M[c.b + 1]);
+                    if (c.op == OpImageSampleProjImplicitLod || c.op == OpImageSampleProjExplicitLod) {
+                        const float q = F(M[c.b + c.aux2 - 1]);
+                        u /= q;
+                        v /= q;
+                    }
+                    sample(t, u, v, ox, oy, out);
+                }
+                ++e->samples;
+                for (uint32_t i = 0; i < c.n && i < 4; ++i) M[c.dst + i] = W(out[i]);
+                break;
+            }
+            case XQueryLevels:
+                M[c.dst] = 1;
+                break;
+            case XDeriv:
+                memset(M + c.dst, 0, 4 * (size_t)c.n);
+                break;
+            case XGlsl:
+                run_glsl(e, c);
+                break;
+
+            case OpMatrixTimesVector: {
+                // aux rows, aux2 columns
+                for (uint32_t r = 0; r < c.aux; ++r) {
+                    float s = 0;
+                    for (uint32_t k = 0; k < c.aux2; ++k) s += F(M[c.a + k * c.aux + r]) * F(M[c.b + k]);
+                    M[c.dst + r] = W(s);
+                }
+                break;
+            }
+            case OpVectorTimesMatrix: {
+                for (uint32_t k = 0; k < c.aux2; ++k) {
+                    float s = 0;
+                    for (uint32_t r = 0; r < c.aux; ++r) s += F(M[c.a + r]) * F(M[c.b + k * c.aux + r]);
+                    M[c.dst + k] = W(s);
+                }
+                break;
+            }
+            case OpMatrixTimesMatrix: {
+                // a: aux rows x aux2 columns, b: aux2 rows x c columns
+                for (uint32_t j = 0; j < c.c; ++j)
+                    for (uint32_t r = 0; r < c.aux; ++r) {
+                        float s = 0;
+                        for (uint32_t k = 0; k < c.aux2; ++k)
+                            s += F(M[c.a + k * c.aux + r]) * F(M[c.b + j * c.aux2 + k]);
+                        M[c.dst + j * c.aux + r] = W(s);
+                    }
+                break;
+            }
+            case OpOuterProduct:
+                for (uint32_t j = 0; j < c.aux2; ++j)
+                    for (uint32_t r = 0; r < c.aux; ++r)
+                        M[c.dst + j * c.aux + r] = W(F(M[c.a + r]) * F(M[c.b + j]));
+                break;
+            case OpTranspose:
+                for (uint32_t j = 0; j < c.aux2; ++j)
+                    for (uint32_t r = 0; r < c.aux; ++r)
+                        M[c.dst + r * c.aux2 + j] = M[c.a + j * c.aux + r];
+                break;
+            case OpDot: {
+                float s = 0;
+                for (uint32_t i = 0; i < c.n; ++i) s += F(M[c.a + i]) * F(M[c.b + i]);
+                M[c.dst] = W(s);
+                break;
+            }
+            case OpAny:
+            case OpAll: {
+                bool any = false, all = true;
+                for (uint32_t i = 0; i < c.n; ++i) {
+                    any = any || M[c.a + i];
+                    all = all && M[c.a + i];
+                }
+                M[c.dst] = c.op == OpAny ? any : all;
+                break;
+            }
+            case OpSelect:
+                for (uint32_t i = 0; i < c.n; ++i)
+                    M[c.dst + i] = M[c.a + (c.aux2 ? 0 : i)] ? M[c.b + i] : M[c.c + i];
+                break;
+
+            case OpConvertFToU: ZM_SPV_EACH(f_to_u(F(x)))
+            case OpConvertFToS: ZM_SPV_EACH((uint32_t)f_to_s(F(x)))
+            case OpConvertSToF: ZM_SPV_EACH(W((float)I(x)))
+            case OpConvertUToF: ZM_SPV_EACH(W((float)x))
+            case OpUConvert: case OpSConvert: case OpFConvert: case OpBitcast: ZM_SPV_EACH(x)
+            case OpSNegate: ZM_SPV_EACH(0u - x)
+            case OpFNegate: ZM_SPV_EACH(x ^ 0x80000000u)
+            case OpNot: ZM_SPV_EACH(~x)
+            case OpLogicalNot: ZM_SPV_EACH(x ? 0u : 1u)
+            case OpIsNan: ZM_SPV_EACH((uint32_t)isnan(F(x)))
+            case OpIsInf: ZM_SPV_EACH((uint32_t)isinf(F(x)))
+
+            case OpFAdd: ZM_SPV_EACH(W(F(x) + F(y)))
+            case OpFSub: ZM_SPV_EACH(W(F(x) - F(y)))
+            case OpFMul: ZM_SPV_EACH(W(F(x) * F(y)))
+            case OpFDiv: ZM_SPV_EACH(W(F(x) / F(y)))
+            case OpFMod: ZM_SPV_EACH(W(F(x) - F(y) * floorf(F(x) / F(y))))
+            case OpFRem: ZM_SPV_EACH(W(fmodf(F(x), F(y))))
+            case OpIAdd: ZM_SPV_EACH(x + y)
+            case OpISub: ZM_SPV_EACH(x - y)
+            case OpIMul: ZM_SPV_EACH(x * y)
+            case OpUDiv: ZM_SPV_EACH(y ? x / y : 0u)
+            case OpUMod: ZM_SPV_EACH(y ? x % y : 0u)
+            case OpSDiv: ZM_SPV_EACH((!y || (I(x) == INT32_MIN && I(y) == -1)) ? 0u : (uint32_t)(I(x) / I(y)))
+            case OpSRem: ZM_SPV_EACH((!y || I(y) == -1) ? 0u : (uint32_t)(I(x) % I(y)))
+            case OpSMod: ZM_SPV_EACH((!y || I(y) == -1) ? 0u : (uint32_t)(((I(x) % I(y)) + I(y)) % I(y)))
+
+            case OpLogicalEqual: ZM_SPV_EACH((uint32_t)(!x == !y))
+            case OpLogicalNotEqual: ZM_SPV_EACH((uint32_t)(!x != !y))
+            case OpLogicalOr: ZM_SPV_EACH((uint32_t)(x || y))
+            case OpLogicalAnd: ZM_SPV_EACH((uint32_t)(x && y))
+            case OpIEqual: ZM_SPV_EACH((uint32_t)(x == y))
+            case OpINotEqual: ZM_SPV_EACH((uint32_t)(x != y))
+            case OpUGreaterThan: ZM_SPV_EACH((uint32_t)(x > y))
+            case OpSGreaterThan: ZM_SPV_EACH((uint32_t)(I(x) > I(y)))
+            case OpUGreaterThanEqual: ZM_SPV_EACH((uint32_t)(x >= y))
+            case OpSGreaterThanEqual: ZM_SPV_EACH((uint32_t)(I(x) >= I(y)))
+            case OpULessThan: ZM_SPV_EACH((uint32_t)(x < y))
+            case OpSLessThan: ZM_SPV_EACH((uint32_t)(I(x) < I(y)))
+            case OpULessThanEqual: ZM_SPV_EACH((uint32_t)(x <= y))
+            case OpSLessThanEqual: ZM_SPV_EACH((uint32_t)(I(x) <= I(y)))
+            case OpFOrdEqual: ZM_SPV_EACH((uint32_t)(F(x) == F(y)))
+            case OpFUnordEqual: ZM_SPV_EACH((uint32_t)!(F(x) != F(y)))
+            case OpFOrdNotEqual: ZM_SPV_EACH((uint32_t)(F(x) < F(y) || F(x) > F(y)))
+            case OpFUnordNotEqual: ZM_SPV_EACH((uint32_t)(F(x) != F(y)))
+            case OpFOrdLessThan: ZM_SPV_EACH((uint32_t)(F(x) < F(y)))
+            case OpFUnordLessThan: ZM_SPV_EACH((uint32_t)!(F(x) >= F(y)))
+            case OpFOrdGreaterThan: ZM_SPV_EACH((uint32_t)(F(x) > F(y)))
+            case OpFUnordGreaterThan: ZM_SPV_EACH((uint32_t)!(F(x) <= F(y)))
+            case OpFOrdLessThanEqual: ZM_SPV_EACH((uint32_t)(F(x) <= F(y)))
+            case OpFUnordLessThanEqual: ZM_SPV_EACH((uint32_t)!(F(x) > F(y)))
+            case OpFOrdGreaterThanEqual: ZM_SPV_EACH((uint32_t)(F(x) >= F(y)))
+            case OpFUnordGreaterThanEqual: ZM_SPV_EACH((uint32_t)!(F(x) < F(y)))
+
+            case OpShiftRightLogical: ZM_SPV_EACH(x >> (y & 31))
+            case OpShiftRightArithmetic: ZM_SPV_EACH((uint32_t)(I(x) >> (y & 31)))
+            case OpShiftLeftLogical: ZM_SPV_EACH(x << (y & 31))
+            case OpBitwiseOr: ZM_SPV_EACH(x | y)
+            case OpBitwiseXor: ZM_SPV_EACH(x ^ y)
+            case OpBitwiseAnd: ZM_SPV_EACH(x & y)
+
+            default:
+                e->steps += steps;
+                e->error = "internal: unknown decoded instruction";
+                return ZM_SPV_ERROR;
+            }
+        }
+#undef ZM_SPV_EACH
+    }
+
+} // namespace ZeroMod
@@ -0,0 +1,120 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// ---- SPIR-V interpreter ----
+// Runs one vertex or fragment entry point of a glslang-compiled slang stage
+// on the CPU, one invocation at a time, for tools/zm_slang_cpu.cpp. A module
+// is decoded once into a flat instruction list whose operands are already
+// offsets into a per-invocation word array (every result id and every
+// variable gets a fixed place; GLSL has no recursion, so function locals can
+// be static too). Uniform and push-constant blocks are read with their
+// decorated offsets straight from a byte blob the caller fills by member
+// name; samplers are bound by index into spv_samplers().
+//
+// Covered: 32-bit scalars, vectors, matrices, arrays and structs,
+// GLSL.std.450, structured control flow with OpPhi/OpSwitch, function
+// calls, OpKill, and 2D sampling/fetch/size queries with nearest or linear
+// filtering and the four RetroArch wrap modes. Not covered: 16/64-bit
+// types, images other than 2D, depth compares, gathers, row_major uniform
+// matrices; spv_load fails on those with the offending opcode. Derivatives
+// (dFdx, fwidth) have no neighbours to look at and return 0;
+// spv_uses_derivatives says when a module would be off because of that.
+// Instructions a single invocation may execute before it is stopped
+#define ZM_SPV_MAX_STEPS (1u << 26)
+
+namespace ZeroMod {
+
+    enum {
+        ZM_SPV_VERTEX = 0,
+        ZM_SPV_FRAGMENT = 4,    // SPIR-V execution models
+    };
+
+    enum zm_spv_kind : uint8_t {
+        ZM_SPV_FLOAT,
+        ZM_SPV_INT,
+        ZM_SPV_UINT,
+        ZM_SPV_BOOL,
+        ZM_SPV_OTHER,
+    };
+
+    enum zm_spv_wrap : uint8_t {
+        ZM_SPV_WRAP_BORDER,     // transparent black outside
+        ZM_SPV_WRAP_EDGE,
+        ZM_SPV_WRAP_REPEAT,
+        ZM_SPV_WRAP_MIRROR,
+    };
+
+    enum zm_spv_result {
+        ZM_SPV_DONE,
+        ZM_SPV_KILLED,          // OpKill
+        ZM_SPV_ERROR,           // see spv_exec_error
+    };
+
+    // RGBA float texels, top row first
+    struct zm_spv_texture
+    {
+        const float* rgba;
+        uint32_t w, h;
+        bool linear;
+        uint8_t wrap;           // zm_spv_wrap
+    };
+
+    // A reflected uniform member, interface variable or sampler
+    struct zm_spv_var
+    {
+        std::string name;       // member name for uniforms, variable name otherwise
+        uint32_t location;      // Location (interface), Binding (samplers), ~0u if none
+        uint32_t offset;        // uniforms: byte offset into the blob
+        uint32_t words;         // 32-bit components
+        uint32_t array;         // uniforms: element count (1 if not an array)
+        uint32_t stride;        // uniforms: array stride in bytes
+        zm_spv_kind kind;
+        bool flat;
+    };
+
+    struct zm_spv_module;
+    struct zm_spv_exec;
+
+    // stage: ZM_SPV_VERTEX or ZM_SPV_FRAGMENT; nullptr and error set on failure
+    zm_spv_module* spv_load(const uint32_t* words, size_t count, int stage, std::string& error);
+    void spv_free(zm_spv_module* m);
+
+    // Location inputs/outputs (builtins are separate), in declaration order
+    const std::vector<zm_spv_var>& spv_inputs(const zm_spv_module* m);
+    const std::vector<zm_spv_var>& spv_outputs(const zm_spv_module* m);
+    // Leaf members of every uniform and push-constant block
+    const std::vector<zm_spv_var>& spv_uniforms(const zm_spv_module* m);
+    const std::vector<zm_spv_var>& spv_samplers(const zm_spv_module* m);
+    // Bytes the uniform blob passed to spv_bind must have
+    uint32_t spv_uniform_size(const zm_spv_module* m);
+    bool spv_uses_derivatives(const zm_spv_module* m);
+
+    // One per thread
+    zm_spv_exec* spv_exec_create(const zm_spv_module* m);
+    void spv_exec_free(zm_spv_exec* e);
+
+    // Both arrays are read during spv_run and must outlive it; textures is
+    // indexed like spv_samplers()
+    void spv_bind(zm_spv_exec* e, const uint8_t* uniforms, const zm_spv_texture* textures);
+
+    // Interface values by index into spv_inputs/spv_outputs, words[] long
+    void spv_set_input(zm_spv_exec* e, size_t index, const float* v);
+    void spv_get_output(const zm_spv_exec* e, size_t index, float* v);
+    // gl_FragCoord (fragment) / gl_VertexIndex (vertex, v[0])
+    void spv_set_frag_coord(zm_spv_exec* e, const float v[4]);
+    void spv_set_vertex_index(zm_spv_exec* e, int32_t index);
+    // gl_Position after a vertex invocation
+    void spv_get_position(const zm_spv_exec* e, float v[4]);
+
+    // Runs main once
+    zm_spv_result spv_run(zm_spv_exec* e);
+    const char* spv_exec_error(const zm_spv_exec* e);
+
+    // Totals since spv_exec_create
+    uint64_t spv_steps(const zm_spv_exec* e);
+    uint64_t spv_samples(const zm_spv_exec* e);
+
+} // namespace ZeroMod
@@ -0,0 +1,105 @@
+OpName %luma "luma"
+OpMemberName %Push 0 "SourceSize"
+OpMemberName %Push 1 "gain"
+OpMemberDecorate %Push 0 35 0
+OpMemberDecorate %Push 1 35 16
+%Push = OpTypeStruct %v4 %float
+%ptr_pc_Push = OpTypePointer 9 %Push
+%params = OpVariable %ptr_pc_Push 9
+%ptr_pc_f = OpTypePointer 9 %float
+%ptr_fn_v3 = OpTypePointer 7 %v3
+%ptr_fn_f = OpTypePointer 7 %float
+%fn_luma_t = OpTypeFunction %float %ptr_fn_v3
+%int_m1 = OpConstant %int -1
+%uint_3 = OpConstant %uint 3
+%arr3 = OpTypeArray %float %uint_3
+%ptr_fn_arr3 = OpTypePointer 7 %arr3
+%w0 = OpConstant %float 0.25
+%w1 = OpConstant %float 0.5
+%warr = OpConstantComposite %arr3 %w0 %w1 %w0
+%lr = OpConstant %float 0.299
+%lg = OpConstant %float 0.587
+%lb = OpConstant %float 0.114
+%lw = OpConstantComposite %v3 %lr %lg %lb
+%float_m1 = OpConstant %float -1.0
+%mat2 = OpTypeMatrix %v2 2
+%c0 = OpConstantComposite %v2 %float_0 %float_1
+%c1 = OpConstantComposite %v2 %float_m1 %float_0
+%rot = OpConstantComposite %mat2 %c0 %c1
+%float_h = OpConstant %float 0.5
+%main = OpFunction %void 0 %fnv
+%l0 = OpLabel
+%wv = OpVariable %ptr_fn_arr3 7 %warr
+%tmp = OpVariable %ptr_fn_v3 7
+%fc = OpLoad %v4 %gl_FragCoord
+%fcxy = OpVectorShuffle %v2 %fc %fc 0 1
+%px = OpConvertFToS %ivec2 %fcxy
+%pxx = OpCompositeExtract %int %px 0
+%pxy = OpCompositeExtract %int %px 1
+%s = OpLoad %simg %Source
+%im = OpImage %img %s
+%sz = OpImageQuerySizeLod %ivec2 %im %int_0
+%x0 = OpIEqual %bool %pxx %int_0
+%y0 = OpIEqual %bool %pxy %int_0
+%both = OpLogicalAnd %bool %x0 %y0
+OpSelectionMerge %lk 0
+OpBranchConditional %both %lkill %lk
+%lkill = OpLabel
+OpKill
+%lk = OpLabel
+OpBranch %lhead
+%lhead = OpLabel
+%i = OpPhi %int %int_m1 %lk %inext %lcont
+%acc = OpPhi %float %float_0 %lk %accn %lcont
+%cond = OpSLessThan %bool %i %int_2
+OpLoopMerge %lexit %lcont 0
+OpBranchConditional %cond %lbody %lexit
+%lbody = OpLabel
+%fx = OpIAdd %int %pxx %i
+%coord = OpCompositeConstruct %ivec2 %fx %pxy
+%t = OpImageFetch %v4 %im %coord
+%t3 = OpVectorShuffle %v3 %t %t 0 1 2
+OpStore %tmp %t3
+%lu = OpFunctionCall %float %luma %tmp
+%wi = OpIAdd %int %i %int_1
+%wp = OpAccessChain %ptr_fn_f %wv %wi
+%w = OpLoad %float %wp
+%prod = OpFMul %float %w %lu
+%accn = OpFAdd %float %acc %prod
+OpBranch %lcont
+%lcont = OpLabel
+%inext = OpIAdd %int %i %int_1
+OpBranch %lhead
+%lexit = OpLabel
+%gainp = OpAccessChain %ptr_pc_f %params %int_1
+%gain = OpLoad %float %gainp
+%accg = OpFMul %float %acc %gain
+%sel = OpSMod %int %pxx %int_3
+OpSelectionMerge %lend 0
+OpSwitch %sel %ldef 0 %lc0 1 %lc1
+%lc0 = OpLabel
+%v0 = OpCompositeConstruct %v4 %accg %float_0 %float_0 %float_1
+OpBranch %lend
+%lc1 = OpLabel
+%v1 = OpCompositeConstruct %v4 %float_0 %accg %float_0 %float_1
+OpBranch %lend
+%ldef = OpLabel
+%tc = OpLoad %v2 %vTexCoord
+%rt = OpMatrixTimesVector %v2 %rot %tc
+%len = OpExtInst %float %glsl 66 %rt
+%b = OpFMul %float %len %float_h
+%vd0 = OpCompositeConstruct %v4 %float_0 %accg %b %float_1
+%vd = OpCompositeInsert %v4 %float_1 %vd0 0
+OpBranch %lend
+%lend = OpLabel
+%res = OpPhi %v4 %v0 %lc0 %v1 %lc1 %vd %ldef
+OpStore %FragColor %res
+OpReturn
+OpFunctionEnd
+%luma = OpFunction %float 0 %fn_luma_t
+%pc = OpFunctionParameter %ptr_fn_v3
+%ll = OpLabel
+%cv = OpLoad %v3 %pc
+%d = OpDot %float %cv %lw
+OpReturnValue %d
+OpFunctionEnd
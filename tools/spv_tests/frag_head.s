@@ -0,0 +1,45 @@
+OpCapability 1
+%glsl = OpExtInstImport "GLSL.std.450"
+OpMemoryModel 0 1
+OpEntryPoint 4 %main "main" %FragColor %vTexCoord %gl_FragCoord
+OpExecutionMode %main 7
+OpName %main "main"
+OpName %Source "Source"
+OpName %FragColor "FragColor"
+OpName %vTexCoord "vTexCoord"
+OpName %params "params"
+OpName %Push "Push"
+OpDecorate %FragColor 30 0
+OpDecorate %Source 34 0
+OpDecorate %Source 33 2
+OpDecorate %vTexCoord 30 0
+OpDecorate %gl_FragCoord 11 15
+OpDecorate %Push 2
+%void = OpTypeVoid
+%fnv = OpTypeFunction %void
+%float = OpTypeFloat 32
+%v2 = OpTypeVector %float 2
+%v3 = OpTypeVector %float 3
+%v4 = OpTypeVector %float 4
+%int = OpTypeInt 32 1
+%uint = OpTypeInt 32 0
+%bool = OpTypeBool
+%ivec2 = OpTypeVector %int 2
+%ptr_out_v4 = OpTypePointer 3 %v4
+%FragColor = OpVariable %ptr_out_v4 3
+%ptr_in_v4 = OpTypePointer 1 %v4
+%gl_FragCoord = OpVariable %ptr_in_v4 1
+%img = OpTypeImage %float 1 0 0 0 1 0
+%simg = OpTypeSampledImage %img
+%ptr_uc = OpTypePointer 0 %simg
+%Source = OpVariable %ptr_uc 0
+%ptr_in_v2 = OpTypePointer 1 %v2
+%vTexCoord = OpVariable %ptr_in_v2 1
+%int_0 = OpConstant %int 0
+%int_1 = OpConstant %int 1
+%int_2 = OpConstant %int 2
+%int_3 = OpConstant %int 3
+%int_4 = OpConstant %int 4
+%int_5 = OpConstant %int 5
+%float_0 = OpConstant %float 0.0
+%float_1 = OpConstant %float 1.0
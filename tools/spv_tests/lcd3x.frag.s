@@ -0,0 +1,79 @@
+OpName %omega "omega"
+OpMemberName %Push 0 "SourceSize"
+OpMemberName %Push 1 "OriginalSize"
+OpMemberName %Push 2 "OutputSize"
+OpMemberName %Push 3 "FrameCount"
+OpMemberName %Push 4 "brighten_scanlines"
+OpMemberName %Push 5 "brighten_lcd"
+OpMemberDecorate %Push 0 35 0
+OpMemberDecorate %Push 1 35 16
+OpMemberDecorate %Push 2 35 32
+OpMemberDecorate %Push 3 35 48
+OpMemberDecorate %Push 4 35 52
+OpMemberDecorate %Push 5 35 56
+%Push = OpTypeStruct %v4 %v4 %v4 %uint %float %float
+%ptr_pc_Push = OpTypePointer 9 %Push
+%params = OpVariable %ptr_pc_Push 9
+%ptr_pc_v4 = OpTypePointer 9 %v4
+%ptr_pc_f = OpTypePointer 9 %float
+%ptr_priv_v2 = OpTypePointer 6 %v2
+%omega = OpVariable %ptr_priv_v2 6
+%ptr_fn_v3 = OpTypePointer 7 %v3
+%ptr_fn_v2 = OpTypePointer 7 %v2
+%ptr_fn_f = OpTypePointer 7 %float
+%twopi = OpConstant %float 6.2831855
+%twopi2 = OpConstantComposite %v2 %twopi %twopi
+%o0 = OpConstant %float 1.5707964
+%o1 = OpConstant %float -0.5235988
+%o2 = OpConstant %float -2.6179938
+%offsets = OpConstantComposite %v3 %o0 %o1 %o2
+%main = OpFunction %void 0 %fnv
+%l = OpLabel
+%res = OpVariable %ptr_fn_v3 7
+%angle = OpVariable %ptr_fn_v2 7
+%yfactor = OpVariable %ptr_fn_f 7
+%ssp = OpAccessChain %ptr_pc_v4 %params %int_0
+%ss = OpLoad %v4 %ssp
+%ssxy = OpVectorShuffle %v2 %ss %ss 0 1
+%om = OpFMul %v2 %twopi2 %ssxy
+OpStore %omega %om
+%s = OpLoad %simg %Source
+%tc = OpLoad %v2 %vTexCoord
+%c = OpImageSampleImplicitLod %v4 %s %tc
+%c3 = OpVectorShuffle %v3 %c %c 0 1 2
+OpStore %res %c3
+%tc2 = OpLoad %v2 %vTexCoord
+%om2 = OpLoad %v2 %omega
+%ang = OpFMul %v2 %tc2 %om2
+OpStore %angle %ang
+%bsp = OpAccessChain %ptr_pc_f %params %int_4
+%bs = OpLoad %float %bsp
+%ang2 = OpLoad %v2 %angle
+%ay = OpCompositeExtract %float %ang2 1
+%sy = OpExtInst %float %glsl 13 %ay
+%num = OpFAdd %float %bs %sy
+%bs1 = OpFAdd %float %bs %float_1
+%yf = OpFDiv %float %num %bs1
+OpStore %yfactor %yf
+%blp = OpAccessChain %ptr_pc_f %params %int_5
+%bl = OpLoad %float %blp
+%ax = OpCompositeExtract %float %ang2 0
+%axs = OpCompositeConstruct %v3 %ax %ax %ax
+%axo = OpFAdd %v3 %axs %offsets
+%sx = OpExtInst %v3 %glsl 13 %axo
+%bls = OpCompositeConstruct %v3 %bl %bl %bl
+%xn = OpFAdd %v3 %bls %sx
+%bl1 = OpFAdd %float %bl %float_1
+%bl1s = OpCompositeConstruct %v3 %bl1 %bl1 %bl1
+%xf = OpFDiv %v3 %xn %bl1s
+%yf2 = OpLoad %float %yfactor
+%col0 = OpVectorTimesScalar %v3 %xf %yf2
+%r3 = OpLoad %v3 %res
+%col = OpFMul %v3 %col0 %r3
+%cx = OpCompositeExtract %float %col 0
+%cy = OpCompositeExtract %float %col 1
+%cz = OpCompositeExtract %float %col 2
+%out = OpCompositeConstruct %v4 %cx %cy %cz %float_1
+OpStore %FragColor %out
+OpReturn
+OpFunctionEnd
@@ -0,0 +1,58 @@
+# Python references for the goldens in this directory, from the GLSL
+# definitions of the shaders rather than from the SPIR-V: nearest and
+# bilinear Stock, the Stock x2 -> LCD3x chain and the control-flow module
+# (control.frag.s). Exits with 1 when a golden is more than one 8-bit
+# level off anywhere.
+#   python3 ref.py [DIR]     (default: this script's directory)
+import math, os, sys
+D = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+def rd(p):
+    d=open(p,'rb').read(); parts=d.split(b'\n',3); w,h=map(int,parts[1].split()); px=parts[3]
+    return w,h,[[[px[(y*w+x)*3+c]/255 for c in range(3)] for x in range(w)] for y in range(h)]
+def q(v): return 0 if not v>0 else 255 if v>=1 else int(v*255+0.5)
+W,H,S=rd(os.path.join(D,'in.ppm'))
+def nearest(img,w,h,u,v):
+    x=math.floor(u*w); y=math.floor(v*h)
+    if 0<=x<w and 0<=y<h: return img[y][x]
+    return [0,0,0]
+def clampfetch(img,w,h,x,y): return img[min(max(y,0),h-1)][min(max(x,0),w-1)]
+def bilinear(img,w,h,u,v):
+    sx=u*w-.5; sy=v*h-.5; x0=math.floor(sx); y0=math.floor(sy); ax=sx-x0; ay=sy-y0
+    a=clampfetch(img,w,h,x0,y0); b=clampfetch(img,w,h,x0+1,y0); c=clampfetch(img,w,h,x0,y0+1); d=clampfetch(img,w,h,x0+1,y0+1)
+    return [ (a[i]+(b[i]-a[i])*ax)+((c[i]+(d[i]-c[i])*ax)-(a[i]+(b[i]-a[i])*ax))*ay for i in range(3)]
+failed=0
+def cmp(name, ref):
+    global failed
+    w,h,o=rd(os.path.join(D,name)); bad=0; mx=0
+    for y in range(h):
+        for x in range(w):
+            for c in range(3):
+                dlt=abs(q(o[y][x][c])-q(ref(x,y,w,h)[c])); mx=max(mx,dlt); bad+=dlt>1
+    print(name, w,h,'max diff',mx,'bad',bad)
+    failed+=bad>0
+cmp('golden_stock.ppm', lambda x,y,w,h: nearest(S,W,H,(x+.5)/w,(y+.5)/h))
+cmp('golden_linear.ppm', lambda x,y,w,h: bilinear(S,W,H,(x+.5)/w,(y+.5)/h))
+# chain
+P0=[[nearest(S,W,H,(x+.5)/14,(y+.5)/10) for x in range(14)] for y in range(10)]
+def lcd(x,y,w,h):
+    u=(x+.5)/w; v=(y+.5)/h; res=nearest(P0,14,10,u,v)
+    om=(2*math.pi*14, 2*math.pi*10); ax=u*om[0]; ay=v*om[1]
+    bs=16.0; bl=6.0
+    yf=(bs+math.sin(ay))/(bs+1)
+    offs=[math.pi*(0.5), math.pi*(0.5-2/3), math.pi*(0.5-4/3)]
+    return [yf*(bl+math.sin(ax+offs[i]))/(bl+1)*res[i] for i in range(3)]
+cmp('golden_chain.ppm', lcd)
+def ctl(x,y,w,h):
+    if x==0 and y==0: return [0,0,0]
+    wt=[.25,.5,.25]; acc=0
+    for i in (-1,0,1):
+        xx=x+i
+        c=S[y][xx] if 0<=xx<W else [0,0,0]
+        acc+=wt[i+1]*(c[0]*.299+c[1]*.587+c[2]*.114)
+    a=acc*1.5; m=x%3
+    if m==0: return [a,0,0]
+    if m==1: return [0,a,0]
+    tc=((x+.5)/w,(y+.5)/h)
+    return [1,a,math.hypot(*tc)*.5]
+cmp('golden_control.ppm', ctl)
+sys.exit(1 if failed else 0)
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Runs tools/zm_slang_cpu against the goldens in this directory.
+#
+# The modules (*.s) are hand-assembled SPIR-V for custom/shaders/stock.slang,
+# custom/shaders/lcd3x.slang and shaders/control.slang, the subset of
+# glslang's output that tools/spv_exec.cpp interprets; spvasm.py turns them
+# into the <base>.vert.spv / <base>.frag.spv files zm_slang_cpu loads. The
+# goldens come from ref.py, which computes them from the GLSL, so the
+# script checks both the interpreter and the goldens.
+#
+# custom/Stock.slangp runs as it ships; the other presets here reuse the
+# custom shaders with linear filtering, a scaled two-pass chain and a
+# parameter override. Presets whose SPIR-V needs glslang (xbrz, scalefx,
+# freescale) aren't covered.
+#
+# Run (from anywhere):
+#   sh tools/spv_tests/run.sh
+# Exits non-zero on the first failure.
+set -e
+here=$(cd "$(dirname "$0")" && pwd)
+root=$(cd "$here/../.." && pwd)
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+g++ -O2 -std=c++17 -pthread -I"$root/src" "$root/tools/zm_slang_cpu.cpp" "$root/tools/spv_exec.cpp" -o "$tmp/zm_slang_cpu"
+
+mkdir "$tmp/spv"
+for b in stock lcd3x control; do
+    python3 "$here/spvasm.py" "$here/stock.vert.s" "$tmp/spv/$b.vert.spv"
+    cat "$here/frag_head.s" "$here/$b.frag.s" > "$tmp/$b.full.s"
+    python3 "$here/spvasm.py" "$tmp/$b.full.s" "$tmp/spv/$b.frag.spv"
+done
+
+run() {
+    golden=$1; shift
+    echo "== $golden"
+    "$tmp/zm_slang_cpu" --spv "$tmp/spv" --golden "$here/$golden" --tolerance 1 "$@"
+}
+run golden_stock.ppm   --viewport 21x15 "$root/custom/Stock.slangp" "$here/in.ppm"
+run golden_linear.ppm  --viewport 20x13 "$here/p_linear.slangp" "$here/in.ppm"
+run golden_chain.ppm   --viewport 42x30 "$here/p_chain.slangp" "$here/in.ppm"
+run golden_control.ppm --threads 3 --tile 2 "$here/p_control.slangp" "$here/in.ppm"
+
+echo "== ref.py"
+python3 "$here/ref.py" "$here"
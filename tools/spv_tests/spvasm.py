@@ -0,0 +1,54 @@
+# Minimal SPIR-V assembler for the hand-written modules next to it: one
+# instruction per line, "%result = OpName operands", '; ' comments, %names
+# numbered in order of appearance, operands as numbers, quoted strings or
+# %names. Only the opcodes tools/spv_exec.cpp interprets are known.
+#   python3 spvasm.py module.s module.spv
+import struct, re, sys
+OPS = dict(OpName=5,OpMemberName=6,OpExtInstImport=11,OpExtInst=12,OpMemoryModel=14,OpEntryPoint=15,OpExecutionMode=16,OpCapability=17,
+OpTypeVoid=19,OpTypeBool=20,OpTypeInt=21,OpTypeFloat=22,OpTypeVector=23,OpTypeMatrix=24,OpTypeImage=25,OpTypeSampler=26,OpTypeSampledImage=27,
+OpTypeArray=28,OpTypeStruct=30,OpTypePointer=32,OpTypeFunction=33,OpConstantTrue=41,OpConstantFalse=42,OpConstant=43,OpConstantComposite=44,
+OpFunction=54,OpFunctionParameter=55,OpFunctionEnd=56,OpFunctionCall=57,OpVariable=59,OpLoad=61,OpStore=62,OpAccessChain=65,OpDecorate=71,
+OpMemberDecorate=72,OpVectorExtractDynamic=77,OpVectorShuffle=79,OpCompositeConstruct=80,OpCompositeExtract=81,OpCompositeInsert=82,
+OpSampledImage=86,OpImageSampleImplicitLod=87,OpImageFetch=95,OpImage=100,OpImageQuerySizeLod=103,OpConvertFToS=110,OpConvertSToF=111,OpConvertUToF=112,
+OpFNegate=127,OpIAdd=128,OpFAdd=129,OpISub=130,OpFSub=131,OpIMul=132,OpFMul=133,OpFDiv=136,OpSMod=139,OpFMod=141,OpVectorTimesScalar=142,
+OpMatrixTimesVector=145,OpDot=148,OpLogicalAnd=167,OpLogicalNot=168,OpSelect=169,OpIEqual=170,OpSLessThan=177,OpFOrdLessThan=184,OpFOrdGreaterThan=186,
+OpPhi=245,OpLoopMerge=246,OpSelectionMerge=247,OpLabel=248,OpBranch=249,OpBranchConditional=250,OpSwitch=251,OpKill=252,OpReturn=253,OpReturnValue=254,
+OpSource=3,OpVectorTimesMatrix=144)
+NO_TYPE = {'OpLabel','OpExtInstImport','OpString'} | {k for k in OPS if k.startswith('OpType')}
+def assemble(text):
+    ids = {}
+    def idn(n):
+        if n not in ids: ids[n] = len(ids)+1
+        return ids[n]
+    out = []
+    # float-typed constant detection
+    floats = set()
+    for raw in text.splitlines():
+        line = raw.split(';')[0].strip()
+        if not line: continue
+        toks = re.findall(r'"[^"]*"|\S+', line)
+        res = None
+        if len(toks) > 2 and toks[1] == '=':
+            res = toks[0]; toks = toks[2:]
+        op = toks[0]; args = toks[1:]
+        if op == 'OpTypeFloat': floats.add(res)
+        words = []
+        for i,a in enumerate(args):
+            if a.startswith('%'): words.append(idn(a))
+            elif a.startswith('"'):
+                b = a[1:-1].encode()+b'\0'
+                b += b'\0'*((4-len(b)%4)%4)
+                words += list(struct.unpack('<%dI'%(len(b)//4), b))
+            elif op == 'OpConstant' and args[0] in floats and i == 1:
+                words.append(struct.unpack('<I', struct.pack('<f', float(a)))[0])
+            else:
+                v = int(a, 0)
+                words.append(v & 0xffffffff)
+        if res is not None:
+            if op in NO_TYPE: words = [idn(res)] + words
+            else: words = [words[0], idn(res)] + words[1:]
+        out.append(((len(words)+1) << 16) | OPS[op]); out += words
+    hdr = [0x07230203, 0x00010000, 0, len(ids)+1, 0]
+    return struct.pack('<%dI' % (len(hdr)+len(out)), *(hdr+out))
+if __name__ == '__main__':
+    open(sys.argv[2],'wb').write(assemble(open(sys.argv[1]).read()))
@@ -0,0 +1,19 @@
+OpMemberName %Push 0 "SourceSize"
+OpMemberName %Push 1 "OriginalSize"
+OpMemberName %Push 2 "OutputSize"
+OpMemberName %Push 3 "FrameCount"
+OpMemberDecorate %Push 0 35 0
+OpMemberDecorate %Push 1 35 16
+OpMemberDecorate %Push 2 35 32
+OpMemberDecorate %Push 3 35 48
+%Push = OpTypeStruct %v4 %v4 %v4 %uint
+%ptr_pc_Push = OpTypePointer 9 %Push
+%params = OpVariable %ptr_pc_Push 9
+%main = OpFunction %void 0 %fnv
+%l = OpLabel
+%s = OpLoad %simg %Source
+%tc = OpLoad %v2 %vTexCoord
+%c = OpImageSampleImplicitLod %v4 %s %tc
+OpStore %FragColor %c
+OpReturn
+OpFunctionEnd
@@ -0,0 +1,67 @@
+OpCapability 1
+%glsl = OpExtInstImport "GLSL.std.450"
+OpMemoryModel 0 1
+OpEntryPoint 0 %main "main" %_ %Position %vTexCoord %TexCoord
+OpSource 2 450
+OpName %main "main"
+OpName %gl_PerVertex "gl_PerVertex"
+OpMemberName %gl_PerVertex 0 "gl_Position"
+OpMemberName %gl_PerVertex 1 "gl_PointSize"
+OpName %_ ""
+OpName %UBO "UBO"
+OpMemberName %UBO 0 "MVP"
+OpName %global "global"
+OpName %Position "Position"
+OpName %vTexCoord "vTexCoord"
+OpName %TexCoord "TexCoord"
+OpMemberDecorate %gl_PerVertex 0 11 0
+OpMemberDecorate %gl_PerVertex 1 11 1
+OpMemberDecorate %gl_PerVertex 2 11 3
+OpMemberDecorate %gl_PerVertex 3 11 4
+OpDecorate %gl_PerVertex 2
+OpMemberDecorate %UBO 0 5
+OpMemberDecorate %UBO 0 35 0
+OpMemberDecorate %UBO 0 7 16
+OpDecorate %UBO 2
+OpDecorate %global 34 0
+OpDecorate %global 33 0
+OpDecorate %Position 30 0
+OpDecorate %vTexCoord 30 0
+OpDecorate %TexCoord 30 1
+%void = OpTypeVoid
+%fnv = OpTypeFunction %void
+%float = OpTypeFloat 32
+%v4 = OpTypeVector %float 4
+%uint = OpTypeInt 32 0
+%uint_1 = OpConstant %uint 1
+%arr1 = OpTypeArray %float %uint_1
+%gl_PerVertex = OpTypeStruct %v4 %float %arr1 %arr1
+%ptr_out_pv = OpTypePointer 3 %gl_PerVertex
+%_ = OpVariable %ptr_out_pv 3
+%int = OpTypeInt 32 1
+%int_0 = OpConstant %int 0
+%mat4 = OpTypeMatrix %v4 4
+%UBO = OpTypeStruct %mat4
+%ptr_u_UBO = OpTypePointer 2 %UBO
+%global = OpVariable %ptr_u_UBO 2
+%ptr_u_mat4 = OpTypePointer 2 %mat4
+%ptr_in_v4 = OpTypePointer 1 %v4
+%Position = OpVariable %ptr_in_v4 1
+%ptr_out_v4 = OpTypePointer 3 %v4
+%v2 = OpTypeVector %float 2
+%ptr_out_v2 = OpTypePointer 3 %v2
+%vTexCoord = OpVariable %ptr_out_v2 3
+%ptr_in_v2 = OpTypePointer 1 %v2
+%TexCoord = OpVariable %ptr_in_v2 1
+%main = OpFunction %void 0 %fnv
+%l5 = OpLabel
+%mp = OpAccessChain %ptr_u_mat4 %global %int_0
+%m = OpLoad %mat4 %mp
+%p = OpLoad %v4 %Position
+%r = OpMatrixTimesVector %v4 %m %p
+%op = OpAccessChain %ptr_out_v4 %_ %int_0
+OpStore %op %r
+%tc = OpLoad %v2 %TexCoord
+OpStore %vTexCoord %tc
+OpReturn
+OpFunctionEnd
@@ -0,0 +1,17 @@
+# Writes the deterministic pixel-art test frames in this directory: 48x36,
+# a few palette colours in diamonds, discs and shallow diagonal lines, plus
+# scattered single pixels. in1/in2/in3.ppm are seeds 1, 2 and 3.
+#   python3 gen.py in1.ppm 1
+import random,sys
+random.seed(int(sys.argv[2])); w,h=48,36
+pal=[(0,0,0),(248,248,248),(216,56,0),(0,88,248),(0,168,0),(248,184,0),(120,120,120),(60,188,252),(130,130,128)]
+img=[[pal[0]]*w for _ in range(h)]
+for _ in range(40):
+    c=random.choice(pal); x0,y0=random.randrange(w),random.randrange(h); kind=random.randrange(3); s=random.randrange(2,10)
+    for y in range(h):
+        for x in range(w):
+            if kind==0 and abs(x-x0)+abs(y-y0)<s: img[y][x]=c
+            if kind==1 and (x-x0)**2+(y-y0)**2<s*s: img[y][x]=c
+            if kind==2 and 0<=(x-x0)-2*(y-y0)<3 and abs(y-y0)<s: img[y][x]=c
+for _ in range(60): img[random.randrange(h)][random.randrange(w)]=random.choice(pal)
+open(sys.argv[1],'wb').write(b'P6\n%d %d\n255\n'%(w,h)+bytes(v for r in img for p in r for v in p))
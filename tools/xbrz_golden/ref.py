@@ -0,0 +1,85 @@
+# Reference port of custom/shaders/xbrz-freescale.slang to Python, pixel by
+# pixel and straight from the GLSL (nearest sampling, clamp_to_border, the
+# whole output at factor times the input size). The golden*_xN.ppm files in
+# this directory are its output for in1..3.ppm.
+#   python3 ref.py in1.ppm 4 golden1_x4.ppm
+import sys, math, random
+def rd(p):
+    d=open(p,'rb').read(); parts=d.split(b'\n',3); w,h=map(int,parts[1].split()); px=parts[3]
+    return w,h,[[tuple(px[3*(y*w+x)+c]/255.0 for c in range(3)) for x in range(w)] for y in range(h)]
+def wr(p,w,h,img):
+    open(p,'wb').write(b'P6\n%d %d\n255\n'%(w,h)+bytes(v for row in img for px in row for v in px))
+Wt=(0.2627,0.6780,0.0593); sB=0.5/(1-Wt[2]); sR=0.5/(1-Wt[0])
+def dist(a,b):
+    d=[a[i]-b[i] for i in range(3)]; Y=d[0]*Wt[0]+d[1]*Wt[1]+d[2]*Wt[2]; cb=sB*(d[2]-Y); cr=sR*(d[0]-Y)
+    return math.sqrt(Y*Y+cb*cb+cr*cr)
+def near(a,b): return dist(a,b)<30/255
+def lr(c,o,d,s):
+    P0=(c[0]-o[0],c[1]-o[1]); k=(P0[0]*d[0]+P0[1]*d[1])/(d[0]*d[0]+d[1]*d[1])
+    dv=((P0[0]-d[0]*k)*s,(P0[1]-d[1]*k)*s); orth=(-d[1],d[0]); o_=P0[0]*orth[0]+P0[1]*orth[1]
+    side=(o_>0)-(o_<0); v=side*math.hypot(*dv); e=math.sqrt(2)/2
+    t=min(1,max(0,(v+e)/(2*e))); return t*t*(3-2*t)
+def mix(a,b,t): return tuple(a[i]*(1-t)+b[i]*t for i in range(3))
+w,h,src=rd(sys.argv[1]); f=int(sys.argv[2])
+def S(x,y): return src[y][x] if 0<=x<w and 0<=y<h else (0.0,0.0,0.0)
+out=[]
+r2=1/math.sqrt(2)
+for oy in range(h*f):
+  row=[]
+  for ox in range(w*f):
+    sx,sy=ox//f,oy//f; pos=((ox%f+0.5)/f-0.5,(oy%f+0.5)/f-0.5)
+    P=lambda dx,dy:S(sx+dx,sy+dy)
+    A,B,C=P(-1,-1),P(0,-1),P(1,-1); D,E,F=P(-1,0),P(0,0),P(1,0); G,H,I=P(-1,1),P(0,1),P(1,1)
+    br=[0,0,0,0] # x y z w
+    if not ((E==F and H==I) or (E==H and F==I)):
+      a=dist(G,E)+dist(E,C)+dist(P(0,2),I)+dist(I,P(2,0))+4*dist(H,F); b=dist(D,H)+dist(H,P(1,2))+dist(B,F)+dist(F,P(2,1))+4*dist(E,I)
+      br[2]=(2 if 3.6*a<b else 1) if (a<b and E!=F and E!=H) else 0
+    if not ((D==E and G==H) or (D==G and E==H)):
+      a=dist(P(-2,1),D)+dist(D,B)+dist(P(-1,2),H)+dist(H,F)+4*dist(G,E); b=dist(P(-2,0),G)+dist(G,P(0,2))+dist(A,E)+dist(E,I)+4*dist(D,H)
+      br[3]=(2 if 3.6*b<a else 1) if (a>b and E!=D and E!=H) else 0
+    if not ((B==C and E==F) or (B==E and C==F)):
+      a=dist(D,B)+dist(B,P(1,-2))+dist(H,F)+dist(F,P(2,-1))+4*dist(E,C); b=dist(A,E)+dist(E,I)+dist(P(0,-2),C)+dist(C,P(2,0))+4*dist(B,F)
+      br[1]=(2 if 3.6*b<a else 1) if (a>b and E!=B and E!=F) else 0
+    if not ((A==B and D==E) or (A==D and B==E)):
+      a=dist(P(-2,0),A)+dist(A,P(0,-2))+dist(G,E)+dist(E,C)+4*dist(D,B); b=dist(P(-2,-1),D)+dist(D,H)+dist(P(-1,-2),B)+dist(B,F)+4*dist(A,E)
+      br[0]=(2 if 3.6*a<b else 1) if (a<b and E!=D and E!=B) else 0
+    res=E
+    if br[2]:
+      fg,hc=dist(F,G),dist(H,C)
+      dl= br[2]==2 or not ((br[1] and not near(E,G)) or (br[3] and not near(E,C)) or (near(G,H) and near(H,I) and near(I,F) and near(F,C) and not near(E,I)))
+      o=(0,r2); d=[1,-1]
+      if dl:
+        sh=2.2*fg<=hc and E!=G and D!=G; st=2.2*hc<=fg and E!=C and B!=C
+        o=(0,0.25) if sh else (0,0.5); d[0]+=sh; d[1]-=st
+      bp=F if dist(E,F)<=dist(E,H) else H
+      res=mix(res,bp,lr(pos,o,d,f))
+    if br[3]:
+      ha,di=dist(H,A),dist(D,I)
+      dl= br[3]==2 or not ((br[2] and not near(E,A)) or (br[0] and not near(E,I)) or (near(A,D) and near(D,G) and near(G,H) and near(H,I) and not near(E,G)))
+      o=(-r2,0); d=[1,1]
+      if dl:
+        sh=2.2*ha<=di and E!=A and B!=A; st=2.2*di<=ha and E!=I and F!=I
+        o=(-0.25,0) if sh else (-0.5,0); d[1]+=sh; d[0]+=st
+      bp=D if dist(E,D)<=dist(E,H) else H
+      res=mix(res,bp,lr(pos,o,d,f))
+    if br[1]:
+      bi,fa=dist(B,I),dist(F,A)
+      dl= br[1]==2 or not ((br[0] and not near(E,I)) or (br[2] and not near(E,A)) or (near(I,F) and near(F,C) and near(C,B) and near(B,A) and not near(E,C)))
+      o=(r2,0); d=[-1,-1]
+      if dl:
+        sh=2.2*bi<=fa and E!=I and H!=I; st=2.2*fa<=bi and E!=A and D!=A
+        o=(0.25,0) if sh else (0.5,0); d[1]-=sh; d[0]-=st
+      bp=B if dist(E,B)<=dist(E,F) else F
+      res=mix(res,bp,lr(pos,o,d,f))
+    if br[0]:
+      dc,bg=dist(D,C),dist(B,G)
+      dl= br[0]==2 or not ((br[3] and not near(E,C)) or (br[1] and not near(E,G)) or (near(C,B) and near(B,A) and near(A,D) and near(D,G) and not near(E,A)))
+      o=(0,-r2); d=[-1,1]
+      if dl:
+        sh=2.2*dc<=bg and E!=C and F!=C; st=2.2*bg<=dc and E!=G and H!=G
+        o=(0,-0.25) if sh else (0,-0.5); d[0]-=sh; d[1]+=st
+      bp=B if dist(E,B)<=dist(E,D) else D
+      res=mix(res,bp,lr(pos,o,d,f))
+    row.append(tuple(int(v*255+0.5) for v in res))
+  out.append(row)
+wr(sys.argv[3],w*f,h*f,out)
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Runs tools/zm_xbrz_check against the goldens in this directory: every
+# golden<i>_x<N>.ppm is in<i>.ppm scaled by N with ref.py's port of
+# custom/shaders/xbrz-freescale.slang, so the CPU kernel must match the GPU
+# chain's shader on these frames. Pass --regen to rewrite the goldens with
+# ref.py first (slow, pure Python).
+#
+# Run (from anywhere):
+#   sh tools/xbrz_golden/run.sh [--regen]
+# Exits non-zero on the first failure.
+set -e
+here=$(cd "$(dirname "$0")" && pwd)
+root=$(cd "$here/../.." && pwd)
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+g++ -O2 -std=c++17 -pthread -I"$root/src" "$root/tools/zm_xbrz_check.cpp" "$root/src/xbrz_cpu.cpp" -o "$tmp/zm_xbrz_check"
+
+for g in "$here"/golden*_x*.ppm; do
+    name=$(basename "$g" .ppm)
+    i=${name#golden}; i=${i%%_x*}
+    f=${name##*_x}
+    if [ "$1" = "--regen" ]; then
+        python3 "$here/ref.py" "$here/in$i.ppm" "$f" "$g"
+    fi
+    echo "== in$i.ppm x$f"
+    "$tmp/zm_xbrz_check" --factor "$f" --frames 1 --golden "$g" "$here/in$i.ppm"
+done
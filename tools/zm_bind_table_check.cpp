@@ -0,0 +1,462 @@
+// zm_bind_table_check: checks the slang binding tables (src/slang_bind_table.cpp)
+// built from a synthetic reflection
+//
+// Feeds slang_bind_table_build what slang_d3d9_bindings.cpp reads out of
+// the D3DX constant tables for a typical pass (gl_HalfPixel, MVP, UBO and
+// push-constant uniforms, the usual samplers) and checks every op's
+// source slot, registers, dword count, components and layout, the
+// register spans, each sampler's kind, history depth and stage, and where
+// Source ends up. Then random reflections against a reference of the
+// ID3DXConstantTable packing rules, reflections that must fall back to
+// the constant-table path (not float4, odd matrices, ragged sizes, out of
+// range registers, too many ops) with the samplers still filled, and
+// slang_bindings_validate on built tables copied through a byte buffer
+// like the pass cache does, then corrupted one field at a time. Exits
+// with 2 when a check fails.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -Isrc tools/zm_bind_table_check.cpp src/slang_bind_table.cpp -o zm_bind_table_check
+// Run:
+//   ./zm_bind_table_check [random reflections]
+
+#include "slang_bind_table.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace ZeroMod;
+
+static uint32_t seed = 12345;
+static uint32_t rnd()
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+static unsigned g_fail = 0;
+
+static void check(bool cond, const char* what, unsigned line)
+{
+    if (!cond) {
+        printf("line %u: %s: FAIL\n", line, what);
+        g_fail++;
+    }
+}
+#define CHECK(c) check((c), #c, __LINE__)
+
+static slang_refl_const vec(const char* name, unsigned reg, unsigned regs, unsigned cols, bool is_int = false)
+{
+    slang_refl_const c{};
+    c.name = name;
+    c.cls = ZM_RC_VECTOR;
+    c.is_int = is_int;
+    c.float4 = 1;
+    c.reg = (uint16_t)reg;
+    c.regs = (uint16_t)regs;
+    c.rows = 1;
+    c.cols = (uint16_t)cols;
+    return c;
+}
+
+static slang_refl_const mat(const char* name, unsigned reg, bool rows = true, unsigned dim = 4)
+{
+    slang_refl_const c{};
+    c.name = name;
+    c.cls = rows ? ZM_RC_MAT_ROWS : ZM_RC_MAT_COLS;
+    c.float4 = 1;
+    c.reg = (uint16_t)reg;
+    c.regs = (uint16_t)dim;
+    c.rows = (uint16_t)dim;
+    c.cols = (uint16_t)dim;
+    return c;
+}
+
+static slang_refl_const sampler(const char* name, unsigned stage)
+{
+    slang_refl_const c{};
+    c.name = name;
+    c.cls = ZM_RC_SAMPLER;
+    c.reg = (uint16_t)stage;
+    c.regs = 1;
+    return c;
+}
+
+static slang_refl_uniform uni(const slang_refl_const& c, uint32_t kind, uint32_t index, uint32_t bytes)
+{
+    slang_refl_uniform u{};
+    u.c = c;
+    u.source = kind << 16 | index;
+    u.bytes = bytes;
+    return u;
+}
+
+static bool op_is(const slang_const_op& op, uint32_t source, unsigned reg, unsigned regs, unsigned dwords, unsigned cols, unsigned layout)
+{
+    return op.source == source && op.reg == reg && op.regs == regs &&
+        op.dwords == dwords && op.cols == cols && op.layout == layout;
+}
+
+static const slang_sampler_bind* find_sampler(const slang_pass_bindings& b, const char* name)
+{
+    for (uint32_t i = 0; i < b.num_samplers; ++i)
+        if (strcmp(b.samplers[i].name, name) == 0)
+            return &b.samplers[i];
+    return nullptr;
+}
+
+static bool sampler_is(const slang_pass_bindings& b, const char* name, unsigned stage, unsigned kind, unsigned index)
+{
+    const slang_sampler_bind* s = find_sampler(b, name);
+    return s && s->stage == stage && s->kind == kind && s->index == index && s->pass == 0xFF;
+}
+
+// What the constant-table path would bind for a pass like the stock
+// chain's: VS gets gl_HalfPixel, MVP and SourceSize, PS the rest
+static void typical_pass()
+{
+    std::vector<slang_refl_uniform> vs, ps;
+    vs.push_back(uni(vec("gl_HalfPixel", 0, 1, 4), ZM_SLOT_HALFPIXEL, 0, 16));
+    vs.push_back(uni(mat("global_MVP", 1), ZM_SLOT_IDENTITY, 0, 64));
+    vs.push_back(uni(vec("params_SourceSize", 5, 1, 4), ZM_SLOT_TEXSIZE, 0x0001, 16));
+
+    ps.push_back(uni(vec("params_SourceSize", 0, 1, 4), ZM_SLOT_TEXSIZE, 0x0001, 16));
+    ps.push_back(uni(vec("params_FrameCount", 1, 1, 1, true), ZM_SLOT_UNIFORM, 3, 4));
+    ps.push_back(uni(vec("params_OutputSize", 2, 1, 4), ZM_SLOT_UNIFORM, 1, 16));
+    ps.push_back(uni(vec("params_OriginalHistorySize", 3, 2, 4), ZM_SLOT_TEXSIZE, 0x0104, 32));
+    ps.push_back(uni(mat("params_Rot", 8, false), ZM_SLOT_PARAM, 2, 64));
+    // A float2 array: two registers, two dwords each, 16 bytes in the UBO
+    ps.push_back(uni(vec("params_Offsets", 6, 2, 2), ZM_SLOT_PARAM, 0, 16));
+    ps.push_back(uni(vec("params_Gamma", 12, 1, 1), ZM_SLOT_PARAM, 1, 4));
+
+    std::vector<slang_refl_const> all;
+    all.push_back(sampler("Original", 1));
+    all.push_back(ps[0].c);
+    all.push_back(sampler("Source", 0));
+    all.push_back(sampler("OriginalHistory3", 2));
+    all.push_back(sampler("OriginalHistory0", 3));
+    all.push_back(sampler("PassFeedback1", 4));
+    all.push_back(sampler("HqPass", 5));
+    all.push_back(sampler("HqPassFeedback", 6));
+    all.push_back(sampler("PassOutput0", 7));
+    all.push_back(sampler("OriginalHistory900", 8));
+    all.push_back(sampler("", 9));
+
+    slang_pass_bindings b;
+    const bool ok = slang_bind_table_build(vs.data(), (unsigned)vs.size(), ps.data(), (unsigned)ps.size(),
+        all.data(), (unsigned)all.size(), b);
+
+    CHECK(ok);
+    CHECK(b.consts_packed == 1);
+    CHECK(b.num_vs == 3 && b.num_ps == 7);
+    CHECK(op_is(b.vs[0], ZM_SLOT_HALFPIXEL << 16, 0, 1, 4, 4, ZM_CL_FLOAT));
+    CHECK(op_is(b.vs[1], ZM_SLOT_IDENTITY << 16, 1, 4, 16, 4, ZM_CL_MAT_ROWS));
+    CHECK(op_is(b.vs[2], ZM_SLOT_TEXSIZE << 16 | 1, 5, 1, 4, 4, ZM_CL_FLOAT));
+    CHECK(b.vs_lo == 0 && b.vs_hi == 6);
+
+    CHECK(op_is(b.ps[0], ZM_SLOT_TEXSIZE << 16 | 1, 0, 1, 4, 4, ZM_CL_FLOAT));
+    CHECK(op_is(b.ps[1], ZM_SLOT_UNIFORM << 16 | 3, 1, 1, 1, 1, ZM_CL_INT));
+    CHECK(op_is(b.ps[2], ZM_SLOT_UNIFORM << 16 | 1, 2, 1, 4, 4, ZM_CL_FLOAT));
+    CHECK(op_is(b.ps[3], ZM_SLOT_TEXSIZE << 16 | 0x0104, 3, 2, 8, 4, ZM_CL_FLOAT));
+    CHECK(op_is(b.ps[4], ZM_SLOT_PARAM << 16 | 2, 8, 4, 16, 4, ZM_CL_MAT_COLS));
+    CHECK(op_is(b.ps[5], ZM_SLOT_PARAM << 16 | 0, 6, 2, 4, 2, ZM_CL_FLOAT));
+    CHECK(op_is(b.ps[6], ZM_SLOT_PARAM << 16 | 1, 12, 1, 1, 1, ZM_CL_FLOAT));
+    CHECK(b.ps_lo == 0 && b.ps_hi == 13);
+
+    // The nameless sampler is skipped, the uniform isn't a sampler
+    CHECK(b.num_samplers == 9);
+    CHECK(b.source_stage == 0);
+    CHECK(sampler_is(b, "Original", 1, ZM_SAMP_ORIGINAL, 0));
+    CHECK(sampler_is(b, "Source", 0, ZM_SAMP_SOURCE, 0));
+    CHECK(sampler_is(b, "OriginalHistory3", 2, ZM_SAMP_HISTORY, 3));
+    CHECK(sampler_is(b, "OriginalHistory0", 3, ZM_SAMP_ORIGINAL, 0));
+    CHECK(sampler_is(b, "PassFeedback1", 4, ZM_SAMP_FEEDBACK, 0));
+    CHECK(sampler_is(b, "HqPass", 5, ZM_SAMP_ALIAS, 0));
+    CHECK(sampler_is(b, "HqPassFeedback", 6, ZM_SAMP_FEEDBACK, 0));
+    CHECK(sampler_is(b, "PassOutput0", 7, ZM_SAMP_ALIAS, 0));
+    CHECK(sampler_is(b, "OriginalHistory900", 8, ZM_SAMP_HISTORY, ZM_SLANG_MAX_HISTORY));
+    CHECK(b.samplers[0].stage == 1 && b.samplers[1].stage == 0);
+    CHECK(slang_bindings_validate(b));
+}
+
+static void source_fallback()
+{
+    slang_pass_bindings b;
+    const slang_refl_const two[] = { sampler("Original", 3), sampler("Pass1", 1) };
+    slang_bind_table_build(nullptr, 0, nullptr, 0, two, 2, b);
+    CHECK(b.num_samplers == 2 && b.source_stage == 3);
+    CHECK(b.consts_packed == 1 && b.num_vs == 0 && b.num_ps == 0);
+    CHECK(b.vs_lo == 0 && b.vs_hi == 0 && b.ps_lo == 0 && b.ps_hi == 0);
+
+    slang_bind_table_build(nullptr, 0, nullptr, 0, nullptr, 0, b);
+    CHECK(b.num_samplers == 0 && b.source_stage == -1);
+
+    // More samplers than stages: the first sixteen
+    std::vector<std::string> names;
+    std::vector<slang_refl_const> many;
+    for (unsigned i = 0; i < 20; ++i)
+        names.push_back("Pass" + std::to_string(i));
+    for (unsigned i = 0; i < 20; ++i)
+        many.push_back(sampler(names[i].c_str(), i & 15));
+    slang_bind_table_build(nullptr, 0, nullptr, 0, many.data(), (unsigned)many.size(), b);
+    CHECK(b.num_samplers == ZM_SLANG_MAX_SAMPLERS);
+    CHECK(strcmp(b.samplers[15].name, "Pass15") == 0);
+
+    // Names longer than the table's field are cut, not overrun
+    const std::string long_name(100, 'x');
+    const slang_refl_const one[] = { sampler(long_name.c_str(), 2) };
+    slang_bind_table_build(nullptr, 0, nullptr, 0, one, 1, b);
+    CHECK(b.num_samplers == 1 && strlen(b.samplers[0].name) == sizeof(b.samplers[0].name) - 1);
+}
+
+// Each of these keeps the pass on the constant-table path
+static void not_packable()
+{
+    const slang_refl_const samp[] = { sampler("Source", 2), sampler("Original", 0) };
+    const slang_refl_uniform good = uni(vec("params_SourceSize", 0, 1, 4), ZM_SLOT_TEXSIZE, 1, 16);
+
+    struct bad_case { const char* what; slang_refl_uniform u; bool ps; };
+    std::vector<bad_case> cases;
+
+    slang_refl_uniform u = good;
+    u.c.float4 = 0;
+    cases.push_back({ "bool register set", u, true });
+
+    cases.push_back({ "3x3 matrix", uni(mat("params_M", 4, true, 3), ZM_SLOT_PARAM, 0, 36), false });
+
+    cases.push_back({ "short matrix data", uni(mat("params_M", 4), ZM_SLOT_PARAM, 0, 48), false });
+
+    u = good;
+    u.bytes = 14;
+    cases.push_back({ "ragged byte count", u, true });
+
+    u = good;
+    u.c.cls = ZM_RC_OTHER;
+    cases.push_back({ "struct", u, true });
+
+    u = good;
+    u.c.cols = 0;
+    cases.push_back({ "no columns", u, false });
+
+    u = good;
+    u.c.cols = 5;
+    cases.push_back({ "five columns", u, false });
+
+    u = good;
+    u.c.regs = 0;
+    cases.push_back({ "no registers", u, true });
+
+    cases.push_back({ "past c255", uni(vec("params_Big", 250, 8, 4), ZM_SLOT_PARAM, 0, 128), false });
+
+    // Fine for VS, beyond what ps_3_0 has
+    cases.push_back({ "past the PS file", uni(vec("params_Big", 220, 8, 4), ZM_SLOT_PARAM, 0, 128), true });
+
+    for (const bad_case& c : cases) {
+        std::vector<slang_refl_uniform> vs(1, good), ps(1, good);
+        (c.ps ? ps : vs).push_back(c.u);
+
+        slang_pass_bindings b;
+        const bool ok = slang_bind_table_build(vs.data(), (unsigned)vs.size(), ps.data(), (unsigned)ps.size(), samp, 2, b);
+        const bool fell_back = !ok && b.consts_packed == 0 && b.num_vs == 0 && b.num_ps == 0 &&
+            b.vs_lo == 0 && b.vs_hi == 0 && b.ps_lo == 0 && b.ps_hi == 0;
+        const bool samplers_kept = b.num_samplers == 2 && b.source_stage == 2;
+        if (!fell_back || !samplers_kept) {
+            printf("%s: packed=%u vs=%u ps=%u samplers=%u: FAIL\n",
+                c.what, b.consts_packed, b.num_vs, b.num_ps, b.num_samplers);
+            g_fail++;
+        }
+        CHECK(slang_bindings_validate(b));
+    }
+
+    // One op per uniform, so a uniform past the op table spills the pass
+    std::vector<slang_refl_uniform> lots;
+    for (unsigned i = 0; i <= ZM_SLANG_MAX_CONST_OPS; ++i)
+        lots.push_back(uni(vec("params_X", i, 1, 1), ZM_SLOT_PARAM, i, 4));
+    slang_pass_bindings b;
+    CHECK(slang_bind_table_build(lots.data(), ZM_SLANG_MAX_CONST_OPS, nullptr, 0, nullptr, 0, b));
+    CHECK(b.num_vs == ZM_SLANG_MAX_CONST_OPS && b.vs_hi == ZM_SLANG_MAX_CONST_OPS);
+    CHECK(!slang_bind_table_build(lots.data(), (unsigned)lots.size(), nullptr, 0, nullptr, 0, b));
+    CHECK(b.consts_packed == 0 && b.num_vs == 0);
+}
+
+// The ID3DXConstantTable rules, written out the long way
+static slang_const_op reference_op(const slang_refl_uniform& u)
+{
+    slang_const_op op{};
+    op.source = u.source;
+    op.reg = u.c.reg;
+    if (u.c.cls == ZM_RC_VECTOR) {
+        op.regs = u.c.regs;
+        op.cols = (uint8_t)u.c.cols;
+        op.layout = u.c.is_int ? ZM_CL_INT : ZM_CL_FLOAT;
+        unsigned dw = u.bytes / 4;
+        if (dw > (unsigned)u.c.regs * u.c.cols)
+            dw = (unsigned)u.c.regs * u.c.cols;
+        op.dwords = (uint16_t)dw;
+    }
+    else {
+        op.regs = u.c.regs > 4 ? 4 : u.c.regs;
+        op.cols = 4;
+        op.layout = u.c.cls == ZM_RC_MAT_ROWS ? ZM_CL_MAT_ROWS : ZM_CL_MAT_COLS;
+        op.dwords = 16;
+    }
+    return op;
+}
+
+static slang_refl_uniform random_uniform(unsigned max_regs)
+{
+    static const char* const names[] = { "params_A", "params_B", "params_C" };
+    const uint32_t kind = 1 + rnd() % 5;
+    const uint32_t source = kind << 16 | (rnd() % 0x300);
+
+    if (rnd() % 5 == 0) {
+        slang_refl_uniform u = uni(mat(names[rnd() % 3], rnd() % (max_regs - 4), rnd() & 1), kind, 0, 64);
+        u.source = source;
+        return u;
+    }
+    const unsigned cols = 1 + rnd() % 4;
+    const unsigned regs = 1 + rnd() % 4;
+    // UBO members are often padded past what the registers hold, or shorter
+    // than the registers when the last one is partly used
+    const unsigned dwords = 1 + rnd() % (regs * cols + 3);
+    slang_refl_uniform u = uni(vec(names[rnd() % 3], rnd() % (max_regs - regs + 1), regs, cols, rnd() % 4 == 0),
+        kind, 0, dwords * 4);
+    u.source = source;
+    return u;
+}
+
+static void random_reflections(unsigned count)
+{
+    unsigned built = 0, ops = 0;
+    for (unsigned n = 0; n < count; ++n) {
+        std::vector<slang_refl_uniform> vs, ps;
+        const unsigned nvs = rnd() % 12, nps = rnd() % 24;
+        for (unsigned i = 0; i < nvs; ++i) vs.push_back(random_uniform(ZM_SLANG_MAX_VS_CONSTS));
+        for (unsigned i = 0; i < nps; ++i) ps.push_back(random_uniform(ZM_SLANG_MAX_PS_CONSTS));
+
+        slang_pass_bindings b;
+        if (!slang_bind_table_build(vs.data(), nvs, ps.data(), nps, nullptr, 0, b)) {
+            printf("reflection %u: not packable: FAIL\n", n);
+            g_fail++;
+            continue;
+        }
+
+        bool same = b.num_vs == nvs && b.num_ps == nps;
+        unsigned lo = ~0u, hi = 0;
+        for (unsigned i = 0; same && i < nvs; ++i) {
+            const slang_const_op r = reference_op(vs[i]);
+            same = op_is(b.vs[i], r.source, r.reg, r.regs, r.dwords, r.cols, r.layout);
+            if (r.reg < lo) lo = r.reg;
+            if (r.reg + r.regs > hi) hi = r.reg + r.regs;
+        }
+        same = same && (nvs ? (b.vs_lo == lo && b.vs_hi == hi) : (b.vs_lo == 0 && b.vs_hi == 0));
+
+        lo = ~0u, hi = 0;
+        for (unsigned i = 0; same && i < nps; ++i) {
+            const slang_const_op r = reference_op(ps[i]);
+            same = op_is(b.ps[i], r.source, r.reg, r.regs, r.dwords, r.cols, r.layout);
+            if (r.reg < lo) lo = r.reg;
+            if (r.reg + r.regs > hi) hi = r.reg + r.regs;
+        }
+        same = same && (nps ? (b.ps_lo == lo && b.ps_hi == hi) : (b.ps_lo == 0 && b.ps_hi == 0));
+
+        if (!same || !slang_bindings_validate(b)) {
+            printf("reflection %u: table differs from the reference: FAIL\n", n);
+            g_fail++;
+            continue;
+        }
+        built++;
+        ops += nvs + nps;
+    }
+    printf("random reflections: %u/%u tables match, %u ops\n", built, count, ops);
+}
+
+// A built table through a byte buffer, the way the pass cache stores it,
+// then one bad field at a time
+static void validate_round_trip()
+{
+    const slang_refl_uniform vs[] = {
+        uni(vec("gl_HalfPixel", 0, 1, 4), ZM_SLOT_HALFPIXEL, 0, 16),
+        uni(mat("global_MVP", 1), ZM_SLOT_IDENTITY, 0, 64),
+    };
+    const slang_refl_uniform ps[] = {
+        uni(vec("params_SourceSize", 4, 1, 4), ZM_SLOT_TEXSIZE, 1, 16),
+        uni(vec("params_FrameCount", 5, 1, 1, true), ZM_SLOT_UNIFORM, 3, 4),
+    };
+    const slang_refl_const samp[] = { sampler("Source", 0), sampler("OriginalHistory2", 1) };
+
+    slang_pass_bindings built;
+    CHECK(slang_bind_table_build(vs, 2, ps, 2, samp, 2, built));
+
+    std::vector<unsigned char> blob(sizeof(built));
+    memcpy(blob.data(), &built, sizeof(built));
+    slang_pass_bindings b;
+    memcpy(&b, blob.data(), sizeof(b));
+    CHECK(memcmp(&b, &built, sizeof(b)) == 0);
+    CHECK(slang_bindings_validate(b));
+
+    struct corruption { const char* what; void (*apply)(slang_pass_bindings&); };
+    static const corruption bad[] = {
+        { "num_vs past the op table", [](slang_pass_bindings& t) { t.num_vs = ZM_SLANG_MAX_CONST_OPS + 1; } },
+        { "num_samplers past 16", [](slang_pass_bindings& t) { t.num_samplers = ZM_SLANG_MAX_SAMPLERS + 1; } },
+        { "source_stage 16", [](slang_pass_bindings& t) { t.source_stage = 16; } },
+        { "source_stage -2", [](slang_pass_bindings& t) { t.source_stage = -2; } },
+        { "sampler stage 16", [](slang_pass_bindings& t) { t.samplers[1].stage = 16; } },
+        { "sampler kind LUT", [](slang_pass_bindings& t) { t.samplers[0].kind = ZM_SAMP_LUT; } },
+        { "history past the limit", [](slang_pass_bindings& t) { t.samplers[1].index = ZM_SLANG_MAX_HISTORY + 1; } },
+        { "op below the span", [](slang_pass_bindings& t) { t.ps_lo = 5; } },
+        { "op above the span", [](slang_pass_bindings& t) { t.vs_hi = 4; } },
+        { "span inverted", [](slang_pass_bindings& t) { t.ps_lo = 7; t.ps_hi = 6; } },
+        { "PS span past c223", [](slang_pass_bindings& t) { t.ps_hi = ZM_SLANG_MAX_PS_CONSTS + 1; } },
+        { "layout out of range", [](slang_pass_bindings& t) { t.vs[1].layout = ZM_CL_MAT_COLS + 1; } },
+        { "no columns", [](slang_pass_bindings& t) { t.ps[0].cols = 0; } },
+        { "five columns", [](slang_pass_bindings& t) { t.ps[0].cols = 5; } },
+        { "more dwords than registers", [](slang_pass_bindings& t) { t.ps[1].dwords = 2; } },
+        { "unknown source kind", [](slang_pass_bindings& t) { t.vs[0].source = (ZM_SLOT_IDENTITY + 1) << 16; } },
+    };
+    for (const corruption& c : bad) {
+        slang_pass_bindings t;
+        memcpy(&t, blob.data(), sizeof(t));
+        c.apply(t);
+        if (slang_bindings_validate(t)) {
+            printf("validate accepted %s: FAIL\n", c.what);
+            g_fail++;
+        }
+    }
+    printf("validate: built table accepted, %zu corruptions\n", sizeof(bad) / sizeof(bad[0]));
+}
+
+static void names()
+{
+    unsigned n = 7;
+    CHECK(slang_name_index("PassOutput12", "PassOutput", n) && n == 12);
+    CHECK(!slang_name_index("PassOutput", "PassOutput", n));
+    CHECK(!slang_name_index("PassOutput1x", "PassOutput", n));
+    CHECK(!slang_name_index("PassOutpu1", "PassOutput", n));
+    CHECK(!slang_name_index("PassOutput99999999", "PassOutput", n));
+
+    uint8_t kind = 0xFF, index = 0xFF;
+    slang_sampler_classify("Feedback", kind, index);
+    CHECK(kind == ZM_SAMP_ALIAS && index == 0);
+    slang_sampler_classify("OriginalHistory1", kind, index);
+    CHECK(kind == ZM_SAMP_HISTORY && index == 1);
+    slang_sampler_classify("OriginalHistory", kind, index);
+    CHECK(kind == ZM_SAMP_ALIAS);
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned count = argc > 1 ? (unsigned)atoi(argv[1]) : 2000;
+
+    typical_pass();
+    source_fallback();
+    not_packable();
+    random_reflections(count);
+    validate_round_trip();
+    names();
+
+    printf("%s\n", g_fail ? "FAIL" : "ok");
+    return g_fail ? 2 : 0;
+}
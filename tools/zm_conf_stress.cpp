@@ -0,0 +1,306 @@
+// zm_conf_stress: concurrent publish/read stress for Config snapshots
+//
+// Drives src/rcu.cpp the way Config does: one writer thread (the ini
+// thread) keeps publishing new snapshots, reader threads (render threads)
+// refresh once per "frame" and then read the snapshot throughout the
+// frame. A freed snapshot is poisoned and parked in a quarantine instead of
+// going back to the allocator, so a reader still holding one sees the
+// poison instead of reused memory. Every read checks the poison, a
+// checksum over the contents and that versions never go backwards; any
+// failure makes the exit code non-zero. For comparison the old scheme runs
+// too: readers take the writer's lock to copy the values every frame.
+// Reports frames, publishes, frees still pending, and the per-frame cost
+// of picking up the config (p50/p99/max).
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -pthread -Isrc tools/zm_conf_stress.cpp src/rcu.cpp -o zm_conf_stress
+// Run:
+//   ./zm_conf_stress [readers] [seconds] [publish interval us]
+
+#include "rcu.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ZeroMod;
+
+#define STRESS_ALIVE 0x5A5A1234u
+#define STRESS_DEAD 0xDEADDEADu
+// Freed snapshots kept poisoned before really going back to the allocator
+#define STRESS_QUARANTINE 8192
+// Reads of the snapshot per simulated frame
+#define STRESS_READS_PER_FRAME 64
+
+static uint64_t now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_us(unsigned us)
+{
+    timespec ts = { (time_t)(us / 1000000), (long)(us % 1000000) * 1000l };
+    nanosleep(&ts, nullptr);
+}
+
+// Shaped like ConfigValues: a version, flags, strings and key lists
+struct stress_values
+{
+    volatile uint32_t magic;
+    uint64_t version;
+    bool flags[8];
+    std::string shader;
+    std::vector<uint8_t> hotkey;
+    uint64_t check;
+};
+
+static uint64_t checksum(const stress_values& v)
+{
+    uint64_t h = 1469598103934665603ull ^ v.version;
+    for (bool f : v.flags)
+        h = (h ^ (uint64_t)f) * 1099511628211ull;
+    for (char c : v.shader)
+        h = (h ^ (uint8_t)c) * 1099511628211ull;
+    for (uint8_t k : v.hotkey)
+        h = (h ^ k) * 1099511628211ull;
+    return h;
+}
+
+static stress_values* make_values(uint64_t version)
+{
+    stress_values* v = new stress_values;
+    v->magic = STRESS_ALIVE;
+    v->version = version;
+    for (int i = 0; i < 8; ++i)
+        v->flags[i] = ((version >> i) & 1) != 0;
+    v->shader = "shaders/crt/crt-royale.slangp#" + std::to_string(version);
+    v->hotkey.assign(1 + version % 4, (uint8_t)version);
+    v->check = checksum(*v);
+    return v;
+}
+
+static std::vector<stress_values*> quarantine;
+static size_t quarantine_at = 0;
+static std::atomic<uint64_t> freed{ 0 };
+
+// Writer thread only, like every rcu_publish
+static void free_values(void* p)
+{
+    stress_values* v = (stress_values*)p;
+    v->magic = STRESS_DEAD;
+    ++freed;
+    if (quarantine.size() < STRESS_QUARANTINE) {
+        quarantine.push_back(v);
+        return;
+    }
+    delete quarantine[quarantine_at];
+    quarantine[quarantine_at] = v;
+    quarantine_at = (quarantine_at + 1) % STRESS_QUARANTINE;
+}
+
+static std::atomic<uint64_t> errors{ 0 };
+
+static void report_error(const char* what, const stress_values* v)
+{
+    if (errors.fetch_add(1) < 10)
+        fprintf(stderr, "error: %s (magic %08x version %llu)\n", what, (unsigned)v->magic, (unsigned long long)v->version);
+}
+
+// False when v is freed or torn
+static bool check_values(const stress_values* v)
+{
+    if (v->magic != STRESS_ALIVE) {
+        report_error("read a freed snapshot", v);
+        return false;
+    }
+    if (checksum(*v) != v->check) {
+        report_error("snapshot contents changed under a reader", v);
+        return false;
+    }
+    return true;
+}
+
+struct reader_result
+{
+    uint64_t frames = 0;
+    uint64_t changes = 0;
+    std::vector<uint32_t> lat;
+};
+
+static void print_result(const char* name, std::vector<reader_result>& rs, double seconds)
+{
+    std::vector<uint32_t> lat;
+    uint64_t frames = 0, changes = 0;
+    for (reader_result& r : rs) {
+        frames += r.frames;
+        changes += r.changes;
+        lat.insert(lat.end(), r.lat.begin(), r.lat.end());
+    }
+    std::sort(lat.begin(), lat.end());
+    const size_t n = lat.size();
+    printf("%-6s %10.0f frames/s  %8llu version changes  pick-up p50 %5u ns  p99 %6u ns  max %8u ns\n",
+        name, frames / seconds, (unsigned long long)changes,
+        n ? lat[n / 2] : 0, n ? lat[n * 99 / 100] : 0, n ? lat[n - 1] : 0);
+}
+
+static void run_rcu(int readers, int seconds, unsigned interval_us)
+{
+    zm_rcu r;
+    rcu_init(r, make_values(0), free_values);
+
+    std::atomic<bool> stop{ false };
+    std::vector<reader_result> results(readers);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < readers; ++t) {
+        threads.emplace_back([&, t] {
+            reader_result& res = results[t];
+            res.lat.reserve(1 << 20);
+            const int slot = rcu_attach(r);
+            if (slot < 0) {
+                fprintf(stderr, "error: no reader slot\n");
+                ++errors;
+                return;
+            }
+            uint64_t seen = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                const uint64_t t0 = now_ns();
+                const stress_values* v = (const stress_values*)rcu_refresh(r, slot);
+                const uint64_t t1 = now_ns();
+                if (res.lat.size() < res.lat.capacity())
+                    res.lat.push_back((uint32_t)std::min<uint64_t>(t1 - t0, UINT32_MAX));
+
+                if (v->version < seen)
+                    report_error("version went backwards", v);
+                if (v->version != seen)
+                    ++res.changes;
+                seen = v->version;
+
+                // The rest of the frame keeps reading the same snapshot
+                for (int i = 0; i < STRESS_READS_PER_FRAME && check_values(v); ++i) {
+                }
+                ++res.frames;
+            }
+            rcu_detach(r, slot);
+        });
+    }
+
+    uint64_t published = 0;
+    const uint64_t end = now_ns() + (uint64_t)seconds * 1000000000ull;
+    while (now_ns() < end) {
+        // Copy, edit, publish: what Config::begin_config/end_config do
+        const stress_values* cur = (const stress_values*)rcu_current(r);
+        rcu_publish(r, make_values(cur->version + 1));
+        ++published;
+        if (interval_us)
+            sleep_us(interval_us);
+    }
+    stop = true;
+    for (std::thread& th : threads)
+        th.join();
+
+    const size_t pending = rcu_pending(r);
+    print_result("rcu", results, seconds);
+    printf("       %llu published, %llu freed, %zu pending at stop\n",
+        (unsigned long long)published, (unsigned long long)freed.load(), pending);
+    if (freed.load() + pending != published) {
+        fprintf(stderr, "error: %llu published but %llu freed + %zu pending\n",
+            (unsigned long long)published, (unsigned long long)freed.load(), pending);
+        ++errors;
+    }
+
+    rcu_free(r);
+    for (stress_values* v : quarantine)
+        delete v;
+    quarantine.clear();
+}
+
+// The old scheme: the writer edits in place under a lock and every reader
+// takes the same lock to copy what it needs each frame
+static void run_locked(int readers, int seconds, unsigned interval_us)
+{
+    std::mutex cs;
+    stress_values* shared = make_values(0);
+
+    std::atomic<bool> stop{ false };
+    std::vector<reader_result> results(readers);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < readers; ++t) {
+        threads.emplace_back([&, t] {
+            reader_result& res = results[t];
+            res.lat.reserve(1 << 20);
+            uint64_t seen = 0;
+            stress_values copy;
+            while (!stop.load(std::memory_order_relaxed)) {
+                const uint64_t t0 = now_ns();
+                {
+                    std::lock_guard<std::mutex> lock(cs);
+                    copy.magic = shared->magic;
+                    copy.version = shared->version;
+                    memcpy(copy.flags, shared->flags, sizeof(copy.flags));
+                    copy.shader = shared->shader;
+                    copy.hotkey = shared->hotkey;
+                    copy.check = shared->check;
+                }
+                const uint64_t t1 = now_ns();
+                if (res.lat.size() < res.lat.capacity())
+                    res.lat.push_back((uint32_t)std::min<uint64_t>(t1 - t0, UINT32_MAX));
+
+                if (copy.version != seen)
+                    ++res.changes;
+                seen = copy.version;
+                for (int i = 0; i < STRESS_READS_PER_FRAME && check_values(&copy); ++i) {
+                }
+                ++res.frames;
+            }
+        });
+    }
+
+    const uint64_t end = now_ns() + (uint64_t)seconds * 1000000000ull;
+    while (now_ns() < end) {
+        stress_values* next = make_values(shared->version + 1);
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            std::swap(*shared, *next);
+        }
+        delete next;
+        if (interval_us)
+            sleep_us(interval_us);
+    }
+    stop = true;
+    for (std::thread& th : threads)
+        th.join();
+    delete shared;
+
+    print_result("locked", results, seconds);
+}
+
+int main(int argc, char** argv)
+{
+    const int readers = argc > 1 ? atoi(argv[1]) : 4;
+    const int seconds = argc > 2 ? atoi(argv[2]) : 3;
+    const unsigned interval_us = argc > 3 ? (unsigned)atoi(argv[3]) : 50;
+    if (readers < 1 || readers > ZM_RCU_MAX_READERS || seconds < 1) {
+        fprintf(stderr, "usage: zm_conf_stress [readers 1-%d] [seconds] [publish interval us]\n", ZM_RCU_MAX_READERS);
+        return 1;
+    }
+
+    printf("%d readers, %d s, publish every %u us\n", readers, seconds, interval_us);
+    run_locked(readers, seconds, interval_us);
+    run_rcu(readers, seconds, interval_us);
+
+    if (errors.load()) {
+        printf("FAILED: %llu errors\n", (unsigned long long)errors.load());
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,304 @@
+// zm_const_shadow_test: checks the slang constant shadow (src/const_shadow.cpp)
+// against a fake device
+//
+// Runs synthetic chains through the upload the runtime does per pass and
+// stage (zm_upload_consts in src/slang_d3d9.cpp): start the scratch image
+// from the shadow, pack every op, upload the dirty span, commit. The fake
+// device is a float4 register file that logs each Set*ShaderConstantF.
+// Like the real chain, every frame starts on registers the game left
+// (random values, shadow invalidated), the passes share registers with
+// different values (SourceSize, OutputSize), some uniforms change every
+// frame (FrameCount), some never (MVP, parameters), and a mid-frame blit
+// writes c0-c1 behind the shadow's back (csh_forget).
+//
+// Every upload is checked against a reference packed straight from the
+// ID3DXConstantTable rules: afterwards each register a pass uses holds
+// that pass' value, each register the shadow claims to know matches the
+// device, and the upload is exactly one call spanning the first to the
+// last register the pass uses that didn't already hold its value (or no
+// call when there is none). Reports calls and bytes per frame next to
+// what one call per uniform every pass would cost. Exits with 2 when a
+// check fails.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -Isrc tools/zm_const_shadow_test.cpp src/const_shadow.cpp -o zm_const_shadow_test
+// Run:
+//   ./zm_const_shadow_test [frames]
+
+#include "const_shadow.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using namespace ZeroMod;
+
+static uint32_t seed = 12345;
+static uint32_t rnd()
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8 ^ seed << 24;
+}
+static float rndf() { return (float)(rnd() % 2000) / 8.0f - 100.0f; }
+
+// ---- fake device ----
+struct fake_device
+{
+    float regs[ZM_SLANG_MAX_VS_CONSTS][4];
+    unsigned calls;
+    unsigned last_first, last_count;
+
+    void set_consts(unsigned first, const float* data, unsigned count)
+    {
+        memcpy(regs[first], data, count * sizeof(regs[0]));
+        calls++;
+        last_first = first;
+        last_count = count;
+    }
+};
+
+// ---- synthetic chain ----
+struct uniform
+{
+    slang_const_op op;
+    float value[16];        // ints stored as int32_t bits
+    bool per_frame;         // changes every frame
+};
+
+struct pass
+{
+    std::vector<uniform> vs, ps;
+};
+
+static slang_const_op make_op(unsigned reg, unsigned regs, unsigned dwords, unsigned cols, uint8_t layout)
+{
+    slang_const_op op = {};
+    op.source = ZM_SLOT_UNIFORM << 16;
+    op.reg = (uint16_t)reg;
+    op.regs = (uint16_t)regs;
+    op.dwords = (uint16_t)dwords;
+    op.cols = (uint8_t)cols;
+    op.layout = layout;
+    return op;
+}
+
+static void fill(uniform& u)
+{
+    for (unsigned k = 0; k < 16; ++k) {
+        if (u.op.layout == ZM_CL_INT) {
+            const int32_t v = (int32_t)(rnd() % 1000);
+            memcpy(&u.value[k], &v, 4);
+        }
+        else {
+            u.value[k] = rndf();
+        }
+    }
+}
+
+// MVP at c0-c3 and gl_HalfPixel at c4 in every VS; sizes, FrameCount and
+// parameters in the PS at registers the passes partly share
+static std::vector<pass> make_chain(unsigned passes)
+{
+    std::vector<pass> chain(passes);
+    for (unsigned i = 0; i < passes; ++i) {
+        pass& p = chain[i];
+        uniform mvp = {};
+        mvp.op = make_op(0, 4, 16, 4, i & 1 ? ZM_CL_MAT_COLS : ZM_CL_MAT_ROWS);
+        for (unsigned k = 0; k < 16; ++k)
+            mvp.value[k] = k % 5 == 0 ? 1.0f : 0.0f;
+        p.vs.push_back(mvp);
+
+        uniform hp = {};
+        hp.op = make_op(4, 1, 4, 4, ZM_CL_FLOAT);
+        fill(hp);
+        p.vs.push_back(hp);
+
+        unsigned reg = 0;
+        const unsigned n = 2 + rnd() % 6;
+        for (unsigned u = 0; u < n; ++u) {
+            uniform x = {};
+            switch (rnd() % 5) {
+            case 0: x.op = make_op(reg, 1, 4, 4, ZM_CL_FLOAT); break;               // a *Size
+            case 1: x.op = make_op(reg, 1, 1, 1, ZM_CL_INT); x.per_frame = true; break; // FrameCount
+            case 2: x.op = make_op(reg, 1, 1, 1, ZM_CL_FLOAT); break;               // a parameter
+            case 3: x.op = make_op(reg, 2, 6, 3, ZM_CL_FLOAT); break;               // float3[2]
+            default: x.op = make_op(reg, 1, 2, 2, ZM_CL_FLOAT); x.per_frame = rnd() & 1; break;
+            }
+            fill(x);
+            p.ps.push_back(x);
+            reg += x.op.regs + (rnd() % 3 == 0 ? 1 : 0);    // sometimes a gap
+        }
+    }
+    return chain;
+}
+
+// ---- reference packing, from the constant table rules ----
+static void ref_pack(const uniform& u, float (*out)[4])
+{
+    const slang_const_op& op = u.op;
+    for (unsigned r = 0; r < op.regs; ++r)
+        for (unsigned c = 0; c < 4; ++c)
+            out[r][c] = 0.0f;
+
+    if (op.layout == ZM_CL_MAT_ROWS || op.layout == ZM_CL_MAT_COLS) {
+        // SetMatrixTranspose: the transpose of the row-major matrix goes up,
+        // by rows for row_major storage and by columns for column_major
+        for (unsigned row = 0; row < 4; ++row)
+            for (unsigned col = 0; col < 4; ++col) {
+                const float m = u.value[row * 4 + col];
+                if (op.layout == ZM_CL_MAT_ROWS) out[col][row] = m;
+                else out[row][col] = m;
+            }
+        return;
+    }
+    for (unsigned k = 0; k < op.dwords; ++k) {
+        float v = u.value[k];
+        if (op.layout == ZM_CL_INT) {
+            int32_t i;
+            memcpy(&i, &u.value[k], 4);
+            v = (float)i;
+        }
+        out[k / op.cols][k % op.cols] = v;
+    }
+}
+
+struct counters
+{
+    uint64_t calls = 0, bytes = 0, naive_calls = 0, naive_bytes = 0, failures = 0;
+};
+
+static void fail(counters& c, unsigned frame, unsigned pass, const char* stage, const char* what)
+{
+    if (c.failures++ < 20)
+        printf("frame %u pass %u %s: %s: FAIL\n", frame, pass, stage, what);
+}
+
+// zm_upload_consts with the fake device, plus the checks
+static void upload(fake_device& dev, zm_const_shadow& shadow, bool* written, float (*scratch)[4],
+    const std::vector<uniform>& us, counters& c, unsigned frame, unsigned pass, const char* stage)
+{
+    if (us.empty())
+        return;
+
+    std::vector<slang_const_op> ops;
+    unsigned lo = ~0u, hi = 0;
+    for (const uniform& u : us) {
+        ops.push_back(u.op);
+        if (u.op.reg < lo) lo = u.op.reg;
+        if ((unsigned)u.op.reg + u.op.regs > hi) hi = (unsigned)u.op.reg + u.op.regs;
+        c.naive_calls++;
+        c.naive_bytes += u.op.regs * 16u;
+    }
+
+    // What the pass needs on the device, and the span a minimal upload covers
+    float want[ZM_SLANG_MAX_VS_CONSTS][4];
+    bool used[ZM_SLANG_MAX_VS_CONSTS] = {};
+    for (const uniform& u : us) {
+        ref_pack(u, &want[u.op.reg]);
+        for (unsigned r = u.op.reg; r < (unsigned)u.op.reg + u.op.regs; ++r)
+            used[r] = true;
+    }
+    unsigned need_lo = ~0u, need_hi = 0;
+    for (unsigned r = 0; r < ZM_SLANG_MAX_VS_CONSTS; ++r)
+        if (used[r] && (!written[r] || memcmp(dev.regs[r], want[r], sizeof(want[r])) != 0)) {
+            if (r < need_lo) need_lo = r;
+            need_hi = r;
+        }
+
+    float before[ZM_SLANG_MAX_VS_CONSTS][4];
+    memcpy(before, dev.regs, sizeof(before));
+    const unsigned calls0 = dev.calls;
+
+    csh_begin(shadow, scratch, lo, hi);
+    for (const uniform& u : us)
+        csh_pack(scratch, u.op, u.value);
+    unsigned first = 0, count = 0;
+    if (csh_dirty_span(shadow, scratch, ops.data(), (unsigned)ops.size(), first, count)) {
+        dev.set_consts(first, scratch[first], count);
+        csh_commit(shadow, scratch, first, count);
+        for (unsigned r = first; r < first + count; ++r)
+            written[r] = true;
+        c.calls++;
+        c.bytes += count * 16u;
+    }
+
+    const unsigned made = dev.calls - calls0;
+    if (need_lo == ~0u) {
+        if (made)
+            fail(c, frame, pass, stage, "uploaded with every register already in place");
+    }
+    else if (made != 1 || dev.last_first != need_lo || dev.last_first + dev.last_count != need_hi + 1) {
+        char b[128];
+        snprintf(b, sizeof(b), "%u call(s) c%u..c%u, minimal is c%u..c%u", made,
+            dev.last_first, dev.last_first + dev.last_count - 1, need_lo, need_hi);
+        fail(c, frame, pass, stage, b);
+    }
+
+    for (unsigned r = 0; r < ZM_SLANG_MAX_VS_CONSTS; ++r) {
+        if (used[r] && memcmp(dev.regs[r], want[r], sizeof(want[r])) != 0)
+            fail(c, frame, pass, stage, "a register the pass uses has the wrong value");
+        const bool known = (shadow.known[r >> 5] >> (r & 31)) & 1u;
+        if (known && memcmp(dev.regs[r], shadow.regs[r], sizeof(want[r])) != 0)
+            fail(c, frame, pass, stage, "the shadow disagrees with the device");
+        if (!used[r] && (r < first || r >= first + count) && memcmp(dev.regs[r], before[r], sizeof(want[r])) != 0)
+            fail(c, frame, pass, stage, "a register outside the upload changed");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned frames = argc > 1 ? (unsigned)atoi(argv[1]) : 600;
+
+    bool ok = true;
+    for (unsigned passes : { 1u, 3u, 7u }) {
+        const std::vector<pass> proto = make_chain(passes);
+
+        fake_device vs_dev = {}, ps_dev = {};
+        static zm_const_shadow vs_shadow, ps_shadow;
+        static float scratch[ZM_SLANG_MAX_VS_CONSTS][4];
+        counters c;
+
+        std::vector<pass> chain = proto;
+        for (unsigned f = 0; f < frames; ++f) {
+            // The state block gave the game's constants back since last frame
+            for (unsigned r = 0; r < ZM_SLANG_MAX_VS_CONSTS; ++r)
+                for (unsigned k = 0; k < 4; ++k) {
+                    vs_dev.regs[r][k] = rndf();
+                    ps_dev.regs[r][k] = rndf();
+                }
+            csh_invalidate(vs_shadow);
+            csh_invalidate(ps_shadow);
+            bool vs_written[ZM_SLANG_MAX_VS_CONSTS] = {}, ps_written[ZM_SLANG_MAX_VS_CONSTS] = {};
+
+            // The crop blit's transform, written without the shadow
+            if (f % 3 == 0) {
+                const float blit[2][4] = { { 2, 0, 0, -1 }, { 0, -2, 0, 1 } };
+                vs_dev.set_consts(0, blit[0], 2);
+                csh_forget(vs_shadow, 0, 2);
+            }
+
+            for (unsigned i = 0; i < passes; ++i) {
+                for (uniform& u : chain[i].ps)
+                    if (u.per_frame)
+                        fill(u);
+                // A parameter tweak now and then
+                if (rnd() % 50 == 0 && !chain[i].ps.empty())
+                    fill(chain[i].ps[rnd() % chain[i].ps.size()]);
+
+                upload(vs_dev, vs_shadow, vs_written, scratch, chain[i].vs, c, f, i, "VS");
+                upload(ps_dev, ps_shadow, ps_written, scratch, chain[i].ps, c, f, i, "PS");
+            }
+        }
+
+        printf("%u pass(es): %.1f calls, %.0f bytes per frame; one call per uniform: %.1f calls, %.0f bytes\n",
+            passes, (double)c.calls / frames, (double)c.bytes / frames,
+            (double)c.naive_calls / frames, (double)c.naive_bytes / frames);
+        if (c.failures) {
+            printf("%llu failure(s)\n", (unsigned long long)c.failures);
+            ok = false;
+        }
+    }
+    printf("uploads: %s\n", ok ? "ok" : "FAIL");
+    return ok ? 0 : 2;
+}
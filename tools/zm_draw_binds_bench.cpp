@@ -0,0 +1,489 @@
+// zm_draw_binds_bench: what DrawPrimitive pays per draw to learn RT0, the
+// stage 0 texture and the viewport (src/draw_binds.cpp)
+//
+// Generates a draw stream: a few render target switches per frame, some
+// viewport changes, a texture bound before about half the draws (2D ones
+// made through the proxy or behind it, cube textures, null) and now and
+// then a texture set or a state block applied behind the proxy. It then
+// replays the stream against a fake device three ways:
+//   roundtrip  what DrawPrimitive did before the mirror: GetRenderTarget +
+//              GetDesc, GetTexture + QueryInterface + GetLevelDesc and
+//              GetViewport on every draw (once, where the old code did it
+//              for each test)
+//   resync     ZM_DRAW_BINDS 0: db_sync re-reads all three every draw,
+//              texture sizes from the descriptor table
+//   mirror     ZM_DRAW_BINDS 1: db_sync re-reads only what was invalidated
+// and prints ns/draw and device reads/draw for each. The fake's calls are
+// bare virtual calls, so the runtime's cost per call (its lock, the
+// refcounting) comes on top of the roundtrip and resync figures.
+//
+// Checks that every draw sees the same bindings in all three modes and
+// that every reference a Get* took was dropped. Exits with 2 when a check
+// fails.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -Isrc -Itools/fake_d3d9 tools/zm_draw_binds_bench.cpp src/draw_binds.cpp -o zm_draw_binds_bench
+// Run:
+//   ./zm_draw_binds_bench --frames 600
+// Options:
+//   --frames N       frames in the stream (default 600)
+//   --draws N        draws per frame (default 400)
+//   --rounds N       replays per mode, the best one counts (default 5)
+
+#include "draw_binds.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace ZeroMod;
+
+static uint32_t seed = 12345;
+static uint32_t rnd()
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+// Get*, QueryInterface, GetDesc and GetLevelDesc calls
+static uint64_t g_reads = 0;
+
+// ---- fake objects ----
+template <class I>
+struct fake_obj : I
+{
+    int refs = 1;
+    UINT w = 0, h = 0;
+
+    ULONG AddRef() override { return (ULONG)++refs; }
+    ULONG Release() override { return (ULONG)--refs; }    // owned by the bench, never freed
+};
+
+template <class I>
+static void ref_set(I*& slot, I* v)
+{
+    if (v) v->AddRef();
+    if (slot) slot->Release();
+    slot = v;
+}
+
+struct fake_surface : fake_obj<IDirect3DSurface9>
+{
+    HRESULT GetDesc(D3DSURFACE_DESC* d) override
+    {
+        g_reads++;
+        *d = {};
+        d->Format = D3DFMT_X8R8G8B8;
+        d->Width = w;
+        d->Height = h;
+        return S_OK;
+    }
+};
+
+// Holds its IUnknown private data like the runtime does, until replaced
+// or the texture goes away
+template <class I>
+struct fake_texture : fake_obj<I>
+{
+    IUnknown* priv = nullptr;
+
+    HRESULT SetPrivateData(REFGUID, const void* data, DWORD size, DWORD flags) override
+    {
+        if (!(flags & D3DSPD_IUNKNOWN) || size != sizeof(IUnknown*))
+            return D3DERR_INVALIDCALL;
+        // D3DSPD_IUNKNOWN: 'data' is the object itself
+        ref_set(priv, (IUnknown*)data);
+        return S_OK;
+    }
+
+    void destroy() { ref_set(priv, (IUnknown*)nullptr); }
+};
+
+struct fake_tex2d : fake_texture<IDirect3DTexture9>
+{
+    HRESULT QueryInterface(REFIID riid, void** out) override
+    {
+        g_reads++;
+        if (riid == IID_IDirect3DTexture9) {
+            AddRef();
+            *out = static_cast<IDirect3DTexture9*>(this);
+            return S_OK;
+        }
+        *out = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    HRESULT GetLevelDesc(UINT level, D3DSURFACE_DESC* d) override
+    {
+        g_reads++;
+        if (level)
+            return D3DERR_INVALIDCALL;
+        *d = {};
+        d->Format = D3DFMT_A8R8G8B8;
+        d->Width = w;
+        d->Height = h;
+        return S_OK;
+    }
+};
+
+// Answers only IUnknown, like a cube or volume texture asked for a 2D one
+struct fake_cube : fake_texture<IDirect3DBaseTexture9>
+{
+    HRESULT QueryInterface(REFIID, void** out) override
+    {
+        g_reads++;
+        *out = nullptr;
+        return E_NOINTERFACE;
+    }
+};
+
+// ---- fake device: RT0, stage 0 and the viewport ----
+struct fake_device : IDirect3DDevice9
+{
+    IDirect3DSurface9* rt0 = nullptr;
+    IDirect3DBaseTexture9* tex0 = nullptr;
+    D3DVIEWPORT9 vp = {};
+
+    ULONG AddRef() override { return 1; }
+    ULONG Release() override { return 1; }
+
+    HRESULT SetRenderTarget(DWORD i, IDirect3DSurface9* s) override
+    {
+        if (i || !s)
+            return D3DERR_INVALIDCALL;
+        ref_set(rt0, s);
+        const fake_surface* f = static_cast<const fake_surface*>(s);
+        vp = { 0, 0, f->w, f->h, 0.0f, 1.0f };
+        return S_OK;
+    }
+    HRESULT GetRenderTarget(DWORD i, IDirect3DSurface9** out) override
+    {
+        g_reads++;
+        if (i || !rt0) { *out = nullptr; return D3DERR_NOTAVAILABLE; }
+        rt0->AddRef();
+        *out = rt0;
+        return S_OK;
+    }
+    HRESULT SetViewport(const D3DVIEWPORT9* v) override { vp = *v; return S_OK; }
+    HRESULT GetViewport(D3DVIEWPORT9* v) override { g_reads++; *v = vp; return S_OK; }
+    HRESULT SetTexture(DWORD s, IDirect3DBaseTexture9* t) override
+    {
+        if (s)
+            return D3DERR_INVALIDCALL;
+        ref_set(tex0, t);
+        return S_OK;
+    }
+    HRESULT GetTexture(DWORD s, IDirect3DBaseTexture9** out) override
+    {
+        g_reads++;
+        *out = s ? nullptr : tex0;
+        if (*out) (*out)->AddRef();
+        return s ? D3DERR_INVALIDCALL : S_OK;
+    }
+
+    // draw_binds never touches the rest
+    HRESULT CreateStateBlock(D3DSTATEBLOCKTYPE, IDirect3DStateBlock9**) override { return D3DERR_INVALIDCALL; }
+    HRESULT CreateQuery(D3DQUERYTYPE, IDirect3DQuery9**) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetDepthStencilSurface(IDirect3DSurface9*) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetDepthStencilSurface(IDirect3DSurface9**) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetRenderState(D3DRENDERSTATETYPE, DWORD) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetRenderState(D3DRENDERSTATETYPE, DWORD*) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetTextureStageState(DWORD, D3DTEXTURESTAGESTATETYPE, DWORD*) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetTextureStageState(DWORD, D3DTEXTURESTAGESTATETYPE, DWORD) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetSamplerState(DWORD, D3DSAMPLERSTATETYPE, DWORD*) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetSamplerState(DWORD, D3DSAMPLERSTATETYPE, DWORD) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetScissorRect(const RECT*) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetScissorRect(RECT*) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetVertexDeclaration(IDirect3DVertexDeclaration9*) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetVertexDeclaration(IDirect3DVertexDeclaration9**) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetFVF(DWORD) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetFVF(DWORD*) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetVertexShader(IDirect3DVertexShader9*) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetVertexShader(IDirect3DVertexShader9**) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetVertexShaderConstantF(UINT, const float*, UINT) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetVertexShaderConstantF(UINT, float*, UINT) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetStreamSource(UINT, IDirect3DVertexBuffer9*, UINT, UINT) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetStreamSource(UINT, IDirect3DVertexBuffer9**, UINT*, UINT*) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetPixelShader(IDirect3DPixelShader9*) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetPixelShader(IDirect3DPixelShader9**) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetPixelShaderConstantF(UINT, const float*, UINT) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetPixelShaderConstantF(UINT, float*, UINT) override { return D3DERR_INVALIDCALL; }
+};
+
+// ---- the stream ----
+enum {
+    OP_RT,              // SetRenderTarget(0)
+    OP_VP,              // SetViewport
+    OP_TEX,             // SetTexture(0) through the proxy
+    OP_TEX_BEHIND,      // SetTexture(0) the proxy doesn't see
+    OP_APPLY,           // a state block applied: every binding unknown
+    OP_DRAW,
+};
+
+struct op
+{
+    uint8_t kind;
+    int idx;            // RT or texture index, -1 for a null texture
+    D3DVIEWPORT9 vp;
+};
+
+struct scene
+{
+    std::vector<fake_surface> rts;
+    std::vector<fake_tex2d> tex;
+    std::vector<fake_cube> cubes;
+    unsigned proxy_tex = 0;     // tex[0, proxy_tex) were created through the proxy
+
+    IDirect3DBaseTexture9* texture(int i)
+    {
+        if (i < 0) return nullptr;
+        if ((unsigned)i < tex.size()) return &tex[i];
+        return &cubes[i - tex.size()];
+    }
+};
+
+static void make_scene(scene& s)
+{
+    static const UINT rt_sizes[][2] = { { 1280, 960 }, { 640, 480 }, { 512, 384 }, { 256, 256 } };
+    static const UINT tex_sizes[][2] = {
+        { 512, 384 }, { 1280, 960 }, { 256, 256 }, { 512, 256 }, { 64, 64 }, { 128, 32 }, { 640, 480 },
+    };
+
+    s.rts.resize(sizeof(rt_sizes) / sizeof(rt_sizes[0]));
+    for (size_t i = 0; i < s.rts.size(); ++i) {
+        s.rts[i].w = rt_sizes[i][0];
+        s.rts[i].h = rt_sizes[i][1];
+    }
+    s.tex.resize(48);
+    for (size_t i = 0; i < s.tex.size(); ++i) {
+        const UINT* sz = tex_sizes[rnd() % (sizeof(tex_sizes) / sizeof(tex_sizes[0]))];
+        s.tex[i].w = sz[0];
+        s.tex[i].h = sz[1];
+    }
+    s.proxy_tex = 36;
+    s.cubes.resize(4);
+}
+
+static void make_stream(const scene& s, unsigned frames, unsigned draws, std::vector<op>& ops)
+{
+    const int textures = (int)(s.tex.size() + s.cubes.size());
+    for (unsigned f = 0; f < frames; ++f) {
+        const unsigned passes = 4 + rnd() % 5;
+        for (unsigned p = 0; p < passes; ++p) {
+            const int rt = p == passes - 1 ? 0 : (int)(rnd() % s.rts.size());
+            ops.push_back({ OP_RT, rt, {} });
+
+            if (rnd() % 10 < 3) {
+                const UINT w = s.rts[rt].w, h = s.rts[rt].h;
+                const DWORD x = rnd() % (w / 2), y = rnd() % (h / 2);
+                ops.push_back({ OP_VP, 0, { x, y, w / 2, h / 2, 0.0f, 1.0f } });
+            }
+
+            const unsigned n = p == passes - 1 ? draws - draws / passes * (passes - 1) : draws / passes;
+            for (unsigned d = 0; d < n; ++d) {
+                const uint32_t r = rnd() % 100;
+                if (r < 50)
+                    ops.push_back({ OP_TEX, r < 3 ? -1 : (int)(rnd() % textures), {} });
+                else if (r < 52)
+                    ops.push_back({ OP_TEX_BEHIND, (int)(rnd() % textures), {} });
+                ops.push_back({ OP_DRAW, 0, {} });
+            }
+        }
+        ops.push_back({ OP_APPLY, 0, {} });
+    }
+}
+
+// ---- replay ----
+enum { M_ROUNDTRIP, M_RESYNC, M_MIRROR, M_COUNT };
+static const char* const mode_names[M_COUNT] = { "roundtrip", "resync", "mirror" };
+
+struct binds
+{
+    UINT rt_w, rt_h;
+    const void* tex0;
+    UINT tex_2d, tex_w, tex_h;
+    D3DVIEWPORT9 vp;
+};
+
+static inline void mix(uint64_t& h, uint64_t v)
+{
+    h = (h ^ v) * 0x100000001B3ull;
+}
+
+static inline void digest(uint64_t& h, const binds& b)
+{
+    mix(h, b.rt_w); mix(h, b.rt_h);
+    mix(h, (uint64_t)(uintptr_t)b.tex0);
+    mix(h, b.tex_2d); mix(h, b.tex_w); mix(h, b.tex_h);
+    mix(h, b.vp.X); mix(h, b.vp.Y); mix(h, b.vp.Width); mix(h, b.vp.Height);
+}
+
+// The pre-mirror sequence, as the game-rect test had it
+static void read_roundtrip(IDirect3DDevice9* dev, binds& b)
+{
+    b = {};
+    IDirect3DSurface9* rt0 = nullptr;
+    if (SUCCEEDED(dev->GetRenderTarget(0, &rt0)) && rt0) {
+        D3DSURFACE_DESC rd = {};
+        rt0->GetDesc(&rd);
+        b.rt_w = rd.Width;
+        b.rt_h = rd.Height;
+
+        IDirect3DBaseTexture9* t0b = nullptr;
+        IDirect3DTexture9* t0 = nullptr;
+        D3DSURFACE_DESC td = {};
+        if (SUCCEEDED(dev->GetTexture(0, &t0b)) && t0b)
+            t0b->QueryInterface(IID_IDirect3DTexture9, (void**)&t0);
+        if (t0)
+            t0->GetLevelDesc(0, &td);
+        b.tex0 = t0b;
+        b.tex_2d = t0 != nullptr;
+        b.tex_w = td.Width;
+        b.tex_h = td.Height;
+
+        dev->GetViewport(&b.vp);
+
+        if (t0) t0->Release();
+        if (t0b) t0b->Release();
+        rt0->Release();
+    }
+}
+
+struct result
+{
+    uint64_t hash;
+    uint64_t reads;
+    double ns;
+};
+
+static result replay(int mode, scene& s, fake_device& dev, const std::vector<op>& ops)
+{
+    // Textures the proxy created went into the table then, not per draw
+    zm_res_table table = {};
+    for (unsigned i = 0; i < s.proxy_tex; ++i)
+        res_put(table, &s.tex[i], s.tex[i].w, s.tex[i].h, D3DFMT_A8R8G8B8, ZM_RES_TEX2D);
+
+    dev.SetRenderTarget(0, &s.rts[0]);
+    dev.SetTexture(0, nullptr);
+    zm_draw_binds db = {};
+
+    result r = {};
+    r.hash = 0xCBF29CE484222325ull;
+    const uint64_t reads0 = g_reads;
+    const auto t0 = std::chrono::steady_clock::now();
+
+    for (const op& o : ops) {
+        switch (o.kind) {
+        case OP_RT:
+            if (SUCCEEDED(dev.SetRenderTarget(0, &s.rts[o.idx])))
+                db_set_rt0(db, &s.rts[o.idx]);
+            break;
+        case OP_VP:
+            if (SUCCEEDED(dev.SetViewport(&o.vp)))
+                db_set_viewport(db, o.vp);
+            break;
+        case OP_TEX:
+            if (SUCCEEDED(dev.SetTexture(0, s.texture(o.idx))))
+                db_set_tex0(db, table, s.texture(o.idx));
+            break;
+        case OP_TEX_BEHIND:
+            dev.SetTexture(0, s.texture(o.idx));
+            db_invalidate(db, ZM_DB_TEX0);
+            break;
+        case OP_APPLY:
+            db_invalidate(db, ZM_DB_ALL);
+            break;
+        case OP_DRAW: {
+            binds b;
+            if (mode == M_ROUNDTRIP) {
+                read_roundtrip(&dev, b);
+            }
+            else {
+                // what db_sync does first when built with ZM_DRAW_BINDS 0
+                if (mode == M_RESYNC)
+                    db_invalidate(db, ZM_DB_ALL);
+                db_sync(db, table, &dev);
+                b.rt_w = db.rt0_w;
+                b.rt_h = db.rt0_h;
+                b.tex0 = db.tex0;
+                b.tex_2d = db.tex0_2d != nullptr;
+                b.tex_w = db.tex0_w;
+                b.tex_h = db.tex0_h;
+                b.vp = db.vp;
+            }
+            digest(r.hash, b);
+            break;
+        }
+        }
+    }
+
+    r.ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    r.reads = g_reads - reads0;
+    res_free(table);
+    return r;
+}
+
+static void usage()
+{
+    printf("usage: zm_draw_binds_bench [--frames N] [--draws N] [--rounds N]\n");
+}
+
+int main(int argc, char** argv)
+{
+    unsigned frames = 600, draws = 400, rounds = 5;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        const bool more = i + 1 < argc;
+        if (a == "--frames" && more) frames = (unsigned)atoi(argv[++i]);
+        else if (a == "--draws" && more) draws = (unsigned)atoi(argv[++i]);
+        else if (a == "--rounds" && more) rounds = (unsigned)atoi(argv[++i]);
+        else { usage(); return 1; }
+    }
+    if (!frames) frames = 1;
+    if (draws < 8) draws = 8;
+    if (!rounds) rounds = 1;
+
+    scene s;
+    make_scene(s);
+    std::vector<op> ops;
+    make_stream(s, frames, draws, ops);
+    const double total_draws = (double)frames * draws;
+
+    fake_device dev;
+    bool ok = true;
+    result best[M_COUNT] = {};
+    for (unsigned n = 0; n < rounds; ++n) {
+        for (int m = 0; m < M_COUNT; ++m) {
+            const result r = replay(m, s, dev, ops);
+            if (!n || r.ns < best[m].ns)
+                best[m] = r;
+            if (r.hash != best[M_ROUNDTRIP].hash && m != M_ROUNDTRIP) {
+                printf("%s: bindings differ from roundtrip: FAIL\n", mode_names[m]);
+                ok = false;
+            }
+        }
+    }
+
+    // Only the device's and the bench's own references may be left
+    ref_set(dev.rt0, (IDirect3DSurface9*)nullptr);
+    ref_set(dev.tex0, (IDirect3DBaseTexture9*)nullptr);
+    int leaked = 0;
+    for (const fake_surface& o : s.rts) leaked += o.refs != 1;
+    for (fake_tex2d& o : s.tex) { leaked += o.refs != 1; o.destroy(); }
+    for (fake_cube& o : s.cubes) { leaked += o.refs != 1; o.destroy(); }
+    if (leaked) {
+        printf("%d object(s) with references left: FAIL\n", leaked);
+        ok = false;
+    }
+
+    printf("%u frames x %u draws, best of %u\n", frames, draws, rounds);
+    for (int m = 0; m < M_COUNT; ++m)
+        printf("  %-10s %7.2f ns/draw  %5.2f reads/draw\n", mode_names[m],
+            best[m].ns / total_draws, best[m].reads / total_draws);
+    if (best[M_MIRROR].ns > 0)
+        printf("  mirror vs roundtrip: %.1fx\n", best[M_ROUNDTRIP].ns / best[M_MIRROR].ns);
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,293 @@
+// zm_draw_sig_check: checks the draw signature matcher (src/draw_sig.cpp)
+// against brute force
+//
+// Three parts:
+//  - the compiled byte-slice tables against evaluating k_draw_sigs one
+//    signature at a time (require all set, forbid all clear), over every
+//    combination of the key bits the proxy sets and random 32-bit keys;
+//  - ds_compile on random tables of 1 to 32 signatures the same way;
+//  - ds_bind_key plus the table against the hand-written predicate chain
+//    DrawPrimitive used before the table (copied below, including the
+//    latch step clearing a same-draw expiry), over random bindings drawn
+//    around the sizes the predicates test: composite, backbuffer, game
+//    layer, full, 4:3 and 3:2 sub-rect viewports, no RT0, non-2D stage 0.
+//
+// Exits with 2 when a check fails.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -Isrc tools/zm_draw_sig_check.cpp src/draw_sig.cpp -o zm_draw_sig_check
+// Run:
+//   ./zm_draw_sig_check [random keys]
+
+#include "draw_sig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace ZeroMod;
+
+static uint32_t seed = 12345;
+static uint32_t rnd()
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8 ^ seed << 24;
+}
+
+static unsigned g_fail = 0;
+
+static void fail(const char* what, uint32_t key, uint32_t got, uint32_t want)
+{
+    if (g_fail++ < 10)
+        printf("%s: key %08x matched %08x, expected %08x: FAIL\n", what, key, got, want);
+}
+
+static uint32_t brute(const zm_draw_sig* sigs, uint32_t count, uint32_t key)
+{
+    uint32_t hit = 0;
+    for (uint32_t r = 0; r < count; ++r)
+        if ((key & sigs[r].require) == sigs[r].require && !(key & sigs[r].forbid))
+            hit |= 1u << r;
+    return hit;
+}
+
+// ---- the predicates DrawPrimitive had before the signature table ----
+static bool is_4_3(uint32_t w, uint32_t h) {
+    return w && h && (w * 3 == h * 4);
+}
+static inline bool is_3_2(uint32_t w, uint32_t h)
+{
+    if (!w || !h) return false;
+
+    // 3:2 => w*2 == h*3, with tiny tolerance for rounding
+    const uint64_t lhs = (uint64_t)w * 2ull;
+    const uint64_t rhs = (uint64_t)h * 3ull;
+    const uint64_t diff = (lhs > rhs) ? (lhs - rhs) : (rhs - lhs);
+    return diff <= 8;
+}
+
+struct wanted_state
+{
+    bool active, chain, src_tex, latched, stale;
+};
+
+// What the old chain did on a strip quad, as the signature bits that
+// DrawPrimitive acts on
+static uint32_t legacy_decide(const zm_draw_bind_state& db, wanted_state w)
+{
+    uint32_t out = 0;
+
+    if (!w.active && db.rt0 && db.rt0_w == 1280 && db.rt0_h == 960)
+        out |= ZM_DS_BIT(ZM_DS_PRE_WANT_COMPOSITE);
+
+    if (w.active && w.src_tex && db.rt0) {
+        const bool rt_is_composite = (db.rt0_w == 1280 && db.rt0_h == 960);
+        const bool t0_is_game_layer = (db.tex0_w == 512 && db.tex0_h == 384);
+        const bool vp_full_composite =
+            (db.vp_x == 0 && db.vp_y == 0 && db.vp_w == db.rt0_w && db.vp_h == db.rt0_h);
+        if (rt_is_composite && vp_full_composite) {
+            out |= ZM_DS_BIT(ZM_DS_COMPOSITE_FULL);
+            if (db.tex0_2d && t0_is_game_layer)
+                out |= ZM_DS_BIT(ZM_DS_SWALLOW_GAME_LAYER);
+        }
+    }
+
+    if (w.active && w.chain && w.src_tex) {
+        const bool is_composite_t0 = db.tex0_2d && db.tex0_w == 1280 && db.tex0_h == 960;
+        if (is_composite_t0) {
+            out |= ZM_DS_BIT(ZM_DS_LATCH_COMPOSITE);
+            // latch_draw_id is now this draw
+            w.latched = true;
+            w.stale = false;
+        }
+    }
+
+    if (w.active && w.chain && w.src_tex && w.latched) {
+        if (w.stale) {
+            out |= ZM_DS_BIT(ZM_DS_LATCH_EXPIRE);
+        }
+        else if (db.rt0) {
+            const bool rt_full = (db.rt0_w == db.bb_w && db.rt0_h == db.bb_h);
+            const bool t0_is_composite = (db.tex0_w == 1280 && db.tex0_h == 960);
+            const bool vp_is_subrect =
+                (db.vp_w > 0 && db.vp_h > 0) &&
+                (db.vp_w <= db.rt0_w && db.vp_h <= db.rt0_h) &&
+                !(db.vp_x == 0 && db.vp_y == 0 && db.vp_w == db.rt0_w && db.vp_h == db.rt0_h);
+            const bool vp_is_game_aspect = is_4_3(db.vp_w, db.vp_h) || is_3_2(db.vp_w, db.vp_h);
+            if (rt_full && t0_is_composite && vp_is_subrect && vp_is_game_aspect)
+                out |= is_3_2(db.vp_w, db.vp_h) ? ZM_DS_BIT(ZM_DS_GAME_RECT_3_2) : ZM_DS_BIT(ZM_DS_GAME_RECT_4_3);
+        }
+    }
+
+    if (!w.active)
+        out |= ZM_DS_BIT(ZM_DS_LEGACY);
+    return out;
+}
+
+// The same through the table, reduced the way DrawPrimitive reads the bits
+static uint32_t table_decide(zm_draw_matcher& m, const zm_draw_bind_state& db, const wanted_state& w)
+{
+    uint32_t key = ds_bind_key(db);
+    if (w.active) key |= ZM_DK_WANTED;
+    if (w.chain) key |= ZM_DK_CHAIN;
+    if (w.src_tex) key |= ZM_DK_SRC_TEX;
+    if (w.latched) key |= ZM_DK_LATCHED;
+    if (w.stale) key |= ZM_DK_LATCH_STALE;
+
+    uint32_t sig = ds_match_count(m, key);
+    if (sig & ZM_DS_BIT(ZM_DS_LATCH_COMPOSITE))
+        sig &= ~ZM_DS_BIT(ZM_DS_LATCH_EXPIRE);
+    // Both aspects can hold; vp_is_32 picks 3:2
+    const uint32_t rect = ZM_DS_BIT(ZM_DS_GAME_RECT_4_3) | ZM_DS_BIT(ZM_DS_GAME_RECT_3_2);
+    if ((sig & rect) == rect)
+        sig &= ~ZM_DS_BIT(ZM_DS_GAME_RECT_4_3);
+    return sig;
+}
+
+// ---- random bindings around the interesting sizes ----
+static void pick_size(uint32_t& w, uint32_t& h, uint32_t bb_w, uint32_t bb_h)
+{
+    static const uint32_t k_sizes[][2] = {
+        { 1280, 960 }, { 512, 384 }, { 256, 192 }, { 1920, 1080 }, { 2560, 1440 }, { 640, 480 }, { 0, 0 },
+    };
+    switch (rnd() % 10) {
+    case 0: w = bb_w; h = bb_h; break;
+    case 1: w = 1 + rnd() % 3000; h = 1 + rnd() % 2000; break;
+    default: {
+        const uint32_t i = rnd() % (sizeof(k_sizes) / sizeof(k_sizes[0]));
+        w = k_sizes[i][0];
+        h = k_sizes[i][1];
+        break;
+    }
+    }
+}
+
+static zm_draw_bind_state random_binds()
+{
+    zm_draw_bind_state s = {};
+    static const uint32_t k_bb[][2] = { { 1920, 1080 }, { 2560, 1440 }, { 1280, 960 } };
+    const uint32_t b = rnd() % 3;
+    s.bb_w = k_bb[b][0];
+    s.bb_h = k_bb[b][1];
+
+    s.rt0 = rnd() % 8 != 0;
+    if (s.rt0)
+        pick_size(s.rt0_w, s.rt0_h, s.bb_w, s.bb_h);
+
+    // Viewport: the full RT, a centered 4:3 or 3:2 rect, or anything
+    switch (rnd() % 5) {
+    case 0:
+        s.vp_w = s.rt0_w;
+        s.vp_h = s.rt0_h;
+        break;
+    case 1:
+    case 2: {
+        const bool wide = rnd() % 2;
+        // Now and then a row taller than RT0
+        const uint32_t h = s.rt0_h ? s.rt0_h + 16 - (rnd() % 4) * 16 : 960;
+        s.vp_h = h;
+        s.vp_w = wide ? h * 3 / 2 + rnd() % 3 : h * 4 / 3;
+        s.vp_x = s.rt0_w > s.vp_w ? (s.rt0_w - s.vp_w) / 2 : 0;
+        s.vp_y = s.rt0_h > h ? (s.rt0_h - h) / 2 : 0;
+        break;
+    }
+    default:
+        pick_size(s.vp_w, s.vp_h, s.bb_w, s.bb_h);
+        s.vp_x = rnd() % 3 ? 0 : rnd() % 64;
+        s.vp_y = rnd() % 3 ? 0 : rnd() % 64;
+        break;
+    }
+
+    // Stage 0: the descriptor table only has a size for 2D textures
+    s.tex0_2d = rnd() % 6 != 0;
+    if (s.tex0_2d)
+        pick_size(s.tex0_w, s.tex0_h, s.bb_w, s.bb_h);
+    return s;
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned keys = argc > 1 ? (unsigned)atoi(argv[1]) : 1000000;
+
+    // 1. The proxy's table, every combination of the bits it sets
+    static zm_draw_matcher m;
+    if (!ds_compile(m, k_draw_sigs, ZM_DS_COUNT)) {
+        puts("ds_compile refused the table: FAIL");
+        return 2;
+    }
+    uint32_t used = 0;
+    for (uint32_t r = 0; r < ZM_DS_COUNT; ++r)
+        used |= k_draw_sigs[r].require | k_draw_sigs[r].forbid;
+    unsigned combos = 0;
+    for (uint32_t k = used;; k = (k - 1) & used) {
+        combos++;
+        const uint32_t got = ds_match(m, k), want = brute(k_draw_sigs, ZM_DS_COUNT, k);
+        if (got != want)
+            fail("k_draw_sigs", k, got, want);
+        if (!k)
+            break;
+    }
+    for (unsigned i = 0; i < keys; ++i) {
+        const uint32_t k = rnd();
+        const uint32_t got = ds_match(m, k), want = brute(k_draw_sigs, ZM_DS_COUNT, k);
+        if (got != want)
+            fail("k_draw_sigs", k, got, want);
+    }
+    printf("table: %u signatures, %u key combinations + %u random keys\n", (unsigned)ZM_DS_COUNT, combos, keys);
+
+    // 2. Random tables
+    static zm_draw_matcher rm;
+    zm_draw_sig sigs[32];
+    const unsigned tables = 2000;
+    for (unsigned t = 0; t < tables; ++t) {
+        const uint32_t count = 1 + rnd() % 32;
+        for (uint32_t r = 0; r < count; ++r) {
+            // Sparse like the real table; a require/forbid overlap never matches
+            sigs[r].name = "random";
+            sigs[r].require = rnd() & rnd() & rnd();
+            sigs[r].forbid = rnd() & rnd() & rnd() & rnd();
+        }
+        ds_compile(rm, sigs, count);
+        for (unsigned i = 0; i < 500; ++i) {
+            // Half near a signature, so matches actually happen
+            uint32_t k = rnd();
+            if (i & 1) {
+                const zm_draw_sig& s = sigs[rnd() % count];
+                k = (k | s.require) & ~(rnd() % 4 ? s.forbid : 0);
+            }
+            const uint32_t got = ds_match(rm, k), want = brute(sigs, count, k);
+            if (got != want)
+                fail("random table", k, got, want);
+        }
+    }
+    if (ds_compile(rm, sigs, 33))
+        fail("33 signatures accepted", 0, 0, 0);
+    printf("random tables: %u, 500 keys each\n", tables);
+
+    // 3. Bindings through ds_bind_key and the table vs the old predicates
+    static zm_draw_matcher dm;
+    ds_compile(dm, k_draw_sigs, ZM_DS_COUNT);
+    const unsigned draws = keys;
+    unsigned hits[ZM_DS_COUNT] = {};
+    for (unsigned i = 0; i < draws; ++i) {
+        const zm_draw_bind_state db = random_binds();
+        const uint32_t f = rnd();
+        const wanted_state w = { (f & 3) != 0, (f & 4) != 0, (f & 8) != 0, (f & 16) != 0, (f & 0xE0) == 0 };
+
+        const uint32_t got = table_decide(dm, db, w), want = legacy_decide(db, w);
+        if (got != want)
+            fail("bindings", ds_bind_key(db), got, want);
+        for (uint32_t r = 0; r < ZM_DS_COUNT; ++r)
+            if (want >> r & 1)
+                hits[r]++;
+    }
+    printf("bindings: %u draws vs the old predicates\n", draws);
+    for (uint32_t r = 0; r < ZM_DS_COUNT; ++r) {
+        printf("  %-20s %u\n", k_draw_sigs[r].name, hits[r]);
+        if (!hits[r])
+            fail("signature never exercised", 0, 0, ZM_DS_BIT(r));
+    }
+
+    puts(g_fail ? "FAIL" : "ok");
+    return g_fail ? 2 : 0;
+}
@@ -0,0 +1,204 @@
+// zm_frame_store_check: checks the OriginalHistory ring and PassFeedback
+// pair indices (src/slang_frame_store.cpp)
+//
+// Stands in for slang_d3d9_frame with integer "textures": the history ring
+// and each feedback pair hold the number of the frame written into them,
+// -1 when cleared to black. Every frame the chain is drawn once, twice or
+// not at all, and now and then the game rect resizes, which reallocates the
+// ring and the pairs. Each draw calls sfs_frame_begin, writes this frame's
+// Original into history slot 0 and runs the passes in order: a pass first
+// samples the PassFeedback of every feedback pass, then writes its own
+// output into its pair's write half.
+//
+// Checks, for ring depths 0 to 8 and a few feedback layouts, that
+// OriginalHistoryN always holds the Original of the Nth chain frame before
+// this one (black before the ring had that many), that the ring's slots are
+// all distinct, that PassFeedback holds the pass' output from the previous
+// chain frame, that the indices move on the first draw of a frame and a
+// second draw in the same frame samples what the first one did, and that
+// each live pair flipped exactly once per chain frame. Exits with 2 when a
+// check fails.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -Isrc tools/zm_frame_store_check.cpp src/slang_frame_store.cpp -o zm_frame_store_check
+// Run:
+//   ./zm_frame_store_check [frames]
+
+#include "slang_frame_store.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+
+using namespace ZeroMod;
+
+#define CHECK_MAX_DEPTH 8
+#define CHECK_PASSES 6
+
+static uint32_t seed = 12345;
+static uint32_t rnd()
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+static unsigned g_fail = 0;
+
+static void fail(const char* layout, unsigned depth, uint64_t frame, const char* what)
+{
+    if (g_fail++ < 10)
+        printf("%s, depth %u, frame %llu: %s: FAIL\n", layout, depth, (unsigned long long)frame, what);
+}
+
+struct layout
+{
+    const char* name;
+    bool feedback[CHECK_PASSES];
+};
+
+static const layout layouts[] = {
+    { "no feedback",        { false, false, false, false, false, false } },
+    { "last pass",          { false, false, false, false, false, true } },
+    { "first and middle",   { true, false, false, true, false, false } },
+    { "every pass",         { true, true, true, true, true, true } },
+};
+
+static void run(const layout& L, unsigned depth, unsigned frames)
+{
+    slang_frame_store fs = {};
+    fs.history_depth = depth;
+    const unsigned slots = sfs_history_slots(fs);
+
+    int ring[CHECK_MAX_DEPTH + 1];
+    bool ring_alloc = false;
+    // Originals since the ring was last allocated, newest first
+    std::deque<int> originals;
+
+    int pair[CHECK_PASSES][2];
+    bool pair_alloc[CHECK_PASSES] = {};
+    int last_out[CHECK_PASSES];     // the pass' output in its previous chain frame, -1 = none since allocation
+    int this_out[CHECK_PASSES];
+    for (unsigned i = 0; i < CHECK_PASSES; ++i)
+        last_out[i] = this_out[i] = -1;
+    unsigned flips[CHECK_PASSES] = {};
+    unsigned live_frames[CHECK_PASSES] = {};
+
+    for (uint64_t f = 0; f < frames; ++f) {
+        const uint32_t r = rnd() % 100;
+        const unsigned draws = r < 10 ? 0 : r < 25 ? 2 : 1;
+        const bool resize = rnd() % 100 < 3;
+
+        // PassFeedback the first draw sampled, unless the pair was (re)allocated after
+        int seen[CHECK_PASSES] = {};
+        bool seen_ok[CHECK_PASSES] = {};
+        for (unsigned d = 0; d < draws; ++d) {
+            unsigned read_before[CHECK_PASSES];
+            bool live_before[CHECK_PASSES];
+            for (unsigned i = 0; i < CHECK_PASSES; ++i) {
+                read_before[i] = sfs_fb_read(fs, i);
+                live_before[i] = fs.fb_live[i];
+            }
+
+            const bool moved = sfs_frame_begin(fs, f);
+            if (moved != (d == 0))
+                fail(L.name, depth, f, d ? "second draw moved the indices" : "first draw kept the indices");
+
+            for (unsigned i = 0; i < CHECK_PASSES; ++i) {
+                const bool flipped = sfs_fb_read(fs, i) != read_before[i];
+                if (flipped != (moved && live_before[i]))
+                    fail(L.name, depth, f, "feedback pair flipped out of turn");
+                if (flipped)
+                    flips[i]++;
+                if (moved && live_before[i]) {
+                    live_frames[i]++;
+                    // this frame's write half is what was sampled as last frame's
+                    last_out[i] = this_out[i];
+                }
+            }
+
+            // slang_history_ensure: a new ring starts black
+            if (depth && (!ring_alloc || (resize && d == 0))) {
+                for (unsigned k = 0; k < slots; ++k)
+                    ring[k] = -1;
+                ring_alloc = true;
+                originals.clear();
+                sfs_history_reset(fs);
+            }
+
+            if (depth) {
+                bool distinct = true;
+                for (unsigned a = 0; a < slots; ++a)
+                    for (unsigned b = a + 1; b < slots; ++b)
+                        distinct &= sfs_history_slot(fs, a) != sfs_history_slot(fs, b);
+                if (!distinct)
+                    fail(L.name, depth, f, "history slots overlap");
+
+                ring[sfs_history_slot(fs, 0)] = (int)f;
+                if (d == 0)
+                    originals.push_front((int)f);
+                if (originals.size() > slots)
+                    originals.pop_back();
+
+                for (unsigned k = 0; k < slots; ++k) {
+                    const int want = k < originals.size() ? originals[k] : -1;
+                    if (ring[sfs_history_slot(fs, k)] != want)
+                        fail(L.name, depth, f, "OriginalHistoryN is not the Nth frame back");
+                }
+            }
+
+            for (unsigned i = 0; i < CHECK_PASSES; ++i) {
+                // every pass samples every PassFeedback before its own output
+                for (unsigned j = 0; j < CHECK_PASSES; ++j) {
+                    if (!L.feedback[j] || !pair_alloc[j])
+                        continue;
+                    const int v = pair[j][sfs_fb_read(fs, j)];
+                    if (v != last_out[j])
+                        fail(L.name, depth, f, "PassFeedback is not last frame's output");
+                    if (i == 0) {
+                        if (d == 0) {
+                            seen[j] = v;
+                            seen_ok[j] = true;
+                        }
+                        else if (seen_ok[j] && v != seen[j])
+                            fail(L.name, depth, f, "second draw sampled other feedback");
+                    }
+                }
+
+                if (!L.feedback[i])
+                    continue;
+                // slang_feedback_ensure: a new pair starts black
+                if (!pair_alloc[i] || (resize && d == 0)) {
+                    pair[i][0] = pair[i][1] = -1;
+                    pair_alloc[i] = true;
+                    sfs_fb_reset(fs, i, true);
+                    last_out[i] = -1;
+                    seen_ok[i] = false;
+                }
+                if (sfs_fb_write(fs, i) == sfs_fb_read(fs, i))
+                    fail(L.name, depth, f, "pass renders into the half it samples");
+                pair[i][sfs_fb_write(fs, i)] = (int)f;
+                this_out[i] = (int)f;
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < CHECK_PASSES; ++i)
+        if (flips[i] != live_frames[i])
+            fail(L.name, depth, frames, "flip count differs from chain frames");
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned frames = argc > 1 ? (unsigned)atoi(argv[1]) : 2000;
+
+    for (const layout& L : layouts)
+        for (unsigned depth = 0; depth <= CHECK_MAX_DEPTH; ++depth)
+            run(L, depth, frames);
+
+    printf("%u layouts x %u depths, %u frames each: %s\n",
+        (unsigned)(sizeof(layouts) / sizeof(layouts[0])), CHECK_MAX_DEPTH + 1, frames,
+        g_fail ? "FAIL" : "ok");
+    return g_fail ? 2 : 0;
+}
@@ -0,0 +1,449 @@
+// zm_gpu_prof_test: checks the GPU timestamp profiler's scheduling
+// (src/gpu_prof.cpp) against fake queries that answer late
+//
+// The fake device (tools/fake_d3d9 stands in for the SDK headers) hands
+// out refcounted queries whose GetData says S_FALSE until a frame the
+// test picks: usually a frame or three after they were issued, now and
+// then more than ZM_GPU_PROF_FRAMES later (so the set's slot is still
+// busy when it comes round), with single queries straggling behind the
+// rest of their set. Frames are marked disjoint, report a zero
+// frequency or fail with D3DERR_DEVICELOST. Timestamps come from a fake
+// GPU clock the test advances inside each ZM_GPU_SCOPE, so every pass
+// has a known length; some frames issue more passes than a set holds.
+// Halfway the profiler is switched off for a few frames, later it moves
+// to a second device, and last comes a device without timestamp queries.
+//
+// A model of the pool (a frame is read once every query of it answered;
+// a frame whose slot still waits on an older set goes unprofiled)
+// predicts, after every gp_frame, whether the frame is profiled and the
+// skipped / disjoint / collected counts, the per-label sums, maxima and
+// sample counts, and the header of each published table. Also checks
+// that GetData is never asked to flush, that timestamps are only issued
+// with D3DISSUE_END, and that every query is released after gp_discard
+// and on a device change. Exits with 2 when a check fails.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -Itools/fake_d3d9 -Isrc tools/zm_gpu_prof_test.cpp src/gpu_prof.cpp -o zm_gpu_prof_test
+// Run:
+//   ./zm_gpu_prof_test [frames]
+
+#include "gpu_prof.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace ZeroMod;
+
+static uint32_t seed = 12345;
+static uint32_t rnd()
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+static unsigned g_fail = 0;
+
+static void fail(unsigned frame, const char* what)
+{
+    if (g_fail++ < 10)
+        printf("frame %u: %s: FAIL\n", frame, what);
+}
+
+static const UINT64 k_freq = 25000000;     // 25 MHz
+
+// ---- the fake GPU ----
+// What the test decided for one profiled frame
+struct frame_plan
+{
+    unsigned ready_at;          // gp_frame call from which its queries answer
+    unsigned answered_by;       // ... the last of them, stragglers included
+    bool disjoint;
+    bool zero_freq;
+    bool lost;                  // GetData fails
+};
+
+static unsigned g_now = 0;                  // gp_frame calls so far
+static UINT64 g_ticks = 1000;               // GPU clock
+static std::vector<frame_plan> g_plans;     // by gp_frame call
+static unsigned g_cur = 0;                  // frame whose queries are being issued
+static unsigned g_flushes = 0, g_bad_issues = 0;
+
+struct fake_query : IDirect3DQuery9
+{
+    struct fake_device* dev;
+    D3DQUERYTYPE type;
+    int refs = 1;
+    bool ended = false;
+    unsigned frame = 0;
+    unsigned ready_at = 0;
+    UINT64 stamp = 0;
+
+    fake_query(struct fake_device* d, D3DQUERYTYPE t) : dev(d), type(t) {}
+    uint32_t AddRef() override { return (uint32_t)++refs; }
+    uint32_t Release() override;
+
+    HRESULT Issue(DWORD flags) override
+    {
+        if (type == D3DQUERYTYPE_TIMESTAMP || type == D3DQUERYTYPE_TIMESTAMPFREQ) {
+            if (flags != D3DISSUE_END)
+                g_bad_issues++;
+        }
+        if (!(flags & D3DISSUE_END)) {
+            ended = false;
+            return S_OK;
+        }
+        ended = true;
+        frame = g_cur;
+        stamp = g_ticks;
+        // Now and then a straggler answers later than the rest of its set
+        frame_plan& p = g_plans[frame];
+        ready_at = p.ready_at + (rnd() % 12 == 0 ? 1 + rnd() % 2 : 0);
+        if (ready_at > p.answered_by)
+            p.answered_by = ready_at;
+        return S_OK;
+    }
+
+    HRESULT GetData(void* data, DWORD size, DWORD flags) override
+    {
+        if (flags & D3DGETDATA_FLUSH)
+            g_flushes++;
+        if (!ended)
+            return S_FALSE;
+        const frame_plan& p = g_plans[frame];
+        if (p.lost)
+            return D3DERR_DEVICELOST;
+        if (g_now < ready_at)
+            return S_FALSE;
+
+        switch (type) {
+        case D3DQUERYTYPE_TIMESTAMP:
+            if (size != sizeof(UINT64)) return D3DERR_INVALIDCALL;
+            *(UINT64*)data = stamp;
+            break;
+        case D3DQUERYTYPE_TIMESTAMPDISJOINT:
+            if (size != sizeof(BOOL)) return D3DERR_INVALIDCALL;
+            *(BOOL*)data = p.disjoint ? TRUE : FALSE;
+            break;
+        case D3DQUERYTYPE_TIMESTAMPFREQ:
+            if (size != sizeof(UINT64)) return D3DERR_INVALIDCALL;
+            *(UINT64*)data = p.zero_freq ? 0 : k_freq;
+            break;
+        default:
+            return D3DERR_INVALIDCALL;
+        }
+        return S_OK;
+    }
+};
+
+struct fake_device : IDirect3DDevice9
+{
+    bool timestamps = true;     // false: CreateQuery(TIMESTAMP) fails
+    int live = 0;               // queries not released yet
+    int peak = 0;
+
+    uint32_t AddRef() override { return 1; }
+    uint32_t Release() override { return 1; }
+
+    HRESULT CreateQuery(D3DQUERYTYPE type, IDirect3DQuery9** out) override
+    {
+        if (!out || (type == D3DQUERYTYPE_TIMESTAMP && !timestamps))
+            return D3DERR_NOTAVAILABLE;
+        *out = new fake_query(this, type);
+        if (++live > peak)
+            peak = live;
+        return S_OK;
+    }
+
+    // gp_* never touch state; the rest of the interface is unused
+    HRESULT CreateStateBlock(D3DSTATEBLOCKTYPE, IDirect3DStateBlock9**) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetRenderTarget(DWORD, IDirect3DSurface9*) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetRenderTarget(DWORD, IDirect3DSurface9**) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetDepthStencilSurface(IDirect3DSurface9*) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetDepthStencilSurface(IDirect3DSurface9**) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetViewport(const D3DVIEWPORT9*) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetViewport(D3DVIEWPORT9*) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetRenderState(D3DRENDERSTATETYPE, DWORD) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetRenderState(D3DRENDERSTATETYPE, DWORD*) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetTexture(DWORD, IDirect3DBaseTexture9**) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetTexture(DWORD, IDirect3DBaseTexture9*) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetTextureStageState(DWORD, D3DTEXTURESTAGESTATETYPE, DWORD*) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetTextureStageState(DWORD, D3DTEXTURESTAGESTATETYPE, DWORD) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetSamplerState(DWORD, D3DSAMPLERSTATETYPE, DWORD*) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetSamplerState(DWORD, D3DSAMPLERSTATETYPE, DWORD) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetScissorRect(const RECT*) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetScissorRect(RECT*) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetVertexDeclaration(IDirect3DVertexDeclaration9*) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetVertexDeclaration(IDirect3DVertexDeclaration9**) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetFVF(DWORD) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetFVF(DWORD*) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetVertexShader(IDirect3DVertexShader9*) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetVertexShader(IDirect3DVertexShader9**) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetVertexShaderConstantF(UINT, const float*, UINT) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetVertexShaderConstantF(UINT, float*, UINT) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetStreamSource(UINT, IDirect3DVertexBuffer9*, UINT, UINT) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetStreamSource(UINT, IDirect3DVertexBuffer9**, UINT*, UINT*) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetPixelShader(IDirect3DPixelShader9*) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetPixelShader(IDirect3DPixelShader9**) override { return D3DERR_INVALIDCALL; }
+    HRESULT SetPixelShaderConstantF(UINT, const float*, UINT) override { return D3DERR_INVALIDCALL; }
+    HRESULT GetPixelShaderConstantF(UINT, float*, UINT) override { return D3DERR_INVALIDCALL; }
+};
+
+uint32_t fake_query::Release()
+{
+    if (--refs > 0)
+        return (uint32_t)refs;
+    dev->live--;
+    delete this;
+    return 0;
+}
+
+// ---- the model ----
+struct model_stat
+{
+    double sum = 0, max = 0;
+    unsigned samples = 0;
+};
+
+struct model_frame
+{
+    unsigned call;              // gp_frame call that opened it
+    std::vector<std::pair<std::string, double>> passes;
+};
+
+struct model
+{
+    model_frame slots[ZM_GPU_PROF_FRAMES];
+    bool pending[ZM_GPU_PROF_FRAMES] = {};
+    int cur = -1;               // slot being recorded
+    uint64_t frame = 0;         // gp.frame
+    bool enabled = false;
+    uint64_t skipped = 0, disjoint = 0;
+    unsigned collected = 0;
+    std::map<std::string, model_stat> stats;
+    std::vector<std::string> published;     // expected table headers
+
+    void drop_all()
+    {
+        for (bool& p : pending)
+            p = false;
+        cur = -1;
+    }
+
+    void read(unsigned s)
+    {
+        const model_frame& f = slots[s];
+        const frame_plan& p = g_plans[f.call];
+        if (!p.lost && g_now < p.answered_by)
+            return;
+        pending[s] = false;
+        if (p.lost)
+            return;
+        if (p.disjoint || p.zero_freq) {
+            disjoint++;
+            return;
+        }
+        for (const auto& e : f.passes) {
+            model_stat& st = stats[e.first];
+            st.sum += e.second;
+            if (e.second > st.max)
+                st.max = e.second;
+            st.samples++;
+        }
+        if (++collected >= ZM_GPU_PROF_PUBLISH_INTERVAL) {
+            char b[128];
+            snprintf(b, sizeof(b), "GPU ms (%u frames, %llu skipped, %llu disjoint)",
+                collected, (unsigned long long)skipped, (unsigned long long)disjoint);
+            published.push_back(b);
+            stats.clear();
+            collected = 0;
+        }
+    }
+
+    // gp_frame on a device with timestamp queries
+    void gp_frame(bool on, unsigned call)
+    {
+        if (cur >= 0) {
+            pending[cur] = true;
+            cur = -1;
+        }
+        for (unsigned s = 0; s < ZM_GPU_PROF_FRAMES; ++s)
+            if (pending[s])
+                read(s);
+
+        if (!on) {
+            if (enabled) {
+                drop_all();
+                stats.clear();
+                collected = 0;
+            }
+            enabled = false;
+            return;
+        }
+        enabled = true;
+
+        const unsigned s = (unsigned)(frame++ % ZM_GPU_PROF_FRAMES);
+        if (pending[s]) {
+            skipped++;
+            return;
+        }
+        slots[s].call = call;
+        slots[s].passes.clear();
+        cur = (int)s;
+    }
+};
+
+static void check(const model& m, unsigned frame, std::vector<std::string>& seen)
+{
+    const zm_gpu_prof& gp = g_gpu_prof;
+    if ((gp.cur != nullptr) != (m.cur >= 0))
+        fail(frame, m.cur >= 0 ? "frame should be profiled" : "frame should go unprofiled");
+    if (gp.skipped != m.skipped)
+        fail(frame, "skipped count");
+    if (gp.disjoint != m.disjoint)
+        fail(frame, "disjoint count");
+    if (gp.collected != m.collected)
+        fail(frame, "collected count");
+
+    if (gp.stat_count != m.stats.size())
+        fail(frame, "number of labels");
+    for (unsigned i = 0; i < gp.stat_count; ++i) {
+        const auto it = m.stats.find(gp.stats[i].label);
+        if (it == m.stats.end()) {
+            fail(frame, "unexpected label");
+            continue;
+        }
+        const model_stat& want = it->second;
+        const zm_gpu_stat& got = gp.stats[i];
+        if (got.samples != want.samples ||
+            fabs(got.ms_sum - want.sum) > 1e-9 * (1.0 + want.sum) ||
+            fabs(got.ms_max - want.max) > 1e-12)
+            fail(frame, "per-label sum, max or samples");
+    }
+
+    std::string text;
+    if (gp_overlay_text(g_gpu_prof, text) && !text.empty())
+        seen.push_back(text.substr(0, text.find(')') + 1));
+}
+
+static const char* const k_labels[] = {
+    "pass0", "pass1", "pass2", "crt-geom", "blur_h", "blur_v",
+    "a label longer than the thirty-one chars a set keeps",
+};
+
+// One frame's injected passes, the way the slang runtime scopes them
+static void run_passes(model& m)
+{
+    const unsigned n = rnd() % 50 == 0 ? ZM_GPU_PROF_MAX_PASSES + 6 : 1 + rnd() % 8;
+    for (unsigned i = 0; i < n; ++i) {
+        const char* label = k_labels[rnd() % (sizeof(k_labels) / sizeof(k_labels[0]))];
+        const UINT64 dur = 500 + rnd() % 200000;
+        {
+            ZM_GPU_SCOPE(label);
+            g_ticks += dur;
+        }
+        if (m.cur >= 0 && m.slots[m.cur].passes.size() < ZM_GPU_PROF_MAX_PASSES)
+            m.slots[m.cur].passes.push_back({ std::string(label).substr(0, 31), (double)dur * 1000.0 / (double)k_freq });
+        g_ticks += rnd() % 1000;    // the game's own work in between
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned frames = argc > 1 ? (unsigned)atoi(argv[1]) : 6000;
+
+    static fake_device dev_a, dev_b, dev_none;
+    dev_none.timestamps = false;
+    model m;
+    std::vector<std::string> seen;
+
+    g_plans.reserve(frames + 8);
+    for (unsigned f = 0; f < frames; ++f) {
+        // Halfway: profiler off for a few frames; at 2/3: a new device
+        const bool on = !(f >= frames / 2 && f < frames / 2 + 7);
+        fake_device* dev = f < frames * 2 / 3 ? &dev_a : &dev_b;
+
+        if (f == frames * 2 / 3) {
+            // gp_frame sees the new device first: every set is released
+            m.drop_all();
+        }
+
+        // What this frame's queries will do (read by the fake at Issue/GetData)
+        frame_plan p;
+        const unsigned r = rnd() % 100;
+        const unsigned lag = r < 70 ? 1 + rnd() % 2 : r < 92 ? 3 : ZM_GPU_PROF_FRAMES + 1 + rnd() % 3;
+        p.ready_at = f + 1 + lag;
+        p.answered_by = p.ready_at;
+        p.disjoint = rnd() % 25 == 0;
+        p.zero_freq = rnd() % 150 == 0;
+        p.lost = rnd() % 300 == 0;
+        g_plans.push_back(p);
+
+        g_now = f;
+        // The set closed by this call belongs to the previous frame
+        m.gp_frame(on, f);
+        gp_frame(g_gpu_prof, dev, on, false);
+        g_cur = f;
+        check(m, f, seen);
+
+        if (f == frames * 2 / 3 && dev_a.live != 0)
+            fail(f, "queries of the old device not released");
+
+        run_passes(m);
+    }
+
+    if (seen.size() != m.published.size())
+        fail(frames, "number of published tables");
+    for (size_t i = 0; i < seen.size() && i < m.published.size(); ++i)
+        if (seen[i] != m.published[i])
+            fail(frames, "published table header");
+
+    const int peak = dev_a.peak > dev_b.peak ? dev_a.peak : dev_b.peak;
+    if (peak > ZM_GPU_PROF_FRAMES * (2 + 2 * ZM_GPU_PROF_MAX_PASSES))
+        fail(frames, "more queries than the pool holds");
+    if (g_flushes)
+        fail(frames, "GetData asked to flush");
+    if (g_bad_issues)
+        fail(frames, "timestamp issued with D3DISSUE_BEGIN");
+
+    printf("gpu prof: %u frames, %llu skipped, %llu disjoint, %zu tables published, %d queries at most\n",
+        frames, (unsigned long long)g_gpu_prof.skipped, (unsigned long long)g_gpu_prof.disjoint,
+        seen.size(), peak);
+
+    gp_discard(g_gpu_prof, true);
+    if (dev_b.live != 0)
+        fail(frames, "queries left after gp_discard");
+
+    // A device without timestamp queries: gives up after one frame
+    for (unsigned f = 0; f < 3; ++f) {
+        g_plans.push_back(frame_plan{ frames + f + 2, frames + f + 2, false, false, false });
+        g_now = frames + f;
+        gp_frame(g_gpu_prof, &dev_none, true, false);
+        g_cur = frames + f;
+        ZM_GPU_SCOPE("pass0");
+    }
+    if (!g_gpu_prof.unsupported || g_gpu_prof.enabled || g_gpu_prof.cur)
+        fail(frames, "still profiling without timestamp queries");
+    if (gp_pass_begin(g_gpu_prof, "pass0") != -1)
+        fail(frames, "pass began without timestamp queries");
+    gp_discard(g_gpu_prof, true);
+    if (dev_none.live != 0)
+        fail(frames, "queries left on the device without timestamps");
+
+    // And back to one that has them
+    g_now = frames + 3;
+    g_plans.push_back(frame_plan{ frames + 5, frames + 5, false, false, false });
+    gp_frame(g_gpu_prof, &dev_a, true, false);
+    if (g_gpu_prof.unsupported || !g_gpu_prof.cur)
+        fail(frames, "not profiling again on a device with timestamps");
+    gp_discard(g_gpu_prof, true);
+    if (dev_a.live != 0)
+        fail(frames, "queries left after the last gp_discard");
+
+    puts(g_fail ? "FAIL" : "ok");
+    return g_fail ? 2 : 0;
+}
@@ -0,0 +1,318 @@
+// zm_ini_bench: reload latency and idle cost of the ini watcher
+//
+// Runs the two ways Ini can notice an edit against a copy of an ini in a
+// scratch directory. Polling stats the file every 250 ms and, on a new
+// mtime, re-reads the file once per key the way GetPrivateProfileString
+// does. Watching sleeps in inotify on the directory (the Linux stand-in
+// for ReadDirectoryChangesW), waits out the same settle time as
+// src/ini.cpp, then reads the file once, parses it with src/ini_parse.cpp
+// and applies only the keys that changed. Each mode gets a number of
+// rewrites, each bumping one value, and an idle window. Reports
+// write->applied latency (p50/max), cost per reload and wakeups per
+// minute while nothing changes.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -pthread -Isrc tools/zm_ini_bench.cpp src/ini_parse.cpp -o zm_ini_bench
+// Run:
+//   ./zm_ini_bench [ini file] [rewrites] [idle seconds]
+// The ini defaults to ./filter-mod.ini.
+
+#include "ini_parse.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace ZeroMod;
+
+// Same as INI_POLL_MS / INI_SETTLE_MS in src/ini.cpp
+#define BENCH_POLL_MS 250
+#define BENCH_SETTLE_MS 30
+// Time between rewrites; longer than a poll so every rewrite is seen, plus
+// up to one poll of jitter so the writes don't lock onto the poll phase
+#define BENCH_GAP_MS 400
+
+static uint64_t now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_ms(unsigned ms)
+{
+    timespec ts = { (time_t)(ms / 1000), (long)(ms % 1000) * 1000000l };
+    nanosleep(&ts, nullptr);
+}
+
+static bool read_file(const char* path, std::string& out)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return false;
+    out.clear();
+    char b[4096];
+    size_t n;
+    while ((n = fread(b, 1, sizeof(b), f)) > 0)
+        out.append(b, n);
+    fclose(f);
+    return true;
+}
+
+static bool write_file(const char* path, const std::string& data)
+{
+    FILE* f = fopen(path, "wb");
+    if (!f)
+        return false;
+    const bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+// Section/key pairs as load_ini asks for them
+typedef std::vector<std::pair<std::string, std::string>> key_list;
+
+static key_list keys_of(const zm_ini_table& t)
+{
+    key_list keys;
+    for (const auto& kv : t.keys) {
+        const size_t nl = kv.first.find('\n');
+        keys.emplace_back(kv.first.substr(0, nl), kv.first.substr(nl + 1));
+    }
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+struct bench_state
+{
+    std::string path;
+    std::string dir;
+    std::string name;
+    key_list keys;
+
+    std::atomic<bool> stop{ false };
+    std::atomic<long> applied{ -1 };        // last bench_counter value seen
+    std::atomic<uint64_t> applied_ns{ 0 };
+    std::atomic<uint64_t> wakeups{ 0 };
+    std::atomic<uint64_t> reloads{ 0 };
+    std::atomic<uint64_t> reload_ns{ 0 };
+};
+
+static void apply_counter(bench_state& s, const std::string* v)
+{
+    const long c = v ? strtol(v->c_str(), nullptr, 10) : -1;
+    if (c != s.applied.load(std::memory_order_relaxed)) {
+        s.applied_ns.store(now_ns(), std::memory_order_relaxed);
+        s.applied.store(c, std::memory_order_release);
+    }
+}
+
+// One file read and parse per key, like GetPrivateProfileString
+static void reload_per_key(bench_state& s)
+{
+    const uint64_t t0 = now_ns();
+    std::string data;
+    zm_ini_table t;
+    const std::string* counter = nullptr;
+    std::string counter_value;
+    for (const auto& k : s.keys) {
+        if (!read_file(s.path.c_str(), data))
+            data.clear();
+        ip_parse(t, data.data(), data.size());
+        const std::string* v = ip_find(t, k.first.c_str(), k.second.c_str());
+        if (k.first == "bench" && k.second == "counter" && v) {
+            counter_value = *v;
+            counter = &counter_value;
+        }
+    }
+    s.reload_ns += now_ns() - t0;
+    ++s.reloads;
+    apply_counter(s, counter);
+}
+
+static void poll_thread(bench_state& s)
+{
+    timespec last = {};
+    while (!s.stop.load(std::memory_order_relaxed)) {
+        ++s.wakeups;
+        struct stat st;
+        if (stat(s.path.c_str(), &st) == 0 &&
+            (st.st_mtim.tv_sec != last.tv_sec || st.st_mtim.tv_nsec != last.tv_nsec)) {
+            last = st.st_mtim;
+            reload_per_key(s);
+        }
+        sleep_ms(BENCH_POLL_MS);
+    }
+}
+
+static void watch_thread(bench_state& s, int stop_fd)
+{
+    const int fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (fd < 0 || inotify_add_watch(fd, s.dir.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE) < 0) {
+        perror("inotify");
+        exit(1);
+    }
+
+    zm_ini_table prev, cur;
+    std::string data;
+    alignas(inotify_event) char buf[4096 + sizeof(inotify_event) + NAME_MAX + 1];
+    for (;;) {
+        pollfd fds[2] = { { fd, POLLIN, 0 }, { stop_fd, POLLIN, 0 } };
+        if (poll(fds, 2, -1) <= 0)
+            continue;
+        ++s.wakeups;
+        if (fds[1].revents)
+            break;
+
+        const ssize_t len = read(fd, buf, sizeof(buf));
+        bool hit = len == 0;
+        for (ssize_t off = 0; off < len;) {
+            const inotify_event* e = (const inotify_event*)(buf + off);
+            if ((e->mask & IN_Q_OVERFLOW) || (e->len && s.name == e->name))
+                hit = true;
+            off += sizeof(inotify_event) + e->len;
+        }
+        if (!hit)
+            continue;
+
+        sleep_ms(BENCH_SETTLE_MS);
+        // Anything that arrived while settling is covered by this read
+        while (read(fd, buf, sizeof(buf)) > 0) {
+        }
+
+        const uint64_t t0 = now_ns();
+        if (!read_file(s.path.c_str(), data))
+            data.clear();
+        ip_parse(cur, data.data(), data.size());
+        size_t changed = 0;
+        for (const auto& k : s.keys)
+            changed += ip_changed(prev, cur, k.first.c_str(), k.second.c_str());
+        const std::string* counter = ip_find(cur, "bench", "counter");
+        std::string counter_value = counter ? *counter : std::string();
+        std::swap(prev, cur);
+        s.reload_ns += now_ns() - t0;
+        ++s.reloads;
+        if (changed)
+            apply_counter(s, counter ? &counter_value : nullptr);
+    }
+    close(fd);
+}
+
+static std::string with_counter(const std::string& base, long i)
+{
+    return base + "\n[bench]\ncounter = " + std::to_string(i) + "\n";
+}
+
+static void run(const char* mode, bench_state& s, const std::string& base, int rewrites, int idle_s)
+{
+    s.stop = false;
+    s.applied = -1;
+    s.wakeups = 0;
+    s.reloads = 0;
+    s.reload_ns = 0;
+    write_file(s.path.c_str(), with_counter(base, 0));
+
+    int stop_pipe[2];
+    if (pipe(stop_pipe) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+    const bool watch = strcmp(mode, "watch") == 0;
+    std::thread th = watch ? std::thread(watch_thread, std::ref(s), stop_pipe[0]) : std::thread(poll_thread, std::ref(s));
+
+    // Watching starts from the initial load, like Ini's constructor
+    if (watch)
+        sleep_ms(50);
+    while (s.applied.load(std::memory_order_acquire) != 0) {
+        write_file(s.path.c_str(), with_counter(base, 0));
+        sleep_ms(BENCH_GAP_MS);
+    }
+
+    std::vector<uint64_t> lat;
+    srand(12345);
+    for (int i = 1; i <= rewrites; ++i) {
+        sleep_ms(BENCH_GAP_MS + rand() % BENCH_POLL_MS);
+        const uint64_t t0 = now_ns();
+        write_file(s.path.c_str(), with_counter(base, i));
+        while (s.applied.load(std::memory_order_acquire) != i) {
+            if (now_ns() - t0 > 5000000000ull) {
+                fprintf(stderr, "%s: rewrite %d never applied\n", mode, i);
+                break;
+            }
+            sleep_ms(1);
+        }
+        lat.push_back(s.applied_ns.load(std::memory_order_relaxed) - t0);
+    }
+    const uint64_t reloads = s.reloads.load();
+    const uint64_t reload_ns = s.reload_ns.load();
+
+    const uint64_t w0 = s.wakeups.load();
+    sleep_ms((unsigned)idle_s * 1000);
+    const uint64_t idle_wakeups = s.wakeups.load() - w0;
+
+    s.stop = true;
+    if (write(stop_pipe[1], "x", 1) != 1)
+        perror("write");
+    th.join();
+    close(stop_pipe[0]);
+    close(stop_pipe[1]);
+
+    std::sort(lat.begin(), lat.end());
+    const double p50 = lat.empty() ? 0 : lat[lat.size() / 2] / 1e6;
+    const double mx = lat.empty() ? 0 : lat.back() / 1e6;
+    printf("%-6s latency p50 %7.1f ms  max %7.1f ms  reload %8.1f us  idle wakeups %6.1f/min\n",
+        mode, p50, mx, reloads ? reload_ns / 1e3 / reloads : 0.0, idle_wakeups * 60.0 / idle_s);
+}
+
+int main(int argc, char** argv)
+{
+    const char* src = argc > 1 ? argv[1] : "filter-mod.ini";
+    const int rewrites = argc > 2 ? atoi(argv[2]) : 10;
+    const int idle_s = argc > 3 ? atoi(argv[3]) : 5;
+    if (rewrites < 1 || idle_s < 1) {
+        fprintf(stderr, "usage: zm_ini_bench [ini file] [rewrites] [idle seconds]\n");
+        return 1;
+    }
+
+    std::string base;
+    if (!read_file(src, base)) {
+        perror(src);
+        return 1;
+    }
+
+    char dir[] = "/tmp/zm_ini_bench.XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    bench_state s;
+    s.dir = dir;
+    s.name = "filter-mod.ini";
+    s.path = s.dir + "/" + s.name;
+
+    zm_ini_table t;
+    const std::string first = with_counter(base, 0);
+    ip_parse(t, first.data(), first.size());
+    s.keys = keys_of(t);
+    printf("%s: %zu bytes, %zu keys, %d rewrites, %d s idle\n", src, base.size(), s.keys.size(), rewrites, idle_s);
+
+    run("poll", s, base, rewrites, idle_s);
+    run("watch", s, base, rewrites, idle_s);
+
+    unlink(s.path.c_str());
+    rmdir(dir);
+    return 0;
+}
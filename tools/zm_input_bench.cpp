@@ -0,0 +1,195 @@
+// zm_input_bench: hotkey sampling on the render thread vs an input thread
+//
+// Two parts, both on src/input_edge.cpp. The first replays a synthetic
+// minute of hotkey taps (random lengths and gaps, both combo keys held
+// together) and counts the presses each sampling scheme sees: the old
+// one samples once per frame at the given frame rate, the input thread at
+// the given poll rate. A tap that starts and ends between two samples is
+// lost. The second runs a producer thread feeding in_map_edges at the poll
+// rate and a consumer draining the queue once per "frame", and reports
+// what the drain costs the consumer (p50/p99/max) plus lost or reordered
+// events.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -pthread -Isrc tools/zm_input_bench.cpp src/input_edge.cpp -o zm_input_bench
+// Run:
+//   ./zm_input_bench [frame rate] [poll hz] [seconds]
+
+#include "input_edge.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace ZeroMod;
+
+// Same base as XINPUT_VK_BASE in src/conf.h
+#define BENCH_PAD_BASE 0xE0
+// VK_CONTROL + 'O', the log toggle example in the README
+#define BENCH_KEY_A 0x11
+#define BENCH_KEY_B 0x4F
+
+static uint64_t now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_us(unsigned us)
+{
+    timespec ts = { (time_t)(us / 1000000), (long)(us % 1000000) * 1000l };
+    nanosleep(&ts, nullptr);
+}
+
+struct tap
+{
+    double start_ms;
+    double end_ms;
+};
+
+// Tap lengths 10-120 ms (quick keyboard taps are often 30-60 ms), gaps 150-600 ms
+static std::vector<tap> make_taps(double total_ms)
+{
+    std::vector<tap> taps;
+    srand(12345);
+    double t = 100;
+    while (t < total_ms) {
+        const double len = 10 + rand() % 111;
+        taps.push_back({ t, t + len });
+        t += len + 150 + rand() % 451;
+    }
+    return taps;
+}
+
+static bool held(const std::vector<tap>& taps, size_t& at, double t)
+{
+    while (at < taps.size() && taps[at].end_ms <= t)
+        ++at;
+    return at < taps.size() && taps[at].start_ms <= t;
+}
+
+// Samples the timeline every period_ms through the real edge detector
+static size_t count_presses(const std::vector<tap>& taps, double total_ms, double period_ms)
+{
+    zm_input_map m;
+    in_map_init(m, BENCH_PAD_BASE);
+    const uint8_t keys[2] = { BENCH_KEY_A, BENCH_KEY_B };
+    in_map_add(m, ZM_IN_LOG_TOGGLE, keys, 2);
+
+    zm_input_queue queues[ZM_IN_QUEUE_COUNT];
+    for (zm_input_queue& q : queues)
+        in_queue_init(q);
+
+    size_t presses = 0;
+    size_t at = 0;
+    for (double t = 0; t < total_ms; t += period_ms) {
+        uint8_t down[32] = {};
+        if (held(taps, at, t)) {
+            in_set_key(down, BENCH_KEY_A);
+            in_set_key(down, BENCH_KEY_B);
+        }
+        in_map_edges(m, down, queues);
+        uint8_t ev;
+        while (in_pop(queues[ZM_IN_Q_LOG], ev))
+            ++presses;
+    }
+    return presses;
+}
+
+static void drain_cost(double fps, unsigned poll_hz, int seconds)
+{
+    zm_input_queue queues[ZM_IN_QUEUE_COUNT];
+    for (zm_input_queue& q : queues)
+        in_queue_init(q);
+
+    std::atomic<bool> stop{ false };
+    std::atomic<uint64_t> produced{ 0 };
+    std::thread producer([&] {
+        zm_input_map m;
+        in_map_init(m, BENCH_PAD_BASE);
+        const uint8_t kb[1] = { '1' };
+        const uint8_t pad[1] = { BENCH_PAD_BASE + 2 };
+        in_map_add(m, ZM_IN_FLASH_KILL, kb, 1);
+        in_map_add(m, ZM_IN_SHADER_TOGGLE, pad, 1);
+        uint64_t tick = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            // Alternate the two buttons every few polls: one press each per 8 polls
+            uint8_t down[32] = {};
+            if ((tick & 7) < 2)
+                in_set_key(down, '1');
+            if (((tick + 4) & 7) < 2)
+                in_set_key(down, BENCH_PAD_BASE + 2);
+            produced += in_map_edges(m, down, queues);
+            ++tick;
+            sleep_us(1000000 / poll_hz);
+        }
+    });
+
+    std::vector<uint32_t> empty_lat, busy_lat;
+    uint64_t consumed = 0, out_of_order = 0;
+    uint8_t last = ZM_IN_EVENT_COUNT;
+    const uint64_t end = now_ns() + (uint64_t)seconds * 1000000000ull;
+    while (now_ns() < end) {
+        const uint64_t t0 = now_ns();
+        uint8_t ev;
+        int n = 0;
+        while (in_pop(queues[ZM_IN_Q_RENDER], ev)) {
+            // The producer alternates, so two in a row of one kind means a lost event
+            if (ev == last)
+                ++out_of_order;
+            last = ev;
+            ++n;
+        }
+        const uint64_t t1 = now_ns();
+        (n ? busy_lat : empty_lat).push_back((uint32_t)std::min<uint64_t>(t1 - t0, UINT32_MAX));
+        consumed += n;
+        sleep_us((unsigned)(1000000 / fps));
+    }
+    stop = true;
+    producer.join();
+    uint8_t ev;
+    while (in_pop(queues[ZM_IN_Q_RENDER], ev))
+        ++consumed;
+
+    auto pct = [](std::vector<uint32_t>& v, size_t p) -> uint32_t {
+        if (v.empty())
+            return 0;
+        std::sort(v.begin(), v.end());
+        return v[std::min(v.size() - 1, v.size() * p / 100)];
+    };
+    printf("drain  empty frame p50 %4u ns  p99 %5u ns  |  with events p50 %4u ns  p99 %5u ns  (%zu frames)\n",
+        pct(empty_lat, 50), pct(empty_lat, 99), pct(busy_lat, 50), pct(busy_lat, 99), empty_lat.size() + busy_lat.size());
+    printf("       %llu events produced, %llu consumed, %llu dropped, %llu out of order\n",
+        (unsigned long long)produced.load(), (unsigned long long)consumed,
+        (unsigned long long)queues[ZM_IN_Q_RENDER].dropped.load(), (unsigned long long)out_of_order);
+}
+
+int main(int argc, char** argv)
+{
+    const double fps = argc > 1 ? atof(argv[1]) : 60;
+    const unsigned poll_hz = argc > 2 ? (unsigned)atoi(argv[2]) : 250;
+    const int seconds = argc > 3 ? atoi(argv[3]) : 3;
+    if (fps <= 0 || poll_hz < 1 || seconds < 1) {
+        fprintf(stderr, "usage: zm_input_bench [frame rate] [poll hz] [seconds]\n");
+        return 1;
+    }
+
+    const double total_ms = 60000;
+    const std::vector<tap> taps = make_taps(total_ms);
+    printf("%zu taps in 60 s\n", taps.size());
+    for (double f : { fps, fps / 2 }) {
+        const size_t n = count_presses(taps, total_ms, 1000.0 / f);
+        printf("frame  %5.1f fps  %4zu seen  %4zu lost\n", f, n, taps.size() - n);
+    }
+    const size_t n = count_presses(taps, total_ms, 1000.0 / poll_hz);
+    printf("thread %5u Hz   %4zu seen  %4zu lost\n", poll_hz, n, taps.size() - n);
+
+    drain_cost(fps, poll_hz, seconds);
+    return 0;
+}
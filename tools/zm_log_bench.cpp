@@ -0,0 +1,199 @@
+// zm_log_bench: throughput benchmark for the per-thread log rings
+//
+// Runs the producer/writer pair from src/log_ring.cpp the way Logger uses
+// it: each producer formats a record shaped like a LOG_MFUN line into a
+// stack buffer and pushes it into its own ring, one writer thread drains
+// all rings into large write()s. For comparison the old path is run too:
+// one mutex around a shared std::ostringstream and a write() per record.
+// Reports records/sec, producer latency (p50/p99/max per record) and how
+// many records the drop policy threw away.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -pthread -Isrc tools/zm_log_bench.cpp src/log_ring.cpp -o zm_log_bench
+// Run:
+//   ./zm_log_bench [threads] [records per thread] [output file]
+// Output defaults to /dev/null so the disk isn't what gets measured.
+
+#include "log_ring.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace ZeroMod;
+
+static uint64_t now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int format_record(char* b, size_t cap, unsigned tid, unsigned i)
+{
+    return snprintf(b, cap,
+        "(%u)(%u) MyID3D9Device::SetSamplerState(this = 0x%08x, Sampler = %u, Type = %u, Value = %u)\n",
+        i / 1000, tid, 0x1234560u + tid * 16, i & 15, (i >> 4) & 15, i * 2654435761u);
+}
+
+struct run_result
+{
+    uint64_t records;
+    uint64_t dropped;
+    uint64_t bytes;
+    uint64_t ns;
+    std::vector<uint32_t> lat;      // per record, all producers
+};
+
+static void print_result(const char* name, run_result& r)
+{
+    std::sort(r.lat.begin(), r.lat.end());
+    const size_t n = r.lat.size();
+    const uint32_t p50 = n ? r.lat[n / 2] : 0;
+    const uint32_t p99 = n ? r.lat[(n * 99 + 99) / 100 - 1] : 0;
+    const uint32_t max = n ? r.lat[n - 1] : 0;
+    printf("%-16s %8.2f M rec/s %8.1f MB/s   p50 %6u ns  p99 %6u ns  max %8u ns  dropped %llu\n",
+        name, (double)(r.records - r.dropped) * 1e3 / (double)r.ns,
+        (double)r.bytes * 1e3 / (double)r.ns, p50, p99, max, (unsigned long long)r.dropped);
+}
+
+// ---- per-thread rings + one writer ----
+static run_result run_rings(int policy, unsigned threads, unsigned per_thread, int fd)
+{
+    static zm_log_rings lr;
+    lr_init(lr, policy);
+    std::vector<char> staging(ZM_LOG_WRITE_BYTES);
+    std::atomic<bool> done{ false };
+    uint64_t bytes = 0;
+
+    std::thread writer([&] {
+        for (;;) {
+            const bool last = done.load();
+            bool any = false;
+            size_t n;
+            while ((n = lr_drain(lr, staging.data(), staging.size()))) {
+                bytes += n;
+                any = true;
+                if (write(fd, staging.data(), n) < 0)
+                    break;
+            }
+            if (last)
+                break;
+            if (!any)
+                usleep(500);
+        }
+    });
+
+    std::vector<std::vector<uint32_t>> lat(threads);
+    std::vector<std::thread> prod;
+    const uint64_t t0 = now_ns();
+    for (unsigned t = 0; t < threads; ++t) {
+        prod.emplace_back([&, t] {
+            std::vector<uint32_t>& l = lat[t];
+            l.resize(per_thread);
+            const int slot = lr_attach(lr, 100 + t);
+            char b[512];
+            for (unsigned i = 0; i < per_thread; ++i) {
+                const uint64_t s = now_ns();
+                const int n = format_record(b, sizeof(b), 100 + t, i);
+                lr_write(lr, slot, b, (size_t)n);
+                l[i] = (uint32_t)std::min<uint64_t>(now_ns() - s, UINT32_MAX);
+            }
+        });
+    }
+    for (std::thread& p : prod)
+        p.join();
+    done = true;
+    writer.join();
+    const uint64_t ns = now_ns() - t0;
+
+    run_result r;
+    r.records = (uint64_t)threads * per_thread;
+    r.dropped = lr_dropped(lr);
+    r.bytes = bytes;
+    r.ns = ns;
+    for (std::vector<uint32_t>& l : lat)
+        r.lat.insert(r.lat.end(), l.begin(), l.end());
+    lr_free(lr);
+    return r;
+}
+
+// ---- the old path: shared stream under a lock, one write per record ----
+static run_result run_locked(unsigned threads, unsigned per_thread, int fd)
+{
+    std::mutex cs;
+    std::ostringstream oss;
+    uint64_t bytes = 0;
+
+    std::vector<std::vector<uint32_t>> lat(threads);
+    std::vector<std::thread> prod;
+    const uint64_t t0 = now_ns();
+    for (unsigned t = 0; t < threads; ++t) {
+        prod.emplace_back([&, t] {
+            std::vector<uint32_t>& l = lat[t];
+            l.resize(per_thread);
+            char b[512];
+            for (unsigned i = 0; i < per_thread; ++i) {
+                const uint64_t s = now_ns();
+                format_record(b, sizeof(b), 100 + t, i);
+                {
+                    std::lock_guard<std::mutex> g(cs);
+                    oss << b;
+                    const std::string str = oss.str();
+                    if (write(fd, str.data(), str.size()) > 0)
+                        bytes += str.size();
+                    oss.clear();
+                    oss.str(std::string());
+                }
+                l[i] = (uint32_t)std::min<uint64_t>(now_ns() - s, UINT32_MAX);
+            }
+        });
+    }
+    for (std::thread& p : prod)
+        p.join();
+
+    run_result r;
+    r.records = (uint64_t)threads * per_thread;
+    r.dropped = 0;
+    r.bytes = bytes;
+    r.ns = now_ns() - t0;
+    for (std::vector<uint32_t>& l : lat)
+        r.lat.insert(r.lat.end(), l.begin(), l.end());
+    return r;
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned threads = argc > 1 ? (unsigned)atoi(argv[1]) : 4;
+    const unsigned per_thread = argc > 2 ? (unsigned)atoi(argv[2]) : 500000;
+    const char* out = argc > 3 ? argv[3] : "/dev/null";
+    if (!threads || threads > ZM_LOG_MAX_THREADS || !per_thread) {
+        fprintf(stderr, "usage: %s [threads 1..%u] [records per thread] [output file]\n", argv[0], ZM_LOG_MAX_THREADS);
+        return 2;
+    }
+
+    const int fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "can't open '%s'\n", out);
+        return 1;
+    }
+
+    printf("%u producer threads x %u records -> %s\n", threads, per_thread, out);
+    run_result locked = run_locked(threads, per_thread, fd);
+    print_result("locked stream", locked);
+    run_result drop = run_rings(ZM_LOG_DROP, threads, per_thread, fd);
+    print_result("rings, drop", drop);
+    run_result block = run_rings(ZM_LOG_BLOCK, threads, per_thread, fd);
+    print_result("rings, block", block);
+
+    close(fd);
+    return block.dropped ? 3 : 0;
+}
@@ -0,0 +1,365 @@
+// zm_log_decode: turns a binary ZeroMod log back into text
+//
+// Reads filter-mod.zmlb written with ZM_LOG_BINARY and prints what the
+// text logger would have: "(frame)(thread) Class::Method(arg = value, ...)"
+// per LOG_MFUN call, the text records as they were, and the frame and
+// drop markers. Values are printed the way Logger::log_item prints the
+// same types (decimal, 0x... for NumHexLogger and pointers, NULL,
+// true/false); objects stored raw come out as a byte dump. The LogItem
+// specializations themselves need the D3D9 headers, so they aren't linked
+// in here.
+//
+// --bench compares the two backends on one representative call: the text
+// path formatting into a std::ostringstream like Logger does, and the
+// binary path from src/log_bin.h. It reports ns and bytes per call.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -Isrc tools/zm_log_decode.cpp src/log_bin.cpp -o zm_log_decode
+// Run:
+//   ./zm_log_decode filter-mod.zmlb > filter-mod.log
+//   ./zm_log_decode --bench
+
+#include "log_bin.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+using namespace ZeroMod;
+
+struct decoded_def
+{
+    bool known;
+    std::string name;
+    uint8_t argc;
+    zm_lb_arg_type types[ZM_LB_MAX_ARGS];
+    std::string args[ZM_LB_MAX_ARGS];
+};
+
+static uint64_t read_uint(const uint8_t* p, unsigned size)
+{
+    uint64_t v = 0;
+    memcpy(&v, p, size < 8 ? size : 8);
+    return v;
+}
+
+static int64_t read_int(const uint8_t* p, unsigned size)
+{
+    const uint64_t v = read_uint(p, size);
+    const unsigned shift = 64 - 8 * (size < 8 ? size : 8);
+    return (int64_t)(v << shift) >> shift;
+}
+
+static void print_hex(FILE* out, uint64_t v)
+{
+    // std::showbase prints a plain 0
+    if (v)
+        fprintf(out, "%#llx", (unsigned long long)v);
+    else
+        fputc('0', out);
+}
+
+// Prints one value; returns the bytes it used or 0 when the record is short
+static size_t print_value(FILE* out, zm_lb_arg_type t, const uint8_t* p, const uint8_t* end)
+{
+    const size_t room = (size_t)(end - p);
+    if (t.code == ZM_LB_T_STR) {
+        if (room < 1)
+            return 0;
+        if (p[0] == 0xFF) {
+            fputs("NULL", out);
+            return 1;
+        }
+        if (room < 1u + p[0])
+            return 0;
+        fwrite(p + 1, 1, p[0], out);
+        return 1u + p[0];
+    }
+    if (room < t.size)
+        return 0;
+
+    switch (t.code) {
+    case ZM_LB_T_INT:
+        fprintf(out, "%lld", (long long)read_int(p, t.size));
+        break;
+    case ZM_LB_T_UINT:
+        fprintf(out, "%llu", (unsigned long long)read_uint(p, t.size));
+        break;
+    case ZM_LB_T_HEX:
+        print_hex(out, read_uint(p, t.size));
+        break;
+    case ZM_LB_T_PTR: {
+        const uint64_t v = read_uint(p, t.size);
+        if (v)
+            print_hex(out, v);
+        else
+            fputs("NULL", out);
+        break;
+    }
+    case ZM_LB_T_FLOAT:
+        if (t.size == 4) {
+            float f;
+            memcpy(&f, p, 4);
+            fprintf(out, "%g", f);
+        }
+        else {
+            double d;
+            memcpy(&d, p, 8);
+            fprintf(out, "%g", d);
+        }
+        break;
+    case ZM_LB_T_BOOL:
+        fputs(p[0] ? "true" : "false", out);
+        break;
+    case ZM_LB_T_CHAR:
+        fputc((char)p[0], out);
+        break;
+    case ZM_LB_T_GUID: {
+        uint32_t d1;
+        uint16_t d2, d3;
+        memcpy(&d1, p, 4);
+        memcpy(&d2, p + 4, 2);
+        memcpy(&d3, p + 6, 2);
+        fprintf(out, "%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+            d1, d2, d3, p[8], p[9], p[10], p[11], p[12], p[13], p[14], p[15]);
+        break;
+    }
+    default:
+        fputc('[', out);
+        for (unsigned i = 0; i < t.size; ++i)
+            fprintf(out, "%02x", p[i]);
+        fputc(']', out);
+        break;
+    }
+    return t.size;
+}
+
+static bool read_def(const uint8_t* p, const uint8_t* end, std::vector<decoded_def>& defs)
+{
+    if ((size_t)(end - p) < sizeof(zm_lb_def))
+        return false;
+    zm_lb_def d;
+    memcpy(&d, p, sizeof(d));
+    if (!d.id || d.argc > ZM_LB_MAX_ARGS)
+        return false;
+    if (defs.size() <= d.id)
+        defs.resize(d.id + 1);
+
+    decoded_def& def = defs[d.id];
+    def.known = true;
+    def.argc = d.argc;
+    memcpy(def.types, d.args, sizeof(def.types));
+
+    const char* s = (const char*)p + sizeof(d);
+    const char* e = (const char*)end;
+    for (int i = -1; i < (int)d.argc; ++i) {
+        const size_t n = strnlen(s, e - s);
+        if (s + n >= e)
+            return false;
+        (i < 0 ? def.name : def.args[i]).assign(s, n);
+        s += n + 1;
+    }
+    return true;
+}
+
+static void print_call(FILE* out, const std::vector<decoded_def>& defs, const uint8_t* p, const uint8_t* end)
+{
+    zm_lb_call c;
+    memcpy(&c, p, sizeof(c));
+    fprintf(out, "(%u)(%u) ", c.frame, c.tid);
+    if (c.id >= defs.size() || !defs[c.id].known) {
+        fprintf(out, "<call site %u: no description>\n", c.id);
+        return;
+    }
+
+    const decoded_def& d = defs[c.id];
+    fprintf(out, "%s(", d.name.c_str());
+    p += sizeof(c);
+    for (unsigned i = 0; i < c.argc && i < d.argc; ++i) {
+        if (i)
+            fputs(", ", out);
+        fprintf(out, "%s = ", d.args[i].c_str());
+        const size_t n = print_value(out, d.types[i], p, end);
+        if (!n) {
+            fputs("<cut>", out);
+            break;
+        }
+        p += n;
+    }
+    if (c.argc < d.argc)
+        fputs(", ...", out);
+    fputs(")\n", out);
+}
+
+// Walks the records; defs_only collects call sites, otherwise prints
+static bool walk(const uint8_t* p, const uint8_t* end, std::vector<decoded_def>& defs, bool defs_only, FILE* out)
+{
+    while (p < end) {
+        if ((size_t)(end - p) < 4)
+            return false;
+        uint32_t head;
+        memcpy(&head, p, 4);
+        const uint32_t op = lb_head_op(head);
+        const uint32_t bytes = lb_head_bytes(head);
+        if (bytes < 4 || (bytes & 3) || bytes > (size_t)(end - p))
+            return false;
+        const uint8_t* body = p + 4;
+        const uint8_t* next = p + bytes;
+
+        if (defs_only) {
+            if (op == ZM_LB_OP_DEF && !read_def(body, next, defs))
+                return false;
+            p = next;
+            continue;
+        }
+
+        switch (op) {
+        case ZM_LB_OP_CALL:
+            if (bytes >= 4 + sizeof(zm_lb_call))
+                print_call(out, defs, body, next);
+            break;
+        case ZM_LB_OP_TEXT:
+            if (bytes >= 4 + sizeof(zm_lb_call)) {
+                zm_lb_call c;
+                memcpy(&c, body, sizeof(c));
+                const char* s = (const char*)body + sizeof(c);
+                fprintf(out, "(%u)(%u) %.*s", c.frame, c.tid, (int)strnlen(s, (const char*)next - s), s);
+            }
+            break;
+        case ZM_LB_OP_FRAME:
+            if (bytes >= 4 + sizeof(zm_lb_frame)) {
+                zm_lb_frame f;
+                memcpy(&f, body, sizeof(f));
+                fprintf(out, "---- frame %u ----\n", f.frame);
+            }
+            break;
+        case ZM_LB_OP_DROPPED:
+            if (bytes >= 4 + sizeof(zm_lb_dropped)) {
+                zm_lb_dropped d;
+                memcpy(&d, body, sizeof(d));
+                fprintf(out, "[log] %u records dropped (ring full)\n", d.records);
+            }
+            break;
+        default:
+            break;
+        }
+        p = next;
+    }
+    return true;
+}
+
+// ---- --bench ----
+static uint64_t now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+struct fake_device {};
+
+static int bench()
+{
+    const int n = 2000000;
+    fake_device dev;
+    const fake_device* self = &dev;
+    const unsigned sampler = 3, type = 5;
+    const unsigned long long id = 0xABCDEF0123ull;
+    const float lod = 0.5f;
+    const char* tag = "SetSamplerState";
+
+    // Text: what Logger's log_fun_name_begin / log_item chain produces
+    std::ostringstream oss;
+    size_t text_bytes = 0;
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < n; ++i) {
+        oss.clear();
+        oss.seekp(0);
+        oss << '(' << i / 1000 << ")(" << 4242 << ") " << "MyID3D9Device::" << tag << '(';
+        oss << "this" << " = " << std::hex << std::showbase << (const void*)self;
+        oss.flags(std::ios::fmtflags{});
+        oss << ", " << "Sampler" << " = " << +sampler;
+        oss << ", " << "Type" << " = " << +(type + (i & 7));
+        oss << ", " << "id" << " = " << std::hex << std::showbase << id;
+        oss.flags(std::ios::fmtflags{});
+        oss << ", " << "lod" << " = " << lod << ")\n";
+        text_bytes += (size_t)oss.tellp();
+    }
+    const uint64_t text_ns = now_ns() - t0;
+
+    // Binary: register once, then raw values
+    zm_lb_event ev = {};
+    ev.cls = "MyID3D9Device::";
+    ev.fun = tag;
+    lb_describe(ev, "this", self, "Sampler", sampler, "Type", type, "id", id, "lod", lod);
+    const uint16_t ev_id = lb_register(ev);
+
+    alignas(4) uint8_t b[ZM_LB_MAX_RECORD];
+    size_t bin_bytes = 0;
+    t0 = now_ns();
+    for (int i = 0; i < n; ++i) {
+        const unsigned t = type + (i & 7);
+        bin_bytes += lb_encode_call(b, ev_id, "this", self, "Sampler", sampler, "Type", t, "id", id, "lod", lod);
+        // Keep the encode from being folded away
+        __asm__ __volatile__("" : : "r"(b) : "memory");
+    }
+    const uint64_t bin_ns = now_ns() - t0;
+
+    printf("%-8s %8.1f ns/call %6.1f bytes/call\n", "text", (double)text_ns / n, (double)text_bytes / n);
+    printf("%-8s %8.1f ns/call %6.1f bytes/call\n", "binary", (double)bin_ns / n, (double)bin_bytes / n);
+    printf("binary is %.1fx cheaper and %.1fx smaller\n",
+        (double)text_ns / (double)bin_ns, (double)text_bytes / (double)bin_bytes);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s filter-mod.zmlb | --bench\n", argv[0]);
+        return 2;
+    }
+    if (!strcmp(argv[1], "--bench"))
+        return bench();
+
+    const int fd = open(argv[1], O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(zm_lb_file_header)) {
+        fprintf(stderr, "can't open '%s'\n", argv[1]);
+        return 1;
+    }
+    const size_t size = (size_t)st.st_size;
+    const uint8_t* base = (const uint8_t*)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "mmap failed\n");
+        return 1;
+    }
+
+    zm_lb_file_header hdr;
+    memcpy(&hdr, base, sizeof(hdr));
+    if (hdr.magic != ZM_LB_MAGIC || hdr.version != ZM_LB_VERSION ||
+        hdr.header_bytes < sizeof(hdr) || hdr.header_bytes > size) {
+        fprintf(stderr, "'%s' is not a version %u binary log\n", argv[1], ZM_LB_VERSION);
+        return 1;
+    }
+    const uint8_t* recs = base + hdr.header_bytes;
+    const uint8_t* end = base + size;
+
+    // A log cut off mid-record (game killed) still decodes up to the cut
+    std::vector<decoded_def> defs;
+    const bool whole = walk(recs, end, defs, true, stdout);
+    walk(recs, end, defs, false, stdout);
+    if (!whole)
+        fprintf(stderr, "'%s': stream ends in a partial or malformed record\n", argv[1]);
+
+    munmap((void*)base, size);
+    return whole ? 0 : 3;
+}
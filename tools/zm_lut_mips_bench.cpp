@@ -0,0 +1,143 @@
+// zm_lut_mips_bench: checks and times LUT mip chain generation
+// (src/lut_mips.cpp)
+//
+// Builds full chains for a spread of sizes, odd and one-wide ones
+// included, with every kernel this build has and requires the same bytes
+// as the scalar code, plus a plain per-texel reference for the scalar
+// code itself. Then times the chain of a --size image, which is what
+// loading a mipmapped LUT adds on the decode thread. Exits with 2 when
+// anything is off.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -Isrc tools/zm_lut_mips_bench.cpp src/lut_mips.cpp -o zm_lut_mips_bench
+// Run:
+//   ./zm_lut_mips_bench --size 1024x1024
+// Options:
+//   --size WxH       timed image (default 1024x1024)
+//   --iters N        chains per timing (default 20)
+
+#include "lut_mips.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace ZeroMod;
+
+static uint32_t seed = 12345;
+static uint32_t rnd()
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8 ^ seed << 24;
+}
+
+// Texel by texel, straight from the definition
+static std::vector<uint32_t> reference(const std::vector<uint32_t>& img, uint32_t w, uint32_t h)
+{
+    std::vector<uint32_t> out = img;
+    std::vector<uint32_t> cur = img;
+    while (w > 1 || h > 1) {
+        const uint32_t dw = w > 1 ? w / 2 : 1, dh = h > 1 ? h / 2 : 1;
+        std::vector<uint32_t> next((size_t)dw * dh);
+        for (uint32_t y = 0; y < dh; ++y)
+            for (uint32_t x = 0; x < dw; ++x) {
+                const uint32_t xs[2] = { 2 * x, 2 * x + 1 < w ? 2 * x + 1 : 2 * x };
+                const uint32_t ys[2] = { 2 * y, 2 * y + 1 < h ? 2 * y + 1 : 2 * y };
+                uint32_t v = 0;
+                for (int c = 0; c < 4; ++c) {
+                    uint32_t sum = 2;
+                    for (uint32_t yy : ys)
+                        for (uint32_t xx : xs)
+                            sum += cur[(size_t)yy * w + xx] >> (8 * c) & 0xFF;
+                    v |= (sum >> 2) << (8 * c);
+                }
+                next[(size_t)y * dw + x] = v;
+            }
+        out.insert(out.end(), next.begin(), next.end());
+        cur.swap(next);
+        w = dw;
+        h = dh;
+    }
+    return out;
+}
+
+static bool check()
+{
+    static const uint32_t sizes[][2] = {
+        { 1, 1 }, { 2, 1 }, { 1, 7 }, { 3, 3 }, { 8, 8 }, { 9, 4 }, { 16, 1 },
+        { 17, 33 }, { 64, 16 }, { 255, 3 }, { 256, 256 }, { 1024, 32 }, { 37, 129 },
+    };
+    bool ok = true;
+    for (const auto& s : sizes) {
+        const uint32_t w = s[0], h = s[1];
+        const unsigned levels = lm_level_count(w, h);
+        const size_t total = lm_chain_pixels(w, h, levels);
+
+        std::vector<uint32_t> img((size_t)w * h);
+        for (uint32_t& p : img)
+            p = rnd();
+        const std::vector<uint32_t> ref = reference(img, w, h);
+        if (ref.size() != total) {
+            printf("%ux%u: %zu pixels in the chain, expected %zu: FAIL\n", w, h, total, ref.size());
+            ok = false;
+            continue;
+        }
+
+        for (int isa = ZM_LM_SCALAR; isa <= lm_best_isa(); ++isa) {
+            // A guard pixel past the end catches overruns
+            std::vector<uint32_t> chain(total + 1, 0xDEADBEEF);
+            memcpy(chain.data(), img.data(), img.size() * 4);
+            lm_build_chain(chain.data(), w, h, levels, isa);
+            if (memcmp(chain.data(), ref.data(), total * 4) || chain[total] != 0xDEADBEEF) {
+                printf("%ux%u %s: differs from the reference: FAIL\n", w, h, lm_isa_name(isa));
+                ok = false;
+            }
+        }
+    }
+    printf("chains: %s\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: zm_lut_mips_bench [--size WxH] [--iters N]\n");
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t w = 1024, h = 1024;
+    unsigned iters = 20;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        const bool more = i + 1 < argc;
+        if (a == "--size" && more) {
+            if (sscanf(argv[++i], "%ux%u", &w, &h) != 2 || !w || !h) { usage(); return 1; }
+        }
+        else if (a == "--iters" && more) iters = (unsigned)atoi(argv[++i]);
+        else { usage(); return 1; }
+    }
+    if (!iters) iters = 1;
+
+    printf("best kernel: %s\n", lm_isa_name(lm_best_isa()));
+    const bool ok = check();
+
+    const unsigned levels = lm_level_count(w, h);
+    const size_t total = lm_chain_pixels(w, h, levels);
+    std::vector<uint32_t> chain(total);
+    for (size_t i = 0; i < (size_t)w * h; ++i)
+        chain[i] = rnd();
+
+    printf("%ux%u, %u levels:", w, h, levels);
+    for (int isa = ZM_LM_SCALAR; isa <= lm_best_isa(); ++isa) {
+        const auto t0 = std::chrono::steady_clock::now();
+        for (unsigned n = 0; n < iters; ++n)
+            lm_build_chain(chain.data(), w, h, levels, isa);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() / iters;
+        printf("  %s %.3f ms", lm_isa_name(isa), ms);
+    }
+    printf("\n");
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,169 @@
+// zm_pixconv_bench: checks and times the pixel format conversions
+// (src/pixel_conv.cpp)
+//
+// For every pair of formats, converts a pitched sub-rect at an odd offset
+// and width with every instruction set the CPU has (scalar, SSE2, AVX2)
+// and requires the same bytes as scalar, padding around the block
+// included, then prints GB/s (source plus destination bytes) for each.
+// Before that it checks that every 16-bit value of R5G6B5, X1R5G5B5,
+// A1R5G5B5 and A4R4G4B4 comes back unchanged through A8R8G8B8, and every
+// 8-bit value through A16B16G16R16F. Exits with 2 when anything is off.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -Isrc tools/zm_pixconv_bench.cpp src/pixel_conv.cpp -o zm_pixconv_bench
+// Run:
+//   ./zm_pixconv_bench --size 1024x1024
+// Options:
+//   --size WxH       block size (default 1024x1024)
+//   --iters N        conversions per timing (default 20)
+
+#include "pixel_conv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace ZeroMod;
+
+static const uint32_t formats[] = {
+    ZM_PC_A8R8G8B8, ZM_PC_X8R8G8B8, ZM_PC_R5G6B5, ZM_PC_X1R5G5B5,
+    ZM_PC_A1R5G5B5, ZM_PC_A4R4G4B4, ZM_PC_A16B16G16R16F,
+};
+
+// Offset of the block in each buffer, and spare pixels per row
+static const uint32_t SRC_X = 3, SRC_Y = 1, DST_X = 5, DST_Y = 2, PAD = 11;
+
+static uint32_t seed = 12345;
+static uint32_t rnd()
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+// Random bytes, except halves, which get values in -0.25..1.25 and now and
+// then an Inf or NaN
+static void fill(std::vector<uint8_t>& buf, uint32_t format)
+{
+    if (format != ZM_PC_A16B16G16R16F) {
+        for (uint8_t& b : buf)
+            b = (uint8_t)rnd();
+        return;
+    }
+    static const uint16_t specials[] = { 0x7C00, 0xFC00, 0x7E00, 0x8000 };
+    for (size_t i = 0; i + 1 < buf.size(); i += 2) {
+        // 0x3C00 is 1.0; exponent 12..15 covers 1/8..2 with the sign
+        uint16_t h = (uint16_t)((rnd() % 4 + 12) << 10 | (rnd() & 0x3FF));
+        if (rnd() % 5 == 0) h |= 0x8000;
+        if (rnd() % 7 == 0) h = (uint16_t)(rnd() % 0x3C01);
+        if (rnd() % 97 == 0) h = specials[rnd() % 4];
+        memcpy(&buf[i], &h, 2);
+    }
+}
+
+static bool round_trips()
+{
+    bool ok = true;
+    const zm_pc_rect row16 = { 0, 0, 65536, 1 };
+    const zm_pc_rect row8 = { 0, 0, 256, 1 };
+    std::vector<uint16_t> in(65536), back(65536);
+    std::vector<uint32_t> argb(65536);
+    std::vector<uint16_t> half(256 * 4);
+    for (uint32_t v = 0; v < 65536; ++v)
+        in[v] = (uint16_t)v;
+
+    for (int isa = ZM_PC_SCALAR; isa <= pc_cpu_isa(); ++isa) {
+        for (uint32_t f : { ZM_PC_R5G6B5, ZM_PC_X1R5G5B5, ZM_PC_A1R5G5B5, ZM_PC_A4R4G4B4 }) {
+            pc_convert(argb.data(), 65536 * 4, ZM_PC_A8R8G8B8, 0, 0, in.data(), 65536 * 2, f, row16, isa);
+            pc_convert(back.data(), 65536 * 2, f, 0, 0, argb.data(), 65536 * 4, ZM_PC_A8R8G8B8, row16, isa);
+            // The X bit doesn't survive
+            const uint16_t keep = f == ZM_PC_X1R5G5B5 ? 0x7FFF : 0xFFFF;
+            uint32_t bad = 0;
+            for (uint32_t v = 0; v < 65536; ++v)
+                bad += (back[v] & keep) != (in[v] & keep);
+            if (bad) {
+                printf("%-7s %s -> A8R8G8B8 -> %s: %u value(s) change: FAIL\n",
+                    pc_isa_name(isa), pc_format_name(f), pc_format_name(f), bad);
+                ok = false;
+            }
+        }
+
+        std::vector<uint32_t> grey(256), out(256);
+        for (uint32_t v = 0; v < 256; ++v)
+            grey[v] = v << 24 | v << 16 | (255 - v) << 8 | (v ^ 0x5A);
+        pc_convert(half.data(), 256 * 8, ZM_PC_A16B16G16R16F, 0, 0, grey.data(), 256 * 4, ZM_PC_A8R8G8B8, row8, isa);
+        pc_convert(out.data(), 256 * 4, ZM_PC_A8R8G8B8, 0, 0, half.data(), 256 * 8, ZM_PC_A16B16G16R16F, row8, isa);
+        if (memcmp(grey.data(), out.data(), 256 * 4)) {
+            printf("%-7s A8R8G8B8 -> A16B16G16R16F -> A8R8G8B8 changes values: FAIL\n", pc_isa_name(isa));
+            ok = false;
+        }
+    }
+    printf("round trips: %s\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: zm_pixconv_bench [--size WxH] [--iters N]\n");
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t w = 1024, h = 1024;
+    unsigned iters = 20;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        const bool more = i + 1 < argc;
+        if (a == "--size" && more) {
+            if (sscanf(argv[++i], "%ux%u", &w, &h) != 2 || !w || !h) { usage(); return 1; }
+        }
+        else if (a == "--iters" && more) iters = (unsigned)atoi(argv[++i]);
+        else { usage(); return 1; }
+    }
+    if (!iters) iters = 1;
+
+    const int best = pc_cpu_isa();
+    printf("cpu: %s, %ux%u block\n", pc_isa_name(best), w, h);
+    bool ok = round_trips();
+
+    // Odd offsets and a width that leaves a scalar tail in every kernel
+    const uint32_t bw = w | 1;
+    const zm_pc_rect rect = { SRC_X, SRC_Y, SRC_X + bw, SRC_Y + h };
+    for (uint32_t sf : formats) {
+        const uint32_t sbpp = pc_bytes_per_pixel(sf);
+        const size_t spitch = (size_t)(SRC_X + bw + PAD) * sbpp;
+        std::vector<uint8_t> src(spitch * (SRC_Y + h + 1));
+        fill(src, sf);
+
+        for (uint32_t df : formats) {
+            const uint32_t dbpp = pc_bytes_per_pixel(df);
+            const size_t dpitch = (size_t)(DST_X + bw + PAD) * dbpp;
+            std::vector<uint8_t> ref(dpitch * (DST_Y + h + 1), 0xCD), out;
+            const double gb = (double)bw * h * (sbpp + dbpp) * iters / 1e9;
+
+            printf("%-13s -> %-13s", pc_format_name(sf), pc_format_name(df));
+            for (int isa = ZM_PC_SCALAR; isa <= best; ++isa) {
+                std::vector<uint8_t>& dst = isa == ZM_PC_SCALAR ? ref : out;
+                if (isa != ZM_PC_SCALAR)
+                    out.assign(ref.size(), 0xCD);
+                if (!pc_convert(dst.data(), dpitch, df, DST_X, DST_Y, src.data(), spitch, sf, rect, isa)) {
+                    printf("\n  pc_convert refused the pair: FAIL\n");
+                    ok = false;
+                    break;
+                }
+                const bool same = isa == ZM_PC_SCALAR || out == ref;
+                ok = ok && same;
+
+                const auto t0 = std::chrono::steady_clock::now();
+                for (unsigned n = 0; n < iters; ++n)
+                    pc_convert(dst.data(), dpitch, df, DST_X, DST_Y, src.data(), spitch, sf, rect, isa);
+                const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+                printf("  %s %6.2f GB/s%s", pc_isa_name(isa), s > 0 ? gb / s : 0.0, same ? "" : " (differs from scalar: FAIL)");
+            }
+            printf("\n");
+        }
+    }
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,224 @@
+// zm_preset_cache_bench: times preset loads with and without the parsed
+// preset cache (src/slang_preset_cache.cpp)
+//
+// Walks a directory (the slang-shaders tree, or custom/) for .slangp files
+// and loads each one the way a cold parse reads it: the preset and its
+// #reference chain, then every pass's .slang with its #includes expanded.
+// That is the file I/O config_file and glslang_read_shader_file do on
+// each d3d9_gfx_set_shader; RetroArch's parsing itself isn't reproduced.
+// The result goes into the cache, and --rounds passes then look every
+// preset up again, which is what selecting it once more costs.
+//
+// First, a small tree in a temporary directory checks that touching,
+// resizing or deleting any file a preset depends on (the preset, a
+// #reference, a pass, an #include) makes the lookup miss; exits with 2
+// when one doesn't.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -Isrc tools/zm_preset_cache_bench.cpp src/slang_preset_cache.cpp tools/slang_files.cpp -o zm_preset_cache_bench
+// Run:
+//   ./zm_preset_cache_bench slang-shaders
+// Options:
+//   --rounds N       lookups of every preset (default 20)
+
+#include "slang_preset_cache.h"
+#include "slang_files.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace ZeroMod;
+
+struct parsed
+{
+    std::vector<std::string> sources;
+};
+
+static void parsed_free(void* p)
+{
+    delete (parsed*)p;
+}
+
+// A cold load: read everything, then store it with its files
+static bool load(zm_spc& c, const std::string& preset, size_t* file_count = nullptr)
+{
+    std::map<std::string, std::string> kv;
+    if (!read_preset(preset, kv))
+        return false;
+    const int passes = atoi(kv["shaders"].c_str());
+    if (passes <= 0)
+        return false;
+
+    parsed* p = new parsed();
+    std::vector<std::string> files;
+    spc_add_preset_files(preset.c_str(), files);
+    for (int i = 0; i < passes; ++i) {
+        const std::string src = kv["shader" + std::to_string(i)];
+        std::string text;
+        if (src.empty() || !expand(src, text)) {
+            delete p;
+            return false;
+        }
+        p->sources.push_back(std::move(text));
+        spc_add_source_files(src.c_str(), files);
+    }
+    if (file_count)
+        *file_count = files.size();
+    return spc_store(c, preset.c_str(), files, p, parsed_free);
+}
+
+// Moves the modification time one second on
+static bool touch(const std::string& path)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return false;
+    struct timespec t[2] = { st.st_atim, st.st_mtim };
+    t[1].tv_sec += 1;
+    return utimensat(AT_FDCWD, path.c_str(), t, 0) == 0;
+}
+
+static bool check_invalidation()
+{
+    char tmpl[] = "/tmp/zm_spc_XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        printf("invalidation: can't make a temporary directory: FAIL\n");
+        return false;
+    }
+    const std::string root = tmpl;
+    mkdir((root + "/shaders").c_str(), 0755);
+    mkdir((root + "/shaders/inc").c_str(), 0755);
+    const std::string top = root + "/top.slangp";
+    const std::string files[] = {
+        top,
+        root + "/base.slangp",
+        root + "/shaders/pass.slang",
+        root + "/shaders/inc/common.inc",
+        root + "/shaders/inc/deep.inc",
+    };
+    write_file(files[0], "#reference \"base.slangp\"\nscale_type0 = source\n");
+    write_file(files[1], "shaders = 1\nshader0 = \"shaders/pass.slang\"\n");
+    write_file(files[2], "#version 450\n#include \"inc/common.inc\"\nvoid main() {}\n");
+    write_file(files[3], "#include \"deep.inc\"\nfloat a;\n");
+    write_file(files[4], "float b;\n");
+
+    zm_spc c;
+    size_t count = 0;
+    bool ok = load(c, top, &count) && count == 5 && spc_lookup(c, top.c_str());
+    if (!ok)
+        printf("invalidation: first load (%zu files): FAIL\n", count);
+
+    for (const std::string& f : files) {
+        if (!ok) break;
+        const char* what[2] = { "touched", "resized" };
+        for (int k = 0; k < 2 && ok; ++k) {
+            std::string text;
+            const bool changed = k == 0 ? touch(f) : read_file(f, text) && write_file(f, text + "\n");
+            if (!changed || spc_lookup(c, top.c_str())) {
+                printf("invalidation: %s %s still hits: FAIL\n", f.c_str() + root.size() + 1, what[k]);
+                ok = false;
+            }
+            else if (!load(c, top) || !spc_lookup(c, top.c_str())) {
+                printf("invalidation: reload after %s %s: FAIL\n", f.c_str() + root.size() + 1, what[k]);
+                ok = false;
+            }
+        }
+    }
+    if (ok) {
+        unlink(files[4].c_str());
+        if (spc_lookup(c, top.c_str()) || load(c, top)) {
+            printf("invalidation: deleted include still loads: FAIL\n");
+            ok = false;
+        }
+    }
+    spc_clear(c);
+
+    for (int i = 4; i >= 0; --i)
+        unlink(files[i].c_str());
+    rmdir((root + "/shaders/inc").c_str());
+    rmdir((root + "/shaders").c_str());
+    rmdir(root.c_str());
+    printf("invalidation: %s\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: zm_preset_cache_bench [--rounds N] DIR\n");
+}
+
+int main(int argc, char** argv)
+{
+    std::string dir;
+    unsigned rounds = 20;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        if (a == "--rounds" && i + 1 < argc) rounds = (unsigned)std::max(1, atoi(argv[++i]));
+        else if (!a.empty() && a[0] == '-') { usage(); return 1; }
+        else if (dir.empty()) dir = a;
+        else { usage(); return 1; }
+    }
+    if (dir.empty()) {
+        usage();
+        return 1;
+    }
+
+    if (!check_invalidation())
+        return 2;
+
+    std::vector<std::string> presets;
+    find_presets(dir, presets);
+    std::sort(presets.begin(), presets.end());
+    if (presets.empty()) {
+        fprintf(stderr, "no .slangp under %s\n", dir.c_str());
+        return 1;
+    }
+
+    zm_spc c;
+    c.max_entries = presets.size();
+
+    // Cold: read and expand everything, stamp the files
+    size_t loaded = 0, files = 0, most = 0;
+    std::vector<std::string> ok_presets;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (const std::string& p : presets) {
+        size_t n = 0;
+        if (load(c, p, &n)) {
+            ++loaded;
+            files += n;
+            most = std::max(most, n);
+            ok_presets.push_back(p);
+        }
+    }
+    const double cold = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    // Warm: every lookup has to hit
+    const uint64_t stats0 = c.stats, hits0 = c.hits;
+    const auto t1 = std::chrono::steady_clock::now();
+    for (unsigned r = 0; r < rounds; ++r)
+        for (const std::string& p : ok_presets)
+            spc_lookup(c, p.c_str());
+    const double warm = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t1).count() / rounds;
+    const uint64_t lookups = (uint64_t)rounds * ok_presets.size();
+    const bool all_hit = c.hits - hits0 == lookups;
+
+    printf("%zu preset(s), %zu loaded (the rest have a missing file or no passes)\n", presets.size(), loaded);
+    printf("files per preset: %.1f on average, %zu at most\n", loaded ? (double)files / loaded : 0.0, most);
+    printf("cold load: %.3f ms for all, %.1f us per preset\n", cold, loaded ? cold * 1000.0 / loaded : 0.0);
+    printf("cached:    %.3f ms for all, %.1f us per preset, %.1f stat calls each%s\n",
+        warm, loaded ? warm * 1000.0 / loaded : 0.0, lookups ? (double)(c.stats - stats0) / lookups : 0.0,
+        all_hit ? "" : " (some lookups missed: FAIL)");
+    if (warm > 0)
+        printf("speedup:   %.1fx\n", cold / warm);
+    spc_clear(c);
+    return all_hit ? 0 : 2;
+}
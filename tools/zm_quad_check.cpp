@@ -0,0 +1,320 @@
+// zm_quad_check: checks the static-quad blit (src/quad_draw.cpp)
+//
+// First the geometry: for a spread of viewport sizes and UV rectangles
+// (full, a GBA-style crop, a centered overscan) it runs the baked vertices
+// through the blit VS transform quad_blit_xform produces and requires the
+// quad to cover the viewport from pixel edge to pixel edge shifted by half
+// a pixel (D3D9 puts pixel centers on integer coordinates), with the UV
+// rectangle's corners on the matching corners and every pixel center
+// sampling at u0 + (x + 0.5) / w * (u1 - u0).
+//
+// Then quad_blit on a recording fake device (tools/fake_d3d9 stands in for
+// the SDK headers) inside a zm_state_delta scope over game state: exactly
+// one DrawPrimitive(TRIANGLESTRIP, ZM_QUAD_FULL, 2) per blit, drawn with
+// the quad's buffer, stride, declaration and VS and the c0/c1 transform,
+// no other device call besides the state saves, and after sd_end the game's
+// stream, declaration, VS and constants back with every reference dropped.
+// A zero viewport or an empty quad must fail without drawing. Exits with 2
+// when a check fails.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -Itools/fake_d3d9 -Isrc tools/zm_quad_check.cpp src/quad_draw.cpp src/state_delta.cpp -o zm_quad_check
+// Run:
+//   ./zm_quad_check
+
+#include "quad.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace ZeroMod;
+
+static unsigned g_fail = 0;
+
+static void fail(const char* where, const char* what)
+{
+    if (g_fail++ < 10)
+        printf("%s: %s: FAIL\n", where, what);
+}
+
+static bool near(float a, float b, float eps)
+{
+    return fabsf(a - b) <= eps;
+}
+
+// ---- geometry ----
+struct uv_rect
+{
+    const char* name;
+    float u0, v0, u1, v1;
+};
+
+static void check_geometry()
+{
+    static const UINT sizes[][2] = {
+        { 1, 1 }, { 2, 2 }, { 240, 160 }, { 256, 192 }, { 640, 480 }, { 1280, 960 }, { 1919, 1079 },
+    };
+    static const uv_rect rects[] = {
+        { "full", 0.0f, 0.0f, 1.0f, 1.0f },
+        { "crop", 8.0f / 256.0f, 16.0f / 192.0f, 248.0f / 256.0f, 176.0f / 192.0f },
+        { "overscan", 0.05f, 0.05f, 0.95f, 0.95f },
+    };
+
+    unsigned cases = 0;
+    for (const UINT* sz : sizes) {
+        const UINT w = sz[0], h = sz[1];
+        for (const uv_rect& r : rects) {
+            char where[64];
+            snprintf(where, sizeof(where), "%ux%u %s", w, h, r.name);
+            cases++;
+
+            float pos[4], uv[4];
+            quad_blit_xform(w, h, r.u0, r.v0, r.u1, r.v1, pos, uv);
+
+            // Pixel-space positions and UVs of the four baked corners
+            float sx[ZM_QUAD_VERTS], sy[ZM_QUAD_VERTS], tu[ZM_QUAD_VERTS], tv[ZM_QUAD_VERTS];
+            for (unsigned i = 0; i < ZM_QUAD_VERTS; ++i) {
+                const zm_slang_vertex& v = g_quad_vertices[i];
+                const float cx = v.x * pos[0] + pos[2];
+                const float cy = v.y * pos[1] + pos[3];
+                sx[i] = (cx + 1.0f) * 0.5f * (float)w;
+                sy[i] = (1.0f - cy) * 0.5f * (float)h;
+                tu[i] = v.u * uv[0] + uv[2];
+                tv[i] = v.v * uv[1] + uv[3];
+
+                const bool right = v.u > 0.5f, bottom = v.v > 0.5f;
+                if (!near(sx[i], right ? (float)w - 0.5f : -0.5f, 1e-3f) ||
+                    !near(sy[i], bottom ? (float)h - 0.5f : -0.5f, 1e-3f))
+                    fail(where, "corner is not half a pixel off the viewport edge");
+                if (!near(tu[i], right ? r.u1 : r.u0, 1e-6f) ||
+                    !near(tv[i], bottom ? r.v1 : r.v0, 1e-6f))
+                    fail(where, "corner UV is not the rectangle's");
+            }
+
+            // TL to TR along the top edge: pixel centers sample texel centers
+            const float du = (tu[2] - tu[0]) / (sx[2] - sx[0]);
+            for (UINT x = 0; x < w; x += (w > 8 ? w / 8 : 1)) {
+                const float u = tu[0] + ((float)x - sx[0]) * du;
+                const float want = r.u0 + ((float)x + 0.5f) / (float)w * (r.u1 - r.u0);
+                if (!near(u, want, 1e-5f))
+                    fail(where, "pixel center samples off the texel center");
+            }
+        }
+    }
+    printf("geometry: %u viewport/rect cases\n", cases);
+}
+
+// ---- recording device ----
+template <class I>
+struct fake_obj : I
+{
+    int refs = 1;
+
+    ULONG AddRef() override { return (ULONG)++refs; }
+    ULONG Release() override { return (ULONG)--refs; }    // owned by the check, never freed
+};
+
+template <class I>
+static void ref_set(I*& slot, I* v)
+{
+    if (v) v->AddRef();
+    if (slot) slot->Release();
+    slot = v;
+}
+
+template <class I>
+static I* ref_get(I* v)
+{
+    if (v) v->AddRef();
+    return v;
+}
+
+struct draw_rec
+{
+    D3DPRIMITIVETYPE type;
+    UINT start, count;
+    IDirect3DVertexBuffer9* vb;
+    UINT offset, stride;
+    IDirect3DVertexDeclaration9* decl;
+    IDirect3DVertexShader9* vs;
+    float c[2][4];
+};
+
+struct rec_device : IDirect3DDevice9
+{
+    IDirect3DVertexBuffer9* vb = nullptr;
+    UINT vb_offset = 0, vb_stride = 0;
+    IDirect3DVertexDeclaration9* decl = nullptr;
+    DWORD fvf = 0;
+    IDirect3DVertexShader9* vs = nullptr;
+    float vsc[ZM_SD_MAX_VS_CONSTS][4] = {};
+
+    draw_rec draws[8];
+    unsigned num_draws = 0;
+    unsigned other = 0;         // calls quad_blit has no business making
+
+    ULONG AddRef() override { return 1; }
+    ULONG Release() override { return 1; }
+
+    HRESULT GetRenderState(D3DRENDERSTATETYPE, DWORD* v) override { *v = 0; return S_OK; }  // state_delta's probe
+    HRESULT SetStreamSource(UINT n, IDirect3DVertexBuffer9* b, UINT off, UINT stride) override
+    {
+        if (n) { other++; return D3DERR_INVALIDCALL; }
+        ref_set(vb, b);
+        vb_offset = off;
+        vb_stride = stride;
+        return S_OK;
+    }
+    HRESULT GetStreamSource(UINT n, IDirect3DVertexBuffer9** b, UINT* off, UINT* stride) override
+    {
+        if (n) { other++; return D3DERR_INVALIDCALL; }
+        *b = ref_get(vb);
+        *off = vb_offset;
+        *stride = vb_stride;
+        return S_OK;
+    }
+    HRESULT SetVertexDeclaration(IDirect3DVertexDeclaration9* d) override { ref_set(decl, d); if (d) fvf = 0; return S_OK; }
+    HRESULT GetVertexDeclaration(IDirect3DVertexDeclaration9** d) override { *d = ref_get(decl); return S_OK; }
+    HRESULT SetFVF(DWORD f) override { fvf = f; if (f) ref_set(decl, (IDirect3DVertexDeclaration9*)nullptr); return S_OK; }
+    HRESULT GetFVF(DWORD* f) override { *f = fvf; return S_OK; }
+    HRESULT SetVertexShader(IDirect3DVertexShader9* s) override { ref_set(vs, s); return S_OK; }
+    HRESULT GetVertexShader(IDirect3DVertexShader9** s) override { *s = ref_get(vs); return S_OK; }
+    HRESULT SetVertexShaderConstantF(UINT first, const float* p, UINT n) override
+    {
+        if (first + n > ZM_SD_MAX_VS_CONSTS) return D3DERR_INVALIDCALL;
+        memcpy(vsc[first], p, n * sizeof(vsc[0]));
+        return S_OK;
+    }
+    HRESULT GetVertexShaderConstantF(UINT first, float* p, UINT n) override
+    {
+        if (first + n > ZM_SD_MAX_VS_CONSTS) return D3DERR_INVALIDCALL;
+        memcpy(p, vsc[first], n * sizeof(vsc[0]));
+        return S_OK;
+    }
+    HRESULT DrawPrimitive(D3DPRIMITIVETYPE type, UINT start, UINT count) override
+    {
+        if (num_draws < 8) {
+            draw_rec& d = draws[num_draws];
+            d.type = type;
+            d.start = start;
+            d.count = count;
+            d.vb = vb;
+            d.offset = vb_offset;
+            d.stride = vb_stride;
+            d.decl = decl;
+            d.vs = vs;
+            memcpy(d.c, vsc[0], sizeof(d.c));
+        }
+        num_draws++;
+        return S_OK;
+    }
+
+    // quad_blit touches nothing else
+    HRESULT CreateStateBlock(D3DSTATEBLOCKTYPE, IDirect3DStateBlock9**) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT CreateQuery(D3DQUERYTYPE, IDirect3DQuery9**) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT SetRenderTarget(DWORD, IDirect3DSurface9*) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT GetRenderTarget(DWORD, IDirect3DSurface9**) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT SetDepthStencilSurface(IDirect3DSurface9*) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT GetDepthStencilSurface(IDirect3DSurface9**) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT SetViewport(const D3DVIEWPORT9*) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT GetViewport(D3DVIEWPORT9*) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT SetRenderState(D3DRENDERSTATETYPE, DWORD) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT GetTexture(DWORD, IDirect3DBaseTexture9**) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT SetTexture(DWORD, IDirect3DBaseTexture9*) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT GetTextureStageState(DWORD, D3DTEXTURESTAGESTATETYPE, DWORD*) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT SetTextureStageState(DWORD, D3DTEXTURESTAGESTATETYPE, DWORD) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT GetSamplerState(DWORD, D3DSAMPLERSTATETYPE, DWORD*) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT SetSamplerState(DWORD, D3DSAMPLERSTATETYPE, DWORD) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT SetScissorRect(const RECT*) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT GetScissorRect(RECT*) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT SetPixelShader(IDirect3DPixelShader9*) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT GetPixelShader(IDirect3DPixelShader9**) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT SetPixelShaderConstantF(UINT, const float*, UINT) override { other++; return D3DERR_INVALIDCALL; }
+    HRESULT GetPixelShaderConstantF(UINT, float*, UINT) override { other++; return D3DERR_INVALIDCALL; }
+};
+
+static void check_draw(const char* where, const draw_rec& d, const zm_quad& q, UINT w, UINT h, const uv_rect& r)
+{
+    if (d.type != D3DPT_TRIANGLESTRIP || d.start != ZM_QUAD_FULL || d.count != 2)
+        fail(where, "not DrawPrimitive(TRIANGLESTRIP, ZM_QUAD_FULL, 2)");
+    if (d.vb != q.vb || d.offset != 0 || d.stride != sizeof(zm_slang_vertex))
+        fail(where, "drawn from another stream 0");
+    if (d.decl != q.decl || d.vs != q.vs)
+        fail(where, "drawn with another declaration or VS");
+
+    float pos[4], uv[4];
+    quad_blit_xform(w, h, r.u0, r.v0, r.u1, r.v1, pos, uv);
+    if (memcmp(d.c[0], pos, sizeof(pos)) || memcmp(d.c[1], uv, sizeof(uv)))
+        fail(where, "c0/c1 are not the blit transform");
+}
+
+static void check_device()
+{
+    fake_obj<IDirect3DVertexBuffer9> quad_vb, game_vb;
+    fake_obj<IDirect3DVertexDeclaration9> quad_decl, game_decl;
+    fake_obj<IDirect3DVertexShader9> quad_vs, game_vs;
+    zm_quad q = { &quad_vb, &quad_decl, &quad_vs };
+
+    rec_device dev;
+    dev.SetStreamSource(0, &game_vb, 16, 32);
+    dev.SetVertexDeclaration(&game_decl);
+    dev.SetVertexShader(&game_vs);
+    float game_c[4][4];
+    for (int i = 0; i < 16; ++i)
+        game_c[i / 4][i % 4] = (float)(i + 1) * 0.25f;
+    dev.SetVertexShaderConstantF(0, game_c[0], 4);
+
+    static const uv_rect full = { "full", 0.0f, 0.0f, 1.0f, 1.0f };
+    static const uv_rect crop = { "crop", 8.0f / 256.0f, 16.0f / 192.0f, 248.0f / 256.0f, 176.0f / 192.0f };
+
+    zm_state_delta sd = {};
+    sd_begin(sd, &dev);
+    if (FAILED(quad_blit(sd, q, 240, 160, crop.u0, crop.v0, crop.u1, crop.v1)))
+        fail("blit", "quad_blit failed");
+    if (FAILED(quad_blit(sd, q, 1280, 960, full.u0, full.v0, full.u1, full.v1)))
+        fail("blit", "quad_blit failed");
+
+    // Nothing to draw with: must fail before touching the device
+    const unsigned draws = dev.num_draws;
+    if (SUCCEEDED(quad_blit(sd, q, 0, 960, 0.0f, 0.0f, 1.0f, 1.0f)))
+        fail("zero viewport", "quad_blit succeeded");
+    zm_quad empty = {};
+    if (SUCCEEDED(quad_blit(sd, empty, 1280, 960, 0.0f, 0.0f, 1.0f, 1.0f)))
+        fail("empty quad", "quad_blit succeeded");
+    if (dev.num_draws != draws)
+        fail("failed blits", "drew anyway");
+    sd_end(sd);
+
+    if (dev.num_draws != 2)
+        fail("blit", "not one draw per blit");
+    else {
+        check_draw("crop blit", dev.draws[0], q, 240, 160, crop);
+        check_draw("full blit", dev.draws[1], q, 1280, 960, full);
+    }
+    if (dev.other)
+        fail("blit", "device calls outside the quad's state");
+
+    if (dev.vb != &game_vb || dev.vb_offset != 16 || dev.vb_stride != 32)
+        fail("sd_end", "game stream 0 not restored");
+    if (dev.decl != &game_decl || dev.vs != &game_vs)
+        fail("sd_end", "game declaration or VS not restored");
+    if (memcmp(dev.vsc[0], game_c, sizeof(game_c)))
+        fail("sd_end", "game VS constants not restored");
+
+    // Left: the device's references to the game's objects
+    if (quad_vb.refs != 1 || quad_decl.refs != 1 || quad_vs.refs != 1 ||
+        game_vb.refs != 2 || game_decl.refs != 2 || game_vs.refs != 2)
+        fail("sd_end", "references left over");
+
+    printf("device: %u blits, %u save and %u restore calls\n", dev.num_draws, sd.save_calls, sd.restore_calls);
+}
+
+int main()
+{
+    check_geometry();
+    check_device();
+    printf("%s\n", g_fail ? "FAIL" : "ok");
+    return g_fail ? 2 : 0;
+}
@@ -0,0 +1,336 @@
+// zm_replay: offline benchmark for ZeroMod call-stream captures
+//
+// Maps a .zmcr file written with [capture] enabled=true and drives the
+// proxy's portable decision logic over it with no device behind it: the
+// binding mirror (RT0 / stage 0 / viewport), the strip-quad key, the draw
+// signature matcher from src/draw_sig.cpp and the redundant state filter
+// from src/state_filter.cpp. Reports calls/sec over the whole stream, the
+// cost per opcode, heap allocations made while replaying, and whether the
+// recomputed keys and matches agree with the capture.
+//
+// The capture doesn't record the proxy's own direct writes, which make the
+// in-game filter forget entries, so the replayed filter may drop calls the
+// capture forwarded. The other way round is a filter bug: a call the proxy
+// dropped must have been redundant by the game's own stream as well.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -Itools/fake_d3d9 -Isrc tools/zm_replay.cpp src/draw_sig.cpp src/state_filter.cpp -o zm_replay
+// Run:
+//   ./zm_replay zeromod_1234.zmcr [passes]
+
+#include "call_rec_format.h"
+#include "draw_sig.h"
+#include "state_filter.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <new>
+
+using namespace ZeroMod;
+
+// ---- allocation counting ----
+static uint64_t g_allocs = 0;
+
+void* operator new(size_t n)
+{
+    g_allocs++;
+    if (void* p = malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// ---- replay state (what the proxy keeps per device) ----
+struct replay_state
+{
+    zm_draw_matcher dm;
+    zm_draw_bind_state bs;
+    bool binds_valid;
+    zm_state_filter sf;
+
+    uint64_t frames;
+    uint64_t draws;
+    uint64_t quads;
+    uint64_t key_mismatch;      // recomputed binding bits != captured
+    uint64_t sig_mismatch;      // matcher result != captured
+    uint64_t filtered;          // state calls the proxy's filter dropped
+    uint64_t sf_filtered;       // state calls the replayed filter drops
+    uint64_t sf_missed;         // dropped in the capture, forwarded by the replay
+    uint64_t tex_filtered;      // SetTexture calls the replayed filter drops
+    uint64_t unsynced;          // quads seen before any binding was known
+};
+
+typedef void (*op_fn)(replay_state& s, const uint32_t* p);
+
+static void op_nop(replay_state&, const uint32_t*) {}
+
+static void op_frame(replay_state& s, const uint32_t* p)
+{
+    const zm_cr_frame* r = (const zm_cr_frame*)p;
+    s.bs.bb_w = r->bb_w;
+    s.bs.bb_h = r->bb_h;
+    s.frames++;
+    sf_frame_end(s.sf);
+}
+
+static void op_set_rt(replay_state& s, const uint32_t* p)
+{
+    const zm_cr_set_rt* r = (const zm_cr_set_rt*)p;
+    if (r->index != 0)
+        return;
+    // SetRenderTarget(0) also resets the viewport to the full target
+    s.bs.rt0 = r->id != 0;
+    s.bs.rt0_w = r->w;
+    s.bs.rt0_h = r->h;
+    s.bs.vp_x = 0;
+    s.bs.vp_y = 0;
+    s.bs.vp_w = r->w;
+    s.bs.vp_h = r->h;
+}
+
+static void op_set_tex(replay_state& s, const uint32_t* p)
+{
+    const zm_cr_set_tex* r = (const zm_cr_set_tex*)p;
+    // IDs stand in for the pointers; the capture doesn't say what was dropped
+    if (!sf_texture(s.sf, r->stage, (IDirect3DBaseTexture9*)(uintptr_t)r->id))
+        s.tex_filtered++;
+    if (r->stage != 0)
+        return;
+    s.bs.tex0_2d = r->is_2d != 0;
+    s.bs.tex0_w = r->is_2d ? r->w : 0;
+    s.bs.tex0_h = r->is_2d ? r->h : 0;
+}
+
+static void op_set_vp(replay_state& s, const uint32_t* p)
+{
+    const zm_cr_viewport* r = (const zm_cr_viewport*)p;
+    s.bs.vp_x = r->x;
+    s.bs.vp_y = r->y;
+    s.bs.vp_w = r->w;
+    s.bs.vp_h = r->h;
+}
+
+static void state_check(replay_state& s, const zm_cr_state* r, bool forward)
+{
+    if (!r->forwarded)
+        s.filtered++;
+    if (!forward)
+        s.sf_filtered++;
+    else if (!r->forwarded)
+        s.sf_missed++;
+}
+
+static void op_rs(replay_state& s, const uint32_t* p)
+{
+    const zm_cr_state* r = (const zm_cr_state*)p;
+    state_check(s, r, sf_rs(s.sf, (D3DRENDERSTATETYPE)r->b, r->value));
+}
+
+static void op_samp(replay_state& s, const uint32_t* p)
+{
+    const zm_cr_state* r = (const zm_cr_state*)p;
+    state_check(s, r, sf_sampler(s.sf, r->a, (D3DSAMPLERSTATETYPE)r->b, r->value));
+}
+
+static void op_tss(replay_state& s, const uint32_t* p)
+{
+    const zm_cr_state* r = (const zm_cr_state*)p;
+    state_check(s, r, sf_tss(s.sf, r->a, (D3DTEXTURESTAGESTATETYPE)r->b, r->value));
+}
+
+static void op_binds(replay_state& s, const uint32_t* p)
+{
+    const zm_cr_binds* r = (const zm_cr_binds*)p;
+    s.bs.rt0 = r->rt0_id != 0;
+    s.bs.rt0_w = r->rt0_w;
+    s.bs.rt0_h = r->rt0_h;
+    s.bs.tex0_2d = r->tex0_2d != 0;
+    s.bs.tex0_w = r->tex0_w;
+    s.bs.tex0_h = r->tex0_h;
+    s.bs.vp_x = r->vp.x;
+    s.bs.vp_y = r->vp.y;
+    s.bs.vp_w = r->vp.w;
+    s.bs.vp_h = r->vp.h;
+    s.binds_valid = true;
+}
+
+static void op_reset(replay_state& s, const uint32_t*)
+{
+    // The proxy re-reads everything; a BINDS record follows before the next quad
+    s.binds_valid = false;
+    sf_invalidate(s.sf);
+}
+
+static void op_draw(replay_state& s, const uint32_t* p)
+{
+    const zm_cr_draw* r = (const zm_cr_draw*)p;
+    s.draws++;
+    if (!(r->key & ZM_DK_STRIP_QUAD))
+        return;
+
+    s.quads++;
+    if (!s.binds_valid) {
+        s.unsynced++;
+        return;
+    }
+
+    // Binding bits from the mirror, chain/latch bits as the proxy had them
+    const uint32_t key = ds_bind_key(s.bs) | (r->key & ~(uint32_t)ZM_DK_BIND_MASK);
+    if (key != r->key)
+        s.key_mismatch++;
+    if (ds_match_count(s.dm, key) != r->sig)
+        s.sig_mismatch++;
+}
+
+static const char* const k_op_names[ZM_CR_OP_COUNT] = {
+    "nop", "frame", "create_tex", "set_rt", "set_tex", "set_vp", "set_rs",
+    "set_samp", "set_tss", "draw", "clear", "binds", "shader", "reset",
+};
+
+static const op_fn k_ops[ZM_CR_OP_COUNT] = {
+    op_nop, op_frame, op_nop, op_set_rt, op_set_tex, op_set_vp, op_rs,
+    op_samp, op_tss, op_draw, op_nop, op_binds, op_nop, op_reset,
+};
+
+struct op_stats
+{
+    uint64_t calls;
+    uint64_t ns;
+};
+
+static void replay_reset(replay_state& s)
+{
+    memset(&s, 0, sizeof(s));
+    ds_compile(s.dm, k_draw_sigs, ZM_DS_COUNT);
+}
+
+// One pass over the records; returns false on a malformed stream
+static bool replay_pass(replay_state& s, const uint8_t* p, const uint8_t* end, op_stats* stats)
+{
+    while (p < end) {
+        if ((size_t)(end - p) < 4)
+            return false;
+        const uint32_t head = *(const uint32_t*)p;
+        const uint32_t op = cr_head_op(head);
+        const uint32_t bytes = cr_head_bytes(head);
+        if (bytes < 4 || (bytes & 3) || bytes > (size_t)(end - p) || op >= ZM_CR_OP_COUNT)
+            return false;
+
+        if (stats) {
+            const uint64_t t0 = ds_now_ns();
+            k_ops[op](s, (const uint32_t*)(p + 4));
+            stats[op].ns += ds_now_ns() - t0;
+            stats[op].calls++;
+        }
+        else {
+            k_ops[op](s, (const uint32_t*)(p + 4));
+        }
+        p += bytes;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s capture.zmcr [passes]\n", argv[0]);
+        return 2;
+    }
+    const int passes = argc > 2 ? atoi(argv[2]) : 20;
+
+    const int fd = open(argv[1], O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(zm_cr_file_header)) {
+        fprintf(stderr, "can't open '%s'\n", argv[1]);
+        return 1;
+    }
+    const size_t size = (size_t)st.st_size;
+    const uint8_t* base = (const uint8_t*)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "mmap failed\n");
+        return 1;
+    }
+    madvise((void*)base, size, MADV_SEQUENTIAL);
+
+    const zm_cr_file_header* hdr = (const zm_cr_file_header*)base;
+    if (hdr->magic != ZM_CR_MAGIC || hdr->version != ZM_CR_VERSION ||
+        hdr->header_bytes < sizeof(*hdr) || hdr->header_bytes > size) {
+        fprintf(stderr, "'%s' is not a version %u capture\n", argv[1], ZM_CR_VERSION);
+        return 1;
+    }
+    const uint8_t* recs = base + hdr->header_bytes;
+    const uint8_t* end = base + size;
+
+    // Timed pass: per-opcode cost (includes the clock reads)
+    static replay_state s;
+    op_stats stats[ZM_CR_OP_COUNT] = {};
+    replay_reset(s);
+    if (!replay_pass(s, recs, end, stats)) {
+        fprintf(stderr, "malformed record stream\n");
+        return 1;
+    }
+    const replay_state first = s;
+
+    uint64_t records = 0;
+    for (uint32_t i = 0; i < ZM_CR_OP_COUNT; ++i)
+        records += stats[i].calls;
+
+    // Clock overhead, subtracted from the per-opcode figures
+    uint64_t clock_ns = 0;
+    {
+        const int n = 100000;
+        const uint64_t t0 = ds_now_ns();
+        for (int i = 0; i < n; ++i)
+            (void)ds_now_ns();
+        clock_ns = (ds_now_ns() - t0) / n;
+    }
+
+    // Untimed passes: throughput and allocations
+    const uint64_t allocs_before = g_allocs;
+    const uint64_t t0 = ds_now_ns();
+    for (int i = 0; i < passes; ++i) {
+        replay_reset(s);
+        replay_pass(s, recs, end, nullptr);
+    }
+    const uint64_t elapsed = ds_now_ns() - t0;
+    const uint64_t allocs = g_allocs - allocs_before;
+
+    printf("%s: %zu KB, %llu records, %llu frames%s\n", argv[1], size >> 10,
+        (unsigned long long)records, (unsigned long long)first.frames,
+        (hdr->flags & ZM_CR_FILE_CONTENTS) ? ", with shader bytecode" : "");
+    if (passes > 0 && elapsed)
+        printf("replay: %.1f M calls/s over %d passes (%.1f ns/call), %llu allocations\n",
+            (double)records * passes * 1e3 / (double)elapsed, passes,
+            (double)elapsed / ((double)records * passes), (unsigned long long)allocs);
+
+    printf("%-12s %12s %10s\n", "opcode", "calls", "ns/call");
+    for (uint32_t i = 0; i < ZM_CR_OP_COUNT; ++i) {
+        if (!stats[i].calls)
+            continue;
+        const double ns = (double)stats[i].ns / (double)stats[i].calls - (double)clock_ns;
+        printf("%-12s %12llu %10.1f\n", k_op_names[i], (unsigned long long)stats[i].calls, ns > 0 ? ns : 0.0);
+    }
+
+    printf("draws %llu (strip quads %llu, %llu before bindings were known), state calls filtered %llu\n",
+        (unsigned long long)first.draws, (unsigned long long)first.quads,
+        (unsigned long long)first.unsynced, (unsigned long long)first.filtered);
+    printf("replayed filter: %llu state calls and %llu textures dropped, %llu dropped only in the capture\n",
+        (unsigned long long)first.sf_filtered, (unsigned long long)first.tex_filtered,
+        (unsigned long long)first.sf_missed);
+    printf("key mismatches %llu, signature mismatches %llu\n",
+        (unsigned long long)first.key_mismatch, (unsigned long long)first.sig_mismatch);
+
+    char b[2048];
+    ds_format_stats(first.dm, b, sizeof(b));
+    fputs(b, stdout);
+
+    munmap((void*)base, size);
+    return (first.key_mismatch || first.sig_mismatch || first.sf_missed) ? 3 : 0;
+}
@@ -0,0 +1,441 @@
+// zm_rtpool_report: VRAM the slang render-target pool needs per preset,
+// with and without aliasing, against a fake allocator
+//
+// For every .slangp given (or found under a directory, custom/ by
+// default) it reads the passes' scale, format and alias settings, finds
+// the samplers each pass' fragment stage declares and turns them into
+// binding tables (src/slang_bind_table.cpp), then runs frames the way
+// slang_d3d9.cpp draws the chain: each intermediate output is acquired
+// from the pool (src/slang_rt_slots.cpp, the bookkeeping the d3d9 pool
+// uses) and given back once its last reader has drawn. CreateTexture and
+// Release are a fake allocator that tracks live and peak bytes. Feedback
+// passes keep their own textures and the last pass draws to the
+// backbuffer, as in the runtime, so neither is counted.
+//
+// The viewport changes at a third of the run, so a resize's surfaces have
+// to be reused or evicted. Prints, per preset, what one texture per pass
+// would cost and the allocator's peak with aliasing and without it
+// (ZM_SLANG_RT_ALIASING 0). Checks that no pass' output is handed to
+// another pass before its last reader drew, that the pool's byte count
+// matches the allocator, that aliasing never needs more than not
+// aliasing, and that the surfaces left at the end are the ones the last
+// frame used. A built-in chain of same-size passes, where aliasing has to
+// save surfaces, is reported last. Exits with 2 when a check fails.
+// Presets whose passes aren't on disk are skipped.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -Isrc tools/zm_rtpool_report.cpp src/slang_rt_slots.cpp src/slang_bind_table.cpp src/slang_pass_meta.cpp tools/slang_files.cpp -o zm_rtpool_report
+// Run:
+//   ./zm_rtpool_report custom
+// Options:
+//   --input WxH      game frame size (default 240x160)
+//   --viewport WxH   game rect before the resize (default 1440x960)
+//   --resize WxH     game rect after it (default 1920x1280)
+//   --frames N       frames per run (default 400)
+
+#include "slang_rt_slots.h"
+#include "slang_bind_table.h"
+#include "slang_pass_meta.h"
+#include "slang_files.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace ZeroMod;
+
+// D3DFMT_A8R8G8B8 / D3DFMT_A16B16G16R16F
+enum : uint32_t { FMT_RGBA8 = 21, FMT_RGBA16F = 113 };
+
+static bool parse_size(const char* s, unsigned& w, unsigned& h)
+{
+    return sscanf(s, "%ux%u", &w, &h) == 2 && w && h;
+}
+
+enum { SCALE_SOURCE, SCALE_VIEWPORT, SCALE_ABSOLUTE };
+
+struct pass
+{
+    std::string path, alias;
+    int type_x = SCALE_SOURCE, type_y = SCALE_SOURCE;
+    float scale_x = 1.0f, scale_y = 1.0f;
+    unsigned abs_x = 0, abs_y = 0;
+    bool fp = false;
+    bool feedback = false;
+    std::vector<std::string> samplers;
+    slang_pass_bindings bind;
+};
+
+struct preset
+{
+    std::string path;
+    std::vector<pass> passes;
+};
+
+static std::string value_of(const std::map<std::string, std::string>& kv, const std::string& key, const std::string& def = "")
+{
+    auto it = kv.find(key);
+    return it == kv.end() ? def : it->second;
+}
+
+static int scale_type(const std::string& s)
+{
+    if (s == "viewport") return SCALE_VIEWPORT;
+    if (s == "absolute") return SCALE_ABSOLUTE;
+    return SCALE_SOURCE;
+}
+
+// The fragment stage's sampler2D names, in declaration order
+static void fragment_samplers(const std::string& expanded, std::vector<std::string>& out)
+{
+    bool fragment = false;
+    for (const std::string& l : lines_of(expanded)) {
+        const std::string t = trim(l);
+        if (t.compare(0, 14, "#pragma stage ") == 0) {
+            fragment = t.find("fragment") != std::string::npos;
+            continue;
+        }
+        const size_t at = t.find("uniform sampler2D ");
+        if (!fragment || at == std::string::npos)
+            continue;
+        std::string name = trim(t.substr(at + 18));
+        const size_t end = name.find_first_of(" ;[");
+        if (end != std::string::npos)
+            name = name.substr(0, end);
+        if (!name.empty() && std::find(out.begin(), out.end(), name) == out.end())
+            out.push_back(name);
+    }
+}
+
+// slang_sampler_resolve_pass, over the preset's aliases
+static uint8_t resolve_pass(const preset& p, const char* name, uint8_t kind)
+{
+    const unsigned N = (unsigned)p.passes.size();
+    unsigned n = 0;
+    if (slang_name_index(name, kind == ZM_SAMP_ALIAS ? "PassOutput" : "PassFeedback", n))
+        return (n < N && n < 0xFF) ? (uint8_t)n : 0xFF;
+
+    std::string base = name;
+    if (kind == ZM_SAMP_FEEDBACK)
+        base.resize(base.size() - (sizeof("Feedback") - 1));
+    for (unsigned j = 0; j < N && j < 0xFF; ++j)
+        if (!p.passes[j].alias.empty() && p.passes[j].alias == base)
+            return (uint8_t)j;
+    return 0xFF;
+}
+
+// Binding tables from the samplers, then the aliases and feedback
+// targets resolved against the whole preset
+static void build_tables(preset& p)
+{
+    for (pass& s : p.passes) {
+        std::vector<slang_refl_const> refl(s.samplers.size());
+        for (size_t k = 0; k < s.samplers.size(); ++k) {
+            refl[k] = slang_refl_const{};
+            refl[k].name = s.samplers[k].c_str();
+            refl[k].cls = ZM_RC_SAMPLER;
+            refl[k].reg = (uint16_t)k;
+            refl[k].regs = 1;
+        }
+        slang_bind_table_build(nullptr, 0, nullptr, 0, refl.data(), (unsigned)refl.size(), s.bind);
+    }
+    for (pass& s : p.passes) {
+        for (uint32_t k = 0; k < s.bind.num_samplers; ++k) {
+            slang_sampler_bind& sb = s.bind.samplers[k];
+            if (sb.kind != ZM_SAMP_ALIAS && sb.kind != ZM_SAMP_FEEDBACK)
+                continue;
+            sb.pass = resolve_pass(p, sb.name, sb.kind);
+            if (sb.kind == ZM_SAMP_FEEDBACK && sb.pass != 0xFF)
+                p.passes[sb.pass].feedback = true;
+        }
+    }
+}
+
+static bool load_preset(const std::string& path, preset& p)
+{
+    std::map<std::string, std::string> kv;
+    if (!read_preset(path, kv) || !kv.count("shaders"))
+        return false;
+    p.path = path;
+    p.passes.resize((size_t)atoi(kv["shaders"].c_str()));
+    if (p.passes.empty())
+        return false;
+
+    for (size_t i = 0; i < p.passes.size(); ++i) {
+        pass& s = p.passes[i];
+        const std::string n = std::to_string(i);
+        s.path = value_of(kv, "shader" + n);
+        std::string src;
+        zm_spm meta;
+        if (s.path.empty() || !expand(s.path, src) || !spm_parse(src.data(), src.size(), meta))
+            return false;
+
+        // The preset's alias wins over #pragma name, as in slang_process
+        s.alias = value_of(kv, "alias" + n);
+        if (s.alias.empty())
+            s.alias = meta.name;
+
+        const std::string both = value_of(kv, "scale_type" + n, "source");
+        s.type_x = scale_type(value_of(kv, "scale_type_x" + n, both));
+        s.type_y = scale_type(value_of(kv, "scale_type_y" + n, both));
+        const std::string scale = value_of(kv, "scale" + n, "1.0");
+        const std::string sx = value_of(kv, "scale_x" + n, scale);
+        const std::string sy = value_of(kv, "scale_y" + n, scale);
+        s.scale_x = (float)atof(sx.c_str());
+        s.scale_y = (float)atof(sy.c_str());
+        s.abs_x = (unsigned)atoi(sx.c_str());
+        s.abs_y = (unsigned)atoi(sy.c_str());
+        s.fp = value_of(kv, "float_framebuffer" + n) == "true";
+
+        fragment_samplers(src, s.samplers);
+    }
+
+    build_tables(p);
+    return true;
+}
+
+// Six same-size RGBA8 passes, the first one also read by the fifth: what
+// exact-size buckets can alias. Without aliasing every intermediate keeps
+// its own surface; with it the middle passes ping-pong between two.
+static void synthetic_preset(preset& p)
+{
+    p.path = "(synthetic, 6 passes)";
+    p.passes.resize(6);
+    for (size_t i = 0; i < p.passes.size(); ++i) {
+        pass& s = p.passes[i];
+        s.scale_x = s.scale_y = i == 0 ? 2.0f : 1.0f;
+        s.samplers.push_back("Source");
+    }
+    p.passes[0].alias = "first";
+    p.passes[4].samplers.push_back("first");
+    build_tables(p);
+}
+
+// CreateTexture / Release
+struct fake_allocator
+{
+    size_t live = 0, peak = 0;
+    unsigned creates = 0, releases = 0;
+
+    void create(size_t bytes)
+    {
+        live += bytes;
+        creates++;
+        peak = std::max(peak, live);
+    }
+    void release(size_t bytes)
+    {
+        live -= bytes;
+        releases++;
+    }
+};
+
+struct run_stats
+{
+    size_t dedicated = 0;       // one texture per pooled output, largest frame
+    size_t in_use_peak = 0;     // most held at once in a frame
+    size_t alloc_peak = 0;
+    size_t end_bytes = 0, last_frame_bytes = 0;
+    unsigned creates = 0, surfaces = 0;
+    unsigned errors = 0;
+};
+
+static void report_error(run_stats& r, const char* what, unsigned frame, unsigned pass)
+{
+    if (r.errors++ < 5)
+        printf("  frame %u pass %u: %s: FAIL\n", frame, pass, what);
+}
+
+static unsigned scaled(int type, float scale, unsigned abs, unsigned src, unsigned vp)
+{
+    if (type == SCALE_ABSOLUTE)
+        return abs ? abs : 1;
+    const unsigned base = type == SCALE_VIEWPORT ? vp : src;
+    const unsigned v = (unsigned)(base * (scale > 0 ? scale : 1.0f) + 0.5f);
+    return v ? v : 1;
+}
+
+static run_stats run(const preset& p, bool aliasing, unsigned in_w, unsigned in_h,
+    unsigned vp_w, unsigned vp_h, unsigned rs_w, unsigned rs_h, unsigned frames)
+{
+    const unsigned N = (unsigned)p.passes.size();
+    std::vector<const slang_pass_bindings*> binds(N);
+    for (unsigned k = 0; k < N; ++k)
+        binds[k] = &p.passes[k].bind;
+    std::vector<unsigned> last(N);
+    rts_last_readers(binds.data(), N, aliasing, last.data());
+
+    slang_rt_slots book{};
+    fake_allocator alloc;
+    run_stats r;
+    std::vector<int> slot_of(N, -1);
+    int owner[ZM_SLANG_RT_POOL_MAX];
+    for (int& o : owner) o = -1;
+
+    for (unsigned f = 0; f < frames; ++f) {
+        const bool resized = f >= frames / 3;
+        const unsigned vw = resized ? rs_w : vp_w, vh = resized ? rs_h : vp_h;
+
+        rts_frame_begin(book);
+        size_t dedicated = 0, frame_bytes = 0;
+        std::vector<bool> held(N, false);
+        unsigned src_w = in_w, src_h = in_h;
+
+        for (unsigned i = 0; i < N; ++i) {
+            const pass& s = p.passes[i];
+
+            // Every output this pass reads is still the one its writer drew
+            auto check_read = [&](unsigned j) {
+                if (j < i && held[j] && owner[slot_of[j]] != (int)j)
+                    report_error(r, "input overwritten before its last reader", f, i);
+            };
+            if (i > 0) check_read(i - 1);
+            for (uint32_t k = 0; k < s.bind.num_samplers; ++k)
+                if (s.bind.samplers[k].kind == ZM_SAMP_ALIAS && s.bind.samplers[k].pass != 0xFF)
+                    check_read(s.bind.samplers[k].pass);
+
+            unsigned out_w = scaled(s.type_x, s.scale_x, s.abs_x, src_w, vw);
+            unsigned out_h = scaled(s.type_y, s.scale_y, s.abs_y, src_h, vh);
+            if (i == N - 1) { out_w = vw; out_h = vh; }
+
+            if (i + 1 < N && !s.feedback) {
+                const uint32_t fmt = s.fp ? FMT_RGBA16F : FMT_RGBA8;
+                const size_t bytes = (size_t)out_w * out_h * (s.fp ? 8 : 4);
+                int slot = rts_reuse(book, out_w, out_h, fmt, slot_of[i]);
+                if (slot < 0) {
+                    slot = rts_victim(book);
+                    if (slot < 0) {
+                        report_error(r, "pool full", f, i);
+                        continue;
+                    }
+                    if (book.e[slot].held)
+                        alloc.release(book.e[slot].bytes);
+                    rts_drop(book, slot);
+                    alloc.create(bytes);
+                    rts_fill(book, slot, out_w, out_h, fmt, bytes);
+                }
+                slot_of[i] = slot;
+                owner[slot] = (int)i;
+                held[i] = true;
+                dedicated += bytes;
+                frame_bytes += bytes;
+            }
+
+            // Outputs nobody reads after this pass go back to the pool
+            for (unsigned j = 0; j + 1 < N && j <= i; ++j)
+                if (last[j] == i && held[j])
+                    rts_release(book, slot_of[j]);
+
+            src_w = out_w;
+            src_h = out_h;
+        }
+
+        for (int i = 0; i < ZM_SLANG_RT_POOL_MAX; ++i) {
+            if (rts_expired(book, i)) {
+                alloc.release(book.e[i].bytes);
+                rts_drop(book, i);
+            }
+        }
+        rts_frame_end(book);
+
+        if (book.bytes != alloc.live)
+            report_error(r, "pool bytes differ from the allocator", f, N);
+        r.dedicated = std::max(r.dedicated, dedicated);
+        r.in_use_peak = std::max(r.in_use_peak, book.frame_peak_in_use);
+        r.last_frame_bytes = frame_bytes;
+    }
+
+    // What's left is what the last frame drew into; with aliasing that can
+    // be fewer surfaces than passes, so only the count of bytes is an upper
+    // bound
+    r.end_bytes = book.bytes;
+    if (frames / 3 + ZM_SLANG_RT_POOL_IDLE_FRAMES + 1 < frames && r.end_bytes > r.last_frame_bytes)
+        report_error(r, "surfaces of the old size were never evicted", frames, N);
+    r.alloc_peak = alloc.peak;
+    r.creates = alloc.creates;
+    r.surfaces = book.count;
+    return r;
+}
+
+static double mb(size_t bytes)
+{
+    return (double)bytes / (1024.0 * 1024.0);
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: zm_rtpool_report [--input WxH] [--viewport WxH] [--resize WxH] [--frames N] [preset.slangp | dir]...\n");
+}
+
+int main(int argc, char** argv)
+{
+    unsigned in_w = 240, in_h = 160, vp_w = 1440, vp_h = 960, rs_w = 1920, rs_h = 1280, frames = 400;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        const bool more = i + 1 < argc;
+        if (a == "--input" && more) { if (!parse_size(argv[++i], in_w, in_h)) { usage(); return 1; } }
+        else if (a == "--viewport" && more) { if (!parse_size(argv[++i], vp_w, vp_h)) { usage(); return 1; } }
+        else if (a == "--resize" && more) { if (!parse_size(argv[++i], rs_w, rs_h)) { usage(); return 1; } }
+        else if (a == "--frames" && more) frames = (unsigned)atoi(argv[++i]);
+        else if (a.compare(0, 2, "--") == 0) { usage(); return 1; }
+        else args.push_back(a);
+    }
+    if (args.empty())
+        args.push_back("custom");
+    if (frames < 3)
+        frames = 3;
+
+    std::vector<std::string> paths;
+    for (const std::string& a : args) {
+        struct stat st;
+        if (stat(a.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+            find_presets(a, paths);
+        else
+            paths.push_back(a);
+    }
+    std::sort(paths.begin(), paths.end());
+
+    printf("input %ux%u, game rect %ux%u then %ux%u, %u frames\n", in_w, in_h, vp_w, vp_h, rs_w, rs_h, frames);
+    printf("%-36s %6s %13s %13s %13s %9s\n", "preset", "passes", "dedicated MB", "no-alias MB", "aliased MB", "surfaces");
+
+    bool ok = true;
+    unsigned reported = 0;
+    paths.push_back("");
+    for (const std::string& path : paths) {
+        preset p;
+        if (path.empty())
+            synthetic_preset(p);
+        else if (!load_preset(path, p)) {
+            printf("%-36s skipped (a pass isn't on disk)\n", path.c_str());
+            continue;
+        }
+        const run_stats off = run(p, false, in_w, in_h, vp_w, vp_h, rs_w, rs_h, frames);
+        const run_stats on = run(p, true, in_w, in_h, vp_w, vp_h, rs_w, rs_h, frames);
+        printf("%-36s %6zu %13.2f %13.2f %13.2f %4u/%-4u\n", p.path.c_str(), p.passes.size(),
+            mb(on.dedicated), mb(off.alloc_peak), mb(on.alloc_peak), on.surfaces, off.surfaces);
+        printf("%-36s %6s %13s %13.2f %13.2f   in use at once\n", "", "", "", mb(off.in_use_peak), mb(on.in_use_peak));
+        reported++;
+
+        if (off.errors || on.errors)
+            ok = false;
+        if (on.alloc_peak > off.alloc_peak || on.in_use_peak > off.in_use_peak) {
+            printf("  aliasing needs more than not aliasing: FAIL\n");
+            ok = false;
+        }
+        if (path.empty() && (on.surfaces != 3 || off.surfaces != 5)) {
+            printf("  expected 3 surfaces aliased and 5 without: FAIL\n");
+            ok = false;
+        }
+    }
+    if (reported < 2) {
+        fprintf(stderr, "no preset could be read\n");
+        return 1;
+    }
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,341 @@
+// zm_slang_cache_bench: times cold and warm slang preset loads through
+// src/slang_d3d9_cache.cpp's pass cache format
+//
+// For every .slangp given (or found under a directory, custom/ by
+// default) it reads the preset, include-expands each pass and keys it
+// with scf_pass_key (src/slang_cache_format.cpp), the bytes and hash
+// slang_cache_pass_key uses: the expanded source, the pass' own #pragma
+// parameters, the pass index and count, every pass alias (the preset's,
+// else #pragma name) and LUT id, the shader model 3.0 profiles and the
+// DLL's compile flags. A cold load then runs the glslang / SPIRV-Cross
+// half of slang_process on each pass, as external glslangValidator and
+// spirv-cross, and writes a .zmsc entry under the key in --cache; --rounds
+// warm loads of the same presets only expand, key, read the entry and
+// check its header and payload hash. D3DXCompileShader, the Windows half
+// a real cold load also pays, isn't run: the entries carry the SPIR-V
+// where the bytecode goes and no uniform table.
+//
+// Keying the passes in reverse order has to give the same keys, and every
+// warm load has to hit on every pass and read back the HLSL the cold load
+// produced; exits with 2 when not. Without the compilers on PATH nothing
+// is timed: the keying is still checked and the run ends with a SKIP line.
+// Presets whose passes aren't on disk are skipped.
+//
+// Build (Linux, with the smhasher submodule checked out):
+//   g++ -O2 -std=c++17 -Isrc tools/zm_slang_cache_bench.cpp src/slang_cache_format.cpp src/slang_pass_meta.cpp tools/slang_files.cpp smhasher/MurmurHash3.cpp -o zm_slang_cache_bench
+// Run:
+//   ./zm_slang_cache_bench custom
+// Options:
+//   --rounds N       warm loads of every preset (default 5)
+//   --cache DIR      cache directory (default: a new temporary one)
+//   --glslang CMD    glslangValidator to run (default glslangValidator)
+//   --spirv-cross CMD  spirv-cross to run (default spirv-cross)
+
+#include "slang_cache_format.h"
+#include "slang_pass_meta.h"
+#include "slang_files.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace ZeroMod;
+
+// src/slang_d3d9.cpp's profiles and ZM_SLANG_COMPILE_FLAGS
+// (D3DXSHADER_OPTIMIZATION_LEVEL3)
+static const char* const VS_PROFILE = "vs_3_0";
+static const char* const PS_PROFILE = "ps_3_0";
+static const uint32_t COMPILE_FLAGS = 1u << 15;
+
+struct pass
+{
+    std::string path, alias;
+    std::string expanded;
+    uint64_t key[2] = {};
+    std::string hlsl[2];        // what the cold load stored
+};
+
+struct preset
+{
+    std::string path;
+    std::vector<pass> passes;
+    std::vector<std::string> luts;
+};
+
+// Aliases as prepare_passes has registered them by the time a pass is
+// keyed: the preset's, else the pass' #pragma name
+static bool load_preset(const std::string& path, preset& p)
+{
+    std::map<std::string, std::string> kv;
+    if (!read_preset(path, kv) || !kv.count("shaders"))
+        return false;
+    p.path = path;
+    p.passes.resize((size_t)atoi(kv["shaders"].c_str()));
+    for (size_t i = 0; i < p.passes.size(); ++i) {
+        const std::string n = std::to_string(i);
+        auto it = kv.find("shader" + n);
+        if (it == kv.end())
+            return false;
+        pass& s = p.passes[i];
+        s.path = it->second;
+        auto a = kv.find("alias" + n);
+        if (a != kv.end())
+            s.alias = a->second;
+        zm_spm meta;
+        std::string text;
+        if (s.alias.empty() && expand(s.path, text) && spm_parse(text.data(), text.size(), meta))
+            s.alias = meta.name;
+    }
+    const std::string textures = kv["textures"];
+    for (size_t at = 0; at < textures.size(); ) {
+        size_t semi = textures.find(';', at);
+        if (semi == std::string::npos) semi = textures.size();
+        const std::string id = trim(textures.substr(at, semi - at));
+        if (!id.empty())
+            p.luts.push_back(id);
+        at = semi + 1;
+    }
+    return true;
+}
+
+// Expands and keys pass i as slang_cache_pass_key does
+static bool key_pass(preset& p, size_t i)
+{
+    pass& s = p.passes[i];
+    s.expanded.clear();
+    zm_spm meta;
+    if (!expand(s.path, s.expanded) || !spm_parse(s.expanded.data(), s.expanded.size(), meta))
+        return false;
+
+    std::vector<const char*> aliases, luts;
+    for (const pass& o : p.passes)
+        aliases.push_back(o.alias.c_str());
+    for (const std::string& l : p.luts)
+        luts.push_back(l.c_str());
+
+    zm_sc_key_in in = {};
+    in.vs_profile = VS_PROFILE;
+    in.ps_profile = PS_PROFILE;
+    in.compile_flags = COMPILE_FLAGS;
+    in.pass = (unsigned)i;
+    in.num_passes = (unsigned)p.passes.size();
+    in.aliases = aliases.data();
+    in.num_aliases = (unsigned)aliases.size();
+    in.lut_ids = luts.data();
+    in.num_luts = (unsigned)luts.size();
+    scf_pass_key(s.expanded, meta, in, s.key);
+    return true;
+}
+
+static std::string key_name(const uint64_t key[2])
+{
+    char name[64];
+    scf_file_name(key, name, sizeof(name));
+    return name;
+}
+
+static bool run(const std::string& cmd)
+{
+    return system((cmd + " >/dev/null 2>&1").c_str()) == 0;
+}
+
+// glslang -> SPIRV-Cross for one pass, stored as a .zmsc entry with the
+// SPIR-V in the bytecode blobs
+static bool compile_pass(pass& s, const std::string& tmp, const std::string& glslang,
+    const std::string& cross, const std::string& cache)
+{
+    std::string vs, fs;
+    split_stages(s.expanded, vs, fs);
+    const std::string stage_src[2] = { vs, fs };
+    static const char* const ext[2] = { "vert", "frag" };
+    std::string spv[2];
+    for (int st = 0; st < 2; ++st) {
+        const std::string src = tmp + "/pass." + ext[st];
+        if (!write_file(src, stage_src[st]) ||
+            !run(glslang + " -V " + src + " -o " + src + ".spv") ||
+            !run(cross + " " + src + ".spv --hlsl --shader-model 30 --output " + src + ".hlsl") ||
+            !read_file(src + ".spv", spv[st]) ||
+            !read_file(src + ".hlsl", s.hlsl[st]))
+            return false;
+    }
+
+    std::vector<uint8_t> payload;
+    scf_put_code(payload, s.alias.c_str(), s.hlsl[0].c_str(), s.hlsl[1].c_str(),
+        spv[0].data(), (uint32_t)spv[0].size(), spv[1].data(), (uint32_t)spv[1].size());
+    zm_sc_header h;
+    scf_header(s.key, payload, h);
+    std::string entry((const char*)&h, sizeof(h));
+    entry.append((const char*)payload.data(), payload.size());
+    return write_file(cache + "/" + key_name(s.key), entry);
+}
+
+// What slang_cache_load does before the uniform table: header, payload
+// hash, then the blobs. False on a miss or a bad entry.
+static bool load_pass(const pass& s, const std::string& cache, std::string hlsl[2])
+{
+    std::string e;
+    zm_sc_header h;
+    if (!read_file(cache + "/" + key_name(s.key), e) || e.size() < sizeof(h))
+        return false;
+    memcpy(&h, e.data(), sizeof(h));
+    const uint8_t* payload = (const uint8_t*)e.data() + sizeof(h);
+    if (!scf_header_ok(h, s.key) || !scf_payload_ok(h, payload, e.size() - sizeof(h)))
+        return false;
+
+    zm_sc_reader r{ payload, payload + h.payload_size };
+    char alias[64];
+    char* stage[2] = {};
+    void* code[2] = {};
+    uint32_t code_size[2] = {};
+    const bool ok = scf_get_code(r, alias, stage[0], stage[1], code[0], code_size[0], code[1], code_size[1]);
+    for (int st = 0; st < 2; ++st) {
+        if (ok) hlsl[st] = stage[st];
+        free(stage[st]);
+        free(code[st]);
+    }
+    return ok;
+}
+
+static double ms_since(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: zm_slang_cache_bench [--rounds N] [--cache DIR] [--glslang CMD] [--spirv-cross CMD] [preset.slangp | dir]...\n");
+}
+
+int main(int argc, char** argv)
+{
+    unsigned rounds = 5;
+    std::string cache, glslang = "glslangValidator", cross = "spirv-cross";
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        const bool more = i + 1 < argc;
+        if (a == "--rounds" && more) rounds = (unsigned)atoi(argv[++i]);
+        else if (a == "--cache" && more) cache = argv[++i];
+        else if (a == "--glslang" && more) glslang = argv[++i];
+        else if (a == "--spirv-cross" && more) cross = argv[++i];
+        else if (a.compare(0, 2, "--") == 0) { usage(); return 1; }
+        else args.push_back(a);
+    }
+    if (!rounds) rounds = 1;
+    if (args.empty()) args.push_back("custom");
+
+    std::vector<std::string> paths;
+    for (const std::string& a : args) {
+        struct stat st;
+        if (stat(a.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) find_presets(a, paths);
+        else paths.push_back(a);
+    }
+    std::sort(paths.begin(), paths.end());
+
+    char tmpl[] = "/tmp/zm_slang_cache_bench.XXXXXX";
+    const char* tmp = mkdtemp(tmpl);
+    if (!tmp) { fprintf(stderr, "can't make a temporary directory\n"); return 1; }
+    if (cache.empty()) cache = std::string(tmp) + "/cache";
+    mkdir(cache.c_str(), 0755);
+
+    const bool have = run(glslang + " --version") && run(cross + " --help");
+
+    bool ok = true;
+    std::vector<preset> presets;
+    for (const std::string& path : paths) {
+        preset p;
+        if (!load_preset(path, p)) {
+            printf("%s: can't read: FAIL\n", path.c_str());
+            ok = false;
+            continue;
+        }
+
+        // nds-freescale and scalefx-d3d9 point into the slang-shaders tree
+        bool found = true;
+        std::string text;
+        for (const pass& s : p.passes)
+            if (found && !expand(s.path, text)) {
+                printf("%s: %s missing, skipped\n", path.c_str(), s.path.c_str());
+                found = false;
+            }
+        if (!found)
+            continue;
+
+        // Reverse order first: a key mustn't depend on which passes were
+        // keyed before it
+        std::vector<std::string> reverse(p.passes.size());
+        bool keyed = true;
+        for (size_t i = p.passes.size(); keyed && i-- > 0; ) {
+            keyed = key_pass(p, i);
+            reverse[i] = key_name(p.passes[i].key);
+        }
+        for (size_t i = 0; keyed && i < p.passes.size(); ++i)
+            keyed = key_pass(p, i) && key_name(p.passes[i].key) == reverse[i];
+        if (!keyed) {
+            printf("%s: keying failed or depends on pass order: FAIL\n", path.c_str());
+            ok = false;
+            continue;
+        }
+        presets.push_back(std::move(p));
+    }
+
+    if (!have) {
+        run(std::string("rm -rf ") + tmp);
+        printf("%zu preset(s) keyed\n", presets.size());
+        printf("SKIP: %s / %s not on PATH, no cold or warm load timed\n", glslang.c_str(), cross.c_str());
+        return ok ? 0 : 2;
+    }
+
+    printf("preset                              passes     cold ms   warm ms  hits\n");
+    for (preset& p : presets) {
+        const char* name = strrchr(p.path.c_str(), '/');
+        name = name ? name + 1 : p.path.c_str();
+
+        // Cold: expand, key, compile and store every pass
+        const auto t0 = std::chrono::steady_clock::now();
+        bool compiled = true;
+        for (size_t i = 0; compiled && i < p.passes.size(); ++i) {
+            compiled = key_pass(p, i) && compile_pass(p.passes[i], tmp, glslang, cross, cache);
+            if (!compiled) {
+                printf("%s pass %zu: compile failed: FAIL\n", name, i);
+                ok = false;
+            }
+        }
+        const double cold = ms_since(t0);
+        if (!compiled)
+            continue;
+
+        // Warm: expand, key and read back; what a cache hit costs
+        unsigned hits = 0;
+        const auto t1 = std::chrono::steady_clock::now();
+        for (unsigned r = 0; r < rounds; ++r)
+            for (size_t i = 0; i < p.passes.size(); ++i) {
+                std::string hlsl[2];
+                if (key_pass(p, i) && load_pass(p.passes[i], cache, hlsl)) {
+                    ++hits;
+                    if (hlsl[0] != p.passes[i].hlsl[0] || hlsl[1] != p.passes[i].hlsl[1]) {
+                        printf("%s pass %zu: cached HLSL differs from the compiled one: FAIL\n", name, i);
+                        ok = false;
+                    }
+                }
+            }
+        const double warm = ms_since(t1) / rounds;
+        hits /= rounds;
+
+        if (hits != p.passes.size()) {
+            printf("%s: %u of %zu passes hit: FAIL\n", name, hits, p.passes.size());
+            ok = false;
+        }
+        printf("%-34s %7zu %11.1f %9.3f %5u\n", name, p.passes.size(), cold, warm, hits);
+    }
+
+    run(std::string("rm -rf ") + tmp);
+    return ok ? 0 : 2;
+}
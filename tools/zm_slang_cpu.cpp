@@ -0,0 +1,952 @@
+// zm_slang_cpu: runs a slang preset on the CPU, for golden images and pass costs
+//
+// Interprets each pass's glslang SPIR-V with tools/spv_exec.cpp over the
+// whole render target, the way the d3d9 runtime (src/slang_d3d9.cpp) draws
+// the chain: pass sizes from scale_type/scale (final pass at the viewport),
+// every sampler of a pass with that pass's filter_linear/wrap_mode, 8-bit
+// targets unless float_framebuffer (half floats, like A16B16G16R16F), sRGB
+// encode on write for srgb_framebuffer, and the usual semantics (Source,
+// Original, OriginalHistoryN, PassOutputN, PassFeedbackN, aliases, *Size,
+// FrameCount with frame_count_mod, MVP, FinalViewportSize, parameters with
+// the preset's overrides). The quad is the vertex stage run at its four
+// corners; varyings are interpolated across the target from those.
+// Pixels are split into tiles shared by a thread pool.
+//
+// Nothing here compiles GLSL. --emit-glsl splits each .slang into its
+// vertex and fragment stages (includes expanded, slang pragmas dropped)
+// next to where the SPIR-V is expected and prints the glslangValidator
+// commands that produce it; any machine with glslang can do that step.
+//
+// Per pass it reports the target size, wall time, and the interpreted
+// instruction and texture sample counts per pixel, which unlike the time
+// are the same on every machine. --golden compares the final image with a
+// reference and exits with 2 when a channel differs by more than
+// --tolerance (8-bit levels).
+//
+// tools/spv_tests/run.sh runs it on hand-assembled modules for the stock
+// and LCD3x shaders against goldens computed from their GLSL.
+//
+// Images are binary PPM (P6, 8-bit). Lookup textures (textures = ...) and
+// #reference presets are not supported.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -pthread -Isrc tools/zm_slang_cpu.cpp tools/spv_exec.cpp -o zm_slang_cpu
+// Run:
+//   ./zm_slang_cpu --emit-glsl custom/Stock.slangp
+//   (run the printed glslangValidator commands)
+//   ./zm_slang_cpu [options] custom/Stock.slangp input.ppm
+// Options:
+//   --spv DIR        SPIR-V / split GLSL directory (default: <preset dir>/spv)
+//   --viewport WxH   final size (default: the input size)
+//   --frames N       frames to run (default 1)
+//   --threads N      worker threads (default: all cores)
+//   --tile N         tile edge in pixels (default 32)
+//   --param NAME=V   parameter override (repeatable)
+//   --out FILE       write the final image
+//   --dump DIR       write every pass's output as DIR/passN.ppm
+//   --golden FILE    compare the final image with FILE
+//   --tolerance N    allowed difference per channel (default 1)
+
+#include "spv_exec.h"
+#include "half/include/half.hpp"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ZeroMod;
+
+enum scale_type { SCALE_SOURCE, SCALE_VIEWPORT, SCALE_ABSOLUTE };
+
+struct image
+{
+    uint32_t w = 0, h = 0;
+    std::vector<float> rgba;
+};
+
+struct parameter
+{
+    std::string name;
+    float value;
+};
+
+struct shader_source
+{
+    std::string path;
+    std::string base;           // file name without .slang
+    std::string vertex, fragment;
+    std::string name;           // #pragma name
+    std::string format;         // #pragma format
+    std::vector<parameter> parameters;
+    zm_spv_module* vs = nullptr;
+    zm_spv_module* fs = nullptr;
+};
+
+struct pass
+{
+    shader_source* src = nullptr;
+    std::string alias;
+    bool linear = true;
+    uint8_t wrap = ZM_SPV_WRAP_BORDER;
+    bool fp = false, srgb = false;
+    scale_type type_x = SCALE_SOURCE, type_y = SCALE_SOURCE;
+    float scale_x = 0, scale_y = 0;
+    unsigned frame_count_mod = 0;
+
+    image out, feedback;
+
+    // Per frame
+    std::vector<uint8_t> vs_uniforms, fs_uniforms;
+    std::vector<zm_spv_texture> vs_textures, fs_textures;
+    std::vector<std::unique_ptr<zm_spv_exec, void (*)(zm_spv_exec*)>> execs;
+
+    // Totals
+    double ms = 0;
+    uint64_t pixels = 0, steps = 0, samples = 0, killed = 0;
+};
+
+static bool read_file(const std::string& path, std::string& out)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    char buf[65536];
+    size_t n;
+    out.clear();
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        out.append(buf, n);
+    fclose(f);
+    return true;
+}
+
+static bool write_file(const std::string& path, const std::string& data)
+{
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    const bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+static std::string dir_of(const std::string& path)
+{
+    const size_t s = path.find_last_of('/');
+    return s == std::string::npos ? "." : path.substr(0, s);
+}
+
+static std::string join(const std::string& dir, const std::string& rel)
+{
+    if (!rel.empty() && rel[0] == '/') return rel;
+    return dir + "/" + rel;
+}
+
+static std::string trim(const std::string& s)
+{
+    size_t a = 0, b = s.size();
+    while (a < b && (s[a] == ' ' || s[a] == '\t' || s[a] == '\r')) ++a;
+    while (b > a && (s[b - 1] == ' ' || s[b - 1] == '\t' || s[b - 1] == '\r')) --b;
+    return s.substr(a, b - a);
+}
+
+// ---- Images ----
+
+static bool ppm_token(const std::string& d, size_t& at, unsigned& v)
+{
+    while (at < d.size()) {
+        if (d[at] == '#') {
+            while (at < d.size() && d[at] != '\n') ++at;
+        }
+        else if (isspace((unsigned char)d[at])) {
+            ++at;
+        }
+        else {
+            break;
+        }
+    }
+    if (at >= d.size() || !isdigit((unsigned char)d[at])) return false;
+    v = 0;
+    while (at < d.size() && isdigit((unsigned char)d[at]))
+        v = v * 10 + (unsigned)(d[at++] - '0');
+    return true;
+}
+
+static bool read_ppm(const std::string& path, image& img)
+{
+    std::string d;
+    if (!read_file(path, d) || d.size() < 2 || d[0] != 'P' || d[1] != '6') return false;
+    size_t at = 2;
+    unsigned w, h, maxval;
+    if (!ppm_token(d, at, w) || !ppm_token(d, at, h) || !ppm_token(d, at, maxval) || maxval != 255 || !w || !h)
+        return false;
+    ++at;
+    if (d.size() < at + (size_t)w * h * 3) return false;
+    img.w = w;
+    img.h = h;
+    img.rgba.resize((size_t)w * h * 4);
+    for (size_t i = 0; i < (size_t)w * h; ++i) {
+        for (int c = 0; c < 3; ++c)
+            img.rgba[4 * i + c] = (unsigned char)d[at + 3 * i + c] / 255.0f;
+        img.rgba[4 * i + 3] = 1.0f;
+    }
+    return true;
+}
+
+static unsigned char unorm8(float v)
+{
+    if (!(v > 0)) return 0;
+    if (v >= 1) return 255;
+    return (unsigned char)(v * 255.0f + 0.5f);
+}
+
+static bool write_ppm(const std::string& path, const image& img)
+{
+    std::string d = "P6\n" + std::to_string(img.w) + " " + std::to_string(img.h) + "\n255\n";
+    d.reserve(d.size() + (size_t)img.w * img.h * 3);
+    for (size_t i = 0; i < (size_t)img.w * img.h; ++i)
+        for (int c = 0; c < 3; ++c)
+            d += (char)unorm8(img.rgba[4 * i + c]);
+    return write_file(path, d);
+}
+
+static float srgb_encode(float v)
+{
+    if (!(v > 0)) return 0;
+    if (v >= 1) return 1;
+    return v <= 0.0031308f ? v * 12.92f : 1.055f * powf(v, 1.0f / 2.4f) - 0.055f;
+}
+
+// What the render target keeps of a shader's output
+static void store_texel(const pass& p, bool final, const float* in, float* out)
+{
+    for (int c = 0; c < 4; ++c) {
+        float v = in[c];
+        if (p.srgb && c < 3) v = srgb_encode(v);
+        if (p.fp && !final)
+            out[c] = (float)half_float::half(v);
+        else
+            out[c] = unorm8(v) / 255.0f;
+    }
+}
+
+// ---- Preset and shaders ----
+
+static bool read_config(const std::string& path, std::map<std::string, std::string>& kv, std::string& err)
+{
+    std::string d;
+    if (!read_file(path, d)) {
+        err = "can't read " + path;
+        return false;
+    }
+    size_t at = 0;
+    while (at < d.size()) {
+        size_t e = d.find('\n', at);
+        if (e == std::string::npos) e = d.size();
+        std::string line = trim(d.substr(at, e - at));
+        at = e + 1;
+        if (line.compare(0, 10, "#reference") == 0) {
+            err = "#reference presets are not supported";
+            return false;
+        }
+        if (line.empty() || line[0] == '#') continue;
+        const size_t eq = line.find('=');
+        if (eq == std::string::npos) continue;
+        std::string k = trim(line.substr(0, eq)), v = trim(line.substr(eq + 1));
+        if (v.size() >= 2 && v.front() == '"') {
+            const size_t q = v.find('"', 1);
+            v = v.substr(1, q == std::string::npos ? std::string::npos : q - 1);
+        }
+        kv[k] = v;      // later lines win
+    }
+    return true;
+}
+
+static bool load_slang(const std::string& path, std::string& out, std::string& err, int depth = 0)
+{
+    std::string d;
+    if (depth > 16 || !read_file(path, d)) {
+        err = "can't read " + path;
+        return false;
+    }
+    size_t at = 0;
+    while (at < d.size()) {
+        size_t e = d.find('\n', at);
+        if (e == std::string::npos) e = d.size();
+        const std::string line = d.substr(at, e - at);
+        at = e + 1;
+        const std::string t = trim(line);
+        if (t.compare(0, 8, "#include") == 0) {
+            const size_t q0 = t.find('"'), q1 = t.rfind('"');
+            if (q0 == std::string::npos || q1 <= q0) {
+                err = path + ": bad #include";
+                return false;
+            }
+            std::string inc;
+            if (!load_slang(join(dir_of(path), t.substr(q0 + 1, q1 - q0 - 1)), inc, err, depth + 1))
+                return false;
+            out += inc;
+            continue;
+        }
+        out += line;
+        out += '\n';
+    }
+    return true;
+}
+
+// Splits stages and pulls out the slang pragmas, like slang_preprocess
+static bool parse_slang(shader_source& s, std::string& err)
+{
+    std::string text;
+    if (!load_slang(s.path, text, err)) return false;
+
+    int stage = 0;      // 0 shared, 1 vertex, 2 fragment
+    size_t at = 0;
+    while (at < text.size()) {
+        size_t e = text.find('\n', at);
+        if (e == std::string::npos) e = text.size();
+        const std::string line = text.substr(at, e - at + 1);
+        at = e + 1;
+        const std::string t = trim(line);
+        if (t.compare(0, 7, "#pragma") == 0) {
+            char what[32] = {}, arg[256] = {};
+            sscanf(t.c_str() + 7, " %31s %255s", what, arg);
+            if (!strcmp(what, "stage")) {
+                stage = !strcmp(arg, "vertex") ? 1 : !strcmp(arg, "fragment") ? 2 : -1;
+                if (stage < 0) {
+                    err = s.path + ": unknown stage " + arg;
+                    return false;
+                }
+                continue;
+            }
+            if (!strcmp(what, "name")) { s.name = arg; continue; }
+            if (!strcmp(what, "format")) { s.format = arg; continue; }
+            if (!strcmp(what, "parameter")) {
+                // #pragma parameter id "description" default min max step
+                const size_t q1 = t.find('"'), q2 = q1 == std::string::npos ? q1 : t.find('"', q1 + 1);
+                float def = 0;
+                if (q2 == std::string::npos || sscanf(t.c_str() + q2 + 1, "%f", &def) != 1) {
+                    err = s.path + ": bad #pragma parameter";
+                    return false;
+                }
+                bool seen = false;
+                for (const parameter& p : s.parameters) seen = seen || p.name == arg;
+                if (!seen) s.parameters.push_back({ arg, def });
+                continue;
+            }
+        }
+        if (stage != 2) s.vertex += line;
+        if (stage != 1) s.fragment += line;
+    }
+    return true;
+}
+
+static zm_spv_module* load_spv(const std::string& path, int stage, std::string& err)
+{
+    std::string d;
+    if (!read_file(path, d) || d.size() % 4) {
+        err = "can't read " + path + " (run --emit-glsl and glslangValidator first)";
+        return nullptr;
+    }
+    std::vector<uint32_t> words(d.size() / 4);
+    memcpy(words.data(), d.data(), d.size());
+    std::string e;
+    zm_spv_module* m = spv_load(words.data(), words.size(), stage, e);
+    if (!m) err = path + ": " + e;
+    return m;
+}
+
+// ---- Running the chain ----
+
+struct run_context
+{
+    const image* original;
+    uint32_t viewport_w, viewport_h;
+    uint32_t frame;
+    unsigned threads;
+    unsigned tile;
+    std::vector<pass>* passes;
+    std::map<std::string, float> params;
+    std::map<std::string, bool> warned;
+};
+
+static void size4(const image& img, float* v)
+{
+    v[0] = (float)img.w;
+    v[1] = (float)img.h;
+    v[2] = img.w ? 1.0f / img.w : 0.0f;
+    v[3] = img.h ? 1.0f / img.h : 0.0f;
+}
+
+static bool ends_with(const std::string& s, const char* suffix, std::string& head)
+{
+    const size_t n = strlen(suffix);
+    if (s.size() <= n || s.compare(s.size() - n, n, suffix) != 0) return false;
+    head = s.substr(0, s.size() - n);
+    return true;
+}
+
+static bool number_suffix(const std::string& s, const char* prefix, unsigned& n)
+{
+    const size_t pl = strlen(prefix);
+    if (s.size() <= pl || s.compare(0, pl, prefix) != 0) return false;
+    for (size_t i = pl; i < s.size(); ++i)
+        if (!isdigit((unsigned char)s[i])) return false;
+    n = (unsigned)atoi(s.c_str() + pl);
+    return true;
+}
+
+// Pass index of an alias, or -1
+static int alias_pass(const run_context& ctx, const std::string& name, unsigned before)
+{
+    for (unsigned i = 0; i < before && i < ctx.passes->size(); ++i) {
+        const pass& p = (*ctx.passes)[i];
+        if (name == p.alias || (p.alias.empty() && !p.src->name.empty() && name == p.src->name)) return (int)i;
+    }
+    return -1;
+}
+
+// Image a sampler name refers to for pass i
+static const image* sampler_image(run_context& ctx, unsigned i, const std::string& name, const image& source)
+{
+    std::vector<pass>& P = *ctx.passes;
+    unsigned n;
+    std::string head;
+    if (name == "Source") return &source;
+    if (name == "Original") return ctx.original;
+    if (number_suffix(name, "OriginalHistory", n)) return ctx.original;    // one input frame
+    if (number_suffix(name, "PassOutput", n)) return n < i ? &P[n].out : nullptr;
+    if (number_suffix(name, "PassFeedback", n)) return n < P.size() ? &P[n].feedback : nullptr;
+    if (ends_with(name, "Feedback", head)) {
+        const int a = alias_pass(ctx, head, (unsigned)P.size());
+        return a >= 0 ? &P[a].feedback : nullptr;
+    }
+    const int a = alias_pass(ctx, name, i);
+    return a >= 0 ? &P[a].out : nullptr;
+}
+
+static void fill_uniforms(run_context& ctx, unsigned i, const image& source, const zm_spv_module* m, std::vector<uint8_t>& blob)
+{
+    pass& p = (*ctx.passes)[i];
+    blob.assign(spv_uniform_size(m), 0);
+
+    for (const zm_spv_var& u : spv_uniforms(m)) {
+        float v[16] = {};
+        int n = 0;
+        std::string head;
+        unsigned k;
+        if (u.name == "MVP") {
+            // RetroArch's ortho(0, 1, 0, 1, -1, 1), column-major
+            const float mvp[16] = { 2, 0, 0, 0, 0, 2, 0, 0, 0, 0, -1, 0, -1, -1, 0, 1 };
+            memcpy(v, mvp, sizeof(mvp));
+            n = 16;
+        }
+        else if (u.name == "SourceSize") { size4(source, v); n = 4; }
+        else if (u.name == "OriginalSize") { size4(*ctx.original, v); n = 4; }
+        else if (u.name == "OutputSize") { size4(p.out, v); n = 4; }
+        else if (u.name == "FinalViewportSize") {
+            image vp;
+            vp.w = ctx.viewport_w;
+            vp.h = ctx.viewport_h;
+            size4(vp, v);
+            n = 4;
+        }
+        else if (u.name == "FrameCount") {
+            v[0] = (float)(p.frame_count_mod ? ctx.frame % p.frame_count_mod : ctx.frame);
+            n = 1;
+        }
+        else if (u.name == "FrameDirection" || u.name == "TotalSubFrames" || u.name == "CurrentSubFrame") { v[0] = 1; n = 1; }
+        else if (u.name == "Rotation") { v[0] = 0; n = 1; }
+        else if (ctx.params.count(u.name)) { v[0] = ctx.params[u.name]; n = 1; }
+        else if (number_suffix(u.name, "OriginalHistorySize", k)) { size4(*ctx.original, v); n = 4; }
+        else if (ends_with(u.name, "Size", head)) {
+            const image* img = sampler_image(ctx, i, head, source);
+            if (img) { size4(*img, v); n = 4; }
+        }
+        if (!n) {
+            if (!ctx.warned[u.name]) fprintf(stderr, "warning: no value for uniform %s, using 0\n", u.name.c_str());
+            ctx.warned[u.name] = true;
+            continue;
+        }
+
+        // Matrices come as 'array' columns of 'words'
+        const uint32_t per = u.words;
+        for (uint32_t a = 0; a < u.array; ++a) {
+            for (uint32_t c = 0; c < per; ++c) {
+                const int src = (int)(a * (n == 16 ? 4 : per) + c);
+                const float f = src < n ? v[src] : 0.0f;
+                uint32_t w;
+                if (u.kind == ZM_SPV_INT) w = (uint32_t)(int32_t)f;
+                else if (u.kind == ZM_SPV_UINT || u.kind == ZM_SPV_BOOL) w = (uint32_t)f;
+                else memcpy(&w, &f, 4);
+                const size_t at = u.offset + (size_t)a * u.stride + 4 * c;
+                if (at + 4 <= blob.size()) memcpy(blob.data() + at, &w, 4);
+            }
+        }
+    }
+}
+
+static bool bind_textures(run_context& ctx, unsigned i, const image& source, const zm_spv_module* m, std::vector<zm_spv_texture>& out, std::string& err)
+{
+    const pass& p = (*ctx.passes)[i];
+    out.clear();
+    for (const zm_spv_var& s : spv_samplers(m)) {
+        const image* img = sampler_image(ctx, i, s.name, source);
+        if (!img) {
+            err = "pass " + std::to_string(i) + ": nothing to bind to sampler " + s.name + " (lookup textures are not supported)";
+            return false;
+        }
+        // Like zm_bind_all_ps_samplers_by_ct: the pass's own filter and wrap for every sampler
+        out.push_back(zm_spv_texture{ img->rgba.empty() ? nullptr : img->rgba.data(), img->w, img->h, p.linear, p.wrap });
+    }
+    return true;
+}
+
+static bool run_pass(run_context& ctx, unsigned i, const image& source, std::string& err)
+{
+    std::vector<pass>& P = *ctx.passes;
+    pass& p = P[i];
+    const bool final = i + 1 == P.size();
+
+    // Output size, as in the d3d9 runtime
+    const uint32_t base_w = p.type_x == SCALE_VIEWPORT ? ctx.viewport_w : source.w;
+    const uint32_t base_h = p.type_y == SCALE_VIEWPORT ? ctx.viewport_h : source.h;
+    uint32_t w = p.type_x == SCALE_ABSOLUTE ? (uint32_t)p.scale_x : (uint32_t)(base_w * (p.scale_x > 0 ? p.scale_x : 1.0f) + 0.5f);
+    uint32_t h = p.type_y == SCALE_ABSOLUTE ? (uint32_t)p.scale_y : (uint32_t)(base_h * (p.scale_y > 0 ? p.scale_y : 1.0f) + 0.5f);
+    if (final) {
+        w = ctx.viewport_w;
+        h = ctx.viewport_h;
+    }
+    p.out.w = std::max(w, 1u);
+    p.out.h = std::max(h, 1u);
+    p.out.rgba.assign((size_t)p.out.w * p.out.h * 4, 0.0f);
+
+    fill_uniforms(ctx, i, source, p.src->vs, p.vs_uniforms);
+    fill_uniforms(ctx, i, source, p.src->fs, p.fs_uniforms);
+    if (!bind_textures(ctx, i, source, p.src->vs, p.vs_textures, err) ||
+        !bind_textures(ctx, i, source, p.src->fs, p.fs_textures, err))
+        return false;
+
+    // Vertex stage at the quad corners: Position and TexCoord both (x, y) in [0, 1]
+    const std::vector<zm_spv_var>& vin = spv_inputs(p.src->vs);
+    const std::vector<zm_spv_var>& vout = spv_outputs(p.src->vs);
+    std::vector<std::vector<float>> corners(vout.size());
+    float pos[4][4];
+    {
+        zm_spv_exec* ve = spv_exec_create(p.src->vs);
+        spv_bind(ve, p.vs_uniforms.data(), p.vs_textures.data());
+        for (int k = 0; k < 4; ++k) {
+            const float cx = (float)(k & 1), cy = (float)(k >> 1);
+            for (size_t a = 0; a < vin.size(); ++a) {
+                const float v[4] = { cx, cy, 0.0f, 1.0f };
+                float buf[16] = {};
+                memcpy(buf, v, sizeof(v));
+                if (vin[a].location <= 1) spv_set_input(ve, a, buf);
+            }
+            spv_set_vertex_index(ve, k);
+            if (spv_run(ve) != ZM_SPV_DONE) {
+                err = p.src->base + " vertex: " + spv_exec_error(ve);
+                spv_exec_free(ve);
+                return false;
+            }
+            spv_get_position(ve, pos[k]);
+            for (size_t o = 0; o < vout.size(); ++o) {
+                std::vector<float> tmp(vout[o].words);
+                spv_get_output(ve, o, tmp.data());
+                corners[o].insert(corners[o].end(), tmp.begin(), tmp.end());
+            }
+        }
+        spv_exec_free(ve);
+    }
+
+    // Target pixel -> position on the quad, from corners 0 and 3
+    float x0 = 0, y0 = 0, x1 = (float)p.out.w, y1 = (float)p.out.h;
+    if (pos[0][3] != 0 && pos[3][3] != 0) {
+        x0 = (pos[0][0] / pos[0][3] * 0.5f + 0.5f) * p.out.w;
+        y0 = (pos[0][1] / pos[0][3] * 0.5f + 0.5f) * p.out.h;
+        x1 = (pos[3][0] / pos[3][3] * 0.5f + 0.5f) * p.out.w;
+        y1 = (pos[3][1] / pos[3][3] * 0.5f + 0.5f) * p.out.h;
+    }
+    if (fabsf(x1 - x0) < 1e-6f || fabsf(y1 - y0) < 1e-6f) {
+        err = p.src->base + ": the vertex stage produced a degenerate quad";
+        return false;
+    }
+
+    // Fragment input -> vertex output with the same location
+    const std::vector<zm_spv_var>& fin = spv_inputs(p.src->fs);
+    std::vector<int> link(fin.size(), -1);
+    for (size_t a = 0; a < fin.size(); ++a)
+        for (size_t o = 0; o < vout.size(); ++o)
+            if (vout[o].location == fin[a].location && vout[o].words >= fin[a].words) link[a] = (int)o;
+
+    const std::vector<zm_spv_var>& fout = spv_outputs(p.src->fs);
+    int color = -1;
+    for (size_t o = 0; o < fout.size(); ++o)
+        if (fout[o].location == 0) color = (int)o;
+    if (color < 0) {
+        err = p.src->base + ": no fragment output at location 0";
+        return false;
+    }
+
+    const uint32_t tile = ctx.tile;
+    const uint32_t tiles_x = (p.out.w + tile - 1) / tile, tiles_y = (p.out.h + tile - 1) / tile;
+    std::atomic<uint32_t> next{ 0 };
+    std::atomic<bool> failed{ false };
+    std::mutex err_lock;
+    std::atomic<uint64_t> killed{ 0 };
+
+    auto worker = [&](zm_spv_exec* e) {
+        spv_bind(e, p.fs_uniforms.data(), p.fs_textures.data());
+        std::vector<float> in(64), res(std::max(fout[color].words, 4u));
+        for (;;) {
+            const uint32_t t = next.fetch_add(1);
+            if (t >= tiles_x * tiles_y || failed.load(std::memory_order_relaxed)) return;
+            const uint32_t tx0 = (t % tiles_x) * tile, ty0 = (t / tiles_x) * tile;
+            const uint32_t tx1 = std::min(tx0 + tile, p.out.w), ty1 = std::min(ty0 + tile, p.out.h);
+            for (uint32_t y = ty0; y < ty1; ++y) {
+                const float t_ = ((float)y + 0.5f - y0) / (y1 - y0);
+                for (uint32_t x = tx0; x < tx1; ++x) {
+                    const float s = ((float)x + 0.5f - x0) / (x1 - x0);
+                    const float wts[4] = { (1 - s) * (1 - t_), s * (1 - t_), (1 - s) * t_, s * t_ };
+                    for (size_t a = 0; a < fin.size(); ++a) {
+                        const uint32_t n = fin[a].words;
+                        if (in.size() < n) in.resize(n);
+                        if (link[a] < 0) {
+                            std::fill(in.begin(), in.begin() + n, 0.0f);
+                        }
+                        else {
+                            const std::vector<float>& c = corners[link[a]];
+                            const uint32_t cw = vout[link[a]].words;
+                            for (uint32_t k = 0; k < n; ++k)
+                                in[k] = fin[a].flat ? c[k]
+                                    : wts[0] * c[k] + wts[1] * c[cw + k] + wts[2] * c[2 * cw + k] + wts[3] * c[3 * cw + k];
+                        }
+                        spv_set_input(e, a, in.data());
+                    }
+                    const float fc[4] = { (float)x + 0.5f, (float)y + 0.5f, 0.0f, 1.0f };
+                    spv_set_frag_coord(e, fc);
+                    const zm_spv_result r = spv_run(e);
+                    float* dst = &p.out.rgba[4 * ((size_t)y * p.out.w + x)];
+                    if (r == ZM_SPV_ERROR) {
+                        std::lock_guard<std::mutex> g(err_lock);
+                        if (!failed.exchange(true))
+                            err = p.src->base + " fragment at " + std::to_string(x) + "," + std::to_string(y) + ": " + spv_exec_error(e);
+                        return;
+                    }
+                    if (r == ZM_SPV_KILLED) {
+                        // Discarded: the cleared target shows through
+                        ++killed;
+                        continue;
+                    }
+                    std::fill(res.begin(), res.end(), 0.0f);
+                    res[3] = 1.0f;
+                    spv_get_output(e, color, res.data());
+                    store_texel(p, final, res.data(), dst);
+                }
+            }
+        }
+    };
+
+    const auto t0 = std::chrono::steady_clock::now();
+    const unsigned n = std::max(1u, std::min(ctx.threads, tiles_x * tiles_y));
+    uint64_t steps_before = 0, samples_before = 0;
+    for (unsigned k = 0; k < n; ++k) {
+        steps_before += spv_steps(p.execs[k].get());
+        samples_before += spv_samples(p.execs[k].get());
+    }
+    if (n == 1) {
+        worker(p.execs[0].get());
+    }
+    else {
+        std::vector<std::thread> pool;
+        for (unsigned k = 0; k < n; ++k)
+            pool.emplace_back(worker, p.execs[k].get());
+        for (std::thread& t : pool)
+            t.join();
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    if (failed) return false;
+
+    uint64_t steps = 0, samples = 0;
+    for (unsigned k = 0; k < n; ++k) {
+        steps += spv_steps(p.execs[k].get());
+        samples += spv_samples(p.execs[k].get());
+    }
+    p.ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+    p.pixels += (uint64_t)p.out.w * p.out.h;
+    p.steps += steps - steps_before;
+    p.samples += samples - samples_before;
+    p.killed += killed;
+    return true;
+}
+
+static bool parse_size(const char* s, uint32_t& w, uint32_t& h)
+{
+    unsigned a, b;
+    if (sscanf(s, "%ux%u", &a, &b) != 2 || !a || !b) return false;
+    w = a;
+    h = b;
+    return true;
+}
+
+static void usage()
+{
+    fprintf(stderr,
+        "usage: zm_slang_cpu --emit-glsl [--spv DIR] preset.slangp\n"
+        "       zm_slang_cpu [--spv DIR] [--viewport WxH] [--frames N] [--threads N] [--tile N]\n"
+        "                    [--param NAME=V]... [--out FILE] [--dump DIR] [--golden FILE] [--tolerance N]\n"
+        "                    preset.slangp input.ppm\n");
+}
+
+int main(int argc, char** argv)
+{
+    std::string spv_dir, out_path, dump_dir, golden_path, preset_path, input_path;
+    uint32_t vp_w = 0, vp_h = 0;
+    unsigned frames = 1, threads = std::max(1u, std::thread::hardware_concurrency()), tile = 32;
+    int tolerance = 1;
+    bool emit = false;
+    std::vector<std::pair<std::string, float>> overrides;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        const bool more = i + 1 < argc;
+        if (a == "--emit-glsl") emit = true;
+        else if (a == "--spv" && more) spv_dir = argv[++i];
+        else if (a == "--viewport" && more) {
+            if (!parse_size(argv[++i], vp_w, vp_h)) { usage(); return 1; }
+        }
+        else if (a == "--frames" && more) frames = (unsigned)std::max(1, atoi(argv[++i]));
+        else if (a == "--threads" && more) threads = (unsigned)std::max(1, atoi(argv[++i]));
+        else if (a == "--tile" && more) tile = (unsigned)std::max(1, atoi(argv[++i]));
+        else if (a == "--param" && more) {
+            const std::string kv = argv[++i];
+            const size_t eq = kv.find('=');
+            if (eq == std::string::npos) { usage(); return 1; }
+            overrides.push_back({ kv.substr(0, eq), (float)atof(kv.c_str() + eq + 1) });
+        }
+        else if (a == "--out" && more) out_path = argv[++i];
+        else if (a == "--dump" && more) dump_dir = argv[++i];
+        else if (a == "--golden" && more) golden_path = argv[++i];
+        else if (a == "--tolerance" && more) tolerance = atoi(argv[++i]);
+        else if (!a.empty() && a[0] == '-') { usage(); return 1; }
+        else if (preset_path.empty()) preset_path = a;
+        else if (input_path.empty()) input_path = a;
+        else { usage(); return 1; }
+    }
+    if (preset_path.empty() || (!emit && input_path.empty())) {
+        usage();
+        return 1;
+    }
+    if (spv_dir.empty()) spv_dir = dir_of(preset_path) + "/spv";
+
+    std::string err;
+    std::map<std::string, std::string> kv;
+    if (!read_config(preset_path, kv, err)) {
+        fprintf(stderr, "%s\n", err.c_str());
+        return 1;
+    }
+    auto get = [&](const std::string& k) -> const std::string* {
+        auto it = kv.find(k);
+        return it == kv.end() ? nullptr : &it->second;
+    };
+    auto get_bool = [&](const std::string& k, bool def) {
+        const std::string* v = get(k);
+        return v ? (*v == "true" || *v == "1") : def;
+    };
+    if (get("textures")) {
+        fprintf(stderr, "%s: lookup textures are not supported\n", preset_path.c_str());
+        return 1;
+    }
+    const unsigned count = get("shaders") ? (unsigned)atoi(get("shaders")->c_str()) : 0;
+    if (!count || count > 64) {
+        fprintf(stderr, "%s: bad shader count\n", preset_path.c_str());
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<shader_source>> sources;
+    std::vector<pass> passes(count);
+    for (unsigned i = 0; i < count; ++i) {
+        const std::string n = std::to_string(i);
+        const std::string* path = get("shader" + n);
+        if (!path) {
+            fprintf(stderr, "%s: shader%u missing\n", preset_path.c_str(), i);
+            return 1;
+        }
+        const std::string full = join(dir_of(preset_path), *path);
+        shader_source* src = nullptr;
+        for (auto& s : sources)
+            if (s->path == full) src = s.get();
+        if (!src) {
+            sources.emplace_back(new shader_source());
+            src = sources.back().get();
+            src->path = full;
+            std::string base = full.substr(full.find_last_of('/') + 1);
+            if (base.size() > 6 && base.compare(base.size() - 6, 6, ".slang") == 0) base.resize(base.size() - 6);
+            src->base = base;
+            for (auto& s : sources)
+                if (s.get() != src && s->base == base) {
+                    fprintf(stderr, "%s and %s share a file name; their SPIR-V would collide in %s\n",
+                        s->path.c_str(), full.c_str(), spv_dir.c_str());
+                    return 1;
+                }
+            if (!parse_slang(*src, err)) {
+                fprintf(stderr, "%s\n", err.c_str());
+                return 1;
+            }
+        }
+
+        pass& p = passes[i];
+        p.src = src;
+        if (const std::string* v = get("alias" + n)) p.alias = *v;
+        if (const std::string* v = get("filter_linear" + n)) p.linear = *v == "true" || *v == "1";
+        if (const std::string* v = get("wrap_mode" + n)) {
+            p.wrap = *v == "clamp_to_edge" ? ZM_SPV_WRAP_EDGE
+                : *v == "repeat" ? ZM_SPV_WRAP_REPEAT
+                : *v == "mirrored_repeat" ? ZM_SPV_WRAP_MIRROR : ZM_SPV_WRAP_BORDER;
+        }
+        p.fp = get_bool("float_framebuffer" + n, src->format.find("SFLOAT") != std::string::npos);
+        p.srgb = get_bool("srgb_framebuffer" + n, src->format.find("SRGB") != std::string::npos);
+        if (const std::string* v = get("frame_count_mod" + n)) p.frame_count_mod = (unsigned)atoi(v->c_str());
+
+        auto type_of = [](const std::string& v) {
+            return v == "viewport" ? SCALE_VIEWPORT : v == "absolute" ? SCALE_ABSOLUTE : SCALE_SOURCE;
+        };
+        if (const std::string* v = get("scale_type" + n)) p.type_x = p.type_y = type_of(*v);
+        if (const std::string* v = get("scale_type_x" + n)) p.type_x = type_of(*v);
+        if (const std::string* v = get("scale_type_y" + n)) p.type_y = type_of(*v);
+        if (const std::string* v = get("scale" + n)) p.scale_x = p.scale_y = (float)atof(v->c_str());
+        if (const std::string* v = get("scale_x" + n)) p.scale_x = (float)atof(v->c_str());
+        if (const std::string* v = get("scale_y" + n)) p.scale_y = (float)atof(v->c_str());
+    }
+
+    if (emit) {
+        for (auto& s : sources) {
+            const std::string vs = spv_dir + "/" + s->base + ".vert", fs = spv_dir + "/" + s->base + ".frag";
+            if (!write_file(vs, s->vertex) || !write_file(fs, s->fragment)) {
+                fprintf(stderr, "can't write to %s\n", spv_dir.c_str());
+                return 1;
+            }
+            printf("glslangValidator -V %s -o %s.spv\n", vs.c_str(), vs.c_str());
+            printf("glslangValidator -V %s -o %s.spv\n", fs.c_str(), fs.c_str());
+        }
+        return 0;
+    }
+
+    for (auto& s : sources) {
+        s->vs = load_spv(spv_dir + "/" + s->base + ".vert.spv", ZM_SPV_VERTEX, err);
+        if (s->vs) s->fs = load_spv(spv_dir + "/" + s->base + ".frag.spv", ZM_SPV_FRAGMENT, err);
+        if (!s->fs) {
+            fprintf(stderr, "%s\n", err.c_str());
+            return 1;
+        }
+        if (spv_uses_derivatives(s->fs))
+            fprintf(stderr, "warning: %s uses derivatives, which read as 0 here\n", s->base.c_str());
+    }
+
+    image input;
+    if (!read_ppm(input_path, input)) {
+        fprintf(stderr, "can't read %s (binary PPM expected)\n", input_path.c_str());
+        return 1;
+    }
+
+    run_context ctx;
+    ctx.original = &input;
+    ctx.viewport_w = vp_w ? vp_w : input.w;
+    ctx.viewport_h = vp_h ? vp_h : input.h;
+    ctx.threads = threads;
+    ctx.tile = tile;
+    ctx.passes = &passes;
+
+    // Shader defaults, then the preset's parameter values, then --param
+    for (auto& s : sources)
+        for (const parameter& p : s->parameters)
+            if (!ctx.params.count(p.name)) ctx.params[p.name] = p.value;
+    for (auto& it : ctx.params)
+        if (const std::string* v = get(it.first)) it.second = (float)atof(v->c_str());
+    for (auto& o : overrides) {
+        if (!ctx.params.count(o.first)) fprintf(stderr, "warning: no parameter named %s\n", o.first.c_str());
+        ctx.params[o.first] = o.second;
+    }
+
+    for (pass& p : passes)
+        for (unsigned k = 0; k < threads; ++k)
+            p.execs.emplace_back(spv_exec_create(p.src->fs), spv_exec_free);
+
+    for (unsigned f = 0; f < frames; ++f) {
+        ctx.frame = f;
+        for (pass& p : passes)
+            std::swap(p.feedback, p.out);
+        for (unsigned i = 0; i < count; ++i) {
+            const image& source = i ? passes[i - 1].out : input;
+            if (!run_pass(ctx, i, source, err)) {
+                fprintf(stderr, "frame %u: %s\n", f, err.c_str());
+                return 1;
+            }
+        }
+    }
+
+    printf("%s: %u pass(es), %ux%u -> %ux%u, %u frame(s), %u thread(s)\n", preset_path.c_str(), count,
+        input.w, input.h, ctx.viewport_w, ctx.viewport_h, frames, threads);
+    printf("pass  shader                    size        ms/frame   insn/px  samples/px\n");
+    for (unsigned i = 0; i < count; ++i) {
+        const pass& p = passes[i];
+        const double px = p.pixels ? (double)p.pixels : 1.0;
+        printf("%4u  %-24s  %4ux%-5u  %9.2f  %8.1f  %10.2f%s\n", i, p.src->base.c_str(), p.out.w, p.out.h,
+            p.ms / frames, p.steps / px, p.samples / px, p.killed ? "  (discards)" : "");
+    }
+
+    const image& final_img = passes.back().out;
+    if (!out_path.empty() && !write_ppm(out_path, final_img)) {
+        fprintf(stderr, "can't write %s\n", out_path.c_str());
+        return 1;
+    }
+    if (!dump_dir.empty()) {
+        for (unsigned i = 0; i < count; ++i)
+            if (!write_ppm(dump_dir + "/pass" + std::to_string(i) + ".ppm", passes[i].out)) {
+                fprintf(stderr, "can't write to %s\n", dump_dir.c_str());
+                return 1;
+            }
+    }
+
+    if (!golden_path.empty()) {
+        image golden;
+        if (!read_ppm(golden_path, golden)) {
+            fprintf(stderr, "can't read %s\n", golden_path.c_str());
+            return 1;
+        }
+        if (golden.w != final_img.w || golden.h != final_img.h) {
+            printf("golden: size %ux%u, output %ux%u: FAIL\n", golden.w, golden.h, final_img.w, final_img.h);
+            return 2;
+        }
+        uint64_t bad = 0;
+        int worst = 0;
+        double sq = 0;
+        for (size_t i = 0; i < (size_t)golden.w * golden.h; ++i) {
+            bool off = false;
+            for (int c = 0; c < 3; ++c) {
+                const int d = abs((int)unorm8(golden.rgba[4 * i + c]) - (int)unorm8(final_img.rgba[4 * i + c]));
+                worst = std::max(worst, d);
+                sq += (double)d * d;
+                off = off || d > tolerance;
+            }
+            bad += off;
+        }
+        const double mse = sq / ((double)golden.w * golden.h * 3);
+        printf("golden: %llu pixel(s) off by more than %d, max %d, PSNR %s: %s\n", (unsigned long long)bad, tolerance, worst,
+            mse > 0 ? std::to_string(10.0 * log10(255.0 * 255.0 / mse)).c_str() : "inf", bad ? "FAIL" : "ok");
+        if (bad) return 2;
+    }
+
+    for (auto& s : sources) {
+        spv_free(s->vs);
+        spv_free(s->fs);
+    }
+    return 0;
+}
@@ -0,0 +1,297 @@
+// zm_slang_prepare_bench: serial vs concurrent slang pass prepare
+//
+// Runs the scheduling slang_d3d9_prepare_passes (src/slang_d3d9.cpp) uses,
+// src/slang_prepare_batch.cpp, with std::thread in place of CreateThread
+// and a std::mutex for slang_process_cs: every pass's pragmas are
+// registered in pass order first, then workers take passes off a shared
+// counter, the calling thread being worker 0. Per pass, slang_process
+// runs under the one lock and appends the parameters the shared list
+// doesn't have yet; the D3DX compile after it runs outside the lock.
+// slang_process's glslang / SPIRV-Cross half is glslangValidator and
+// spirv-cross when both are on PATH and --process-ms of busy work when
+// not; D3DX is --compile-ms of busy work.
+//
+// For each preset (custom/ and slang-shaders/ when present, or the ones
+// given) it times the batch on 1, 2, 4 and 8 workers, capped at the pass
+// count and ZM_SLANG_COMPILE_THREADS, and prints the speedup over one;
+// that is bounded by the core count, printed first, and by the share of
+// a pass that runs under the lock. Every run has to prepare each pass
+// exactly once and end with the parameter list the serial run built, in
+// the same order, and a batch whose cancel flag is already raised has to
+// fail without preparing a pass; exits with 2 when one doesn't.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -pthread -Isrc tools/zm_slang_prepare_bench.cpp src/slang_prepare_batch.cpp src/slang_pass_meta.cpp tools/slang_files.cpp -o zm_slang_prepare_bench
+// Run:
+//   ./zm_slang_prepare_bench custom
+// Options:
+//   --process-ms N   locked cost per pass without the compilers (default 10)
+//   --compile-ms N   unlocked cost per pass (default 30)
+
+#include "slang_pass_meta.h"
+#include "slang_prepare_batch.h"
+#include "slang_files.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ZeroMod;
+
+typedef std::chrono::steady_clock clk;
+
+static double g_process_ms = 10.0;
+static double g_compile_ms = 30.0;
+static bool g_compilers = false;
+static std::string g_tmp;
+
+static void busy(double ms)
+{
+    const auto until = clk::now() + std::chrono::duration<double, std::milli>(ms);
+    while (clk::now() < until) {}
+}
+
+static bool run(const std::string& cmd)
+{
+    return system((cmd + " >/dev/null 2>&1").c_str()) == 0;
+}
+
+struct pass
+{
+    std::string source;     // include-expanded
+    zm_spm meta;
+};
+
+struct preset
+{
+    std::string path;
+    std::vector<pass> passes;
+};
+
+static bool load_preset(const std::string& path, preset& p)
+{
+    std::string text;
+    if (!read_file(path, text))
+        return false;
+    std::map<unsigned, std::string> shaders;
+    for (const std::string& l : lines_of(text)) {
+        const size_t eq = l.find('=');
+        if (l.empty() || l[0] == '#' || eq == std::string::npos)
+            continue;
+        const std::string k = trim(l.substr(0, eq));
+        if (k.compare(0, 6, "shader") == 0 && k != "shaders")
+            shaders[(unsigned)atoi(k.c_str() + 6)] = join(path, trim(l.substr(eq + 1)));
+    }
+    p.path = path;
+    for (const auto& s : shaders) {
+        pass ps;
+        if (!expand(s.second, ps.source) || !spm_parse(ps.source.data(), ps.source.size(), ps.meta))
+            return false;
+        p.passes.push_back(std::move(ps));
+    }
+    return !p.passes.empty();
+}
+
+// The shared video_shader state a batch touches
+struct shared_list
+{
+    std::vector<std::string> params;    // ids, in registration order
+};
+
+static void register_meta(shared_list& s, const zm_spm& meta)
+{
+    for (const zm_spm_param& p : meta.params)
+        if (std::find(s.params.begin(), s.params.end(), p.id) == s.params.end())
+            s.params.push_back(p.id);
+}
+
+// What slang_d3d9_prepare_passes hands the scheduler
+struct batch_ctx
+{
+    const preset* p;
+    shared_list* list;
+    std::mutex* process_cs;
+    std::vector<int>* prepared;
+};
+
+static void batch_lock(void* ctx) { ((batch_ctx*)ctx)->process_cs->lock(); }
+static void batch_unlock(void* ctx) { ((batch_ctx*)ctx)->process_cs->unlock(); }
+
+static void batch_register(void* ctx, unsigned i)
+{
+    batch_ctx* c = (batch_ctx*)ctx;
+    register_meta(*c->list, c->p->passes[i].meta);
+}
+
+// slang_process under the lock, then the compile outside it
+static bool batch_prepare(void* ctx, unsigned i)
+{
+    batch_ctx* c = (batch_ctx*)ctx;
+    const pass& ps = c->p->passes[i];
+    {
+        std::lock_guard<std::mutex> lock(*c->process_cs);
+        register_meta(*c->list, ps.meta);
+        if (g_compilers) {
+            // Files per pass, though the lock keeps this serial as in the DLL
+            std::string stage[2];
+            split_stages(ps.source, stage[0], stage[1]);
+            static const char* const ext[2] = { ".vert", ".frag" };
+            for (int st = 0; st < 2; ++st) {
+                const std::string src = g_tmp + "/p" + std::to_string(i) + ext[st];
+                write_file(src, stage[st]);
+                run("glslangValidator -V " + src + " -o " + src + ".spv");
+                run("spirv-cross " + src + ".spv --hlsl --shader-model 30 --output " + src + ".hlsl");
+            }
+        }
+        else {
+            busy(g_process_ms);
+        }
+    }
+    busy(g_compile_ms);
+    (*c->prepared)[i]++;
+    return true;
+}
+
+// slang_d3d9_prepare_passes on 'workers' threads; false when the batch failed
+static bool prepare_passes(const preset& p, unsigned workers, const std::atomic<int>* cancel,
+    shared_list& list, std::vector<int>& prepared, double& ms)
+{
+    std::mutex process_cs;
+    list.params.clear();
+    prepared.assign(p.passes.size(), 0);
+
+    batch_ctx c;
+    c.p = &p;
+    c.list = &list;
+    c.process_cs = &process_cs;
+    c.prepared = &prepared;
+
+    zm_spb b;
+    b.passes = (unsigned)p.passes.size();
+    b.cancel = cancel;
+    b.ctx = &c;
+    b.register_pass = batch_register;
+    b.prepare = batch_prepare;
+    b.lock = batch_lock;
+    b.unlock = batch_unlock;
+
+    const auto t0 = clk::now();
+    spb_register(b);
+    std::vector<std::thread> threads;
+    for (unsigned w = 1; w < workers; ++w)
+        threads.emplace_back(spb_worker, std::ref(b));
+    spb_worker(b);
+    for (std::thread& t : threads)
+        t.join();
+    ms = std::chrono::duration<double, std::milli>(clk::now() - t0).count();
+    return b.failed.load() == 0;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: zm_slang_prepare_bench [--process-ms N] [--compile-ms N] [preset.slangp | dir]...\n");
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        const bool more = i + 1 < argc;
+        if (a == "--process-ms" && more) g_process_ms = atof(argv[++i]);
+        else if (a == "--compile-ms" && more) g_compile_ms = atof(argv[++i]);
+        else if (a.compare(0, 2, "--") == 0) { usage(); return 1; }
+        else args.push_back(a);
+    }
+    if (args.empty()) {
+        args.push_back("custom");
+        args.push_back("slang-shaders");
+    }
+
+    std::vector<std::string> paths;
+    for (const std::string& a : args) {
+        struct stat st;
+        if (stat(a.c_str(), &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) find_presets(a, paths);
+        else paths.push_back(a);
+    }
+    std::sort(paths.begin(), paths.end());
+
+    char tmpl[] = "/tmp/zm_slang_prepare_bench.XXXXXX";
+    const char* tmp = mkdtemp(tmpl);
+    if (!tmp) { fprintf(stderr, "can't make a temporary directory\n"); return 1; }
+    g_tmp = tmp;
+    g_compilers = run("glslangValidator --version") && run("spirv-cross --help");
+
+    char process[64];
+    snprintf(process, sizeof(process), "%.1f ms busy", g_process_ms);
+    printf("%u core(s); slang_process: %s, D3DX: %.1f ms busy\n", std::thread::hardware_concurrency(),
+        g_compilers ? "glslangValidator + spirv-cross" : process, g_compile_ms);
+    printf("preset                          passes  workers    ms   speedup\n");
+
+    bool ok = true;
+    for (const std::string& path : paths) {
+        preset p;
+        if (!load_preset(path, p)) {
+            printf("%s: can't read it or one of its passes, skipped\n", path.c_str());
+            continue;
+        }
+        const char* name = strrchr(path.c_str(), '/');
+        name = name ? name + 1 : path.c_str();
+
+        shared_list serial;
+        std::vector<int> prepared;
+        double one = 0;
+        unsigned last = 0;
+        for (unsigned workers = 1; workers <= ZM_SLANG_COMPILE_THREADS; workers *= 2) {
+            const unsigned w = spb_workers(workers, (unsigned)p.passes.size());
+            if (w == last)
+                break;
+            last = w;
+            shared_list list;
+            double ms = 0;
+            if (!prepare_passes(p, w, nullptr, list, prepared, ms)) {
+                printf("%s: batch failed on %u workers: FAIL\n", name, w);
+                ok = false;
+            }
+            if (w == 1) {
+                one = ms;
+                serial = list;
+            }
+            for (size_t i = 0; i < prepared.size(); ++i)
+                if (prepared[i] != 1) {
+                    printf("%s: pass %zu prepared %d times on %u workers: FAIL\n", name, i, prepared[i], w);
+                    ok = false;
+                }
+            if (list.params != serial.params) {
+                printf("%s: parameter order differs from the serial run on %u workers: FAIL\n", name, w);
+                ok = false;
+            }
+            printf("%-31s %6zu %8u %7.1f %8.2fx\n", name, p.passes.size(), w, ms, one / ms);
+        }
+
+        // Cancelled before the workers start, as when a newer preset
+        // supersedes the job during the registration
+        const std::atomic<int> cancelled{ 1 };
+        shared_list list;
+        double ms = 0;
+        const bool done = prepare_passes(p, last, &cancelled, list, prepared, ms);
+        if (done || std::count(prepared.begin(), prepared.end(), 0) != (long)prepared.size()) {
+            printf("%s: cancelled batch %s: FAIL\n", name, done ? "succeeded" : "still prepared passes");
+            ok = false;
+        }
+    }
+
+    run("rm -rf " + g_tmp);
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,295 @@
+// zm_slang_swap_mock: render-thread time during a slang preset swap, off-device
+//
+// Runs src/slang_d3d9_async.cpp's begin / poll / cancel on the job
+// protocol it uses (src/slang_job.cpp), with std::thread in place of
+// CreateThread: a refcounted job (owner + worker), begin superseding the
+// job in flight, a poll per Present that swaps in a finished chain or
+// drops a failed one, cancel. The worker
+// reads the preset and include-expands and parses each pass's pragmas
+// (src/slang_pass_meta.cpp) for real; glslang, SPIRV-Cross and D3DX are a
+// sleep of --compile-ms per pass, and the render thread's part of the
+// swap (CreateVertexShader / CreatePixelShader) is --create-us of busy
+// work per pass.
+//
+// A frame loop at --fps edits the preset at frame 10 and records the
+// time each frame spends on the swap, once with the whole compile inside
+// that frame (the synchronous d3d9_gfx_set_shader path) and once through
+// the job. Reports the worst and total per-frame render-thread cost and
+// how many frames the old chain kept drawing. Also checks that a second
+// begin supersedes the first (the first chain is never swapped in), that
+// a failed compile keeps the current chain and that every job is freed;
+// exits with 2 when one doesn't hold or the async worst frame isn't
+// below the synchronous one.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -pthread -Isrc tools/zm_slang_swap_mock.cpp src/slang_job.cpp src/slang_pass_meta.cpp tools/slang_files.cpp -o zm_slang_swap_mock
+// Run:
+//   ./zm_slang_swap_mock custom/ScaleFx+LCD.slangp
+// Options:
+//   --fps N          frame rate of the loop (default 60)
+//   --frames N       frames per run (default 90)
+//   --compile-ms N   worker cost per pass (default 40)
+//   --create-us N    render-thread cost per pass at the swap (default 300)
+
+#include "slang_job.h"
+#include "slang_pass_meta.h"
+#include "slang_files.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ZeroMod;
+
+typedef std::chrono::steady_clock clk;
+
+static double g_compile_ms = 40.0;
+static double g_create_us = 300.0;
+static std::atomic<int> g_live_jobs{ 0 };
+
+// What the worker hands the render thread
+struct chain
+{
+    std::string path;
+    std::vector<zm_spm> passes;
+};
+
+// The parse and prepare half, slang_job_proc's part
+static bool parse_and_prepare(const std::string& path, chain& out, const std::atomic<int>& cancel)
+{
+    std::string text;
+    if (!read_file(path, text))
+        return false;
+    std::vector<std::string> shaders;
+    size_t at = 0;
+    while (at < text.size()) {
+        size_t nl = text.find('\n', at);
+        if (nl == std::string::npos) nl = text.size();
+        const std::string l = text.substr(at, nl - at);
+        at = nl + 1;
+        const size_t eq = l.find('=');
+        const std::string k = eq == std::string::npos ? "" : trim(l.substr(0, eq));
+        if (k.compare(0, 6, "shader") == 0 && k != "shaders")
+            shaders.push_back(join(path, trim(l.substr(eq + 1))));
+    }
+    if (shaders.empty())
+        return false;
+
+    out.path = path;
+    out.passes.resize(shaders.size());
+    for (size_t i = 0; i < shaders.size(); ++i) {
+        if (cancel.load())
+            return false;
+        std::string src;
+        if (!expand(shaders[i], src) || !spm_parse(src.data(), src.size(), out.passes[i]))
+            return false;
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(g_compile_ms));
+    }
+    return true;
+}
+
+// Device-object creation, the render thread's part of a swap
+static void create_objects(const chain& c)
+{
+    const auto until = clk::now() + std::chrono::duration<double, std::micro>(g_create_us * c.passes.size());
+    while (clk::now() < until) {}
+}
+
+struct job : zm_job
+{
+    std::string path;
+    chain result;
+
+    job() { g_live_jobs++; }
+    ~job() { g_live_jobs--; }
+};
+
+static void job_destroy(zm_job* j)
+{
+    delete static_cast<job*>(j);
+}
+
+struct device
+{
+    chain current;
+    zm_job* pending = nullptr;
+    unsigned swaps = 0, failures = 0;
+};
+
+static void async_cancel(device& d)
+{
+    job_cancel(d.pending);
+}
+
+static void async_begin(device& d, const std::string& path)
+{
+    job_cancel(d.pending);
+    job* j = new job();
+    job_init(j, job_destroy);
+    j->path = path;
+    std::thread([j] {
+        job_finish(j, parse_and_prepare(j->path, j->result, j->cancel));
+    }).detach();
+    d.pending = j;
+}
+
+static void async_poll(device& d)
+{
+    job* j = static_cast<job*>(job_take(d.pending));
+    if (!j)
+        return;
+    if (j->state.load() == ZM_JOB_DONE) {
+        create_objects(j->result);
+        d.current = std::move(j->result);
+        d.swaps++;
+    }
+    else {
+        d.failures++;
+    }
+    job_release(j);
+}
+
+struct run_stats
+{
+    double worst_ms = 0, total_ms = 0;
+    int swapped_at = -1;
+};
+
+// One preset edit at frame 10; the frame's own rendering is left out, only
+// what the swap adds to it is timed
+static run_stats frame_loop(const std::string& from, const std::string& to, bool async, unsigned fps, unsigned frames)
+{
+    device d;
+    const std::atomic<int> no_cancel{ 0 };
+    parse_and_prepare(from, d.current, no_cancel);
+    create_objects(d.current);
+
+    run_stats s;
+    const auto period = std::chrono::duration<double>(1.0 / fps);
+    auto next = clk::now();
+    for (unsigned f = 0; f < frames; ++f) {
+        const auto t0 = clk::now();
+        if (f == 10) {
+            if (async) {
+                async_begin(d, to);
+            }
+            else {
+                chain c;
+                if (parse_and_prepare(to, c, no_cancel)) {
+                    create_objects(c);
+                    d.current = std::move(c);
+                    d.swaps++;
+                }
+            }
+        }
+        async_poll(d);
+        const double ms = std::chrono::duration<double, std::milli>(clk::now() - t0).count();
+        s.worst_ms = std::max(s.worst_ms, ms);
+        s.total_ms += ms;
+        if (s.swapped_at < 0 && d.swaps)
+            s.swapped_at = (int)f;
+
+        next += std::chrono::duration_cast<clk::duration>(period);
+        std::this_thread::sleep_until(next);
+    }
+    async_cancel(d);
+    return s;
+}
+
+static bool wait_jobs_freed()
+{
+    for (int i = 0; i < 1000 && g_live_jobs.load(); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return g_live_jobs.load() == 0;
+}
+
+// Begin twice, then once with a preset that doesn't parse
+static bool check_protocol(const std::string& preset, const std::string& other)
+{
+    bool ok = true;
+    device d;
+    async_begin(d, other);
+    async_begin(d, preset);
+    while (d.pending)
+        async_poll(d);
+    if (d.swaps != 1 || d.current.path != preset) {
+        printf("supersede: %u swap(s), current '%s': FAIL\n", d.swaps, d.current.path.c_str());
+        ok = false;
+    }
+
+    async_begin(d, preset + ".missing");
+    while (d.pending)
+        async_poll(d);
+    if (d.failures != 1 || d.current.path != preset) {
+        printf("failed compile: current '%s': FAIL\n", d.current.path.c_str());
+        ok = false;
+    }
+
+    if (!wait_jobs_freed()) {
+        printf("%d job(s) never freed: FAIL\n", g_live_jobs.load());
+        ok = false;
+    }
+    printf("protocol: %s\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: zm_slang_swap_mock [--fps N] [--frames N] [--compile-ms N] [--create-us N] [preset.slangp]\n");
+}
+
+int main(int argc, char** argv)
+{
+    unsigned fps = 60, frames = 90;
+    std::string preset = "custom/ScaleFx+LCD.slangp";
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        const bool more = i + 1 < argc;
+        if (a == "--fps" && more) fps = (unsigned)atoi(argv[++i]);
+        else if (a == "--frames" && more) frames = (unsigned)atoi(argv[++i]);
+        else if (a == "--compile-ms" && more) g_compile_ms = atof(argv[++i]);
+        else if (a == "--create-us" && more) g_create_us = atof(argv[++i]);
+        else if (a.compare(0, 2, "--") == 0) { usage(); return 1; }
+        else preset = a;
+    }
+    if (!fps) fps = 60;
+    if (frames < 11) frames = 11;
+
+    chain probe;
+    const std::atomic<int> no_cancel{ 0 };
+    if (!parse_and_prepare(preset, probe, no_cancel)) {
+        fprintf(stderr, "can't read %s or one of its passes\n", preset.c_str());
+        return 1;
+    }
+    // Swapping from the one-pass stock chain, as after a fresh start
+    const std::string stock = join(preset, "Stock.slangp");
+
+    printf("%s: %zu pass(es), %.1f ms compile and %.0f us create per pass, %u fps\n",
+        preset.c_str(), probe.passes.size(), g_compile_ms, g_create_us, fps);
+
+    bool ok = check_protocol(preset, stock);
+
+    printf("mode   worst frame ms  total ms  swapped at frame\n");
+    const run_stats sync = frame_loop(stock, preset, false, fps, frames);
+    printf("sync   %14.2f %9.2f %17d\n", sync.worst_ms, sync.total_ms, sync.swapped_at);
+    const run_stats async = frame_loop(stock, preset, true, fps, frames);
+    printf("async  %14.2f %9.2f %17d\n", async.worst_ms, async.total_ms, async.swapped_at);
+    if (async.swapped_at > 10)
+        printf("old chain kept drawing for %d frame(s)\n", async.swapped_at - 10);
+
+    if (async.swapped_at < 0 || async.worst_ms >= sync.worst_ms) {
+        printf("async swap: FAIL\n");
+        ok = false;
+    }
+    if (!wait_jobs_freed()) {
+        printf("%d job(s) never freed: FAIL\n", g_live_jobs.load());
+        ok = false;
+    }
+    return ok ? 0 : 2;
+}
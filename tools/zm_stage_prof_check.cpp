@@ -0,0 +1,301 @@
+// zm_stage_prof_check: checks the CPU stage profiler's sample ring and
+// frame window (src/stage_prof_ring.cpp)
+//
+// Generates a run of frames up front: each stage gets 0 to 3 samples a
+// frame, and every 100th frame gfx_frame also gets two samples whose sum
+// overflows 32 bits. A partial frame of samples comes before the first
+// mark. Three passes over it:
+//   window   one thread pushes and drains at random points; every frame a
+//            mark closes must carry its own sums and calls, the window
+//            entry must hold the sum clamped to 32 bits, publish must come
+//            every ZM_PROF_PUBLISH_INTERVAL frames, and avg/min/p99/calls
+//            must match a brute-force sort of the last ZM_PROF_WINDOW
+//            frames; the overlay table gets one line per stage with calls.
+//   full     pushes more than the ring holds without draining; the extra
+//            samples are refused and counted, and the ring keeps every one
+//            it took.
+//   threads  a producer thread pushes the run (retrying refused samples)
+//            while the consumer drains it; every frame must come through
+//            whole and every refusal must be counted.
+// Exits with 2 when a check fails.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -pthread -Isrc tools/zm_stage_prof_check.cpp src/stage_prof_ring.cpp -o zm_stage_prof_check
+// Run:
+//   ./zm_stage_prof_check [frames]
+
+#include "stage_prof_ring.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace ZeroMod;
+
+static uint32_t seed = 12345;
+static uint32_t rnd()
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+static unsigned g_fail = 0;
+
+static void fail(const char* pass, uint64_t frame, const char* what)
+{
+    if (g_fail++ < 10)
+        printf("%s, frame %llu: %s: FAIL\n", pass, (unsigned long long)frame, what);
+}
+
+struct gen_frame
+{
+    std::vector<zm_prof_sample> samples;
+    uint64_t sum[ZM_PS_COUNT];
+    uint32_t calls[ZM_PS_COUNT];
+};
+
+static gen_frame gen_one(unsigned i)
+{
+    gen_frame g = {};
+    if (i % 100 == 99) {
+        g.samples.push_back({ ZM_PS_GFX_FRAME, 0xF0000000u });
+        g.samples.push_back({ ZM_PS_GFX_FRAME, 0xF0000000u });
+        g.sum[ZM_PS_GFX_FRAME] = 2ull * 0xF0000000u;
+        g.calls[ZM_PS_GFX_FRAME] = 2;
+    }
+    for (uint32_t s = 0; s < ZM_PS_COUNT; ++s) {
+        const unsigned n = rnd() % 4;
+        for (unsigned k = 0; k < n; ++k) {
+            const uint32_t ticks = rnd() % 50000;
+            g.samples.push_back({ s, ticks });
+            g.sum[s] += ticks;
+            g.calls[s]++;
+        }
+    }
+    // Scopes close in any order
+    for (size_t i = g.samples.size(); i > 1; --i)
+        std::swap(g.samples[i - 1], g.samples[rnd() % i]);
+    return g;
+}
+
+// What the consumer expects, frame by frame
+struct checker
+{
+    const char* pass;
+    const std::vector<gen_frame>* frames;
+    std::deque<uint32_t> win_sum[ZM_PS_COUNT];     // clamped, newest last
+    std::deque<uint32_t> win_calls[ZM_PS_COUNT];
+    uint64_t closed = 0;
+    bool full_stats = true;
+};
+
+static void on_frame(void* ctx, const zm_prof_frames& f, bool publish)
+{
+    checker& c = *(checker*)ctx;
+    // The first mark only ends the partial frame, so mark i + 1 closes frame i
+    const uint64_t i = f.frame - 1;
+    if (f.frame != c.closed + 1 || i >= c.frames->size()) {
+        fail(c.pass, f.frame, "frame closed out of turn");
+        c.closed = f.frame;
+        return;
+    }
+    c.closed++;
+    const gen_frame& g = (*c.frames)[i];
+
+    if (publish != (c.closed % ZM_PROF_PUBLISH_INTERVAL == 0))
+        fail(c.pass, i, "publish off its interval");
+
+    const uint32_t last = (f.hist_pos + ZM_PROF_WINDOW - 1) % ZM_PROF_WINDOW;
+    for (uint32_t s = 0; s < ZM_PS_COUNT; ++s) {
+        if (f.cur[s] != g.sum[s] || f.cur_calls[s] != g.calls[s])
+            fail(c.pass, i, "frame sums differ from its samples");
+        const uint32_t clamped = (uint32_t)std::min<uint64_t>(g.sum[s], UINT32_MAX);
+        if (f.hist[s][last] != clamped || f.hist_calls[s][last] != g.calls[s])
+            fail(c.pass, i, "window entry differs from the frame");
+
+        c.win_sum[s].push_back(clamped);
+        c.win_calls[s].push_back(g.calls[s]);
+        if (c.win_sum[s].size() > ZM_PROF_WINDOW) {
+            c.win_sum[s].pop_front();
+            c.win_calls[s].pop_front();
+        }
+    }
+    if (f.hist_n != c.win_sum[0].size())
+        fail(c.pass, i, "window length");
+
+    if (!c.full_stats)
+        return;
+    for (uint32_t s = 0; s < ZM_PS_COUNT; ++s) {
+        std::vector<uint32_t> v(c.win_sum[s].begin(), c.win_sum[s].end());
+        uint64_t sum = 0, calls = 0;
+        for (size_t k = 0; k < v.size(); ++k) {
+            sum += v[k];
+            calls += c.win_calls[s][k];
+        }
+        std::sort(v.begin(), v.end());
+
+        zm_prof_stats st;
+        const bool any = spr_stage_stats(f, s, st);
+        if (any != (calls != 0)) {
+            fail(c.pass, i, "stage with calls has no stats, or the reverse");
+            continue;
+        }
+        if (!any)
+            continue;
+        // 99th percentile, nearest rank
+        const size_t rank = (v.size() * 99 + 99) / 100;
+        if (st.avg != (double)sum / v.size() || st.min != v[0] || st.p99 != v[rank - 1]
+            || st.calls != (double)calls / v.size())
+            fail(c.pass, i, "avg/min/p99/calls differ from the window");
+    }
+}
+
+static void push_frame(zm_prof_ring& r, const gen_frame& g)
+{
+    spr_push(r, ZM_PS_FRAME_MARK, 0);
+    for (const zm_prof_sample& s : g.samples)
+        spr_push(r, s.stage, s.ticks);
+}
+
+static void check_window(const std::vector<gen_frame>& frames, const gen_frame& partial)
+{
+    std::unique_ptr<zm_prof_ring> r(new zm_prof_ring);
+    std::unique_ptr<zm_prof_frames> f(new zm_prof_frames());
+    checker c;
+    c.pass = "window";
+    c.frames = &frames;
+
+    for (const zm_prof_sample& s : partial.samples)
+        spr_push(*r, s.stage, s.ticks);
+    for (const gen_frame& g : frames) {
+        push_frame(*r, g);
+        if (rnd() % 4 == 0)
+            spr_drain(*r, *f, on_frame, &c);
+    }
+    spr_push(*r, ZM_PS_FRAME_MARK, 0);
+    spr_drain(*r, *f, on_frame, &c);
+
+    if (c.closed != frames.size())
+        fail(c.pass, c.closed, "not every frame closed");
+    if (r->dropped.load())
+        fail(c.pass, c.closed, "dropped samples with room in the ring");
+
+    std::string t = spr_table(*f, 0.001, 0);
+    unsigned lines = 0, want = 1;
+    for (char ch : t)
+        lines += ch == '\n';
+    zm_prof_stats st;
+    for (uint32_t s = 0; s < ZM_PS_COUNT; ++s)
+        want += spr_stage_stats(*f, s, st);
+    if (lines != want || t.find("dropped") != std::string::npos)
+        fail(c.pass, c.closed, "overlay table lines");
+    if (spr_table(*f, 0.001, 7).find("dropped samples: 7\n") == std::string::npos)
+        fail(c.pass, c.closed, "overlay table doesn't show drops");
+
+    // A reset window starts over at the next mark
+    spr_reset(*f);
+    spr_push(*r, ZM_PS_PRESENT, 5);
+    spr_push(*r, ZM_PS_FRAME_MARK, 0);
+    spr_drain(*r, *f, nullptr, nullptr);
+    if (f->hist_n != 0 || !f->in_frame)
+        fail(c.pass, c.closed, "samples after a reset counted as a frame");
+}
+
+static void check_full()
+{
+    std::unique_ptr<zm_prof_ring> r(new zm_prof_ring);
+    std::unique_ptr<zm_prof_frames> f(new zm_prof_frames());
+    const uint32_t extra = 1000;
+
+    unsigned refused = 0;
+    spr_push(*r, ZM_PS_FRAME_MARK, 0);
+    for (uint32_t k = 0; k < ZM_PROF_RING - 1 + extra; ++k)
+        refused += !spr_push(*r, ZM_PS_OVERLAY, 1);
+    if (refused != extra || r->dropped.load() != extra)
+        fail("full", 0, "full ring didn't refuse and count the extra samples");
+
+    spr_push(*r, ZM_PS_FRAME_MARK, 0);     // refused too
+    spr_drain(*r, *f, nullptr, nullptr);
+    if (f->cur_calls[ZM_PS_OVERLAY] != ZM_PROF_RING - 1 || f->cur[ZM_PS_OVERLAY] != ZM_PROF_RING - 1)
+        fail("full", 0, "ring lost samples it took");
+    if (r->head.load() != r->tail.load())
+        fail("full", 0, "drain left samples behind");
+
+    // Room again after the drain
+    if (!spr_push(*r, ZM_PS_FRAME_MARK, 0))
+        fail("full", 0, "drained ring still full");
+}
+
+static void check_threads(const std::vector<gen_frame>& frames, const gen_frame& partial)
+{
+    std::unique_ptr<zm_prof_ring> r(new zm_prof_ring);
+    std::unique_ptr<zm_prof_frames> f(new zm_prof_frames());
+    checker c;
+    c.pass = "threads";
+    c.frames = &frames;
+    // The sort per frame would slow the consumer into refusing every push
+    c.full_stats = false;
+
+    std::atomic<bool> done{ false };
+    uint64_t refused = 0;
+
+    std::thread producer([&] {
+        auto push = [&](uint32_t stage, uint32_t ticks) {
+            while (!spr_push(*r, stage, ticks)) {
+                refused++;
+                std::this_thread::yield();
+            }
+        };
+        for (const zm_prof_sample& s : partial.samples)
+            push(s.stage, s.ticks);
+        for (const gen_frame& g : frames) {
+            push(ZM_PS_FRAME_MARK, 0);
+            for (const zm_prof_sample& s : g.samples)
+                push(s.stage, s.ticks);
+        }
+        push(ZM_PS_FRAME_MARK, 0);
+        done.store(true, std::memory_order_release);
+    });
+
+    uint32_t spins = 0;
+    for (;;) {
+        const bool last = done.load(std::memory_order_acquire);
+        spr_drain(*r, *f, on_frame, &c);
+        if (last)
+            break;
+        // Fall behind now and then so the ring fills
+        if (++spins % 64 == 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    producer.join();
+
+    if (c.closed != frames.size())
+        fail(c.pass, c.closed, "not every frame came through");
+    if (r->dropped.load() != refused)
+        fail(c.pass, c.closed, "refused pushes not counted");
+    printf("threads: %llu refused pushes while the consumer lagged\n", (unsigned long long)refused);
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned n = argc > 1 ? (unsigned)atoi(argv[1]) : 2000;
+
+    const gen_frame partial = gen_one(0);
+    std::vector<gen_frame> frames;
+    for (unsigned i = 0; i < n; ++i)
+        frames.push_back(gen_one(i));
+
+    check_window(frames, partial);
+    check_full();
+    check_threads(frames, partial);
+
+    printf("%u frames, window %u: %s\n", n, ZM_PROF_WINDOW, g_fail ? "FAIL" : "ok");
+    return g_fail ? 2 : 0;
+}
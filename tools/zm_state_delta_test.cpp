@@ -0,0 +1,707 @@
+// zm_state_delta_test: checks the minimal-delta state save/restore
+// (src/state_delta.cpp) against a recording fake device
+//
+// The fake device (tools/fake_d3d9 stands in for the SDK headers) keeps
+// every state state_delta can touch, logs each Get* and Set*, hands out
+// refcounted fake objects, resets the viewport on SetRenderTarget(0) and
+// lets SetFVF and SetVertexDeclaration clobber each other like d3d9
+// does. Each scope starts from random game state, makes a random run of
+// sd_* writes like an injected pass does (repeats, RT switches, both
+// input layouts, constants through the setters and through
+// sd_touch_*_consts plus a direct write) and closes with sd_end.
+//
+// Checks that afterwards the device holds exactly the state it had
+// before, that each state written was read once and only those states
+// were read (the viewport with the RT, the FVF with the declaration),
+// that sd_end set back only those states, that save_calls and
+// restore_calls match the log, and that every reference a Get* took was
+// dropped. Then the same on a pure device (Get* fails), which has to go
+// through one D3DSBT_ALL state block, and the setters outside a scope,
+// which must fail without a device call. Exits with 2 when a check fails.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -Itools/fake_d3d9 -Isrc tools/zm_state_delta_test.cpp src/state_delta.cpp -o zm_state_delta_test
+// Run:
+//   ./zm_state_delta_test [scopes]
+
+#include "state_delta.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <set>
+#include <vector>
+
+using namespace ZeroMod;
+
+static uint32_t seed = 12345;
+static uint32_t rnd()
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+static unsigned g_fail = 0;
+
+static void fail(unsigned scope, const char* what)
+{
+    if (g_fail++ < 10)
+        printf("scope %u: %s: FAIL\n", scope, what);
+}
+
+// ---- fake objects ----
+template <class I>
+struct fake_obj : I
+{
+    int refs = 1;
+    uint32_t w = 0, h = 0;      // surfaces: the size SetRenderTarget resets the viewport to
+
+    uint32_t AddRef() override { return (uint32_t)++refs; }
+    uint32_t Release() override { return (uint32_t)--refs; }    // pooled by the test, never freed
+};
+
+template <class I>
+static void ref_set(I*& slot, I* v)
+{
+    if (v) v->AddRef();
+    if (slot) slot->Release();
+    slot = v;
+}
+
+template <class I>
+static I* ref_get(I* v)
+{
+    if (v) v->AddRef();
+    return v;
+}
+
+// ---- device state ----
+struct dev_state
+{
+    DWORD rs[ZM_SD_MAX_RS];
+    DWORD samp[ZM_SD_MAX_STAGES][ZM_SD_MAX_SAMP];
+    DWORD tss[ZM_SD_MAX_TSS_STAGES][ZM_SD_MAX_TSS];
+    IDirect3DBaseTexture9* tex[ZM_SD_MAX_STAGES];
+    IDirect3DSurface9* rt0;
+    IDirect3DSurface9* ds;
+    D3DVIEWPORT9 vp;
+    RECT scissor;
+    IDirect3DVertexShader9* vs;
+    IDirect3DPixelShader9* ps;
+    IDirect3DVertexDeclaration9* decl;
+    DWORD fvf;
+    IDirect3DVertexBuffer9* vb0;
+    UINT vb0_offset, vb0_stride;
+    float vsc[ZM_SD_MAX_VS_CONSTS][4];
+    float psc[ZM_SD_MAX_PS_CONSTS][4];
+};
+
+// Copies 'from' into 'to', moving the references the way Set* would
+static void state_assign(dev_state& to, const dev_state& from)
+{
+    dev_state t = from;
+    for (unsigned s = 0; s < ZM_SD_MAX_STAGES; ++s) { t.tex[s] = to.tex[s]; ref_set(t.tex[s], from.tex[s]); }
+    t.rt0 = to.rt0; ref_set(t.rt0, from.rt0);
+    t.ds = to.ds; ref_set(t.ds, from.ds);
+    t.vs = to.vs; ref_set(t.vs, from.vs);
+    t.ps = to.ps; ref_set(t.ps, from.ps);
+    t.decl = to.decl; ref_set(t.decl, from.decl);
+    t.vb0 = to.vb0; ref_set(t.vb0, from.vb0);
+    to = t;
+}
+
+static bool state_equal(const dev_state& a, const dev_state& b)
+{
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// ---- the log ----
+enum unit_kind : uint8_t {
+    U_RS, U_SAMP, U_TSS, U_TEX, U_RT0, U_DS, U_VP, U_SCISSOR,
+    U_VS, U_PS, U_DECL, U_FVF, U_STREAM0, U_VSC, U_PSC, U_STATEBLOCK,
+};
+
+// One state: kind, stage and index packed so std::set can hold it
+static uint32_t unit(unit_kind k, unsigned a = 0, unsigned b = 0)
+{
+    return (uint32_t)k << 24 | (a & 0xFF) << 16 | (b & 0xFFFF);
+}
+
+struct call
+{
+    bool get;
+    uint32_t unit;
+};
+
+struct rec_device : IDirect3DDevice9
+{
+    dev_state st{};
+    bool pure = false;
+    std::vector<call> log;
+    unsigned blocks_created = 0, blocks_applied = 0;
+
+    uint32_t AddRef() override { return 1; }
+    uint32_t Release() override { return 1; }
+
+    void note(bool get, uint32_t u) { log.push_back({ get, u }); }
+
+    // A D3DSBT_ALL block: a copy of everything, references held
+    struct block : fake_obj<IDirect3DStateBlock9>
+    {
+        rec_device* dev = nullptr;
+        dev_state saved{};
+        HRESULT Capture() override { state_assign(saved, dev->st); dev->note(true, unit(U_STATEBLOCK)); return S_OK; }
+        HRESULT Apply() override { state_assign(dev->st, saved); dev->note(false, unit(U_STATEBLOCK)); dev->blocks_applied++; return S_OK; }
+        uint32_t Release() override
+        {
+            if (--refs == 0) { dev_state none{}; state_assign(saved, none); delete this; return 0; }
+            return (uint32_t)refs;
+        }
+    };
+
+    HRESULT CreateStateBlock(D3DSTATEBLOCKTYPE type, IDirect3DStateBlock9** out) override
+    {
+        if (type != D3DSBT_ALL || !out) return D3DERR_INVALIDCALL;
+        block* b = new block();
+        b->dev = this;
+        *out = b;
+        blocks_created++;
+        return S_OK;
+    }
+    HRESULT CreateQuery(D3DQUERYTYPE, IDirect3DQuery9**) override { return D3DERR_NOTAVAILABLE; }
+
+    HRESULT SetRenderTarget(DWORD i, IDirect3DSurface9* s) override
+    {
+        if (i != 0) return D3DERR_INVALIDCALL;
+        note(false, unit(U_RT0));
+        ref_set(st.rt0, s);
+        if (s) {
+            const fake_obj<IDirect3DSurface9>* f = static_cast<const fake_obj<IDirect3DSurface9>*>(s);
+            st.vp = { 0, 0, f->w, f->h, 0.0f, 1.0f };
+        }
+        return S_OK;
+    }
+    HRESULT GetRenderTarget(DWORD i, IDirect3DSurface9** out) override
+    {
+        if (pure || i != 0) return D3DERR_INVALIDCALL;
+        note(true, unit(U_RT0));
+        *out = ref_get(st.rt0);
+        return st.rt0 ? S_OK : D3DERR_NOTAVAILABLE;
+    }
+    HRESULT SetDepthStencilSurface(IDirect3DSurface9* s) override { note(false, unit(U_DS)); ref_set(st.ds, s); return S_OK; }
+    HRESULT GetDepthStencilSurface(IDirect3DSurface9** out) override
+    {
+        if (pure) return D3DERR_INVALIDCALL;
+        note(true, unit(U_DS));
+        *out = ref_get(st.ds);
+        return st.ds ? S_OK : D3DERR_NOTAVAILABLE;
+    }
+    HRESULT SetViewport(const D3DVIEWPORT9* vp) override { note(false, unit(U_VP)); st.vp = *vp; return S_OK; }
+    HRESULT GetViewport(D3DVIEWPORT9* vp) override
+    {
+        if (pure) return D3DERR_INVALIDCALL;
+        note(true, unit(U_VP));
+        *vp = st.vp;
+        return S_OK;
+    }
+    HRESULT SetRenderState(D3DRENDERSTATETYPE r, DWORD v) override
+    {
+        if ((unsigned)r >= ZM_SD_MAX_RS) return D3DERR_INVALIDCALL;
+        note(false, unit(U_RS, 0, r));
+        st.rs[r] = v;
+        return S_OK;
+    }
+    HRESULT GetRenderState(D3DRENDERSTATETYPE r, DWORD* v) override
+    {
+        if (pure || (unsigned)r >= ZM_SD_MAX_RS) return D3DERR_INVALIDCALL;
+        note(true, unit(U_RS, 0, r));
+        *v = st.rs[r];
+        return S_OK;
+    }
+    HRESULT GetTexture(DWORD s, IDirect3DBaseTexture9** out) override
+    {
+        if (pure || s >= ZM_SD_MAX_STAGES) return D3DERR_INVALIDCALL;
+        note(true, unit(U_TEX, s));
+        *out = ref_get(st.tex[s]);
+        return S_OK;
+    }
+    HRESULT SetTexture(DWORD s, IDirect3DBaseTexture9* t) override
+    {
+        if (s >= ZM_SD_MAX_STAGES) return D3DERR_INVALIDCALL;
+        note(false, unit(U_TEX, s));
+        ref_set(st.tex[s], t);
+        return S_OK;
+    }
+    HRESULT GetTextureStageState(DWORD s, D3DTEXTURESTAGESTATETYPE t, DWORD* v) override
+    {
+        if (pure || s >= ZM_SD_MAX_TSS_STAGES || (unsigned)t >= ZM_SD_MAX_TSS) return D3DERR_INVALIDCALL;
+        note(true, unit(U_TSS, s, t));
+        *v = st.tss[s][t];
+        return S_OK;
+    }
+    HRESULT SetTextureStageState(DWORD s, D3DTEXTURESTAGESTATETYPE t, DWORD v) override
+    {
+        if (s >= ZM_SD_MAX_TSS_STAGES || (unsigned)t >= ZM_SD_MAX_TSS) return D3DERR_INVALIDCALL;
+        note(false, unit(U_TSS, s, t));
+        st.tss[s][t] = v;
+        return S_OK;
+    }
+    HRESULT GetSamplerState(DWORD s, D3DSAMPLERSTATETYPE t, DWORD* v) override
+    {
+        if (pure || s >= ZM_SD_MAX_STAGES || (unsigned)t >= ZM_SD_MAX_SAMP) return D3DERR_INVALIDCALL;
+        note(true, unit(U_SAMP, s, t));
+        *v = st.samp[s][t];
+        return S_OK;
+    }
+    HRESULT SetSamplerState(DWORD s, D3DSAMPLERSTATETYPE t, DWORD v) override
+    {
+        if (s >= ZM_SD_MAX_STAGES || (unsigned)t >= ZM_SD_MAX_SAMP) return D3DERR_INVALIDCALL;
+        note(false, unit(U_SAMP, s, t));
+        st.samp[s][t] = v;
+        return S_OK;
+    }
+    HRESULT SetScissorRect(const RECT* rc) override { note(false, unit(U_SCISSOR)); st.scissor = *rc; return S_OK; }
+    HRESULT GetScissorRect(RECT* rc) override
+    {
+        if (pure) return D3DERR_INVALIDCALL;
+        note(true, unit(U_SCISSOR));
+        *rc = st.scissor;
+        return S_OK;
+    }
+    // SetVertexDeclaration and SetFVF replace each other
+    HRESULT SetVertexDeclaration(IDirect3DVertexDeclaration9* d) override
+    {
+        note(false, unit(U_DECL));
+        ref_set(st.decl, d);
+        st.fvf = 0;
+        return S_OK;
+    }
+    HRESULT GetVertexDeclaration(IDirect3DVertexDeclaration9** out) override
+    {
+        if (pure) return D3DERR_INVALIDCALL;
+        note(true, unit(U_DECL));
+        *out = ref_get(st.decl);
+        return S_OK;
+    }
+    HRESULT SetFVF(DWORD f) override
+    {
+        note(false, unit(U_FVF));
+        ref_set(st.decl, (IDirect3DVertexDeclaration9*)nullptr);
+        st.fvf = f;
+        return S_OK;
+    }
+    HRESULT GetFVF(DWORD* f) override
+    {
+        if (pure) return D3DERR_INVALIDCALL;
+        note(true, unit(U_FVF));
+        *f = st.fvf;
+        return S_OK;
+    }
+    HRESULT SetVertexShader(IDirect3DVertexShader9* s) override { note(false, unit(U_VS)); ref_set(st.vs, s); return S_OK; }
+    HRESULT GetVertexShader(IDirect3DVertexShader9** out) override
+    {
+        if (pure) return D3DERR_INVALIDCALL;
+        note(true, unit(U_VS));
+        *out = ref_get(st.vs);
+        return S_OK;
+    }
+    HRESULT SetPixelShader(IDirect3DPixelShader9* s) override { note(false, unit(U_PS)); ref_set(st.ps, s); return S_OK; }
+    HRESULT GetPixelShader(IDirect3DPixelShader9** out) override
+    {
+        if (pure) return D3DERR_INVALIDCALL;
+        note(true, unit(U_PS));
+        *out = ref_get(st.ps);
+        return S_OK;
+    }
+    HRESULT SetStreamSource(UINT n, IDirect3DVertexBuffer9* vb, UINT off, UINT stride) override
+    {
+        if (n != 0) return D3DERR_INVALIDCALL;
+        note(false, unit(U_STREAM0));
+        ref_set(st.vb0, vb);
+        st.vb0_offset = off;
+        st.vb0_stride = stride;
+        return S_OK;
+    }
+    HRESULT GetStreamSource(UINT n, IDirect3DVertexBuffer9** vb, UINT* off, UINT* stride) override
+    {
+        if (pure || n != 0) return D3DERR_INVALIDCALL;
+        note(true, unit(U_STREAM0));
+        *vb = ref_get(st.vb0);
+        *off = st.vb0_offset;
+        *stride = st.vb0_stride;
+        return S_OK;
+    }
+
+    HRESULT consts(bool get, bool ps, UINT first, float* data, const float* src, UINT count)
+    {
+        const unsigned max = ps ? ZM_SD_MAX_PS_CONSTS : ZM_SD_MAX_VS_CONSTS;
+        if ((get && pure) || first > max || count > max - first) return D3DERR_INVALIDCALL;
+        float (*regs)[4] = ps ? st.psc : st.vsc;
+        for (UINT r = 0; r < count; ++r) {
+            note(get, unit(ps ? U_PSC : U_VSC, 0, first + r));
+            if (get) memcpy(data + r * 4, regs[first + r], 16);
+            else memcpy(regs[first + r], src + r * 4, 16);
+        }
+        return S_OK;
+    }
+    HRESULT SetVertexShaderConstantF(UINT f, const float* d, UINT n) override { return consts(false, false, f, nullptr, d, n); }
+    HRESULT GetVertexShaderConstantF(UINT f, float* d, UINT n) override { return consts(true, false, f, d, nullptr, n); }
+    HRESULT SetPixelShaderConstantF(UINT f, const float* d, UINT n) override { return consts(false, true, f, nullptr, d, n); }
+    HRESULT GetPixelShaderConstantF(UINT f, float* d, UINT n) override { return consts(true, true, f, d, nullptr, n); }
+};
+
+// ---- object pools ----
+template <class I>
+struct pool
+{
+    std::vector<fake_obj<I>*> objs;
+
+    explicit pool(unsigned n)
+    {
+        for (unsigned i = 0; i < n; ++i) {
+            fake_obj<I>* o = new fake_obj<I>();
+            o->w = 64 + rnd() % 1024;
+            o->h = 64 + rnd() % 1024;
+            objs.push_back(o);
+        }
+    }
+    // Sometimes null, as unbound slots are
+    I* pick(bool allow_null = true)
+    {
+        if (allow_null && rnd() % 6 == 0) return nullptr;
+        return objs[rnd() % objs.size()];
+    }
+    std::vector<int> refs() const
+    {
+        std::vector<int> r;
+        for (const fake_obj<I>* o : objs) r.push_back(o->refs);
+        return r;
+    }
+};
+
+struct pools
+{
+    pool<IDirect3DBaseTexture9> tex{ 12 };
+    pool<IDirect3DSurface9> surf{ 6 };
+    pool<IDirect3DVertexShader9> vs{ 4 };
+    pool<IDirect3DPixelShader9> ps{ 4 };
+    pool<IDirect3DVertexDeclaration9> decl{ 3 };
+    pool<IDirect3DVertexBuffer9> vb{ 3 };
+
+    std::vector<int> refs() const
+    {
+        std::vector<int> r;
+        for (const std::vector<int>& v : { tex.refs(), surf.refs(), vs.refs(), ps.refs(), decl.refs(), vb.refs() })
+            r.insert(r.end(), v.begin(), v.end());
+        return r;
+    }
+};
+
+static float rndf()
+{
+    return (float)(rnd() % 2001) / 1000.0f - 1.0f;
+}
+
+// Whatever the game left bound
+static void game_state(rec_device& d, pools& p)
+{
+    dev_state s{};
+    for (DWORD& v : s.rs) v = rnd();
+    for (auto& st : s.samp) for (DWORD& v : st) v = rnd();
+    for (auto& st : s.tss) for (DWORD& v : st) v = rnd();
+    for (auto& t : s.tex) t = p.tex.pick();
+    s.rt0 = p.surf.pick(false);
+    s.ds = p.surf.pick();
+    s.vp = { rnd() % 64, rnd() % 64, 1 + rnd() % 1024, 1 + rnd() % 1024, 0.0f, 1.0f };
+    s.scissor = { (int32_t)(rnd() % 64), (int32_t)(rnd() % 64), (int32_t)(64 + rnd() % 1024), (int32_t)(64 + rnd() % 1024) };
+    s.vs = p.vs.pick();
+    s.ps = p.ps.pick();
+    if (rnd() & 1) s.decl = p.decl.pick(false);
+    else s.fvf = rnd() | 1;
+    s.vb0 = p.vb.pick();
+    s.vb0_offset = rnd() % 4096;
+    s.vb0_stride = 4 * (1 + rnd() % 16);
+    for (auto& r : s.vsc) for (float& v : r) v = rndf();
+    for (auto& r : s.psc) for (float& v : r) v = rndf();
+    state_assign(d.st, s);
+}
+
+struct expect
+{
+    std::set<uint32_t> saved;       // every state the delta must read and put back
+    unsigned writes = 0;
+};
+
+static void consts_written(expect& e, bool ps, unsigned first, unsigned count)
+{
+    for (unsigned r = first; r < first + count; ++r)
+        e.saved.insert(unit(ps ? U_PSC : U_VSC, 0, r));
+}
+
+// One injected pass' worth of writes, in random order
+static void random_writes(zm_state_delta& sd, rec_device& d, pools& p, expect& e)
+{
+    const unsigned n = 1 + rnd() % 60;
+    for (unsigned i = 0; i < n; ++i) {
+        e.writes++;
+        switch (rnd() % 15) {
+        case 0: {
+            // The few render states a pass sets, so repeats are common
+            const unsigned r = 7 + rnd() % 24;
+            sd_rs(sd, (D3DRENDERSTATETYPE)r, rnd());
+            e.saved.insert(unit(U_RS, 0, r));
+            break;
+        }
+        case 1: {
+            const unsigned s = rnd() % 4, t = 1 + rnd() % (ZM_SD_MAX_SAMP - 1);
+            sd_sampler(sd, s, (D3DSAMPLERSTATETYPE)t, rnd());
+            e.saved.insert(unit(U_SAMP, s, t));
+            break;
+        }
+        case 2: {
+            const unsigned s = rnd() % 2, t = 1 + rnd() % (ZM_SD_MAX_TSS - 1);
+            sd_tss(sd, s, (D3DTEXTURESTAGESTATETYPE)t, rnd());
+            e.saved.insert(unit(U_TSS, s, t));
+            break;
+        }
+        case 3: {
+            const unsigned s = rnd() % 4;
+            sd_texture(sd, s, p.tex.pick());
+            e.saved.insert(unit(U_TEX, s));
+            break;
+        }
+        case 4:
+            sd_rt(sd, p.surf.pick(false));
+            e.saved.insert(unit(U_RT0));
+            e.saved.insert(unit(U_VP));
+            break;
+        case 5:
+            sd_ds(sd, p.surf.pick());
+            e.saved.insert(unit(U_DS));
+            break;
+        case 6: {
+            const D3DVIEWPORT9 vp = { rnd() % 32, rnd() % 32, 1 + rnd() % 512, 1 + rnd() % 512, 0.0f, 1.0f };
+            sd_viewport(sd, vp);
+            e.saved.insert(unit(U_VP));
+            break;
+        }
+        case 7: {
+            const RECT rc = { 0, 0, (int32_t)(1 + rnd() % 512), (int32_t)(1 + rnd() % 512) };
+            sd_scissor(sd, rc);
+            e.saved.insert(unit(U_SCISSOR));
+            break;
+        }
+        case 8:
+            sd_vs(sd, p.vs.pick());
+            e.saved.insert(unit(U_VS));
+            break;
+        case 9:
+            sd_ps(sd, p.ps.pick());
+            e.saved.insert(unit(U_PS));
+            break;
+        case 10:
+            if (rnd() & 1) sd_decl(sd, p.decl.pick());
+            else sd_fvf(sd, rnd() | 1);
+            e.saved.insert(unit(U_DECL));
+            e.saved.insert(unit(U_FVF));
+            break;
+        case 11:
+            sd_stream0(sd, p.vb.pick(), rnd() % 256, 4 * (1 + rnd() % 8));
+            e.saved.insert(unit(U_STREAM0));
+            break;
+        case 12: {
+            float data[8][4];
+            for (auto& r : data) for (float& v : r) v = rndf();
+            const unsigned count = 1 + rnd() % 8, first = rnd() % (ZM_SD_MAX_VS_CONSTS - count + 1);
+            sd_vs_consts(sd, first, &data[0][0], count);
+            consts_written(e, false, first, count);
+            break;
+        }
+        case 13: {
+            float data[8][4];
+            for (auto& r : data) for (float& v : r) v = rndf();
+            const unsigned count = 1 + rnd() % 8, first = rnd() % (ZM_SD_MAX_PS_CONSTS - count + 1);
+            sd_ps_consts(sd, first, &data[0][0], count);
+            consts_written(e, true, first, count);
+            break;
+        }
+        default: {
+            // ID3DXConstantTable writes straight to the device after a touch
+            const bool ps = rnd() & 1;
+            const unsigned count = 1 + rnd() % 6;
+            const unsigned first = rnd() % ((ps ? ZM_SD_MAX_PS_CONSTS : ZM_SD_MAX_VS_CONSTS) - count + 1);
+            float data[6][4];
+            for (auto& r : data) for (float& v : r) v = rndf();
+            if (ps) { sd_touch_ps_consts(sd, first, count); d.SetPixelShaderConstantF(first, &data[0][0], count); }
+            else { sd_touch_vs_consts(sd, first, count); d.SetVertexShaderConstantF(first, &data[0][0], count); }
+            consts_written(e, ps, first, count);
+            break;
+        }
+        }
+    }
+}
+
+static unsigned count_calls(const std::vector<call>& log, size_t from, size_t to, bool get)
+{
+    unsigned n = 0;
+    for (size_t i = from; i < to; ++i)
+        n += log[i].get == get;
+    return n;
+}
+
+// Get*/Set* issued by the delta for constants come as one call per run;
+// the log has one entry per register, so runs are counted separately
+static unsigned logged_calls(const std::vector<call>& log, size_t from, size_t to, bool get)
+{
+    unsigned n = 0;
+    for (size_t i = from; i < to; ++i) {
+        if (log[i].get != get) continue;
+        const unit_kind k = (unit_kind)(log[i].unit >> 24);
+        if ((k == U_VSC || k == U_PSC) && i > from && log[i - 1].get == get &&
+            log[i - 1].unit + 1 == log[i].unit)
+            continue;
+        n++;
+    }
+    return n;
+}
+
+static void delta_scopes(unsigned scopes, pools& p)
+{
+    rec_device d;
+    zm_state_delta* sd = new zm_state_delta();
+    uint64_t gets = 0, sets = 0, writes = 0;
+
+    for (unsigned n = 0; n < scopes; ++n) {
+        game_state(d, p);
+        dev_state before{};
+        state_assign(before, d.st);
+        const std::vector<int> refs = p.refs();
+        d.log.clear();
+
+        sd_begin(*sd, &d);
+        // The probe on the first scope reads ZENABLE once
+        const size_t probe = d.log.size();
+        expect e;
+        // Writes go through, so a write is logged as a Set among the Gets;
+        // mark where sd_end starts
+        random_writes(*sd, d, p, e);
+        const size_t scope_end = d.log.size();
+        const unsigned save_calls = sd->save_calls;
+        sd_end(*sd);
+
+        if (!state_equal(d.st, before))
+            fail(n, "device state differs after sd_end");
+
+        // Reads: exactly the states written, once each
+        std::set<uint32_t> read;
+        bool twice = false;
+        for (size_t i = probe; i < scope_end; ++i)
+            if (d.log[i].get && !read.insert(d.log[i].unit).second)
+                twice = true;
+        if (twice)
+            fail(n, "a state was read twice");
+        if (read != e.saved)
+            fail(n, "states read differ from the states written");
+        if (save_calls != logged_calls(d.log, probe, scope_end, true))
+            fail(n, "save_calls differs from the Get* calls");
+
+        // Restores: only states written; every one of them, but only one of
+        // the declaration and the FVF
+        std::set<uint32_t> restored;
+        for (size_t i = scope_end; i < d.log.size(); ++i) {
+            if (d.log[i].get) { fail(n, "sd_end read a state"); break; }
+            restored.insert(d.log[i].unit);
+        }
+        std::set<uint32_t> want = e.saved;
+        const bool layout = want.erase(unit(U_DECL)) + want.erase(unit(U_FVF)) > 0;
+        const bool got_decl = restored.erase(unit(U_DECL)) > 0, got_fvf = restored.erase(unit(U_FVF)) > 0;
+        if (restored != want || (layout && got_decl == got_fvf) || (!layout && (got_decl || got_fvf)))
+            fail(n, "sd_end set states other than the ones written");
+        if (sd->restore_calls != logged_calls(d.log, scope_end, d.log.size(), false))
+            fail(n, "restore_calls differs from the Set* calls");
+
+        if (p.refs() != refs)
+            fail(n, "a reference taken by Get* was not released");
+
+        gets += count_calls(d.log, probe, scope_end, true);
+        sets += count_calls(d.log, scope_end, d.log.size(), false);
+        writes += e.writes;
+
+        dev_state none{};
+        state_assign(before, none);
+    }
+    printf("delta: %u scopes, %.1f writes, %.1f states saved and %.1f restored per scope\n",
+        scopes, (double)writes / scopes, (double)gets / scopes, (double)sets / scopes);
+    delete sd;
+}
+
+// Get* fails: one state block per scope, nothing read but the probe
+static void pure_device(unsigned scopes, pools& p)
+{
+    rec_device d;
+    d.pure = true;
+    zm_state_delta* sd = new zm_state_delta();
+
+    for (unsigned n = 0; n < scopes; ++n) {
+        game_state(d, p);
+        dev_state before{};
+        state_assign(before, d.st);
+        const std::vector<int> refs = p.refs();
+
+        sd_begin(*sd, &d);
+        expect e;
+        random_writes(*sd, d, p, e);
+        sd_end(*sd);
+
+        if (!state_equal(d.st, before))
+            fail(n, "pure device: state differs after sd_end");
+        if (p.refs() != refs)
+            fail(n, "pure device: references leaked");
+
+        dev_state none{};
+        state_assign(before, none);
+    }
+    if (!sd->pure || d.blocks_created != scopes || d.blocks_applied != scopes)
+        fail(scopes, "pure device: not one D3DSBT_ALL block per scope");
+    printf("pure device: %u scopes, %u state blocks applied\n", scopes, d.blocks_applied);
+    delete sd;
+}
+
+static void outside_scope(pools& p)
+{
+    rec_device d;
+    zm_state_delta* sd = new zm_state_delta();
+    const float c[4] = {};
+    const D3DVIEWPORT9 vp = {};
+    const HRESULT hr[] = {
+        sd_rs(*sd, D3DRS_ZENABLE, 0),
+        sd_sampler(*sd, 0, D3DSAMP_ADDRESSU, 1),
+        sd_tss(*sd, 0, D3DTSS_COLOROP, 1),
+        sd_texture(*sd, 0, p.tex.pick(false)),
+        sd_rt(*sd, p.surf.pick(false)),
+        sd_viewport(*sd, vp),
+        sd_vs_consts(*sd, 0, c, 1),
+        sd_ps_consts(*sd, 0, c, 1),
+    };
+    sd_touch_vs_consts(*sd, 0, 4);
+    sd_end(*sd);
+    for (HRESULT h : hr)
+        if (h != D3DERR_INVALIDCALL)
+            fail(0, "setter outside a scope didn't fail");
+    if (!d.log.empty() || sd_active(*sd))
+        fail(0, "setter outside a scope reached the device");
+    delete sd;
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned scopes = argc > 1 ? (unsigned)atoi(argv[1]) : 2000;
+
+    pools p;
+    delta_scopes(scopes ? scopes : 1, p);
+    pure_device(scopes / 10 + 1, p);
+    outside_scope(p);
+
+    printf("%s\n", g_fail ? "FAIL" : "ok");
+    return g_fail ? 2 : 0;
+}
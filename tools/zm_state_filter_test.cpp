@@ -0,0 +1,433 @@
+// zm_state_filter_test: checks the redundant state filter
+// (src/state_filter.cpp) against a model device
+//
+// Drives the filter the way MyID3D9Device does (tools/fake_d3d9 stands in
+// for the SDK headers): every game SetRenderState / SetSamplerState /
+// SetTextureStageState / SetTexture asks the filter first and only
+// forwarded calls reach the model device, which holds every state the
+// filter shadows. The game stream is material-driven like a real frame (a
+// few presets re-applied per draw, so most calls are redundant) and mixed
+// with everything that changes device state behind the filter: the
+// proxy's own writes to stage 0 and the full unbind, failed Set* calls,
+// BeginStateBlock/EndStateBlock with later Apply, Reset, stages the filter
+// doesn't track (the displacement map and vertex samplers are tracked).
+//
+// Checks at every draw that each entry the filter claims to know matches
+// the device, after every call the game made that the device holds what
+// was asked, and that nothing is dropped while a state block records.
+// Reports the share of calls dropped. Exits with 2 when a check fails.
+//
+// --write FILE also saves the stream as a .zmcr capture laid out like
+// call_rec.cpp writes it (filtered calls flagged, nothing recorded while a
+// state block records, RESET after Reset), for tools/zm_replay.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -Itools/fake_d3d9 -Isrc tools/zm_state_filter_test.cpp src/state_filter.cpp -o zm_state_filter_test
+// Run:
+//   ./zm_state_filter_test [frames] [--write capture.zmcr]
+
+#include "state_filter.h"
+#include "call_rec_format.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using namespace ZeroMod;
+
+static uint32_t seed = 12345;
+static uint32_t rnd()
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+static unsigned g_fail = 0;
+
+static void fail(unsigned frame, const char* what)
+{
+    if (g_fail++ < 10)
+        printf("frame %u: %s: FAIL\n", frame, what);
+}
+
+// Sampler/texture stage -> device slot, as state_filter.cpp maps them
+static int dev_slot(DWORD stage)
+{
+    if (stage < 16)
+        return (int)stage;
+    if (stage == D3DDMAPSAMPLER)
+        return 16;
+    if (stage >= D3DVERTEXTEXTURESAMPLER0 && stage <= D3DVERTEXTEXTURESAMPLER3)
+        return 17 + (int)(stage - D3DVERTEXTEXTURESAMPLER0);
+    return -1;
+}
+
+// ---- model device ----
+struct model_device
+{
+    DWORD rs[ZM_SF_MAX_RS];
+    DWORD samp[ZM_SF_SAMPLERS][ZM_SF_MAX_SAMP];
+    DWORD tss[ZM_SF_TSS_STAGES][ZM_SF_MAX_TSS];
+    uintptr_t tex[ZM_SF_SAMPLERS];
+};
+
+static IDirect3DBaseTexture9* tex_ptr(uintptr_t id) { return (IDirect3DBaseTexture9*)id; }
+
+// One recorded call: 0 RS, 1 sampler, 2 TSS, 3 texture
+struct sb_call
+{
+    int kind;
+    DWORD a, b, value;
+};
+
+// ---- capture writer (call_rec.cpp's layout) ----
+struct capture
+{
+    std::vector<uint32_t> words;
+
+    void put(uint32_t op, const uint32_t* payload, uint32_t n)
+    {
+        words.push_back(cr_head(op, 4 + n * 4));
+        words.insert(words.end(), payload, payload + n);
+    }
+};
+
+// ---- the proxy's side: MyID3D9Device's Set* paths ----
+struct proxy
+{
+    model_device dev{};
+    zm_state_filter sf{};
+    capture* cap = nullptr;
+
+    std::vector<sb_call> recording;             // between Begin/EndStateBlock
+    std::vector<std::vector<sb_call>> blocks;   // recorded state blocks
+
+    unsigned fail_one_in = 0;                   // the device rejects 1 call in N
+    uint64_t calls = 0, dropped = 0, dropped_recording = 0;
+
+    bool device_fails() { return fail_one_in && rnd() % fail_one_in == 0; }
+
+    void record_state(uint32_t op, DWORD a, DWORD b, DWORD v, bool forward)
+    {
+        if (!cap || sf.recording)
+            return;
+        const uint32_t r[4] = { a, b, v, forward ? 1u : 0u };
+        cap->put(op, r, 4);
+    }
+
+    void count(bool forward)
+    {
+        calls++;
+        if (!forward) {
+            dropped++;
+            if (sf.recording)
+                dropped_recording++;
+        }
+    }
+
+    // Each returns false when the device rejected the call
+    bool set_rs(DWORD r, DWORD v)
+    {
+        const bool forward = sf_rs(sf, (D3DRENDERSTATETYPE)r, v);
+        record_state(ZM_CR_OP_SET_RS, 0, r, v, forward);
+        count(forward);
+        if (!forward)
+            return true;
+        if (sf.recording) { recording.push_back({ 0, 0, r, v }); return true; }
+        if (r >= ZM_SF_MAX_RS || device_fails()) {
+            sf_invalidate_rs(sf, (D3DRENDERSTATETYPE)r);
+            return false;
+        }
+        dev.rs[r] = v;
+        return true;
+    }
+
+    bool set_sampler(DWORD s, DWORD t, DWORD v)
+    {
+        const bool forward = sf_sampler(sf, s, (D3DSAMPLERSTATETYPE)t, v);
+        record_state(ZM_CR_OP_SET_SAMP, s, t, v, forward);
+        count(forward);
+        if (!forward)
+            return true;
+        if (sf.recording) { recording.push_back({ 1, s, t, v }); return true; }
+        const int slot = dev_slot(s);
+        if (slot < 0 || t >= ZM_SF_MAX_SAMP || device_fails()) {
+            sf_invalidate_sampler(sf, s);
+            return false;
+        }
+        dev.samp[slot][t] = v;
+        return true;
+    }
+
+    bool set_tss(DWORD s, DWORD t, DWORD v)
+    {
+        const bool forward = sf_tss(sf, s, (D3DTEXTURESTAGESTATETYPE)t, v);
+        record_state(ZM_CR_OP_SET_TSS, s, t, v, forward);
+        count(forward);
+        if (!forward)
+            return true;
+        if (sf.recording) { recording.push_back({ 2, s, t, v }); return true; }
+        if (s >= ZM_SF_TSS_STAGES || t >= ZM_SF_MAX_TSS || device_fails()) {
+            sf_invalidate(sf);
+            return false;
+        }
+        dev.tss[s][t] = v;
+        return true;
+    }
+
+    bool set_texture(DWORD s, uintptr_t id)
+    {
+        const bool forward = sf_texture(sf, s, tex_ptr(id));
+        count(forward);
+        bool ok = true;
+        if (forward && sf.recording) {
+            recording.push_back({ 3, s, 0, (DWORD)id });
+        }
+        else if (forward) {
+            const int slot = dev_slot(s);
+            if (slot < 0 || device_fails()) {
+                sf_invalidate_texture(sf, s);
+                ok = false;
+            }
+            else {
+                dev.tex[slot] = id;
+            }
+        }
+        // Recorded after the call, only when it succeeded
+        if (ok && cap && !sf.recording) {
+            const uint32_t r[5] = { s, (uint32_t)id, 0, 0, 0 };
+            cap->put(ZM_CR_OP_SET_TEX, r, 5);
+        }
+        return ok;
+    }
+
+    void begin_state_block() { sf_begin_record(sf); recording.clear(); }
+
+    void end_state_block()
+    {
+        sf_end_record(sf);
+        blocks.push_back(recording);
+        recording.clear();
+    }
+
+    // MyIDirect3DStateBlock9::Apply
+    void apply_block(const std::vector<sb_call>& b)
+    {
+        for (const sb_call& c : b) {
+            const int slot = dev_slot(c.a);
+            switch (c.kind) {
+            case 0: if (c.b < ZM_SF_MAX_RS) dev.rs[c.b] = c.value; break;
+            case 1: if (slot >= 0 && c.b < ZM_SF_MAX_SAMP) dev.samp[slot][c.b] = c.value; break;
+            case 2: if (c.a < ZM_SF_TSS_STAGES && c.b < ZM_SF_MAX_TSS) dev.tss[c.a][c.b] = c.value; break;
+            case 3: if (slot >= 0) dev.tex[slot] = c.value; break;
+            }
+        }
+        sf_invalidate(sf);
+    }
+
+    // The linear-filter override and the stage 0 blit: written directly
+    void direct_stage0()
+    {
+        dev.samp[0][5] = rnd() % 3;
+        sf_invalidate_sampler(sf, 0);
+        if (rnd() % 2) {
+            dev.tex[0] = 1000 + rnd() % 4;
+            sf_invalidate_texture(sf, 0);
+        }
+    }
+
+    // The full unbind on a failed chain
+    void unbind_all()
+    {
+        for (unsigned s = 0; s < 16; ++s)
+            dev.tex[s] = 0;
+        sf_invalidate(sf);
+    }
+
+    void reset()
+    {
+        // Everything back to defaults (zero stands in for each default)
+        dev = model_device{};
+        sf_invalidate(sf);
+        if (cap)
+            cap->put(ZM_CR_OP_RESET, nullptr, 0);
+    }
+
+    void draw(unsigned i)
+    {
+        if (!cap)
+            return;
+        const uint32_t r[5] = { 5, i * 4, 2, 0, 0 };    // triangle strip, not a quad key
+        cap->put(ZM_CR_OP_DRAW, r, 5);
+    }
+
+    void present(unsigned frame)
+    {
+        sf_frame_end(sf);
+        if (cap) {
+            const uint32_t r[3] = { frame, 1280, 720 };
+            cap->put(ZM_CR_OP_FRAME, r, 3);
+        }
+    }
+};
+
+// Every entry the filter knows must be what the device has
+static bool shadow_matches(const proxy& p)
+{
+    const zm_state_filter& sf = p.sf;
+    for (unsigned r = 0; r < ZM_SF_MAX_RS; ++r)
+        if ((sf.rs_known[r >> 5] >> (r & 31) & 1) && sf.rs[r] != p.dev.rs[r])
+            return false;
+    for (unsigned s = 0; s < ZM_SF_SAMPLERS; ++s) {
+        for (unsigned t = 0; t < ZM_SF_MAX_SAMP; ++t)
+            if ((sf.samp_known[s] >> t & 1) && sf.samp[s][t] != p.dev.samp[s][t])
+                return false;
+        if ((sf.tex_known >> s & 1) && sf.tex[s] != tex_ptr(p.dev.tex[s]))
+            return false;
+    }
+    for (unsigned s = 0; s < ZM_SF_TSS_STAGES; ++s)
+        for (unsigned t = 0; t < ZM_SF_MAX_TSS; ++t)
+            if ((sf.tss_known[s] >> t & 1) && sf.tss[s][t] != p.dev.tss[s][t])
+                return false;
+    return true;
+}
+
+// ---- the game's stream ----
+static const DWORD k_stages[] = {
+    0, 1, 2, 3, D3DDMAPSAMPLER, D3DVERTEXTEXTURESAMPLER0, D3DVERTEXTEXTURESAMPLER3,
+};
+
+struct material
+{
+    DWORD rs[12][2];
+    DWORD samp[8][3];
+    DWORD tss[6][3];
+    DWORD tex[2][2];
+};
+
+// Mostly the common value, now and then one of two others
+static DWORD variant() { return rnd() % 4 ? 0 : 1 + rnd() % 2; }
+
+static material make_material()
+{
+    material m;
+    for (auto& e : m.rs) { e[0] = 7 + rnd() % 24; e[1] = variant(); }
+    for (auto& e : m.samp) { e[0] = k_stages[rnd() % 7]; e[1] = 1 + rnd() % 8; e[2] = variant(); }
+    for (auto& e : m.tss) { e[0] = rnd() % 3; e[1] = 1 + rnd() % 12; e[2] = variant(); }
+    for (auto& e : m.tex) { e[0] = k_stages[rnd() % 7]; e[1] = rnd() % 6; }
+    return m;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned frames = 2000;
+    const char* out = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--write") && i + 1 < argc)
+            out = argv[++i];
+        else
+            frames = (unsigned)atoi(argv[i]);
+    }
+
+    static proxy p;
+    capture cap;
+    if (out)
+        p.cap = &cap;
+    p.fail_one_in = 4000;
+
+    std::vector<material> mats;
+    for (int i = 0; i < 8; ++i)
+        mats.push_back(make_material());
+
+    unsigned applies = 0, resets = 0, rejected = 0;
+    for (unsigned f = 0; f < frames; ++f) {
+        if (f % 500 == 499) {
+            p.reset();
+            resets++;
+        }
+
+        const unsigned draws = 20 + rnd() % 20;
+        for (unsigned d = 0; d < draws; ++d) {
+            const material& m = mats[rnd() % mats.size()];
+            bool ok = true;
+
+            // A call the device rejected has nothing to hold, skip the check
+            for (const auto& e : m.rs)
+                if (p.set_rs(e[0], e[1]) && !p.sf.recording && p.dev.rs[e[0]] != e[1])
+                    ok = false;
+            for (const auto& e : m.samp)
+                if (p.set_sampler(e[0], e[1], e[2]) && !p.sf.recording && p.dev.samp[dev_slot(e[0])][e[1]] != e[2])
+                    ok = false;
+            for (const auto& e : m.tss)
+                if (p.set_tss(e[0], e[1], e[2]) && !p.sf.recording && p.dev.tss[e[0]][e[1]] != e[2])
+                    ok = false;
+            for (const auto& e : m.tex)
+                if (p.set_texture(e[0], e[1]) && !p.sf.recording && p.dev.tex[dev_slot(e[0])] != e[1])
+                    ok = false;
+
+            // Calls the device refuses outright
+            if (rnd() % 16 == 0 && !p.sf.recording) {
+                rejected++;
+                if (p.set_rs(300, 1) || p.set_sampler(40, 1, 1) || p.set_tss(9, 1, 1) || p.set_texture(40, 1))
+                    ok = false;
+            }
+            if (!ok)
+                fail(f, "device doesn't hold a value the game set");
+
+            switch (rnd() % 256) {
+            case 0: p.direct_stage0(); break;
+            case 1: p.unbind_all(); break;
+            case 2:
+                if (!p.sf.recording)
+                    p.begin_state_block();
+                break;
+            case 3: case 4: case 5: case 6: case 7: case 8: case 9:
+                if (p.sf.recording)
+                    p.end_state_block();
+                break;
+            case 10:
+                if (!p.sf.recording && !p.blocks.empty()) {
+                    p.apply_block(p.blocks[rnd() % p.blocks.size()]);
+                    applies++;
+                }
+                break;
+            }
+
+            if (!shadow_matches(p))
+                fail(f, "filter knows a value the device doesn't have");
+            if (!p.sf.recording)
+                p.draw(d);
+        }
+        if (p.sf.recording)
+            p.end_state_block();
+        p.present(f);
+    }
+
+    if (p.dropped_recording)
+        fail(frames, "calls dropped while a state block recorded");
+    if (p.dropped * 2 < p.calls)
+        fail(frames, "less than half of a material-driven stream dropped");
+
+    printf("state filter: %u frames, %llu calls, %llu dropped (%.1f%%), %zu state blocks (%u applied), %u resets, %u rejected\n",
+        frames, (unsigned long long)p.calls, (unsigned long long)p.dropped,
+        p.calls ? 100.0 * (double)p.dropped / (double)p.calls : 0.0,
+        p.blocks.size(), applies, resets, rejected);
+
+    if (out) {
+        FILE* fp = fopen(out, "wb");
+        const zm_cr_file_header hdr = { ZM_CR_MAGIC, ZM_CR_VERSION, sizeof(zm_cr_file_header), 0 };
+        if (!fp || fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+            fwrite(cap.words.data(), 4, cap.words.size(), fp) != cap.words.size()) {
+            fprintf(stderr, "can't write '%s'\n", out);
+            if (fp)
+                fclose(fp);
+            return 1;
+        }
+        fclose(fp);
+        printf("wrote %s (%zu KB)\n", out, (sizeof(hdr) + cap.words.size() * 4) >> 10);
+    }
+
+    puts(g_fail ? "FAIL" : "ok");
+    return g_fail ? 2 : 0;
+}
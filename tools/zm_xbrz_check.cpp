@@ -0,0 +1,307 @@
+// zm_xbrz_check: checks and times the CPU xBRZ kernel (src/xbrz_cpu.cpp)
+//
+// Scales a frame with every instruction set the CPU has (scalar, SSE4.1,
+// AVX2) and requires them to agree byte for byte, then times the best
+// one on 1 and on --threads threads, bands of --band source rows handed
+// out the way the cpu_scaler pool does. --golden compares the output
+// with a reference at the same size and exits with 2 when a channel
+// differs by more than --tolerance (8-bit levels); the reference is the
+// GPU chain's answer, e.g. tools/zm_slang_cpu running a preset whose only
+// pass is custom/shaders/xbrz-freescale.slang (nearest, clamp_to_border)
+// with --viewport at factor times the frame size.
+// tools/xbrz_golden/run.sh checks it against goldens from a Python port
+// of that shader.
+//
+// Images are binary PPM (P6, 8-bit). Without an input, --pattern WxH
+// makes a deterministic pixel-art-like frame (flat areas, diagonal
+// edges, dithering) to run on.
+//
+// Build (Linux):
+//   g++ -O2 -std=c++17 -pthread -Isrc tools/zm_xbrz_check.cpp src/xbrz_cpu.cpp -o zm_xbrz_check
+// Run:
+//   ./zm_xbrz_check --pattern 256x192
+//   ./zm_xbrz_check --factor 4 --golden gold.ppm frame.ppm
+// Options:
+//   --factor N       output factor (default 4)
+//   --frames N       frames per timing (default 100)
+//   --threads N      threads for the pool timing (default: all cores)
+//   --band N         source rows per work item (default 8)
+//   --pattern WxH    generated input instead of a file
+//   --out FILE       write the output
+//   --golden FILE    compare the output with FILE
+//   --tolerance N    allowed difference per channel (default 2)
+
+#include "xbrz_cpu.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ZeroMod;
+
+struct frame
+{
+    uint32_t w = 0, h = 0;
+    std::vector<uint32_t> px;   // X8R8G8B8
+};
+
+static bool read_file(const std::string& path, std::string& out)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    char buf[65536];
+    size_t n;
+    out.clear();
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        out.append(buf, n);
+    fclose(f);
+    return true;
+}
+
+static bool write_file(const std::string& path, const std::string& data)
+{
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    const bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+static bool ppm_token(const std::string& d, size_t& at, unsigned& v)
+{
+    while (at < d.size()) {
+        if (d[at] == '#') {
+            while (at < d.size() && d[at] != '\n') ++at;
+        }
+        else if (isspace((unsigned char)d[at])) {
+            ++at;
+        }
+        else {
+            break;
+        }
+    }
+    if (at >= d.size() || !isdigit((unsigned char)d[at])) return false;
+    v = 0;
+    while (at < d.size() && isdigit((unsigned char)d[at]))
+        v = v * 10 + (unsigned)(d[at++] - '0');
+    return true;
+}
+
+static bool read_ppm(const std::string& path, frame& img)
+{
+    std::string d;
+    if (!read_file(path, d) || d.size() < 2 || d[0] != 'P' || d[1] != '6') return false;
+    size_t at = 2;
+    unsigned w, h, maxval;
+    if (!ppm_token(d, at, w) || !ppm_token(d, at, h) || !ppm_token(d, at, maxval) || maxval != 255 || !w || !h)
+        return false;
+    ++at;
+    if (d.size() < at + (size_t)w * h * 3) return false;
+    img.w = w;
+    img.h = h;
+    img.px.resize((size_t)w * h);
+    for (size_t i = 0; i < img.px.size(); ++i) {
+        const unsigned char* p = (const unsigned char*)d.data() + at + 3 * i;
+        img.px[i] = 0xFF000000u | (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+    }
+    return true;
+}
+
+static bool write_ppm(const std::string& path, const frame& img)
+{
+    std::string d = "P6\n" + std::to_string(img.w) + " " + std::to_string(img.h) + "\n255\n";
+    d.reserve(d.size() + img.px.size() * 3);
+    for (uint32_t p : img.px) {
+        d += (char)(p >> 16);
+        d += (char)(p >> 8);
+        d += (char)p;
+    }
+    return write_file(path, d);
+}
+
+// Flat shapes with diagonal and curved edges, a dithered gradient and
+// some single-pixel noise, from a fixed seed
+static void make_pattern(frame& img, uint32_t w, uint32_t h)
+{
+    static const uint32_t palette[8] = {
+        0x000000, 0xF8F8F8, 0xD83800, 0x0058F8, 0x00A800, 0xF8B800, 0x787878, 0x3CBCFC,
+    };
+    img.w = w;
+    img.h = h;
+    img.px.resize((size_t)w * h);
+    uint32_t seed = 12345;
+    auto rnd = [&]() { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+    for (uint32_t y = 0; y < h; ++y) {
+        for (uint32_t x = 0; x < w; ++x) {
+            uint32_t c = palette[((x / 16) + (y / 16)) & 1 ? 6 : 0];
+            if ((int)x - (int)y > 20 && (int)x - (int)y < 60) c = palette[2];
+            if ((int)x + 2 * (int)y > 180 && (int)x + 2 * (int)y < 200) c = palette[3];
+            const int dx = (int)x - (int)w / 2, dy = (int)y - (int)h / 2;
+            if (dx * dx + dy * dy < 900) c = palette[5];
+            if (dx * dx + dy * dy < 400) c = palette[1];
+            if (y > h - 24) c = palette[((x + y) & 1) ? 4 : 7];
+            if (rnd() % 97 == 0) c = palette[rnd() % 8];
+            img.px[(size_t)y * w + x] = 0xFF000000u | c;
+        }
+    }
+}
+
+// Bands of source rows from a shared counter on 'threads' threads
+static void scale(const zm_xbrz& x, frame& out, unsigned threads, unsigned band)
+{
+    std::atomic<uint32_t> next(0);
+    const size_t pitch = (size_t)out.w * 4;
+    auto work = [&]() {
+        for (;;) {
+            const uint32_t y0 = next.fetch_add(band);
+            if (y0 >= x.h)
+                break;
+            xb_run(x, y0, std::min(x.h, y0 + band), out.px.data(), pitch);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t)
+        pool.emplace_back(work);
+    work();
+    for (auto& t : pool)
+        t.join();
+}
+
+static bool parse_size(const char* s, uint32_t& w, uint32_t& h)
+{
+    unsigned a, b;
+    if (sscanf(s, "%ux%u", &a, &b) != 2 || !a || !b) return false;
+    w = a;
+    h = b;
+    return true;
+}
+
+static void usage()
+{
+    fprintf(stderr,
+        "usage: zm_xbrz_check [--factor N] [--frames N] [--threads N] [--band N] [--out FILE]\n"
+        "                     [--golden FILE] [--tolerance N] (input.ppm | --pattern WxH)\n");
+}
+
+int main(int argc, char** argv)
+{
+    std::string input_path, out_path, golden_path;
+    uint32_t pat_w = 0, pat_h = 0;
+    unsigned factor = 4, frames = 100, band = 8;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    int tolerance = 2;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        const bool more = i + 1 < argc;
+        if (a == "--factor" && more) factor = (unsigned)atoi(argv[++i]);
+        else if (a == "--frames" && more) frames = (unsigned)std::max(1, atoi(argv[++i]));
+        else if (a == "--threads" && more) threads = (unsigned)std::max(1, atoi(argv[++i]));
+        else if (a == "--band" && more) band = (unsigned)std::max(1, atoi(argv[++i]));
+        else if (a == "--pattern" && more) {
+            if (!parse_size(argv[++i], pat_w, pat_h)) { usage(); return 1; }
+        }
+        else if (a == "--out" && more) out_path = argv[++i];
+        else if (a == "--golden" && more) golden_path = argv[++i];
+        else if (a == "--tolerance" && more) tolerance = atoi(argv[++i]);
+        else if (!a.empty() && a[0] == '-') { usage(); return 1; }
+        else if (input_path.empty()) input_path = a;
+        else { usage(); return 1; }
+    }
+    if (input_path.empty() == !pat_w) {
+        usage();
+        return 1;
+    }
+
+    frame src;
+    if (pat_w) {
+        make_pattern(src, pat_w, pat_h);
+    }
+    else if (!read_ppm(input_path, src)) {
+        fprintf(stderr, "can't read %s\n", input_path.c_str());
+        return 1;
+    }
+
+    const int best = xb_cpu_isa();
+    frame ref, out;
+    ref.w = out.w = src.w * factor;
+    ref.h = out.h = src.h * factor;
+    ref.px.resize((size_t)ref.w * ref.h);
+    out.px.resize(ref.px.size());
+
+    bool agree = true;
+    for (int isa = ZM_XBRZ_SCALAR; isa <= best; ++isa) {
+        zm_xbrz x;
+        if (!xb_init(x, src.w, src.h, factor, isa)) {
+            fprintf(stderr, "%ux%u at factor %u is out of range\n", src.w, src.h, factor);
+            return 1;
+        }
+        xb_load(x, src.px.data(), (size_t)src.w * 4, ZM_XBRZ_XRGB8888);
+        frame& dst = isa == ZM_XBRZ_SCALAR ? ref : out;
+        scale(x, dst, 1, band);
+
+        size_t diff = 0;
+        if (isa != ZM_XBRZ_SCALAR)
+            for (size_t i = 0; i < ref.px.size(); ++i)
+                diff += ref.px[i] != out.px[i];
+        agree = agree && !diff;
+
+        // Single thread, then the pool
+        double ms[2];
+        const unsigned counts[2] = { 1, threads };
+        for (int t = 0; t < 2; ++t) {
+            const auto t0 = std::chrono::steady_clock::now();
+            for (unsigned f = 0; f < frames; ++f)
+                scale(x, dst, counts[t], band);
+            ms[t] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() / frames;
+        }
+        printf("%-7s %ux%u -> %ux%u: %.3f ms/frame, %.3f ms on %u threads%s\n",
+            xb_isa_name(isa), src.w, src.h, out.w, out.h, ms[0], ms[1], threads,
+            isa == ZM_XBRZ_SCALAR ? "" : (diff ? (", " + std::to_string(diff) + " pixel(s) differ from scalar: FAIL").c_str() : ", same as scalar"));
+    }
+    const frame& final_img = best == ZM_XBRZ_SCALAR ? ref : out;
+
+    if (!out_path.empty() && !write_ppm(out_path, final_img)) {
+        fprintf(stderr, "can't write %s\n", out_path.c_str());
+        return 1;
+    }
+    if (!agree)
+        return 2;
+
+    if (!golden_path.empty()) {
+        frame golden;
+        if (!read_ppm(golden_path, golden)) {
+            fprintf(stderr, "can't read %s\n", golden_path.c_str());
+            return 1;
+        }
+        if (golden.w != final_img.w || golden.h != final_img.h) {
+            printf("golden: size %ux%u, output %ux%u: FAIL\n", golden.w, golden.h, final_img.w, final_img.h);
+            return 2;
+        }
+        uint64_t bad = 0;
+        int worst = 0;
+        double sq = 0;
+        for (size_t i = 0; i < golden.px.size(); ++i) {
+            bool off = false;
+            for (int c = 0; c < 3; ++c) {
+                const int d = abs((int)((golden.px[i] >> (8 * c)) & 0xFF) - (int)((final_img.px[i] >> (8 * c)) & 0xFF));
+                worst = std::max(worst, d);
+                sq += (double)d * d;
+                off = off || d > tolerance;
+            }
+            bad += off;
+        }
+        const double mse = sq / ((double)golden.w * golden.h * 3);
+        printf("golden: %llu pixel(s) off by more than %d, max %d, PSNR %s: %s\n", (unsigned long long)bad, tolerance, worst,
+            mse > 0 ? std::to_string(10.0 * log10(255.0 * 255.0 / mse)).c_str() : "inf", bad ? "FAIL" : "ok");
+        if (bad) return 2;
+    }
+    return 0;
+}